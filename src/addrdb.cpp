@@ -139,7 +139,12 @@ CAddrDB::CAddrDB()
 
 bool CAddrDB::Write(const CAddrMan& addr)
 {
-    return SerializeFileDB("peers", pathAddr, addr);
+    // Serialize into memory first. CAddrMan locks itself while being serialized, this way the lock is held only
+    // once and not during the file write and fsync. It also makes sure that the checksum covers the same snapshot
+    // as the written data.
+    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
+    ssPeers << addr;
+    return SerializeFileDB("peers", pathAddr, ssPeers);
 }
 
 bool CAddrDB::Read(CAddrMan& addr)
@@ -89,13 +89,13 @@ public:
     }
 
     //! Calculate in which "tried" bucket this entry belongs
-    int GetTriedBucket(const uint256 &nKey, const std::vector<bool> &asmap) const;
+    int GetTriedBucket(const uint256 &nKey, const ASMap &asmap) const;
 
     //! Calculate in which "new" bucket this entry belongs, given a certain source
-    int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const std::vector<bool> &asmap) const;
+    int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const ASMap &asmap) const;
 
     //! Calculate in which "new" bucket this entry belongs, using its default source
-    int GetNewBucket(const uint256 &nKey, const std::vector<bool> &asmap) const
+    int GetNewBucket(const uint256 &nKey, const ASMap &asmap) const
     {
         return GetNewBucket(nKey, source, asmap);
     }
@@ -319,7 +319,7 @@ public:
     //
     // If a new asmap was provided, the existing records
     // would be re-bucketed accordingly.
-    std::vector<bool> m_asmap;
+    ASMap m_asmap;
 
     // Read asmap from provided binary file
     static std::vector<bool> DecodeAsmap(fs::path path);
@@ -406,8 +406,8 @@ public:
         // Store asmap checksum after bucket entries so that it
         // can be ignored by older clients for backward compatibility.
         uint256 asmap_checksum;
-        if (m_asmap.size() != 0) {
-            asmap_checksum = SerializeHash(m_asmap);
+        if (!m_asmap.IsEmpty()) {
+            asmap_checksum = SerializeHash(m_asmap.GetBits());
         }
         s << asmap_checksum;
     }
@@ -512,8 +512,8 @@ public:
         // to restore the entries to the buckets/positions they were in before
         // serialization.
         uint256 supplied_asmap_checksum;
-        if (m_asmap.size() != 0) {
-            supplied_asmap_checksum = SerializeHash(m_asmap);
+        if (!m_asmap.IsEmpty()) {
+            supplied_asmap_checksum = SerializeHash(m_asmap.GetBits());
         }
         uint256 serialized_asmap_checksum;
         if (format >= Format::V2_ASMAP) {
@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 
 #include <crypto/sha256.h>
+#include <crypto/siphash.h>
 #include <key.h>
 #include <random.h>
 #include <stacktraces.h>
@@ -77,6 +78,7 @@ int main(int argc, char** argv)
     const fs::path bench_datadir{SetDataDir()};
 
     SHA256AutoDetect();
+    SipHashAutoDetect();
 
     RegisterPrettySignalHandlers();
     RegisterPrettyTerminateHander();
@@ -0,0 +1,62 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bip39.h>
+#include <key.h>
+#include <pubkey.h>
+
+#include <cassert>
+
+static const SecureString BENCH_MNEMONIC("abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about");
+
+static void BIP39_ToSeed(benchmark::Bench& bench)
+{
+    SecureVector seed;
+    bench.unit("seed").run([&] {
+        CMnemonic::ToSeed(BENCH_MNEMONIC, SecureString("TREZOR"), seed);
+    });
+}
+
+// A batch of wallets is restored at once, the seeds are derived in parallel
+static void BIP39_ToSeeds_64(benchmark::Bench& bench)
+{
+    std::vector<std::pair<SecureString, SecureString>> mnemonics;
+    for (int i = 0; i < 64; i++) {
+        mnemonics.emplace_back(BENCH_MNEMONIC, SecureString(std::to_string(i).c_str()));
+    }
+    std::vector<SecureVector> seeds;
+    bench.batch(mnemonics.size()).unit("seed").run([&] {
+        CMnemonic::ToSeeds(mnemonics, seeds);
+    });
+}
+
+// A wallet is restored from its mnemonic and fills its keypool. This is what CHDChain::SetMnemonic and
+// CWallet::DeriveNewChildKeys do, with the BIP44 path of mainnet spelled out to not depend on the chain params.
+static void BIP39_Restore_FirstKeypool(benchmark::Bench& bench)
+{
+    const uint32_t keypoolSize = 1000;
+    bench.unit("wallet").run([&] {
+        SecureVector seed;
+        CMnemonic::ToSeed(BENCH_MNEMONIC, SecureString(), seed);
+
+        CExtKey masterKey, purposeKey, cointypeKey, accountKey, changeKey;
+        masterKey.SetSeed(seed.data(), seed.size());
+        masterKey.Derive(purposeKey, 44 | 0x80000000);
+        purposeKey.Derive(cointypeKey, 5 | 0x80000000);
+        cointypeKey.Derive(accountKey, 0 | 0x80000000);
+        accountKey.Derive(changeKey, 0);
+
+        const CExtPubKey changePubKey = changeKey.Neuter();
+        CExtPubKey childKey;
+        for (uint32_t i = 0; i < keypoolSize; i++) {
+            bool ok = changePubKey.Derive(childKey, i);
+            assert(ok);
+        }
+    });
+}
+
+BENCHMARK(BIP39_ToSeed);
+BENCHMARK(BIP39_ToSeeds_64);
+BENCHMARK(BIP39_Restore_FirstKeypool);
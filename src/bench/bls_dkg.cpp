@@ -4,7 +4,9 @@
 
 #include <bench/bench.h>
 #include <random.h>
+#include <bls/bls_ies.h>
 #include <bls/bls_worker.h>
+#include <version.h>
 
 extern CBLSWorker blsWorker;
 
@@ -131,3 +133,71 @@ BENCH_VerifyContributionShares(simple, 400, 5, false, 1)
 BENCH_VerifyContributionShares(aggregated, 10, 5, true, 100)
 BENCH_VerifyContributionShares(aggregated, 100, 5, true, 10)
 BENCH_VerifyContributionShares(aggregated, 400, 5, true, 1)
+
+static void BuildContributionRecipients(size_t quorumSize, std::vector<CBLSSecretKey>& operatorKeys, std::vector<CBLSPublicKey>& recipients, BLSSecretKeyVector& skShares)
+{
+    operatorKeys.resize(quorumSize);
+    recipients.resize(quorumSize);
+    skShares.resize(quorumSize);
+    for (size_t i = 0; i < quorumSize; i++) {
+        operatorKeys[i].MakeNewKey();
+        recipients[i] = operatorKeys[i].GetPublicKey();
+        skShares[i].MakeNewKey();
+    }
+}
+
+static void BLSDKG_EncryptContributions_400(benchmark::Bench& bench)
+{
+    std::vector<CBLSSecretKey> operatorKeys;
+    std::vector<CBLSPublicKey> recipients;
+    BLSSecretKeyVector skShares;
+    BuildContributionRecipients(400, operatorKeys, recipients, skShares);
+
+    bench.minEpochIterations(1).run([&] {
+        CBLSIESMultiRecipientObjects<CBLSSecretKey> encrypted;
+        bool ok = blsWorker.EncryptContributionShares(recipients, skShares, encrypted, PROTOCOL_VERSION);
+        assert(ok);
+    });
+}
+
+static void BLSDKG_EncryptContributions_Serial_400(benchmark::Bench& bench)
+{
+    std::vector<CBLSSecretKey> operatorKeys;
+    std::vector<CBLSPublicKey> recipients;
+    BLSSecretKeyVector skShares;
+    BuildContributionRecipients(400, operatorKeys, recipients, skShares);
+
+    bench.minEpochIterations(1).run([&] {
+        CBLSIESMultiRecipientObjects<CBLSSecretKey> encrypted;
+        encrypted.InitEncrypt(recipients.size());
+        for (size_t i = 0; i < recipients.size(); i++) {
+            bool ok = encrypted.Encrypt(i, recipients[i], skShares[i], PROTOCOL_VERSION);
+            assert(ok);
+        }
+    });
+}
+
+static void BLSDKG_DecryptContributions_400(benchmark::Bench& bench)
+{
+    std::vector<CBLSSecretKey> operatorKeys;
+    std::vector<CBLSPublicKey> recipients;
+    BLSSecretKeyVector skShares;
+    BuildContributionRecipients(400, operatorKeys, recipients, skShares);
+
+    // we only decrypt our own share from each contribution, so using the same contribution 400 times is good enough.
+    // Use the last member, as it has the longest IV chain
+    auto encrypted = std::make_shared<CBLSIESMultiRecipientObjects<CBLSSecretKey>>();
+    bool ok = blsWorker.EncryptContributionShares(recipients, skShares, *encrypted, PROTOCOL_VERSION);
+    assert(ok);
+    std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>> contributions(400, encrypted);
+    size_t myIdx = 399;
+
+    bench.minEpochIterations(1).run([&] {
+        auto result = blsWorker.DecryptContributionShares(contributions, myIdx, operatorKeys[myIdx], PROTOCOL_VERSION);
+        assert(result.size() == contributions.size() && result[0] == skShares[myIdx]);
+    });
+}
+
+BENCHMARK(BLSDKG_EncryptContributions_400)
+BENCHMARK(BLSDKG_EncryptContributions_Serial_400)
+BENCHMARK(BLSDKG_DecryptContributions_400)
@@ -101,5 +101,31 @@ static void BnBExhaustion(benchmark::Bench& bench)
     });
 }
 
+// Selects fully mixed coins for a CoinJoin send from a wallet with thousands of coins of each denomination
+static void CoinSelectionDenominated(benchmark::Bench& bench)
+{
+    std::vector<OutputGroup> utxo_pool;
+    CAmount target = 0;
+    for (const CAmount nDenom : CCoinJoin::GetStandardDenominations()) {
+        for (int i = 0; i < 2000; ++i) {
+            CMutableTransaction tx;
+            tx.nLockTime = i; // so all transactions get different hashes
+            tx.vout.resize(1);
+            tx.vout[0].nValue = nDenom;
+            utxo_pool.emplace_back(CInputCoin(MakeTransactionRef(std::move(tx)), 0), 6, false, 0, 0);
+        }
+        target += 7 * nDenom;
+    }
+    CoinSet selection;
+    CAmount value_ret = 0;
+
+    bench.run([&] {
+        bool success = SelectCoinsDenominated(target, utxo_pool, selection, value_ret, 0);
+        assert(success);
+        assert(value_ret == target);
+    });
+}
+
 BENCHMARK(CoinSelection);
 BENCHMARK(BnBExhaustion);
+BENCHMARK(CoinSelectionDenominated);
@@ -216,6 +216,37 @@ static void HASH_SipHash_32b(benchmark::Bench& bench)
     });
 }
 
+/* Hash 1024 uint256 keys via SipHash, one at a time and batched */
+
+static void HASH_SipHash_1024(benchmark::Bench& bench)
+{
+    std::vector<uint256> keys(1024);
+    for (size_t i = 0; i < keys.size(); i++) {
+        *((uint64_t*)keys[i].begin()) = i;
+    }
+    std::vector<uint64_t> out(keys.size());
+    uint64_t k1 = 0;
+    bench.minEpochIterations(1000).run([&] {
+        ++k1;
+        for (size_t i = 0; i < keys.size(); i++) {
+            out[i] = SipHashUint256(0, k1, keys[i]);
+        }
+    });
+}
+
+static void HASH_SipHashBatch_1024(benchmark::Bench& bench)
+{
+    std::vector<uint256> keys(1024);
+    for (size_t i = 0; i < keys.size(); i++) {
+        *((uint64_t*)keys[i].begin()) = i;
+    }
+    std::vector<uint64_t> out(keys.size());
+    uint64_t k1 = 0;
+    bench.minEpochIterations(1000).run([&] {
+        SipHashUint256Batch(0, ++k1, keys.data(), out.data(), keys.size());
+    });
+}
+
 /* Hash 1024 blobs 64 bytes each via DSHA256 */
 
 static void HASH_SHA256D64_1024(benchmark::Bench& bench)
@@ -267,6 +298,8 @@ BENCHMARK(HASH_X11_2048b_single);
 
 BENCHMARK(HASH_SHA256_32b);
 BENCHMARK(HASH_SipHash_32b);
+BENCHMARK(HASH_SipHash_1024);
+BENCHMARK(HASH_SipHashBatch_1024);
 
 BENCHMARK(HASH_SHA256D64_1024);
 
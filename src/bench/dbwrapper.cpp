@@ -0,0 +1,58 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <dbwrapper.h>
+#include <random.h>
+
+// 100k entries in the DB, split over 10 prefixes, with 1% of them overwritten or deleted in the transactions
+static const uint32_t ENTRY_COUNT = 100000;
+static const uint32_t PREFIX_COUNT = 10;
+
+static void DBWrapperTransactionIterator(benchmark::Bench& bench)
+{
+    typedef CDBCompactTransaction<CDBWrapper, CDBBatch> RootTransaction;
+
+    FastRandomContext rnd(true);
+    CDBWrapper dbw(fs::path(), 8 << 20, true);
+    CDBBatch batch(dbw);
+    for (uint32_t i = 0; i < ENTRY_COUNT; i++) {
+        batch.Write(std::make_tuple((uint8_t)(i % PREFIX_COUNT), htobe32(i)), rnd.rand256());
+    }
+    dbw.WriteBatch(batch);
+    batch.Clear();
+
+    RootTransaction rootTx(dbw, batch);
+    CDBTransaction<RootTransaction, RootTransaction> curTx(rootTx, rootTx);
+    for (uint32_t i = 0; i < ENTRY_COUNT / 100; i++) {
+        uint32_t n = (uint32_t)rnd.randrange(ENTRY_COUNT);
+        auto key = std::make_tuple((uint8_t)(n % PREFIX_COUNT), htobe32(n));
+        switch (rnd.randrange(4)) {
+            case 0: rootTx.Write(key, rnd.rand256()); break;
+            case 1: rootTx.Erase(key); break;
+            case 2: curTx.Write(key, rnd.rand256()); break;
+            case 3: curTx.Erase(key); break;
+        }
+    }
+
+    // iterate over one prefix, like the LLMQ code does for mined commitments
+    const uint8_t prefix = PREFIX_COUNT / 2;
+    bench.batch(ENTRY_COUNT / PREFIX_COUNT).unit("entry").run([&] {
+        auto it = curTx.NewIteratorUniquePtr();
+        size_t nCount = 0;
+        for (it->Seek(std::make_tuple(prefix, (uint32_t)0)); it->Valid(); it->Next()) {
+            std::tuple<uint8_t, uint32_t> key;
+            uint256 value;
+            if (!it->GetKey(key) || std::get<0>(key) != prefix) {
+                break;
+            }
+            if (it->GetValue(value)) {
+                nCount++;
+            }
+        }
+        assert(nCount > 0);
+    });
+}
+
+BENCHMARK(DBWrapperTransactionIterator);
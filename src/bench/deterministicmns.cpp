@@ -0,0 +1,134 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <evo/deterministicmns.h>
+#include <random.h>
+
+// Roughly the size of the mainnet list, with a third of all MNs carrying some PoSe penalty
+static const size_t MN_COUNT = 4500;
+static const size_t PENALIZED_RATIO = 3;
+
+static CDeterministicMNList BuildList(size_t penalizedRatio = PENALIZED_RATIO)
+{
+    FastRandomContext rnd(true);
+    CDeterministicMNList mnList(uint256(), 1, 0);
+    for (size_t i = 0; i < MN_COUNT; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = rnd.rand256();
+        dmn->collateralOutpoint = COutPoint(rnd.rand256(), 0);
+        dmn->nOperatorReward = 0;
+
+        auto dmnState = std::make_shared<CDeterministicMNState>();
+        dmnState->nRegisteredHeight = 1;
+        dmnState->keyIDOwner = CKeyID(uint160(rnd.randbytes(20)));
+        dmnState->keyIDVoting = dmnState->keyIDOwner;
+        if (penalizedRatio != 0 && i % penalizedRatio == 0) {
+            dmnState->nPoSePenalty = 1 + (int)rnd.randrange(100);
+        }
+        dmn->pdmnState = dmnState;
+        mnList.AddMN(dmn);
+    }
+    return mnList;
+}
+
+static void DeterministicMNList_DecreasePoSePenalties(benchmark::Bench& bench)
+{
+    const auto baseList = BuildList();
+    bench.batch(MN_COUNT / PENALIZED_RATIO).unit("mn").run([&] {
+        auto mnList = baseList;
+        CDeterministicMNManager::DecreasePoSePenalties(mnList);
+    });
+}
+
+// The per-MN path through UpdateMN, which DecreasePoSePenalties used before
+static void DeterministicMNList_DecreasePoSePenalties_Single(benchmark::Bench& bench)
+{
+    const auto baseList = BuildList();
+    bench.batch(MN_COUNT / PENALIZED_RATIO).unit("mn").run([&] {
+        auto mnList = baseList;
+        std::vector<uint256> toDecrease;
+        mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+            if (dmn->pdmnState->nPoSePenalty > 0 && !dmn->pdmnState->IsBanned()) {
+                toDecrease.emplace_back(dmn->proTxHash);
+            }
+        });
+        for (const auto& proTxHash : toDecrease) {
+            mnList.PoSeDecrease(proTxHash);
+        }
+    });
+}
+
+static void DeterministicMNList_BuildDiff(benchmark::Bench& bench)
+{
+    const auto baseList = BuildList();
+    auto mnList = baseList;
+    CDeterministicMNManager::DecreasePoSePenalties(mnList);
+    bench.batch(MN_COUNT).unit("mn").run([&] {
+        auto diff = baseList.BuildDiff(mnList);
+        assert(diff.updatedMNs.size() == (MN_COUNT + PENALIZED_RATIO - 1) / PENALIZED_RATIO);
+    });
+}
+
+// Replaying diffs is what GetListForBlock does between the last snapshot (or checkpoint) and the requested block. Every
+// block pays one MN, punishes one MN and decreases PoSe penalties, which is roughly what most diffs on mainnet look like.
+// The diffs of a whole snapshot period are built, and the last nReplay diffs of it are replayed.
+static const size_t SNAPSHOT_PERIOD = 576; // CDeterministicMNManager::DISK_SNAPSHOT_PERIOD
+
+static void ReplayDiffs(benchmark::Bench& bench, size_t nReplay)
+{
+    FastRandomContext rnd(true);
+    const size_t nDiffs = SNAPSHOT_PERIOD - 1;
+
+    std::vector<uint256> blockHashes(nDiffs);
+    std::vector<CBlockIndex> blockIndexes(nDiffs);
+    std::vector<CDeterministicMNListDiff> diffs;
+
+    auto mnList = BuildList(0);
+    std::vector<uint256> proTxHashes;
+    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        proTxHashes.emplace_back(dmn->proTxHash);
+    });
+
+    CDeterministicMNList startList;
+    for (size_t i = 0; i < nDiffs; i++) {
+        if (i == nDiffs - nReplay) {
+            startList = mnList;
+        }
+        blockHashes[i] = rnd.rand256();
+        blockIndexes[i].phashBlock = &blockHashes[i];
+        blockIndexes[i].nHeight = (int)i + 2;
+
+        auto newList = mnList;
+        auto payee = newList.GetMN(proTxHashes[rnd.randrange(proTxHashes.size())]);
+        auto newState = std::make_shared<CDeterministicMNState>(*payee->pdmnState);
+        newState->nLastPaidHeight = blockIndexes[i].nHeight;
+        newList.UpdateMN(payee, newState);
+        CDeterministicMNManager::DecreasePoSePenalties(newList);
+        newList.PoSePunish(proTxHashes[rnd.randrange(proTxHashes.size())], newList.CalcPenalty(66), false);
+
+        diffs.emplace_back(mnList.BuildDiff(newList));
+        mnList = newList;
+    }
+
+    bench.batch(nReplay).unit("diff").run([&] {
+        auto snapshot = startList;
+        for (size_t i = nDiffs - nReplay; i < nDiffs; i++) {
+            snapshot = snapshot.ApplyDiff(&blockIndexes[i], diffs[i]);
+        }
+        assert(snapshot.GetHeight() == (int)nDiffs + 1);
+    });
+}
+
+// Worst case without checkpoints, one block before the next disk snapshot
+static void DeterministicMNList_ReplayDiffs_DiskSnapshot(benchmark::Bench& bench) { ReplayDiffs(bench, SNAPSHOT_PERIOD - 1); }
+// Worst case when starting at an in-memory checkpoint (CDeterministicMNManager::LIST_CHECKPOINT_PERIOD - 1 diffs)
+static void DeterministicMNList_ReplayDiffs_Checkpoint(benchmark::Bench& bench) { ReplayDiffs(bench, 31); }
+
+BENCHMARK(DeterministicMNList_DecreasePoSePenalties)
+BENCHMARK(DeterministicMNList_DecreasePoSePenalties_Single)
+BENCHMARK(DeterministicMNList_BuildDiff)
+BENCHMARK(DeterministicMNList_ReplayDiffs_DiskSnapshot)
+BENCHMARK(DeterministicMNList_ReplayDiffs_Checkpoint)
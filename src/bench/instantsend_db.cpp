@@ -0,0 +1,44 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <dbwrapper.h>
+#include <llmq/quorums_instantsend.h>
+#include <random.h>
+
+// 100k locks mined in 1000 blocks, each with 2 inputs
+static const size_t LOCK_COUNT = 100000;
+static const int BLOCK_COUNT = 1000;
+
+static void InstantSendDb_WriteConfirmArchive(benchmark::Bench& bench)
+{
+    FastRandomContext rnd(true);
+    std::vector<std::pair<uint256, llmq::CInstantSendLock>> islocks;
+    islocks.reserve(LOCK_COUNT);
+    for (size_t i = 0; i < LOCK_COUNT; i++) {
+        llmq::CInstantSendLock islock;
+        islock.txid = rnd.rand256();
+        islock.inputs.emplace_back(rnd.rand256(), 0);
+        islock.inputs.emplace_back(rnd.rand256(), 1);
+        islocks.emplace_back(::SerializeHash(islock), std::move(islock));
+    }
+
+    bench.batch(LOCK_COUNT).unit("islock").epochs(1).epochIterations(1).run([&] {
+        CDBWrapper dbw(fs::path(), 8 << 20, true);
+        llmq::CInstantSendDb db(dbw);
+
+        for (size_t i = 0; i < islocks.size(); i++) {
+            db.WriteNewInstantSendLock(islocks[i].first, islocks[i].second);
+            db.WriteInstantSendLockMined(islocks[i].first, 1 + (int)(i * BLOCK_COUNT / islocks.size()));
+        }
+        // same as what HandleFullyConfirmedBlock does for every new block
+        for (int nHeight = 1; nHeight <= BLOCK_COUNT + 100; nHeight++) {
+            db.RemoveConfirmedInstantSendLocks(nHeight);
+            db.RemoveArchivedInstantSendLocks(nHeight - 100);
+        }
+        assert(db.GetInstantSendLockCount() == 0);
+    });
+}
+
+BENCHMARK(InstantSendDb_WriteConfirmArchive)
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <llmq/quorums.h>
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_signing_shares.h>
+#include <random.h>
+#include <streams.h>
+#include <version.h>
+
+static CBLSSignature MakeSignature()
+{
+    CBLSSecretKey secKey;
+    secKey.MakeNewKey();
+    return secKey.Sign(GetRandHash());
+}
+
+// A QBSIGSHARES message with the shares of all members of a 400 members quorum
+static llmq::CBatchedSigShares MakeBatchedSigShares()
+{
+    CBLSSignature sig = MakeSignature();
+    llmq::CBatchedSigShares batched;
+    batched.sessionId = 1;
+    for (uint16_t i = 0; i < 400; i++) {
+        CBLSLazySignature lazySig;
+        lazySig.Set(sig);
+        batched.sigShares.emplace_back(i, lazySig);
+    }
+    return batched;
+}
+
+static void LLMQ_BatchedSigShares_Serialize(benchmark::Bench& bench)
+{
+    auto batched = MakeBatchedSigShares();
+    bench.run([&] {
+        CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+        ds << batched;
+    });
+}
+
+static void LLMQ_BatchedSigShares_Unserialize(benchmark::Bench& bench)
+{
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << MakeBatchedSigShares();
+    bench.run([&] {
+        CDataStream ds2(ds);
+        llmq::CBatchedSigShares batched;
+        ds2 >> batched;
+    });
+}
+
+static void LLMQ_SigShare_RoundTrip(benchmark::Bench& bench)
+{
+    llmq::CSigShare sigShare;
+    sigShare.llmqType = Consensus::LLMQType::LLMQ_400_60;
+    sigShare.quorumHash = GetRandHash();
+    sigShare.quorumMember = 1;
+    sigShare.id = GetRandHash();
+    sigShare.msgHash = GetRandHash();
+    sigShare.sigShare.Set(MakeSignature());
+    sigShare.UpdateKey();
+
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    bench.run([&] {
+        ds << sigShare;
+        llmq::CSigShare sigShare2;
+        ds >> sigShare2;
+    });
+}
+
+BENCHMARK(LLMQ_BatchedSigShares_Serialize);
+BENCHMARK(LLMQ_BatchedSigShares_Unserialize);
+BENCHMARK(LLMQ_SigShare_RoundTrip);
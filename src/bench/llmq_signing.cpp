@@ -0,0 +1,192 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bls/bls_batchverifier.h>
+#include <bls/bls_worker.h>
+#include <dbwrapper.h>
+#include <llmq/quorums.h>
+#include <llmq/quorums_chainlocks.h>
+#include <llmq/quorums_instantsend.h>
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_signing_shares.h>
+#include <llmq/quorums_utils.h>
+#include <random.h>
+#include <streams.h>
+#include <version.h>
+
+#include <set>
+
+// These benchmarks run the same steps as the LLMQ managers do for incoming messages (unserialize, decode the lazy
+// signatures, batch verify and recover/store), but without a chain, masternode list or network, which the managers
+// need for everything else.
+
+extern CBLSWorker blsWorker;
+
+// The keys of a quorum as they result from a successful DKG
+struct BenchQuorum
+{
+    uint256 quorumHash;
+    std::vector<CBLSId> ids;
+    std::vector<CBLSSecretKey> skShares;
+    std::vector<CBLSPublicKey> pkShares;
+    CBLSSecretKey quorumSecretKey;
+    CBLSPublicKey quorumPublicKey;
+
+    BenchQuorum(size_t size, size_t threshold)
+    {
+        quorumHash = GetRandHash();
+        std::vector<CBLSSecretKey> msk(threshold);
+        for (auto& sk : msk) {
+            sk.MakeNewKey();
+        }
+        quorumSecretKey = msk[0];
+        quorumPublicKey = msk[0].GetPublicKey();
+
+        ids.resize(size);
+        skShares.resize(size);
+        pkShares.resize(size);
+        for (size_t i = 0; i < size; i++) {
+            ids[i] = CBLSId(::SerializeHash(std::make_pair(quorumHash, (uint32_t)i)));
+            skShares[i].SecretKeyShare(msk, ids[i]);
+            pkShares[i] = skShares[i].GetPublicKey();
+        }
+    }
+};
+
+// threshold QSIGSHARE messages from different members arrive for a single signing session, which is then recovered
+static void SigSharesRecovery(benchmark::Bench& bench, size_t size, size_t threshold)
+{
+    BenchQuorum quorum(size, threshold);
+    auto llmqType = size == 50 ? Consensus::LLMQType::LLMQ_50_60 : Consensus::LLMQType::LLMQ_400_60;
+
+    std::vector<CDataStream> messages;
+    for (size_t i = 0; i < threshold; i++) {
+        llmq::CSigShare sigShare;
+        sigShare.llmqType = llmqType;
+        sigShare.quorumHash = quorum.quorumHash;
+        sigShare.quorumMember = (uint16_t)i;
+        sigShare.id = uint256();
+        sigShare.msgHash = uint256();
+        sigShare.UpdateKey();
+        sigShare.sigShare.Set(quorum.skShares[i].Sign(sigShare.GetSignHash()));
+        messages.emplace_back(SER_NETWORK, PROTOCOL_VERSION);
+        messages.back() << sigShare;
+    }
+
+    bench.unit("recovery").run([&] {
+        std::vector<llmq::CSigShare> sigShares(messages.size());
+        std::vector<const CBLSLazySignature*> lazySigs;
+        for (size_t i = 0; i < messages.size(); i++) {
+            CDataStream ds(messages[i]);
+            ds >> sigShares[i];
+            lazySigs.emplace_back(&sigShares[i].sigShare);
+        }
+        blsWorker.DecodeLazySignatures(lazySigs);
+
+        CBLSBatchVerifier<NodeId, llmq::SigShareKey> batchVerifier(false, true);
+        for (size_t i = 0; i < sigShares.size(); i++) {
+            const auto& sigShare = sigShares[i];
+            batchVerifier.PushMessage((NodeId)i, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), quorum.pkShares[sigShare.quorumMember]);
+        }
+        batchVerifier.Verify();
+        assert(batchVerifier.badSources.empty());
+
+        std::vector<CBLSSignature> sigs;
+        std::vector<CBLSId> ids;
+        for (const auto& sigShare : sigShares) {
+            sigs.emplace_back(sigShare.sigShare.Get());
+            ids.emplace_back(quorum.ids[sigShare.quorumMember]);
+        }
+        CBLSSignature recoveredSig;
+        bool ok = recoveredSig.Recover(sigs, ids);
+        assert(ok && recoveredSig.VerifyInsecure(quorum.quorumPublicKey, sigShares[0].GetSignHash()));
+    });
+}
+
+static void LLMQ_SigShares_Recovery_50(benchmark::Bench& bench) { SigSharesRecovery(bench, 50, 30); }
+static void LLMQ_SigShares_Recovery_400(benchmark::Bench& bench) { SigSharesRecovery(bench, 400, 240); }
+
+// A block worth of ISLOCKs is received, verified in one batch and written to the db
+static void LLMQ_ISLock_Processing(benchmark::Bench& bench)
+{
+    const size_t count = 100;
+    BenchQuorum quorum(1, 1);
+
+    std::vector<CDataStream> messages;
+    for (size_t i = 0; i < count; i++) {
+        llmq::CInstantSendLock islock;
+        islock.txid = GetRandHash();
+        islock.inputs.emplace_back(GetRandHash(), 0);
+        islock.inputs.emplace_back(GetRandHash(), 1);
+        auto signHash = llmq::CLLMQUtils::BuildSignHash(Consensus::LLMQType::LLMQ_50_60, quorum.quorumHash, islock.GetRequestId(), islock.txid);
+        islock.sig.Set(quorum.quorumSecretKey.Sign(signHash));
+        messages.emplace_back(SER_NETWORK, PROTOCOL_VERSION);
+        messages.back() << islock;
+    }
+
+    CDBWrapper dbw(fs::path(), 8 << 20, true);
+    llmq::CInstantSendDb db(dbw);
+
+    bench.batch(count).unit("islock").run([&] {
+        std::vector<llmq::CInstantSendLock> islocks(messages.size());
+        std::vector<const CBLSLazySignature*> lazySigs;
+        for (size_t i = 0; i < messages.size(); i++) {
+            CDataStream ds(messages[i]);
+            ds >> islocks[i];
+            lazySigs.emplace_back(&islocks[i].sig);
+        }
+        blsWorker.DecodeLazySignatures(lazySigs);
+
+        CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
+        std::vector<uint256> hashes;
+        for (size_t i = 0; i < islocks.size(); i++) {
+            const auto& islock = islocks[i];
+            hashes.emplace_back(::SerializeHash(islock));
+            auto signHash = llmq::CLLMQUtils::BuildSignHash(Consensus::LLMQType::LLMQ_50_60, quorum.quorumHash, islock.GetRequestId(), islock.txid);
+            batchVerifier.PushMessage((NodeId)i, hashes.back(), signHash, islock.sig.Get(), quorum.quorumPublicKey);
+        }
+        batchVerifier.Verify();
+        assert(batchVerifier.badSources.empty());
+
+        for (size_t i = 0; i < islocks.size(); i++) {
+            db.WriteNewInstantSendLock(hashes[i], islocks[i]);
+        }
+    });
+}
+
+// The same CLSIG is received from 8 peers, only the first one is verified
+static void LLMQ_ChainLock_Intake(benchmark::Bench& bench)
+{
+    const size_t peerCount = 8;
+    BenchQuorum quorum(1, 1);
+
+    llmq::CChainLockSig clsig;
+    clsig.nHeight = 1000;
+    clsig.blockHash = GetRandHash();
+    auto requestId = ::SerializeHash(std::make_pair(llmq::CLSIG_REQUESTID_PREFIX, clsig.nHeight));
+    auto signHash = llmq::CLLMQUtils::BuildSignHash(Consensus::LLMQType::LLMQ_400_60, quorum.quorumHash, requestId, clsig.blockHash);
+    clsig.sig.Set(quorum.quorumSecretKey.Sign(signHash));
+    CDataStream msg(SER_NETWORK, PROTOCOL_VERSION);
+    msg << clsig;
+
+    bench.unit("clsig").run([&] {
+        std::set<uint256> seen;
+        for (size_t i = 0; i < peerCount; i++) {
+            CDataStream ds(msg);
+            llmq::CChainLockSig received;
+            ds >> received;
+            if (!seen.emplace(::SerializeHash(received)).second) {
+                continue;
+            }
+            bool ok = received.sig.Get().VerifyInsecure(quorum.quorumPublicKey, signHash);
+            assert(ok);
+        }
+    });
+}
+
+BENCHMARK(LLMQ_SigShares_Recovery_50);
+BENCHMARK(LLMQ_SigShares_Recovery_400);
+BENCHMARK(LLMQ_ISLock_Processing);
+BENCHMARK(LLMQ_ChainLock_Intake);
@@ -0,0 +1,146 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <saltedhasher.h>
+#include <uint256.h>
+#include <unordered_lru_cache.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+// The previous implementation of unordered_lru_cache, which sorts all entries by their access time whenever the
+// size exceeds twice the maximum size. Kept here to compare against.
+template<typename Key, typename Value, typename Hasher>
+class sorting_lru_cache
+{
+    typedef std::unordered_map<Key, std::pair<Value, int64_t>, Hasher> MapType;
+    MapType cacheMap;
+    size_t maxSize;
+    int64_t accessCounter{0};
+
+public:
+    explicit sorting_lru_cache(size_t _maxSize) : maxSize(_maxSize) {}
+
+    void insert(const Key& key, const Value& v)
+    {
+        truncate_if_needed();
+        cacheMap[key] = std::make_pair(v, accessCounter++);
+    }
+
+    bool get(const Key& key, Value& value)
+    {
+        auto it = cacheMap.find(key);
+        if (it != cacheMap.end()) {
+            it->second.second = accessCounter++;
+            value = it->second.first;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    void truncate_if_needed()
+    {
+        typedef typename MapType::iterator Iterator;
+        if (cacheMap.size() <= maxSize * 2) {
+            return;
+        }
+        std::vector<Iterator> vec;
+        vec.reserve(cacheMap.size());
+        for (auto it = cacheMap.begin(); it != cacheMap.end(); ++it) {
+            vec.emplace_back(it);
+        }
+        std::sort(vec.begin(), vec.end(), [](const Iterator& it1, const Iterator& it2) {
+            return it1->second.second > it2->second.second;
+        });
+        for (size_t i = maxSize; i < vec.size(); i++) {
+            cacheMap.erase(vec[i]);
+        }
+    }
+};
+
+const size_t CACHE_SIZE = 30000;
+
+// 3/4 of the accesses go to a hot set which fits into the cache, the rest is spread over twice the cache size
+std::vector<uint256> MakeKeys()
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> keys(CACHE_SIZE * 2);
+    for (auto& k : keys) {
+        k = rng.rand256();
+    }
+    std::vector<uint256> accesses;
+    accesses.reserve(100000);
+    for (size_t i = 0; i < 100000; i++) {
+        size_t range = rng.randrange(4) != 0 ? CACHE_SIZE * 3 / 4 : keys.size();
+        accesses.emplace_back(keys[rng.randrange(range)]);
+    }
+    return accesses;
+}
+
+template<typename Cache>
+void RunCache(benchmark::Bench& bench, Cache& cache)
+{
+    auto accesses = MakeKeys();
+    bench.batch(accesses.size()).unit("access").run([&] {
+        for (const auto& k : accesses) {
+            bool v;
+            if (!cache.get(k, v)) {
+                cache.insert(k, true);
+            }
+        }
+    });
+}
+
+} // namespace
+
+static void LRUCache_Sorting(benchmark::Bench& bench)
+{
+    sorting_lru_cache<uint256, bool, StaticSaltedHasher> cache(CACHE_SIZE);
+    RunCache(bench, cache);
+}
+
+static void LRUCache_Intrusive(benchmark::Bench& bench)
+{
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher> cache(CACHE_SIZE);
+    RunCache(bench, cache);
+}
+
+static void LRUCache_Sharded(benchmark::Bench& bench)
+{
+    sharded_lru_cache<uint256, bool, StaticSaltedHasher> cache(CACHE_SIZE);
+    RunCache(bench, cache);
+}
+
+// 4 threads access the cache concurrently
+static void LRUCache_Sharded_4Threads(benchmark::Bench& bench)
+{
+    sharded_lru_cache<uint256, bool, StaticSaltedHasher> cache(CACHE_SIZE);
+    auto accesses = MakeKeys();
+    bench.batch(accesses.size()).unit("access").run([&] {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (size_t i = t; i < accesses.size(); i += 4) {
+                    bool v;
+                    if (!cache.get(accesses[i], v)) {
+                        cache.insert(accesses[i], true);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    });
+}
+
+BENCHMARK(LRUCache_Sorting);
+BENCHMARK(LRUCache_Intrusive);
+BENCHMARK(LRUCache_Sharded);
+BENCHMARK(LRUCache_Sharded_4Threads);
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <crypto/common.h>
+#include <script/standard.h>
+#include <txmempool.h>
+
+#include <vector>
+
+static CScript AddressScript(int n)
+{
+    uint160 hash;
+    WriteLE32(hash.begin(), n);
+    return GetScriptForDestination(CKeyID(hash));
+}
+
+// Adds and removes the address and spent index entries of 1000 transactions, each spending an output of one of
+// 100 addresses and paying to another one of them. Half of all outputs go to the same address, which results in
+// one large bucket as usually seen for exchange and pool addresses.
+static void MempoolAddressIndex(benchmark::Bench& bench)
+{
+    const int nTxs = 1000;
+    const int nAddresses = 100;
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+
+    CMutableTransaction funding;
+    funding.vout.resize(nTxs);
+    for (int i = 0; i < nTxs; i++) {
+        funding.vout[i].nValue = 10 * COIN;
+        funding.vout[i].scriptPubKey = AddressScript(i % nAddresses);
+    }
+    AddCoins(coins, CTransaction(funding), 1);
+
+    std::vector<CTxMemPoolEntry> entries;
+    entries.reserve(nTxs);
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(funding.GetHash(), i);
+        tx.vout.resize(2);
+        tx.vout[0].nValue = 5 * COIN;
+        tx.vout[0].scriptPubKey = AddressScript(0);
+        tx.vout[1].nValue = 4 * COIN;
+        tx.vout[1].scriptPubKey = AddressScript((i + 1) % nAddresses);
+        entries.emplace_back(MakeTransactionRef(tx), 1000, 0, 1, false, 4, LockPoints());
+    }
+
+    std::vector<std::pair<uint160, int> > addresses;
+    addresses.emplace_back(uint160(), 1);
+
+    CTxMemPool pool;
+
+    bench.run([&] {
+        for (const auto& entry : entries) {
+            pool.addAddressIndex(entry, coins);
+            pool.addSpentIndex(entry, coins);
+        }
+
+        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+        pool.getAddressIndex(addresses, results);
+        assert(results.size() == size_t(nTxs + 2 * nTxs / nAddresses));
+
+        for (const auto& entry : entries) {
+            pool.removeAddressIndex(entry.GetTx().GetHash());
+            pool.removeSpentIndex(entry.GetTx().GetHash());
+        }
+    });
+}
+
+BENCHMARK(MempoolAddressIndex);
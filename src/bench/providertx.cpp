@@ -0,0 +1,90 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <evo/providertx.h>
+#include <netbase.h>
+#include <random.h>
+
+#include <algorithm>
+
+// A block full of ProUpServTx, each one signed by a different operator
+static const size_t TX_COUNT = 100;
+
+static std::vector<CProTxOperatorSig> BuildBlockSigs(size_t invalidCount)
+{
+    FastRandomContext rnd(true);
+    std::vector<CProTxOperatorSig> sigs;
+    for (size_t i = 0; i < TX_COUNT; i++) {
+        CBLSSecretKey operatorKey;
+        operatorKey.MakeNewKey();
+
+        CProUpServTx ptx;
+        ptx.proTxHash = rnd.rand256();
+        ptx.addr = LookupNumeric("1.1.1.1", 9999 + i);
+        ptx.inputsHash = rnd.rand256();
+        ptx.sig = operatorKey.Sign(::SerializeHash(ptx));
+        if (i < invalidCount) {
+            ptx.inputsHash = rnd.rand256();
+        }
+
+        sigs.emplace_back(CProTxOperatorSig{::SerializeHash(ptx), ptx.sig, operatorKey.GetPublicKey()});
+    }
+    return sigs;
+}
+
+static size_t VerifyIndividual(const std::vector<CProTxOperatorSig>& sigs)
+{
+    size_t invalid = 0;
+    for (const auto& s : sigs) {
+        invalid += !s.sig.VerifyInsecure(s.pubKey, s.msgHash);
+    }
+    return invalid;
+}
+
+// Same as VerifyProTxOperatorSigs, but without the signature cache
+static size_t VerifyBatched(const std::vector<CProTxOperatorSig>& sigs)
+{
+    std::vector<CBLSSignature> vSigs;
+    std::vector<CBLSPublicKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    for (const auto& s : sigs) {
+        vSigs.emplace_back(s.sig);
+        vPubKeys.emplace_back(s.pubKey);
+        vHashes.emplace_back(s.msgHash);
+    }
+    if (CBLSSignature::VerifyBatch(vSigs, vPubKeys, vHashes)) {
+        return 0;
+    }
+    return VerifyIndividual(sigs);
+}
+
+// All valid signatures are in the signature cache after the first run, like they are when a block only contains
+// transactions which were accepted into the mempool before
+static size_t VerifyCached(const std::vector<CProTxOperatorSig>& sigs)
+{
+    std::vector<bool> vValid;
+    VerifyProTxOperatorSigs(sigs, vValid);
+    return std::count(vValid.begin(), vValid.end(), false);
+}
+
+static void ProTxOperatorSigs(benchmark::Bench& bench, size_t (*verify)(const std::vector<CProTxOperatorSig>&), size_t invalidCount)
+{
+    auto sigs = BuildBlockSigs(invalidCount);
+    size_t invalid = 0;
+    bench.batch(TX_COUNT).unit("sig").run([&] {
+        invalid = verify(sigs);
+    });
+    assert(invalid == invalidCount);
+}
+
+static void ProTxOperatorSigs_Individual(benchmark::Bench& bench) { ProTxOperatorSigs(bench, VerifyIndividual, 0); }
+static void ProTxOperatorSigs_Batched(benchmark::Bench& bench) { ProTxOperatorSigs(bench, VerifyBatched, 0); }
+static void ProTxOperatorSigs_Batched_1Invalid(benchmark::Bench& bench) { ProTxOperatorSigs(bench, VerifyBatched, 1); }
+static void ProTxOperatorSigs_Cached(benchmark::Bench& bench) { ProTxOperatorSigs(bench, VerifyCached, 0); }
+
+BENCHMARK(ProTxOperatorSigs_Individual)
+BENCHMARK(ProTxOperatorSigs_Batched)
+BENCHMARK(ProTxOperatorSigs_Batched_1Invalid)
+BENCHMARK(ProTxOperatorSigs_Cached)
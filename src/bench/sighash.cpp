@@ -0,0 +1,53 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <util/memory.h>
+
+// A CoinJoin transaction with 500 P2PKH inputs and as many outputs of the same denomination
+static CTransaction MakeCoinJoinTx(CScript& scriptCodeRet)
+{
+    const size_t count = 500;
+    FastRandomContext rng(true);
+    CMutableTransaction tx;
+    for (size_t i = 0; i < count; i++) {
+        CTxIn txin(COutPoint(rng.rand256(), rng.randrange(4)));
+        txin.scriptSig = CScript() << rng.randbytes(72) << rng.randbytes(33);
+        tx.vin.emplace_back(txin);
+        tx.vout.emplace_back(100001, CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG);
+    }
+    scriptCodeRet = CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+    return CTransaction(tx);
+}
+
+static void SignatureHashAllInputs(benchmark::Bench& bench, int nHashType, bool fPrecompute)
+{
+    CScript scriptCode;
+    const CTransaction tx = MakeCoinJoinTx(scriptCode);
+    bench.batch(tx.vin.size()).unit("input").run([&] {
+        // The precomputed data is set up once per transaction, which is part of the cost
+        std::unique_ptr<PrecomputedTransactionData> txdata;
+        if (fPrecompute) {
+            txdata = MakeUnique<PrecomputedTransactionData>(tx);
+        }
+        for (size_t i = 0; i < tx.vin.size(); i++) {
+            uint256 hash = SignatureHash(scriptCode, tx, i, nHashType, 0, SigVersion::BASE, txdata.get());
+            ankerl::nanobench::doNotOptimizeAway(hash);
+        }
+    });
+}
+
+static void SignatureHash_CoinJoin500_All(benchmark::Bench& bench) { SignatureHashAllInputs(bench, SIGHASH_ALL, false); }
+static void SignatureHash_CoinJoin500_All_Precomputed(benchmark::Bench& bench) { SignatureHashAllInputs(bench, SIGHASH_ALL, true); }
+static void SignatureHash_CoinJoin500_AnyoneCanPay(benchmark::Bench& bench) { SignatureHashAllInputs(bench, SIGHASH_ALL | SIGHASH_ANYONECANPAY, false); }
+static void SignatureHash_CoinJoin500_AnyoneCanPay_Precomputed(benchmark::Bench& bench) { SignatureHashAllInputs(bench, SIGHASH_ALL | SIGHASH_ANYONECANPAY, true); }
+
+BENCHMARK(SignatureHash_CoinJoin500_All);
+BENCHMARK(SignatureHash_CoinJoin500_All_Precomputed);
+BENCHMARK(SignatureHash_CoinJoin500_AnyoneCanPay);
+BENCHMARK(SignatureHash_CoinJoin500_AnyoneCanPay_Precomputed);
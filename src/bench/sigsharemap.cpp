@@ -0,0 +1,136 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <llmq/quorums.h>
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_signing_shares.h>
+#include <random.h>
+
+#include <unordered_map>
+
+// The previous SigShareMap implementation (one heap node per entry), kept here for comparison
+template<typename T>
+class NestedSigShareMap
+{
+private:
+    std::unordered_map<uint256, std::unordered_map<uint16_t, T>, StaticSaltedHasher> internalMap;
+
+public:
+    bool Add(const llmq::SigShareKey& k, const T& v)
+    {
+        auto& m = internalMap[k.first];
+        return m.emplace(k.second, v).second;
+    }
+
+    bool Has(const llmq::SigShareKey& k) const
+    {
+        auto it = internalMap.find(k.first);
+        if (it == internalMap.end()) {
+            return false;
+        }
+        return it->second.count(k.second) != 0;
+    }
+
+    void EraseAllForSignHash(const uint256& signHash)
+    {
+        internalMap.erase(signHash);
+    }
+
+    template<typename F>
+    void ForEach(F&& f)
+    {
+        for (auto& p : internalMap) {
+            llmq::SigShareKey k;
+            k.first = p.first;
+            for (auto& p2 : p.second) {
+                k.second = p2.first;
+                f(k, p2.second);
+            }
+        }
+    }
+};
+
+// 24 concurrent signing sessions in a 400 member quorum, which is roughly what LLMQ_400_60 sees under load
+static const size_t SESSIONS = 24;
+static const uint16_t MEMBERS = 400;
+
+static std::vector<uint256> BuildSignHashes()
+{
+    FastRandomContext rnd(true);
+    std::vector<uint256> signHashes;
+    for (size_t i = 0; i < SESSIONS; i++) {
+        signHashes.emplace_back(rnd.rand256());
+    }
+    return signHashes;
+}
+
+template<typename Map>
+static void FillMap(Map& map, const std::vector<uint256>& signHashes)
+{
+    for (const auto& signHash : signHashes) {
+        for (uint16_t i = 0; i < MEMBERS; i++) {
+            map.Add(std::make_pair(signHash, i), (int64_t)i);
+        }
+    }
+}
+
+template<typename Map>
+static void SigShareMapAddErase(benchmark::Bench& bench)
+{
+    auto signHashes = BuildSignHashes();
+    bench.batch(SESSIONS * MEMBERS).unit("share").run([&] {
+        Map map;
+        FillMap(map, signHashes);
+        for (const auto& signHash : signHashes) {
+            map.EraseAllForSignHash(signHash);
+        }
+    });
+}
+
+template<typename Map>
+static void SigShareMapForEach(benchmark::Bench& bench)
+{
+    auto signHashes = BuildSignHashes();
+    Map map;
+    FillMap(map, signHashes);
+    int64_t sum = 0;
+    bench.batch(SESSIONS * MEMBERS).unit("share").run([&] {
+        map.ForEach([&](const llmq::SigShareKey& k, int64_t v) {
+            sum += v;
+        });
+    });
+    assert(sum != 0);
+}
+
+template<typename Map>
+static void SigShareMapHas(benchmark::Bench& bench)
+{
+    auto signHashes = BuildSignHashes();
+    Map map;
+    FillMap(map, signHashes);
+    size_t found = 0;
+    bench.batch(SESSIONS * MEMBERS).unit("share").run([&] {
+        for (const auto& signHash : signHashes) {
+            for (uint16_t i = 0; i < MEMBERS; i++) {
+                found += map.Has(std::make_pair(signHash, i));
+            }
+        }
+    });
+    assert(found != 0);
+}
+
+static void SigShareMap_AddErase(benchmark::Bench& bench) { SigShareMapAddErase<llmq::SigShareMap<int64_t>>(bench); }
+static void SigShareMap_AddErase_Nested(benchmark::Bench& bench) { SigShareMapAddErase<NestedSigShareMap<int64_t>>(bench); }
+static void SigShareMap_ForEach(benchmark::Bench& bench) { SigShareMapForEach<llmq::SigShareMap<int64_t>>(bench); }
+static void SigShareMap_ForEach_Nested(benchmark::Bench& bench) { SigShareMapForEach<NestedSigShareMap<int64_t>>(bench); }
+static void SigShareMap_Has(benchmark::Bench& bench) { SigShareMapHas<llmq::SigShareMap<int64_t>>(bench); }
+static void SigShareMap_Has_Nested(benchmark::Bench& bench) { SigShareMapHas<NestedSigShareMap<int64_t>>(bench); }
+
+BENCHMARK(SigShareMap_AddErase)
+BENCHMARK(SigShareMap_AddErase_Nested)
+BENCHMARK(SigShareMap_ForEach)
+BENCHMARK(SigShareMap_ForEach_Nested)
+BENCHMARK(SigShareMap_Has)
+BENCHMARK(SigShareMap_Has_Nested)
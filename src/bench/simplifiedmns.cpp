@@ -0,0 +1,96 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <evo/deterministicmns.h>
+#include <evo/simplifiedmns.h>
+#include <llmq/quorums_commitment.h>
+#include <random.h>
+
+// A bit more than the mainnet list
+static const size_t MN_COUNT = 5000;
+
+static CDeterministicMNList BuildList()
+{
+    FastRandomContext rnd(true);
+    CDeterministicMNList mnList(uint256(), 1, 0);
+    for (size_t i = 0; i < MN_COUNT; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = rnd.rand256();
+        dmn->collateralOutpoint = COutPoint(rnd.rand256(), 0);
+
+        auto dmnState = std::make_shared<CDeterministicMNState>();
+        dmnState->nRegisteredHeight = 1;
+        dmnState->confirmedHash = rnd.rand256();
+        dmnState->keyIDOwner = CKeyID(uint160(rnd.randbytes(20)));
+        dmnState->keyIDVoting = dmnState->keyIDOwner;
+        dmn->pdmnState = dmnState;
+        mnList.AddMN(dmn);
+    }
+    return mnList;
+}
+
+static std::vector<CSimplifiedMNListEntry> BuildEntries()
+{
+    std::vector<CSimplifiedMNListEntry> entries;
+    BuildList().ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        entries.emplace_back(*dmn);
+    });
+    return entries;
+}
+
+static void SimplifiedMNList_FromEntries(benchmark::Bench& bench)
+{
+    const auto entries = BuildEntries();
+    bench.batch(MN_COUNT).unit("mn").run([&] {
+        CSimplifiedMNList sml(entries);
+        ankerl::nanobench::doNotOptimizeAway(sml.mnList.size());
+    });
+}
+
+static void SimplifiedMNList_FromDMNList(benchmark::Bench& bench)
+{
+    const auto mnList = BuildList();
+    bench.batch(MN_COUNT).unit("mn").run([&] {
+        CSimplifiedMNList sml(mnList);
+        ankerl::nanobench::doNotOptimizeAway(sml.mnList.size());
+    });
+}
+
+static void SimplifiedMNList_CalcMerkleRoot(benchmark::Bench& bench)
+{
+    const CSimplifiedMNList sml(BuildEntries());
+    bench.batch(MN_COUNT).unit("mn").run([&] {
+        auto root = sml.CalcMerkleRoot();
+        ankerl::nanobench::doNotOptimizeAway(root);
+    });
+}
+
+// What the first block after startup pays, when there's no previous tree to reuse leaves from
+static void SimplifiedMNList_MerkleTreeFirstRoot(benchmark::Bench& bench)
+{
+    const CSimplifiedMNList sml(BuildEntries());
+    bench.batch(MN_COUNT).unit("mn").run([&] {
+        CSimplifiedMNListMerkleTree tree;
+        auto root = tree.CalcMerkleRoot(sml);
+        ankerl::nanobench::doNotOptimizeAway(root);
+    });
+}
+
+// protx diff from the genesis block
+static void SimplifiedMNList_BuildSimplifiedDiff(benchmark::Bench& bench)
+{
+    const auto mnList = BuildList();
+    const CDeterministicMNList emptyList(uint256(), 0, 0);
+    bench.batch(MN_COUNT).unit("mn").run([&] {
+        auto diff = emptyList.BuildSimplifiedDiff(mnList);
+        assert(diff.mnList.size() == MN_COUNT);
+    });
+}
+
+BENCHMARK(SimplifiedMNList_FromEntries)
+BENCHMARK(SimplifiedMNList_FromDMNList)
+BENCHMARK(SimplifiedMNList_CalcMerkleRoot)
+BENCHMARK(SimplifiedMNList_MerkleTreeFirstRoot)
+BENCHMARK(SimplifiedMNList_BuildSimplifiedDiff)
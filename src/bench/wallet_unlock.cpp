@@ -0,0 +1,57 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <random.h>
+#include <wallet/crypter.h>
+
+#include <vector>
+
+class BenchCryptoKeyStore : public CCryptoKeyStore
+{
+public:
+    using CCryptoKeyStore::cs_KeyStore;
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::Unlock;
+    using CCryptoKeyStore::mapCryptedKeys;
+};
+
+// Measures the first unlock of a wallet with nKeys encrypted keys, which checks that all of them decrypt correctly
+static void WalletUnlock(benchmark::Bench& bench, size_t nKeys)
+{
+    CKeyingMaterial vMasterKey(WALLET_CRYPTO_KEY_SIZE);
+    GetStrongRandBytes(vMasterKey.data(), WALLET_CRYPTO_KEY_SIZE);
+
+    std::vector<std::pair<CPubKey, std::vector<unsigned char>>> vecCryptedKeys;
+    {
+        BenchCryptoKeyStore keystore;
+        for (size_t i = 0; i < nKeys; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            keystore.AddKey(key);
+        }
+        bool fEncrypted = keystore.EncryptKeys(vMasterKey);
+        assert(fEncrypted);
+        LOCK(keystore.cs_KeyStore);
+        for (const auto& p : keystore.mapCryptedKeys) {
+            vecCryptedKeys.emplace_back(p.second);
+        }
+    }
+
+    bench.run([&] {
+        BenchCryptoKeyStore keystore;
+        for (const auto& p : vecCryptedKeys) {
+            keystore.AddCryptedKey(p.first, p.second);
+        }
+        bool fUnlocked = keystore.Unlock(vMasterKey);
+        assert(fUnlocked);
+    });
+}
+
+static void WalletUnlock100(benchmark::Bench& bench) { WalletUnlock(bench, 100); }
+static void WalletUnlock10000(benchmark::Bench& bench) { WalletUnlock(bench, 10000); }
+
+BENCHMARK(WalletUnlock100);
+BENCHMARK(WalletUnlock10000);
@@ -26,10 +26,15 @@
 
 #include <bip39.h>
 #include <bip39_english.h>
+#include <crypto/pbkdf2_hmac_sha512.h>
 #include <crypto/sha256.h>
 #include <random.h>
+#include <util/system.h>
 
-#include <openssl/evp.h>
+#include <ctpl_stl.h>
+
+#include <algorithm>
+#include <future>
 
 SecureString CMnemonic::Generate(int strength)
 {
@@ -154,9 +159,37 @@ void CMnemonic::ToSeed(SecureString mnemonic, SecureString passphrase, SecureVec
     SecureString ssSalt = SecureString("mnemonic") + passphrase;
     SecureVector vchSalt(ssSalt.begin(), ssSalt.end());
     seedRet.resize(64);
-    // int PKCS5_PBKDF2_HMAC(const char *pass, int passlen,
-    //                    const unsigned char *salt, int saltlen, int iter,
-    //                    const EVP_MD *digest,
-    //                    int keylen, unsigned char *out);
-    PKCS5_PBKDF2_HMAC(mnemonic.c_str(), mnemonic.size(), vchSalt.data(), vchSalt.size(), 2048, EVP_sha512(), 64, seedRet.data());
+    PBKDF2_HMAC_SHA512((const unsigned char*)mnemonic.data(), mnemonic.size(), vchSalt.data(), vchSalt.size(), 2048, seedRet.data(), seedRet.size());
+}
+
+void CMnemonic::ToSeeds(const std::vector<std::pair<SecureString, SecureString>>& vecMnemonics, std::vector<SecureVector>& vecSeedsRet, int nThreads)
+{
+    vecSeedsRet.clear();
+    vecSeedsRet.resize(vecMnemonics.size());
+    if (nThreads <= 0) {
+        nThreads = GetNumCores();
+    }
+    nThreads = std::min(nThreads, (int)vecMnemonics.size());
+
+    // Every seed takes the same time to derive, so each thread gets a fixed stride of the input
+    auto deriveSeeds = [&](int nFirst) {
+        for (size_t i = nFirst; i < vecMnemonics.size(); i += nThreads) {
+            ToSeed(vecMnemonics[i].first, vecMnemonics[i].second, vecSeedsRet[i]);
+        }
+    };
+    if (nThreads < 2) {
+        deriveSeeds(0);
+        return;
+    }
+
+    ctpl::thread_pool pool(nThreads - 1);
+    RenameThreadPool(pool, "dash-bip39");
+    std::vector<std::future<void>> futures;
+    for (int i = 1; i < nThreads; i++) {
+        futures.emplace_back(pool.push([&deriveSeeds, i](int) { deriveSeeds(i); }));
+    }
+    deriveSeeds(0);
+    for (auto& future : futures) {
+        future.get();
+    }
 }
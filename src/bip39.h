@@ -26,6 +26,9 @@
 
 #include <support/allocators/secure.h>
 
+#include <utility>
+#include <vector>
+
 class CMnemonic
 {
 public:
@@ -34,6 +37,8 @@ public:
     static bool Check(SecureString mnemonic);
     // passphrase must be at most 256 characters or code may crash
     static void ToSeed(SecureString mnemonic, SecureString passphrase, SecureVector& seedRet);
+    // derives the seeds of many (mnemonic, passphrase) pairs, split across nThreads threads (0 = one per core)
+    static void ToSeeds(const std::vector<std::pair<SecureString, SecureString>>& vecMnemonics, std::vector<SecureVector>& vecSeedsRet, int nThreads = 0);
 };
 
 #endif // BITCOIN_BIP39_H
@@ -0,0 +1,150 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilecache.h>
+
+#include <consensus/consensus.h>
+#include <crypto/common.h>
+#include <validation.h>
+
+#ifndef WIN32
+#include <fcntl.h> // for open
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h> // for close
+#endif
+
+#include <string.h>
+
+CBlockFileCache blockFileCache;
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    munmap((void*)data, size);
+#endif
+}
+
+std::shared_ptr<const CMappedBlockFile> CMappedBlockFile::Map(const fs::path& path)
+{
+#ifndef WIN32
+    // Block files are up to 128 MiB, keeping several of them mapped would use up the address space of 32-bit systems
+    if (sizeof(void*) < 8) {
+        return nullptr;
+    }
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::shared_ptr<const CMappedBlockFile>(new CMappedBlockFile((const unsigned char*)addr, st.st_size));
+#else
+    return nullptr;
+#endif
+}
+
+CBlockFileCache::CBlockFileCache() :
+    mappedFiles(MAX_MAPPED_FILES),
+    blocks(MAX_CACHED_BLOCKS)
+{
+    blocks.set_max_weight(MAX_CACHED_BLOCKS_BYTES, [](const uint64_t& key, const std::pair<std::shared_ptr<const CBlock>, size_t>& entry) {
+        return entry.second;
+    });
+}
+
+CBlockFileCache::MappedFilePtr CBlockFileCache::GetFile(int nFile, size_t nMinSize)
+{
+    LOCK(cs);
+    MappedFilePtr file;
+    if (mappedFiles.get(nFile, file) && file->Data().size() >= nMinSize) {
+        return file;
+    }
+    // The file grew since it was mapped (or was never mapped), readers of the old mapping keep it alive
+    file = CMappedBlockFile::Map(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk"));
+    if (!file || file->Data().size() < nMinSize) {
+        return nullptr;
+    }
+    mappedFiles.insert(nFile, file);
+    return file;
+}
+
+bool CBlockFileCache::GetRawBlock(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, MappedFilePtr& file, Span<const unsigned char>& data)
+{
+    // WriteBlockToDisk stores the message start and the size of the block right before it
+    const size_t nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.IsNull() || pos.nPos < nHeaderSize) {
+        return false;
+    }
+
+    file = GetFile(pos.nFile, pos.nPos);
+    if (!file) {
+        return false;
+    }
+    const unsigned char* header = file->Data().data() + pos.nPos - nHeaderSize;
+    if (memcmp(header, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0) {
+        return false;
+    }
+    uint32_t nSize = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+    if (nSize == 0 || nSize > MaxBlockSize()) {
+        return false;
+    }
+    if (file->Data().size() < (size_t)pos.nPos + nSize) {
+        file = GetFile(pos.nFile, (size_t)pos.nPos + nSize);
+        if (!file) {
+            return false;
+        }
+    }
+    data = file->Data().subspan(pos.nPos, nSize);
+    return true;
+}
+
+bool CBlockFileCache::GetBlock(const CDiskBlockPos& pos, std::shared_ptr<const CBlock>& block)
+{
+    LOCK(cs);
+    std::pair<std::shared_ptr<const CBlock>, size_t> entry;
+    if (!blocks.get(BlockKey(pos), entry)) {
+        return false;
+    }
+    block = std::move(entry.first);
+    return true;
+}
+
+void CBlockFileCache::AddBlock(const CDiskBlockPos& pos, std::shared_ptr<const CBlock> block, size_t nSize)
+{
+    LOCK(cs);
+    blocks.emplace(BlockKey(pos), std::make_pair(std::move(block), nSize));
+}
+
+void CBlockFileCache::RemoveFiles(const std::set<int>& setFiles)
+{
+    LOCK(cs);
+    for (int nFile : setFiles) {
+        mappedFiles.erase(nFile);
+    }
+    std::vector<uint64_t> vecRemove;
+    blocks.for_each([&](const uint64_t& key, const std::pair<std::shared_ptr<const CBlock>, size_t>& entry) {
+        if (setFiles.count((int)(key >> 32))) {
+            vecRemove.emplace_back(key);
+        }
+    });
+    for (uint64_t key : vecRemove) {
+        blocks.erase(key);
+    }
+}
+
+void CBlockFileCache::Clear()
+{
+    LOCK(cs);
+    mappedFiles.clear();
+    blocks.clear();
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILECACHE_H
+#define BITCOIN_BLOCKFILECACHE_H
+
+#include <chain.h>
+#include <fs.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <span.h>
+#include <sync.h>
+#include <unordered_lru_cache.h>
+
+#include <memory>
+#include <set>
+
+/** A read-only memory mapping of a whole block file (blk?????.dat) */
+class CMappedBlockFile
+{
+private:
+    const unsigned char* data;
+    size_t size;
+
+    CMappedBlockFile(const unsigned char* _data, size_t _size) : data(_data), size(_size) {}
+
+public:
+    ~CMappedBlockFile();
+
+    CMappedBlockFile(const CMappedBlockFile&) = delete;
+    CMappedBlockFile& operator=(const CMappedBlockFile&) = delete;
+
+    /** Map the file with its current size. Returns nullptr if it can't be mapped or mapping isn't supported */
+    static std::shared_ptr<const CMappedBlockFile> Map(const fs::path& path);
+
+    Span<const unsigned char> Data() const { return Span<const unsigned char>(data, size); }
+};
+
+/**
+ * Keeps the most recently read block files mapped into memory, so that reading a block doesn't need to open, seek
+ * and read the file, and the most recently read blocks decoded, as the same blocks are often read repeatedly in a
+ * short time (e.g. when serving them to multiple peers or when looking up transactions of recent blocks).
+ *
+ * Block files are only appended to, so a mapping stays valid for everything that was written before it was created.
+ * A file is mapped again when a block beyond the end of its current mapping is requested.
+ */
+class CBlockFileCache
+{
+public:
+    static const size_t MAX_MAPPED_FILES = 8;
+    static const size_t MAX_CACHED_BLOCKS = 32;
+    static const size_t MAX_CACHED_BLOCKS_BYTES = 32 * 1024 * 1024;
+
+    typedef std::shared_ptr<const CMappedBlockFile> MappedFilePtr;
+
+private:
+    CCriticalSection cs;
+    unordered_lru_cache<int, MappedFilePtr, std::hash<int>> mappedFiles GUARDED_BY(cs);
+    //! Decoded blocks with their serialized size, which bounds the memory the cache takes
+    unordered_lru_cache<uint64_t, std::pair<std::shared_ptr<const CBlock>, size_t>, std::hash<uint64_t>> blocks GUARDED_BY(cs);
+
+    MappedFilePtr GetFile(int nFile, size_t nMinSize);
+    static uint64_t BlockKey(const CDiskBlockPos& pos) { return ((uint64_t)pos.nFile << 32) | pos.nPos; }
+
+public:
+    CBlockFileCache();
+
+    /**
+     * Get the serialized block which WriteBlockToDisk stored at pos. The returned data points into file, which must be
+     * kept alive while data is used. Returns false if the file couldn't be mapped or doesn't contain a block at pos.
+     */
+    bool GetRawBlock(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, MappedFilePtr& file, Span<const unsigned char>& data);
+
+    /** Get the decoded block at pos, if it was read recently. The block is shared with the cache, not copied */
+    bool GetBlock(const CDiskBlockPos& pos, std::shared_ptr<const CBlock>& block);
+    /** Add a decoded block, nSize is the size of its serialization, which the caller read it from */
+    void AddBlock(const CDiskBlockPos& pos, std::shared_ptr<const CBlock> block, size_t nSize);
+
+    /** Drop everything belonging to the given files, called before they are deleted by pruning */
+    void RemoveFiles(const std::set<int>& setFiles);
+    void Clear();
+};
+
+extern CBlockFileCache blockFileCache;
+
+#endif // BITCOIN_BLOCKFILECACHE_H
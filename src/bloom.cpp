@@ -9,6 +9,7 @@
 #include <evo/providertx.h>
 #include <evo/cbtx.h>
 #include <llmq/quorums_commitment.h>
+#include <crypto/common.h>
 #include <hash.h>
 #include <script/script.h>
 #include <script/standard.h>
@@ -42,48 +43,55 @@ CBloomFilter::CBloomFilter(const unsigned int nElements, const double nFPRate, c
 {
 }
 
-inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const
+inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const CMurmurHash3Multi& hasher) const
 {
     // 0xFBA4C795 chosen as it guarantees a reasonable bit difference between nHashNum values.
-    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
+    return hasher.Hash(nHashNum * 0xFBA4C795 + nTweak) % (vData.size() * 8);
 }
 
-void CBloomFilter::insert(const std::vector<unsigned char>& vKey)
+void CBloomFilter::insert(Span<const unsigned char> vKey)
 {
     if (isFull)
         return;
+    CMurmurHash3Multi hasher(vKey);
     for (unsigned int i = 0; i < nHashFuncs; i++)
     {
-        unsigned int nIndex = Hash(i, vKey);
+        unsigned int nIndex = Hash(i, hasher);
         // Sets bit nIndex of vData
         vData[nIndex >> 3] |= (1 << (7 & nIndex));
     }
     isEmpty = false;
 }
 
+// The serialized outpoint, without going through a stream
+static void SerializeOutPoint(const COutPoint& outpoint, unsigned char (&data)[36])
+{
+    memcpy(data, outpoint.hash.begin(), 32);
+    WriteLE32(data + 32, outpoint.n);
+}
+
 void CBloomFilter::insert(const COutPoint& outpoint)
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
+    unsigned char data[36];
+    SerializeOutPoint(outpoint, data);
     insert(data);
 }
 
 void CBloomFilter::insert(const uint256& hash)
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    insert(data);
+    insert(Span<const unsigned char>(hash.begin(), hash.size()));
 }
 
-bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+bool CBloomFilter::contains(Span<const unsigned char> vKey) const
 {
     if (isFull)
         return true;
     if (isEmpty)
         return false;
+    CMurmurHash3Multi hasher(vKey);
     for (unsigned int i = 0; i < nHashFuncs; i++)
     {
-        unsigned int nIndex = Hash(i, vKey);
+        unsigned int nIndex = Hash(i, hasher);
         // Checks bit nIndex of vData
         if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
             return false;
@@ -93,22 +101,19 @@ bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
 
 bool CBloomFilter::contains(const COutPoint& outpoint) const
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
+    unsigned char data[36];
+    SerializeOutPoint(outpoint, data);
     return contains(data);
 }
 
 bool CBloomFilter::contains(const uint256& hash) const
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    return contains(data);
+    return contains(Span<const unsigned char>(hash.begin(), hash.size()));
 }
 
 bool CBloomFilter::contains(const uint160& hash) const
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    return contains(data);
+    return contains(Span<const unsigned char>(hash.begin(), hash.size()));
 }
 
 void CBloomFilter::clear()
@@ -244,16 +249,7 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
         // is discovered in order to find spending transactions, which avoids round-tripping and race conditions.
         if(CheckScript(txout.scriptPubKey)) {
             fFound = true;
-            if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
-                insert(COutPoint(hash, i));
-            else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
-            {
-                txnouttype type;
-                std::vector<std::vector<unsigned char> > vSolutions;
-                if (Solver(txout.scriptPubKey, type, vSolutions) &&
-                        (type == TX_PUBKEY || type == TX_MULTISIG))
-                    insert(COutPoint(hash, i));
-            }
+            UpdateMatchedOutput(tx, i);
         }
     }
 
@@ -274,6 +270,91 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
     return false;
 }
 
+void CBloomFilter::UpdateMatchedOutput(const CTransaction& tx, unsigned int nOut)
+{
+    if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
+        insert(COutPoint(tx.GetHash(), nOut));
+    else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
+    {
+        txnouttype type;
+        std::vector<std::vector<unsigned char> > vSolutions;
+        if (Solver(tx.vout[nOut].scriptPubKey, type, vSolutions) &&
+                (type == TX_PUBKEY || type == TX_MULTISIG))
+            insert(COutPoint(tx.GetHash(), nOut));
+    }
+}
+
+// Matches exactly like IsRelevantAndUpdate(const CTransaction&), which walks the same elements in the same order
+bool CBloomFilter::IsRelevantAndUpdate(const CTxBloomElements& txElements)
+{
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    const CTransaction& tx = *txElements.tx;
+    bool fFound = contains(tx.GetHash());
+
+    // Check additional matches for special transactions
+    fFound = fFound || CheckSpecialTransactionMatchesAndUpdate(tx);
+
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        for (size_t j = txElements.GetOutputBegin(i); j < txElements.GetOutputBegin(i + 1); j++) {
+            if (contains(txElements.GetElement(j))) {
+                fFound = true;
+                UpdateMatchedOutput(tx, i);
+                break;
+            }
+        }
+    }
+
+    if (fFound)
+        return true;
+
+    // The outpoints and scriptSig elements of all inputs
+    for (size_t j = txElements.GetOutputBegin(tx.vout.size()); j < txElements.GetElementCount(); j++) {
+        if (contains(txElements.GetElement(j)))
+            return true;
+    }
+
+    return false;
+}
+
+CTxBloomElements::CTxBloomElements(const CTransactionRef& txIn) : tx(txIn)
+{
+    vOutputBegin.reserve(tx->vout.size() + 1);
+    for (const CTxOut& txout : tx->vout) {
+        vOutputBegin.emplace_back(vElementEnds.size());
+        AddScript(txout.scriptPubKey);
+    }
+    vOutputBegin.emplace_back(vElementEnds.size());
+    for (const CTxIn& txin : tx->vin) {
+        unsigned char outpoint[36];
+        SerializeOutPoint(txin.prevout, outpoint);
+        AddElement(outpoint);
+        AddScript(txin.scriptSig);
+    }
+}
+
+void CTxBloomElements::AddElement(Span<const unsigned char> element)
+{
+    data.insert(data.end(), element.begin(), element.end());
+    vElementEnds.emplace_back(data.size());
+}
+
+// Same as the elements CBloomFilter::CheckScript looks at
+void CTxBloomElements::AddScript(const CScript& script)
+{
+    CScript::const_iterator pc = script.begin();
+    std::vector<unsigned char> element;
+    while (pc < script.end()) {
+        opcodetype opcode;
+        if (!script.GetOp(pc, opcode, element))
+            break;
+        if (element.size() != 0)
+            AddElement(element);
+    }
+}
+
 void CBloomFilter::UpdateEmptyFull()
 {
     bool full = true;
@@ -5,10 +5,13 @@
 #ifndef BITCOIN_BLOOM_H
 #define BITCOIN_BLOOM_H
 
+#include <primitives/transaction.h>
 #include <serialize.h>
+#include <span.h>
 
 #include <vector>
 
+class CMurmurHash3Multi;
 class COutPoint;
 class CScript;
 class CTransaction;
@@ -43,6 +46,42 @@ enum bloomflags
  * allowing clients to trade more bandwidth for more privacy by obfuscating which
  * keys are controlled by them.
  */
+/**
+ * The data elements of a transaction which CBloomFilter::IsRelevantAndUpdate matches: the data pushes of all
+ * scriptPubKeys and scriptSigs and the spent outpoints. They are extracted once, so that a transaction (or a block of
+ * them) can be matched against many filters without parsing its scripts every time.
+ */
+class CTxBloomElements
+{
+private:
+    //! All elements concatenated
+    std::vector<unsigned char> data;
+    //! Where each element ends in data, it starts where the previous one ends
+    std::vector<uint32_t> vElementEnds;
+    //! The index of the first element of every output, followed by the index of the first input element
+    std::vector<uint32_t> vOutputBegin;
+
+    void AddElement(Span<const unsigned char> element);
+    void AddScript(const CScript& script);
+
+public:
+    CTransactionRef tx;
+
+    explicit CTxBloomElements(const CTransactionRef& txIn);
+
+    size_t GetElementCount() const { return vElementEnds.size(); }
+    Span<const unsigned char> GetElement(size_t i) const
+    {
+        size_t nBegin = i == 0 ? 0 : vElementEnds[i - 1];
+        return Span<const unsigned char>(data.data() + nBegin, vElementEnds[i] - nBegin);
+    }
+    //! Elements [GetOutputBegin(n), GetOutputBegin(n + 1)) belong to output n, GetOutputBegin(vout.size()) is where
+    //! the input elements start
+    size_t GetOutputBegin(size_t nOut) const { return vOutputBegin[nOut]; }
+
+    size_t GetDataSize() const { return data.size(); }
+};
+
 class CBloomFilter
 {
 private:
@@ -53,12 +92,14 @@ private:
     unsigned int nTweak;
     unsigned char nFlags;
 
-    unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
+    unsigned int Hash(unsigned int nHashNum, const CMurmurHash3Multi& hasher) const;
 
     // Check matches for arbitrary script data elements
     bool CheckScript(const CScript& script) const;
     // Check additional matches for special transactions
     bool CheckSpecialTransactionMatchesAndUpdate(const CTransaction& tx);
+    // Add the outpoint of a matched output, depending on nFlags
+    void UpdateMatchedOutput(const CTransaction& tx, unsigned int nOut);
 public:
     /**
      * Creates a new bloom filter which will provide the given fp rate when filled with the given number of elements
@@ -74,11 +115,11 @@ public:
 
     SERIALIZE_METHODS(CBloomFilter, obj) { READWRITE(obj.vData, obj.nHashFuncs, obj.nTweak, obj.nFlags); }
 
-    void insert(const std::vector<unsigned char>& vKey);
+    void insert(Span<const unsigned char> vKey);
     void insert(const COutPoint& outpoint);
     void insert(const uint256& hash);
 
-    bool contains(const std::vector<unsigned char>& vKey) const;
+    bool contains(Span<const unsigned char> vKey) const;
     bool contains(const COutPoint& outpoint) const;
     bool contains(const uint256& hash) const;
     bool contains(const uint160& hash) const;
@@ -92,6 +133,8 @@ public:
 
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
+    //! Same as above, for a transaction of which the data elements were already extracted
+    bool IsRelevantAndUpdate(const CTxBloomElements& txElements);
 
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <map>
 
 static std::unique_ptr<bls::CoreMPL> pSchemeLegacy(new bls::LegacySchemeMPL);
 static std::unique_ptr<bls::CoreMPL> pScheme(new bls::BasicSchemeMPL);
@@ -313,6 +314,49 @@ bool CBLSSignature::VerifySecureAggregated(const std::vector<CBLSPublicKey>& pks
     return Scheme(fLegacy)->VerifySecure(vecPublicKeys, impl, bls::Bytes(hash.begin(), hash.size()));
 }
 
+#ifndef BUILD_BITCOIN_INTERNAL
+bool CBLSSignature::VerifyBatch(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes)
+{
+    assert(!sigs.empty() && sigs.size() == pubKeys.size() && sigs.size() == hashes.size());
+
+    // 128 bit weights make it infeasible to craft signatures which cancel out and keep the multiplications cheap
+    FastRandomContext rng;
+    uint8_t weightBytes[BLS_CURVE_SECKEY_SIZE] = {};
+
+    try {
+        std::vector<bls::G2Element> vecSigs;
+        vecSigs.reserve(sigs.size());
+        // the weighted public keys of the same hash are summed up, as the basic scheme only verifies distinct messages
+        std::map<uint256, bls::G1Element> mapPubKeys;
+        for (size_t i = 0; i < sigs.size(); i++) {
+            if (!sigs[i].IsValid() || !pubKeys[i].IsValid()) {
+                return false;
+            }
+            auto r = rng.randbytes(16);
+            std::copy(r.begin(), r.end(), weightBytes + sizeof(weightBytes) - r.size());
+            const auto weight = bls::PrivateKey::FromBytes(bls::Bytes(weightBytes, sizeof(weightBytes)));
+            vecSigs.emplace_back(weight * sigs[i].impl);
+            auto it = mapPubKeys.emplace(hashes[i], bls::G1Element()).first;
+            it->second += weight * pubKeys[i].impl;
+        }
+
+        std::vector<bls::G1Element> vecPubKeys;
+        std::vector<bls::Bytes> vecHashes;
+        vecPubKeys.reserve(mapPubKeys.size());
+        vecHashes.reserve(mapPubKeys.size());
+        for (const auto& p : mapPubKeys) {
+            vecPubKeys.emplace_back(p.second);
+            vecHashes.emplace_back(p.first.begin(), p.first.size());
+        }
+
+        const auto& scheme = Scheme(sigs[0].fLegacy);
+        return scheme->AggregateVerify(vecPubKeys, vecHashes, scheme->Aggregate(vecSigs));
+    } catch (...) {
+        return false;
+    }
+}
+#endif
+
 bool CBLSSignature::Recover(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSId>& ids)
 {
     fValid = false;
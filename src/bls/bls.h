@@ -99,18 +99,18 @@ public:
         *((C*)this) = C(fLegacy);
     }
 
-    void SetByteVector(const std::vector<uint8_t>& vecBytes)
+    void SetBytes(const uint8_t* data, size_t size)
     {
-        if (vecBytes.size() != SerSize) {
+        if (size != SerSize) {
             Reset();
             return;
         }
 
-        if (std::all_of(vecBytes.begin(), vecBytes.end(), [](uint8_t c) { return c == 0; })) {
+        if (std::all_of(data, data + size, [](uint8_t c) { return c == 0; })) {
             Reset();
         } else {
             try {
-                impl = ImplType::FromBytes(bls::Bytes(vecBytes), fLegacy);
+                impl = ImplType::FromBytes(bls::Bytes(data, size), fLegacy);
                 fValid = true;
             } catch (...) {
                 Reset();
@@ -119,6 +119,11 @@ public:
         cachedHash.SetNull();
     }
 
+    void SetByteVector(const std::vector<uint8_t>& vecBytes)
+    {
+        SetBytes(vecBytes.data(), vecBytes.size());
+    }
+
     std::vector<uint8_t> ToByteVector() const
     {
         if (!fValid) {
@@ -164,18 +169,25 @@ public:
     template <typename Stream>
     inline void Unserialize(Stream& s, bool checkMalleable = true)
     {
-        std::vector<uint8_t> vecBytes(SerSize, 0);
-        s.read((char*)vecBytes.data(), SerSize);
-        SetByteVector(vecBytes);
+        // read into a stack buffer, so that unserializing doesn't need a heap allocation of its own
+        std::array<uint8_t, SerSize> buf;
+        s.read((char*)buf.data(), SerSize);
+        SetBytes(buf.data(), SerSize);
 
-        if (checkMalleable && !CheckMalleable(vecBytes)) {
+        if (checkMalleable && !CheckMalleable(buf.data())) {
             throw std::ios_base::failure("malleable BLS object");
         }
     }
 
     inline bool CheckMalleable(const std::vector<uint8_t>& vecBytes) const
     {
-        if (memcmp(vecBytes.data(), ToByteVector().data(), SerSize)) {
+        return vecBytes.size() == SerSize && CheckMalleable(vecBytes.data());
+    }
+
+    //! data must point to SerSize bytes
+    inline bool CheckMalleable(const uint8_t* data) const
+    {
+        if (memcmp(data, ToByteVector().data(), SerSize)) {
             // TODO not sure if this is actually possible with the BLS libs. I'm assuming here that somewhere deep inside
             // these libs masking might happen, so that 2 different binary representations could result in the same object
             // representation
@@ -291,6 +303,13 @@ public:
 
     bool VerifySecureAggregated(const std::vector<CBLSPublicKey>& pks, const uint256& hash) const;
 
+#ifndef BUILD_BITCOIN_INTERNAL
+    // Checks that each sigs[i] is a valid signature of hashes[i] by pubKeys[i] with a single multi-pairing. Unlike with
+    // AggregateInsecure, every signature and public key is multiplied by a random weight first, so invalid signatures
+    // can't cancel each other out. Returns false if any of the signatures is invalid, without telling which one.
+    static bool VerifyBatch(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes);
+#endif
+
     bool Recover(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSId>& ids);
 };
 
@@ -301,7 +320,9 @@ class CBLSLazyWrapper
 private:
     mutable std::mutex mutex;
 
-    mutable std::vector<uint8_t> vecBytes;
+    // a fixed size buffer instead of a vector, so that creating, copying and unserializing the hot LLMQ messages
+    // (sig shares, recovered sigs, islocks) doesn't need a heap allocation per BLS object
+    mutable std::array<uint8_t, BLSObject::SerSize> vecBytes;
     mutable bool bufValid{false};
 
     mutable BLSObject obj;
@@ -309,9 +330,18 @@ private:
 
     mutable uint256 hash;
 
+    // requires mutex to be held
+    void UpdateBufFromObj() const
+    {
+        auto v = obj.ToByteVector();
+        std::copy(v.begin(), v.end(), vecBytes.begin());
+        bufValid = true;
+        hash.SetNull();
+    }
+
 public:
     CBLSLazyWrapper() :
-        vecBytes(BLSObject::SerSize, 0)
+        vecBytes{}
     {
         // the all-zero buf is considered a valid buf, but the resulting object will return false for IsValid
         bufValid = true;
@@ -354,9 +384,7 @@ public:
             throw std::ios_base::failure("obj and buf not initialized");
         }
         if (!bufValid) {
-            vecBytes = obj.ToByteVector();
-            bufValid = true;
-            hash.SetNull();
+            UpdateBufFromObj();
         }
         s.write((const char*)vecBytes.data(), vecBytes.size());
     }
@@ -387,8 +415,8 @@ public:
             return invalidObj;
         }
         if (!objInitialized) {
-            obj.SetByteVector(vecBytes);
-            if (!obj.CheckMalleable(vecBytes)) {
+            obj.SetBytes(vecBytes.data(), vecBytes.size());
+            if (!obj.CheckMalleable(vecBytes.data())) {
                 bufValid = false;
                 objInitialized = false;
                 obj = invalidObj;
@@ -399,6 +427,16 @@ public:
         return obj;
     }
 
+    /** The serialized object, the same bytes as Serialize writes */
+    std::array<uint8_t, BLSObject::SerSize> ToByteArray() const
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        if (!bufValid) {
+            UpdateBufFromObj();
+        }
+        return vecBytes;
+    }
+
     bool operator==(const CBLSLazyWrapper& r) const
     {
         if (bufValid && r.bufValid) {
@@ -419,9 +457,7 @@ public:
     {
         std::unique_lock<std::mutex> l(mutex);
         if (!bufValid) {
-            vecBytes = obj.ToByteVector();
-            bufValid = true;
-            hash.SetNull();
+            UpdateBufFromObj();
         }
         if (hash.IsNull()) {
             CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
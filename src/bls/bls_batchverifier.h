@@ -7,7 +7,9 @@
 
 #include <bls/bls.h>
 
+#include <iterator>
 #include <map>
+#include <set>
 #include <vector>
 
 template<typename SourceId, typename MessageId>
@@ -70,56 +72,118 @@ public:
 
     void Verify()
     {
-        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
-
+        std::vector<MessageMapIterator> allMessages;
+        allMessages.reserve(messages.size());
         for (auto it = messages.begin(); it != messages.end(); ++it) {
-            byMessageHash[it->second.msgHash].emplace_back(it);
+            allMessages.emplace_back(it);
         }
 
-        if (VerifyBatch(byMessageHash)) {
+        if (VerifyMessages(allMessages)) {
             // full batch is valid
             return;
         }
 
-        // revert to per-source verification
-        for (const auto& p : messagesBySource) {
-            bool batchValid = false;
+        // Bisect the sources to find the bad ones. Each step only needs to verify one half, as the other half is known
+        // to be bad if the first half turns out to be valid. This keeps the number of verifications logarithmic in the
+        // number of sources when only few of them are bad.
+        std::vector<typename MessagesBySourceMap::const_iterator> sources;
+        sources.reserve(messagesBySource.size());
+        for (auto it = messagesBySource.cbegin(); it != messagesBySource.cend(); ++it) {
+            sources.emplace_back(it);
+        }
+        BisectSources(sources.begin(), sources.end());
+    }
 
-            // no need to verify it again if there was just one source
-            if (messagesBySource.size() != 1) {
-                byMessageHash.clear();
-                for (auto it = p.second.begin(); it != p.second.end(); ++it) {
-                    byMessageHash[(*it)->second.msgHash].emplace_back(*it);
-                }
-                batchValid = VerifyBatch(byMessageHash);
+private:
+    typedef typename std::vector<typename MessagesBySourceMap::const_iterator>::const_iterator SourcesIterator;
+    typedef typename std::vector<MessageMapIterator>::const_iterator MessagesIterator;
+
+    bool VerifyMessages(MessagesIterator begin, MessagesIterator end)
+    {
+        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        for (auto it = begin; it != end; ++it) {
+            byMessageHash[(*it)->second.msgHash].emplace_back(*it);
+        }
+        return VerifyBatch(byMessageHash);
+    }
+
+    bool VerifyMessages(const std::vector<MessageMapIterator>& msgs)
+    {
+        return VerifyMessages(msgs.begin(), msgs.end());
+    }
+
+    bool VerifySources(SourcesIterator begin, SourcesIterator end)
+    {
+        std::vector<MessageMapIterator> msgs;
+        for (auto it = begin; it != end; ++it) {
+            msgs.insert(msgs.end(), (*it)->second.begin(), (*it)->second.end());
+        }
+        return VerifyMessages(msgs);
+    }
+
+    // The passed range of sources is known to contain at least one bad source
+    void BisectSources(SourcesIterator begin, SourcesIterator end)
+    {
+        if (std::distance(begin, end) == 1) {
+            const auto& p = **begin;
+            badSources.emplace(p.first);
+            if (perMessageFallback) {
+                FindBadMessages(p.second);
             }
-            if (!batchValid) {
-                badSources.emplace(p.first);
-
-                if (perMessageFallback) {
-                    // revert to per-message verification
-                    if (p.second.size() == 1) {
-                        // no need to re-verify a single message
-                        badMessages.emplace(p.second[0]->second.msgId);
-                    } else {
-                        for (const auto& msgIt : p.second) {
-                            if (badMessages.count(msgIt->first)) {
-                                // same message might be invalid from different source, so no need to re-verify it
-                                continue;
-                            }
-
-                            const auto& msg = msgIt->second;
-                            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
-                                badMessages.emplace(msg.msgId);
-                            }
-                        }
-                    }
-                }
+            return;
+        }
+
+        auto mid = begin + std::distance(begin, end) / 2;
+        if (VerifySources(begin, mid)) {
+            BisectSources(mid, end);
+        } else {
+            BisectSources(begin, mid);
+            if (!VerifySources(mid, end)) {
+                BisectSources(mid, end);
+            }
+        }
+    }
+
+    // The passed messages are known to contain at least one bad message
+    void FindBadMessages(const std::vector<MessageMapIterator>& msgs)
+    {
+        // same message might be invalid from different source, so no need to re-verify it
+        std::vector<MessageMapIterator> unknown;
+        unknown.reserve(msgs.size());
+        for (const auto& msgIt : msgs) {
+            if (!badMessages.count(msgIt->first)) {
+                unknown.emplace_back(msgIt);
+            }
+        }
+        if (unknown.empty()) {
+            return;
+        }
+        if (unknown.size() != msgs.size() && VerifyMessages(unknown)) {
+            // the already known bad messages were the reason for the failure
+            return;
+        }
+        BisectMessages(unknown.begin(), unknown.end());
+    }
+
+    // The passed range of messages is known to contain at least one bad message
+    void BisectMessages(MessagesIterator begin, MessagesIterator end)
+    {
+        if (std::distance(begin, end) == 1) {
+            badMessages.emplace((*begin)->first);
+            return;
+        }
+
+        auto mid = begin + std::distance(begin, end) / 2;
+        if (VerifyMessages(begin, mid)) {
+            BisectMessages(mid, end);
+        } else {
+            BisectMessages(begin, mid);
+            if (!VerifyMessages(mid, end)) {
+                BisectMessages(mid, end);
             }
         }
     }
 
-private:
     // All Verify methods take ownership of the passed byMessageHash map and thus might modify the map. This is to avoid
     // unnecessary copies
 
@@ -0,0 +1,91 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls_sigcache.h>
+
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util/system.h>
+
+#include <boost/thread.hpp>
+
+namespace {
+class CBLSSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || public key hash || message hash || signature hash)
+    uint256 nonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setValid;
+    boost::shared_mutex cs;
+
+public:
+    CBLSSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const CBLSPublicKey& pubKey, const uint256& msgHash, const CBLSSignature& sig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(pubKey.GetHash().begin(), 32).Write(msgHash.begin(), 32).Write(sig.GetHash().begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256 entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+};
+
+CBLSSignatureCache blsSignatureCache;
+} // namespace
+
+void InitBLSSignatureCache()
+{
+    // As with -maxsigcachesize, a size of zero creates the minimum possible cache (2 elements)
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-blssigcachesize", DEFAULT_BLS_SIG_CACHE_SIZE)), MAX_BLS_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = blsSignatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for BLS signature cache, able to store %zu elements\n",
+            (nElems * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
+}
+
+CBLSSigCacheEntry::CBLSSigCacheEntry(const CBLSPublicKey& pubKey, const uint256& msgHash, const CBLSSignature& sig)
+{
+    blsSignatureCache.ComputeEntry(entry, pubKey, msgHash, sig);
+}
+
+bool CBLSSigCacheEntry::IsCached() const
+{
+    return blsSignatureCache.Get(entry);
+}
+
+void CBLSSigCacheEntry::Add() const
+{
+    blsSignatureCache.Set(entry);
+}
+
+bool VerifyBLSSigCached(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash)
+{
+    CBLSSigCacheEntry entry(pubKey, msgHash, sig);
+    if (entry.IsCached()) {
+        return true;
+    }
+    if (!sig.VerifyInsecure(pubKey, msgHash)) {
+        return false;
+    }
+    entry.Add();
+    return true;
+}
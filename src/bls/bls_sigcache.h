@@ -0,0 +1,42 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_CRYPTO_BLS_SIGCACHE_H
+#define DASH_CRYPTO_BLS_SIGCACHE_H
+
+#include <bls/bls.h>
+
+// Default size of the BLS signature cache in MiB. Every entry takes 32 bytes, so this holds ~130k signatures
+static const unsigned int DEFAULT_BLS_SIG_CACHE_SIZE = 4;
+// Maximum BLS signature cache size allowed
+static const int64_t MAX_BLS_SIG_CACHE_SIZE = 1024;
+
+/**
+ * Cache of successfully verified BLS signatures, modelled on the script signature cache.
+ *
+ * The same recovered signatures, ISLOCKs and CLSIGs are usually received from multiple peers and special transactions
+ * are verified when entering the mempool and again when connecting the block, each time with an expensive pairing.
+ * Entries are salted hashes of (public key, message hash, signature), so they can't be crafted to collide.
+ */
+class CBLSSigCacheEntry
+{
+private:
+    uint256 entry;
+
+public:
+    CBLSSigCacheEntry(const CBLSPublicKey& pubKey, const uint256& msgHash, const CBLSSignature& sig);
+
+    //! Returns true if the signature was successfully verified before
+    bool IsCached() const;
+    //! Mark the signature as successfully verified
+    void Add() const;
+};
+
+/** Verifies sig with VerifyInsecure, unless the same signature was successfully verified before */
+bool VerifyBLSSigCached(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash);
+
+// To be called once in AppInitMain/BasicTestingSetup
+void InitBLSSignatureCache();
+
+#endif // DASH_CRYPTO_BLS_SIGCACHE_H
@@ -4,10 +4,12 @@
 
 #include <bls/bls_worker.h>
 #include <hash.h>
+#include <random.h>
 #include <serialize.h>
 
 #include <util/system.h>
 
+#include <condition_variable>
 #include <memory>
 #include <utility>
 
@@ -63,14 +65,82 @@ void CBLSWorker::Start()
 {
     int workerCount = std::thread::hardware_concurrency() / 2;
     workerCount = std::max(std::min(1, workerCount), 4);
-    workerPool.resize(workerCount);
-    RenameThreadPool(workerPool, "dash-bls-work");
+    workerPool.Start(workerCount, "dash-bls-work");
 }
 
 void CBLSWorker::Stop()
 {
-    workerPool.clear_queue();
-    workerPool.stop(true);
+    workerPool.Stop();
+}
+
+void CBLSWorker::RunJobs(std::vector<std::function<void()>>& jobs, const std::function<void()>& callerJob)
+{
+    if (jobs.empty()) {
+        if (callerJob) {
+            callerJob();
+        }
+        return;
+    }
+
+    struct State {
+        std::vector<std::function<void()>>& jobs;
+        const size_t count;
+        std::atomic<size_t> nextJob{0};
+        std::atomic<size_t> doneCount{0};
+        std::mutex cs;
+        std::condition_variable cond;
+        explicit State(std::vector<std::function<void()>>& _jobs) : jobs(_jobs), count(_jobs.size()) {}
+    };
+    auto state = std::make_shared<State>(jobs);
+
+    // Helpers which only get to run after all jobs were picked up return without touching the jobs, so it's fine that
+    // they might outlive this call
+    auto runJobs = [state]() {
+        size_t i;
+        while ((i = state->nextJob++) < state->count) {
+            state->jobs[i]();
+            if (++state->doneCount == state->count) {
+                std::unique_lock<std::mutex> l(state->cs);
+                state->cond.notify_all();
+            }
+        }
+    };
+
+    // the calling thread is busy with callerJob first, so the workers should pick up all jobs in that case
+    size_t helperCount = std::min(callerJob ? jobs.size() : jobs.size() - 1, (size_t)std::max(1U, std::thread::hardware_concurrency()));
+    for (size_t i = 0; i < helperCount; i++) {
+        workerPool.PushJob(CBLSWorkerPool::Priority::LATENCY, [runJobs](int threadId) {
+            runJobs();
+        });
+    }
+    if (callerJob) {
+        callerJob();
+    }
+    runJobs();
+
+    std::unique_lock<std::mutex> l(state->cs);
+    state->cond.wait(l, [&] { return state->doneCount == state->count; });
+}
+
+void CBLSWorker::DecodeLazySignatures(const std::vector<const CBLSLazySignature*>& sigs)
+{
+    // decoding a single signature is too cheap to hand it over to another thread
+    const size_t batchSize = 8;
+    if (sigs.size() <= batchSize) {
+        return;
+    }
+
+    std::vector<std::function<void()>> jobs;
+    jobs.reserve((sigs.size() + batchSize - 1) / batchSize);
+    for (size_t i = 0; i < sigs.size(); i += batchSize) {
+        size_t end = std::min(i + batchSize, sigs.size());
+        jobs.emplace_back([&sigs, i, end]() {
+            for (size_t j = i; j < end; j++) {
+                sigs[j]->Get();
+            }
+        });
+    }
+    RunJobs(jobs);
 }
 
 bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skSharesRet)
@@ -94,7 +164,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, f));
     }
 
     for (size_t i = 0; i < ids.size(); i += batchSize) {
@@ -108,7 +178,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, f));
     }
     bool success = true;
     for (auto& f : futures) {
@@ -135,13 +205,12 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     std::shared_ptr<std::vector<const T*> > inputVec;
 
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    CBLSWorkerPool& workerPool;
 
-    std::mutex m;
     // items in the queue are all intermediate aggregation results of finished batches.
     // The intermediate results must be deleted by us again (which we do in SyncAggregateAndPushAggQueue)
-    ctpl::detail::Queue<T*> aggQueue;
-    std::atomic<size_t> aggQueueSize{0};
+    std::mutex aggQueueMutex;
+    std::vector<T*> aggQueue;
 
     // keeps track of currently queued/in-progress batches. If it reaches 0, we are done
     std::atomic<size_t> waitCount{0};
@@ -154,10 +223,10 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     Aggregator(const std::vector<TP>& _inputVec,
                size_t start, size_t count,
                bool _parallel,
-               ctpl::thread_pool& _workerPool,
+               CBLSWorkerPool& _workerPool,
                DoneCallback _doneCallback) :
-            workerPool(_workerPool),
             parallel(_parallel),
+            workerPool(_workerPool),
             doneCallback(std::move(_doneCallback))
     {
         inputVec = std::make_shared<std::vector<const T*> >(count);
@@ -226,13 +295,12 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
         // work. This is the case when these did not add up to a new batch. In this case, we have to aggregate
         // the items into the final result
 
-        std::vector<T*> rem(aggQueueSize);
-        for (size_t i = 0; i < rem.size(); i++) {
-            T* p = nullptr;
-            bool s = aggQueue.pop(p);
-            assert(s);
-            rem[i] = p;
+        std::vector<T*> rem;
+        {
+            std::unique_lock<std::mutex> l(aggQueueMutex);
+            rem = std::move(aggQueue);
         }
+        assert(!rem.empty());
 
         T r;
         if (rem.size() == 1) {
@@ -273,32 +341,21 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
 
     void PushAggQueue(const T& v)
     {
-        aggQueue.push(new T(v));
-
-        if (++aggQueueSize >= batchSize) {
-            // we've collected enough intermediate results to form a new batch.
-            std::shared_ptr<std::vector<const T*> > newBatch;
-            {
-                std::unique_lock<std::mutex> l(m);
-                if (aggQueueSize < batchSize) {
-                    // some other worker thread grabbed this batch
-                    return;
-                }
-                newBatch = std::make_shared<std::vector<const T*> >(batchSize);
-                // collect items for new batch
-                for (size_t i = 0; i < batchSize; i++) {
-                    T* p = nullptr;
-                    bool s = aggQueue.pop(p);
-                    assert(s);
-                    (*newBatch)[i] = p;
-                }
-                aggQueueSize -= batchSize;
+        std::shared_ptr<std::vector<const T*> > newBatch;
+        {
+            std::unique_lock<std::mutex> l(aggQueueMutex);
+            aggQueue.emplace_back(new T(v));
+            if (aggQueue.size() < batchSize) {
+                return;
             }
-
-            // push new batch to work queue. del=true this time as these items are intermediate results and need to be deleted
-            // after aggregation is done
-            AsyncAggregateAndPushAggQueue(newBatch, 0, newBatch->size(), true);
+            // we've collected enough intermediate results to form a new batch.
+            newBatch = std::make_shared<std::vector<const T*> >(aggQueue.begin(), aggQueue.end());
+            aggQueue.clear();
         }
+
+        // push new batch to work queue. del=true this time as these items are intermediate results and need to be deleted
+        // after aggregation is done
+        AsyncAggregateAndPushAggQueue(newBatch, 0, newBatch->size(), true);
     }
 
     template <typename TP>
@@ -314,7 +371,7 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     template <typename Callable>
     void PushWork(Callable&& f)
     {
-        workerPool.push(f);
+        workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, f);
     }
 };
 
@@ -342,7 +399,7 @@ struct VectorAggregator : public std::enable_shared_from_this<VectorAggregator<T
     size_t start;
     size_t count;
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    CBLSWorkerPool& workerPool;
 
     std::atomic<size_t> doneCount;
 
@@ -351,14 +408,14 @@ struct VectorAggregator : public std::enable_shared_from_this<VectorAggregator<T
 
     VectorAggregator(const VectorVectorType& _vecs,
                      size_t _start, size_t _count,
-                     bool _parallel, ctpl::thread_pool& _workerPool,
+                     bool _parallel, CBLSWorkerPool& _workerPool,
                      DoneCallback _doneCallback) :
+            doneCallback(std::move(_doneCallback)),
             vecs(_vecs),
-            parallel(_parallel),
             start(_start),
             count(_count),
+            parallel(_parallel),
             workerPool(_workerPool),
-            doneCallback(std::move(_doneCallback)),
             doneCount(0)
     {
         assert(!vecs.empty());
@@ -390,7 +447,7 @@ struct VectorAggregator : public std::enable_shared_from_this<VectorAggregator<T
 };
 
 // See comment of AsyncVerifyContributionShares for a description on what this does
-// Same rules as in Aggregator apply for the inputs
+// The inputs are copied in a random order, so that the caller doesn't need to keep them alive
 struct ContributionVerifier : public std::enable_shared_from_this<ContributionVerifier> {
     struct BatchState {
         size_t start;
@@ -411,13 +468,15 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
     };
 
     CBLSId forId;
-    const std::vector<BLSVerificationVectorPtr>& vvecs;
-    const BLSSecretKeyVector& skShares;
+    // inputs in random order, order[i] is the index of the i-th entry in the original inputs
+    std::vector<size_t> order;
+    std::vector<BLSVerificationVectorPtr> vvecs;
+    BLSSecretKeyVector skShares;
     size_t batchSize;
     bool parallel;
     bool aggregated;
 
-    ctpl::thread_pool& workerPool;
+    CBLSWorkerPool& workerPool;
 
     size_t batchCount;
     size_t verifyCount;
@@ -428,19 +487,31 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
 
     ContributionVerifier(CBLSId _forId, const std::vector<BLSVerificationVectorPtr>& _vvecs,
                          const BLSSecretKeyVector& _skShares, size_t _batchSize,
-                         bool _parallel, bool _aggregated, ctpl::thread_pool& _workerPool,
+                         bool _parallel, bool _aggregated, CBLSWorkerPool& _workerPool,
                          std::function<void(const std::vector<bool>&)> _doneCallback) :
         forId(std::move(_forId)),
-        vvecs(_vvecs),
-        skShares(_skShares),
         batchSize(_batchSize),
         parallel(_parallel),
         aggregated(_aggregated),
         workerPool(_workerPool),
-        doneCallback(std::move(_doneCallback)),
         batchCount(1),
-        verifyCount(_vvecs.size())
+        verifyCount(_vvecs.size()),
+        doneCallback(std::move(_doneCallback))
     {
+        // With plain (non-randomized) aggregation, two invalid contributions could cancel each other out if they end up
+        // in the same batch. Shuffling prevents colluding members from choosing their batch.
+        order.resize(_vvecs.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        Shuffle(order.begin(), order.end(), FastRandomContext());
+
+        vvecs.reserve(order.size());
+        skShares.reserve(order.size());
+        for (size_t idx : order) {
+            vvecs.emplace_back(_vvecs[idx]);
+            skShares.emplace_back(_skShares[idx]);
+        }
     }
 
     void Start()
@@ -480,7 +551,7 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
         for (size_t i = 0; i < vvecs.size(); i += batchSize) {
             auto& batchState = batchStates[batchIdx++];
             for (size_t j = 0; j < batchState.count; j++) {
-                result[batchState.start + j] = batchState.verifyResults[j] != 0;
+                result[order[batchState.start + j]] = batchState.verifyResults[j] != 0;
             }
         }
         doneCallback(result);
@@ -550,7 +621,8 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
                 batchState.verifyResults.assign(batchState.count, 1);
                 HandleVerifyDone(batchState.count);
             } else {
-                // at least one entry in the batch is invalid, revert to per-contribution verification (but parallelized)
+                // at least one entry in the batch is invalid. Aggregating parts of the batch again would let errors
+                // cancel out within such a part, so each entry is verified on its own now
                 AsyncVerifyBatchOneByOne(batchIdx);
             }
         };
@@ -587,7 +659,7 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
     void PushOrDoWork(Callable&& f)
     {
         if (parallel) {
-            workerPool.push(std::forward<Callable>(f));
+            workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, std::forward<Callable>(f));
         } else {
             f(0);
         }
@@ -629,7 +701,7 @@ BLSVerificationVectorPtr CBLSWorker::BuildQuorumVerificationVector(const std::ve
 }
 
 template <typename T>
-void AsyncAggregateHelper(ctpl::thread_pool& workerPool,
+void AsyncAggregateHelper(CBLSWorkerPool& workerPool,
                           const std::vector<T>& vec, size_t start, size_t count, bool parallel,
                           std::function<void(const T&)> doneCallback)
 {
@@ -767,7 +839,65 @@ std::future<bool> CBLSWorker::AsyncVerifyContributionShare(const CBLSId& forId,
         CBLSPublicKey pk2 = skContribution.GetPublicKey();
         return pk1 == pk2;
     };
-    return workerPool.push(f);
+    return workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, f);
+}
+
+bool CBLSWorker::EncryptContributionShares(const std::vector<CBLSPublicKey>& recipients, const BLSSecretKeyVector& skShares,
+                                           CBLSIESMultiRecipientObjects<CBLSSecretKey>& encryptedRet, int nVersion)
+{
+    if (recipients.size() != skShares.size()) {
+        return false;
+    }
+
+    // each job only writes to its own blob, InitEncrypt already allocated all of them
+    encryptedRet.InitEncrypt(recipients.size());
+
+    std::vector<std::future<bool>> futures;
+    futures.reserve(recipients.size());
+    for (size_t i = 0; i < recipients.size(); i++) {
+        futures.emplace_back(workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, [&, i](int threadId) {
+            return encryptedRet.Encrypt(i, recipients[i], skShares[i], nVersion);
+        }));
+    }
+
+    bool ret = true;
+    for (auto& f : futures) {
+        // all jobs must be finished before returning, as they reference our arguments. Jobs discarded due to
+        // shutdown result in a broken promise
+        try {
+            ret &= f.get();
+        } catch (const std::future_error&) {
+            ret = false;
+        }
+    }
+    return ret;
+}
+
+BLSSecretKeyVector CBLSWorker::DecryptContributionShares(const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& encrypted,
+                                                         size_t idx, const CBLSSecretKey& sk, int nVersion)
+{
+    std::vector<std::future<CBLSSecretKey>> futures;
+    futures.reserve(encrypted.size());
+    for (const auto& e : encrypted) {
+        futures.emplace_back(workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, [&](int threadId) {
+            CBLSSecretKey skShare;
+            if (!e->Decrypt(idx, sk, skShare, nVersion)) {
+                return CBLSSecretKey();
+            }
+            return skShare;
+        }));
+    }
+
+    BLSSecretKeyVector ret;
+    ret.reserve(futures.size());
+    for (auto& f : futures) {
+        try {
+            ret.emplace_back(f.get());
+        } catch (const std::future_error&) {
+            ret.emplace_back();
+        }
+    }
+    return ret;
 }
 
 __attribute__((unused)) bool CBLSWorker::VerifyContributionShare(const CBLSId& forId, const BLSVerificationVectorPtr& vvec,
@@ -829,7 +959,7 @@ __attribute__((unused)) bool CBLSWorker::VerifySignatureVector(const BLSSignatur
 
 void CBLSWorker::AsyncSign(const CBLSSecretKey& secKey, const uint256& msgHash, const CBLSWorker::SignDoneCallback& doneCallback)
 {
-    workerPool.push([secKey, msgHash, doneCallback](int threadId) {
+    workerPool.Push(CBLSWorkerPool::Priority::LATENCY, [secKey, msgHash, doneCallback](int threadId) {
         doneCallback(secKey.Sign(msgHash));
     });
 }
@@ -841,6 +971,17 @@ __attribute__((unused)) std::future<CBLSSignature> CBLSWorker::AsyncSign(const C
     return std::move(p.second);
 }
 
+void CBLSWorker::AsyncRecoverSig(const BLSSignatureVector& sigShares, const std::vector<CBLSId>& ids, const CBLSWorker::SignDoneCallback& doneCallback)
+{
+    workerPool.Push(CBLSWorkerPool::Priority::LATENCY, [sigShares, ids, doneCallback](int threadId) {
+        CBLSSignature recoveredSig;
+        if (!recoveredSig.Recover(sigShares, ids)) {
+            recoveredSig.Reset();
+        }
+        doneCallback(recoveredSig);
+    });
+}
+
 void CBLSWorker::AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash,
                                 CBLSWorker::SigVerifyDoneCallback doneCallback, CancelCond cancelCond)
 {
@@ -887,8 +1028,11 @@ bool CBLSWorker::IsAsyncVerifyInProgress()
 // sigVerifyMutex must be held while calling
 void CBLSWorker::PushSigVerifyBatch()
 {
-    auto f = [this](int threadId, const std::shared_ptr<std::vector<SigVerifyJob> >& _jobs) {
-        auto& jobs = *_jobs;
+    auto batch = std::make_shared<std::vector<SigVerifyJob> >(std::move(sigVerifyQueue));
+    sigVerifyQueue.reserve(SIG_VERIFY_BATCH_SIZE);
+
+    auto f = [this, batch](int threadId) {
+        auto& jobs = *batch;
         if (jobs.size() == 1) {
             auto& job = jobs[0];
             if (!job.cancelCond()) {
@@ -949,9 +1093,6 @@ void CBLSWorker::PushSigVerifyBatch()
         }
     };
 
-    auto batch = std::make_shared<std::vector<SigVerifyJob> >(std::move(sigVerifyQueue));
-    sigVerifyQueue.reserve(SIG_VERIFY_BATCH_SIZE);
-
     sigVerifyBatchesInProgress++;
-    workerPool.push(f, batch);
+    workerPool.Push(CBLSWorkerPool::Priority::LATENCY, f);
 }
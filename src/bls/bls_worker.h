@@ -6,8 +6,8 @@
 #define DASH_CRYPTO_BLS_WORKER_H
 
 #include <bls/bls.h>
-
-#include <ctpl_stl.h>
+#include <bls/bls_ies.h>
+#include <bls/bls_worker_pool.h>
 
 #include <future>
 #include <mutex>
@@ -25,7 +25,7 @@ public:
     typedef std::function<bool()> CancelCond;
 
 private:
-    ctpl::thread_pool workerPool;
+    CBLSWorkerPool workerPool;
 
     static const int SIG_VERIFY_BATCH_SIZE = 8;
     struct SigVerifyJob {
@@ -55,6 +55,18 @@ public:
     void Start();
     void Stop();
 
+    const CBLSWorkerPool& GetWorkerPool() const { return workerPool; }
+    CBLSWorkerPool& GetWorkerPool() { return workerPool; }
+
+    // Runs all jobs and returns when all of them have finished. If given, callerJob is run on the calling thread while
+    // the workers already start on the jobs. The calling thread takes part in the work afterwards, so all jobs are
+    // still run (on the calling thread only) when the workers are not started or already stopped. Jobs must not throw.
+    void RunJobs(std::vector<std::function<void()>>& jobs, const std::function<void()>& callerJob = nullptr);
+
+    // Decodes lazy signatures which were only unserialized so far in parallel, so that the following Get() calls
+    // don't have to do it one by one. Already decoded signatures are skipped cheaply.
+    void DecodeLazySignatures(const std::vector<const CBLSLazySignature*>& sigs);
+
     bool GenerateContributions(int threshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skSharesRet);
 
     // The following functions are all used to aggregate verification (public key) vectors
@@ -112,7 +124,9 @@ public:
     // a batch are aggregated (in parallel, see AsyncBuildQuorumVerificationVector and AsyncBuildSecretKeyShare). The
     // result per batch is a single aggregated verification vector and a single aggregated contribution, which are then
     // verified with VerifyContributionShare. If verification of the aggregated inputs is successful, the whole batch
-    // is marked as valid. If the batch verification fails, the individual entries are verified in a non-aggregated manner
+    // is marked as valid. If the batch verification fails, each entry of the batch is verified individually.
+    // Inputs are assigned to batches in random order, so that invalid contributions can't be placed in the same batch
+    // on purpose to cancel each other out
     void AsyncVerifyContributionShares(const CBLSId& forId, const std::vector<BLSVerificationVectorPtr>& vvecs, const BLSSecretKeyVector& skShares,
                                        bool parallel, bool aggregated, std::function<void(const std::vector<bool>&)> doneCallback);
     std::future<std::vector<bool> > AsyncVerifyContributionShares(const CBLSId& forId, const std::vector<BLSVerificationVectorPtr>& vvecs, const BLSSecretKeyVector& skShares,
@@ -122,6 +136,14 @@ public:
 
     std::future<bool> AsyncVerifyContributionShare(const CBLSId& forId, const BLSVerificationVectorPtr& vvec, const CBLSSecretKey& skContribution);
 
+    // Encrypts the contribution shares for all recipients. The DH key exchange for each recipient is done in its own job
+    bool EncryptContributionShares(const std::vector<CBLSPublicKey>& recipients, const BLSSecretKeyVector& skShares,
+                                   CBLSIESMultiRecipientObjects<CBLSSecretKey>& encryptedRet, int nVersion);
+    // Decrypts the share for the given recipient index from multiple encrypted contributions, one job per contribution.
+    // Result entries are invalid secret keys if decryption failed
+    BLSSecretKeyVector DecryptContributionShares(const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& encrypted,
+                                                 size_t idx, const CBLSSecretKey& sk, int nVersion);
+
     // Non parallelized verification of a single contribution
     static bool VerifyContributionShare(const CBLSId& forId, const BLSVerificationVectorPtr& vvec, const CBLSSecretKey& skContribution);
 
@@ -138,6 +160,10 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Recovers the threshold signature from the given shares (Lagrange interpolation). The callback receives an invalid
+    // signature if recovery failed
+    void AsyncRecoverSig(const BLSSignatureVector& sigShares, const std::vector<CBLSId>& ids, const SignDoneCallback& doneCallback);
+
 private:
     void PushSigVerifyBatch();
 };
@@ -179,6 +205,12 @@ public:
         });
     }
 
+    void ClearPubKeyShares()
+    {
+        std::unique_lock<std::mutex> l(cacheCs);
+        publicKeyShareCache.clear();
+    }
+
 private:
     template <typename T, typename Builder>
     T GetOrBuild(const uint256& cacheKey, std::map<uint256, std::shared_future<T> >& cache, Builder&& builder)
@@ -0,0 +1,154 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls_worker_pool.h>
+
+#include <tinyformat.h>
+#include <util/threadnames.h>
+
+// Allows jobs that push new jobs (e.g. the aggregators) to push into the deques of the current worker thread
+static thread_local const CBLSWorkerPool* currentPool{nullptr};
+static thread_local size_t currentThreadIdx{0};
+
+CBLSWorkerPool::CBLSWorkerPool()
+{
+    for (auto& d : queueDepth) {
+        d = 0;
+    }
+}
+
+CBLSWorkerPool::~CBLSWorkerPool()
+{
+    Stop();
+}
+
+void CBLSWorkerPool::Start(int threadCount, const std::string& threadName)
+{
+    assert(threads.empty());
+    assert(threadCount > 0);
+
+    stopping = false;
+    queues.clear();
+    for (int i = 0; i < threadCount; i++) {
+        queues.emplace_back(std::make_unique<WorkerQueues>());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&CBLSWorkerPool::ThreadMain, this, (size_t)i, threadName);
+    }
+}
+
+void CBLSWorkerPool::Stop()
+{
+    {
+        std::unique_lock<std::mutex> l(cs);
+        stopping = true;
+    }
+    cond.notify_all();
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    threads.clear();
+
+    for (auto& q : queues) {
+        std::unique_lock<std::mutex> l(q->cs);
+        for (auto& jobs : q->jobs) {
+            jobs.clear();
+        }
+    }
+    for (auto& d : queueDepth) {
+        d = 0;
+    }
+}
+
+void CBLSWorkerPool::PushJob(Priority prio, Job&& job)
+{
+    if (queues.empty()) {
+        // not started (or already stopped)
+        return;
+    }
+
+    size_t queueIdx;
+    if (currentPool == this) {
+        queueIdx = currentThreadIdx;
+    } else {
+        queueIdx = nextQueue++ % queues.size();
+    }
+
+    auto& q = *queues[queueIdx];
+    {
+        std::unique_lock<std::mutex> l(q.cs);
+        q.jobs[(size_t)prio].emplace_back(std::move(job));
+        ++queueDepth[(size_t)prio];
+    }
+    {
+        // make sure that no worker misses the new job between checking the queue depth and going to sleep
+        std::unique_lock<std::mutex> l(cs);
+    }
+    cond.notify_one();
+}
+
+bool CBLSWorkerPool::PopJob(size_t threadIdx, Job& jobRet)
+{
+    for (size_t prio = 0; prio < PRIORITY_COUNT; prio++) {
+        if (queueDepth[prio] == 0) {
+            continue;
+        }
+
+        // own jobs first, newest first as these are most likely follow-up jobs of what we just did
+        {
+            auto& q = *queues[threadIdx];
+            std::unique_lock<std::mutex> l(q.cs);
+            auto& jobs = q.jobs[prio];
+            if (!jobs.empty()) {
+                jobRet = std::move(jobs.back());
+                jobs.pop_back();
+                --queueDepth[prio];
+                return true;
+            }
+        }
+
+        // steal the oldest job from the other workers
+        for (size_t i = 1; i < queues.size(); i++) {
+            auto& q = *queues[(threadIdx + i) % queues.size()];
+            std::unique_lock<std::mutex> l(q.cs);
+            auto& jobs = q.jobs[prio];
+            if (!jobs.empty()) {
+                jobRet = std::move(jobs.front());
+                jobs.pop_front();
+                --queueDepth[prio];
+                ++stealCount;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CBLSWorkerPool::ThreadMain(size_t threadIdx, const std::string& threadName)
+{
+    util::ThreadRename(strprintf("%s-%d", threadName, threadIdx));
+    currentPool = this;
+    currentThreadIdx = threadIdx;
+
+    while (true) {
+        Job job;
+        if (PopJob(threadIdx, job)) {
+            job((int)threadIdx);
+            ++jobCount;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> l(cs);
+        cond.wait(l, [&] {
+            return stopping || queueDepth[0] != 0 || queueDepth[1] != 0;
+        });
+        if (stopping) {
+            break;
+        }
+    }
+
+    currentPool = nullptr;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_CRYPTO_BLS_WORKER_POOL_H
+#define DASH_CRYPTO_BLS_WORKER_POOL_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool used by CBLSWorker
+// Each worker thread owns one deque per priority class. Jobs pushed from inside a worker thread go into the deques of
+// that thread (LIFO for cache locality), jobs pushed from outside are distributed round-robin. Idle workers first
+// look into their own deques and then steal the oldest jobs from other workers. Jobs of the LATENCY class are always
+// preferred over THROUGHPUT jobs, so that a large DKG aggregation can't starve signature verification.
+class CBLSWorkerPool
+{
+public:
+    enum class Priority {
+        // signature verification and signing, which is on the critical path of LLMQ based signing
+        LATENCY = 0,
+        // DKG contributions, verification vector building and other bulk aggregations
+        THROUGHPUT = 1,
+    };
+    static const size_t PRIORITY_COUNT = 2;
+
+    typedef std::function<void(int)> Job;
+
+private:
+    struct WorkerQueues {
+        std::mutex cs;
+        std::deque<Job> jobs[PRIORITY_COUNT];
+    };
+
+    std::vector<std::unique_ptr<WorkerQueues>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    bool stopping{false};
+
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<size_t> queueDepth[PRIORITY_COUNT];
+    std::atomic<uint64_t> stealCount{0};
+    std::atomic<uint64_t> jobCount{0};
+
+public:
+    CBLSWorkerPool();
+    ~CBLSWorkerPool();
+
+    void Start(int threadCount, const std::string& threadName);
+    // Discards all queued jobs and waits for running jobs to finish
+    void Stop();
+
+    int Size() const { return (int)threads.size(); }
+
+    size_t GetQueueDepth(Priority prio) const { return queueDepth[(size_t)prio]; }
+    uint64_t GetStealCount() const { return stealCount; }
+    uint64_t GetJobCount() const { return jobCount; }
+
+    // Same semantic as ctpl::thread_pool::push. The job receives the index of the thread it runs on
+    template <typename F>
+    auto Push(Priority prio, F&& f) -> std::future<decltype(f(0))>
+    {
+        auto pck = std::make_shared<std::packaged_task<decltype(f(0))(int)>>(std::forward<F>(f));
+        PushJob(prio, [pck](int threadId) {
+            (*pck)(threadId);
+        });
+        return pck->get_future();
+    }
+
+    void PushJob(Priority prio, Job&& job);
+
+private:
+    bool PopJob(size_t threadIdx, Job& jobRet);
+    void ThreadMain(size_t threadIdx, const std::string& threadName);
+};
+
+#endif //DASH_CRYPTO_BLS_WORKER_POOL_H
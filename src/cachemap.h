@@ -5,11 +5,14 @@
 #ifndef BITCOIN_CACHEMAP_H
 #define BITCOIN_CACHEMAP_H
 
-#include <map>
 #include <list>
 #include <cstddef>
+#include <unordered_map>
 
+#include <saltedhasher.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
+#include <uint256.h>
 
 /**
  * Serializable structure for key/value items
@@ -34,11 +37,41 @@ struct CacheItem
     }
 };
 
+/**
+ * Hasher used for the index of CacheMap and CacheMultiMap, uint256 keys are hashed with StaticSaltedHasher
+ */
+template<typename K>
+struct CacheMapHasher : std::hash<K> {};
+
+template<>
+struct CacheMapHasher<uint256> : StaticSaltedHasher {};
+
+/**
+ * The list and index nodes of a CacheMap/CacheMultiMap are allocated from a pool owned by the container, so that
+ * inserting and pruning items does not hit the heap after the pool has grown to the maximum size.
+ */
+template<typename A, typename B, typename C = A>
+struct CacheMapPool
+{
+private:
+    static constexpr size_t Max(size_t a, size_t b) { return a > b ? a : b; }
+
+public:
+    //! Nodes of lists, hash tables and trees hold up to 4 pointers (or a cached hash) in addition to the payload
+    static constexpr size_t BLOCK_SIZE = Max(sizeof(A), Max(sizeof(B), sizeof(C))) + 4 * sizeof(void*);
+    static constexpr size_t ALIGN = Max(alignof(void*), Max(alignof(A), Max(alignof(B), alignof(C))));
+    //! Chunks hold 64 blocks, small enough to not waste memory for small or empty containers
+    static constexpr size_t CHUNK_SIZE = BLOCK_SIZE * 64;
+
+    typedef PoolResource<BLOCK_SIZE, ALIGN> Resource;
+    template<typename T>
+    using Allocator = PoolAllocator<T, BLOCK_SIZE, ALIGN>;
+};
 
 /**
  * Map like container that keeps the N most recently added items
  */
-template<typename K, typename V, typename Size = uint32_t>
+template<typename K, typename V, typename Size = uint32_t, typename Hasher = CacheMapHasher<K>>
 class CacheMap
 {
 public:
@@ -46,13 +79,15 @@ public:
 
     typedef CacheItem<K,V> item_t;
 
-    typedef std::list<item_t> list_t;
+    typedef CacheMapPool<item_t, std::pair<const K, void*>> pool_t;
+
+    typedef std::list<item_t, typename pool_t::template Allocator<item_t>> list_t;
 
     typedef typename list_t::iterator list_it;
 
     typedef typename list_t::const_iterator list_cit;
 
-    typedef std::map<K, list_it> map_t;
+    typedef std::unordered_map<K, list_it, Hasher, std::equal_to<K>, typename pool_t::template Allocator<std::pair<const K, list_it>>> map_t;
 
     typedef typename map_t::iterator map_it;
 
@@ -61,6 +96,8 @@ public:
 private:
     size_type nMaxSize;
 
+    typename pool_t::Resource poolResource{pool_t::CHUNK_SIZE};
+
     list_t listItems;
 
     map_t mapIndex;
@@ -68,15 +105,14 @@ private:
 public:
     explicit CacheMap(size_type nMaxSizeIn = 0)
         : nMaxSize(nMaxSizeIn),
-          listItems(),
-          mapIndex()
+          listItems(&poolResource),
+          mapIndex(0, Hasher(), std::equal_to<K>(), &poolResource)
     {}
 
-    CacheMap(const CacheMap<K,V>& other)
-        : nMaxSize(other.nMaxSize),
-          listItems(other.listItems),
-          mapIndex()
+    CacheMap(const CacheMap& other)
+        : CacheMap(other.nMaxSize)
     {
+        listItems.insert(listItems.end(), other.listItems.begin(), other.listItems.end());
         RebuildIndex();
     }
 
@@ -142,11 +178,14 @@ public:
         return listItems;
     }
 
-    CacheMap<K,V>& operator=(const CacheMap<K,V>& other)
+    CacheMap& operator=(const CacheMap& other)
     {
-        nMaxSize = other.nMaxSize;
-        listItems = other.listItems;
-        RebuildIndex();
+        if(this != &other) {
+            nMaxSize = other.nMaxSize;
+            Clear();
+            listItems.insert(listItems.end(), other.listItems.begin(), other.listItems.end());
+            RebuildIndex();
+        }
         return *this;
     }
 
@@ -170,6 +209,7 @@ private:
     void RebuildIndex()
     {
         mapIndex.clear();
+        mapIndex.reserve(listItems.size());
         for(list_it it = listItems.begin(); it != listItems.end(); ++it) {
             mapIndex.emplace(it->key, it);
         }
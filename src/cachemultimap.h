@@ -8,7 +8,7 @@
 #include <cstddef>
 #include <map>
 #include <list>
-#include <set>
+#include <unordered_map>
 
 #include <serialize.h>
 
@@ -17,7 +17,7 @@
 /**
  * Map like container that keeps the N most recently added items
  */
-template<typename K, typename V, typename Size = uint32_t>
+template<typename K, typename V, typename Size = uint32_t, typename Hasher = CacheMapHasher<K>>
 class CacheMultiMap
 {
 public:
@@ -25,19 +25,21 @@ public:
 
     typedef CacheItem<K,V> item_t;
 
-    typedef std::list<item_t> list_t;
+    typedef CacheMapPool<item_t, std::pair<const K, std::map<V, void*>>, std::pair<const V, void*>> pool_t;
+
+    typedef std::list<item_t, typename pool_t::template Allocator<item_t>> list_t;
 
     typedef typename list_t::iterator list_it;
 
     typedef typename list_t::const_iterator list_cit;
 
-    typedef std::map<V,list_it> it_map_t;
+    typedef std::map<V, list_it, std::less<V>, typename pool_t::template Allocator<std::pair<const V, list_it>>> it_map_t;
 
     typedef typename it_map_t::iterator it_map_it;
 
     typedef typename it_map_t::const_iterator it_map_cit;
 
-    typedef std::map<K, it_map_t> map_t;
+    typedef std::unordered_map<K, it_map_t, Hasher, std::equal_to<K>, typename pool_t::template Allocator<std::pair<const K, it_map_t>>> map_t;
 
     typedef typename map_t::iterator map_it;
 
@@ -46,6 +48,8 @@ public:
 private:
     size_type nMaxSize;
 
+    typename pool_t::Resource poolResource{pool_t::CHUNK_SIZE};
+
     list_t listItems;
 
     map_t mapIndex;
@@ -53,15 +57,14 @@ private:
 public:
     CacheMultiMap(size_type nMaxSizeIn = 0)
         : nMaxSize(nMaxSizeIn),
-          listItems(),
-          mapIndex()
+          listItems(&poolResource),
+          mapIndex(0, Hasher(), std::equal_to<K>(), &poolResource)
     {}
 
-    CacheMultiMap(const CacheMap<K,V>& other)
-        : nMaxSize(other.nMaxSize),
-          listItems(other.listItems),
-          mapIndex()
+    CacheMultiMap(const CacheMultiMap& other)
+        : CacheMultiMap(other.nMaxSize)
     {
+        listItems.insert(listItems.end(), other.listItems.begin(), other.listItems.end());
         RebuildIndex();
     }
 
@@ -86,10 +89,7 @@ public:
 
     bool Insert(const K& key, const V& value)
     {
-        map_it mit = mapIndex.find(key);
-        if(mit == mapIndex.end()) {
-            mit = mapIndex.emplace(key, it_map_t()).first;
-        }
+        map_it mit = GetOrCreateIndex(key);
         it_map_t& mapIt = mit->second;
 
         if(mapIt.count(value) > 0) {
@@ -184,11 +184,14 @@ public:
         return listItems;
     }
 
-    CacheMap<K,V>& operator=(const CacheMap<K,V>& other)
+    CacheMultiMap& operator=(const CacheMultiMap& other)
     {
-        nMaxSize = other.nMaxSize;
-        listItems = other.listItems;
-        RebuildIndex();
+        if(this != &other) {
+            nMaxSize = other.nMaxSize;
+            Clear();
+            listItems.insert(listItems.end(), other.listItems.begin(), other.listItems.end());
+            RebuildIndex();
+        }
         return *this;
     }
 
@@ -217,22 +220,29 @@ private:
             mapIt.erase(item.value);
 
             if(mapIt.empty()) {
-                mapIndex.erase(item.key);
+                mapIndex.erase(mit);
             }
         }
 
         listItems.pop_back();
     }
 
+    map_it GetOrCreateIndex(const K& key)
+    {
+        map_it mit = mapIndex.find(key);
+        if(mit == mapIndex.end()) {
+            mit = mapIndex.emplace(key, it_map_t(std::less<V>(), &poolResource)).first;
+        }
+        return mit;
+    }
+
     void RebuildIndex()
     {
         mapIndex.clear();
+        mapIndex.reserve(listItems.size());
         for(list_it lit = listItems.begin(); lit != listItems.end(); ++lit) {
             item_t& item = *lit;
-            map_it mit = mapIndex.find(item.key);
-            if(mit == mapIndex.end()) {
-                mit = mapIndex.emplace(item.key, it_map_t()).first;
-            }
+            map_it mit = GetOrCreateIndex(item.key);
             it_map_t& mapIt = mit->second;
             mapIt.emplace(item.value, lit);
         }
@@ -8,6 +8,7 @@
 #include <sync.h>
 #include <tinyformat.h>
 #include <util/threadnames.h>
+#include <util/trace.h>
 
 #include <algorithm>
 #include <vector>
@@ -122,9 +123,11 @@ private:
                 fOk = fAllOk;
             }
             // execute work
+            TRACE2(checkqueue, batch_start, nNow, fMaster);
             for (T& check : vChecks)
                 if (fOk)
                     fOk = check();
+            TRACE3(checkqueue, batch_done, nNow, fMaster, fOk);
             vChecks.clear();
         } while (true);
     }
@@ -59,15 +59,13 @@ void CCoinJoinClientQueueManager::ProcessMessage(CNode* pfrom, const std::string
             if (!lockRecv) return;
 
             // process every dsq only once
-            for (const auto& q : vecCoinJoinQueue) {
-                if (q == dsq) {
-                    return;
-                }
-                if (q.fReady == dsq.fReady && q.masternodeOutpoint == dsq.masternodeOutpoint) {
-                    // no way the same mn can send another dsq with the same readiness this soon
-                    LogPrint(BCLog::COINJOIN, "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n", pfrom->GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+            if (const CCoinJoinQueue* q = FindQueue(dsq.masternodeOutpoint, dsq.fReady)) {
+                if (*q == dsq) {
                     return;
                 }
+                // no way the same mn can send another dsq with the same readiness this soon
+                LogPrint(BCLog::COINJOIN, "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n", pfrom->GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+                return;
             }
         } // cs_vecqueue
 
@@ -115,7 +113,7 @@ void CCoinJoinClientQueueManager::ProcessMessage(CNode* pfrom, const std::string
 
             TRY_LOCK(cs_vecqueue, lockRecv);
             if (!lockRecv) return;
-            vecCoinJoinQueue.push_back(dsq);
+            AddQueue(dsq);
             dsq.Relay(connman);
         }
 
@@ -973,20 +971,21 @@ bool CCoinJoinClientManager::DoAutomaticDenominating(CConnman& connman, bool fDr
         LogPrint(BCLog::COINJOIN, "  vecMasternodesUsed: new size: %d, threshold: %d\n", (int)vecMasternodesUsed.size(), nThreshold_high);
     }
 
+    // These don't depend on the session, so check them once instead of bailing out halfway through the sessions
+    if (!CheckAutomaticBackup()) return false;
+
+    if (WaitForAnotherBlock()) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinClientManager::DoAutomaticDenominating -- Last successful action was too recent\n");
+        strAutoDenomResult = _("Last successful action was too recent.");
+        return false;
+    }
+
     LOCK(cs_deqsessions);
     bool fResult = true;
     if ((int)deqSessions.size() < CCoinJoinClientOptions::GetSessions()) {
         deqSessions.emplace_back(mixingWallet);
     }
     for (auto& session : deqSessions) {
-        if (!CheckAutomaticBackup()) return false;
-
-        if (WaitForAnotherBlock()) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinClientManager::DoAutomaticDenominating -- Last successful action was too recent\n");
-            strAutoDenomResult = _("Last successful action was too recent.");
-            return false;
-        }
-
         fResult &= session.DoAutomaticDenominating(connman, fDryRun);
     }
 
@@ -1042,6 +1041,16 @@ bool CCoinJoinClientSession::JoinExistingQueue(CAmount nBalanceNeedsAnonymized,
 
     auto mnList = deterministicMNManager->GetListAtChainTip();
 
+    // Find out which denominations we can offer once, instead of locking the wallet
+    // for every queue we try below. Only the fact that we have at least one such input
+    // matters here, the actual inputs are selected later in SubmitDenominate.
+    std::set<CAmount> setAmounts;
+    mixingWallet.SelectDenominatedAmounts(MAX_MONEY, setAmounts);
+    if (setAmounts.empty()) {
+        strAutoDenomResult = _("Failed to find mixing queue to join");
+        return false;
+    }
+
     // Look through the queues and see if anything matches
     CCoinJoinQueue dsq;
     while (coinJoinClientQueueManager.GetQueueItemAndTry(dsq)) {
@@ -1064,10 +1073,9 @@ bool CCoinJoinClientSession::JoinExistingQueue(CAmount nBalanceNeedsAnonymized,
 
         LogPrint(BCLog::COINJOIN, "CCoinJoinClientSession::JoinExistingQueue -- trying queue: %s\n", dsq.ToString());
 
-        std::vector<CTxDSIn> vecTxDSInTmp;
-
-        // Try to match their denominations if possible, select exact number of denominations
-        if (!mixingWallet.SelectTxDSInsByDenomination(dsq.nDenom, nBalanceNeedsAnonymized, vecTxDSInTmp)) {
+        // Try to match their denominations if possible
+        CAmount nDenomAmount = CCoinJoin::DenominationToAmount(dsq.nDenom);
+        if (nDenomAmount > nBalanceNeedsAnonymized || !setAmounts.count(nDenomAmount)) {
             LogPrint(BCLog::COINJOIN, "CCoinJoinClientSession::JoinExistingQueue -- Couldn't match denomination %d (%s)\n", dsq.nDenom, CCoinJoin::DenominationToString(dsq.nDenom));
             continue;
         }
@@ -13,6 +13,7 @@
 #include <net_processing.h>
 #include <netmessagemaker.h>
 #include <script/interpreter.h>
+#include <script/sigcache.h>
 #include <shutdown.h>
 #include <txmempool.h>
 #include <util/system.h>
@@ -24,8 +25,23 @@
 
 #include <univalue.h>
 
+#include <algorithm>
+
 CCoinJoinServer coinJoinServer;
 
+/// Consume collateral in cases when peer misbehaved
+static void ConsumeCollateral(CConnman& connman, const CTransactionRef& txref)
+{
+    LOCK(cs_main);
+    CValidationState validationState;
+    if (!AcceptToMemoryPool(mempool, validationState, txref, nullptr /* pfMissingInputs */, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+        LogPrint(BCLog::COINJOIN, "%s -- AcceptToMemoryPool failed\n", __func__);
+    } else {
+        connman.RelayTransaction(*txref);
+        LogPrint(BCLog::COINJOIN, "%s -- Collateral was consumed\n", __func__);
+    }
+}
+
 void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman, bool enable_bip61)
 {
     if (!fMasternodeMode) return;
@@ -43,13 +59,6 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
             return;
         }
 
-        if (IsSessionReady()) {
-            // too many users in this session already, reject new ones
-            LogPrint(BCLog::COINJOIN, "DSACCEPT -- queue is already full!\n");
-            PushStatus(pfrom, STATUS_REJECTED, ERR_QUEUE_FULL, connman);
-            return;
-        }
-
         CCoinJoinAccept dsa;
         vRecv >> dsa;
 
@@ -62,18 +71,34 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
             return;
         }
 
-        if (vecSessionCollaterals.empty()) {
+        LOCK(cs_deqsessions);
+
+        if (GetSessionByParticipant(pfrom->addr)) {
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- peer=%d is already mixing in another session\n", pfrom->GetId());
+            PushStatus(pfrom, STATUS_REJECTED, ERR_MODE, connman);
+            return;
+        }
+
+        // Only one session at a time waits for participants, the ones which are already accepting entries
+        // or signing don't block new sessions
+        CCoinJoinServerSession* pSession = GetQueueingSession();
+        if (pSession && pSession->IsSessionReady()) {
+            // too many users in this session already, reject new ones
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- queue is already full!\n");
+            pSession->PushStatus(pfrom, STATUS_REJECTED, ERR_QUEUE_FULL, connman);
+            return;
+        }
+
+        if (!pSession) {
             {
                 TRY_LOCK(cs_vecqueue, lockRecv);
                 if (!lockRecv) return;
 
-                for (const auto& q : vecCoinJoinQueue) {
-                    if (q.masternodeOutpoint == activeMasternodeInfo.outpoint) {
-                        // refuse to create another queue this often
-                        LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq is still in queue, refuse to mix\n");
-                        PushStatus(pfrom, STATUS_REJECTED, ERR_RECENT, connman);
-                        return;
-                    }
+                if (FindQueue(activeMasternodeInfo.outpoint, false) || FindQueue(activeMasternodeInfo.outpoint, true)) {
+                    // refuse to create another queue this often
+                    LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq is still in queue, refuse to mix\n");
+                    PushStatus(pfrom, STATUS_REJECTED, ERR_RECENT, connman);
+                    return;
                 }
             }
 
@@ -88,19 +113,37 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
                 PushStatus(pfrom, STATUS_REJECTED, ERR_RECENT, connman);
                 return;
             }
+
+            pSession = GetIdleSession();
+            if (!pSession) {
+                LogPrint(BCLog::COINJOIN, "DSACCEPT -- all %d sessions are busy\n", COINJOIN_SERVER_MAX_SESSIONS);
+                PushStatus(pfrom, STATUS_REJECTED, ERR_QUEUE_FULL, connman);
+                return;
+            }
         }
 
         PoolMessage nMessageID = MSG_NOERR;
 
-        bool fResult = nSessionID == 0 ? CreateNewSession(dsa, nMessageID, connman)
-                                       : AddUserToExistingSession(dsa, nMessageID);
+        bool fNewSession = pSession->GetState() == POOL_STATE_IDLE;
+        bool fResult = IsAcceptableDSA(dsa, nMessageID) &&
+                       (fNewSession ? pSession->CreateNewSession(dsa, pfrom->addr, nMessageID)
+                                    : pSession->AddUserToExistingSession(dsa, pfrom->addr, nMessageID));
         if (fResult) {
+            if (fNewSession && !fUnitTest) {
+                //broadcast that I'm accepting entries, only if it's the first entry through
+                CCoinJoinQueue dsq(pSession->nSessionDenom, activeMasternodeInfo.outpoint, GetAdjustedTime(), false);
+                LogPrint(BCLog::COINJOIN, "DSACCEPT -- signing and relaying new queue: %s\n", dsq.ToString());
+                dsq.Sign();
+                dsq.Relay(connman);
+                LOCK(cs_vecqueue);
+                AddQueue(dsq);
+            }
             LogPrint(BCLog::COINJOIN, "DSACCEPT -- is compatible, please submit!\n");
-            PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
+            pSession->PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
             return;
         } else {
             LogPrint(BCLog::COINJOIN, "DSACCEPT -- not compatible with existing transactions!\n");
-            PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
+            pSession->PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
             return;
         }
 
@@ -123,15 +166,13 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
             if (!lockRecv) return;
 
             // process every dsq only once
-            for (const auto& q : vecCoinJoinQueue) {
-                if (q == dsq) {
-                    return;
-                }
-                if (q.fReady == dsq.fReady && q.masternodeOutpoint == dsq.masternodeOutpoint) {
-                    // no way the same mn can send another dsq with the same readiness this soon
-                    LogPrint(BCLog::COINJOIN, "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n", pfrom->GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+            if (const CCoinJoinQueue* q = FindQueue(dsq.masternodeOutpoint, dsq.fReady)) {
+                if (*q == dsq) {
                     return;
                 }
+                // no way the same mn can send another dsq with the same readiness this soon
+                LogPrint(BCLog::COINJOIN, "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n", pfrom->GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+                return;
             }
         } // cs_vecqueue
 
@@ -164,7 +205,7 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
 
             TRY_LOCK(cs_vecqueue, lockRecv);
             if (!lockRecv) return;
-            vecCoinJoinQueue.push_back(dsq);
+            AddQueue(dsq);
             dsq.Relay(connman);
         }
 
@@ -180,10 +221,20 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
             return;
         }
 
+        LOCK(cs_deqsessions);
+
+        // entries carry no session id, clients are only ever part of one session
+        CCoinJoinServerSession* pSession = GetSessionByParticipant(pfrom->addr);
+        if (!pSession) {
+            LogPrint(BCLog::COINJOIN, "DSVIN -- peer=%d is not part of any session\n", pfrom->GetId());
+            PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
+            return;
+        }
+
         //do we have enough users in the current session?
-        if (!IsSessionReady()) {
+        if (!pSession->IsSessionReady()) {
             LogPrint(BCLog::COINJOIN, "DSVIN -- session not complete!\n");
-            PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
+            pSession->PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
             return;
         }
 
@@ -195,12 +246,12 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
         PoolMessage nMessageID = MSG_NOERR;
 
         entry.addr = pfrom->addr;
-        if (AddEntry(connman, entry, nMessageID)) {
-            PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
-            CheckPool(connman);
-            RelayStatus(STATUS_ACCEPTED, connman);
+        if (pSession->AddEntry(connman, entry, nMessageID)) {
+            pSession->PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
+            pSession->CheckPool(connman);
+            pSession->RelayStatus(STATUS_ACCEPTED, connman);
         } else {
-            PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
+            pSession->PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
         }
 
     } else if (strCommand == NetMsgType::DSSIGNFINALTX) {
@@ -219,51 +270,71 @@ void CCoinJoinServer::ProcessMessage(CNode* pfrom, const std::string& strCommand
 
         LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- vecTxIn.size() %s\n", vecTxIn.size());
 
-        int nTxInIndex = 0;
-        int nTxInsCount = (int)vecTxIn.size();
+        LOCK(cs_deqsessions);
 
-        for (const auto& txin : vecTxIn) {
-            nTxInIndex++;
-            if (!AddScriptSig(txin)) {
-                LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- AddScriptSig() failed at %d/%d, session: %d\n", nTxInIndex, nTxInsCount, nSessionID);
-                RelayStatus(STATUS_REJECTED, connman);
-                return;
-            }
-            LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- AddScriptSig() %d/%d success\n", nTxInIndex, nTxInsCount);
+        CCoinJoinServerSession* pSession = GetSessionByParticipant(pfrom->addr);
+        if (!pSession) {
+            LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- peer=%d is not part of any session\n", pfrom->GetId());
+            return;
+        }
+
+        if (pSession->AddScriptSigs(vecTxIn, connman)) {
+            // all is good
+            pSession->CheckPool(connman);
         }
-        // all is good
-        CheckPool(connman);
     }
 }
 
-void CCoinJoinServer::SetNull()
+bool CCoinJoinServerSession::AddScriptSigs(const std::vector<CTxIn>& vecTxIn, CConnman& connman)
+{
+    int nTxInIndex = 0;
+    int nTxInsCount = (int)vecTxIn.size();
+
+    for (const auto& txin : vecTxIn) {
+        nTxInIndex++;
+        if (!AddScriptSig(txin)) {
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- AddScriptSig() failed at %d/%d, session: %d\n", __func__, nTxInIndex, nTxInsCount, nSessionID);
+            RelayStatus(STATUS_REJECTED, connman);
+            return false;
+        }
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- AddScriptSig() %d/%d success\n", __func__, nTxInIndex, nTxInsCount);
+    }
+    return true;
+}
+
+void CCoinJoinServerSession::SetNull()
 {
     // MN side
     vecSessionCollaterals.clear();
+    vecParticipants.clear();
 
     CCoinJoinBaseSession::SetNull();
-    CCoinJoinBaseManager::SetNull();
+}
+
+bool CCoinJoinServerSession::IsParticipant(const CService& addr) const
+{
+    return std::find(vecParticipants.begin(), vecParticipants.end(), addr) != vecParticipants.end();
 }
 
 //
 // Check the mixing progress and send client updates if a Masternode
 //
-void CCoinJoinServer::CheckPool(CConnman& connman)
+void CCoinJoinServerSession::CheckPool(CConnman& connman)
 {
     if (!fMasternodeMode) return;
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckPool -- entries count %lu\n", GetEntriesCount());
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckPool -- entries count %lu\n", GetEntriesCount());
 
     // If we have an entry for each collateral, then create final tx
     if (nState == POOL_STATE_ACCEPTING_ENTRIES && GetEntriesCount() == vecSessionCollaterals.size()) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckPool -- FINALIZE TRANSACTIONS\n");
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckPool -- FINALIZE TRANSACTIONS\n");
         CreateFinalTransaction(connman);
         return;
     }
 
     // Check for Time Out
     // If we timed out while accepting entries, then if we have more than minimum, create final tx
-    if (nState == POOL_STATE_ACCEPTING_ENTRIES && CCoinJoinServer::HasTimedOut()
+    if (nState == POOL_STATE_ACCEPTING_ENTRIES && CCoinJoinServerSession::HasTimedOut()
             && GetEntriesCount() >= CCoinJoin::GetMinPoolParticipants()) {
         // Punish misbehaving participants
         ChargeFees(connman);
@@ -274,15 +345,15 @@ void CCoinJoinServer::CheckPool(CConnman& connman)
 
     // If we have all of the signatures, try to compile the transaction
     if (nState == POOL_STATE_SIGNING && IsSignaturesComplete()) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckPool -- SIGNING\n");
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckPool -- SIGNING\n");
         CommitFinalTransaction(connman);
         return;
     }
 }
 
-void CCoinJoinServer::CreateFinalTransaction(CConnman& connman)
+void CCoinJoinServerSession::CreateFinalTransaction(CConnman& connman)
 {
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateFinalTransaction -- FINALIZE TRANSACTIONS\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- FINALIZE TRANSACTIONS\n");
 
     CMutableTransaction txNew;
 
@@ -300,21 +371,21 @@ void CCoinJoinServer::CreateFinalTransaction(CConnman& connman)
     sort(txNew.vout.begin(), txNew.vout.end(), CompareOutputBIP69());
 
     finalMutableTransaction = txNew;
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateFinalTransaction -- finalMutableTransaction=%s", txNew.ToString()); /* Continued */
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- finalMutableTransaction=%s", txNew.ToString()); /* Continued */
 
     // request signatures from clients
     SetState(POOL_STATE_SIGNING);
     RelayFinalTransaction(finalMutableTransaction, connman);
 }
 
-void CCoinJoinServer::CommitFinalTransaction(CConnman& connman)
+void CCoinJoinServerSession::CommitFinalTransaction(CConnman& connman)
 {
     if (!fMasternodeMode) return; // check and relay final tx only on masternode
 
     CTransactionRef finalTransaction = MakeTransactionRef(finalMutableTransaction);
     uint256 hashTx = finalTransaction->GetHash();
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- finalTransaction=%s", finalTransaction->ToString()); /* Continued */
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- finalTransaction=%s", finalTransaction->ToString()); /* Continued */
 
     {
         // See if the transaction is valid
@@ -322,7 +393,7 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman& connman)
         CValidationState validationState;
         mempool.PrioritiseTransaction(hashTx, 0.1 * COIN);
         if (!lockMain || !AcceptToMemoryPool(mempool, validationState, finalTransaction, nullptr /* pfMissingInputs */, false /* bypass_limits */, maxTxFee /* nAbsurdFee */)) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- AcceptToMemoryPool() error: Transaction not valid\n");
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- AcceptToMemoryPool() error: Transaction not valid\n");
             SetNull();
             // not much we can do in this case, just notify clients
             RelayCompletedTransaction(ERR_INVALID_TX, connman);
@@ -330,16 +401,16 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman& connman)
         }
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- CREATING DSTX\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- CREATING DSTX\n");
 
     // create and sign masternode dstx transaction
-    if (!CCoinJoin::GetDSTX(hashTx)) {
+    if (!CCoinJoin::HasDSTX(hashTx)) {
         CCoinJoinBroadcastTx dstxNew(finalTransaction, activeMasternodeInfo.outpoint, GetAdjustedTime());
         dstxNew.Sign();
         CCoinJoin::AddDSTX(dstxNew);
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- TRANSMITTING DSTX\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- TRANSMITTING DSTX\n");
 
     CInv inv(MSG_DSTX, hashTx);
     connman.RelayInv(inv);
@@ -351,7 +422,7 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman& connman)
     ChargeRandomFees(connman);
 
     // Reset
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- COMPLETED -- RESETTING\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- COMPLETED -- RESETTING\n");
     SetNull();
 }
 
@@ -367,7 +438,7 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman& connman)
 // transaction for the client to be able to enter the pool. This transaction is kept by the Masternode
 // until the transaction is either complete or fails.
 //
-void CCoinJoinServer::ChargeFees(CConnman& connman)
+void CCoinJoinServerSession::ChargeFees(CConnman& connman)
 {
     if (!fMasternodeMode) return;
 
@@ -388,7 +459,7 @@ void CCoinJoinServer::ChargeFees(CConnman& connman)
 
             // This queue entry didn't send us the promised transaction
             if (!fFound) {
-                LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeFees -- found uncooperative node (didn't send transaction), found offence\n");
+                LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeFees -- found uncooperative node (didn't send transaction), found offence\n");
                 vecOffendersCollaterals.push_back(txCollateral);
             }
         }
@@ -399,7 +470,7 @@ void CCoinJoinServer::ChargeFees(CConnman& connman)
         for (const auto& entry : vecEntries) {
             for (const auto& txdsin : entry.vecTxDSIn) {
                 if (!txdsin.fHasSig) {
-                    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeFees -- found uncooperative node (didn't sign), found offence\n");
+                    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeFees -- found uncooperative node (didn't sign), found offence\n");
                     vecOffendersCollaterals.push_back(entry.txCollateral);
                 }
             }
@@ -419,7 +490,7 @@ void CCoinJoinServer::ChargeFees(CConnman& connman)
     Shuffle(vecOffendersCollaterals.begin(), vecOffendersCollaterals.end(), FastRandomContext());
 
     if (nState == POOL_STATE_ACCEPTING_ENTRIES || nState == POOL_STATE_SIGNING) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeFees -- found uncooperative node (didn't %s transaction), charging fees: %s", /* Continued */
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeFees -- found uncooperative node (didn't %s transaction), charging fees: %s", /* Continued */
             (nState == POOL_STATE_SIGNING) ? "sign" : "send", vecOffendersCollaterals[0]->ToString());
         ConsumeCollateral(connman, vecOffendersCollaterals[0]);
     }
@@ -437,30 +508,18 @@ void CCoinJoinServer::ChargeFees(CConnman& connman)
     stop these kinds of attacks 1 in 10 successful transactions are charged. This
     adds up to a cost of 0.001DRK per transaction on average.
 */
-void CCoinJoinServer::ChargeRandomFees(CConnman& connman)
+void CCoinJoinServerSession::ChargeRandomFees(CConnman& connman)
 {
     if (!fMasternodeMode) return;
 
     for (const auto& txCollateral : vecSessionCollaterals) {
         if (GetRandInt(100) > 10) return;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeRandomFees -- charging random fees, txCollateral=%s", txCollateral->ToString()); /* Continued */
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeRandomFees -- charging random fees, txCollateral=%s", txCollateral->ToString()); /* Continued */
         ConsumeCollateral(connman, txCollateral);
     }
 }
 
-void CCoinJoinServer::ConsumeCollateral(CConnman& connman, const CTransactionRef& txref)
-{
-    LOCK(cs_main);
-    CValidationState validationState;
-    if (!AcceptToMemoryPool(mempool, validationState, txref, nullptr /* pfMissingInputs */, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
-        LogPrint(BCLog::COINJOIN, "%s -- AcceptToMemoryPool failed\n", __func__);
-    } else {
-        connman.RelayTransaction(*txref);
-        LogPrint(BCLog::COINJOIN, "%s -- Collateral was consumed\n", __func__);
-    }
-}
-
-bool CCoinJoinServer::HasTimedOut()
+bool CCoinJoinServerSession::HasTimedOut()
 {
     if (!fMasternodeMode) return false;
 
@@ -474,16 +533,14 @@ bool CCoinJoinServer::HasTimedOut()
 //
 // Check for extraneous timeout
 //
-void CCoinJoinServer::CheckTimeout(CConnman& connman)
+void CCoinJoinServerSession::CheckTimeout(CConnman& connman)
 {
     if (!fMasternodeMode) return;
 
-    CheckQueue();
-
     // Too early to do anything
-    if (!CCoinJoinServer::HasTimedOut()) return;
+    if (!CCoinJoinServerSession::HasTimedOut()) return;
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckTimeout -- %s timed out -- resetting\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckTimeout -- %s timed out -- resetting\n",
         (nState == POOL_STATE_SIGNING) ? "Signing" : "Session");
     ChargeFees(connman);
     SetNull();
@@ -494,7 +551,7 @@ void CCoinJoinServer::CheckTimeout(CConnman& connman)
     After receiving multiple dsa messages, the queue will switch to "accepting entries"
     which is the active state right before merging the transaction
 */
-void CCoinJoinServer::CheckForCompleteQueue(CConnman& connman)
+void CCoinJoinServerSession::CheckForCompleteQueue(CConnman& connman)
 {
     if (!fMasternodeMode) return;
 
@@ -502,7 +559,7 @@ void CCoinJoinServer::CheckForCompleteQueue(CConnman& connman)
         SetState(POOL_STATE_ACCEPTING_ENTRIES);
 
         CCoinJoinQueue dsq(nSessionDenom, activeMasternodeInfo.outpoint, GetAdjustedTime(), true);
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckForCompleteQueue -- queue is ready, signing and relaying (%s) " /* Continued */
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckForCompleteQueue -- queue is ready, signing and relaying (%s) " /* Continued */
                                      "with %d participants\n", dsq.ToString(), vecSessionCollaterals.size());
         dsq.Sign();
         dsq.Relay(connman);
@@ -510,69 +567,67 @@ void CCoinJoinServer::CheckForCompleteQueue(CConnman& connman)
 }
 
 // Check to make sure a given input matches an input in the pool and its scriptSig is valid
-bool CCoinJoinServer::IsInputScriptSigValid(const CTxIn& txin)
+bool CCoinJoinServerSession::IsInputScriptSigValid(const CTxIn& txin)
 {
-    CMutableTransaction txNew;
-    txNew.vin.clear();
-    txNew.vout.clear();
-
-    int i = 0;
     int nTxInIndex = -1;
     CScript sigPubKey = CScript();
 
-    for (const auto& entry : vecEntries) {
-        for (const auto& txout : entry.vecTxOut) {
-            txNew.vout.push_back(txout);
+    // Clients sign finalMutableTransaction, so that's what we verify against
+    for (size_t i = 0; i < finalMutableTransaction.vin.size(); i++) {
+        if (finalMutableTransaction.vin[i].prevout == txin.prevout) {
+            nTxInIndex = i;
+            break;
         }
+    }
+    for (const auto& entry : vecEntries) {
         for (const auto& txdsin : entry.vecTxDSIn) {
-            txNew.vin.push_back(txdsin);
-
             if (txdsin.prevout == txin.prevout) {
-                nTxInIndex = i;
                 sigPubKey = txdsin.prevPubKey;
             }
-            i++;
         }
     }
 
-    if (nTxInIndex >= 0) { //might have to do this one input at a time?
-        txNew.vin[nTxInIndex].scriptSig = txin.scriptSig;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0, 24));
+    if (nTxInIndex >= 0 && !sigPubKey.empty()) {
+        // Other inputs' scriptSigs are not part of the signature hash, so it doesn't matter that some are still missing.
+        // Verify through the signature cache, AcceptToMemoryPool in CommitFinalTransaction can then skip the ECDSA checks.
+        const CTransaction txFinal(finalMutableTransaction);
+        PrecomputedTransactionData txdata(txFinal);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0, 24));
         // TODO we're using amount=0 here but we should use the correct amount. This works because Dash ignores the amount while signing/verifying (only used in Bitcoin/Segwit)
-        if (!VerifyScript(txNew.vin[nTxInIndex].scriptSig, sigPubKey, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, MutableTransactionSignatureChecker(&txNew, nTxInIndex, 0))) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
+        if (!VerifyScript(txin.scriptSig, sigPubKey, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, CachingTransactionSignatureChecker(&txFinal, nTxInIndex, 0, txdata))) {
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
             return false;
         }
     } else {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- Failed to find matching input in pool, %s\n", txin.ToString());
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- Failed to find matching input in pool, %s\n", txin.ToString());
         return false;
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- Successfully validated input and scriptSig\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- Successfully validated input and scriptSig\n");
     return true;
 }
 
 //
 // Add a client's transaction inputs/outputs to the pool
 //
-bool CCoinJoinServer::AddEntry(CConnman& connman, const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::AddEntry(CConnman& connman, const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet)
 {
     if (!fMasternodeMode) return false;
 
     if (GetEntriesCount() >= vecSessionCollaterals.size()) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: entries is full!\n", __func__);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: entries is full!\n", __func__);
         nMessageIDRet = ERR_ENTRIES_FULL;
         return false;
     }
 
     if (!CCoinJoin::IsCollateralValid(*entry.txCollateral)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: collateral not valid!\n", __func__);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: collateral not valid!\n", __func__);
         nMessageIDRet = ERR_INVALID_COLLATERAL;
         return false;
     }
 
     if (entry.vecTxDSIn.size() > COINJOIN_ENTRY_MAX_SIZE) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: too many inputs! %d/%d\n", __func__, entry.vecTxDSIn.size(), COINJOIN_ENTRY_MAX_SIZE);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: too many inputs! %d/%d\n", __func__, entry.vecTxDSIn.size(), COINJOIN_ENTRY_MAX_SIZE);
         nMessageIDRet = ERR_MAXIMUM;
         ConsumeCollateral(connman, entry.txCollateral);
         return false;
@@ -580,12 +635,12 @@ bool CCoinJoinServer::AddEntry(CConnman& connman, const CCoinJoinEntry& entry, P
 
     std::vector<CTxIn> vin;
     for (const auto& txin : entry.vecTxDSIn) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- txin=%s\n", __func__, txin.ToString());
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- txin=%s\n", __func__, txin.ToString());
 
         for (const auto& entry : vecEntries) {
             for (const auto& txdsin : entry.vecTxDSIn) {
                 if (txdsin.prevout == txin.prevout) {
-                    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: already have this txin in entries\n", __func__);
+                    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: already have this txin in entries\n", __func__);
                     nMessageIDRet = ERR_ALREADY_HAVE;
                     // Two peers sent the same input? Can't really say who is the malicious one here,
                     // could be that someone is picking someone else's inputs randomly trying to force
@@ -599,7 +654,7 @@ bool CCoinJoinServer::AddEntry(CConnman& connman, const CCoinJoinEntry& entry, P
 
     bool fConsumeCollateral{false};
     if (!IsValidInOuts(vin, entry.vecTxOut, nMessageIDRet, &fConsumeCollateral)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR! IsValidInOuts() failed: %s\n", __func__, CCoinJoin::GetMessageByID(nMessageIDRet));
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR! IsValidInOuts() failed: %s\n", __func__, CCoinJoin::GetMessageByID(nMessageIDRet));
         if (fConsumeCollateral) {
             ConsumeCollateral(connman, entry.txCollateral);
         }
@@ -608,51 +663,51 @@ bool CCoinJoinServer::AddEntry(CConnman& connman, const CCoinJoinEntry& entry, P
 
     vecEntries.push_back(entry);
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- adding entry %d of %d required\n", __func__, GetEntriesCount(), CCoinJoin::GetMaxPoolParticipants());
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- adding entry %d of %d required\n", __func__, GetEntriesCount(), CCoinJoin::GetMaxPoolParticipants());
     nMessageIDRet = MSG_ENTRIES_ADDED;
 
     return true;
 }
 
-bool CCoinJoinServer::AddScriptSig(const CTxIn& txinNew)
+bool CCoinJoinServerSession::AddScriptSig(const CTxIn& txinNew)
 {
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
 
     for (const auto& entry : vecEntries) {
         for (const auto& txdsin : entry.vecTxDSIn) {
             if (txdsin.scriptSig == txinNew.scriptSig) {
-                LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- already exists\n");
+                LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- already exists\n");
                 return false;
             }
         }
     }
 
     if (!IsInputScriptSigValid(txinNew)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- Invalid scriptSig\n");
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- Invalid scriptSig\n");
         return false;
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- scriptSig=%s new\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- scriptSig=%s new\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
 
     for (auto& txin : finalMutableTransaction.vin) {
         if (txin.prevout == txinNew.prevout && txin.nSequence == txinNew.nSequence) {
             txin.scriptSig = txinNew.scriptSig;
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- adding to finalMutableTransaction, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- adding to finalMutableTransaction, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
         }
     }
     for (int i = 0; i < GetEntriesCount(); i++) {
         if (vecEntries[i].AddScriptSig(txinNew)) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- adding to entries, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- adding to entries, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
             return true;
         }
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- Couldn't set sig!\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- Couldn't set sig!\n");
     return false;
 }
 
 // Check to make sure everything is signed
-bool CCoinJoinServer::IsSignaturesComplete()
+bool CCoinJoinServerSession::IsSignaturesComplete()
 {
     for (const auto& entry : vecEntries) {
         for (const auto& txdsin : entry.vecTxDSIn) {
@@ -663,39 +718,14 @@ bool CCoinJoinServer::IsSignaturesComplete()
     return true;
 }
 
-bool CCoinJoinServer::IsAcceptableDSA(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet)
-{
-    if (!fMasternodeMode) return false;
-
-    // is denom even something legit?
-    if (!CCoinJoin::IsValidDenomination(dsa.nDenom)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- denom not valid!\n", __func__);
-        nMessageIDRet = ERR_DENOM;
-        return false;
-    }
-
-    // check collateral
-    if (!fUnitTest && !CCoinJoin::IsCollateralValid(dsa.txCollateral)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- collateral not valid!\n", __func__);
-        nMessageIDRet = ERR_INVALID_COLLATERAL;
-        return false;
-    }
-
-    return true;
-}
-
-bool CCoinJoinServer::CreateNewSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet, CConnman& connman)
+bool CCoinJoinServerSession::CreateNewSession(const CCoinJoinAccept& dsa, const CService& addr, PoolMessage& nMessageIDRet)
 {
     if (!fMasternodeMode || nSessionID != 0) return false;
 
     // new session can only be started in idle mode
     if (nState != POOL_STATE_IDLE) {
         nMessageIDRet = ERR_MODE;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateNewSession -- incompatible mode: nState=%d\n", nState);
-        return false;
-    }
-
-    if (!IsAcceptableDSA(dsa, nMessageIDRet)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CreateNewSession -- incompatible mode: nState=%d\n", nState);
         return false;
     }
 
@@ -706,39 +736,27 @@ bool CCoinJoinServer::CreateNewSession(const CCoinJoinAccept& dsa, PoolMessage&
 
     SetState(POOL_STATE_QUEUE);
 
-    if (!fUnitTest) {
-        //broadcast that I'm accepting entries, only if it's the first entry through
-        CCoinJoinQueue dsq(nSessionDenom, activeMasternodeInfo.outpoint, GetAdjustedTime(), false);
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateNewSession -- signing and relaying new queue: %s\n", dsq.ToString());
-        dsq.Sign();
-        dsq.Relay(connman);
-        vecCoinJoinQueue.push_back(dsq);
-    }
-
     vecSessionCollaterals.push_back(MakeTransactionRef(dsa.txCollateral));
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateNewSession -- new session created, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CCoinJoin::GetMaxPoolParticipants(): %d\n",
+    vecParticipants.push_back(addr);
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CreateNewSession -- new session created, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CCoinJoin::GetMaxPoolParticipants(): %d\n",
         nSessionID, nSessionDenom, CCoinJoin::DenominationToString(nSessionDenom), vecSessionCollaterals.size(), CCoinJoin::GetMaxPoolParticipants());
 
     return true;
 }
 
-bool CCoinJoinServer::AddUserToExistingSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::AddUserToExistingSession(const CCoinJoinAccept& dsa, const CService& addr, PoolMessage& nMessageIDRet)
 {
     if (!fMasternodeMode || nSessionID == 0 || IsSessionReady()) return false;
 
-    if (!IsAcceptableDSA(dsa, nMessageIDRet)) {
-        return false;
-    }
-
     // we only add new users to an existing session when we are in queue mode
     if (nState != POOL_STATE_QUEUE) {
         nMessageIDRet = ERR_MODE;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddUserToExistingSession -- incompatible mode: nState=%d\n", nState);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddUserToExistingSession -- incompatible mode: nState=%d\n", nState);
         return false;
     }
 
     if (dsa.nDenom != nSessionDenom) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddUserToExistingSession -- incompatible denom %d (%s) != nSessionDenom %d (%s)\n",
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddUserToExistingSession -- incompatible denom %d (%s) != nSessionDenom %d (%s)\n",
             dsa.nDenom, CCoinJoin::DenominationToString(dsa.nDenom), nSessionDenom, CCoinJoin::DenominationToString(nSessionDenom));
         nMessageIDRet = ERR_DENOM;
         return false;
@@ -748,21 +766,22 @@ bool CCoinJoinServer::AddUserToExistingSession(const CCoinJoinAccept& dsa, PoolM
 
     nMessageIDRet = MSG_NOERR;
     vecSessionCollaterals.push_back(MakeTransactionRef(dsa.txCollateral));
+    vecParticipants.push_back(addr);
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddUserToExistingSession -- new user accepted, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CCoinJoin::GetMaxPoolParticipants(): %d\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddUserToExistingSession -- new user accepted, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CCoinJoin::GetMaxPoolParticipants(): %d\n",
         nSessionID, nSessionDenom, CCoinJoin::DenominationToString(nSessionDenom), vecSessionCollaterals.size(), CCoinJoin::GetMaxPoolParticipants());
 
     return true;
 }
 
 // Returns true if either max size has been reached or if the mix timed out and min size was reached
-bool CCoinJoinServer::IsSessionReady()
+bool CCoinJoinServerSession::IsSessionReady()
 {
     if (nState == POOL_STATE_QUEUE) {
         if ((int)vecSessionCollaterals.size() >= CCoinJoin::GetMaxPoolParticipants()) {
             return true;
         }
-        if (CCoinJoinServer::HasTimedOut() && (int)vecSessionCollaterals.size() >= CCoinJoin::GetMinPoolParticipants()) {
+        if (CCoinJoinServerSession::HasTimedOut() && (int)vecSessionCollaterals.size() >= CCoinJoin::GetMinPoolParticipants()) {
             return true;
         }
     }
@@ -772,9 +791,9 @@ bool CCoinJoinServer::IsSessionReady()
     return false;
 }
 
-void CCoinJoinServer::RelayFinalTransaction(const CTransaction& txFinal, CConnman& connman)
+void CCoinJoinServerSession::RelayFinalTransaction(const CTransaction& txFinal, CConnman& connman)
 {
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
         __func__, nSessionID, nSessionDenom, CCoinJoin::DenominationToString(nSessionDenom));
 
     // final mixing tx with empty signatures should be relayed to mixing participants only
@@ -792,14 +811,14 @@ void CCoinJoinServer::RelayFinalTransaction(const CTransaction& txFinal, CConnma
     }
 }
 
-void CCoinJoinServer::PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman& connman)
+void CCoinJoinServerSession::PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman& connman)
 {
     if (!pnode) return;
     CCoinJoinStatusUpdate psssup(nSessionID, nState, 0, nStatusUpdate, nMessageID);
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::DSSTATUSUPDATE, psssup));
 }
 
-void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman& connman, PoolMessage nMessageID)
+void CCoinJoinServerSession::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman& connman, PoolMessage nMessageID)
 {
     unsigned int nDisconnected{};
     // status updates should be relayed to mixing participants only
@@ -817,7 +836,7 @@ void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman& conn
     if (nDisconnected == 0) return; // all is clear
 
     // something went wrong
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- can't continue, %llu client(s) disconnected, nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- can't continue, %llu client(s) disconnected, nSessionID: %d  nSessionDenom: %d (%s)\n",
         __func__, nDisconnected, nSessionID, nSessionDenom, CCoinJoin::DenominationToString(nSessionDenom));
 
     // notify everyone else that this session should be terminated
@@ -835,9 +854,9 @@ void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman& conn
     }
 }
 
-void CCoinJoinServer::RelayCompletedTransaction(PoolMessage nMessageID, CConnman& connman)
+void CCoinJoinServerSession::RelayCompletedTransaction(PoolMessage nMessageID, CConnman& connman)
 {
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
         __func__, nSessionID, nSessionDenom, CCoinJoin::DenominationToString(nSessionDenom));
 
     // final mixing tx with empty signatures should be relayed to mixing participants only
@@ -855,37 +874,144 @@ void CCoinJoinServer::RelayCompletedTransaction(PoolMessage nMessageID, CConnman
     }
 }
 
-void CCoinJoinServer::SetState(PoolState nStateNew)
+void CCoinJoinServerSession::SetState(PoolState nStateNew)
 {
     if (!fMasternodeMode) return;
 
     if (nStateNew == POOL_STATE_ERROR) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::SetState -- Can't set state to ERROR as a Masternode. \n");
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::SetState -- Can't set state to ERROR as a Masternode. \n");
         return;
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::SetState -- nState: %d, nStateNew: %d\n", nState, nStateNew);
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::SetState -- nState: %d, nStateNew: %d\n", nState, nStateNew);
     nTimeLastSuccessfulStep = GetTime();
     nState = nStateNew;
 }
 
+void CCoinJoinServerSession::GetJsonInfo(UniValue& obj) const
+{
+    obj.clear();
+    obj.setObject();
+    obj.pushKV("session_id",    nSessionID);
+    obj.pushKV("denomination",  ValueFromAmount(CCoinJoin::DenominationToAmount(nSessionDenom)));
+    obj.pushKV("state",         GetStateString());
+    obj.pushKV("participants",  (int)vecSessionCollaterals.size());
+    obj.pushKV("entries_count", GetEntriesCount());
+}
+
+bool CCoinJoinServer::IsAcceptableDSA(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet)
+{
+    if (!fMasternodeMode) return false;
+
+    // is denom even something legit?
+    if (!CCoinJoin::IsValidDenomination(dsa.nDenom)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- denom not valid!\n", __func__);
+        nMessageIDRet = ERR_DENOM;
+        return false;
+    }
+
+    // check collateral
+    if (!fUnitTest && !CCoinJoin::IsCollateralValid(dsa.txCollateral)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- collateral not valid!\n", __func__);
+        nMessageIDRet = ERR_INVALID_COLLATERAL;
+        return false;
+    }
+
+    return true;
+}
+
+CCoinJoinServerSession* CCoinJoinServer::GetSessionByParticipant(const CService& addr)
+{
+    for (auto& session : deqSessions) {
+        if (session.GetState() != POOL_STATE_IDLE && session.IsParticipant(addr)) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+CCoinJoinServerSession* CCoinJoinServer::GetQueueingSession()
+{
+    for (auto& session : deqSessions) {
+        if (session.GetState() == POOL_STATE_QUEUE) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+CCoinJoinServerSession* CCoinJoinServer::GetIdleSession()
+{
+    for (auto& session : deqSessions) {
+        if (session.GetState() == POOL_STATE_IDLE) {
+            return &session;
+        }
+    }
+    if ((int)deqSessions.size() >= COINJOIN_SERVER_MAX_SESSIONS) {
+        return nullptr;
+    }
+    deqSessions.emplace_back();
+    return &deqSessions.back();
+}
+
+void CCoinJoinServer::PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman& connman)
+{
+    if (!pnode) return;
+    CCoinJoinStatusUpdate psssup(0, POOL_STATE_IDLE, 0, nStatusUpdate, nMessageID);
+    connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::DSSTATUSUPDATE, psssup));
+}
+
+void CCoinJoinServer::CheckTimeout(CConnman& connman)
+{
+    if (!fMasternodeMode) return;
+
+    CheckQueue();
+
+    LOCK(cs_deqsessions);
+    for (auto& session : deqSessions) {
+        session.CheckTimeout(connman);
+    }
+}
+
 void CCoinJoinServer::DoMaintenance(CConnman& connman)
 {
     if (!fMasternodeMode) return; // only run on masternodes
 
     if (!masternodeSync.IsBlockchainSynced() || ShutdownRequested()) return;
 
-    coinJoinServer.CheckForCompleteQueue(connman);
-    coinJoinServer.CheckPool(connman);
-    coinJoinServer.CheckTimeout(connman);
+    {
+        LOCK(cs_deqsessions);
+        for (auto& session : deqSessions) {
+            session.CheckForCompleteQueue(connman);
+            session.CheckPool(connman);
+        }
+    }
+    CheckTimeout(connman);
 }
 
 void CCoinJoinServer::GetJsonInfo(UniValue& obj) const
 {
+    LOCK(cs_deqsessions);
+
+    // the fields of the first active session are kept at the top level for compatibility
+    const CCoinJoinServerSession sessionIdle;
+    const CCoinJoinServerSession* pSessionFirst = &sessionIdle;
+    UniValue arrSessions(UniValue::VARR);
+    for (const auto& session : deqSessions) {
+        if (session.GetState() == POOL_STATE_IDLE) continue;
+        if (arrSessions.empty()) {
+            pSessionFirst = &session;
+        }
+        UniValue objSession;
+        session.GetJsonInfo(objSession);
+        arrSessions.push_back(objSession);
+    }
+
     obj.clear();
     obj.setObject();
     obj.pushKV("queue_size",    GetQueueSize());
-    obj.pushKV("denomination",  ValueFromAmount(CCoinJoin::DenominationToAmount(nSessionDenom)));
-    obj.pushKV("state",         GetStateString());
-    obj.pushKV("entries_count", GetEntriesCount());
+    obj.pushKV("denomination",  ValueFromAmount(CCoinJoin::DenominationToAmount(pSessionFirst->nSessionDenom)));
+    obj.pushKV("state",         pSessionFirst->GetStateString());
+    obj.pushKV("entries_count", pSessionFirst->GetEntriesCount());
+    obj.pushKV("sessions",      arrSessions);
 }
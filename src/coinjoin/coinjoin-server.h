@@ -8,25 +8,28 @@
 #include <coinjoin/coinjoin.h>
 #include <net.h>
 
+#include <deque>
+
 class CCoinJoinServer;
 class UniValue;
 
 // The main object for accessing mixing
 extern CCoinJoinServer coinJoinServer;
 
-/** Used to keep track of current status of mixing pool
+//! How many mixing sessions a masternode runs at the same time
+static const int COINJOIN_SERVER_MAX_SESSIONS = 4;
+
+/** A single mixing session run by this masternode, with its own participants, entries, timeouts and final tx
  */
-class CCoinJoinServer : public CCoinJoinBaseSession, public CCoinJoinBaseManager
+class CCoinJoinServerSession : public CCoinJoinBaseSession
 {
 private:
     // Mixing uses collateral transactions to trust parties entering the pool
     // to behave honestly. If they don't it takes their money.
     std::vector<CTransactionRef> vecSessionCollaterals;
+    // Clients which joined this session through dsa, their later messages are routed to this session by address
+    std::vector<CService> vecParticipants;
 
-    bool fUnitTest;
-
-    /// Add a clients entry to the pool
-    bool AddEntry(CConnman& connman, const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet);
     /// Add signature to a txin
     bool AddScriptSig(const CTxIn& txin);
 
@@ -34,22 +37,10 @@ private:
     void ChargeFees(CConnman& connman);
     /// Rarely charge fees to pay miners
     void ChargeRandomFees(CConnman& connman);
-    /// Consume collateral in cases when peer misbehaved
-    void ConsumeCollateral(CConnman& connman, const CTransactionRef& txref);
-
-    /// Check for process
-    void CheckPool(CConnman& connman);
 
     void CreateFinalTransaction(CConnman& connman);
     void CommitFinalTransaction(CConnman& connman);
 
-    /// Is this nDenom and txCollateral acceptable?
-    bool IsAcceptableDSA(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet);
-    bool CreateNewSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet, CConnman& connman);
-    bool AddUserToExistingSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet);
-    /// Do we have enough users to take entries?
-    bool IsSessionReady();
-
     /// Check that all inputs are signed. (Are all inputs signed?)
     bool IsSignaturesComplete();
     /// Check to make sure a given input matches an input in the pool and its scriptSig is valid
@@ -60,22 +51,70 @@ private:
 
     /// Relay mixing Messages
     void RelayFinalTransaction(const CTransaction& txFinal, CConnman& connman);
+    void RelayCompletedTransaction(PoolMessage nMessageID, CConnman& connman);
+
+public:
+    CCoinJoinServerSession() :
+        vecSessionCollaterals(),
+        vecParticipants() {}
+
+    bool IsParticipant(const CService& addr) const;
+
+    bool CreateNewSession(const CCoinJoinAccept& dsa, const CService& addr, PoolMessage& nMessageIDRet);
+    bool AddUserToExistingSession(const CCoinJoinAccept& dsa, const CService& addr, PoolMessage& nMessageIDRet);
+    /// Do we have enough users to take entries?
+    bool IsSessionReady();
+
+    /// Add a clients entry to the pool
+    bool AddEntry(CConnman& connman, const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet);
+    /// Add the signatures of a client to the final transaction, fails if any of them is invalid
+    bool AddScriptSigs(const std::vector<CTxIn>& vecTxIn, CConnman& connman);
+
+    /// Check for process
+    void CheckPool(CConnman& connman);
+    bool HasTimedOut();
+    void CheckTimeout(CConnman& connman);
+    void CheckForCompleteQueue(CConnman& connman);
+
     void PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman& connman);
     void RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman& connman, PoolMessage nMessageID = MSG_NOERR);
-    void RelayCompletedTransaction(PoolMessage nMessageID, CConnman& connman);
 
     void SetNull();
 
+    void GetJsonInfo(UniValue& obj) const;
+};
+
+/** Used to keep track of the mixing sessions of this masternode and of the queues on the network
+ */
+class CCoinJoinServer : public CCoinJoinBaseManager
+{
+private:
+    // Session slots, idle ones are reused for new sessions
+    std::deque<CCoinJoinServerSession> deqSessions GUARDED_BY(cs_deqsessions);
+    mutable CCriticalSection cs_deqsessions;
+
+    bool fUnitTest;
+
+    /// Is this nDenom and txCollateral acceptable?
+    bool IsAcceptableDSA(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet);
+
+    CCoinJoinServerSession* GetSessionByParticipant(const CService& addr) EXCLUSIVE_LOCKS_REQUIRED(cs_deqsessions);
+    /// The session which is announced on the network and still waits for participants, there is at most one
+    CCoinJoinServerSession* GetQueueingSession() EXCLUSIVE_LOCKS_REQUIRED(cs_deqsessions);
+    /// An idle session slot, nullptr if all COINJOIN_SERVER_MAX_SESSIONS are busy
+    CCoinJoinServerSession* GetIdleSession() EXCLUSIVE_LOCKS_REQUIRED(cs_deqsessions);
+
+    /// Status for clients which aren't part of any session
+    static void PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman& connman);
+
 public:
     CCoinJoinServer() :
-        vecSessionCollaterals(),
+        deqSessions(),
         fUnitTest(false) {}
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman, bool enable_bip61);
 
-    bool HasTimedOut();
     void CheckTimeout(CConnman& connman);
-    void CheckForCompleteQueue(CConnman& connman);
 
     void DoMaintenance(CConnman& connman);
 
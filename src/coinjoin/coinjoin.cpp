@@ -10,7 +10,9 @@
 #include <messagesigner.h>
 #include <netmessagemaker.h>
 #include <script/sign.h>
+#include <memusage.h>
 #include <txmempool.h>
+#include <util/memaccounting.h>
 #include <util/system.h>
 #include <util/moneystr.h>
 #include <validation.h>
@@ -159,10 +161,34 @@ void CCoinJoinBaseSession::SetNull()
     nTimeLastSuccessfulStep = GetTime();
 }
 
+CCoinJoinBaseManager::CCoinJoinBaseManager() :
+    vecCoinJoinQueue(),
+    mapQueueByMasternode(),
+    nFirstUntriedQueue(0),
+    nNextQueueTimeout(std::numeric_limits<int64_t>::max())
+{
+    memaccounting::Register("coinjoin.queue", this, [this]() {
+        LOCK(cs_vecqueue);
+        size_t nUsage = memusage::DynamicUsage(vecCoinJoinQueue) + memusage::DynamicUsage(mapQueueByMasternode);
+        for (const auto& dsq : vecCoinJoinQueue) {
+            nUsage += memusage::DynamicUsage(dsq.vchSig);
+        }
+        return nUsage;
+    });
+}
+
+CCoinJoinBaseManager::~CCoinJoinBaseManager()
+{
+    memaccounting::Unregister(this);
+}
+
 void CCoinJoinBaseManager::SetNull()
 {
     LOCK(cs_vecqueue);
     vecCoinJoinQueue.clear();
+    mapQueueByMasternode.clear();
+    nFirstUntriedQueue = 0;
+    nNextQueueTimeout = std::numeric_limits<int64_t>::max();
 }
 
 void CCoinJoinBaseManager::CheckQueue()
@@ -170,16 +196,47 @@ void CCoinJoinBaseManager::CheckQueue()
     TRY_LOCK(cs_vecqueue, lockDS);
     if (!lockDS) return; // it's ok to fail here, we run this quite frequently
 
+    // queues only get in here while they are within bounds, so nothing can time out before the oldest one does
+    if (GetAdjustedTime() <= nNextQueueTimeout) return;
+
     // check mixing queue objects for timeouts
-    auto it = vecCoinJoinQueue.begin();
-    while (it != vecCoinJoinQueue.end()) {
-        if ((*it).IsTimeOutOfBounds()) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinBaseManager::%s -- Removing a queue (%s)\n", __func__, (*it).ToString());
-            it = vecCoinJoinQueue.erase(it);
+    std::vector<CCoinJoinQueue> vecQueueTmp;
+    vecQueueTmp.reserve(vecCoinJoinQueue.size());
+    for (const auto& dsq : vecCoinJoinQueue) {
+        if (dsq.IsTimeOutOfBounds()) {
+            LogPrint(BCLog::COINJOIN, "CCoinJoinBaseManager::%s -- Removing a queue (%s)\n", __func__, dsq.ToString());
         } else {
-            ++it;
+            vecQueueTmp.emplace_back(dsq);
         }
     }
+
+    vecCoinJoinQueue.clear();
+    mapQueueByMasternode.clear();
+    nFirstUntriedQueue = 0;
+    nNextQueueTimeout = std::numeric_limits<int64_t>::max();
+    for (const auto& dsq : vecQueueTmp) {
+        AddQueue(dsq);
+    }
+}
+
+void CCoinJoinBaseManager::AddQueue(const CCoinJoinQueue& dsq)
+{
+    AssertLockHeld(cs_vecqueue);
+
+    mapQueueByMasternode[std::make_pair(dsq.masternodeOutpoint, dsq.fReady)] = vecCoinJoinQueue.size();
+    nNextQueueTimeout = std::min(nNextQueueTimeout, dsq.nTime + COINJOIN_QUEUE_TIMEOUT);
+    vecCoinJoinQueue.emplace_back(dsq);
+}
+
+const CCoinJoinQueue* CCoinJoinBaseManager::FindQueue(const COutPoint& masternodeOutpoint, bool fReady) const
+{
+    AssertLockHeld(cs_vecqueue);
+
+    auto it = mapQueueByMasternode.find(std::make_pair(masternodeOutpoint, fReady));
+    if (it == mapQueueByMasternode.end()) {
+        return nullptr;
+    }
+    return &vecCoinJoinQueue[it->second];
 }
 
 bool CCoinJoinBaseManager::GetQueueItemAndTry(CCoinJoinQueue& dsqRet)
@@ -187,11 +244,14 @@ bool CCoinJoinBaseManager::GetQueueItemAndTry(CCoinJoinQueue& dsqRet)
     TRY_LOCK(cs_vecqueue, lockDS);
     if (!lockDS) return false; // it's ok to fail here, we run this quite frequently
 
-    for (auto& dsq : vecCoinJoinQueue) {
+    // queues which are out of bounds can't come back, so it's fine to move past them too
+    for (; nFirstUntriedQueue < vecCoinJoinQueue.size(); ++nFirstUntriedQueue) {
+        auto& dsq = vecCoinJoinQueue[nFirstUntriedQueue];
         // only try each queue once
         if (dsq.fTried || dsq.IsTimeOutOfBounds()) continue;
         dsq.fTried = true;
         dsqRet = dsq;
+        ++nFirstUntriedQueue;
         return true;
     }
 
@@ -305,6 +365,7 @@ bool CCoinJoinBaseSession::IsValidInOuts(const std::vector<CTxIn>& vin, const st
 // Definitions for static data members
 std::vector<CAmount> CCoinJoin::vecStandardDenominations;
 std::map<uint256, CCoinJoinBroadcastTx> CCoinJoin::mapDSTX;
+std::set<std::pair<int, uint256>> CCoinJoin::setDSTXByHeight;
 CCriticalSection CCoinJoin::cs_mapdstx;
 
 void CCoinJoin::InitStandardDenominations()
@@ -541,7 +602,10 @@ std::string CCoinJoin::GetMessageByID(PoolMessage nMessageID)
 void CCoinJoin::AddDSTX(const CCoinJoinBroadcastTx& dstx)
 {
     LOCK(cs_mapdstx);
-    mapDSTX.insert(std::make_pair(dstx.tx->GetHash(), dstx));
+    auto p = mapDSTX.emplace(dstx.tx->GetHash(), dstx);
+    if (p.second && dstx.GetConfirmedHeight() != -1) {
+        setDSTXByHeight.emplace(dstx.GetConfirmedHeight(), dstx.tx->GetHash());
+    }
 }
 
 CCoinJoinBroadcastTx CCoinJoin::GetDSTX(const uint256& hash)
@@ -551,16 +615,28 @@ CCoinJoinBroadcastTx CCoinJoin::GetDSTX(const uint256& hash)
     return (it == mapDSTX.end()) ? CCoinJoinBroadcastTx() : it->second;
 }
 
+bool CCoinJoin::HasDSTX(const uint256& hash)
+{
+    LOCK(cs_mapdstx);
+    return mapDSTX.count(hash) != 0;
+}
+
 void CCoinJoin::CheckDSTXes(const CBlockIndex* pindex)
 {
     LOCK(cs_mapdstx);
-    auto it = mapDSTX.begin();
-    while (it != mapDSTX.end()) {
-        if (it->second.IsExpired(pindex)) {
-            mapDSTX.erase(it++);
-        } else {
-            ++it;
-        }
+    if (setDSTXByHeight.empty()) return; // nothing was mined yet
+
+    // see CCoinJoinBroadcastTx::IsExpired, everything mined more than 24 blocks ago expires and
+    // a chainlock on the tip expires everything mined up to it
+    int nExpireHeight = pindex->nHeight - 25;
+    if (llmq::chainLocksHandler->HasChainLock(pindex->nHeight, *pindex->phashBlock)) {
+        nExpireHeight = pindex->nHeight;
+    }
+
+    auto it = setDSTXByHeight.begin();
+    while (it != setDSTXByHeight.end() && it->first <= nExpireHeight) {
+        mapDSTX.erase(it->second);
+        it = setDSTXByHeight.erase(it);
     }
     LogPrint(BCLog::COINJOIN, "CCoinJoin::CheckDSTXes -- mapDSTX.size()=%llu\n", mapDSTX.size());
 }
@@ -588,14 +664,23 @@ void CCoinJoin::UpdateDSTXConfirmedHeight(const CTransactionRef& tx, int nHeight
         return;
     }
 
+    int nOldHeight = it->second.GetConfirmedHeight();
+    if (nOldHeight != -1) {
+        setDSTXByHeight.erase(std::make_pair(nOldHeight, it->first));
+    }
+    if (nHeight != -1) {
+        setDSTXByHeight.emplace(nHeight, it->first);
+    }
     it->second.SetConfirmedHeight(nHeight);
     LogPrint(BCLog::COINJOIN, "CCoinJoin::%s -- txid=%s, nHeight=%d\n", __func__, tx->GetHash().ToString(), nHeight);
 }
 
-void CCoinJoin::TransactionAddedToMempool(const CTransactionRef& tx)
+void CCoinJoin::TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs)
 {
     LOCK(cs_mapdstx);
-    UpdateDSTXConfirmedHeight(tx, -1);
+    for (const auto& p : txs) {
+        UpdateDSTXConfirmedHeight(p.first, -1);
+    }
 }
 
 void CCoinJoin::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
@@ -10,6 +10,11 @@
 #include <sync.h>
 #include <timedata.h>
 #include <tinyformat.h>
+#include <validationinterface.h>
+
+#include <limits>
+#include <map>
+#include <set>
 
 class CCoinJoin;
 class CConnman;
@@ -324,6 +329,7 @@ public:
     bool Sign();
     bool CheckSignature(const CBLSPublicKey& blsPubKey) const;
 
+    int GetConfirmedHeight() const { return nConfirmedHeight; }
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
     bool IsExpired(const CBlockIndex* pindex) const;
     bool IsValidStructure() const;
@@ -375,13 +381,23 @@ protected:
 
     // The current mixing sessions in progress on the network
     std::vector<CCoinJoinQueue> vecCoinJoinQueue;
+    // Position of the latest queue in vecCoinJoinQueue per masternode and readiness
+    std::map<std::pair<COutPoint, bool>, size_t> mapQueueByMasternode;
+    // All queues before this position in vecCoinJoinQueue were tried already
+    size_t nFirstUntriedQueue;
+    // No queue can time out before this time
+    int64_t nNextQueueTimeout;
 
     void SetNull();
     void CheckQueue();
 
+    // Both require cs_vecqueue
+    void AddQueue(const CCoinJoinQueue& dsq);
+    const CCoinJoinQueue* FindQueue(const COutPoint& masternodeOutpoint, bool fReady) const;
+
 public:
-    CCoinJoinBaseManager() :
-        vecCoinJoinQueue() {}
+    CCoinJoinBaseManager();
+    ~CCoinJoinBaseManager();
 
     int GetQueueSize() const { return vecCoinJoinQueue.size(); }
     bool GetQueueItemAndTry(CCoinJoinQueue& dsqRet);
@@ -400,6 +416,8 @@ private:
     // static members
     static std::vector<CAmount> vecStandardDenominations;
     static std::map<uint256, CCoinJoinBroadcastTx> mapDSTX;
+    // confirmed DSTXes by confirmation height, so that CheckDSTXes only has to look at the ones which can expire
+    static std::set<std::pair<int, uint256>> setDSTXByHeight;
 
     static CCriticalSection cs_mapdstx;
 
@@ -435,12 +453,13 @@ public:
 
     static void AddDSTX(const CCoinJoinBroadcastTx& dstx);
     static CCoinJoinBroadcastTx GetDSTX(const uint256& hash);
+    static bool HasDSTX(const uint256& hash);
 
     static void UpdatedBlockTip(const CBlockIndex* pindex);
     static void NotifyChainLock(const CBlockIndex* pindex);
 
     static void UpdateDSTXConfirmedHeight(const CTransactionRef& tx, int nHeight);
-    static void TransactionAddedToMempool(const CTransactionRef& tx);
+    static void TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs);
     static void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted);
     static void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex*);
 
@@ -65,6 +65,9 @@ enum LLMQType : uint8_t
     LLMQ_TEST_V17 = 102, // 3 members, 2 (66%) threshold, one per hour. Params might differ when -llmqtestparams is used
 };
 
+// The largest size of any LLMQ type. Sets of quorum members are sized for it at compile time
+static const int MAX_LLMQ_SIZE = 400;
+
 // Configures a LLMQ and its DKG
 // See https://github.com/dashpay/dips/blob/master/dip-0006.md for more details
 struct LLMQParams {
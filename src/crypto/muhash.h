@@ -0,0 +1,86 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <span.h>
+#include <uint256.h>
+
+#include <stdint.h>
+
+/** A number modulo the prime 2^3072 - 1103717 */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+
+#ifdef __SIZEOF_INT128__
+    typedef unsigned __int128 double_limb_t;
+    typedef uint64_t limb_t;
+    static const int LIMBS = 48;
+    static const int LIMB_SIZE = 64;
+#else
+    typedef uint64_t double_limb_t;
+    typedef uint32_t limb_t;
+    static const int LIMBS = 96;
+    static const int LIMB_SIZE = 32;
+#endif
+    limb_t limbs[LIMBS];
+
+    static_assert(LIMB_SIZE * LIMBS == 3072, "Num3072 isn't 3072 bits");
+    static_assert(sizeof(double_limb_t) == sizeof(limb_t) * 2, "bad size for double_limb_t");
+    static_assert(sizeof(limb_t) * 8 == LIMB_SIZE, "LIMB_SIZE is incorrect");
+
+    Num3072() { SetToOne(); }
+    /** Interpret data as a little endian number, which is reduced modulo the prime */
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    /** Write the number in little endian, it's fully reduced */
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+private:
+    /** Reduce a product of two numbers into this one */
+    void Reduce(const limb_t (&product)[LIMBS * 2]);
+    bool IsOverflow() const;
+    void FullReduce();
+    Num3072 GetInverse() const;
+};
+
+/** A hash of a set of byte strings, which doesn't depend on the order in which they are added.
+ *
+ * Each element is hashed to a number modulo a 3072-bit prime, and the set is represented by the product of its
+ * elements. Adding an element multiplies it into the numerator, removing one multiplies it into the denominator, so
+ * the only division happens once in Finalize. Two hashes of disjoint sets can be combined with *=, which allows
+ * hashing parts of a set in parallel.
+ *
+ * See https://cseweb.ucsd.edu/~mihir/papers/inchash.pdf for the construction and its security.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(Span<const unsigned char> in);
+
+public:
+    /** The hash of the empty set */
+    MuHash3072() {}
+
+    MuHash3072& Insert(Span<const unsigned char> in);
+    MuHash3072& Remove(Span<const unsigned char> in);
+
+    /** Add all elements of mul, the sets must be disjoint */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    /** Remove all elements of div, which must be part of this set */
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    void Finalize(uint256& out);
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
@@ -0,0 +1,63 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/pbkdf2_hmac_sha512.h>
+
+#include <crypto/hmac_sha512.h>
+#include <crypto/common.h>
+#include <crypto/sha512.h>
+#include <support/cleanse.h>
+
+#include <algorithm>
+#include <string.h>
+
+void PBKDF2_HMAC_SHA512(const unsigned char* pass, size_t passlen, const unsigned char* salt, size_t saltlen, unsigned int iterations, unsigned char* out, size_t outlen)
+{
+    // The HMAC key is the same for all iterations, so the padded inner and outer key blocks are hashed only once.
+    // Each iteration then hashes a 64-byte message with HMAC, which takes one SHA512 transformation per midstate.
+    unsigned char rkey[128] = {0};
+    if (passlen <= 128) {
+        memcpy(rkey, pass, passlen);
+    } else {
+        CSHA512().Write(pass, passlen).Finalize(rkey);
+    }
+    uint64_t innerMidstate[8], outerMidstate[8];
+    for (int n = 0; n < 128; n++) {
+        rkey[n] ^= 0x36;
+    }
+    CSHA512().Write(rkey, 128).GetMidstate(innerMidstate);
+    for (int n = 0; n < 128; n++) {
+        rkey[n] ^= 0x36 ^ 0x5c;
+    }
+    CSHA512().Write(rkey, 128).GetMidstate(outerMidstate);
+    memory_cleanse(rkey, sizeof(rkey));
+
+    unsigned char u[CHMAC_SHA512::OUTPUT_SIZE];
+    unsigned char t[CHMAC_SHA512::OUTPUT_SIZE];
+    unsigned char counter[4];
+
+    for (uint32_t block = 1; outlen > 0; block++) {
+        WriteBE32(counter, block);
+        CHMAC_SHA512(pass, passlen).Write(salt, saltlen).Write(counter, sizeof(counter)).Finalize(u);
+        memcpy(t, u, sizeof(t));
+
+        for (unsigned int i = 1; i < iterations; i++) {
+            SHA512Midstate64(innerMidstate, u, u);
+            SHA512Midstate64(outerMidstate, u, u);
+            for (size_t j = 0; j < sizeof(t); j++) {
+                t[j] ^= u[j];
+            }
+        }
+
+        size_t n = std::min(outlen, sizeof(t));
+        memcpy(out, t, n);
+        out += n;
+        outlen -= n;
+    }
+
+    memory_cleanse(u, sizeof(u));
+    memory_cleanse(t, sizeof(t));
+    memory_cleanse(innerMidstate, sizeof(innerMidstate));
+    memory_cleanse(outerMidstate, sizeof(outerMidstate));
+}
@@ -0,0 +1,14 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_PBKDF2_HMAC_SHA512_H
+#define BITCOIN_CRYPTO_PBKDF2_HMAC_SHA512_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** PBKDF2 (RFC 8018) with HMAC-SHA512 as the pseudorandom function. out must hold outlen bytes. */
+void PBKDF2_HMAC_SHA512(const unsigned char* pass, size_t passlen, const unsigned char* salt, size_t saltlen, unsigned int iterations, unsigned char* out, size_t outlen);
+
+#endif // BITCOIN_CRYPTO_PBKDF2_HMAC_SHA512_H
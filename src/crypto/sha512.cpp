@@ -205,3 +205,24 @@ CSHA512& CSHA512::Reset()
     sha512::Initialize(s);
     return *this;
 }
+
+void CSHA512::GetMidstate(uint64_t midstate[8]) const
+{
+    memcpy(midstate, s, sizeof(s));
+}
+
+void SHA512Midstate64(const uint64_t midstate[8], const unsigned char in[64], unsigned char out[64])
+{
+    // the 64 bytes of input, padding and the total length of 192 bytes fit into a single chunk
+    unsigned char chunk[128] = {0};
+    memcpy(chunk, in, 64);
+    chunk[64] = 0x80;
+    WriteBE64(chunk + 120, 192 << 3);
+
+    uint64_t s[8];
+    memcpy(s, midstate, sizeof(s));
+    sha512::Transform(s, chunk);
+    for (int i = 0; i < 8; i++) {
+        WriteBE64(out + i * 8, s[i]);
+    }
+}
@@ -23,6 +23,13 @@ public:
     CSHA512& Write(const unsigned char* data, size_t len);
     void Finalize(unsigned char hash[OUTPUT_SIZE]);
     CSHA512& Reset();
+    //! Copy the internal state, which is only complete after a multiple of 128 bytes was written
+    void GetMidstate(uint64_t midstate[8]) const;
 };
 
+/** Compute SHA512 of a 128-byte block, given as the state after hashing it, followed by 64 bytes of input. This is
+ *  an inner or outer HMAC-SHA512 invocation on a 64-byte message, with the key block already hashed.
+ */
+void SHA512Midstate64(const uint64_t midstate[8], const unsigned char in[64], unsigned char out[64]);
+
 #endif // BITCOIN_CRYPTO_SHA512_H
@@ -4,6 +4,19 @@
 
 #include <crypto/siphash.h>
 
+#include <crypto/common.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(USE_ASM)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace siphash_avx2
+{
+void SipHashUint256_4way(uint64_t k0, uint64_t k1, const unsigned char* in, uint64_t* out);
+}
+
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
 #define SIPROUND do { \
@@ -171,3 +184,95 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace
+{
+void inline SipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+{
+    SIPROUND;
+}
+
+/** 4 independent SipHashUint256 computations, interleaved so that the CPU can work on all of them at once */
+void SipHashUint256_4way(uint64_t k0, uint64_t k1, const unsigned char* in, uint64_t* out)
+{
+    uint64_t v0[4], v1[4], v2[4], v3[4];
+    for (int i = 0; i < 4; i++) {
+        v0[i] = 0x736f6d6570736575ULL ^ k0;
+        v1[i] = 0x646f72616e646f6dULL ^ k1;
+        v2[i] = 0x6c7967656e657261ULL ^ k0;
+        v3[i] = 0x7465646279746573ULL ^ k1;
+    }
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            uint64_t d = ReadLE64(in + 32 * i + 8 * j);
+            v3[i] ^= d;
+            SipRound(v0[i], v1[i], v2[i], v3[i]);
+            SipRound(v0[i], v1[i], v2[i], v3[i]);
+            v0[i] ^= d;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        v3[i] ^= ((uint64_t)4) << 59;
+        SipRound(v0[i], v1[i], v2[i], v3[i]);
+        SipRound(v0[i], v1[i], v2[i], v3[i]);
+        v0[i] ^= ((uint64_t)4) << 59;
+        v2[i] ^= 0xFF;
+        SipRound(v0[i], v1[i], v2[i], v3[i]);
+        SipRound(v0[i], v1[i], v2[i], v3[i]);
+        SipRound(v0[i], v1[i], v2[i], v3[i]);
+        SipRound(v0[i], v1[i], v2[i], v3[i]);
+        out[i] = v0[i] ^ v1[i] ^ v2[i] ^ v3[i];
+    }
+}
+
+typedef void (*SipHashUint256_4wayType)(uint64_t, uint64_t, const unsigned char*, uint64_t*);
+SipHashUint256_4wayType SipHashUint256_4wayImpl = SipHashUint256_4way;
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the CPU supports AVX2 and the OS has enabled the AVX registers. */
+bool HaveAVX2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    __cpuid_count(1, 0, eax, ebx, ecx, edx);
+    bool have_xsave = (ecx >> 27) & 1;
+    bool have_avx = (ecx >> 28) & 1;
+    if (!have_xsave || !have_avx) {
+        return false;
+    }
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    if ((a & 6) != 6) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+} // namespace
+
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* vals, uint64_t* out, size_t count)
+{
+    static_assert(sizeof(uint256) == 32, "the values must be laid out as consecutive 32 byte blocks");
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        SipHashUint256_4wayImpl(k0, k1, vals[i].begin(), out + i);
+    }
+    for (; i < count; i++) {
+        out[i] = SipHashUint256(k0, k1, vals[i]);
+    }
+}
+
+std::string SipHashAutoDetect()
+{
+    std::string ret = "standard(4way)";
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    (void)HaveAVX2;
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (HaveAVX2()) {
+        SipHashUint256_4wayImpl = siphash_avx2::SipHashUint256_4way;
+        ret = "avx2(4way)";
+    }
+#endif
+#endif
+    return ret;
+}
@@ -6,6 +6,7 @@
 #define BITCOIN_CRYPTO_SIPHASH_H
 
 #include <stdint.h>
+#include <string>
 
 #include <uint256.h>
 
@@ -44,4 +45,14 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** Compute out[i] = SipHashUint256(k0, k1, vals[i]) for count values.
+ *
+ *  Groups of 4 values are hashed at once, with AVX2 if SipHashAutoDetect() found it to be available and otherwise
+ *  with 4 interleaved scalar computations. This is meant for bulk operations which know many keys up front.
+ */
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* vals, uint64_t* out, size_t count);
+
+/** Autodetect the best available SipHash batch implementation. Returns the name of the implementation. */
+std::string SipHashAutoDetect();
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
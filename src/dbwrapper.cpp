@@ -6,6 +6,10 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
+#include <util/strencodings.h>
+#include <util/time.h>
+#include <util/trace.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,6 +17,12 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <set>
+#include <sstream>
+
+//! all currently open databases, for GetAllDBStats()
+static Mutex g_dbwrappers_mutex;
+static std::set<const CDBWrapper*> g_dbwrappers GUARDED_BY(g_dbwrappers_mutex);
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -97,12 +107,109 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static bool GetDBTuningProfile(const std::string& strProfile, DBTuning& tuning)
+{
+    tuning = DBTuning();
+    if (strProfile == "default") {
+        return true;
+    }
+    if (strProfile == "pointlookup") {
+        // fewer bloom filter false positives and more cache for random point lookups
+        tuning.nBloomBits = 16;
+        tuning.nBlockCachePercent = 60;
+        tuning.nWriteBufferPercent = 20;
+        return true;
+    }
+    if (strProfile == "rangescan") {
+        // larger blocks for sequential reads of adjacent keys, which don't benefit much from the block cache
+        tuning.nBlockSize = 64 * 1024;
+        tuning.nBlockCachePercent = 40;
+        tuning.nWriteBufferPercent = 30;
+        return true;
+    }
+    return false;
+}
+
+static bool ApplyDBTuneSetting(const std::string& strSetting, const std::string& strValue, DBTuning& tuning)
+{
+    if (strSetting == "profile") {
+        return GetDBTuningProfile(strValue, tuning);
+    }
+    int32_t nValue;
+    if (!ParseInt32(strValue, &nValue) || nValue < 0) {
+        return false;
+    }
+    if (strSetting == "bloombits") {
+        tuning.nBloomBits = nValue;
+        return nValue <= 64;
+    }
+    if (strSetting == "blocksize") {
+        tuning.nBlockSize = nValue;
+        return nValue >= 1024 && nValue <= 4 * 1024 * 1024;
+    }
+    if (strSetting == "blockcache") {
+        tuning.nBlockCachePercent = nValue;
+        return true;
+    }
+    if (strSetting == "writebuffer") {
+        tuning.nWriteBufferPercent = nValue;
+        return nValue >= 1;
+    }
+    return false;
+}
+
+bool GetDBTuning(const std::string& strName, DBTuning& tuning, std::string& strError)
+{
+    tuning = DBTuning();
+    // -dbtune=<db>:<setting>=<value>[,<setting>=<value>...], later settings override earlier ones
+    for (const std::string& strArg : gArgs.GetArgs("-dbtune")) {
+        if (strArg.empty()) {
+            continue;
+        }
+        size_t nColon = strArg.find(':');
+        if (nColon == std::string::npos) {
+            strError = strprintf("Invalid -dbtune option '%s', expected <db>:<setting>=<value>", strArg);
+            return false;
+        }
+        if (strArg.substr(0, nColon) != strName) {
+            continue;
+        }
+        std::stringstream ss(strArg.substr(nColon + 1));
+        std::string strPair;
+        while (std::getline(ss, strPair, ',')) {
+            size_t nEq = strPair.find('=');
+            if (nEq == std::string::npos || !ApplyDBTuneSetting(strPair.substr(0, nEq), strPair.substr(nEq + 1), tuning)) {
+                strError = strprintf("Invalid -dbtune setting '%s' for database %s", strPair, strName);
+                return false;
+            }
+        }
+    }
+    if (tuning.nBlockCachePercent + 2 * tuning.nWriteBufferPercent > 100) {
+        strError = strprintf("Invalid -dbtune options for database %s, blockcache plus twice writebuffer exceeds 100%%", strName);
+        return false;
+    }
+    return true;
+}
+
+bool CheckDBTuneArgs(std::string& strError)
+{
+    for (const std::string& strArg : gArgs.GetArgs("-dbtune")) {
+        DBTuning tuning;
+        if (!GetDBTuning(strArg.substr(0, strArg.find(':')), tuning, strError)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const DBTuning& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(nCacheSize * tuning.nBlockCachePercent / 100);
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = nCacheSize * tuning.nWriteBufferPercent / 100;
+    options.block_size = tuning.nBlockSize;
+    options.filter_policy = tuning.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(tuning.nBloomBits) : nullptr;
     options.compression = leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -122,7 +229,13 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    std::string strError;
+    if (!GetDBTuning(m_name, m_tuning, strError)) {
+        // invalid options are rejected during startup already, this only happens for databases opened before that
+        LogPrintf("%s, using default tuning\n", strError);
+        m_tuning = DBTuning();
+    }
+    options = GetOptions(nCacheSize, m_tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -164,10 +277,17 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    LOCK(g_dbwrappers_mutex);
+    g_dbwrappers.emplace(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(g_dbwrappers_mutex);
+        g_dbwrappers.erase(this);
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -187,8 +307,10 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    int64_t nStart = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    TRACE4(leveldb, write_batch, m_name.c_str(), batch.SizeEstimate(), fSync, GetTimeMicros() - nStart);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
         LogPrint(BCLog::LEVELDB, "WriteBatch memory usage: db=%s, before=%.1fMiB, after=%.1fMiB\n",
@@ -206,6 +328,56 @@ size_t CDBWrapper::DynamicMemoryUsage() const {
     return stoul(memory);
 }
 
+DBStats CDBWrapper::GetStats() const
+{
+    DBStats stats;
+    stats.name = m_name;
+    stats.tuning = m_tuning;
+    stats.nMemoryUsage = DynamicMemoryUsage();
+
+    std::string strValue;
+    // the property is only available for existing levels
+    for (int nLevel = 0; pdb->GetProperty("leveldb.num-files-at-level" + std::to_string(nLevel), &strValue); nLevel++) {
+        int nFiles = 0;
+        if (!ParseInt32(strValue, &nFiles) || nFiles < 0) {
+            break;
+        }
+        stats.vFilesPerLevel.emplace_back(nFiles);
+        if (nFiles > 0) {
+            stats.nReadAmplification += nLevel == 0 ? nFiles : 1;
+        }
+    }
+
+    // The compaction table of leveldb.stats has a row per level:
+    // "<level> <files> <size MB> <time sec> <read MB> <written MB>"
+    if (pdb->GetProperty("leveldb.stats", &strValue)) {
+        std::stringstream ss(strValue);
+        std::string strLine;
+        while (std::getline(ss, strLine)) {
+            int nLevel, nFiles;
+            double nSize, nTime, nRead, nWritten;
+            std::stringstream ssLine(strLine);
+            if (ssLine >> nLevel >> nFiles >> nSize >> nTime >> nRead >> nWritten) {
+                stats.nCompactionSeconds += nTime;
+                stats.nCompactionReadMB += nRead;
+                stats.nCompactionWrittenMB += nWritten;
+            }
+        }
+    }
+    return stats;
+}
+
+std::vector<DBStats> CDBWrapper::GetAllDBStats()
+{
+    std::vector<DBStats> result;
+    LOCK(g_dbwrappers_mutex);
+    for (const CDBWrapper* pdbw : g_dbwrappers) {
+        result.emplace_back(pdbw->GetStats());
+    }
+    std::sort(result.begin(), result.end(), [](const DBStats& a, const DBStats& b) { return a.name < b.name; });
+    return result;
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
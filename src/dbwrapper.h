@@ -7,13 +7,18 @@
 
 #include <clientversion.h>
 #include <fs.h>
+#include <memusage.h>
 #include <serialize.h>
 #include <streams.h>
+#include <util/bytevectorhash.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <version.h>
 
+#include <algorithm>
+#include <memory>
 #include <typeindex>
+#include <unordered_map>
 
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
@@ -110,8 +115,10 @@ public:
     }
 
     void Erase(const CDataStream& _ssKey) {
-        leveldb::Slice slKey(_ssKey.data(), _ssKey.size());
+        Erase(leveldb::Slice(_ssKey.data(), _ssKey.size()));
+    }
 
+    void Erase(const leveldb::Slice& slKey) {
         batch.Delete(slKey);
         // - byte: header
         // - varint: key length
@@ -172,6 +179,11 @@ public:
         return CDataStream(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
     }
 
+    //! The raw key, only valid until the iterator is moved
+    leveldb::Slice GetKeySlice() const {
+        return piter->key();
+    }
+
     unsigned int GetKeySize() {
         return piter->key().size();
     }
@@ -194,6 +206,41 @@ public:
 
 };
 
+/**
+ * LevelDB tuning of a database. The cache size passed to CDBWrapper is split into the block cache and the (up to two)
+ * write buffers by percentages, so that the total memory budget of a database stays the same for all profiles.
+ */
+struct DBTuning
+{
+    int nBloomBits{10};
+    size_t nBlockSize{4096};
+    int nBlockCachePercent{50};
+    int nWriteBufferPercent{25};
+};
+
+/**
+ * Parse the -dbtune options and return the tuning of the database with the given name (its directory name, e.g.
+ * "chainstate", "index", "evodb" or "llmq"). Returns false and sets strError if the options are invalid.
+ */
+bool GetDBTuning(const std::string& strName, DBTuning& tuning, std::string& strError);
+
+/** Check all -dbtune options, used to fail early during startup */
+bool CheckDBTuneArgs(std::string& strError);
+
+/** LevelDB statistics of an open database, see GetAllDBStats() */
+struct DBStats
+{
+    std::string name;
+    DBTuning tuning;
+    size_t nMemoryUsage{0};
+    std::vector<int> vFilesPerLevel;
+    //! worst case number of table files a point lookup has to check: all level 0 files plus one per deeper level
+    int nReadAmplification{0};
+    double nCompactionSeconds{0};
+    double nCompactionReadMB{0};
+    double nCompactionWrittenMB{0};
+};
+
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
@@ -222,6 +269,9 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! the tuning applied to this database
+    DBTuning m_tuning;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -340,21 +390,72 @@ public:
         return WriteBatch(batch, fSync);
     }
 
+    /**
+     * Erase all keys in the range [key_begin, key_end). Keys are compared in their serialized form, so the range is
+     * only meaningful if the serialization of K preserves ordering (e.g. big endian integers after a common prefix).
+     * Returns the number of erased keys.
+     */
+    template <typename K>
+    size_t EraseRange(const K& key_begin, const K& key_end, bool fSync = false)
+    {
+        CDataStream ssKey1(SER_DISK, CLIENT_VERSION), ssKey2(SER_DISK, CLIENT_VERSION);
+        ssKey1.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        leveldb::Slice slKey1(ssKey1.data(), ssKey1.size());
+        leveldb::Slice slKey2(ssKey2.data(), ssKey2.size());
+
+        std::unique_ptr<leveldb::Iterator> piter(pdb->NewIterator(iteroptions));
+        CDBBatch batch(*this);
+        size_t cnt = 0;
+        for (piter->Seek(slKey1); piter->Valid() && piter->key().compare(slKey2) < 0; piter->Next()) {
+            batch.Erase(piter->key());
+            cnt++;
+            if (batch.SizeEstimate() >= (1 << 24)) {
+                WriteBatch(batch, fSync);
+                batch.Clear();
+            }
+        }
+        WriteBatch(batch, fSync);
+        return cnt;
+    }
+
     bool WriteBatch(CDBBatch& batch, bool fSync = false);
 
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    DBStats GetStats() const;
+
     CDBIterator *NewIterator()
     {
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /** Take a snapshot of the current state of the database, which is released when the last reference is gone */
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot()
+    {
+        leveldb::DB* db = pdb;
+        return std::shared_ptr<const leveldb::Snapshot>(pdb->GetSnapshot(), [db](const leveldb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); });
+    }
+
+    /** Iterate over a snapshot of the database. The snapshot must be kept alive as long as the iterator is used */
+    CDBIterator *NewIterator(const leveldb::Snapshot* snapshot)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot;
+        return new CDBIterator(*this, pdb->NewIterator(options));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
 
+    /** Get the statistics of all currently open databases */
+    static std::vector<DBStats> GetAllDBStats();
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
@@ -394,6 +495,22 @@ public:
 
 };
 
+struct CDBDataStreamCmp {
+    static bool less(const CDataStream& a, const CDataStream& b) {
+        return std::lexicographical_compare(
+                (const uint8_t*)a.data(), (const uint8_t*)a.data() + a.size(),
+                (const uint8_t*)b.data(), (const uint8_t*)b.data() + b.size());
+    }
+    bool operator()(const CDataStream& a, const CDataStream& b) const {
+        return less(a, b);
+    }
+
+    //! Same order as above (and as LevelDB's bytewise comparator), without copying a raw key into a stream
+    static int compare(const CDataStream& a, const leveldb::Slice& b) {
+        return leveldb::Slice(a.data(), a.size()).compare(b);
+    }
+};
+
 template<typename CDBTransaction>
 class CDBTransactionIterator
 {
@@ -401,6 +518,7 @@ private:
     CDBTransaction& transaction;
 
     typedef typename std::remove_pointer<decltype(transaction.parent.NewIterator())>::type ParentIterator;
+    typedef typename CDBTransaction::DataStreamCmp DataStreamCmp;
 
     // We maintain 2 iterators, one for the transaction and one for the parent
     // At all times, only one of both provides the current value. The decision is made by comparing the current keys
@@ -408,20 +526,29 @@ private:
     // is advanced.
     typename CDBTransaction::WritesMap::iterator transactionIt;
     std::unique_ptr<ParentIterator> parentIt;
-    CDataStream parentKey;
     bool curIsParent{false};
 
+    // Parent entries which are deleted or overwritten by the transaction must be skipped. As the parent is iterated in
+    // key order, this is a merge with the (sorted) deletes and writes of the transaction: both cursors only ever move
+    // forward and the parent key is compared as a raw slice, without being copied into a stream for a map lookup.
+    // Once both cursors are exhausted, the parent is simply passed through.
+    typename CDBTransaction::DeletesSet::iterator deletesSkipIt;
+    typename CDBTransaction::WritesMap::iterator writesSkipIt;
+
 public:
     explicit CDBTransactionIterator(CDBTransaction& _transaction) :
-            transaction(_transaction),
-            parentKey(SER_DISK, CLIENT_VERSION)
+            transaction(_transaction)
     {
         transactionIt = transaction.writes.end();
+        deletesSkipIt = transaction.deletes.end();
+        writesSkipIt = transaction.writes.end();
         parentIt = std::unique_ptr<ParentIterator>(transaction.parent.NewIterator());
     }
 
     void SeekToFirst() {
         transactionIt = transaction.writes.begin();
+        deletesSkipIt = transaction.deletes.begin();
+        writesSkipIt = transaction.writes.begin();
         parentIt->SeekToFirst();
         SkipDeletedAndOverwritten();
         DecideCur();
@@ -434,6 +561,8 @@ public:
 
     void Seek(const CDataStream& ssKey) {
         transactionIt = transaction.writes.lower_bound(ssKey);
+        deletesSkipIt = transaction.deletes.lower_bound(ssKey);
+        writesSkipIt = transactionIt;
         parentIt->Seek(ssKey);
         SkipDeletedAndOverwritten();
         DecideCur();
@@ -465,14 +594,7 @@ public:
         }
 
         if (curIsParent) {
-            try {
-                // TODO try to avoid this copy (we need a stream that allows reading from external buffers)
-                CDataStream ssKey = parentKey;
-                ssKey >> key;
-            } catch (const std::exception&) {
-                return false;
-            }
-            return true;
+            return parentIt->GetKey(key);
         } else {
             try {
                 // TODO try to avoid this copy (we need a stream that allows reading from external buffers)
@@ -490,12 +612,21 @@ public:
             return CDataStream(SER_DISK, CLIENT_VERSION);
         }
         if (curIsParent) {
-            return parentKey;
+            return parentIt->GetKey();
         } else {
             return transactionIt->first;
         }
     }
 
+    //! The raw key, only valid until the iterator or the transaction is modified
+    leveldb::Slice GetKeySlice() const {
+        if (curIsParent) {
+            return parentIt->GetKeySlice();
+        } else {
+            return leveldb::Slice(transactionIt->first.data(), transactionIt->first.size());
+        }
+    }
+
     unsigned int GetKeySize() {
         if (!Valid()) {
             return 0;
@@ -513,7 +644,9 @@ public:
             return false;
         }
         if (curIsParent) {
-            return transaction.Read(parentKey, value);
+            // the entry is neither deleted nor overwritten, so the parent iterator already has the current value and
+            // there is no need for another lookup
+            return parentIt->GetValue(value);
         } else {
             return transaction.Read(transactionIt->first, value);
         }
@@ -522,11 +655,25 @@ public:
 private:
     void SkipDeletedAndOverwritten() {
         while (parentIt->Valid()) {
-            parentKey = parentIt->GetKey();
-            if (!transaction.deletes.count(parentKey) && !transaction.writes.count(parentKey)) {
-                break;
+            if (deletesSkipIt == transaction.deletes.end() && writesSkipIt == transaction.writes.end()) {
+                return;
+            }
+            leveldb::Slice slParentKey = parentIt->GetKeySlice();
+            int cmpDeletes = 1;
+            while (deletesSkipIt != transaction.deletes.end() && (cmpDeletes = DataStreamCmp::compare(*deletesSkipIt, slParentKey)) < 0) {
+                ++deletesSkipIt;
+            }
+            int cmpWrites = 1;
+            while (writesSkipIt != transaction.writes.end() && (cmpWrites = DataStreamCmp::compare(writesSkipIt->first, slParentKey)) < 0) {
+                ++writesSkipIt;
+            }
+            if (deletesSkipIt != transaction.deletes.end() && cmpDeletes == 0) {
+                parentIt->Next();
+            } else if (writesSkipIt != transaction.writes.end() && cmpWrites == 0) {
+                parentIt->Next();
+            } else {
+                return;
             }
-            parentIt->Next();
         }
     }
 
@@ -536,11 +683,7 @@ private:
         } else if (transactionIt == transaction.writes.end() && parentIt->Valid()) {
             curIsParent = true;
         } else if (transactionIt != transaction.writes.end() && parentIt->Valid()) {
-            if (CDBTransaction::DataStreamCmp::less(transactionIt->first, parentKey)) {
-                curIsParent = false;
-            } else {
-                curIsParent = true;
-            }
+            curIsParent = DataStreamCmp::compare(transactionIt->first, parentIt->GetKeySlice()) >= 0;
         }
     }
 };
@@ -554,16 +697,7 @@ protected:
     CommitTarget &commitTarget;
     ssize_t memoryUsage{0}; // signed, just in case we made an error in the calculations so that we don't get an overflow
 
-    struct DataStreamCmp {
-        static bool less(const CDataStream& a, const CDataStream& b) {
-            return std::lexicographical_compare(
-                    (const uint8_t*)a.data(), (const uint8_t*)a.data() + a.size(),
-                    (const uint8_t*)b.data(), (const uint8_t*)b.data() + b.size());
-        }
-        bool operator()(const CDataStream& a, const CDataStream& b) const {
-            return less(a, b);
-        }
-    };
+    typedef CDBDataStreamCmp DataStreamCmp;
 
     struct ValueHolder {
         size_t memoryUsage;
@@ -721,4 +855,322 @@ public:
     }
 };
 
+/**
+ * Size bounded cache of deserialized values, keyed by their serialized DB key. Values of different types may be
+ * cached, a Get() with a type other than the one passed to Put() is treated as a miss. The memory usage of an entry
+ * is estimated by its serialized size. When the limit is exceeded, the least recently used entries are evicted until
+ * only half of the limit is used.
+ * Internally synchronized, as the owner may serve reads from multiple threads in parallel.
+ */
+class CDBReadCache
+{
+private:
+    struct ValueBase {
+        virtual ~ValueBase() = default;
+    };
+    template <typename V>
+    struct Value : ValueBase {
+        explicit Value(const V& _value) : value(_value) {}
+        const V value;
+    };
+    struct Entry {
+        std::shared_ptr<const ValueBase> value;
+        size_t memoryUsage{0};
+        int64_t lastAccess{0};
+    };
+    typedef std::vector<unsigned char> Key;
+    typedef std::unordered_map<Key, Entry, ByteVectorHash> EntriesMap;
+
+    const size_t nMaxMemoryUsage;
+
+    Mutex cs;
+    EntriesMap entries GUARDED_BY(cs);
+    size_t nMemoryUsage GUARDED_BY(cs){0};
+    int64_t nAccessCounter GUARDED_BY(cs){0};
+
+    static Key MakeKey(const CDataStream& ssKey) {
+        return Key(ssKey.begin(), ssKey.end());
+    }
+
+    void Truncate() EXCLUSIVE_LOCKS_REQUIRED(cs) {
+        std::vector<EntriesMap::iterator> vec;
+        vec.reserve(entries.size());
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            vec.emplace_back(it);
+        }
+        // least recently used first
+        std::sort(vec.begin(), vec.end(), [](const EntriesMap::iterator& it1, const EntriesMap::iterator& it2) {
+            return it1->second.lastAccess < it2->second.lastAccess;
+        });
+        for (const auto& it : vec) {
+            if (nMemoryUsage <= nMaxMemoryUsage / 2) {
+                break;
+            }
+            nMemoryUsage -= it->second.memoryUsage;
+            entries.erase(it);
+        }
+    }
+
+public:
+    explicit CDBReadCache(size_t _nMaxMemoryUsage) : nMaxMemoryUsage(_nMaxMemoryUsage) {}
+
+    template <typename V>
+    bool Get(const CDataStream& ssKey, V& value) {
+        std::shared_ptr<const ValueBase> cached;
+        {
+            LOCK(cs);
+            auto it = entries.find(MakeKey(ssKey));
+            if (it == entries.end()) {
+                return false;
+            }
+            it->second.lastAccess = nAccessCounter++;
+            cached = it->second.value;
+        }
+        // copy outside of the lock, values may be large
+        auto* impl = dynamic_cast<const Value<V>*>(cached.get());
+        if (!impl) {
+            return false;
+        }
+        value = impl->value;
+        return true;
+    }
+
+    template <typename V>
+    void Put(const CDataStream& ssKey, const V& value) {
+        size_t nEntryMemoryUsage = ssKey.size() + ::GetSerializeSize(value, SER_DISK, CLIENT_VERSION);
+        if (nEntryMemoryUsage > nMaxMemoryUsage / 4) {
+            // a single huge value would evict everything else
+            return;
+        }
+        auto cached = std::make_shared<const Value<V>>(value);
+
+        LOCK(cs);
+        Entry& entry = entries[MakeKey(ssKey)];
+        nMemoryUsage -= entry.memoryUsage;
+        entry.value = std::move(cached);
+        entry.memoryUsage = nEntryMemoryUsage;
+        entry.lastAccess = nAccessCounter++;
+        nMemoryUsage += nEntryMemoryUsage;
+        if (nMemoryUsage > nMaxMemoryUsage) {
+            Truncate();
+        }
+    }
+
+    void Erase(const CDataStream& ssKey) {
+        LOCK(cs);
+        auto it = entries.find(MakeKey(ssKey));
+        if (it != entries.end()) {
+            nMemoryUsage -= it->second.memoryUsage;
+            entries.erase(it);
+        }
+    }
+
+    void Clear() {
+        LOCK(cs);
+        entries.clear();
+        nMemoryUsage = 0;
+    }
+
+    size_t GetMemoryUsage() {
+        LOCK(cs);
+        return nMemoryUsage;
+    }
+};
+
+/**
+ * Same interface as CDBTransaction, but values are kept in serialized form. Meant for long living overlays (e.g. the
+ * EvoDB root transaction) which collect the writes of many blocks between two flushes. A serialized value is usually
+ * much smaller than the deserialized object, and repeated writes of the same key are combined in place, reusing the
+ * already allocated entry. The flip side is that every Read() has to deserialize again, just like a read from the DB.
+ * To avoid this for hot keys, an optional CDBReadCache keeps the deserialized values of recent reads. It is invalidated
+ * per key by Write() and Erase() and completely by Clear().
+ */
+template<typename Parent, typename CommitTarget>
+class CDBCompactTransaction {
+    friend class CDBTransactionIterator<CDBCompactTransaction>;
+
+protected:
+    Parent &parent;
+    CommitTarget &commitTarget;
+    size_t memoryUsage{0};
+    std::unique_ptr<CDBReadCache> readCache;
+
+    typedef CDBDataStreamCmp DataStreamCmp;
+
+    template<typename K>
+    static CDataStream KeyToDataStream(const K& key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        return ssKey;
+    }
+
+    typedef std::map<CDataStream, CDataStream, DataStreamCmp> WritesMap;
+    typedef std::set<CDataStream, DataStreamCmp> DeletesSet;
+
+    WritesMap writes;
+    DeletesSet deletes;
+
+    static size_t EntryMemoryUsage(const WritesMap& m, const CDataStream& ssKey, const CDataStream& ssValue) {
+        return memusage::IncrementalDynamicUsage(m) + memusage::MallocUsage(ssKey.size()) + memusage::MallocUsage(ssValue.size());
+    }
+    static size_t EntryMemoryUsage(const DeletesSet& s, const CDataStream& ssKey) {
+        return memusage::IncrementalDynamicUsage(s) + memusage::MallocUsage(ssKey.size());
+    }
+
+public:
+    CDBCompactTransaction(Parent &_parent, CommitTarget &_commitTarget, size_t nReadCacheSize = 0) :
+        parent(_parent),
+        commitTarget(_commitTarget),
+        readCache(nReadCacheSize != 0 ? std::make_unique<CDBReadCache>(nReadCacheSize) : nullptr)
+    {}
+
+    template <typename K, typename V>
+    void Write(const K& key, const V& v) {
+        Write(KeyToDataStream(key), v);
+    }
+
+    template <typename V>
+    void Write(const CDataStream& ssKey, const V& v) {
+        if (readCache) {
+            readCache->Erase(ssKey);
+        }
+
+        auto it = deletes.find(ssKey);
+        if (it != deletes.end()) {
+            memoryUsage -= EntryMemoryUsage(deletes, *it);
+            deletes.erase(it);
+        }
+
+        auto p = writes.emplace(ssKey, CDataStream(SER_DISK, CLIENT_VERSION));
+        auto& ssValue = p.first->second;
+        if (!p.second) {
+            memoryUsage -= EntryMemoryUsage(writes, p.first->first, ssValue);
+            ssValue.clear();
+        }
+        ssValue.reserve(::GetSerializeSize(v, SER_DISK, CLIENT_VERSION));
+        ssValue << v;
+        memoryUsage += EntryMemoryUsage(writes, p.first->first, ssValue);
+    }
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) {
+        return Read(KeyToDataStream(key), value);
+    }
+
+    template <typename V>
+    bool Read(const CDataStream& ssKey, V& value) {
+        if (deletes.count(ssKey)) {
+            return false;
+        }
+        if (readCache && readCache->Get(ssKey, value)) {
+            return true;
+        }
+
+        auto it = writes.find(ssKey);
+        if (it != writes.end()) {
+            try {
+                CDataStream ssValue(it->second.begin(), it->second.end(), SER_DISK, CLIENT_VERSION);
+                ssValue >> value;
+            } catch (const std::exception&) {
+                return false;
+            }
+        } else if (!parent.Read(ssKey, value)) {
+            return false;
+        }
+
+        if (readCache) {
+            readCache->Put(ssKey, value);
+        }
+        return true;
+    }
+
+    template <typename K>
+    bool Exists(const K& key) {
+        return Exists(KeyToDataStream(key));
+    }
+
+    bool Exists(const CDataStream& ssKey) {
+        if (deletes.count(ssKey)) {
+            return false;
+        }
+
+        if (writes.count(ssKey)) {
+            return true;
+        }
+
+        return parent.Exists(ssKey);
+    }
+
+    template <typename K>
+    void Erase(const K& key) {
+        return Erase(KeyToDataStream(key));
+    }
+
+    void Erase(const CDataStream& ssKey) {
+        if (readCache) {
+            readCache->Erase(ssKey);
+        }
+
+        auto it = writes.find(ssKey);
+        if (it != writes.end()) {
+            memoryUsage -= EntryMemoryUsage(writes, it->first, it->second);
+            writes.erase(it);
+        }
+        if (deletes.emplace(ssKey).second) {
+            memoryUsage += EntryMemoryUsage(deletes, ssKey);
+        }
+    }
+
+    void Clear() {
+        writes.clear();
+        deletes.clear();
+        memoryUsage = 0;
+        ClearReadCache();
+    }
+
+    void Commit() {
+        for (const auto &k : deletes) {
+            commitTarget.Erase(k);
+        }
+        for (const auto &p : writes) {
+            // CDataStream serializes as its raw content, so this writes the value exactly as it was serialized above
+            commitTarget.Write(p.first, p.second);
+        }
+        // the committed values stay the same, so the read cache remains valid
+        writes.clear();
+        deletes.clear();
+        memoryUsage = 0;
+    }
+
+    void ClearReadCache() {
+        if (readCache) {
+            readCache->Clear();
+        }
+    }
+
+    size_t GetReadCacheMemoryUsage() const {
+        return readCache ? readCache->GetMemoryUsage() : 0;
+    }
+
+    bool IsClean() {
+        return writes.empty() && deletes.empty();
+    }
+
+    size_t GetMemoryUsage() const {
+        return memoryUsage;
+    }
+
+    size_t GetWritesCount() const {
+        return writes.size() + deletes.size();
+    }
+
+    CDBTransactionIterator<CDBCompactTransaction>* NewIterator() {
+        return new CDBTransactionIterator<CDBCompactTransaction>(*this);
+    }
+    std::unique_ptr<CDBTransactionIterator<CDBCompactTransaction>> NewIteratorUniquePtr() {
+        return std::make_unique<CDBTransactionIterator<CDBCompactTransaction>>(*this);
+    }
+};
+
 #endif // BITCOIN_DBWRAPPER_H
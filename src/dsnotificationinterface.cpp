@@ -14,6 +14,7 @@
 
 #include <evo/deterministicmns.h>
 #include <evo/mnauth.h>
+#include <evo/simplifiedmns.h>
 
 #include <llmq/quorums.h>
 #include <llmq/quorums_chainlocks.h>
@@ -71,20 +72,24 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
 
     llmq::quorumManager->UpdatedBlockTip(pindexNew, fInitialDownload);
     llmq::quorumDKGSessionManager->UpdatedBlockTip(pindexNew, fInitialDownload);
+    simplifiedMNListDiffCache.UpdatedBlockTip(pindexNew);
 
     if (!fDisableGovernance) governance.UpdatedBlockTip(pindexNew, connman);
 }
 
-void CDSNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcceptTime)
+void CDSNotificationInterface::TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs)
 {
-    llmq::quorumInstantSendManager->TransactionAddedToMempool(ptx);
-    llmq::chainLocksHandler->TransactionAddedToMempool(ptx, nAcceptTime);
-    CCoinJoin::TransactionAddedToMempool(ptx);
+    for (const auto& p : txs) {
+        llmq::quorumInstantSendManager->TransactionAddedToMempool(p.first);
+    }
+    llmq::chainLocksHandler->TransactionsAddedToMempool(txs);
+    CCoinJoin::TransactionsAddedToMempool(txs);
 }
 
 void CDSNotificationInterface::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason)
 {
     llmq::quorumInstantSendManager->TransactionRemovedFromMempool(ptx);
+    llmq::chainLocksHandler->TransactionRemovedFromMempool(ptx);
 }
 
 void CDSNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
@@ -115,8 +120,15 @@ void CDSNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDet
     governance.UpdateCachesAndClean();
 }
 
-void CDSNotificationInterface::NotifyChainLock(const CBlockIndex* pindex, const std::shared_ptr<const llmq::CChainLockSig>& clsig)
+void CDSNotificationInterface::NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks)
+{
+    llmq::chainLocksHandler->NotifyTransactionLocks(locks);
+}
+
+void CDSNotificationInterface::NotifyChainLocks(const std::vector<ChainLockEvent>& clsigs)
 {
+    // ChainLocks only move forward, so everything below the last one is covered by it
+    const CBlockIndex* pindex = clsigs.back().first;
     llmq::quorumInstantSendManager->NotifyChainLock(pindex);
     CCoinJoin::NotifyChainLock(pindex);
 }
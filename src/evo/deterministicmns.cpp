@@ -9,9 +9,11 @@
 #include <base58.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <memusage.h>
 #include <script/standard.h>
 #include <ui_interface.h>
 #include <validation.h>
+#include <util/memaccounting.h>
 #include <validationinterface.h>
 
 #include <llmq/quorums_commitment.h>
@@ -213,6 +215,53 @@ static bool CompareByLastPaid(const CDeterministicMNCPtr& _a, const CDeterminist
     return CompareByLastPaid(*_a, *_b);
 }
 
+CDeterministicMNListColumns::CDeterministicMNListColumns(const CDeterministicMNList& mnList)
+{
+    dmns.reserve(mnList.GetAllMNsCount());
+    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        dmns.emplace_back(dmn);
+    });
+    std::sort(dmns.begin(), dmns.end(), [](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
+        return a->proTxHash.Compare(b->proTxHash) < 0;
+    });
+
+    proTxHashes.reserve(dmns.size());
+    confirmedHashes.reserve(dmns.size());
+    addrs.reserve(dmns.size());
+    pubKeyOperators.reserve(dmns.size());
+    keyIDVotings.reserve(dmns.size());
+    scriptPayouts.reserve(dmns.size());
+    flags.reserve(dmns.size());
+    for (const auto& dmn : dmns) {
+        const auto& state = *dmn->pdmnState;
+        proTxHashes.emplace_back(dmn->proTxHash);
+        confirmedHashes.emplace_back(state.confirmedHash);
+        addrs.emplace_back(state.addr);
+        pubKeyOperators.emplace_back(state.pubKeyOperator);
+        keyIDVotings.emplace_back(state.keyIDVoting);
+        scriptPayouts.emplace_back(state.scriptPayout);
+        uint8_t f = 0;
+        if (CDeterministicMNList::IsMNValid(dmn)) {
+            f |= FLAG_VALID;
+        }
+        if (!state.confirmedHash.IsNull()) {
+            f |= FLAG_CONFIRMED;
+        }
+        flags.emplace_back(f);
+    }
+}
+
+CDeterministicMNListColumnsCPtr CDeterministicMNList::GetColumns() const
+{
+    // copies of the same list might be used from multiple threads, so make sure they see a complete view
+    auto ret = std::atomic_load(&columns);
+    if (!ret) {
+        ret = std::make_shared<const CDeterministicMNListColumns>(*this);
+        std::atomic_store(&columns, ret);
+    }
+    return ret;
+}
+
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
 {
     if (mnMap.size() == 0) {
@@ -236,12 +285,13 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
     }
 
     std::vector<CDeterministicMNCPtr> result;
-    result.reserve(nCount);
+    result.reserve(GetValidMNsCount());
 
     ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
         result.emplace_back(dmn);
     });
-    std::sort(result.begin(), result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
+    // callers usually only want the next few payees, no need to sort the whole list for that
+    std::partial_sort(result.begin(), result.begin() + nCount, result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
         return CompareByLastPaid(a, b);
     });
 
@@ -252,36 +302,58 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t maxSize, const uint256& modifier) const
 {
-    auto scores = CalculateScores(modifier);
+    return CalculateQuorum(GetQuorumCandidates(), maxSize, modifier);
+}
+
+std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier) const
+{
+    return CalculateScores(GetQuorumCandidates(), modifier);
+}
+
+std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetQuorumCandidates() const
+{
+    std::vector<CDeterministicMNCPtr> result;
+    result.reserve(GetAllMNsCount());
+    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+        if (dmn->pdmnState->confirmedHash.IsNull()) {
+            // we only take confirmed MNs into account to avoid hash grinding on the ProRegTxHash to sneak MNs into a
+            // future quorums
+            return;
+        }
+        result.emplace_back(dmn);
+    });
+    return result;
+}
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(const std::vector<CDeterministicMNCPtr>& candidates, size_t maxSize, const uint256& modifier)
+{
+    auto scores = CalculateScores(candidates, modifier);
+
+    // descending order. Only the top maxSize entries are sorted, this gives the same result as sorting all of them
+    auto cmp = [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
-    });
+        return b.first < a.first;
+    };
+    const size_t nCount = std::min(maxSize, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + nCount, scores.end(), cmp);
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(nCount);
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
     return result;
 }
 
-std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier) const
+std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const std::vector<CDeterministicMNCPtr>& candidates, const uint256& modifier)
 {
     std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
-    scores.reserve(GetAllMNsCount());
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (dmn->pdmnState->confirmedHash.IsNull()) {
-            // we only take confirmed MNs into account to avoid hash grinding on the ProRegTxHash to sneak MNs into a
-            // future quorums
-            return;
-        }
+    scores.reserve(candidates.size());
+    for (const auto& dmn : candidates) {
         // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
         // Please note that this is not a double-sha256 but a single-sha256
         // The first part is already precalculated (confirmedHashWithProRegTxHash)
@@ -293,7 +365,7 @@ std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList
         sha256.Finalize(h.begin());
 
         scores.emplace_back(UintToArith256(h), dmn);
-    });
+    }
 
     return scores;
 }
@@ -355,6 +427,22 @@ void CDeterministicMNList::PoSeDecrease(const uint256& proTxHash)
     UpdateMN(proTxHash, newState);
 }
 
+void CDeterministicMNList::PoSeDecrease(const std::vector<CDeterministicMNCPtr>& dmns)
+{
+    for (const auto& oldDmn : dmns) {
+        assert(oldDmn->pdmnState->nPoSePenalty > 0 && !oldDmn->pdmnState->IsBanned());
+        assert(mnMap.find(oldDmn->proTxHash) != nullptr);
+
+        auto newState = std::make_shared<CDeterministicMNState>(*oldDmn->pdmnState);
+        newState->nPoSePenalty--;
+
+        auto dmn = std::make_shared<CDeterministicMN>(*oldDmn);
+        dmn->pdmnState = std::move(newState);
+        mnMap = mnMap.set(oldDmn->proTxHash, std::move(dmn));
+    }
+    columns.reset();
+}
+
 CDeterministicMNListDiff CDeterministicMNList::BuildDiff(const CDeterministicMNList& to) const
 {
     CDeterministicMNListDiff diffRet;
@@ -392,18 +480,24 @@ CSimplifiedMNListDiff CDeterministicMNList::BuildSimplifiedDiff(const CDetermini
     diffRet.baseBlockHash = blockHash;
     diffRet.blockHash = to.blockHash;
 
+    // Building and comparing the entries is independent for each MN, which matters for diffs from far back
+    std::vector<CDeterministicMNCPtr> toMNs;
+    toMNs.reserve(to.GetAllMNsCount());
     to.ForEachMN(false, [&](const CDeterministicMNCPtr& toPtr) {
-        auto fromPtr = GetMN(toPtr->proTxHash);
-        if (fromPtr == nullptr) {
-            diffRet.mnList.emplace_back(*toPtr);
-        } else {
-            CSimplifiedMNListEntry sme1(*toPtr);
-            CSimplifiedMNListEntry sme2(*fromPtr);
-            if (sme1 != sme2) {
-                diffRet.mnList.emplace_back(*toPtr);
-            }
+        toMNs.emplace_back(toPtr);
+    });
+    std::vector<char> vecChanged(toMNs.size());
+    ParallelForSimplifiedMNs(toMNs.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto fromPtr = GetMN(toMNs[i]->proTxHash);
+            vecChanged[i] = fromPtr == nullptr || CSimplifiedMNListEntry(*toMNs[i]) != CSimplifiedMNListEntry(*fromPtr);
         }
     });
+    for (size_t i = 0; i < toMNs.size(); i++) {
+        if (vecChanged[i]) {
+            diffRet.mnList.emplace_back(*toMNs[i]);
+        }
+    }
     ForEachMN(false, [&](const CDeterministicMNCPtr& fromPtr) {
         auto toPtr = to.GetMN(fromPtr->proTxHash);
         if (toPtr == nullptr) {
@@ -449,33 +543,34 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
         throw(std::runtime_error(strprintf("%s: Can't add a masternode with a duplicate internalId=%d", __func__, dmn->GetInternalId())));
     }
 
-    // All mnUniquePropertyMap's updates must be atomic.
-    // Using this temporary map as a checkpoint to rollback to in case of any issues.
-    decltype(mnUniquePropertyMap) mnUniquePropertyMapSaved = mnUniquePropertyMap;
+    // All mnUniqueProperties' updates must be atomic.
+    // Using this temporary copy as a checkpoint to rollback to in case of any issues.
+    decltype(mnUniqueProperties) mnUniquePropertiesSaved = mnUniqueProperties;
 
     if (!AddUniqueProperty(dmn, dmn->collateralOutpoint)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't add a masternode %s with a duplicate collateralOutpoint=%s", __func__,
                 dmn->proTxHash.ToString(), dmn->collateralOutpoint.ToStringShort())));
     }
     if (dmn->pdmnState->addr != CService() && !AddUniqueProperty(dmn, dmn->pdmnState->addr)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't add a masternode %s with a duplicate address=%s", __func__,
                 dmn->proTxHash.ToString(), dmn->pdmnState->addr.ToStringIPPort(false))));
     }
     if (!AddUniqueProperty(dmn, dmn->pdmnState->keyIDOwner)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't add a masternode %s with a duplicate keyIDOwner=%s", __func__,
                 dmn->proTxHash.ToString(), EncodeDestination(dmn->pdmnState->keyIDOwner))));
     }
     if (dmn->pdmnState->pubKeyOperator.Get().IsValid() && !AddUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't add a masternode %s with a duplicate pubKeyOperator=%s", __func__,
                 dmn->proTxHash.ToString(), dmn->pdmnState->pubKeyOperator.Get().ToString())));
     }
 
     mnMap = mnMap.set(dmn->proTxHash, dmn);
     mnInternalIdMap = mnInternalIdMap.set(dmn->GetInternalId(), dmn->proTxHash);
+    columns.reset();
     if (fBumpTotalCount) {
         // nTotalRegisteredCount acts more like a checkpoint, not as a limit,
         nTotalRegisteredCount = std::max(dmn->GetInternalId() + 1, (uint64_t)nTotalRegisteredCount);
@@ -490,27 +585,28 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CD
     auto oldState = dmn->pdmnState;
     dmn->pdmnState = pdmnState;
 
-    // All mnUniquePropertyMap's updates must be atomic.
-    // Using this temporary map as a checkpoint to rollback to in case of any issues.
-    decltype(mnUniquePropertyMap) mnUniquePropertyMapSaved = mnUniquePropertyMap;
+    // All mnUniqueProperties' updates must be atomic.
+    // Using this temporary copy as a checkpoint to rollback to in case of any issues.
+    decltype(mnUniqueProperties) mnUniquePropertiesSaved = mnUniqueProperties;
 
     if (!UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't update a masternode %s with a duplicate address=%s", __func__,
                 oldDmn->proTxHash.ToString(), pdmnState->addr.ToStringIPPort(false))));
     }
     if (!UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't update a masternode %s with a duplicate keyIDOwner=%s", __func__,
                 oldDmn->proTxHash.ToString(), EncodeDestination(pdmnState->keyIDOwner))));
     }
     if (!UpdateUniqueProperty(dmn, oldState->pubKeyOperator, pdmnState->pubKeyOperator)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't update a masternode %s with a duplicate pubKeyOperator=%s", __func__,
                 oldDmn->proTxHash.ToString(), pdmnState->pubKeyOperator.Get().ToString())));
     }
 
     mnMap = mnMap.set(oldDmn->proTxHash, dmn);
+    columns.reset();
 }
 
 void CDeterministicMNList::UpdateMN(const uint256& proTxHash, const CDeterministicMNStateCPtr& pdmnState)
@@ -538,38 +634,49 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
         throw(std::runtime_error(strprintf("%s: Can't find a masternode with proTxHash=%s", __func__, proTxHash.ToString())));
     }
 
-    // All mnUniquePropertyMap's updates must be atomic.
-    // Using this temporary map as a checkpoint to rollback to in case of any issues.
-    decltype(mnUniquePropertyMap) mnUniquePropertyMapSaved = mnUniquePropertyMap;
+    // All mnUniqueProperties' updates must be atomic.
+    // Using this temporary copy as a checkpoint to rollback to in case of any issues.
+    decltype(mnUniqueProperties) mnUniquePropertiesSaved = mnUniqueProperties;
 
     if (!DeleteUniqueProperty(dmn, dmn->collateralOutpoint)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't delete a masternode %s with a collateralOutpoint=%s", __func__,
                 proTxHash.ToString(), dmn->collateralOutpoint.ToStringShort())));
     }
     if (dmn->pdmnState->addr != CService() && !DeleteUniqueProperty(dmn, dmn->pdmnState->addr)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't delete a masternode %s with a address=%s", __func__,
                 proTxHash.ToString(), dmn->pdmnState->addr.ToStringIPPort(false))));
     }
     if (!DeleteUniqueProperty(dmn, dmn->pdmnState->keyIDOwner)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't delete a masternode %s with a keyIDOwner=%s", __func__,
                 proTxHash.ToString(), EncodeDestination(dmn->pdmnState->keyIDOwner))));
     }
     if (dmn->pdmnState->pubKeyOperator.Get().IsValid() && !DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator)) {
-        mnUniquePropertyMap = mnUniquePropertyMapSaved;
+        mnUniqueProperties = mnUniquePropertiesSaved;
         throw(std::runtime_error(strprintf("%s: Can't delete a masternode %s with a pubKeyOperator=%s", __func__,
                 proTxHash.ToString(), dmn->pdmnState->pubKeyOperator.Get().ToString())));
     }
 
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
+    columns.reset();
 }
 
 CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
-    evoDb(_evoDb)
+    evoDb(_evoDb),
+    nMaxCacheMemory((size_t)std::max<int64_t>(0, gArgs.GetArg("-mnlistcachesize", DEFAULT_MNLIST_CACHE_SIZE)) * 1024 * 1024)
 {
+    memaccounting::Register("mnlistcache", this, [this]() {
+        LOCK(cs);
+        return nCacheMemory;
+    });
+}
+
+CDeterministicMNManager::~CDeterministicMNManager()
+{
+    memaccounting::Unregister(this);
 }
 
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, const CCoinsViewCache& view, bool fJustCheck)
@@ -611,13 +718,17 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
         if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
-            mnListsCache.emplace(newList.GetBlockHash(), newList);
+            AddListToCache(newList.GetBlockHash(), newList);
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
                 __func__, nHeight, newList.GetAllMNsCount());
+        } else if (reorgForkIndex) {
+            // the blocks of the new chain are connected in a row before the tip is updated, so let each one build on
+            // the list of its predecessor instead of replaying from the fork point
+            AddListToCache(newList.GetBlockHash(), newList);
         }
 
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), diff);
+        AddDiffToCache(pindex->GetBlockHash(), diff);
     } catch (const std::exception& e) {
         LogPrintf("CDeterministicMNManager::%s -- internal error: %s\n", __func__, e.what());
         return _state.DoS(100, false, REJECT_INVALID, "failed-dmn-block");
@@ -662,8 +773,22 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
             prevList = GetListForBlock(pindex->pprev);
         }
 
-        mnListsCache.erase(blockHash);
-        mnListDiffsCache.erase(blockHash);
+        auto itList = mnListsCache.find(blockHash);
+        if (itList != mnListsCache.end()) {
+            nCacheMemory -= itList->second.nMemoryUsage;
+            mnListsCache.erase(itList);
+        }
+        auto itDiff = mnListDiffsCache.find(blockHash);
+        if (itDiff != mnListDiffsCache.end()) {
+            nCacheMemory -= itDiff->second.nMemoryUsage;
+            mnListDiffsCache.erase(itDiff);
+        }
+        mnListCheckpointsCache.erase(blockHash);
+
+        if (diff.HasChanges()) {
+            // the previous block becomes the tip, keep its list for the next undo or the next block to connect
+            AddListToCache(pindex->pprev->GetBlockHash(), prevList);
+        }
     }
 
     if (diff.HasChanges()) {
@@ -685,6 +810,54 @@ void CDeterministicMNManager::UpdatedBlockTip(const CBlockIndex* pindex)
     LOCK(cs);
 
     tipIndex = pindex;
+    reorgForkIndex = nullptr;
+    nTipListChangeCounter++;
+}
+
+void CDeterministicMNManager::PrepareReorg(const CBlockIndex* pindexTip, const CBlockIndex* pindexFork)
+{
+    if (!pindexTip || !pindexFork || pindexTip == pindexFork) {
+        return;
+    }
+
+    LOCK(cs);
+
+    reorgForkIndex = pindexFork;
+
+    std::vector<const CBlockIndex*> vecIndexes;
+    vecIndexes.reserve(pindexTip->nHeight - pindexFork->nHeight);
+    for (const CBlockIndex* pindex = pindexTip; pindex != pindexFork; pindex = pindex->pprev) {
+        vecIndexes.emplace_back(pindex);
+    }
+
+    // without this, every UndoBlock call would replay the diffs from the last snapshot for both its block and the
+    // previous one, as only the list of the tip and of quorum heights are cached
+    auto mnList = GetListForBlock(pindexFork);
+    AddListToCache(pindexFork->GetBlockHash(), mnList);
+    for (auto it = vecIndexes.rbegin(); it != vecIndexes.rend(); ++it) {
+        const CBlockIndex* pindex = *it;
+        if (mnListsCache.count(pindex->GetBlockHash())) {
+            mnList = mnListsCache.at(pindex->GetBlockHash()).mnList;
+            continue;
+        }
+        CDeterministicMNListDiff diff;
+        auto itDiff = mnListDiffsCache.find(pindex->GetBlockHash());
+        if (itDiff != mnListDiffsCache.end()) {
+            diff = itDiff->second.diff;
+        } else if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+            // let UndoBlock fall back to the regular lookup
+            break;
+        }
+        if (diff.HasChanges()) {
+            mnList = mnList.ApplyDiff(pindex, diff);
+        } else {
+            mnList.SetBlockHash(pindex->GetBlockHash());
+            mnList.SetHeight(pindex->nHeight);
+        }
+        AddListToCache(pindex->GetBlockHash(), mnList);
+    }
+
+    CleanupCache(pindexTip->nHeight);
 }
 
 bool CDeterministicMNManager::BuildNewListFromBlock(const CBlock& block, const CBlockIndex* pindexPrev, CValidationState& _state, const CCoinsViewCache& view, CDeterministicMNList& mnListRet, bool debugLogs)
@@ -940,19 +1113,17 @@ void CDeterministicMNManager::HandleQuorumCommitment(llmq::CFinalCommitment& qc,
 
 void CDeterministicMNManager::DecreasePoSePenalties(CDeterministicMNList& mnList)
 {
-    std::vector<uint256> toDecrease;
-    toDecrease.reserve(mnList.GetValidMNsCount() / 10);
+    std::vector<CDeterministicMNCPtr> toDecrease;
+    toDecrease.reserve(mnList.GetAllMNsCount() / 10);
     // only iterate and decrease for valid ones (not PoSe banned yet)
     // if a MN ever reaches the maximum, it stays in PoSe banned state until revived
     mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
         if (dmn->pdmnState->nPoSePenalty > 0 && !dmn->pdmnState->IsBanned()) {
-            toDecrease.emplace_back(dmn->proTxHash);
+            toDecrease.emplace_back(dmn);
         }
     });
 
-    for (const auto& proTxHash : toDecrease) {
-        mnList.PoSeDecrease(proTxHash);
-    }
+    mnList.PoSeDecrease(toDecrease);
 }
 
 CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex* pindex)
@@ -966,18 +1137,28 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         // try using cache before reading from disk
         auto itLists = mnListsCache.find(pindex->GetBlockHash());
         if (itLists != mnListsCache.end()) {
-            snapshot = itLists->second;
+            itLists->second.nLastUse = ++nCacheClock;
+            nListCacheHits++;
+            snapshot = itLists->second.mnList;
+            break;
+        }
+
+        if (mnListCheckpointsCache.get(pindex->GetBlockHash(), snapshot)) {
+            nListCacheHits++;
             break;
         }
 
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            nListCacheMisses++;
+            AddListToCache(pindex->GetBlockHash(), snapshot);
             break;
         }
 
         // no snapshot found yet, check diffs
         auto itDiffs = mnListDiffsCache.find(pindex->GetBlockHash());
         if (itDiffs != mnListDiffsCache.end()) {
+            itDiffs->second.nLastUse = ++nCacheClock;
+            nDiffCacheHits++;
             listDiffIndexes.emplace_front(pindex);
             pindex = pindex->pprev;
             continue;
@@ -987,38 +1168,40 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
             // no snapshot and no diff on disk means that it's the initial snapshot
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            AddListToCache(pindex->GetBlockHash(), snapshot);
             break;
         }
 
+        nDiffCacheMisses++;
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), std::move(diff));
+        AddDiffToCache(pindex->GetBlockHash(), diff);
         listDiffIndexes.emplace_front(pindex);
         pindex = pindex->pprev;
     }
 
+    // only leave checkpoints behind when the replay was long, short replays are cheap enough
+    bool fCheckpoints = listDiffIndexes.size() >= (size_t)LIST_CHECKPOINT_PERIOD;
     for (const auto& diffIndex : listDiffIndexes) {
-        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
+        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash()).diff;
         if (diff.HasChanges()) {
             snapshot = snapshot.ApplyDiff(diffIndex, diff);
         } else {
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        if (fCheckpoints && (diffIndex->nHeight % LIST_CHECKPOINT_PERIOD) == 0) {
+            mnListCheckpointsCache.insert(diffIndex->GetBlockHash(), snapshot);
+        }
     }
 
     if (tipIndex) {
-        // always keep a snapshot for the tip
-        if (snapshot.GetBlockHash() == tipIndex->GetBlockHash()) {
-            mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-        } else {
-            // keep snapshots for yet alive quorums
-            for (auto& p_llmq : Params().GetConsensus().llmqs) {
-                if ((snapshot.GetHeight() % p_llmq.second.dkgInterval == 0) && (snapshot.GetHeight() + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= tipIndex->nHeight)) {
-                    mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-                    break;
-                }
-            }
+        // always keep a snapshot for the tip and for yet alive quorums
+        if (IsListCacheRequired(snapshot, tipIndex->nHeight)) {
+            AddListToCache(snapshot.GetBlockHash(), snapshot);
+        }
+        // long replays of historical diffs might have pushed the cache beyond its limit
+        if (nCacheMemory > nMaxCacheMemory) {
+            CleanupCache(tipIndex->nHeight);
         }
     }
 
@@ -1031,7 +1214,14 @@ CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
     if (!tipIndex) {
         return {};
     }
-    return GetListForBlock(tipIndex);
+    auto mnList = GetListForBlock(tipIndex);
+    // build the columnar view only once per tip, all copies handed out later share it
+    auto it = mnListsCache.find(tipIndex->GetBlockHash());
+    if (it != mnListsCache.end()) {
+        it->second.mnList.GetColumns();
+        return it->second.mnList;
+    }
+    return mnList;
 }
 
 bool CDeterministicMNManager::IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n)
@@ -1067,53 +1257,122 @@ bool CDeterministicMNManager::IsDIP3Enforced(int nHeight)
     return nHeight >= Params().GetConsensus().DIP0003EnforcementHeight;
 }
 
+// The persistent maps share most of their nodes with other lists, so this is only an upper bound of what a single list
+// keeps alive. States are not accounted as they are shared with all the other lists and diffs.
+static size_t GetListMemoryUsage(const CDeterministicMNList& mnList)
+{
+    static const size_t entryUsage = sizeof(CDeterministicMNList::MnMap::value_type) +
+                                     sizeof(CDeterministicMNList::MnInternalIdMap::value_type) +
+                                     sizeof(CDeterministicMNList::MnUniquePropertyMap<COutPoint>::value_type) +
+                                     sizeof(CDeterministicMNList::MnUniquePropertyMap<CService>::value_type) +
+                                     sizeof(CDeterministicMNList::MnUniquePropertyMap<CKeyID>::value_type) +
+                                     sizeof(CDeterministicMNList::MnUniquePropertyMap<CBLSPublicKeyBytes>::value_type);
+    return sizeof(CDeterministicMNList) + mnList.GetAllMNsCount() * entryUsage;
+}
+
+static size_t GetDiffMemoryUsage(const CDeterministicMNListDiff& diff)
+{
+    return sizeof(CDeterministicMNListDiff) +
+           memusage::DynamicUsage(diff.addedMNs) +
+           diff.addedMNs.size() * (memusage::MallocUsage(sizeof(CDeterministicMN)) + memusage::MallocUsage(sizeof(CDeterministicMNState))) +
+           memusage::DynamicUsage(diff.updatedMNs) +
+           memusage::DynamicUsage(diff.removedMns);
+}
+
+void CDeterministicMNManager::AddListToCache(const uint256& blockHash, const CDeterministicMNList& mnList)
+{
+    AssertLockHeld(cs);
+
+    auto p = mnListsCache.emplace(blockHash, CachedList{mnList, 0, 0});
+    if (p.second) {
+        p.first->second.nMemoryUsage = GetListMemoryUsage(mnList);
+        nCacheMemory += p.first->second.nMemoryUsage;
+    }
+    p.first->second.nLastUse = ++nCacheClock;
+}
+
+void CDeterministicMNManager::AddDiffToCache(const uint256& blockHash, const CDeterministicMNListDiff& diff)
+{
+    AssertLockHeld(cs);
+
+    auto p = mnListDiffsCache.emplace(blockHash, CachedDiff{diff, 0, 0});
+    if (p.second) {
+        p.first->second.nMemoryUsage = GetDiffMemoryUsage(diff);
+        nCacheMemory += p.first->second.nMemoryUsage;
+    }
+    p.first->second.nLastUse = ++nCacheClock;
+}
+
+bool CDeterministicMNManager::IsListCacheRequired(const CDeterministicMNList& mnList, int nHeight) const
+{
+    if (tipIndex && mnList.GetBlockHash() == tipIndex->GetBlockHash()) {
+        return true;
+    }
+    if (reorgForkIndex && mnList.GetBlockHash() == reorgForkIndex->GetBlockHash()) {
+        return true;
+    }
+    for (auto& p_llmq : Params().GetConsensus().llmqs) {
+        if ((mnList.GetHeight() % p_llmq.second.dkgInterval == 0) && (mnList.GetHeight() + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= nHeight)) {
+            // at least one quorum could be using it
+            return true;
+        }
+    }
+    return false;
+}
+
 void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
 
-    std::vector<uint256> toDeleteLists;
-    std::vector<uint256> toDeleteDiffs;
+    if (nCacheMemory <= nMaxCacheMemory) {
+        return;
+    }
+
+    // (last use, block hash, is list)
+    std::vector<std::tuple<uint64_t, uint256, bool>> candidates;
+    candidates.reserve(mnListsCache.size() + mnListDiffsCache.size());
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            toDeleteLists.emplace_back(p.first);
-            continue;
-        }
-        bool fQuorumCache{false};
-        for (auto& p_llmq : Params().GetConsensus().llmqs) {
-            if ((p.second.GetHeight() % p_llmq.second.dkgInterval == 0) && (p.second.GetHeight() + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= nHeight)) {
-                fQuorumCache = true;
-                break;
-            }
-        }
-        if (fQuorumCache) {
-            // at least one quorum could be using it, keep it
-            continue;
-        }
-        // no alive quorums using it, see if it was a cache for the tip or for a now outdated quorum
-        if (tipIndex && tipIndex->pprev && (p.first == tipIndex->pprev->GetBlockHash())) {
-            toDeleteLists.emplace_back(p.first);
-        } else {
-            for (auto& p_llmq : Params().GetConsensus().llmqs) {
-                if (p.second.GetHeight() % p_llmq.second.dkgInterval == 0) {
-                    toDeleteLists.emplace_back(p.first);
-                    break;
-                }
-            }
+        if (!IsListCacheRequired(p.second.mnList, nHeight)) {
+            candidates.emplace_back(p.second.nLastUse, p.first, true);
         }
     }
-    for (const auto& h : toDeleteLists) {
-        mnListsCache.erase(h);
-    }
     for (const auto& p : mnListDiffsCache) {
-        if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            toDeleteDiffs.emplace_back(p.first);
-        }
+        candidates.emplace_back(p.second.nLastUse, p.first, false);
     }
-    for (const auto& h : toDeleteDiffs) {
-        mnListDiffsCache.erase(h);
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& c : candidates) {
+        if (nCacheMemory <= nMaxCacheMemory) {
+            break;
+        }
+        if (std::get<2>(c)) {
+            auto it = mnListsCache.find(std::get<1>(c));
+            nCacheMemory -= it->second.nMemoryUsage;
+            mnListsCache.erase(it);
+        } else {
+            auto it = mnListDiffsCache.find(std::get<1>(c));
+            nCacheMemory -= it->second.nMemoryUsage;
+            mnListDiffsCache.erase(it);
+        }
     }
 }
 
+void CDeterministicMNManager::CacheStatsToJson(UniValue& obj)
+{
+    LOCK(cs);
+
+    obj.clear();
+    obj.setObject();
+    obj.pushKV("lists", (uint64_t)mnListsCache.size());
+    obj.pushKV("diffs", (uint64_t)mnListDiffsCache.size());
+    obj.pushKV("usage", (uint64_t)nCacheMemory);
+    obj.pushKV("max_usage", (uint64_t)nMaxCacheMemory);
+    obj.pushKV("list_hits", nListCacheHits);
+    obj.pushKV("list_misses", nListCacheMisses);
+    obj.pushKV("diff_hits", nDiffCacheHits);
+    obj.pushKV("diff_misses", nDiffCacheMisses);
+}
+
 void CDeterministicMNManager::UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList)
 {
     CDataStream oldDiffData(SER_DISK, CLIENT_VERSION);
@@ -1184,6 +1443,7 @@ bool CDeterministicMNManager::UpgradeDBIfNeeded()
         return false;
     }
     evoDb.GetRawDB().Erase(std::string("b_b"));
+    evoDb.ClearReadCache();
 
     if (chainActive.Height() < Params().GetConsensus().DIP0003Height) {
         // not reached DIP3 height yet, so no upgrade needed
@@ -1217,6 +1477,7 @@ bool CDeterministicMNManager::UpgradeDBIfNeeded()
     }
 
     evoDb.GetRawDB().WriteBatch(batch);
+    evoDb.ClearReadCache();
 
     LogPrintf("CDeterministicMNManager::%s -- done upgrading\n", __func__);
 
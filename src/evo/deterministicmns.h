@@ -10,9 +10,12 @@
 #include <evo/providertx.h>
 #include <saltedhasher.h>
 #include <sync.h>
+#include <unordered_lru_cache.h>
 
 #include <immer/map.hpp>
 
+#include <array>
+#include <atomic>
 #include <unordered_map>
 
 class CBlock;
@@ -260,6 +263,38 @@ public:
 typedef std::shared_ptr<const CDeterministicMN> CDeterministicMNCPtr;
 
 class CDeterministicMNListDiff;
+class CDeterministicMNList;
+
+/**
+ * Immutable column-wise copy of the most frequently read fields of a CDeterministicMNList, sorted by proTxHash.
+ * It's built once per list and then shared read-only between all copies of that list until one of them is modified.
+ * Iterating it avoids chasing the CDeterministicMN and CDeterministicMNState pointers of every single MN.
+ */
+class CDeterministicMNListColumns
+{
+public:
+    enum : uint8_t {
+        FLAG_VALID = 1 << 0,
+        FLAG_CONFIRMED = 1 << 1,
+    };
+
+    std::vector<CDeterministicMNCPtr> dmns;
+    std::vector<uint256> proTxHashes;
+    std::vector<uint256> confirmedHashes;
+    std::vector<CService> addrs;
+    std::vector<CBLSLazyPublicKey> pubKeyOperators;
+    std::vector<CKeyID> keyIDVotings;
+    std::vector<CScript> scriptPayouts;
+    std::vector<uint8_t> flags;
+
+public:
+    explicit CDeterministicMNListColumns(const CDeterministicMNList& mnList);
+
+    size_t size() const { return dmns.size(); }
+    bool IsValid(size_t i) const { return (flags[i] & FLAG_VALID) != 0; }
+    bool IsConfirmed(size_t i) const { return (flags[i] & FLAG_CONFIRMED) != 0; }
+};
+typedef std::shared_ptr<const CDeterministicMNListColumns> CDeterministicMNListColumnsCPtr;
 
 template <typename Stream, typename K, typename T, typename Hash, typename Equal>
 void SerializeImmerMap(Stream& os, const immer::map<K, T, Hash, Equal>& m)
@@ -296,12 +331,61 @@ inline void SerReadWrite(Stream& s, immer::map<K, T, Hash, Equal>& obj, CSerActi
 }
 
 
+// Serialized BLS public key, operator keys are indexed by these so that lookups neither hash nor deserialize them
+typedef std::array<uint8_t, CBLSPublicKey::SerSize> CBLSPublicKeyBytes;
+
+template<>
+struct SaltedHasherImpl<COutPoint>
+{
+    static std::size_t CalcHash(const COutPoint& v, uint64_t k0, uint64_t k1)
+    {
+        return SipHashUint256Extra(k0, k1, v.hash, v.n);
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CService>
+{
+    static std::size_t CalcHash(const CService& v, uint64_t k0, uint64_t k1)
+    {
+        return v.GetSipHash(k0, k1);
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CKeyID>
+{
+    static std::size_t CalcHash(const CKeyID& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write(v.begin(), v.size()).Finalize();
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CBLSPublicKeyBytes>
+{
+    static std::size_t CalcHash(const CBLSPublicKeyBytes& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write(v.data(), v.size()).Finalize();
+    }
+};
+
 class CDeterministicMNList
 {
 public:
     typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
     typedef immer::map<uint64_t, uint256> MnInternalIdMap;
-    typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    // value is the proTxHash of the owning MN and how often it uses the property
+    template <typename K>
+    using MnUniquePropertyMap = immer::map<K, std::pair<uint256, uint32_t>, StaticSaltedHasher>;
+
+    struct MnUniqueProperties
+    {
+        MnUniquePropertyMap<COutPoint> collateralOutpoints;
+        MnUniquePropertyMap<CService> addresses;
+        MnUniquePropertyMap<CKeyID> ownerKeys;
+        MnUniquePropertyMap<CBLSPublicKeyBytes> operatorKeys;
+    };
 
 private:
     uint256 blockHash;
@@ -310,9 +394,12 @@ private:
     MnMap mnMap;
     MnInternalIdMap mnInternalIdMap;
 
-    // map of unique properties like address and keys
+    // maps of unique properties like address and keys, keyed by the properties themselves
     // we keep track of this as checking for duplicates would otherwise be painfully slow
-    MnUniquePropertyMap mnUniquePropertyMap;
+    MnUniqueProperties mnUniqueProperties;
+
+    // built on first use and reset whenever the list is modified, see GetColumns()
+    mutable CDeterministicMNListColumnsCPtr columns;
 
 public:
     CDeterministicMNList() = default;
@@ -344,8 +431,9 @@ public:
 
     template<typename Stream>
     void Unserialize(Stream& s) {
+        columns.reset();
         mnMap = MnMap();
-        mnUniquePropertyMap = MnUniquePropertyMap();
+        mnUniqueProperties = MnUniqueProperties();
         mnInternalIdMap = MnInternalIdMap();
 
         SerializationOpBase(s, CSerActionUnserialize());
@@ -357,6 +445,12 @@ public:
     }
 
 public:
+    /**
+     * Returns the columnar view of this list, building it on first use.
+     * Copies of this list made afterwards share the same view until they are modified.
+     */
+    CDeterministicMNListColumnsCPtr GetColumns() const;
+
     size_t GetAllMNsCount() const
     {
         return mnMap.size();
@@ -448,6 +542,15 @@ public:
     std::vector<CDeterministicMNCPtr> CalculateQuorum(size_t maxSize, const uint256& modifier) const;
     std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CalculateScores(const uint256& modifier) const;
 
+    /**
+     * Returns all valid MNs which can be selected for quorums, which are the ones with a confirmedHash. The result does
+     * not depend on the modifier, so it can be shared by the calculations of all LLMQ types at the same block
+     * @return
+     */
+    std::vector<CDeterministicMNCPtr> GetQuorumCandidates() const;
+    static std::vector<CDeterministicMNCPtr> CalculateQuorum(const std::vector<CDeterministicMNCPtr>& candidates, size_t maxSize, const uint256& modifier);
+    static std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CalculateScores(const std::vector<CDeterministicMNCPtr>& candidates, const uint256& modifier);
+
     /**
      * Calculates the maximum penalty which is allowed at the height of this MN list. It is dynamic and might change
      * for every block.
@@ -481,6 +584,14 @@ public:
      */
     void PoSeDecrease(const uint256& proTxHash);
 
+    /**
+     * Decrease penalty score of all passed MNs by 1 in one go.
+     * Only allowed on non-banned MNs which are part of this list. As decreasing the penalty can't change any of the
+     * unique properties, this skips the unique property bookkeeping and lookups done by UpdateMN.
+     * @param dmns
+     */
+    void PoSeDecrease(const std::vector<CDeterministicMNCPtr>& dmns);
+
     CDeterministicMNListDiff BuildDiff(const CDeterministicMNList& to) const;
     CSimplifiedMNListDiff BuildSimplifiedDiff(const CDeterministicMNList& to) const;
     CDeterministicMNList ApplyDiff(const CBlockIndex* pindex, const CDeterministicMNListDiff& diff) const;
@@ -494,12 +605,12 @@ public:
     template <typename T>
     bool HasUniqueProperty(const T& v) const
     {
-        return mnUniquePropertyMap.count(::SerializeHash(v)) != 0;
+        return GetUniquePropertyMap(mnUniqueProperties, v).count(GetUniquePropertyKey(v)) != 0;
     }
     template <typename T>
     CDeterministicMNCPtr GetUniquePropertyMN(const T& v) const
     {
-        auto p = mnUniquePropertyMap.find(::SerializeHash(v));
+        auto p = GetUniquePropertyMap(mnUniqueProperties, v).find(GetUniquePropertyKey(v));
         if (!p) {
             return nullptr;
         }
@@ -507,6 +618,31 @@ public:
     }
 
 private:
+    // Select the map and the key for a property. Operator keys are found by their serialization, no matter if they
+    // are passed as CBLSPublicKey or CBLSLazyPublicKey.
+    template <typename Properties>
+    static auto& GetUniquePropertyMap(Properties& properties, const COutPoint&) { return properties.collateralOutpoints; }
+    template <typename Properties>
+    static auto& GetUniquePropertyMap(Properties& properties, const CService&) { return properties.addresses; }
+    template <typename Properties>
+    static auto& GetUniquePropertyMap(Properties& properties, const CKeyID&) { return properties.ownerKeys; }
+    template <typename Properties>
+    static auto& GetUniquePropertyMap(Properties& properties, const CBLSPublicKey&) { return properties.operatorKeys; }
+    template <typename Properties>
+    static auto& GetUniquePropertyMap(Properties& properties, const CBLSLazyPublicKey&) { return properties.operatorKeys; }
+
+    static const COutPoint& GetUniquePropertyKey(const COutPoint& v) { return v; }
+    static const CService& GetUniquePropertyKey(const CService& v) { return v; }
+    static const CKeyID& GetUniquePropertyKey(const CKeyID& v) { return v; }
+    static CBLSPublicKeyBytes GetUniquePropertyKey(const CBLSPublicKey& v)
+    {
+        CBLSPublicKeyBytes ret;
+        auto vecBytes = v.ToByteVector();
+        std::copy(vecBytes.begin(), vecBytes.end(), ret.begin());
+        return ret;
+    }
+    static CBLSPublicKeyBytes GetUniquePropertyKey(const CBLSLazyPublicKey& v) { return v.ToByteArray(); }
+
     template <typename T>
     [[nodiscard]] bool AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -515,8 +651,9 @@ private:
             return false;
         }
 
-        auto hash = ::SerializeHash(v);
-        auto oldEntry = mnUniquePropertyMap.find(hash);
+        auto& map = GetUniquePropertyMap(mnUniqueProperties, v);
+        auto key = GetUniquePropertyKey(v);
+        auto oldEntry = map.find(key);
         if (oldEntry != nullptr && oldEntry->first != dmn->proTxHash) {
             return false;
         }
@@ -524,7 +661,7 @@ private:
         if (oldEntry != nullptr) {
             newEntry.second = oldEntry->second + 1;
         }
-        mnUniquePropertyMap = mnUniquePropertyMap.set(hash, newEntry);
+        map = map.set(key, newEntry);
         return true;
     }
     template <typename T>
@@ -535,15 +672,16 @@ private:
             return false;
         }
 
-        auto oldHash = ::SerializeHash(oldValue);
-        auto p = mnUniquePropertyMap.find(oldHash);
+        auto& map = GetUniquePropertyMap(mnUniqueProperties, oldValue);
+        auto oldKey = GetUniquePropertyKey(oldValue);
+        auto p = map.find(oldKey);
         if (p == nullptr || p->first != dmn->proTxHash) {
             return false;
         }
         if (p->second == 1) {
-            mnUniquePropertyMap = mnUniquePropertyMap.erase(oldHash);
+            map = map.erase(oldKey);
         } else {
-            mnUniquePropertyMap = mnUniquePropertyMap.set(oldHash, std::make_pair(dmn->proTxHash, p->second - 1));
+            map = map.set(oldKey, std::make_pair(dmn->proTxHash, p->second - 1));
         }
         return true;
     }
@@ -656,11 +794,15 @@ public:
     }
 };
 
+/** Default for -mnlistcachesize, maximum memory in MiB used for cached MN lists and diffs */
+static const int64_t DEFAULT_MNLIST_CACHE_SIZE = 128;
+
 class CDeterministicMNManager
 {
     static const int DISK_SNAPSHOT_PERIOD = 576; // once per day
-    static const int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
-    static const int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
+    // in-memory checkpoints between two disk snapshots, only created when a list had to be built by replaying diffs
+    static const int LIST_CHECKPOINT_PERIOD = 32;
+    static const int LIST_CHECKPOINTS_CACHE_SIZE = 256;
 
 public:
     CCriticalSection cs;
@@ -668,15 +810,44 @@ public:
 private:
     CEvoDB& evoDb;
 
-    std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache;
-    std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache;
+    struct CachedList {
+        CDeterministicMNList mnList;
+        size_t nMemoryUsage;
+        uint64_t nLastUse;
+    };
+    struct CachedDiff {
+        CDeterministicMNListDiff diff;
+        size_t nMemoryUsage;
+        uint64_t nLastUse;
+    };
+
+    // Lists and diffs are evicted in least recently used order as soon as the cache grows beyond nMaxCacheMemory.
+    // The list of the tip and lists of still alive quorums are never evicted.
+    const size_t nMaxCacheMemory;
+    size_t nCacheMemory{0};
+    uint64_t nCacheClock{0};
+    uint64_t nListCacheHits{0};
+    uint64_t nListCacheMisses{0};
+    uint64_t nDiffCacheHits{0};
+    uint64_t nDiffCacheMisses{0};
+    std::unordered_map<uint256, CachedList, StaticSaltedHasher> mnListsCache;
+    std::unordered_map<uint256, CachedDiff, StaticSaltedHasher> mnListDiffsCache;
+    // intermediate lists which bound the number of diffs to replay for historical heights that were requested before
+    unordered_lru_cache<uint256, CDeterministicMNList, StaticSaltedHasher, LIST_CHECKPOINTS_CACHE_SIZE> mnListCheckpointsCache;
     const CBlockIndex* tipIndex{nullptr};
+    // fork point of a reorg in progress, its list is kept until the new tip is announced through UpdatedBlockTip
+    const CBlockIndex* reorgForkIndex{nullptr};
+    std::atomic<uint64_t> nTipListChangeCounter{0};
 
 public:
     explicit CDeterministicMNManager(CEvoDB& _evoDb);
+    ~CDeterministicMNManager();
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const CCoinsViewCache& view, bool fJustCheck);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
+    // Builds the lists of all blocks between pindexFork and pindexTip with a single replay before these blocks are
+    // undone one by one, and keeps the list of pindexFork so that the blocks of the new chain connect on top of it
+    void PrepareReorg(const CBlockIndex* pindexTip, const CBlockIndex* pindexFork);
 
     void UpdatedBlockTip(const CBlockIndex* pindex);
 
@@ -687,18 +858,25 @@ public:
 
     CDeterministicMNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicMNList GetListAtChainTip();
+    // incremented whenever the list at the chain tip changes, can be used without locking cs
+    uint64_t GetTipListChangeCounter() const { return nTipListChangeCounter; }
 
     // Test if given TX is a ProRegTx which also contains the collateral at index n
     static bool IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n);
 
     bool IsDIP3Enforced(int nHeight = -1);
 
+    void CacheStatsToJson(UniValue& obj);
+
 public:
     // TODO these can all be removed in a future version
     void UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList);
     bool UpgradeDBIfNeeded();
 
 private:
+    void AddListToCache(const uint256& blockHash, const CDeterministicMNList& mnList);
+    void AddDiffToCache(const uint256& blockHash, const CDeterministicMNListDiff& diff);
+    bool IsListCacheRequired(const CDeterministicMNList& mnList, int nHeight) const;
     void CleanupCache(int nHeight);
 };
 
@@ -4,6 +4,8 @@
 
 #include <evo/evodb.h>
 
+#include <statsd_client.h>
+
 std::unique_ptr<CEvoDB> evoDb;
 
 CEvoDBScopedCommitter::CEvoDBScopedCommitter(CEvoDB &_evoDB) :
@@ -34,30 +36,49 @@ void CEvoDBScopedCommitter::Rollback()
 CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) :
     db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe),
     rootBatch(db),
-    rootDBTransaction(db, rootBatch),
-    curDBTransaction(rootDBTransaction, rootDBTransaction)
+    rootDBTransaction(db, rootBatch, (size_t)std::max<int64_t>(0, gArgs.GetArg("-evodbreadcache", DEFAULT_EVODB_READ_CACHE)) * 1024 * 1024),
+    curDBTransaction(rootDBTransaction, rootDBTransaction),
+    nMaxMemoryUsage((size_t)std::max<int64_t>(0, gArgs.GetArg("-evodbcache", DEFAULT_EVODB_CACHE)) * 1024 * 1024)
 {
 }
 
 void CEvoDB::CommitCurTransaction()
 {
-    LOCK(cs);
+    LOCK2(cs, csRoot);
     curDBTransaction.Commit();
+    // bump before clearing fCurDirty, so that IsCacheable never accepts a read of the pre-commit data
+    nGeneration++;
+    fCurDirty = false;
+    transactionOwner = std::thread::id();
+
+    // once per block is frequent enough for these
+    statsClient.count("evodb.committedReads", nCommittedReads.exchange(0), 1.0f);
+    statsClient.count("evodb.lockedReads", nLockedReads.exchange(0), 1.0f);
+    statsClient.count("evodb.lockWaitUs", nLockWaitMicros.exchange(0), 1.0f);
+    statsClient.gauge("evodb.readCacheBytes", rootDBTransaction.GetReadCacheMemoryUsage(), 1.0f);
 }
 
 void CEvoDB::RollbackCurTransaction()
 {
     LOCK(cs);
     curDBTransaction.Clear();
+    nGeneration++;
+    fCurDirty = false;
+    transactionOwner = std::thread::id();
 }
 
 bool CEvoDB::CommitRootTransaction()
 {
-    LOCK(cs);
+    LOCK2(cs, csRoot);
     assert(curDBTransaction.IsClean());
+    int64_t nStart = GetTimeMicros();
+    size_t nWrites = rootDBTransaction.GetWritesCount();
+    size_t nMemoryUsage = rootDBTransaction.GetMemoryUsage();
     rootDBTransaction.Commit();
     bool ret = db.WriteBatch(rootBatch);
     rootBatch.Clear();
+    LogPrint(BCLog::BENCHMARK, "CEvoDB::%s -- flushed %d entries (%.1fMiB) in %.2fms\n", __func__,
+             nWrites, nMemoryUsage * (1.0 / (1 << 20)), (GetTimeMicros() - nStart) * 0.001);
     return ret;
 }
 
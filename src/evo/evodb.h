@@ -9,10 +9,18 @@
 #include <sync.h>
 #include <uint256.h>
 
+#include <atomic>
+#include <thread>
+
 // "b_b" was used in the initial version of deterministic MN storage
 // "b_b2" was used after compact diffs were introduced
 static const std::string EVODB_BEST_BLOCK = "b_b2";
 
+/** Default for -evodbcache, maximum memory in MiB used by committed but not yet flushed EvoDB writes */
+static const int64_t DEFAULT_EVODB_CACHE = 256;
+/** Default for -evodbreadcache, maximum memory in MiB used to keep deserialized values of frequently read EvoDB keys */
+static const int64_t DEFAULT_EVODB_READ_CACHE = 32;
+
 class CEvoDB;
 
 class CEvoDBScopedCommitter
@@ -32,23 +40,46 @@ public:
 class CEvoDB
 {
 public:
+    // guards curDBTransaction and must be held by whoever wants to modify rootDBTransaction
     CCriticalSection cs;
 private:
+    // Reads of committed data (rootDBTransaction and the DB below it) only need csRoot. rootDBTransaction is only ever
+    // modified while holding both cs and csRoot, so holding either of them is enough to read from it.
+    Mutex csRoot;
+
     CDBWrapper db;
 
-    typedef CDBTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    // The root transaction collects the writes of all blocks connected since the last flush, so it keeps them in
+    // serialized form to stay small
+    typedef CDBCompactTransaction<CDBWrapper, CDBBatch> RootTransaction;
     typedef CDBTransaction<RootTransaction, RootTransaction> CurTransaction;
 
     CDBBatch rootBatch;
     RootTransaction rootDBTransaction;
     CurTransaction curDBTransaction;
 
+    // rootDBTransaction is flushed together with the coins cache as soon as it grows beyond this
+    const size_t nMaxMemoryUsage;
+
+    // curDBTransaction has uncommitted writes or erases
+    std::atomic<bool> fCurDirty{false};
+    // the thread which currently owns the transaction started by BeginTransaction()
+    std::atomic<std::thread::id> transactionOwner{std::thread::id()};
+    // bumped whenever the data seen through Read and Exists changes, see IsCacheable
+    std::atomic<uint64_t> nGeneration{0};
+
+    std::atomic<uint64_t> nCommittedReads{0};
+    std::atomic<uint64_t> nLockedReads{0};
+    std::atomic<uint64_t> nLockWaitMicros{0};
+    std::atomic<uint64_t> nWriteMicros{0};
+
 public:
     explicit CEvoDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
     std::unique_ptr<CEvoDBScopedCommitter> BeginTransaction()
     {
         LOCK(cs);
+        transactionOwner = std::this_thread::get_id();
         return std::make_unique<CEvoDBScopedCommitter>(*this);
     }
 
@@ -61,41 +92,94 @@ public:
     template <typename K, typename V>
     bool Read(const K& key, V& value)
     {
+        if (CanReadCommitted()) {
+            nCommittedReads++;
+            LOCK(csRoot);
+            return rootDBTransaction.Read(key, value);
+        }
+        nLockedReads++;
+        int64_t nWaitStart = GetTimeMicros();
         LOCK(cs);
+        nLockWaitMicros += GetTimeMicros() - nWaitStart;
         return curDBTransaction.Read(key, value);
     }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
+        int64_t nStart = GetTimeMicros();
         LOCK(cs);
+        fCurDirty = true;
+        nGeneration++;
         curDBTransaction.Write(key, value);
+        nWriteMicros += GetTimeMicros() - nStart;
     }
 
     template <typename K>
     bool Exists(const K& key)
     {
+        if (CanReadCommitted()) {
+            nCommittedReads++;
+            LOCK(csRoot);
+            return rootDBTransaction.Exists(key);
+        }
+        nLockedReads++;
+        int64_t nWaitStart = GetTimeMicros();
         LOCK(cs);
+        nLockWaitMicros += GetTimeMicros() - nWaitStart;
         return curDBTransaction.Exists(key);
     }
 
     template <typename K>
     void Erase(const K& key)
     {
+        int64_t nStart = GetTimeMicros();
         LOCK(cs);
+        fCurDirty = true;
+        nGeneration++;
         curDBTransaction.Erase(key);
+        nWriteMicros += GetTimeMicros() - nStart;
+    }
+
+    uint64_t GetGeneration() const { return nGeneration; }
+
+    // Read-through caches must only store a value read after GetGeneration() returned nGen if this returns true.
+    // Otherwise the value may be outdated already: either something was written in between, or the read was served
+    // from committed data while another thread has uncommitted writes. In both cases the writer may have invalidated
+    // the cache entry before the value gets stored. Call it while holding the lock that guards the cache, the same lock
+    // the writer takes to invalidate entries after writing.
+    bool IsCacheable(uint64_t nGen) const
+    {
+        return nGeneration == nGen && !(fCurDirty && CanReadCommitted());
     }
 
+    // Time spent in Write and Erase since startup, see ReplayBlocksForBenchmark
+    uint64_t GetWriteMicros() const { return nWriteMicros; }
+
     CDBWrapper& GetRawDB()
     {
         return db;
     }
 
+    // Writes to the raw DB bypass the transactions, so cached values of committed data may become stale. Must be
+    // called after writing through GetRawDB().
+    void ClearReadCache()
+    {
+        LOCK(csRoot);
+        rootDBTransaction.ClearReadCache();
+    }
+
     size_t GetMemoryUsage()
     {
+        LOCK(csRoot);
         return rootDBTransaction.GetMemoryUsage();
     }
 
+    size_t GetMaxMemoryUsage() const
+    {
+        return nMaxMemoryUsage;
+    }
+
     bool CommitRootTransaction();
 
     bool IsEmpty() { return db.IsEmpty(); }
@@ -104,6 +188,17 @@ public:
     void WriteBestBlock(const uint256& hash);
 
 private:
+    // Uncommitted writes are only visible to the thread which owns the current transaction. All other threads (and
+    // every thread while there is nothing uncommitted) can read committed data without waiting for cs.
+    bool CanReadCommitted() const
+    {
+        if (!fCurDirty) {
+            return true;
+        }
+        auto owner = transactionOwner.load();
+        return owner != std::thread::id() && owner != std::this_thread::get_id();
+    }
+
     // only CEvoDBScopedCommitter is allowed to invoke these
     friend class CEvoDBScopedCommitter;
     void CommitCurTransaction();
@@ -141,40 +141,39 @@ void CMNAuth::ProcessMessage(CNode* pnode, const std::string& strCommand, CDataS
             }
         }
 
-        connman.ForEachNode([&](CNode* pnode2) {
-            if (pnode->fDisconnect) {
-                // we've already disconnected the new peer
-                return;
+        connman.ForVerifiedMasternodeNode(mnauth.proRegTxHash, [&](CNode* pnode2) {
+            if (pnode2 == pnode || !pnode2->fSuccessfullyConnected || pnode2->fDisconnect) {
+                return false;
             }
 
-            if (pnode2->verifiedProRegTxHash == mnauth.proRegTxHash) {
-                if (fMasternodeMode) {
-                    auto deterministicOutbound = llmq::CLLMQUtils::DeterministicOutboundConnection(activeMasternodeInfo.proTxHash, mnauth.proRegTxHash);
-                    LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- Masternode %s has already verified as peer %d, deterministicOutbound=%s. peer=%d\n",
-                             mnauth.proRegTxHash.ToString(), pnode2->GetId(), deterministicOutbound.ToString(), pnode->GetId());
-                    if (deterministicOutbound == activeMasternodeInfo.proTxHash) {
-                        if (pnode2->fInbound) {
-                            LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping old inbound, peer=%d\n", pnode2->GetId());
-                            pnode2->fDisconnect = true;
-                        } else if (pnode->fInbound) {
-                            LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping new inbound, peer=%d\n", pnode->GetId());
-                            pnode->fDisconnect = true;
-                        }
-                    } else {
-                        if (!pnode2->fInbound) {
-                            LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping old outbound, peer=%d\n", pnode2->GetId());
-                            pnode2->fDisconnect = true;
-                        } else if (!pnode->fInbound) {
-                            LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping new outbound, peer=%d\n", pnode->GetId());
-                            pnode->fDisconnect = true;
-                        }
+            if (fMasternodeMode) {
+                auto deterministicOutbound = llmq::CLLMQUtils::DeterministicOutboundConnection(activeMasternodeInfo.proTxHash, mnauth.proRegTxHash);
+                LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- Masternode %s has already verified as peer %d, deterministicOutbound=%s. peer=%d\n",
+                         mnauth.proRegTxHash.ToString(), pnode2->GetId(), deterministicOutbound.ToString(), pnode->GetId());
+                if (deterministicOutbound == activeMasternodeInfo.proTxHash) {
+                    if (pnode2->fInbound) {
+                        LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping old inbound, peer=%d\n", pnode2->GetId());
+                        pnode2->fDisconnect = true;
+                    } else if (pnode->fInbound) {
+                        LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping new inbound, peer=%d\n", pnode->GetId());
+                        pnode->fDisconnect = true;
                     }
                 } else {
-                    LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- Masternode %s has already verified as peer %d, dropping new connection. peer=%d\n",
-                            mnauth.proRegTxHash.ToString(), pnode2->GetId(), pnode->GetId());
-                    pnode->fDisconnect = true;
+                    if (!pnode2->fInbound) {
+                        LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping old outbound, peer=%d\n", pnode2->GetId());
+                        pnode2->fDisconnect = true;
+                    } else if (!pnode->fInbound) {
+                        LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- dropping new outbound, peer=%d\n", pnode->GetId());
+                        pnode->fDisconnect = true;
+                    }
                 }
+            } else {
+                LogPrint(BCLog::NET_NETCONN, "CMNAuth::ProcessMessage -- Masternode %s has already verified as peer %d, dropping new connection. peer=%d\n",
+                        mnauth.proRegTxHash.ToString(), pnode2->GetId(), pnode->GetId());
+                pnode->fDisconnect = true;
             }
+            // keep looking at other connections of the same MN until the new one is dropped
+            return pnode->fDisconnect.load();
         });
 
         if (pnode->fDisconnect) {
@@ -186,6 +185,7 @@ void CMNAuth::ProcessMessage(CNode* pnode, const std::string& strCommand, CDataS
             pnode->verifiedProRegTxHash = mnauth.proRegTxHash;
             pnode->verifiedPubKeyHash = dmn->pdmnState->pubKeyOperator.GetHash();
         }
+        connman.SetVerifiedMasternodeNode(mnauth.proRegTxHash, pnode);
 
         if (!pnode->m_masternode_iqr_connection && connman.IsMasternodeQuorumRelayMember(pnode->verifiedProRegTxHash)) {
             // Tell our peer that we're interested in plain LLMQ recovered signatures.
@@ -208,31 +208,35 @@ void CMNAuth::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList&
         return;
     }
 
-    g_connman->ForEachNode([&](CNode* pnode) {
-        LOCK(pnode->cs_mnauth);
-        if (pnode->verifiedProRegTxHash.IsNull()) {
-            return;
-        }
-        auto verifiedDmn = oldMNList.GetMN(pnode->verifiedProRegTxHash);
+    // diffs are usually much smaller than the number of connections, so look up the affected MNs instead of
+    // checking every connection
+    auto disconnectMN = [&](uint64_t internalId, const CBLSLazyPublicKey* newPubKeyOperator) {
+        auto verifiedDmn = oldMNList.GetMNByInternalId(internalId);
         if (!verifiedDmn) {
             return;
         }
-        bool doRemove = false;
-        if (diff.removedMns.count(verifiedDmn->GetInternalId())) {
-            doRemove = true;
-        } else {
-            auto it = diff.updatedMNs.find(verifiedDmn->GetInternalId());
-            if (it != diff.updatedMNs.end()) {
-                if ((it->second.fields & CDeterministicMNStateDiff::Field_pubKeyOperator) && it->second.state.pubKeyOperator.GetHash() != pnode->verifiedPubKeyHash) {
-                    doRemove = true;
-                }
+        g_connman->ForVerifiedMasternodeNode(verifiedDmn->proTxHash, [&](CNode* pnode) {
+            LOCK(pnode->cs_mnauth);
+            if (pnode->fDisconnect || pnode->verifiedProRegTxHash != verifiedDmn->proTxHash) {
+                return false;
+            }
+            if (newPubKeyOperator && newPubKeyOperator->GetHash() == pnode->verifiedPubKeyHash) {
+                return false;
             }
-        }
-
-        if (doRemove) {
             LogPrint(BCLog::NET_NETCONN, "CMNAuth::NotifyMasternodeListChanged -- Disconnecting MN %s due to key changed/removed, peer=%d\n",
                      pnode->verifiedProRegTxHash.ToString(), pnode->GetId());
             pnode->fDisconnect = true;
+            // disconnect all connections of this MN
+            return false;
+        });
+    };
+
+    for (const auto& internalId : diff.removedMns) {
+        disconnectMN(internalId, nullptr);
+    }
+    for (const auto& p : diff.updatedMNs) {
+        if (p.second.fields & CDeterministicMNStateDiff::Field_pubKeyOperator) {
+            disconnectMN(p.first, &p.second.state.pubKeyOperator);
         }
-    });
+    }
 }
@@ -6,6 +6,7 @@
 #include <evo/providertx.h>
 #include <evo/specialtx.h>
 
+#include <bls/bls_sigcache.h>
 #include <chainparams.h>
 #include <clientversion.h>
 #include <coins.h>
@@ -61,9 +62,19 @@ static bool CheckStringSig(const ProTx& proTx, const CKeyID& keyID, CValidationS
 }
 
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state, CProTxOperatorSig* pOperatorSigRet)
 {
-    if (!proTx.sig.VerifyInsecure(pubKey, ::SerializeHash(proTx))) {
+    if (pOperatorSigRet) {
+        // verified later by the caller
+        if (!proTx.sig.IsValid() || !pubKey.IsValid()) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
+        }
+        pOperatorSigRet->msgHash = ::SerializeHash(proTx);
+        pOperatorSigRet->sig = proTx.sig;
+        pOperatorSigRet->pubKey = pubKey;
+        return true;
+    }
+    if (!VerifyBLSSigCached(proTx.sig, pubKey, ::SerializeHash(proTx))) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
     }
     return true;
@@ -212,7 +223,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
     return true;
 }
 
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxOperatorSig* pOperatorSigRet)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_SERVICE) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-type");
@@ -259,7 +270,7 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
             // pass the state returned by the function above
             return false;
         }
-        if (!CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state, pOperatorSigRet)) {
             // pass the state returned by the function above
             return false;
         }
@@ -352,7 +363,7 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
     return true;
 }
 
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxOperatorSig* pOperatorSigRet)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REVOKE) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-type");
@@ -383,7 +394,7 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
             // pass the state returned by the function above
             return false;
         }
-        if (!CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state, pOperatorSigRet)) {
             // pass the state returned by the function above
             return false;
         }
@@ -392,6 +403,41 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
     return true;
 }
 
+bool VerifyProTxOperatorSigs(const std::vector<CProTxOperatorSig>& sigs, std::vector<bool>& vValidRet)
+{
+    vValidRet.assign(sigs.size(), true);
+
+    // most signatures were already verified when the transaction was accepted into the mempool
+    std::vector<size_t> vIdx;
+    std::vector<CBLSSignature> vSigs;
+    std::vector<CBLSPublicKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    for (size_t i = 0; i < sigs.size(); i++) {
+        if (CBLSSigCacheEntry(sigs[i].pubKey, sigs[i].msgHash, sigs[i].sig).IsCached()) {
+            continue;
+        }
+        vIdx.emplace_back(i);
+        vSigs.emplace_back(sigs[i].sig);
+        vPubKeys.emplace_back(sigs[i].pubKey);
+        vHashes.emplace_back(sigs[i].msgHash);
+    }
+    if (vIdx.empty()) {
+        return true;
+    }
+
+    // The batch is verified with random weights, so invalid signatures can't cancel each other out. Only when it
+    // fails, the signatures are verified one by one to find out which ones are invalid.
+    bool fAllValid = CBLSSignature::VerifyBatch(vSigs, vPubKeys, vHashes);
+    for (size_t j = 0; j < vIdx.size(); j++) {
+        if (!fAllValid && !vSigs[j].VerifyInsecure(vPubKeys[j], vHashes[j])) {
+            vValidRet[vIdx[j]] = false;
+            continue;
+        }
+        CBLSSigCacheEntry(vPubKeys[j], vHashes[j], vSigs[j]).Add();
+    }
+    return std::find(vValidRet.begin(), vValidRet.end(), false) == vValidRet.end();
+}
+
 std::string CProRegTx::MakeSignString() const
 {
     std::string s;
@@ -221,9 +221,23 @@ public:
 };
 
 
+// BLS operator signature of a ProUpServTx or ProUpRevTx. When passed to CheckProUpServTx/CheckProUpRevTx, the signature
+// is not verified but only returned here, so that the caller can verify the signatures of a whole block in one batch.
+// sig stays invalid if there was nothing to verify (pindexPrev == nullptr).
+struct CProTxOperatorSig
+{
+    uint256 msgHash;
+    CBLSSignature sig;
+    CBLSPublicKey pubKey;
+};
+
 bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view);
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxOperatorSig* pOperatorSigRet = nullptr);
 bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view);
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxOperatorSig* pOperatorSigRet = nullptr);
+
+// Verifies all signatures which are not in the signature cache yet in one weighted batch and caches the valid ones.
+// Returns false if any of the signatures is invalid, vValidRet then tells which ones.
+bool VerifyProTxOperatorSigs(const std::vector<CProTxOperatorSig>& sigs, std::vector<bool>& vValidRet);
 
 #endif // BITCOIN_EVO_PROVIDERTX_H
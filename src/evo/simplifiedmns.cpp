@@ -18,9 +18,22 @@
 #include <base58.h>
 #include <chainparams.h>
 #include <consensus/merkle.h>
+#include <crypto/sha256.h>
+#include <ctpl_stl.h>
 #include <univalue.h>
+#include <util/system.h>
 #include <validation.h>
 
+#include <atomic>
+#include <future>
+#include <mutex>
+
+//! Below this, building and hashing the entries takes less time than handing the work to other threads
+static const size_t PARALLEL_MIN_ENTRIES = 1024;
+static const int PARALLEL_MAX_THREADS = 8;
+//! Number of ranges per thread, so that threads which got scheduled late don't hold up the others
+static const size_t PARALLEL_RANGES_PER_THREAD = 4;
+
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
     proRegTxHash(dmn.proTxHash),
     confirmedHash(dmn.pdmnState->confirmedHash),
@@ -31,6 +44,16 @@ CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
 {
 }
 
+CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMNListColumns& columns, size_t i) :
+    proRegTxHash(columns.proTxHashes[i]),
+    confirmedHash(columns.confirmedHashes[i]),
+    service(columns.addrs[i]),
+    pubKeyOperator(columns.pubKeyOperators[i]),
+    keyIDVoting(columns.keyIDVotings[i]),
+    isValid(columns.IsValid(i))
+{
+}
+
 uint256 CSimplifiedMNListEntry::CalcHash() const
 {
     CHashWriter hw(SER_GETHASH, CLIENT_VERSION);
@@ -56,12 +79,48 @@ void CSimplifiedMNListEntry::ToJson(UniValue& obj) const
     obj.pushKV("isValid", isValid);
 }
 
+void ParallelForSimplifiedMNs(size_t count, const std::function<void(size_t, size_t)>& f)
+{
+    // The pool is started on first use and kept, as this is called for every new block
+    static std::once_flag poolInitFlag;
+    static std::unique_ptr<ctpl::thread_pool> pool;
+
+    int nThreads = std::min(GetNumCores(), PARALLEL_MAX_THREADS);
+    if (count < PARALLEL_MIN_ENTRIES || nThreads < 2) {
+        f(0, count);
+        return;
+    }
+    std::call_once(poolInitFlag, [nThreads]() {
+        pool = std::make_unique<ctpl::thread_pool>(nThreads - 1);
+        RenameThreadPool(*pool, "dash-sml");
+    });
+
+    const size_t nRanges = nThreads * PARALLEL_RANGES_PER_THREAD;
+    const size_t nRangeSize = (count + nRanges - 1) / nRanges;
+    std::atomic<size_t> nextRange{0};
+    auto work = [&]() {
+        for (size_t i = nextRange++; i * nRangeSize < count; i = nextRange++) {
+            f(i * nRangeSize, std::min(count, (i + 1) * nRangeSize));
+        }
+    };
+    std::vector<std::future<void>> futures;
+    for (int i = 1; i < nThreads; i++) {
+        futures.emplace_back(pool->push([&work](int) { work(); }));
+    }
+    work();
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
 CSimplifiedMNList::CSimplifiedMNList(const std::vector<CSimplifiedMNListEntry>& smlEntries)
 {
     mnList.resize(smlEntries.size());
-    for (size_t i = 0; i < smlEntries.size(); i++) {
-        mnList[i] = std::make_unique<CSimplifiedMNListEntry>(smlEntries[i]);
-    }
+    ParallelForSimplifiedMNs(smlEntries.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            mnList[i] = std::make_unique<CSimplifiedMNListEntry>(smlEntries[i]);
+        }
+    });
 
     std::sort(mnList.begin(), mnList.end(), [&](const std::unique_ptr<CSimplifiedMNListEntry>& a, const std::unique_ptr<CSimplifiedMNListEntry>& b) {
         return a->proRegTxHash.Compare(b->proRegTxHash) < 0;
@@ -70,26 +129,97 @@ CSimplifiedMNList::CSimplifiedMNList(const std::vector<CSimplifiedMNListEntry>&
 
 CSimplifiedMNList::CSimplifiedMNList(const CDeterministicMNList& dmnList)
 {
-    mnList.resize(dmnList.GetAllMNsCount());
-
-    size_t i = 0;
-    dmnList.ForEachMN(false, [this, &i](const CDeterministicMNCPtr& dmn) {
-        mnList[i++] = std::make_unique<CSimplifiedMNListEntry>(*dmn);
+    // the columns are already sorted by proTxHash
+    auto columns = dmnList.GetColumns();
+    mnList.resize(columns->size());
+    ParallelForSimplifiedMNs(columns->size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            mnList[i] = std::make_unique<CSimplifiedMNListEntry>(*columns, i);
+        }
     });
+}
 
-    std::sort(mnList.begin(), mnList.end(), [&](const std::unique_ptr<CSimplifiedMNListEntry>& a, const std::unique_ptr<CSimplifiedMNListEntry>& b) {
-        return a->proRegTxHash.Compare(b->proRegTxHash) < 0;
+uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
+{
+    std::vector<uint256> leaves(mnList.size());
+    ParallelForSimplifiedMNs(mnList.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            leaves[i] = mnList[i]->CalcHash();
+        }
     });
+    return ComputeMerkleRoot(leaves, pmutated);
 }
 
-uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
+uint256 CSimplifiedMNListMerkleTree::CalcMerkleRoot(const CSimplifiedMNList& sml, bool* pmutated)
 {
-    std::vector<uint256> leaves;
-    leaves.reserve(mnList.size());
-    for (const auto& e : mnList) {
-        leaves.emplace_back(e->CalcHash());
+    // Both lists are sorted by proRegTxHash, so a single merge pass finds the leaves which can be reused
+    std::vector<CSimplifiedMNListEntry> newEntries;
+    std::vector<std::vector<uint256>> newLevels(1);
+    std::vector<size_t> vecRehash;
+    newEntries.reserve(sml.mnList.size());
+    newLevels[0].reserve(sml.mnList.size() + 1);
+    newLevels[0].resize(sml.mnList.size());
+    size_t j = 0;
+    for (size_t i = 0; i < sml.mnList.size(); i++) {
+        const auto& e = sml.mnList[i];
+        while (j < entries.size() && entries[j].proRegTxHash.Compare(e->proRegTxHash) < 0) {
+            j++;
+        }
+        if (j < entries.size() && entries[j] == *e) {
+            newLevels[0][i] = levels[0][j];
+        } else {
+            vecRehash.emplace_back(i);
+        }
+        newEntries.emplace_back(*e);
     }
-    return ComputeMerkleRoot(leaves, pmutated);
+    // All leaves are new on the first calculation
+    ParallelForSimplifiedMNs(vecRehash.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            newLevels[0][vecRehash[k]] = newEntries[vecRehash[k]].CalcHash();
+        }
+    });
+
+    bool mutation = false;
+    for (size_t l = 0; newLevels[l].size() > 1; l++) {
+        auto& cur = newLevels[l];
+        for (size_t pos = 0; pos + 1 < cur.size(); pos += 2) {
+            if (cur[pos] == cur[pos + 1]) mutation = true;
+        }
+        if (cur.size() & 1) {
+            cur.emplace_back(cur.back());
+        }
+
+        const std::vector<uint256>* oldCur = l + 1 < levels.size() ? &levels[l] : nullptr;
+        const std::vector<uint256>* oldNext = l + 1 < levels.size() ? &levels[l + 1] : nullptr;
+        std::vector<uint256> next(cur.size() / 2);
+        // Nodes which need to be rehashed are collected into runs, so that SHA256D64 can hash several of them at once
+        // with the multi-way implementations
+        size_t runStart = 0, runLength = 0;
+        for (size_t i = 0; i < next.size(); i++) {
+            if (oldCur && 2 * i + 1 < oldCur->size() && i < oldNext->size() &&
+                cur[2 * i] == (*oldCur)[2 * i] && cur[2 * i + 1] == (*oldCur)[2 * i + 1]) {
+                next[i] = (*oldNext)[i];
+                if (runLength) {
+                    SHA256D64(next[runStart].begin(), cur[2 * runStart].begin(), runLength);
+                    runLength = 0;
+                }
+            } else {
+                if (!runLength) runStart = i;
+                runLength++;
+            }
+        }
+        if (runLength) {
+            SHA256D64(next[runStart].begin(), cur[2 * runStart].begin(), runLength);
+        }
+        newLevels.emplace_back(std::move(next));
+    }
+
+    entries = std::move(newEntries);
+    levels = std::move(newLevels);
+
+    if (pmutated) *pmutated = mutation;
+    if (levels[0].empty()) return uint256();
+    return levels.back()[0];
 }
 
 CSimplifiedMNListDiff::CSimplifiedMNListDiff() = default;
@@ -185,10 +315,11 @@ void CSimplifiedMNListDiff::ToJson(UniValue& obj) const
     }
 }
 
-bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet)
+CSimplifiedMNListDiffCache simplifiedMNListDiffCache;
+
+static bool CheckDiffBlocks(const uint256& baseBlockHash, const uint256& blockHash, const CBlockIndex*& baseBlockIndexRet, const CBlockIndex*& blockIndexRet, std::string& errorRet)
 {
     AssertLockHeld(cs_main);
-    mnListDiffRet = CSimplifiedMNListDiff();
 
     const CBlockIndex* baseBlockIndex = chainActive.Genesis();
     if (!baseBlockHash.IsNull()) {
@@ -214,6 +345,22 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
         return false;
     }
 
+    baseBlockIndexRet = baseBlockIndex;
+    blockIndexRet = blockIndex;
+    return true;
+}
+
+bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet)
+{
+    AssertLockHeld(cs_main);
+    mnListDiffRet = CSimplifiedMNListDiff();
+
+    const CBlockIndex* baseBlockIndex;
+    const CBlockIndex* blockIndex;
+    if (!CheckDiffBlocks(baseBlockHash, blockHash, baseBlockIndex, blockIndex, errorRet)) {
+        return false;
+    }
+
     LOCK(deterministicMNManager->cs);
 
     auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockIndex);
@@ -249,3 +396,76 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
 
     return true;
 }
+
+CSimplifiedMNListDiffCache::CSimplifiedMNListDiffCache() :
+    cache(MAX_CACHE_ENTRIES)
+{
+    cache.set_max_weight(MAX_CACHE_BYTES, [](const uint256&, const SerializedDiffPtr& data) { return data->size(); });
+}
+
+bool CSimplifiedMNListDiffCache::GetSerializedDiff(const uint256& baseBlockHash, const uint256& blockHash, int nVersion, SerializedDiffPtr& ret, std::string& errorRet)
+{
+    AssertLockHeld(cs_main);
+
+    const CBlockIndex* baseBlockIndex;
+    const CBlockIndex* blockIndex;
+    if (!CheckDiffBlocks(baseBlockHash, blockHash, baseBlockIndex, blockIndex, errorRet)) {
+        return false;
+    }
+
+    // The serialized diff only depends on whether the quorums are included
+    bool fQuorums = nVersion >= LLMQS_PROTO_VERSION;
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << baseBlockHash << blockHash << fQuorums;
+    uint256 cacheKey = hw.GetHash();
+
+    {
+        LOCK(cs);
+        if (cache.get(cacheKey, ret)) {
+            return true;
+        }
+    }
+
+    CSimplifiedMNListDiff mnListDiff;
+    if (!BuildSimplifiedMNListDiff(baseBlockHash, blockHash, mnListDiff, errorRet)) {
+        return false;
+    }
+    auto data = std::make_shared<std::vector<unsigned char>>();
+    CVectorWriter(SER_NETWORK, fQuorums ? PROTOCOL_VERSION : LLMQS_PROTO_VERSION - 1, *data, 0, mnListDiff);
+    ret = data;
+
+    LOCK(cs);
+    cache.insert(cacheKey, ret);
+    return true;
+}
+
+void CSimplifiedMNListDiffCache::UpdatedBlockTip(const CBlockIndex* pindexNew)
+{
+    // SPV clients ask for the full list when they start from scratch, and for the diff from their last known tip or
+    // the last checkpoint they stored otherwise
+    std::vector<uint256> vecBaseBlockHashes{uint256()};
+    const CBlockIndex* pindex = pindexNew->pprev;
+    for (int i = 0; i < PRECOMPUTE_PREVIOUS_TIPS && pindex; i++, pindex = pindex->pprev) {
+        vecBaseBlockHashes.emplace_back(pindex->GetBlockHash());
+    }
+    const int nBlocksPerDay = 24 * 60 * 60 / Params().GetConsensus().nPowTargetSpacing;
+    int nCheckpointHeight = pindexNew->nHeight - pindexNew->nHeight % nBlocksPerDay;
+    for (int i = 0; i < PRECOMPUTE_DAILY_CHECKPOINTS && nCheckpointHeight > 0; i++, nCheckpointHeight -= nBlocksPerDay) {
+        if (nCheckpointHeight < pindexNew->nHeight - PRECOMPUTE_PREVIOUS_TIPS) {
+            vecBaseBlockHashes.emplace_back(pindexNew->GetAncestor(nCheckpointHeight)->GetBlockHash());
+        }
+    }
+
+    for (const auto& baseBlockHash : vecBaseBlockHashes) {
+        // Don't hold cs_main for all of them, the message handler thread needs it too
+        LOCK(cs_main);
+        SerializedDiffPtr data;
+        std::string strError;
+        if (!GetSerializedDiff(baseBlockHash, pindexNew->GetBlockHash(), PROTOCOL_VERSION, data, strError)) {
+            // the tip might have been reorged away in the meantime
+            LogPrint(BCLog::NET, "CSimplifiedMNListDiffCache::%s -- failed to build diff from %s to %s: %s\n", __func__,
+                     baseBlockHash.ToString(), pindexNew->GetBlockHash().ToString(), strError);
+            return;
+        }
+    }
+}
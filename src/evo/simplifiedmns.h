@@ -7,10 +7,18 @@
 
 #include <merkleblock.h>
 #include <pubkey.h>
+#include <saltedhasher.h>
+#include <sync.h>
+#include <unordered_lru_cache.h>
+
+#include <functional>
+#include <memory>
 
 class UniValue;
+class CBlockIndex;
 class CDeterministicMNList;
 class CDeterministicMN;
+class CDeterministicMNListColumns;
 
 namespace llmq
 {
@@ -30,6 +38,7 @@ public:
 public:
     CSimplifiedMNListEntry() = default;
     explicit CSimplifiedMNListEntry(const CDeterministicMN& dmn);
+    CSimplifiedMNListEntry(const CDeterministicMNListColumns& columns, size_t i);
 
     bool operator==(const CSimplifiedMNListEntry& rhs) const
     {
@@ -66,6 +75,13 @@ public:
     void ToJson(UniValue& obj) const;
 };
 
+/**
+ * Call f(begin, end) for consecutive ranges which together cover [0, count). Lists of the size of the mainnet list are
+ * split up between a shared pool of worker threads and the calling thread, smaller ones are handled by the calling
+ * thread alone. f is called concurrently for different ranges.
+ */
+void ParallelForSimplifiedMNs(size_t count, const std::function<void(size_t, size_t)>& f);
+
 class CSimplifiedMNList
 {
 public:
@@ -79,6 +95,22 @@ public:
     uint256 CalcMerkleRoot(bool* pmutated = nullptr) const;
 };
 
+/**
+ * Merkle tree over the entries of a CSimplifiedMNList which is kept from one calculation to the next.
+ * Only leaves whose entries changed since the previous calculation are rehashed, and only inner nodes with a changed
+ * child are recomputed. The resulting root and mutation flag are identical to CSimplifiedMNList::CalcMerkleRoot.
+ */
+class CSimplifiedMNListMerkleTree
+{
+private:
+    std::vector<CSimplifiedMNListEntry> entries;
+    // levels[0] holds the leaves, each level is padded with a copy of its last hash if it has an odd size
+    std::vector<std::vector<uint256>> levels;
+
+public:
+    uint256 CalcMerkleRoot(const CSimplifiedMNList& sml, bool* pmutated = nullptr);
+};
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
@@ -129,4 +161,42 @@ public:
 
 bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet);
 
+/**
+ * Cache of serialized MNLISTDIFF responses. The diff between two blocks of the active chain never changes, and SPV
+ * clients mostly ask for the same few: the full list at the tip (from the genesis block), and the diffs from recent
+ * tips or the start of the day to the current tip. Those are built in advance whenever the tip changes, outside of
+ * the message handler thread, and all other responses are cached once they were built for the first request.
+ */
+class CSimplifiedMNListDiffCache
+{
+public:
+    static const size_t MAX_CACHE_ENTRIES = 256;
+    static const size_t MAX_CACHE_BYTES = 64 * 1024 * 1024;
+    //! Number of previous tips from which the diffs to a new tip are built in advance
+    static const int PRECOMPUTE_PREVIOUS_TIPS = 4;
+    //! Number of daily checkpoints from which the diffs to a new tip are built in advance
+    static const int PRECOMPUTE_DAILY_CHECKPOINTS = 2;
+
+    typedef std::shared_ptr<const std::vector<unsigned char>> SerializedDiffPtr;
+
+private:
+    CCriticalSection cs;
+    unordered_lru_cache<uint256, SerializedDiffPtr, StaticSaltedHasher> cache GUARDED_BY(cs);
+
+public:
+    CSimplifiedMNListDiffCache();
+
+    /**
+     * Return the diff from baseBlockHash to blockHash as serialized for a peer with the protocol version nVersion.
+     * The blocks are checked on every call, so the same diff is never returned once they're not part of the active
+     * chain anymore.
+     */
+    bool GetSerializedDiff(const uint256& baseBlockHash, const uint256& blockHash, int nVersion, SerializedDiffPtr& ret, std::string& errorRet);
+
+    /** Build the diffs to the new tip which are requested most */
+    void UpdatedBlockTip(const CBlockIndex* pindexNew);
+};
+
+extern CSimplifiedMNListDiffCache simplifiedMNListDiffCache;
+
 #endif // BITCOIN_EVO_SIMPLIFIEDMNS_H
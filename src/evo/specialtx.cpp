@@ -10,12 +10,17 @@
 
 #include <evo/cbtx.h>
 #include <evo/deterministicmns.h>
+#include <evo/providertx.h>
 #include <evo/specialtx.h>
 
 #include <llmq/quorums_commitment.h>
 #include <llmq/quorums_blockprocessor.h>
+#include <llmq/quorums_init.h>
+#include <llmq/quorums_utils.h>
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view)
+#include <bls/bls_worker.h>
+
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, CProTxOperatorSig* pOperatorSigRet)
 {
     if (tx.nVersion != 3 || tx.nType == TRANSACTION_NORMAL)
         return true;
@@ -29,11 +34,11 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
         case TRANSACTION_PROVIDER_REGISTER:
             return CheckProRegTx(tx, pindexPrev, state, view);
         case TRANSACTION_PROVIDER_UPDATE_SERVICE:
-            return CheckProUpServTx(tx, pindexPrev, state);
+            return CheckProUpServTx(tx, pindexPrev, state, pOperatorSigRet);
         case TRANSACTION_PROVIDER_UPDATE_REGISTRAR:
             return CheckProUpRegTx(tx, pindexPrev, state, view);
         case TRANSACTION_PROVIDER_UPDATE_REVOKE:
-            return CheckProUpRevTx(tx, pindexPrev, state);
+            return CheckProUpRevTx(tx, pindexPrev, state, pOperatorSigRet);
         case TRANSACTION_COINBASE:
             return CheckCbTx(tx, pindexPrev, state);
         case TRANSACTION_QUORUM_COMMITMENT:
@@ -89,54 +94,183 @@ bool UndoSpecialTx(const CTransaction& tx, const CBlockIndex* pindex)
     return false;
 }
 
+// Large enough to make batching worth it, small enough to still spread a block full of provider txs over the workers
+static const size_t OPERATOR_SIGS_BATCH_SIZE = 32;
+
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const CCoinsViewCache& view, bool fJustCheck, bool fCheckCbTxMerleRoots)
 {
-    static int64_t nTimeLoop = 0;
-    static int64_t nTimeQuorum = 0;
-    static int64_t nTimeDMN = 0;
-    static int64_t nTimeMerkle = 0;
+    AssertLockHeld(cs_main);
+    auto& timings = g_block_connect_timings;
 
     try {
         int64_t nTime1 = GetTimeMicros();
 
+        // ProUpServTx and ProUpRevTx only depend on the MN list of the previous block, which does not change while the
+        // block is processed. These and the BLS signatures of quorum commitments are checked on the BLS worker threads
+        // while everything which needs the coins view or cs_main is checked in order on this thread.
+        struct AsyncCheck {
+            int nTxIndex;
+            bool fValid{true};
+            CValidationState state;
+            CProTxOperatorSig operatorSig;
+            explicit AsyncCheck(int _nTxIndex) : nTxIndex(_nTxIndex) {}
+        };
+        std::vector<AsyncCheck> asyncChecks;
+        std::vector<std::pair<AsyncCheck*, llmq::CFinalCommitment>> qcChecks;
+        std::vector<std::function<void()>> jobs;
+        std::vector<uint8_t> vCheckedAsync(block.vtx.size(), 0);
+        asyncChecks.reserve(block.vtx.size());
+        qcChecks.reserve(block.vtx.size());
+
         for (int i = 0; i < (int)block.vtx.size(); i++) {
             const CTransaction& tx = *block.vtx[i];
-            if (!CheckSpecialTx(tx, pindex->pprev, state, view)) {
-                // pass the state returned by the function above
-                return false;
+            if (tx.nVersion != 3) {
+                continue;
+            }
+            if (tx.nType == TRANSACTION_PROVIDER_UPDATE_SERVICE || tx.nType == TRANSACTION_PROVIDER_UPDATE_REVOKE) {
+                vCheckedAsync[i] = 1;
+                asyncChecks.emplace_back(i);
+                auto& check = asyncChecks.back();
+                jobs.emplace_back([&check, &tx, pindex, &view]() {
+                    check.fValid = CheckSpecialTx(tx, pindex->pprev, check.state, view, &check.operatorSig);
+                });
+            } else if (tx.nType == TRANSACTION_QUORUM_COMMITMENT) {
+                llmq::CFinalCommitmentTxPayload qcTx;
+                if (!GetTxPayload(tx, qcTx) || qcTx.commitment.IsNull()) {
+                    continue;
+                }
+                const CBlockIndex* pindexQuorum = LookupBlockIndex(qcTx.commitment.quorumHash);
+                if (!pindexQuorum) {
+                    continue;
+                }
+                // Commitments of upcoming blocks might have been verified ahead while syncing, so there is no need to
+                // verify the same signatures again when the block comes in
+                uint256 commitmentHash = ::SerializeHash(qcTx.commitment);
+                if (llmq::quorumBlockProcessor->ConsumePreVerifiedCommitment(commitmentHash)) {
+                    continue;
+                }
+                asyncChecks.emplace_back(i);
+                qcChecks.emplace_back(&asyncChecks.back(), std::move(qcTx.commitment));
+                auto& qcCheck = qcChecks.back();
+                jobs.emplace_back([&qcCheck, pindexQuorum]() {
+                    auto& check = *qcCheck.first;
+                    const auto& qc = qcCheck.second;
+                    try {
+                        check.fValid = qc.VerifyMembersSig(llmq::CLLMQUtils::GetAllQuorumMembers(qc.llmqType, pindexQuorum));
+                    } catch (const std::exception& e) {
+                        LogPrintf("ProcessSpecialTxsInBlock -- failed: %s\n", e.what());
+                        check.fValid = false;
+                    }
+                });
             }
-            if (!ProcessSpecialTx(tx, pindex, state)) {
-                // pass the state returned by the function above
+        }
+
+        // The quorum signatures don't need the quorum members, so all of them are verified in one weighted batch
+        std::vector<bool> vQuorumSigsValid;
+        if (!qcChecks.empty()) {
+            jobs.emplace_back([&qcChecks, &vQuorumSigsValid]() {
+                std::vector<const llmq::CFinalCommitment*> qcs;
+                qcs.reserve(qcChecks.size());
+                for (const auto& qcCheck : qcChecks) {
+                    qcs.emplace_back(&qcCheck.second);
+                }
+                llmq::CFinalCommitment::VerifyQuorumSigs(qcs, vQuorumSigsValid);
+            });
+        }
+
+        // index of the first tx which failed the checks on this thread
+        int nFailedTx = (int)block.vtx.size();
+        llmq::blsWorker->RunJobs(jobs, [&]() {
+            for (int i = 0; i < (int)block.vtx.size(); i++) {
+                const CTransaction& tx = *block.vtx[i];
+                if ((!vCheckedAsync[i] && !CheckSpecialTx(tx, pindex->pprev, state, view)) || !ProcessSpecialTx(tx, pindex, state)) {
+                    nFailedTx = i;
+                    break;
+                }
+            }
+        });
+
+        for (size_t i = 0; i < qcChecks.size(); i++) {
+            auto& check = *qcChecks[i].first;
+            check.fValid = check.fValid && vQuorumSigsValid[i];
+            if (!check.fValid) {
+                check.state.DoS(100, false, REJECT_INVALID, "bad-qc-invalid");
+            }
+        }
+
+        // The operator signatures of all ProUpServTx and ProUpRevTx are verified in weighted batches, which are spread
+        // over the workers if there are many of them
+        std::vector<AsyncCheck*> sigChecks;
+        for (auto& check : asyncChecks) {
+            if (check.fValid && check.operatorSig.sig.IsValid()) {
+                sigChecks.emplace_back(&check);
+            }
+        }
+        jobs.clear();
+        for (size_t start = 0; start < sigChecks.size(); start += OPERATOR_SIGS_BATCH_SIZE) {
+            size_t count = std::min(OPERATOR_SIGS_BATCH_SIZE, sigChecks.size() - start);
+            jobs.emplace_back([&sigChecks, start, count]() {
+                std::vector<CProTxOperatorSig> sigs;
+                sigs.reserve(count);
+                for (size_t i = start; i < start + count; i++) {
+                    sigs.emplace_back(sigChecks[i]->operatorSig);
+                }
+                std::vector<bool> vValid;
+                if (VerifyProTxOperatorSigs(sigs, vValid)) {
+                    return;
+                }
+                for (size_t i = 0; i < count; i++) {
+                    if (!vValid[i]) {
+                        sigChecks[start + i]->fValid = false;
+                        sigChecks[start + i]->state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
+                    }
+                }
+            });
+        }
+        llmq::blsWorker->RunJobs(jobs);
+
+        // report the same failure as if all txs were checked in order
+        for (const auto& check : asyncChecks) {
+            if (check.nTxIndex >= nFailedTx) {
+                break;
+            }
+            if (!check.fValid) {
+                state = check.state;
                 return false;
             }
         }
+        if (nFailedTx != (int)block.vtx.size()) {
+            // pass the state returned by the functions above
+            return false;
+        }
 
-        int64_t nTime2 = GetTimeMicros(); nTimeLoop += nTime2 - nTime1;
-        LogPrint(BCLog::BENCHMARK, "        - Loop: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeLoop * 0.000001);
+        int64_t nTime2 = GetTimeMicros(); timings.nSpecialTxs += nTime2 - nTime1;
+        LogPrint(BCLog::BENCHMARK, "        - Loop: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), timings.nSpecialTxs * 0.000001);
 
-        if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state, fJustCheck)) {
+        // all commitment signatures were verified above
+        if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state, fJustCheck, false)) {
             // pass the state returned by the function above
             return false;
         }
 
-        int64_t nTime3 = GetTimeMicros(); nTimeQuorum += nTime3 - nTime2;
-        LogPrint(BCLog::BENCHMARK, "        - quorumBlockProcessor: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeQuorum * 0.000001);
+        int64_t nTime3 = GetTimeMicros(); timings.nQuorumCommitments += nTime3 - nTime2;
+        LogPrint(BCLog::BENCHMARK, "        - quorumBlockProcessor: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), timings.nQuorumCommitments * 0.000001);
 
         if (!deterministicMNManager->ProcessBlock(block, pindex, state, view, fJustCheck)) {
             // pass the state returned by the function above
             return false;
         }
 
-        int64_t nTime4 = GetTimeMicros(); nTimeDMN += nTime4 - nTime3;
-        LogPrint(BCLog::BENCHMARK, "        - deterministicMNManager: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeDMN * 0.000001);
+        int64_t nTime4 = GetTimeMicros(); timings.nDMNList += nTime4 - nTime3;
+        LogPrint(BCLog::BENCHMARK, "        - deterministicMNManager: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), timings.nDMNList * 0.000001);
 
         if (fCheckCbTxMerleRoots && !CheckCbTxMerkleRoots(block, pindex, state, view)) {
             // pass the state returned by the function above
             return false;
         }
 
-        int64_t nTime5 = GetTimeMicros(); nTimeMerkle += nTime5 - nTime4;
-        LogPrint(BCLog::BENCHMARK, "        - CheckCbTxMerkleRoots: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimeMerkle * 0.000001);
+        int64_t nTime5 = GetTimeMicros(); timings.nCbTxMerkleRoots += nTime5 - nTime4;
+        LogPrint(BCLog::BENCHMARK, "        - CheckCbTxMerkleRoots: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), timings.nCbTxMerkleRoots * 0.000001);
     } catch (const std::exception& e) {
         LogPrintf("%s -- failed: %s\n", __func__, e.what());
         return state.DoS(100, false, REJECT_INVALID, "failed-procspectxsinblock");
@@ -169,6 +303,57 @@ bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+void PreVerifySpecialTxsInBlocks(const std::vector<CBlockIndex*>& vpindex, const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+
+    for (const CBlockIndex* pindex : vpindex) {
+        if (pindex->nHeight < consensusParams.DIP0003Height || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            continue;
+        }
+        // commitments can only be mined in the mining window of a DKG session, skip reading all other blocks
+        bool fMiningPhase = false;
+        for (const auto& p : consensusParams.llmqs) {
+            fMiningPhase |= llmq::CQuorumBlockProcessor::IsMiningPhase(p.first, pindex->nHeight);
+        }
+        if (!fMiningPhase) {
+            continue;
+        }
+
+        // ConnectTip reads the block again, but then gets it from the block cache
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensusParams)) {
+            continue;
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->nVersion != 3 || tx->nType != TRANSACTION_QUORUM_COMMITMENT) {
+                continue;
+            }
+            llmq::CFinalCommitmentTxPayload qcTx;
+            if (!GetTxPayload(*tx, qcTx) || qcTx.commitment.IsNull()) {
+                continue;
+            }
+            // the members are only known once the quorum block is connected, which is often not the case for
+            // commitments mined shortly after it
+            const CBlockIndex* pindexQuorum = LookupBlockIndex(qcTx.commitment.quorumHash);
+            if (!pindexQuorum || !chainActive.Contains(pindexQuorum)) {
+                continue;
+            }
+            llmq::quorumBlockProcessor->PreVerifyCommitment(qcTx.commitment, pindexQuorum);
+        }
+    }
+}
+
+void PrepareUndoSpecialTxsInBlocks(const CBlockIndex* pindexTip, const CBlockIndex* pindexFork)
+{
+    try {
+        deterministicMNManager->PrepareReorg(pindexTip, pindexFork);
+    } catch (const std::exception& e) {
+        // only a cache warm-up, UndoSpecialTxsInBlock still works without it
+        LogPrintf("%s -- failed: %s\n", __func__, e.what());
+    }
+}
+
 uint256 CalcTxInputsHash(const CTransaction& tx)
 {
     CHashWriter hw(CLIENT_VERSION, SER_GETHASH);
@@ -9,14 +9,26 @@
 #include <streams.h>
 #include <version.h>
 
+#include <vector>
+
 class CBlock;
 class CBlockIndex;
 class CCoinsViewCache;
 class CValidationState;
+struct CProTxOperatorSig;
+
+namespace Consensus {
+struct Params;
+}
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view);
+// If pOperatorSigRet is given, BLS operator signatures are returned there instead of being verified (see CProTxOperatorSig)
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, CProTxOperatorSig* pOperatorSigRet = nullptr);
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const CCoinsViewCache& view, bool fJustCheck, bool fCheckCbTxMerleRoots);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
+// Starts verifying the quorum commitments of blocks which are about to be connected on the BLS workers
+void PreVerifySpecialTxsInBlocks(const std::vector<CBlockIndex*>& vpindex, const Consensus::Params& consensusParams);
+// Called once before the blocks from pindexTip down to pindexFork are undone by a reorg
+void PrepareUndoSpecialTxsInBlocks(const CBlockIndex* pindexTip, const CBlockIndex* pindexFork);
 
 template <typename T>
 inline bool GetTxPayload(const std::vector<unsigned char>& payload, T& obj)
@@ -42,42 +42,48 @@ private:
 
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << Params().MessageStart(); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        // write to a temporary file first, so that an interrupted dump doesn't leave a corrupted file behind
+        fs::path pathTmp = pathDB;
+        pathTmp += ".new";
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        FILE *file = fsbridge::fopen(pathTmp, "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-        // Write and commit header, data
+        // serialize straight into the file while checksumming the data, then append checksum
         try {
-            fileout << ssObj;
+            CHashedSourceWriter<CAutoFile> hashedOut(&fileout);
+            hashedOut << strMagicMessage; // specific magic message for this type of object
+            hashedOut << Params().MessageStart(); // network specific magic number
+            hashedOut << objToSave;
+            fileout << hashedOut.GetHash();
         }
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        if (!FileCommit(fileout.Get()))
+            return error("%s: Failed to commit file %s", __func__, pathTmp.string());
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed for %s", __func__, pathDB.string());
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
+    // With fDryRun, only the header and the checksum are verified and objToLoad is left untouched
     ReadResult Read(T& objToLoad, bool fDryRun = false)
     {
         //LOCK(objToLoad.cs);
 
         int64_t nStart = GetTimeMillis();
         // open input file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        FILE *file = fsbridge::fopen(pathDB, "rb");
         CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
         if (filein.IsNull())
         {
@@ -85,74 +91,95 @@ private:
             return FileError;
         }
 
-        // use file size to size memory buffer
-        int fileSize = fs::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
-        if (dataSize < 0)
-            dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
-        uint256 hashIn;
-
-        // read data and checksum from file
-        try {
-            filein.read((char *)vchData.data(), dataSize);
-            filein >> hashIn;
-        }
-        catch (std::exception &e) {
-            error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            return HashReadError;
-        }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-        // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-        if (hashIn != hashTmp)
-        {
-            error("%s: Checksum mismatch, data corrupted", __func__);
-            return IncorrectHash;
-        }
+        // everything except the trailing checksum is data
+        uint64_t fileSize = fs::file_size(pathDB);
+        uint64_t dataSize = fileSize > sizeof(uint256) ? fileSize - sizeof(uint256) : 0;
 
+        // The data is deserialized straight from the file while it's hashed, instead of reading the whole file into
+        // memory first. The checksum is verified at the end and takes precedence over all other errors.
+        CHashVerifier<CAutoFile> verifier(&filein);
+        ReadResult readResult = Ok;
 
         unsigned char pchMsgTmp[4];
         std::string strMagicMessageTmp;
         try {
             // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
+            verifier >> strMagicMessageTmp;
 
             // ... verify the message matches predefined one
             if (strMagicMessage != strMagicMessageTmp)
             {
-                error("%s: Invalid magic message", __func__);
-                return IncorrectMagicMessage;
+                readResult = IncorrectMagicMessage;
             }
-
-
-            // de-serialize file header (network specific magic number) and ..
-            ssObj >> pchMsgTmp;
-
-            // ... verify the network matches ours
-            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            else
             {
-                error("%s: Invalid network magic number", __func__);
-                return IncorrectMagicNumber;
+                // de-serialize file header (network specific magic number) and ..
+                verifier >> pchMsgTmp;
+
+                // ... verify the network matches ours
+                if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+                {
+                    readResult = IncorrectMagicNumber;
+                }
+                else if (!fDryRun)
+                {
+                    // de-serialize data into T object
+                    verifier >> objToLoad;
+                }
             }
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            readResult = IncorrectFormat;
+        }
 
-            // de-serialize data into T object
-            ssObj >> objToLoad;
+        // hash whatever is left of the data and read the checksum
+        uint256 hashIn;
+        try {
+            long nPos = ftell(filein.Get());
+            if (nPos < 0 || (uint64_t)nPos > dataSize) {
+                throw std::ios_base::failure("data overlaps checksum");
+            }
+            verifier.ignore(dataSize - nPos);
+            filein >> hashIn;
         }
         catch (std::exception &e) {
-            objToLoad.Clear();
+            if (!fDryRun)
+                objToLoad.Clear();
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            return IncorrectFormat;
+            return HashReadError;
+        }
+        filein.fclose();
+
+        // verify stored checksum matches input data
+        if (hashIn != verifier.GetHash())
+        {
+            if (!fDryRun)
+                objToLoad.Clear();
+            error("%s: Checksum mismatch, data corrupted", __func__);
+            return IncorrectHash;
+        }
+
+        if (readResult == IncorrectMagicMessage)
+        {
+            error("%s: Invalid magic message", __func__);
+            return readResult;
+        }
+        if (readResult == IncorrectMagicNumber)
+        {
+            error("%s: Invalid network magic number", __func__);
+            return readResult;
+        }
+        if (readResult == IncorrectFormat)
+        {
+            if (!fDryRun)
+                objToLoad.Clear();
+            return readResult;
         }
 
         LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
-        LogPrintf("     %s\n", objToLoad.ToString());
         if(!fDryRun) {
+            LogPrintf("     %s\n", objToLoad.ToString());
             LogPrintf("%s: Cleaning....\n", __func__);
             objToLoad.CheckAndRemove();
             LogPrintf("     %s\n", objToLoad.ToString());
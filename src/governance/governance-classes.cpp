@@ -5,6 +5,7 @@
 #include <governance/governance-classes.h>
 
 #include <core_io.h>
+#include <evo/deterministicmns.h>
 #include <governance/governance.h>
 #include <key_io.h>
 #include <primitives/transaction.h>
@@ -126,9 +127,67 @@ bool CGovernanceTriggerManager::AddNewTrigger(uint256 nHash)
 
     mapTrigger.insert(std::make_pair(nHash, pSuperblock));
 
+    // CSuperblock's constructor made sure that the governance object exists
+    int nFundingYesCount = governance.FindGovernanceObject(nHash)->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
+    LOCK(cs);
+    mapTriggersByHeight.emplace(std::make_pair(pSuperblock->GetBlockHeight(), nHash), CTriggerVotes{pSuperblock, nFundingYesCount});
+
     return true;
 }
 
+/**
+*   Remove a trigger whose governance object is erased
+*/
+
+void CGovernanceTriggerManager::RemoveTrigger(const uint256& nHash)
+{
+    AssertLockHeld(governance.cs);
+
+    auto it = mapTrigger.find(nHash);
+    if (it == mapTrigger.end()) {
+        return;
+    }
+    if (it->second) {
+        LOCK(cs);
+        mapTriggersByHeight.erase(std::make_pair(it->second->GetBlockHeight(), nHash));
+    }
+    mapTrigger.erase(it);
+}
+
+/**
+*   Update the funding yes votes of a trigger after votes of its governance object changed
+*/
+
+void CGovernanceTriggerManager::UpdateFundingVotes(const uint256& nHash)
+{
+    AssertLockHeld(governance.cs);
+
+    auto it = mapTrigger.find(nHash);
+    if (it == mapTrigger.end() || !it->second) {
+        return;
+    }
+    const CGovernanceObject* pObj = governance.FindGovernanceObject(nHash);
+    if (!pObj) {
+        return;
+    }
+    int nFundingYesCount = pObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
+
+    LOCK(cs);
+    auto jt = mapTriggersByHeight.find(std::make_pair(it->second->GetBlockHeight(), nHash));
+    if (jt != mapTriggersByHeight.end()) {
+        jt->second.nFundingYesCount = nFundingYesCount;
+    }
+}
+
+void CGovernanceTriggerManager::Clear()
+{
+    AssertLockHeld(governance.cs);
+
+    mapTrigger.clear();
+    LOCK(cs);
+    mapTriggersByHeight.clear();
+}
+
 /**
 *
 *   Clean And Remove
@@ -189,6 +248,10 @@ void CGovernanceTriggerManager::CleanAndRemove()
             }
             LogPrint(BCLog::GOBJECT, "CGovernanceTriggerManager::CleanAndRemove -- Removing trigger object %s\n", strDataAsPlainString);
             // delete the trigger
+            if (pSuperblock) {
+                LOCK(cs);
+                mapTriggersByHeight.erase(std::make_pair(pSuperblock->GetBlockHeight(), it->first));
+            }
             mapTrigger.erase(it++);
         } else {
             ++it;
@@ -196,33 +259,10 @@ void CGovernanceTriggerManager::CleanAndRemove()
     }
 }
 
-/**
-*   Get Active Triggers
-*
-*   - Look through triggers and scan for active ones
-*   - Return the triggers in a list
-*/
-
-std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggers()
-{
-    AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecResults;
-
-    // LOOK AT THESE OBJECTS AND COMPILE A VALID LIST OF TRIGGERS
-    for (const auto& pair : mapTrigger) {
-        const CGovernanceObject* pObj = governance.FindGovernanceObject(pair.first);
-        if (pObj) {
-            vecResults.push_back(pair.second);
-        }
-    }
-
-    return vecResults;
-}
-
 /**
 *   Is Superblock Triggered
 *
-*   - Does this block have a non-executed and actived trigger?
+*   - Does this block have a trigger with enough funding votes?
 */
 
 bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
@@ -232,45 +272,19 @@ bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
         return false;
     }
 
-    LOCK(governance.cs);
-    // GET ALL ACTIVE TRIGGERS
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
-
-    LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- vecTriggers.size() = %d\n", vecTriggers.size());
-
-    for (const auto& pSuperblock : vecTriggers) {
-        if (!pSuperblock) {
-            LogPrintf("CSuperblockManager::IsSuperblockTriggered -- Non-superblock found, continuing\n");
-            continue;
-        }
-
-        CGovernanceObject* pObj = pSuperblock->GetGovernanceObject();
-
-        if (!pObj) {
-            LogPrintf("CSuperblockManager::IsSuperblockTriggered -- pObj == nullptr, continuing\n");
-            continue;
-        }
-
-        LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- data = %s\n", pObj->GetDataAsPlainString());
-
-        // note : 12.1 - is epoch calculation correct?
-
-        if (nBlockHeight != pSuperblock->GetBlockHeight()) {
-            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- block height doesn't match nBlockHeight = %d, blockStart = %d, continuing\n",
-                nBlockHeight,
-                pSuperblock->GetBlockHeight());
-            continue;
-        }
-
-        // MAKE SURE THIS TRIGGER IS ACTIVE VIA FUNDING CACHE FLAG
-
-        pObj->UpdateSentinelVariables();
+    // SAME REQUIREMENT AS FOR fCachedFunding, SEE CGovernanceObject::UpdateSentinelVariables
+    int nMnCount = (int)deterministicMNManager->GetListAtChainTip().GetValidMNsCount();
+    if (nMnCount == 0) {
+        return false;
+    }
+    int nAbsVoteReq = std::max(Params().GetConsensus().nGovernanceMinQuorum, nMnCount / 10);
 
-        if (pObj->IsSetCachedFunding()) {
-            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- fCacheFunding = true, returning true\n");
+    LOCK(triggerman.cs);
+    auto it = triggerman.mapTriggersByHeight.lower_bound(std::make_pair(nBlockHeight, uint256()));
+    for (; it != triggerman.mapTriggersByHeight.end() && it->first.first == nBlockHeight; ++it) {
+        if (it->second.nFundingYesCount >= nAbsVoteReq) {
+            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- funding yes count = %d, returning true\n", it->second.nFundingYesCount);
             return true;
-        } else {
-            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- fCacheFunding = false, continuing\n");
         }
     }
 
@@ -284,27 +298,17 @@ bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int
         return false;
     }
 
-    AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    LOCK(triggerman.cs);
     int nYesCount = 0;
 
-    for (const auto& pSuperblock : vecTriggers) {
-        if (!pSuperblock || nBlockHeight != pSuperblock->GetBlockHeight()) {
-            continue;
-        }
-
-        const CGovernanceObject* pObj = pSuperblock->GetGovernanceObject();
-
-        if (!pObj) {
-            continue;
-        }
-
+    // TRIGGERS WITH THE SAME NUMBER OF VOTES ARE ORDERED BY HASH, THE FIRST ONE WINS
+    auto it = triggerman.mapTriggersByHeight.lower_bound(std::make_pair(nBlockHeight, uint256()));
+    for (; it != triggerman.mapTriggersByHeight.end() && it->first.first == nBlockHeight; ++it) {
         // DO WE HAVE A NEW WINNER?
 
-        int nTempYesCount = pObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
-        if (nTempYesCount > nYesCount) {
-            nYesCount = nTempYesCount;
-            pSuperblockRet = pSuperblock;
+        if (it->second.nFundingYesCount > nYesCount) {
+            nYesCount = it->second.nFundingYesCount;
+            pSuperblockRet = it->second.pSuperblock;
         }
     }
 
@@ -319,8 +323,6 @@ bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int
 
 bool CSuperblockManager::GetSuperblockPayments(int nBlockHeight, std::vector<CTxOut>& voutSuperblockRet)
 {
-    LOCK(governance.cs);
-
     // GET THE BEST SUPERBLOCK FOR THIS BLOCK HEIGHT
 
     CSuperblock_sptr pSuperblock;
@@ -368,8 +370,6 @@ bool CSuperblockManager::GetSuperblockPayments(int nBlockHeight, std::vector<CTx
 bool CSuperblockManager::IsValid(const CTransaction& txNew, int nBlockHeight, CAmount blockReward)
 {
     // GET BEST SUPERBLOCK, SHOULD MATCH
-    LOCK(governance.cs);
-
     CSuperblock_sptr pSuperblock;
     if (CSuperblockManager::GetBestSuperblock(pSuperblock, nBlockHeight)) {
         return pSuperblock->IsValid(txNew, nBlockHeight, blockReward);
@@ -614,8 +614,8 @@ bool CSuperblock::IsValid(const CTransaction& txNew, int nBlockHeight, CAmount b
     int nPayments = CountPayments();
     int nMinerAndMasternodePayments = nOutputs - nPayments;
 
-    LogPrint(BCLog::GOBJECT, "CSuperblock::IsValid -- nOutputs = %d, nPayments = %d, GetDataAsHexString = %s\n",
-        nOutputs, nPayments, GetGovernanceObject()->GetDataAsHexString());
+    LogPrint(BCLog::GOBJECT, "CSuperblock::IsValid -- nOutputs = %d, nPayments = %d, nGovObjHash = %s\n",
+        nOutputs, nPayments, nGovObjHash.ToString());
 
     // We require an exact match (including order) between the expected
     // superblock payments and the payments actually in the block.
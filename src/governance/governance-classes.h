@@ -8,8 +8,11 @@
 #include <governance/governance-object.h>
 #include <script/script.h>
 #include <script/standard.h>
+#include <sync.h>
 #include <uint256.h>
 
+#include <map>
+
 class CTxOut;
 class CTransaction;
 
@@ -35,11 +38,24 @@ class CGovernanceTriggerManager
     friend class CGovernanceManager;
 
 private:
+    struct CTriggerVotes {
+        CSuperblock_sptr pSuperblock;
+        int nFundingYesCount;
+    };
+
     std::map<uint256, CSuperblock_sptr> mapTrigger;
 
-    std::vector<CSuperblock_sptr> GetActiveTriggers();
+    // Triggers by superblock height (and hash), limited to triggers whose governance object is known. The funding yes
+    // votes are updated by CGovernanceManager whenever votes of a trigger change, so that block validation only looks
+    // at the triggers for the height of the block and doesn't need governance.cs.
+    mutable CCriticalSection cs;
+    std::map<std::pair<int, uint256>, CTriggerVotes> mapTriggersByHeight GUARDED_BY(cs);
+
     bool AddNewTrigger(uint256 nHash);
+    void RemoveTrigger(const uint256& nHash);
+    void UpdateFundingVotes(const uint256& nHash);
     void CleanAndRemove();
+    void Clear();
 
 public:
     CGovernanceTriggerManager() :
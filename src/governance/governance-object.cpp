@@ -10,6 +10,7 @@
 #include <governance/governance.h>
 #include <masternode/masternode-meta.h>
 #include <masternode/masternode-sync.h>
+#include <memusage.h>
 #include <messagesigner.h>
 #include <net.h>
 #include <validation.h>
@@ -38,6 +39,7 @@ CGovernanceObject::CGovernanceObject() :
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteCounts(),
     fileVotes()
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
@@ -65,6 +67,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteCounts(),
     fileVotes()
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
@@ -91,7 +94,9 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fDirtyCache(other.fDirtyCache),
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
+    collateralLookup(other.collateralLookup),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    voteCounts(other.voteCounts),
     fileVotes(other.fileVotes)
 {
 }
@@ -206,6 +211,8 @@ bool CGovernanceObject::ProcessVote(const CGovernanceVote& vote, CGovernanceExce
         return false;
     }
 
+    AdjustVoteCount(eSignal, voteInstanceRef.eOutcome, -1);
+    AdjustVoteCount(eSignal, vote.GetOutcome(), 1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
     fileVotes.AddVote(vote);
     fDirtyCache = true;
@@ -224,6 +231,9 @@ void CGovernanceObject::ClearMasternodeVotes()
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            for (const auto& p : it->second.mapInstances) {
+                AdjustVoteCount(p.first, p.second.eOutcome, -1);
+            }
             mapCurrentMNVotes.erase(it++);
             fDirtyCache = true;
         } else {
@@ -252,6 +262,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome);
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            AdjustVoteCount(jt->first, jt->second.eOutcome, -1);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -521,8 +532,61 @@ CAmount CGovernanceObject::GetMinCollateralFee() const
 
 bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingConfirmations) const
 {
+    AssertLockHeld(cs_main);
+
     strError = "";
     fMissingConfirmations = false;
+
+    // Look up the TX only if it wasn't found in the active chain before. Without txindex, this can mean scanning block
+    // files, so failed lookups are only repeated once a new block was connected
+    const CBlockIndex* pindex{nullptr};
+    if (collateralLookup.fValidTx) {
+        pindex = LookupBlockIndex(collateralLookup.nBlockHash);
+    }
+    if (!pindex || !chainActive.Contains(pindex)) {
+        if (collateralLookup.pindexFailedAt && collateralLookup.pindexFailedAt == chainActive.Tip()) {
+            strError = collateralLookup.strFailedError;
+            return false;
+        }
+        uint256 nBlockHash;
+        if (!LookupCollateral(strError, nBlockHash)) {
+            collateralLookup.fValidTx = false;
+            collateralLookup.pindexFailedAt = chainActive.Tip();
+            collateralLookup.strFailedError = strError;
+            return false;
+        }
+        collateralLookup.fValidTx = true;
+        collateralLookup.nBlockHash = nBlockHash;
+        collateralLookup.pindexFailedAt = nullptr;
+        pindex = LookupBlockIndex(nBlockHash);
+    }
+
+    // GET CONFIRMATIONS FOR TRANSACTION
+
+    int nConfirmationsIn = 0;
+    if (pindex && chainActive.Contains(pindex)) {
+        nConfirmationsIn += chainActive.Height() - pindex->nHeight + 1;
+    }
+
+    if (nConfirmationsIn < GOVERNANCE_FEE_CONFIRMATIONS) {
+        strError = strprintf("Collateral requires at least %d confirmations to be relayed throughout the network (it has only %d)", GOVERNANCE_FEE_CONFIRMATIONS, nConfirmationsIn);
+        if (nConfirmationsIn >= GOVERNANCE_MIN_RELAY_FEE_CONFIRMATIONS) {
+            fMissingConfirmations = true;
+            strError += ", pre-accepted -- waiting for required confirmations";
+        } else {
+            strError += ", rejected -- try again later";
+        }
+        LogPrintf("CGovernanceObject::IsCollateralValid -- %s\n", strError);
+
+        return false;
+    }
+
+    strError = "valid";
+    return true;
+}
+
+bool CGovernanceObject::LookupCollateral(std::string& strError, uint256& nBlockHashRet) const
+{
     CAmount nMinFee = GetMinCollateralFee();
     uint256 nExpectedHash = GetHash();
 
@@ -577,47 +641,47 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
         return false;
     }
 
-    // GET CONFIRMATIONS FOR TRANSACTION
+    nBlockHashRet = nBlockHash;
+    return true;
+}
 
-    AssertLockHeld(cs_main);
-    int nConfirmationsIn = 0;
-    if (nBlockHash != uint256()) {
-        const CBlockIndex* pindex = LookupBlockIndex(nBlockHash);
-        if (pindex && chainActive.Contains(pindex)) {
-            nConfirmationsIn += chainActive.Height() - pindex->nHeight + 1;
-        }
+size_t CGovernanceObject::GetDynamicMemoryUsage() const
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(vchData) + memusage::DynamicUsage(mapCurrentMNVotes);
+    for (const auto& p : mapCurrentMNVotes) {
+        nUsage += memusage::DynamicUsage(p.second.mapInstances);
     }
+    return nUsage + fileVotes.GetMemoryUsage();
+}
 
-    if (nConfirmationsIn < GOVERNANCE_FEE_CONFIRMATIONS) {
-        strError = strprintf("Collateral requires at least %d confirmations to be relayed throughout the network (it has only %d)", GOVERNANCE_FEE_CONFIRMATIONS, nConfirmationsIn);
-        if (nConfirmationsIn >= GOVERNANCE_MIN_RELAY_FEE_CONFIRMATIONS) {
-            fMissingConfirmations = true;
-            strError += ", pre-accepted -- waiting for required confirmations";
-        } else {
-            strError += ", rejected -- try again later";
-        }
-        LogPrintf("CGovernanceObject::IsCollateralValid -- %s\n", strError);
+int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+{
+    LOCK(cs);
 
-        return false;
+    if (eVoteSignalIn < 0 || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL || eVoteOutcomeIn < 0 || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        return 0;
     }
-
-    strError = "valid";
-    return true;
+    return voteCounts[eVoteSignalIn][eVoteOutcomeIn];
 }
 
-int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+void CGovernanceObject::AdjustVoteCount(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
 {
-    LOCK(cs);
+    // placeholder instances (VOTE_OUTCOME_NONE) and unsupported signals are never queried
+    if (nSignal < 0 || nSignal > MAX_SUPPORTED_VOTE_SIGNAL || eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) {
+        return;
+    }
+    voteCounts[nSignal][eOutcome] += nDelta;
+}
 
-    int nCount = 0;
+void CGovernanceObject::RebuildVoteCounts()
+{
+    voteCounts = vote_count_t();
     for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        auto it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if (it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
+        for (const auto& p : votepair.second.mapInstances) {
+            AdjustVoteCount(p.first, p.second.eOutcome, 1);
         }
     }
-    return nCount;
 }
 
 /**
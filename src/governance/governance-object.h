@@ -13,6 +13,9 @@
 
 #include <univalue.h>
 
+#include <array>
+
+class CBlockIndex;
 class CBLSSecretKey;
 class CBLSPublicKey;
 class CNode;
@@ -149,8 +152,24 @@ private:
     /// Failed to parse object data
     bool fUnparsable;
 
+    /// Result of the last collateral TX lookup, so that objects can be re-validated without looking up the TX again.
+    /// Protected by cs_main
+    struct CollateralLookup {
+        /// the TX contains a valid proof of burn and was mined in nBlockHash, only the confirmations are left to check
+        bool fValidTx{false};
+        uint256 nBlockHash;
+        /// tip at the time of a failed lookup, the result can only change when a new block is connected
+        const CBlockIndex* pindexFailedAt{nullptr};
+        std::string strFailedError;
+    };
+    mutable CollateralLookup collateralLookup;
+
     vote_m_t mapCurrentMNVotes;
 
+    /// Number of current votes per signal and outcome, kept in sync with mapCurrentMNVotes
+    typedef std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> vote_count_t;
+    vote_count_t voteCounts;
+
     CGovernanceObjectVoteFile fileVotes;
 
 public:
@@ -227,6 +246,9 @@ public:
         return fileVotes;
     }
 
+    /// Approximate memory used by the object's data and votes, not including the object itself
+    size_t GetDynamicMemoryUsage() const;
+
     // Signature related functions
 
     void SetMasternodeOutpoint(const COutPoint& outpoint);
@@ -302,6 +324,7 @@ public:
             // Only include these for the disk file format
             LogPrint(BCLog::GOBJECT, "CGovernanceObject::SerializationOp Reading/writing votes from/to disk\n");
             READWRITE(obj.nDeletionTime, obj.fExpired, obj.mapCurrentMNVotes, obj.fileVotes);
+            SER_READ(obj, obj.RebuildVoteCounts());
             LogPrint(BCLog::GOBJECT, "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", obj.GetHash().ToString(), obj.fileVotes.GetVoteCount());
         }
 
@@ -324,6 +347,11 @@ public:
     // also for MNs that were removed from the list completely.
     // Returns deleted vote hashes.
     std::set<uint256> RemoveInvalidVotes(const COutPoint& mnOutpoint);
+
+private:
+    void AdjustVoteCount(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    void RebuildVoteCounts();
+    bool LookupCollateral(std::string& strError, uint256& nBlockHashRet) const;
 };
 
 
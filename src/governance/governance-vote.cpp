@@ -245,6 +245,11 @@ bool CGovernanceVote::CheckSignature(const CBLSPublicKey& pubKey) const
 }
 
 bool CGovernanceVote::IsValid(bool useVotingKey) const
+{
+    return IsValid(deterministicMNManager->GetListAtChainTip(), useVotingKey);
+}
+
+bool CGovernanceVote::IsValid(const CDeterministicMNList& tipMNList, bool useVotingKey) const
 {
     if (nTime > GetAdjustedTime() + (60 * 60)) {
         LogPrint(BCLog::GOBJECT, "CGovernanceVote::IsValid -- vote is too far ahead of current time - %s - nTime %lli - Max Time %lli\n", GetHash().ToString(), nTime, GetAdjustedTime() + (60 * 60));
@@ -263,7 +268,7 @@ bool CGovernanceVote::IsValid(bool useVotingKey) const
         return false;
     }
 
-    auto dmn = deterministicMNManager->GetListAtChainTip().GetMNByCollateral(masternodeOutpoint);
+    auto dmn = tipMNList.GetMNByCollateral(masternodeOutpoint);
     if (!dmn) {
         LogPrint(BCLog::GOBJECT, "CGovernanceVote::IsValid -- Unknown Masternode - %s\n", masternodeOutpoint.ToStringShort());
         return false;
@@ -11,6 +11,7 @@ class CGovernanceVote;
 class CBLSPublicKey;
 class CBLSSecretKey;
 class CConnman;
+class CDeterministicMNList;
 class CKey;
 class CKeyID;
 
@@ -96,12 +97,15 @@ public:
     }
 
     void SetSignature(const std::vector<unsigned char>& vchSigIn) { vchSig = vchSigIn; }
+    const std::vector<unsigned char>& GetSignature() const { return vchSig; }
 
     bool Sign(const CKey& key, const CKeyID& keyID);
     bool CheckSignature(const CKeyID& keyID) const;
     bool Sign(const CBLSSecretKey& key);
     bool CheckSignature(const CBLSPublicKey& pubKey) const;
     bool IsValid(bool useVotingKey) const;
+    // same as above, but checks against the given (tip) MN list instead of fetching it again
+    bool IsValid(const CDeterministicMNList& tipMNList, bool useVotingKey) const;
     void Relay(CConnman& connman) const;
 
     const COutPoint& GetMasternodeOutpoint() const { return masternodeOutpoint; }
@@ -4,21 +4,39 @@
 
 #include <governance/governance-votedb.h>
 
+#include <memusage.h>
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
     nMemoryVotes(0),
     listVotes(),
-    mapVoteIndex()
+    mapVoteIndex(),
+    mapMasternodeVotes()
 {
 }
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other) :
     nMemoryVotes(other.nMemoryVotes),
     listVotes(other.listVotes),
-    mapVoteIndex()
+    mapVoteIndex(),
+    mapMasternodeVotes()
 {
     RebuildIndex();
 }
 
+size_t CGovernanceObjectVoteFile::GetMemoryUsage() const
+{
+    // list nodes hold the vote and two pointers
+    size_t nUsage = listVotes.size() * memusage::MallocUsage(sizeof(CGovernanceVote) + 2 * sizeof(void*));
+    for (const auto& vote : listVotes) {
+        nUsage += memusage::DynamicUsage(vote.GetSignature());
+    }
+    nUsage += memusage::DynamicUsage(mapVoteIndex) + memusage::DynamicUsage(mapMasternodeVotes);
+    for (const auto& p : mapMasternodeVotes) {
+        nUsage += memusage::DynamicUsage(p.second);
+    }
+    return nUsage;
+}
+
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
     uint256 nHash = vote.GetHash();
@@ -27,6 +45,7 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
         return;
     listVotes.push_front(vote);
     mapVoteIndex.emplace(nHash, listVotes.begin());
+    mapMasternodeVotes[vote.GetMasternodeOutpoint()].emplace_back(listVotes.begin());
     ++nMemoryVotes;
     RemoveOldVotes(vote);
 }
@@ -56,35 +75,40 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    auto it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        } else {
-            ++it;
-        }
+    auto mnIt = mapMasternodeVotes.find(outpointMasternode);
+    if (mnIt == mapMasternodeVotes.end()) {
+        return;
+    }
+    for (const auto& it : mnIt->second) {
+        EraseVote(it);
     }
+    mapMasternodeVotes.erase(mnIt);
 }
 
 std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal)
 {
     std::set<uint256> removedVotes;
 
-    auto it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            bool useVotingKey = fProposal && (it->GetSignal() == VOTE_SIGNAL_FUNDING);
-            if (!it->IsValid(useVotingKey)) {
-                removedVotes.emplace(it->GetHash());
-                --nMemoryVotes;
-                mapVoteIndex.erase(it->GetHash());
-                listVotes.erase(it++);
-                continue;
-            }
+    auto mnIt = mapMasternodeVotes.find(outpointMasternode);
+    if (mnIt == mapMasternodeVotes.end()) {
+        return removedVotes;
+    }
+
+    auto& vecVotes = mnIt->second;
+    auto jt = vecVotes.begin();
+    while (jt != vecVotes.end()) {
+        auto it = *jt;
+        bool useVotingKey = fProposal && (it->GetSignal() == VOTE_SIGNAL_FUNDING);
+        if (!it->IsValid(useVotingKey)) {
+            removedVotes.emplace(it->GetHash());
+            EraseVote(it);
+            jt = vecVotes.erase(jt);
+        } else {
+            ++jt;
         }
-        ++it;
+    }
+    if (vecVotes.empty()) {
+        mapMasternodeVotes.erase(mnIt);
     }
 
     return removedVotes;
@@ -92,25 +116,39 @@ std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint&
 
 void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote)
 {
-    auto it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == vote.GetMasternodeOutpoint() // same masternode
-            && it->GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
+    auto mnIt = mapMasternodeVotes.find(vote.GetMasternodeOutpoint());
+    if (mnIt == mapMasternodeVotes.end()) {
+        return;
+    }
+
+    // only votes from the same masternode are in here
+    auto& vecVotes = mnIt->second;
+    auto jt = vecVotes.begin();
+    while (jt != vecVotes.end()) {
+        auto it = *jt;
+        if (it->GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
             && it->GetSignal() == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
             && it->GetTimestamp() < vote.GetTimestamp()) // older than new vote
         {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+            EraseVote(it);
+            jt = vecVotes.erase(jt);
         } else {
-            ++it;
+            ++jt;
         }
     }
 }
 
+void CGovernanceObjectVoteFile::EraseVote(vote_l_t::iterator it)
+{
+    --nMemoryVotes;
+    mapVoteIndex.erase(it->GetHash());
+    listVotes.erase(it);
+}
+
 void CGovernanceObjectVoteFile::RebuildIndex()
 {
     mapVoteIndex.clear();
+    mapMasternodeVotes.clear();
     nMemoryVotes = 0;
     auto it = listVotes.begin();
     while (it != listVotes.end()) {
@@ -118,6 +156,7 @@ void CGovernanceObjectVoteFile::RebuildIndex()
         uint256 nHash = vote.GetHash();
         if (mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
             mapVoteIndex[nHash] = it;
+            mapMasternodeVotes[vote.GetMasternodeOutpoint()].emplace_back(it);
             ++nMemoryVotes;
             ++it;
         } else {
@@ -7,6 +7,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 #include <governance/governance-vote.h>
 #include <serialize.h>
@@ -28,6 +29,8 @@ public: // Types
 
     typedef std::map<uint256, vote_l_t::iterator> vote_m_t;
 
+    typedef std::map<COutPoint, std::vector<vote_l_t::iterator>> vote_mn_m_t;
+
 private:
     int nMemoryVotes;
 
@@ -35,6 +38,10 @@ private:
 
     vote_m_t mapVoteIndex;
 
+    // Votes by masternode, so that removing or replacing the votes of a single masternode doesn't need to walk
+    // through all votes of the object
+    vote_mn_m_t mapMasternodeVotes;
+
 public:
     CGovernanceObjectVoteFile();
 
@@ -62,6 +69,22 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    /**
+     * Approximate memory used by the votes and their indexes
+     */
+    size_t GetMemoryUsage() const;
+
+    /**
+     * Calls f(hash, vote) for all votes without copying them
+     */
+    template<typename Callback>
+    void ForEachVote(Callback&& f) const
+    {
+        for (const auto& p : mapVoteIndex) {
+            f(p.first, *p.second);
+        }
+    }
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
@@ -75,6 +98,8 @@ private:
     // Drop older votes for the same gobject from the same masternode
     void RemoveOldVotes(const CGovernanceVote& vote);
 
+    void EraseVote(vote_l_t::iterator it);
+
     void RebuildIndex();
 };
 
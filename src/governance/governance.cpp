@@ -11,12 +11,14 @@
 #include <governance/governance-validators.h>
 #include <masternode/masternode-meta.h>
 #include <masternode/masternode-sync.h>
+#include <memusage.h>
 #include <net_processing.h>
 #include <netfulfilledman.h>
 #include <netmessagemaker.h>
 #include <protocol.h>
 #include <shutdown.h>
 #include <spork.h>
+#include <util/memaccounting.h>
 
 #include <evo/deterministicmns.h>
 
@@ -27,6 +29,7 @@ int nSubmittedFinalBudget;
 const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-15";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60 * 60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
+const int64_t CGovernanceManager::MAINTENANCE_SLICE_MICROS = 5 * 1000;
 
 CGovernanceManager::CGovernanceManager() :
     nTimeLastDiff(0),
@@ -42,6 +45,27 @@ CGovernanceManager::CGovernanceManager() :
     lastMNListForVotingKeys(std::make_shared<CDeterministicMNList>()),
     cs()
 {
+    memaccounting::Register("governance", this, [this]() {
+        LOCK(cs);
+        size_t nUsage = memusage::DynamicUsage(mapObjects) + memusage::DynamicUsage(mapPostponedObjects) +
+                        memusage::DynamicUsage(mapErasedGovernanceObjects);
+        for (const auto& p : mapObjects) {
+            nUsage += p.second.GetDynamicMemoryUsage();
+        }
+        for (const auto& p : mapPostponedObjects) {
+            nUsage += p.second.GetDynamicMemoryUsage();
+        }
+        // the caches are bounded by MAX_CACHE_SIZE, estimate them by their number of entries
+        nUsage += cmapVoteToObject.GetSize() * memusage::MallocUsage(sizeof(uint256) + 4 * sizeof(void*));
+        nUsage += (cmapInvalidVotes.GetSize() + cmmapOrphanVotes.GetSize()) *
+                  memusage::MallocUsage(sizeof(CGovernanceVote) + sizeof(uint256) + 4 * sizeof(void*));
+        return nUsage;
+    });
+}
+
+CGovernanceManager::~CGovernanceManager()
+{
+    memaccounting::Unregister(this);
 }
 
 // Accessors for thread-safe access to maps
@@ -279,6 +303,9 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CConnman& c
             cmmapOrphanVotes.Erase(nHash, pairVote);
         }
     }
+    if (govobj.GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+        triggerman.UpdateFundingVotes(nHash);
+    }
 }
 
 void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman& connman, const CNode* pfrom)
@@ -310,6 +337,7 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- already have governance object %s\n", nHash.ToString());
         return;
     }
+    nChangeCounter++;
 
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANAGERS?
 
@@ -338,6 +366,22 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
     GetMainSignals().NotifyGovernanceObject(std::make_shared<const CGovernanceObject>(govobj));
 }
 
+void CGovernanceManager::Clear()
+{
+    LOCK(cs);
+
+    LogPrint(BCLog::GOBJECT, "Governance object manager was cleared\n");
+    mapObjects.clear();
+    mapErasedGovernanceObjects.clear();
+    setErasedGovernanceObjectsByExpiry.clear();
+    cmapVoteToObject.Clear();
+    cmapInvalidVotes.Clear();
+    cmmapOrphanVotes.Clear();
+    mapLastMasternodeObject.clear();
+    triggerman.Clear();
+    nChangeCounter++;
+}
+
 void CGovernanceManager::UpdateCachesAndClean()
 {
     // Return on initial sync, spammed the debug.log and provided no use
@@ -349,32 +393,67 @@ void CGovernanceManager::UpdateCachesAndClean()
 
     std::vector<uint256> vecDirtyHashes = mmetaman.GetAndClearDirtyGovernanceObjectHashes();
 
-    LOCK2(cs_main, cs);
+    int64_t nNow = GetAdjustedTime();
 
-    for (const uint256& nHash : vecDirtyHashes) {
-        auto it = mapObjects.find(nHash);
-        if (it == mapObjects.end()) {
-            continue;
+    {
+        LOCK2(cs_main, cs);
+
+        for (const uint256& nHash : vecDirtyHashes) {
+            auto it = mapObjects.find(nHash);
+            if (it == mapObjects.end()) {
+                continue;
+            }
+            it->second.ClearMasternodeVotes();
+            if (it->second.GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+                triggerman.UpdateFundingVotes(nHash);
+            }
+        }
+
+        ScopedLockBool guard(cs, fRateChecksEnabled, false);
+
+        // Clean up any expired or invalid triggers
+        triggerman.CleanAndRemove();
+
+        // forget about expired deleted objects
+        while (!setErasedGovernanceObjectsByExpiry.empty() && setErasedGovernanceObjectsByExpiry.begin()->first < nNow) {
+            mapErasedGovernanceObjects.erase(setErasedGovernanceObjectsByExpiry.begin()->second);
+            setErasedGovernanceObjectsByExpiry.erase(setErasedGovernanceObjectsByExpiry.begin());
+            nChangeCounter++;
         }
-        it->second.ClearMasternodeVotes();
     }
 
-    ScopedLockBool guard(cs, fRateChecksEnabled, false);
+    // Walk through all objects in slices and release the locks in between, so that message processing is not blocked
+    // for the whole time
+    uint256 nCursor;
+    bool fDone = false;
+    while (!fDone) {
+        LOCK2(cs_main, cs);
+        fDone = UpdateCachesAndCleanSlice(nCursor, nNow);
+    }
 
-    // Clean up any expired or invalid triggers
-    triggerman.CleanAndRemove();
+    LogPrint(BCLog::GOBJECT, "CGovernanceManager::UpdateCachesAndClean -- %s\n", ToString());
+}
 
-    auto it = mapObjects.begin();
-    int64_t nNow = GetAdjustedTime();
+bool CGovernanceManager::UpdateCachesAndCleanSlice(uint256& nCursor, int64_t nNow)
+{
+    AssertLockHeld(cs);
 
-    while (it != mapObjects.end()) {
-        CGovernanceObject* pObj = &((*it).second);
+    ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
-        if (!pObj) {
-            ++it;
-            continue;
+    int64_t nSliceStart = GetTimeMicros();
+    std::set<const CGovernanceObject*> setErasedObjects;
+    size_t nProcessed = 0;
+
+    auto it = mapObjects.lower_bound(nCursor);
+    while (it != mapObjects.end()) {
+        // always make some progress, even if acquiring the locks took longer than a slice
+        if (nProcessed++ > 0 && GetTimeMicros() - nSliceStart >= MAINTENANCE_SLICE_MICROS) {
+            nCursor = it->first;
+            break;
         }
 
+        CGovernanceObject* pObj = &((*it).second);
+
         uint256 nHash = it->first;
         std::string strHash = nHash.ToString();
 
@@ -399,19 +478,6 @@ void CGovernanceManager::UpdateCachesAndClean()
             LogPrint(BCLog::GOBJECT, "CGovernanceManager::UpdateCachesAndClean -- erase obj %s\n", (*it).first.ToString());
             mmetaman.RemoveGovernanceObject(pObj->GetHash());
 
-            // Remove vote references
-            const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
-            auto lit = listItems.begin();
-            while (lit != listItems.end()) {
-                if (lit->value == pObj) {
-                    uint256 nKey = lit->key;
-                    ++lit;
-                    cmapVoteToObject.Erase(nKey);
-                } else {
-                    ++lit;
-                }
-            }
-
             int64_t nTimeExpired{0};
 
             if (pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
@@ -422,7 +488,13 @@ void CGovernanceManager::UpdateCachesAndClean()
                 nTimeExpired = pObj->GetCreationTime() + 2 * nSuperblockCycleSeconds + GOVERNANCE_DELETION_DELAY;
             }
 
-            mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            if (mapErasedGovernanceObjects.emplace(nHash, nTimeExpired).second && nTimeExpired != std::numeric_limits<int64_t>::max()) {
+                setErasedGovernanceObjectsByExpiry.emplace(nTimeExpired, nHash);
+            }
+            if (pObj->GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+                triggerman.RemoveTrigger(nHash);
+            }
+            setErasedObjects.emplace(pObj);
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -437,17 +509,24 @@ void CGovernanceManager::UpdateCachesAndClean()
         }
     }
 
-    // forget about expired deleted objects
-    auto s_it = mapErasedGovernanceObjects.begin();
-    while (s_it != mapErasedGovernanceObjects.end()) {
-        if (s_it->second < nNow) {
-            mapErasedGovernanceObjects.erase(s_it++);
-        } else {
-            ++s_it;
+    // Remove vote references to all objects erased in this slice with a single pass. This must happen before the lock
+    // is released as the references would be dangling otherwise.
+    if (!setErasedObjects.empty()) {
+        nChangeCounter++;
+        const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
+        auto lit = listItems.begin();
+        while (lit != listItems.end()) {
+            if (setErasedObjects.count(lit->value)) {
+                uint256 nKey = lit->key;
+                ++lit;
+                cmapVoteToObject.Erase(nKey);
+            } else {
+                ++lit;
+            }
         }
     }
 
-    LogPrint(BCLog::GOBJECT, "CGovernanceManager::UpdateCachesAndClean -- %s\n", ToString());
+    return it == mapObjects.end();
 }
 
 CGovernanceObject* CGovernanceManager::FindGovernanceObject(const uint256& nHash)
@@ -633,18 +712,22 @@ void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp,
     }
 
     const auto& fileVotes = govobj.GetVoteFile();
+    auto tipMNList = deterministicMNManager->GetListAtChainTip();
 
-    for (const auto& vote : fileVotes.GetVotes()) {
-        uint256 nVoteHash = vote.GetHash();
+    // Only votes which the peer doesn't have yet are validated, everything else just costs a filter lookup
+    fileVotes.ForEachVote([&](const uint256& nVoteHash, const CGovernanceVote& vote) {
+        if (filter.contains(nVoteHash)) {
+            return;
+        }
 
         bool onlyVotingKeyAllowed = govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
 
-        if (filter.contains(nVoteHash) || !vote.IsValid(onlyVotingKeyAllowed)) {
-            continue;
+        if (!vote.IsValid(tipMNList, onlyVotingKeyAllowed)) {
+            return;
         }
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
         ++nVoteCount;
-    }
+    });
 
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
     connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ_VOTE, nVoteCount));
@@ -656,14 +739,14 @@ void CGovernanceManager::SyncObjects(CNode* pnode, CConnman& connman) const
     // do not provide any data until our node is synced
     if (!masternodeSync.IsSynced()) return;
 
-    if (netfulfilledman.HasFulfilledRequest(pnode->addr, NetMsgType::MNGOVERNANCESYNC)) {
+    if (netfulfilledman.HasFulfilledRequest(pnode->addr, FulfilledRequest::GOVERNANCE_SYNC_SERVED)) {
         LOCK(cs_main);
         // Asking for the whole list multiple times in a short period of time is no good
         LogPrint(BCLog::GOBJECT, "CGovernanceManager::%s -- peer already asked me for the list\n", __func__);
         Misbehaving(pnode->GetId(), 20);
         return;
     }
-    netfulfilledman.AddFulfilledRequest(pnode->addr, NetMsgType::MNGOVERNANCESYNC);
+    netfulfilledman.AddFulfilledRequest(pnode->addr, FulfilledRequest::GOVERNANCE_SYNC_SERVED);
 
     int nObjCount = 0;
 
@@ -840,6 +923,12 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
     }
 
     bool fOk = govobj.ProcessVote(vote, exception) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    if (fOk) {
+        nChangeCounter++;
+        if (govobj.GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+            triggerman.UpdateFundingVotes(nHashGovobj);
+        }
+    }
     LEAVE_CRITICAL_SECTION(cs)
     return fOk;
 }
@@ -1082,6 +1171,7 @@ void CGovernanceManager::RebuildIndexes()
     LOCK(cs);
 
     cmapVoteToObject.Clear();
+    nChangeCounter++;
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
         std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
@@ -1280,12 +1370,16 @@ void CGovernanceManager::RemoveInvalidVotes()
             if (removed.empty()) {
                 continue;
             }
+            nChangeCounter++;
             for (auto& voteHash : removed) {
                 cmapVoteToObject.Erase(voteHash);
                 cmapInvalidVotes.Erase(voteHash);
                 cmmapOrphanVotes.Erase(voteHash);
                 setRequestedVotes.erase(voteHash);
             }
+            if (p.second.GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+                triggerman.UpdateFundingVotes(p.first);
+            }
         }
     }
 
@@ -9,6 +9,10 @@
 #include <cachemultimap.h>
 #include <governance/governance-object.h>
 
+#include <atomic>
+#include <limits>
+#include <set>
+
 class CBloomFilter;
 class CBlockIndex;
 class CInv;
@@ -160,6 +164,7 @@ private:
 
     static const int MAX_TIME_FUTURE_DEVIATION;
     static const int RELIABLE_PROPAGATION_TIME;
+    static const int64_t MAINTENANCE_SLICE_MICROS;
 
     int64_t nTimeLastDiff;
 
@@ -173,6 +178,8 @@ private:
     //   key   - governance object's hash
     //   value - expiration time for deleted objects
     std::map<uint256, int64_t> mapErasedGovernanceObjects;
+    // the entries of mapErasedGovernanceObjects which expire at some point, ordered by expiration time
+    std::set<std::pair<int64_t, uint256>> setErasedGovernanceObjectsByExpiry;
 
     std::map<uint256, CGovernanceObject> mapPostponedObjects;
     hash_s_t setAdditionalRelayObjects;
@@ -194,6 +201,9 @@ private:
     // used to check for changed voting keys
     CDeterministicMNListPtr lastMNListForVotingKeys;
 
+    // incremented whenever objects or votes are added or removed, lets callers detect changes without locking cs
+    std::atomic<uint64_t> nChangeCounter{0};
+
     class ScopedLockBool
     {
         bool& ref;
@@ -220,7 +230,7 @@ public:
 
     CGovernanceManager();
 
-    virtual ~CGovernanceManager() = default;
+    virtual ~CGovernanceManager();
 
     /**
      * This is called by AlreadyHave in net_processing.cpp as part of the inventory
@@ -239,6 +249,7 @@ public:
     CGovernanceObject* FindGovernanceObject(const uint256& nHash);
 
     // These commands are only used in RPC
+    uint64_t GetChangeCounter() const { return nChangeCounter; }
     std::vector<CGovernanceVote> GetCurrentVotes(const uint256& nParentHash, const COutPoint& mnCollateralOutpointFilter) const;
     std::vector<const CGovernanceObject*> GetAllNewerThan(int64_t nMoreThanTime) const;
 
@@ -248,18 +259,7 @@ public:
 
     void CheckAndRemove() { UpdateCachesAndClean(); }
 
-    void Clear()
-    {
-        LOCK(cs);
-
-        LogPrint(BCLog::GOBJECT, "Governance object manager was cleared\n");
-        mapObjects.clear();
-        mapErasedGovernanceObjects.clear();
-        cmapVoteToObject.Clear();
-        cmapInvalidVotes.Clear();
-        cmmapOrphanVotes.Clear();
-        mapLastMasternodeObject.clear();
-    }
+    void Clear();
 
     std::string ToString() const;
     UniValue ToJson() const;
@@ -295,6 +295,13 @@ public:
             >> mapObjects
             >> mapLastMasternodeObject
             >> *lastMNListForVotingKeys;
+
+        for (const auto& p : mapErasedGovernanceObjects) {
+            if (p.second != std::numeric_limits<int64_t>::max()) {
+                setErasedGovernanceObjectsByExpiry.emplace(p.second, p.first);
+            }
+        }
+        nChangeCounter++;
     }
 
     void UpdatedBlockTip(const CBlockIndex* pindex, CConnman& connman);
@@ -368,6 +375,10 @@ private:
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CConnman& connman);
 
+    /// Updates and cleans the objects starting at nCursor until the time budget of a slice is used up.
+    /// Returns true when the end of mapObjects was reached, otherwise nCursor is set to the next object.
+    bool UpdateCachesAndCleanSlice(uint256& nCursor, int64_t nNow);
+
     void RebuildIndexes();
 
     void AddCachedTriggers();
@@ -68,6 +68,67 @@ unsigned int MurmurHash3(unsigned int nHashSeed, Span<const unsigned char> vData
     return h1;
 }
 
+CMurmurHash3Multi::CMurmurHash3Multi(Span<const unsigned char> dataIn) : data(dataIn)
+{
+    const uint32_t c1 = 0xcc9e2d51;
+    const uint32_t c2 = 0x1b873593;
+
+    nBlocks = data.size() / 4;
+    if (nBlocks > MAX_BLOCKS) {
+        fDirect = true;
+        return;
+    }
+    for (size_t i = 0; i < nBlocks; ++i) {
+        uint32_t k1 = ReadLE32(data.data() + i*4);
+        k1 *= c1;
+        k1 = ROTL32(k1, 15);
+        k1 *= c2;
+        vMixed[i] = k1;
+    }
+
+    const uint8_t* tail = data.data() + nBlocks * 4;
+    uint32_t k1 = 0;
+    switch (data.size() & 3) {
+        case 3:
+            k1 ^= tail[2] << 16;
+        case 2:
+            k1 ^= tail[1] << 8;
+        case 1:
+            k1 ^= tail[0];
+            k1 *= c1;
+            k1 = ROTL32(k1, 15);
+            k1 *= c2;
+            nMixedTail = k1;
+            fTail = true;
+    }
+}
+
+unsigned int CMurmurHash3Multi::Hash(unsigned int nHashSeed) const
+{
+    if (fDirect) {
+        return MurmurHash3(nHashSeed, data);
+    }
+
+    uint32_t h1 = nHashSeed;
+    for (size_t i = 0; i < nBlocks; ++i) {
+        h1 ^= vMixed[i];
+        h1 = ROTL32(h1, 13);
+        h1 = h1 * 5 + 0xe6546b64;
+    }
+    if (fTail) {
+        h1 ^= nMixedTail;
+    }
+
+    h1 ^= data.size();
+    h1 ^= h1 >> 16;
+    h1 *= 0x85ebca6b;
+    h1 ^= h1 >> 13;
+    h1 *= 0xc2b2ae35;
+    h1 ^= h1 >> 16;
+
+    return h1;
+}
+
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64])
 {
     unsigned char num[4];
@@ -251,6 +251,31 @@ public:
     }
 };
 
+/** Writes data to an underlying stream, while hashing the written data. */
+template<typename Source>
+class CHashedSourceWriter : public CHashWriter
+{
+private:
+    Source* source;
+
+public:
+    explicit CHashedSourceWriter(Source* source_) : CHashWriter(source_->GetType(), source_->GetVersion()), source(source_) {}
+
+    void write(const char* pch, size_t nSize)
+    {
+        source->write(pch, nSize);
+        CHashWriter::write(pch, nSize);
+    }
+
+    template<typename T>
+    CHashedSourceWriter<Source>& operator<<(const T& obj)
+    {
+        // Serialize to this stream
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+};
+
 /** Compute the 256-bit hash of an object's serialization. */
 template<typename T>
 uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL_VERSION)
@@ -262,6 +287,28 @@ uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL
 
 unsigned int MurmurHash3(unsigned int nHashSeed, Span<const unsigned char> vDataToHash);
 
+/**
+ * MurmurHash3 of one piece of data with multiple seeds, as needed by bloom filters. Mixing the data blocks doesn't
+ * depend on the seed, so it's done once in the constructor and every Hash() call only runs the seeded part.
+ */
+class CMurmurHash3Multi
+{
+private:
+    //! Enough for the largest script element (MAX_SCRIPT_ELEMENT_SIZE), longer data is hashed with MurmurHash3()
+    static const size_t MAX_BLOCKS = 130;
+
+    Span<const unsigned char> data;
+    uint32_t vMixed[MAX_BLOCKS];
+    size_t nBlocks{0};
+    uint32_t nMixedTail{0};
+    bool fTail{false};
+    bool fDirect{false};
+
+public:
+    explicit CMurmurHash3Multi(Span<const unsigned char> dataIn);
+    unsigned int Hash(unsigned int nHashSeed) const;
+};
+
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
 
 /* ----------- Dash Hash ------------------------------------------------ */
@@ -9,6 +9,7 @@
 #include <key_io.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <random.h>
 #include <sync.h>
 #include <util/system.h>
@@ -17,13 +18,38 @@
 #include <crypto/hmac_sha256.h>
 #include <stdio.h>
 
+#include <iterator>
 #include <memory>
+#include <set>
 
 #include <boost/algorithm/string.hpp> // boost::trim
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
+/** Methods which are queued as expensive requests by default, more can be added with -rpcslowmethod */
+static const char* const DEFAULT_SLOW_RPC_METHODS[] = {
+    "dumpwallet",
+    "getaddressbalance",
+    "getaddressdeltas",
+    "getaddresstxids",
+    "getaddressutxos",
+    "getblockstats",
+    "getchaintxstats",
+    "gettxoutsetinfo",
+    "gobject",
+    "importaddress",
+    "importmulti",
+    "importprivkey",
+    "importpubkey",
+    "importwallet",
+    "rescanblockchain",
+    "verifychain",
+};
+/** Only the beginning of a request body is looked at to classify it */
+static const size_t MAX_CLASSIFY_BODY_SIZE = 4096;
+static std::set<std::string> setSlowRPCMethods;
+
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
  */
@@ -191,10 +217,28 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // Let RPCs with large results write them into the reply body while they are produced. This does not send
+            // anything before the RPC finished, so errors can still be reported in place of a partial result.
+            bool fStreamed = false;
+            JSONStreamWriter resultWriter([&](const std::string& str) {
+                if (!fStreamed) {
+                    req->AppendReplyBody("{\"result\":");
+                    fStreamed = true;
+                }
+                req->AppendReplyBody(str);
+            });
+            jreq.resultWriter = &resultWriter;
+
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            if (resultWriter.IsComplete()) {
+                resultWriter.Flush();
+                strReply = ",\"error\":null,\"id\":" + jreq.id.write() + "}\n";
+            } else {
+                req->ClearReplyBody();
+                strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            }
 
         // array of requests
         } else if (valRequest.isArray())
@@ -205,15 +249,46 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
+        req->ClearReplyBody();
         JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
+        req->ClearReplyBody();
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
     return true;
 }
 
+/** Classify a JSON-RPC request (or batch) as expensive if one of its methods is in setSlowRPCMethods.
+ * This runs on the event loop thread, so instead of parsing the request only the beginning of the body is scanned
+ * for "method" members. A misclassified request is still handled normally, only with another priority.
+ */
+static bool HTTPReq_JSONRPC_IsSlow(HTTPRequest* req, const std::string &)
+{
+    if (setSlowRPCMethods.empty() || req->GetRequestMethod() != HTTPRequest::POST) {
+        return false;
+    }
+    static const std::string strMethodKey = "\"method\"";
+    const std::string strBody = req->PeekBody(MAX_CLASSIFY_BODY_SIZE);
+    size_t pos = 0;
+    while ((pos = strBody.find(strMethodKey, pos)) != std::string::npos) {
+        pos = strBody.find_first_not_of(" \t\r\n:", pos + strMethodKey.size());
+        if (pos == std::string::npos || strBody[pos] != '"') {
+            continue;
+        }
+        size_t end = strBody.find('"', pos + 1);
+        if (end == std::string::npos) {
+            break;
+        }
+        if (setSlowRPCMethods.count(strBody.substr(pos + 1, end - pos - 1))) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
 static bool InitRPCAuthentication()
 {
     if (gArgs.GetArg("-rpcpassword", "") == "")
@@ -242,10 +317,15 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    setSlowRPCMethods = std::set<std::string>(std::begin(DEFAULT_SLOW_RPC_METHODS), std::end(DEFAULT_SLOW_RPC_METHODS));
+    for (const std::string& strMethod : gArgs.GetArgs("-rpcslowmethod")) {
+        setSlowRPCMethods.emplace(strMethod);
+    }
+
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPReq_JSONRPC_IsSlow);
 #ifdef ENABLE_WALLET
     // ifdef can be removed once we switch to better endpoint support and API versioning
-    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, HTTPReq_JSONRPC_IsSlow);
 #endif
     struct event_base* eventBase = EventBase();
     assert(eventBase);
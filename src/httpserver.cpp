@@ -47,6 +47,22 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Work item which just runs a function, see HTTPEnqueueWork */
+class HTTPFunctionWorkItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionWorkItem(const std::function<void()>& _func) : func(_func)
+    {
+    }
+    void operator()() override
+    {
+        func();
+    }
+
+private:
+    std::function<void()> func;
+};
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
 {
@@ -69,6 +85,11 @@ private:
 
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
+ *
+ * Expensive items are kept in a separate queue (with its own depth) and at
+ * most maxSlowRunning of them are processed at the same time, so that the
+ * remaining workers stay available for cheap items. Cheap items are always
+ * taken first.
  */
 template <typename WorkItem>
 class WorkQueue
@@ -77,12 +98,22 @@ private:
     Mutex cs;
     std::condition_variable cond GUARDED_BY(cs);
     std::deque<std::unique_ptr<WorkItem>> queue GUARDED_BY(cs);
+    std::deque<std::unique_ptr<WorkItem>> slowQueue GUARDED_BY(cs);
+    size_t nSlowRunning GUARDED_BY(cs){0};
     bool running GUARDED_BY(cs);
     const size_t maxDepth;
+    const size_t maxSlowRunning;
+
+    bool HasWork() EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        // on shutdown, the limit for expensive items doesn't matter anymore
+        return !queue.empty() || (!slowQueue.empty() && (nSlowRunning < maxSlowRunning || !running));
+    }
 
 public:
-    explicit WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth)
+    WorkQueue(size_t _maxDepth, size_t _maxSlowRunning) : running(true),
+                                 maxDepth(_maxDepth),
+                                 maxSlowRunning(std::max(_maxSlowRunning, (size_t)1))
     {
     }
     /** Precondition: worker threads have all stopped (they have been joined).
@@ -91,13 +122,14 @@ public:
     {
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, bool fSlow = false)
     {
         LOCK(cs);
-        if (!running || queue.size() >= maxDepth) {
+        auto& q = fSlow ? slowQueue : queue;
+        if (!running || q.size() >= maxDepth) {
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        q.emplace_back(std::unique_ptr<WorkItem>(item));
         cond.notify_one();
         return true;
     }
@@ -106,18 +138,36 @@ public:
     {
         while (true) {
             std::unique_ptr<WorkItem> i;
+            bool fSlow;
             {
                 WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
+                while (running && !HasWork())
                     cond.wait(lock);
-                if (!running && queue.empty())
+                if (!HasWork())
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
+                fSlow = queue.empty();
+                auto& q = fSlow ? slowQueue : queue;
+                i = std::move(q.front());
+                q.pop_front();
+                if (fSlow) {
+                    nSlowRunning++;
+                }
             }
             (*i)();
+            if (fSlow) {
+                LOCK(cs);
+                nSlowRunning--;
+                // another worker might be waiting for an expensive item to finish
+                cond.notify_one();
+            }
         }
     }
+    /** Number of queued cheap and expensive items */
+    std::pair<size_t, size_t> Depth()
+    {
+        LOCK(cs);
+        return std::make_pair(queue.size(), slowQueue.size());
+    }
     /** Interrupt and exit loops */
     void Interrupt()
     {
@@ -130,13 +180,14 @@ public:
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPRequestClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier classifier;
 };
 
 /** HTTP module state */
@@ -267,12 +318,13 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        const bool fSlow = i->classifier && i->classifier(hreq.get(), path);
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), fSlow))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http %swork queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n", fSlow ? "slow " : "");
             item->req->WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Work queue depth exceeded");
         }
     } else {
@@ -410,9 +462,11 @@ bool InitHTTPServer()
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    int rpcSlowThreads = std::max(std::min((long)gArgs.GetArg("-rpcslowthreads", std::max(rpcThreads / 2, 1)), (long)rpcThreads), 1L);
+    LogPrintf("HTTP: creating work queues of depth %d, expensive requests are limited to %d worker threads\n", workQueueDepth, rpcSlowThreads);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth, rpcSlowThreads);
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -499,6 +553,27 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+std::pair<size_t, size_t> HTTPWorkQueueDepth()
+{
+    if (!workQueue) {
+        return std::make_pair(0, 0);
+    }
+    return workQueue->Depth();
+}
+
+bool HTTPEnqueueWork(const std::function<void()>& func)
+{
+    if (!workQueue) {
+        return false;
+    }
+    std::unique_ptr<HTTPFunctionWorkItem> item(new HTTPFunctionWorkItem(func));
+    if (!workQueue->Enqueue(item.get())) {
+        return false;
+    }
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -570,6 +645,17 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize) const
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    std::string rv(std::min(evbuffer_get_length(buf), nMaxSize), '\0');
+    ev_ssize_t nCopied = evbuffer_copyout(buf, &rv[0], rv.size());
+    rv.resize(std::max(nCopied, (ev_ssize_t)0));
+    return rv;
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -577,6 +663,22 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+void HTTPRequest::AppendReplyBody(const std::string& str)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, str.data(), str.size());
+}
+
+void HTTPRequest::ClearReplyBody()
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_drain(evb, evbuffer_get_length(evb));
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -652,10 +754,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
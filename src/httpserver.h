@@ -8,6 +8,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <utility>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -38,11 +39,17 @@ bool UpdateHTTPServerLogging(bool enable);
 
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Classifier for requests to a certain HTTP path, called on the event loop
+ * thread before the request is queued. Returns true if the request is expected
+ * to be expensive, in which case it is queued behind cheap requests and only
+ * processed by a limited number of worker threads (-rpcslowthreads).
+ */
+typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
  * be invoked.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -51,6 +58,15 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Return the number of queued cheap and expensive requests */
+std::pair<size_t, size_t> HTTPWorkQueueDepth();
+
+/** Queue a function to be run by one of the HTTP worker threads, like a cheap request.
+ * Returns false if the queue is full or the server is shutting down. Callers must not
+ * wait for the function to be run, as all workers may be busy (possibly waiting themselves).
+ */
+bool HTTPEnqueueWork(const std::function<void()>& func);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -98,6 +114,11 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Return (at most nMaxSize bytes of) the request body without consuming it.
+     */
+    std::string PeekBody(size_t nMaxSize) const;
+
     /**
      * Write output header.
      *
@@ -105,10 +126,23 @@ public:
      */
     void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append to the body of the reply, before it is sent by WriteReply. This
+     * allows large replies to be produced piecewise, without building them as
+     * one string first.
+     */
+    void AppendReplyBody(const std::string& str);
+
+    /**
+     * Discard everything added by AppendReplyBody.
+     */
+    void ClearReplyBody();
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
-     * strReply is the body of the reply. Keep it empty to send a standard message.
+     * strReply is the body of the reply (appended to what was added with
+     * AppendReplyBody). Keep it empty to send a standard message.
      *
      * @note Can be called only once. As this will give the request back to the
      * main thread, do not call any other HTTPRequest methods after calling this.
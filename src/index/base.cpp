@@ -10,10 +10,16 @@
 #include <validation.h>
 #include <warnings.h>
 
+#include <thread>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+//! Number of blocks which are read ahead and written to the index together during the initial sync
+constexpr size_t SYNC_BATCH_SIZE = 128;
+//! Maximum number of threads reading blocks from disk during the initial sync
+constexpr int MAX_SYNC_READ_THREADS = 4;
 
 template<typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
@@ -84,6 +90,34 @@ static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev)
     return chainActive.Next(chainActive.FindFork(pindex_prev));
 }
 
+/** Read the blocks of a sync batch from disk, spreading the work (I/O and PoW hash checks) over a few threads. */
+static bool ReadSyncBlocks(const std::vector<const CBlockIndex*>& block_indexes, std::vector<CBlock>& blocks,
+                           const Consensus::Params& consensus_params)
+{
+    blocks.clear();
+    blocks.resize(block_indexes.size());
+
+    const int n_threads = std::max(1, std::min(GetNumCores(), MAX_SYNC_READ_THREADS));
+    std::atomic<bool> failed{false};
+    auto read = [&](int n_thread) {
+        for (size_t i = n_thread; i < block_indexes.size() && !failed; i += n_threads) {
+            if (!ReadBlockFromDisk(blocks[i], block_indexes[i], consensus_params)) {
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < n_threads; i++) {
+        threads.emplace_back(read, i);
+    }
+    read(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+    return !failed;
+}
+
 void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
@@ -92,12 +126,15 @@ void BaseIndex::ThreadSync()
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
+        std::vector<const CBlockIndex*> block_indexes;
+        std::vector<CBlock> blocks;
         while (true) {
             if (m_interrupt) {
                 WriteBestBlock(pindex);
                 return;
             }
 
+            block_indexes.clear();
             {
                 LOCK(cs_main);
                 const CBlockIndex* pindex_next = NextSyncBlock(pindex);
@@ -107,32 +144,38 @@ void BaseIndex::ThreadSync()
                     m_synced = true;
                     break;
                 }
-                pindex = pindex_next;
+                // Read ahead along the active chain so that the batch can be fetched and written together.
+                while (pindex_next && block_indexes.size() < SYNC_BATCH_SIZE) {
+                    block_indexes.push_back(pindex_next);
+                    pindex_next = chainActive.Next(pindex_next);
+                }
             }
 
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
                 LogPrintf("Syncing %s with block chain from height %d\n",
-                          GetName(), pindex->nHeight);
+                          GetName(), block_indexes.front()->nHeight);
                 last_log_time = current_time;
             }
 
-            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
-                WriteBestBlock(pindex);
-                last_locator_write_time = current_time;
-            }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
+            if (!ReadSyncBlocks(block_indexes, blocks, consensus_params)) {
+                FatalError("%s: Failed to read blocks %d-%d from disk",
+                           __func__, block_indexes.front()->nHeight, block_indexes.back()->nHeight);
                 return;
             }
-            if (!WriteBlock(block, pindex)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
+            if (!WriteBlocks(blocks, block_indexes)) {
+                FatalError("%s: Failed to write blocks %d-%d to index database",
+                           __func__, block_indexes.front()->nHeight, block_indexes.back()->nHeight);
                 return;
             }
+            pindex = block_indexes.back();
+            // Published for GetSummary only; notifications are ignored until m_synced is set.
+            m_best_block_index = pindex;
+
+            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
+                WriteBestBlock(pindex);
+                last_locator_write_time = current_time;
+            }
         }
     }
 
@@ -143,6 +186,17 @@ void BaseIndex::ThreadSync()
     }
 }
 
+bool BaseIndex::WriteBlocks(const std::vector<CBlock>& blocks, const std::vector<const CBlockIndex*>& block_indexes)
+{
+    assert(blocks.size() == block_indexes.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (!WriteBlock(blocks[i], block_indexes[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool BaseIndex::WriteBestBlock(const CBlockIndex* block_index)
 {
     LOCK(cs_main);
@@ -279,3 +333,13 @@ void BaseIndex::Stop()
         m_thread_sync.join();
     }
 }
+
+IndexSummary BaseIndex::GetSummary() const
+{
+    IndexSummary summary{};
+    summary.name = GetName();
+    summary.synced = m_synced;
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    summary.best_block_height = best_block_index ? best_block_index->nHeight : 0;
+    return summary;
+}
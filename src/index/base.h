@@ -12,8 +12,17 @@
 #include <uint256.h>
 #include <validationinterface.h>
 
+#include <string>
+#include <vector>
+
 class CBlockIndex;
 
+struct IndexSummary {
+    std::string name;
+    bool synced{false};
+    int best_block_height{0};
+};
+
 /**
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
@@ -69,6 +78,11 @@ protected:
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Write update index entries for a batch of consecutive blocks read during the initial sync.
+    /// The default implementation writes the blocks one by one with WriteBlock; indexes whose
+    /// entries do not depend on each other can override this to commit them in a single batch.
+    virtual bool WriteBlocks(const std::vector<CBlock>& blocks, const std::vector<const CBlockIndex*>& block_indexes);
+
     virtual DB& GetDB() const = 0;
 
     /// Get the name of the index for display in logs.
@@ -93,6 +107,9 @@ public:
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
+
+    /// Get a summary of the index and its state.
+    IndexSummary GetSummary() const;
 };
 
 #endif // BITCOIN_INDEX_BASE_H
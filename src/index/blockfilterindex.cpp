@@ -0,0 +1,178 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockfilterindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores one entry per block, keyed by block hash:
+ *
+ *   'f' + block hash -> {filter hash, filter header, encoded filter}
+ *
+ * Keying by block hash rather than height means entries of blocks that have been reorged out of
+ * the active chain remain valid, and the entry of a block's predecessor is always available when
+ * the block is connected, so no special handling of reorgs is required. Lookups by height go
+ * through the block index of the requested chain.
+ */
+constexpr char DB_FILTER = 'f';
+
+std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+namespace {
+
+struct DBVal {
+    uint256 hash;
+    uint256 header;
+    std::vector<unsigned char> encoded_filter;
+
+    SERIALIZE_METHODS(DBVal, obj) { READWRITE(obj.hash, obj.header, obj.encoded_filter); }
+};
+
+} // namespace
+
+/**
+ * Access to the block filter database (indexes/blockfilter/<filter name>/)
+ */
+class BlockFilterIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(const fs::path& path, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadFilter(const uint256& block_hash, DBVal& val) const;
+    bool WriteFilter(const uint256& block_hash, const DBVal& val);
+};
+
+BlockFilterIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(path, n_cache_size, f_memory, f_wipe)
+{}
+
+bool BlockFilterIndex::DB::ReadFilter(const uint256& block_hash, DBVal& val) const
+{
+    return Read(std::make_pair(DB_FILTER, block_hash), val);
+}
+
+bool BlockFilterIndex::DB::WriteFilter(const uint256& block_hash, const DBVal& val)
+{
+    return Write(std::make_pair(DB_FILTER, block_hash), val);
+}
+
+BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
+                                   size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_filter_type(filter_type)
+{
+    const std::string& filter_name = BlockFilterTypeName(filter_type);
+    if (filter_name.empty()) throw std::invalid_argument("unknown filter_type");
+
+    m_name = filter_name + " block filter index";
+    m_db = MakeUnique<BlockFilterIndex::DB>(GetDataDir() / "indexes" / "blockfilter" / filter_name,
+                                            n_cache_size, f_memory, f_wipe);
+}
+
+BlockFilterIndex::~BlockFilterIndex() {}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    uint256 prev_header;
+
+    if (pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+
+        DBVal prev_val;
+        if (!m_db->ReadFilter(pindex->pprev->GetBlockHash(), prev_val)) {
+            return error("%s: previous block filter of %s not found in index",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        prev_header = prev_val.header;
+    }
+
+    BlockFilter filter(m_filter_type, block, block_undo);
+
+    DBVal val;
+    val.hash = filter.GetHash();
+    val.header = filter.ComputeHeader(prev_header);
+    val.encoded_filter = filter.GetEncodedFilter();
+    return m_db->WriteFilter(pindex->GetBlockHash(), val);
+}
+
+BaseIndex::DB& BlockFilterIndex::GetDB() const { return *m_db; }
+
+bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
+{
+    DBVal val;
+    if (!m_db->ReadFilter(block_index->GetBlockHash(), val)) {
+        return false;
+    }
+
+    filter_out = BlockFilter(m_filter_type, block_index->GetBlockHash(), std::move(val.encoded_filter));
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const
+{
+    const bool is_checkpoint = block_index->nHeight % CFCHECKPT_INTERVAL == 0;
+
+    if (is_checkpoint) {
+        LOCK(m_cs_headers_cache);
+        auto it = m_headers_cache.find(block_index->GetBlockHash());
+        if (it != m_headers_cache.end()) {
+            header_out = it->second;
+            return true;
+        }
+    }
+
+    DBVal val;
+    if (!m_db->ReadFilter(block_index->GetBlockHash(), val)) {
+        return false;
+    }
+
+    if (is_checkpoint) {
+        LOCK(m_cs_headers_cache);
+        m_headers_cache.emplace(block_index->GetBlockHash(), val.header);
+    }
+
+    header_out = val.header;
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                                         std::vector<BlockFilter>& filters_out) const
+{
+    if (start_height < 0 || !stop_index || start_height > stop_index->nHeight) {
+        return error("%s: start height %d is invalid for the requested stop block", __func__, start_height);
+    }
+
+    filters_out.resize(stop_index->nHeight - start_height + 1);
+    const CBlockIndex* pindex = stop_index;
+    for (auto it = filters_out.rbegin(); it != filters_out.rend(); ++it, pindex = pindex->pprev) {
+        if (!LookupFilter(pindex, *it)) {
+            return error("%s: unable to read filter of block %s from index",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                                             std::vector<uint256>& hashes_out) const
+{
+    if (start_height < 0 || !stop_index || start_height > stop_index->nHeight) {
+        return error("%s: start height %d is invalid for the requested stop block", __func__, start_height);
+    }
+
+    hashes_out.resize(stop_index->nHeight - start_height + 1);
+    const CBlockIndex* pindex = stop_index;
+    for (auto it = hashes_out.rbegin(); it != hashes_out.rend(); ++it, pindex = pindex->pprev) {
+        DBVal val;
+        if (!m_db->ReadFilter(pindex->GetBlockHash(), val)) {
+            return error("%s: unable to read filter of block %s from index",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        *it = val.hash;
+    }
+    return true;
+}
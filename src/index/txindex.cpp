@@ -241,19 +241,41 @@ bool TxIndex::Init()
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+static void AppendTxPositions(const CBlock& block, const CBlockIndex* pindex,
+                              std::vector<std::pair<uint256, CDiskTxPos>>& vPos)
 {
     // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    if (pindex->nHeight == 0) return;
 
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
     for (const auto& tx : block.vtx) {
         vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+}
+
+bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+    vPos.reserve(block.vtx.size());
+    AppendTxPositions(block, pindex, vPos);
+    return vPos.empty() || m_db->WriteTxs(vPos);
+}
+
+bool TxIndex::WriteBlocks(const std::vector<CBlock>& blocks, const std::vector<const CBlockIndex*>& block_indexes)
+{
+    size_t nTxs = 0;
+    for (const auto& block : blocks) {
+        nTxs += block.vtx.size();
+    }
+
+    // Transaction positions of all blocks are independent of each other, so they go into one batch.
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+    vPos.reserve(nTxs);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        AppendTxPositions(blocks[i], block_indexes[i], vPos);
+    }
+    return vPos.empty() || m_db->WriteTxs(vPos);
 }
 
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
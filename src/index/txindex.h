@@ -28,6 +28,8 @@ protected:
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool WriteBlocks(const std::vector<CBlock>& blocks, const std::vector<const CBlockIndex*>& block_indexes) override;
+
     BaseIndex::DB& GetDB() const override;
 
     const char* GetName() const override { return "txindex"; }
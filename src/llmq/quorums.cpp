@@ -15,10 +15,12 @@
 #include <masternode/activemasternode.h>
 #include <chainparams.h>
 #include <masternode/masternode-sync.h>
+#include <memusage.h>
 #include <net.h>
 #include <net_processing.h>
 #include <netmessagemaker.h>
 #include <univalue.h>
+#include <util/memaccounting.h>
 #include <validation.h>
 
 #include <cxxtimer.hpp>
@@ -102,10 +104,165 @@ CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
     if (quorumVvec == nullptr || memberIdx >= members.size() || !qc->validMembers[memberIdx]) {
         return CBLSPublicKey();
     }
+    auto table = std::atomic_load(&pubKeyShareTable);
+    if (table != nullptr) {
+        return (*table)[memberIdx];
+    }
     auto& m = members[memberIdx];
     return blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId(m->proTxHash));
 }
 
+size_t CQuorum::GetPubKeyShareTableMemoryUsage() const
+{
+    auto table = std::atomic_load(&pubKeyShareTable);
+    if (table == nullptr) {
+        return 0;
+    }
+    // the shares are also held by blsCache while the table exists
+    return 2 * table->size() * sizeof(CBLSPublicKey);
+}
+
+size_t CQuorum::GetMemoryUsage() const
+{
+    size_t nUsage = memusage::MallocUsage(sizeof(CQuorum)) + memusage::DynamicUsage(members);
+    auto vvec = std::atomic_load(&quorumVvec);
+    if (vvec != nullptr) {
+        nUsage += memusage::MallocUsage(vvec->size() * sizeof(CBLSPublicKey));
+    }
+    return nUsage + GetPubKeyShareTableMemoryUsage();
+}
+
+void CQuorum::BuildPubKeyShareTable(const CThreadInterrupt& interrupt) const
+{
+    auto table = std::make_shared<std::vector<CBLSPublicKey>>(members.size());
+    for (size_t i = 0; i < members.size(); i++) {
+        if (interrupt) {
+            return;
+        }
+        if (qc->validMembers[i]) {
+            (*table)[i] = GetPubKeyShare(i);
+        }
+    }
+    std::atomic_store(&pubKeyShareTable, std::shared_ptr<const std::vector<CBLSPublicKey>>(std::move(table)));
+}
+
+void CQuorum::ClearPubKeyShareTable() const
+{
+    std::atomic_store(&pubKeyShareTable, std::shared_ptr<const std::vector<CBLSPublicKey>>());
+    blsCache.ClearPubKeyShares();
+}
+
+size_t CQuorum::InitDataRecovery(size_t nMaxChunks) const
+{
+    LOCK(cs_dataRecovery);
+    const size_t nCount = (size_t)qc->CountValidMembers();
+    if (nCount == 0) {
+        return 0;
+    }
+    const size_t nChunks = std::max<size_t>(1, std::min(nMaxChunks, nCount));
+    const size_t nChunkSize = (nCount + nChunks - 1) / nChunks;
+    // keep what we already received in a previous attempt if the layout didn't change
+    if (nChunkSize != nRecoveryChunkSize) {
+        nRecoveryChunkSize = nChunkSize;
+        vecRecoveryChunks.assign((nCount + nChunkSize - 1) / nChunkSize, BLSSecretKeyVector());
+    }
+    nRecoveryStartTime = GetTime();
+    nRecoveryRequests = 0;
+    nRecoveryTimeouts = 0;
+    return vecRecoveryChunks.size();
+}
+
+std::pair<uint16_t, uint16_t> CQuorum::GetDataRecoveryChunk(size_t nChunk) const
+{
+    LOCK(cs_dataRecovery);
+    const size_t nCount = (size_t)qc->CountValidMembers();
+    const size_t nStart = nChunk * nRecoveryChunkSize;
+    if (nChunk >= vecRecoveryChunks.size() || nStart >= nCount) {
+        return std::make_pair(0, 0);
+    }
+    return std::make_pair((uint16_t)nStart, (uint16_t)std::min(nRecoveryChunkSize, nCount - nStart));
+}
+
+bool CQuorum::HasDataRecoveryChunk(size_t nChunk) const
+{
+    LOCK(cs_dataRecovery);
+    return nChunk < vecRecoveryChunks.size() && !vecRecoveryChunks[nChunk].empty();
+}
+
+bool CQuorum::AddDataRecoveryChunk(uint16_t nChunkStart, BLSSecretKeyVector&& vecSecretKeys) const
+{
+    LOCK(cs_dataRecovery);
+    if (nRecoveryChunkSize == 0 || (nChunkStart % nRecoveryChunkSize) != 0) {
+        return false;
+    }
+    const size_t nChunk = nChunkStart / nRecoveryChunkSize;
+    if (nChunk >= vecRecoveryChunks.size() || vecSecretKeys.empty()) {
+        return false;
+    }
+    const size_t nCount = (size_t)qc->CountValidMembers();
+    if (vecSecretKeys.size() != std::min(nRecoveryChunkSize, nCount - nChunkStart)) {
+        return false;
+    }
+    // a straggler might still deliver a chunk which was received from another member in the meantime
+    if (vecRecoveryChunks[nChunk].empty()) {
+        vecRecoveryChunks[nChunk] = std::move(vecSecretKeys);
+    }
+    return true;
+}
+
+bool CQuorum::GetRecoveredContributions(BLSSecretKeyVector& vecSecretKeysRet) const
+{
+    LOCK(cs_dataRecovery);
+    if (vecRecoveryChunks.empty()) {
+        return false;
+    }
+    vecSecretKeysRet.clear();
+    for (const auto& vecChunk : vecRecoveryChunks) {
+        if (vecChunk.empty()) {
+            return false;
+        }
+        vecSecretKeysRet.insert(vecSecretKeysRet.end(), vecChunk.begin(), vecChunk.end());
+    }
+    return true;
+}
+
+void CQuorum::ResetDataRecovery() const
+{
+    LOCK(cs_dataRecovery);
+    for (auto& vecChunk : vecRecoveryChunks) {
+        vecChunk.clear();
+    }
+}
+
+void CQuorum::AddDataRecoveryRequest() const
+{
+    LOCK(cs_dataRecovery);
+    nRecoveryRequests++;
+}
+
+void CQuorum::AddDataRecoveryTimeout() const
+{
+    LOCK(cs_dataRecovery);
+    nRecoveryTimeouts++;
+}
+
+UniValue CQuorum::GetDataRecoveryStatus() const
+{
+    LOCK(cs_dataRecovery);
+    size_t nChunksReceived{0};
+    for (const auto& vecChunk : vecRecoveryChunks) {
+        nChunksReceived += !vecChunk.empty();
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("running", fQuorumDataRecoveryThreadRunning.load());
+    ret.pushKV("startTime", nRecoveryStartTime);
+    ret.pushKV("chunks", (int64_t)vecRecoveryChunks.size());
+    ret.pushKV("chunksReceived", (int64_t)nChunksReceived);
+    ret.pushKV("requests", (int64_t)nRecoveryRequests);
+    ret.pushKV("timeouts", (int64_t)nRecoveryTimeouts);
+    return ret;
+}
+
 const CBLSSecretKey& CQuorum::GetSkShare() const
 {
     return skShare;
@@ -131,22 +288,25 @@ void CQuorum::WriteContributions(CEvoDB& evoDb) const
     if (skShare.IsValid()) {
         evoDb.GetRawDB().Write(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
     }
+    evoDb.ClearReadCache();
 }
 
-bool CQuorum::ReadContributions(CEvoDB& evoDb)
+bool CQuorum::ReadContributions(CEvoDB& evoDb, BLSVerificationVectorPtr& quorumVvecRet, CBLSSecretKey& skShareRet) const
 {
     uint256 dbKey = MakeQuorumKey(*this);
 
+    // The contributions are only ever written to the raw DB (see WriteContributions), so we can bypass the EvoDB
+    // transactions and their locks, which would otherwise serialize the deserialization of the vvecs
     BLSVerificationVector qv;
-    if (evoDb.Read(std::make_pair(DB_QUORUM_QUORUM_VVEC, dbKey), qv)) {
-        quorumVvec = std::make_shared<BLSVerificationVector>(std::move(qv));
+    if (evoDb.GetRawDB().Read(std::make_pair(DB_QUORUM_QUORUM_VVEC, dbKey), qv)) {
+        quorumVvecRet = std::make_shared<BLSVerificationVector>(std::move(qv));
     } else {
         return false;
     }
 
     // We ignore the return value here as it is ok if this fails. If it fails, it usually means that we are not a
     // member of the quorum but observed the whole DKG process to have the quorum verification vector.
-    evoDb.Read(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
+    evoDb.GetRawDB().Read(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShareRet);
 
     return true;
 }
@@ -154,15 +314,35 @@ bool CQuorum::ReadContributions(CEvoDB& evoDb)
 CQuorumManager::CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager) :
     evoDb(_evoDb),
     blsWorker(_blsWorker),
-    dkgManager(_dkgManager)
+    dkgManager(_dkgManager),
+    nMaxPubKeyShareTablesMemory((size_t)std::max<int64_t>(0, gArgs.GetArg("-llmq-pubkeyshare-mem", DEFAULT_PUBKEY_SHARE_TABLES_MEMORY)) * 1024 * 1024)
 {
     CLLMQUtils::InitQuorumsCache(mapQuorumsCache);
     CLLMQUtils::InitQuorumsCache(scanQuorumsCache);
     quorumThreadInterrupt.reset();
+    memaccounting::Register("llmq.quorums", this, [this]() {
+        LOCK(quorumsCacheCs);
+        size_t nUsage = 0;
+        for (const auto& p : mapQuorumsCache) {
+            nUsage += p.second.dynamic_usage();
+            p.second.for_each([&nUsage](const uint256&, const CQuorumPtr& quorum) {
+                nUsage += quorum->GetMemoryUsage();
+            });
+        }
+        // the scanned quorums are the same objects as in mapQuorumsCache, only count the vectors
+        for (const auto& p : scanQuorumsCache) {
+            nUsage += p.second.dynamic_usage();
+            p.second.for_each([&nUsage](const uint256&, const std::vector<CQuorumCPtr>& vecQuorums) {
+                nUsage += memusage::DynamicUsage(vecQuorums);
+            });
+        }
+        return nUsage;
+    });
 }
 
 CQuorumManager::~CQuorumManager()
 {
+    memaccounting::Unregister(this);
     Stop();
 }
 
@@ -204,6 +384,20 @@ void CQuorumManager::TriggerQuorumDataRecoveryThreads(const CBlockIndex* pIndex)
             }
         }
 
+        const bool fSyncForTypeEnabled = mapQuorumVvecSync.count(llmq.first) > 0;
+        const QvvecSyncMode syncMode = fSyncForTypeEnabled ? mapQuorumVvecSync.at(llmq.first) : QvvecSyncMode::Invalid;
+        const bool fSyncCurrent = syncMode == QvvecSyncMode::Always || (syncMode == QvvecSyncMode::OnlyIfTypeMember && fWeAreQuorumTypeMember);
+
+        // Load the contributions of all quorums we need them for at once, so that after a restart the quorums are
+        // read from the DB or built from the DKG in parallel instead of one after the other
+        std::vector<CQuorumCPtr> vecNeedContributions;
+        for (const auto& pQuorum : vecQuorums) {
+            if (!pQuorum->fQuorumDataRecoveryThreadRunning && (pQuorum->IsValidMember(activeMasternodeInfo.proTxHash) || (fSyncForTypeEnabled && fSyncCurrent))) {
+                vecNeedContributions.emplace_back(pQuorum);
+            }
+        }
+        EnsureQuorumContributions(vecNeedContributions);
+
         for (const auto& pQuorum : vecQuorums) {
             // If there is already a thread running for this specific quorum skip it
             if (pQuorum->fQuorumDataRecoveryThreadRunning) {
@@ -212,9 +406,6 @@ void CQuorumManager::TriggerQuorumDataRecoveryThreads(const CBlockIndex* pIndex)
 
             uint16_t nDataMask{0};
             const bool fWeAreQuorumMember = pQuorum->IsValidMember(activeMasternodeInfo.proTxHash);
-            const bool fSyncForTypeEnabled = mapQuorumVvecSync.count(pQuorum->qc->llmqType) > 0;
-            const QvvecSyncMode syncMode = fSyncForTypeEnabled ? mapQuorumVvecSync.at(pQuorum->qc->llmqType) : QvvecSyncMode::Invalid;
-            const bool fSyncCurrent = syncMode == QvvecSyncMode::Always || (syncMode == QvvecSyncMode::OnlyIfTypeMember && fWeAreQuorumTypeMember);
 
             if ((fWeAreQuorumMember || (fSyncForTypeEnabled && fSyncCurrent)) && pQuorum->quorumVvec == nullptr) {
                 nDataMask |= llmq::CQuorumDataRequest::QUORUM_VERIFICATION_VECTOR;
@@ -305,72 +496,196 @@ CQuorumPtr CQuorumManager::BuildQuorumFromCommitment(const Consensus::LLMQType l
 
     quorum->Init(qc, pindexQuorum, minedBlockHash, members);
 
-    bool hasValidVvec = false;
-    if (quorum->ReadContributions(evoDb)) {
-        hasValidVvec = true;
-    } else {
-        if (BuildQuorumContributions(qc, quorum)) {
-            quorum->WriteContributions(evoDb);
-            hasValidVvec = true;
-        } else {
-            LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- quorum.ReadContributions and BuildQuorumContributions for block %s failed\n", __func__, qc->quorumHash.ToString());
+    // The vvec and secret key share are loaded on demand, most quorums are only ever used to verify recovered
+    // signatures with the quorum public key
+    mapQuorumsCache[llmqType].insert(quorumHash, quorum);
+
+    return quorum;
+}
+
+void CQuorumManager::EnsureQuorumContributions(const CQuorumCPtr& pQuorum) const
+{
+    pQuorum->nLastUsedTime = GetTimeMillis();
+
+    {
+        LOCK(pQuorum->cs_contributions);
+        if (!pQuorum->fContributionsLoaded) {
+            pQuorum->fContributionsLoaded = true;
+            // Quorums are always created non-const by BuildQuorumFromCommitment, the contributions are only written
+            // here and when received through QDATA
+            auto quorum = std::const_pointer_cast<CQuorum>(pQuorum);
+            if (quorum->quorumVvec == nullptr && !quorum->ReadContributions(evoDb, quorum->quorumVvec, quorum->skShare)) {
+                if (BuildQuorumContributions(quorum, quorum->quorumVvec, quorum->skShare)) {
+                    quorum->WriteContributions(evoDb);
+                } else {
+                    LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- quorum.ReadContributions and BuildQuorumContributions for block %s failed\n", __func__, quorum->qc->quorumHash.ToString());
+                }
+            }
         }
     }
 
-    if (hasValidVvec) {
+    if (pQuorum->quorumVvec != nullptr && std::atomic_load(&pQuorum->pubKeyShareTable) == nullptr) {
         // pre-populate caches in the background
         // recovering public key shares is quite expensive and would result in serious lags for the first few signing
         // sessions if the shares would be calculated on-demand
-        StartCachePopulatorThread(quorum);
+        StartCachePopulatorThread(pQuorum);
     }
-
-    mapQuorumsCache[llmqType].insert(quorumHash, quorum);
-
-    return quorum;
 }
 
-bool CQuorumManager::BuildQuorumContributions(const CFinalCommitmentPtr& fqc, const std::shared_ptr<CQuorum>& quorum) const
-{
+struct CQuorumManager::ContributionsBuild {
+    // The aggregators only reference their inputs, so these must stay alive until both futures are ready
     std::vector<uint16_t> memberIndexes;
     std::vector<BLSVerificationVectorPtr> vvecs;
     BLSSecretKeyVector skContributions;
-    if (!dkgManager.GetVerifiedContributions((Consensus::LLMQType)fqc->llmqType, quorum->pindexQuorum, fqc->validMembers, memberIndexes, vvecs, skContributions)) {
+    std::future<BLSVerificationVectorPtr> futureQuorumVvec;
+    std::future<CBLSSecretKey> futureSkShare;
+    cxxtimer::Timer timer;
+};
+
+void CQuorumManager::EnsureQuorumContributions(const std::vector<CQuorumCPtr>& vecQuorums) const
+{
+    struct ContributionsLoad {
+        CQuorumCPtr pQuorum;
+        bool fRead{false};
+        bool fBuilt{false};
+        BLSVerificationVectorPtr quorumVvec;
+        CBLSSecretKey skShare;
+        std::unique_ptr<ContributionsBuild> build;
+    };
+
+    std::vector<ContributionsLoad> loads;
+    for (const auto& pQuorum : vecQuorums) {
+        LOCK(pQuorum->cs_contributions);
+        if (!pQuorum->fContributionsLoaded && pQuorum->quorumVvec == nullptr) {
+            loads.emplace_back();
+            loads.back().pQuorum = pQuorum;
+        }
+    }
+
+    if (!loads.empty()) {
+        cxxtimer::Timer t(true);
+
+        // Deserializing a vvec decompresses all of its public keys, so the DB reads are spread over the BLS workers
+        std::vector<std::function<void()>> jobs;
+        for (auto& load : loads) {
+            jobs.emplace_back([this, &load]() {
+                load.fRead = load.pQuorum->ReadContributions(evoDb, load.quorumVvec, load.skShare);
+            });
+        }
+        blsWorker.RunJobs(jobs);
+
+        // Quorums which were never stored are built from the DKG. All aggregations are started before waiting for
+        // the first one, so that the BLS workers build the contributions of all quorums at the same time
+        for (auto& load : loads) {
+            if (load.fRead) {
+                continue;
+            }
+            load.build = std::make_unique<ContributionsBuild>();
+            if (!StartBuildQuorumContributions(load.pQuorum, *load.build)) {
+                load.build.reset();
+            }
+        }
+        for (auto& load : loads) {
+            if (load.build != nullptr) {
+                load.fBuilt = FinishBuildQuorumContributions(*load.build, load.quorumVvec, load.skShare);
+            }
+        }
+
+        size_t nLoaded{0};
+        for (auto& load : loads) {
+            LOCK(load.pQuorum->cs_contributions);
+            if (load.pQuorum->fContributionsLoaded) {
+                // loaded through EnsureQuorumContributions(pQuorum) in the meantime
+                continue;
+            }
+            load.pQuorum->fContributionsLoaded = true;
+            if (load.pQuorum->quorumVvec != nullptr) {
+                // received through QDATA in the meantime
+                continue;
+            }
+            if (!load.fRead && !load.fBuilt) {
+                LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- quorum.ReadContributions and BuildQuorumContributions for block %s failed\n", __func__, load.pQuorum->qc->quorumHash.ToString());
+                continue;
+            }
+            auto quorum = std::const_pointer_cast<CQuorum>(load.pQuorum);
+            quorum->quorumVvec = std::move(load.quorumVvec);
+            quorum->skShare = load.skShare;
+            if (load.fBuilt) {
+                quorum->WriteContributions(evoDb);
+            }
+            nLoaded++;
+        }
+        t.stop();
+
+        LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- loaded contributions of %d/%d quorums. time=%d\n", __func__, nLoaded, loads.size(), t.count());
+    }
+
+    for (const auto& pQuorum : vecQuorums) {
+        EnsureQuorumContributions(pQuorum);
+    }
+}
+
+bool CQuorumManager::StartBuildQuorumContributions(const CQuorumCPtr& pQuorum, ContributionsBuild& build) const
+{
+    const auto& fqc = pQuorum->qc;
+    if (!dkgManager.GetVerifiedContributions((Consensus::LLMQType)fqc->llmqType, pQuorum->pindexQuorum, fqc->validMembers, build.memberIndexes, build.vvecs, build.skContributions)) {
         return false;
     }
 
-    cxxtimer::Timer t2(true);
-    quorum->quorumVvec = blsWorker.BuildQuorumVerificationVector(vvecs);
-    if (quorum->quorumVvec == nullptr) {
+    // The vvec and the skShare don't depend on each other, so both are aggregated at the same time
+    build.timer.start();
+    build.futureQuorumVvec = blsWorker.AsyncBuildQuorumVerificationVector(build.vvecs, 0, 0, true);
+    build.futureSkShare = blsWorker.AsyncAggregateSecretKeys(build.skContributions, 0, 0, true);
+    return true;
+}
+
+bool CQuorumManager::FinishBuildQuorumContributions(ContributionsBuild& build, BLSVerificationVectorPtr& quorumVvecRet, CBLSSecretKey& skShareRet) const
+{
+    quorumVvecRet = build.futureQuorumVvec.get();
+    CBLSSecretKey skShare = build.futureSkShare.get();
+    build.timer.stop();
+    if (quorumVvecRet == nullptr) {
         LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- failed to build quorumVvec\n", __func__);
         // without the quorum vvec, there can't be a skShare, so we fail here. Failure is not fatal here, as it still
         // allows to use the quorum as a non-member (verification through the quorum pub key)
         return false;
     }
-    quorum->skShare = blsWorker.AggregateSecretKeys(skContributions);
-    if (!quorum->skShare.IsValid()) {
-        quorum->skShare.Reset();
+    if (skShare.IsValid()) {
+        skShareRet = skShare;
+    } else {
+        skShareRet.Reset();
         LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- failed to build skShare\n", __func__);
         // We don't bail out here as this is not a fatal error and still allows us to recover public key shares (as we
         // have a valid quorum vvec at this point)
     }
-    t2.stop();
 
-    LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- built quorum vvec and skShare. time=%d\n", __func__, t2.count());
+    LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- built quorum vvec and skShare. time=%d\n", __func__, build.timer.count());
 
     return true;
 }
 
+bool CQuorumManager::BuildQuorumContributions(const CQuorumCPtr& pQuorum, BLSVerificationVectorPtr& quorumVvecRet, CBLSSecretKey& skShareRet) const
+{
+    ContributionsBuild build;
+    return StartBuildQuorumContributions(pQuorum, build) && FinishBuildQuorumContributions(build, quorumVvecRet, skShareRet);
+}
+
 bool CQuorumManager::HasQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash)
 {
     return quorumBlockProcessor->HasMinedCommitment(llmqType, quorumHash);
 }
 
-bool CQuorumManager::RequestQuorumData(CNode* pFrom, Consensus::LLMQType llmqType, const CBlockIndex* pQuorumIndex, uint16_t nDataMask, const uint256& proTxHash) const
+bool CQuorumManager::RequestQuorumData(CNode* pFrom, Consensus::LLMQType llmqType, const CBlockIndex* pQuorumIndex, uint16_t nDataMask, const uint256& proTxHash,
+                                       uint16_t nChunkStart, uint16_t nChunkCount) const
 {
     if (pFrom->nVersion < LLMQ_DATA_MESSAGES_VERSION) {
         LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- Version must be %d or greater.\n", __func__, LLMQ_DATA_MESSAGES_VERSION);
         return false;
     }
+    if ((nDataMask & CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS_CHUNK) && pFrom->nVersion < LLMQ_DATA_CHUNKS_VERSION) {
+        LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- Version must be %d or greater for chunked requests.\n", __func__, LLMQ_DATA_CHUNKS_VERSION);
+        return false;
+    }
     if (pFrom == nullptr || (pFrom->verifiedProRegTxHash.IsNull() && !pFrom->qwatch)) {
         LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- pFrom is neither a verified masternode nor a qwatch connection\n", __func__);
         return false;
@@ -390,7 +705,7 @@ bool CQuorumManager::RequestQuorumData(CNode* pFrom, Consensus::LLMQType llmqTyp
 
     LOCK(cs_data_requests);
     auto key = std::make_pair(pFrom->verifiedProRegTxHash, true);
-    auto it = mapQuorumDataRequests.emplace(key, CQuorumDataRequest(llmqType, pQuorumIndex->GetBlockHash(), nDataMask, proTxHash));
+    auto it = mapQuorumDataRequests.emplace(key, CQuorumDataRequest(llmqType, pQuorumIndex->GetBlockHash(), nDataMask, proTxHash, nChunkStart, nChunkCount));
     if (!it.second && !it.first->second.IsExpired()) {
         LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- Already requested\n", __func__);
         return false;
@@ -587,6 +902,7 @@ void CQuorumManager::ProcessMessage(CNode* pFrom, const std::string& strCommand,
             sendQDATA(CQuorumDataRequest::Errors::QUORUM_NOT_FOUND);
             return;
         }
+        EnsureQuorumContributions(pQuorum);
 
         CDataStream ssResponseData(SER_NETWORK, pFrom->GetSendVersion());
 
@@ -616,6 +932,16 @@ void CQuorumManager::ProcessMessage(CNode* pFrom, const std::string& strCommand,
                 return;
             }
 
+            if (request.GetDataMask() & CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS_CHUNK) {
+                const size_t nChunkEnd = (size_t)request.GetChunkStart() + request.GetChunkCount();
+                if (request.GetChunkCount() == 0 || nChunkEnd > vecEncrypted.size()) {
+                    sendQDATA(CQuorumDataRequest::Errors::ENCRYPTED_CONTRIBUTIONS_CHUNK_INVALID);
+                    return;
+                }
+                vecEncrypted.erase(vecEncrypted.begin() + nChunkEnd, vecEncrypted.end());
+                vecEncrypted.erase(vecEncrypted.begin(), vecEncrypted.begin() + request.GetChunkStart());
+            }
+
             ssResponseData << vecEncrypted;
         }
 
@@ -664,6 +990,8 @@ void CQuorumManager::ProcessMessage(CNode* pFrom, const std::string& strCommand,
                 return;
             }
         }
+        // so that a later load from the DB does not overwrite what we receive here
+        EnsureQuorumContributions(pQuorum);
 
         // Check if request has QUORUM_VERIFICATION_VECTOR data
         if (request.GetDataMask() & CQuorumDataRequest::QUORUM_VERIFICATION_VECTOR) {
@@ -682,7 +1010,10 @@ void CQuorumManager::ProcessMessage(CNode* pFrom, const std::string& strCommand,
         // Check if request has ENCRYPTED_CONTRIBUTIONS data
         if (request.GetDataMask() & CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS) {
 
-            if (pQuorum->quorumVvec->size() != pQuorum->params.threshold) {
+            const bool fChunk = request.GetDataMask() & CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS_CHUNK;
+
+            // Chunks are only aggregated once all of them arrived, the quorum vvec might still be on its way until then
+            if (!fChunk && (pQuorum->quorumVvec == nullptr || pQuorum->quorumVvec->size() != (size_t)pQuorum->params.threshold)) {
                 errorHandler("No valid quorum verification vector available", 0); // Don't bump score because we asked for it
                 return;
             }
@@ -696,6 +1027,11 @@ void CQuorumManager::ProcessMessage(CNode* pFrom, const std::string& strCommand,
             std::vector<CBLSIESEncryptedObject<CBLSSecretKey>> vecEncrypted;
             vRecv >> vecEncrypted;
 
+            if (fChunk && vecEncrypted.size() != request.GetChunkCount()) {
+                errorHandler("Invalid chunk size");
+                return;
+            }
+
             BLSSecretKeyVector vecSecretKeys;
             vecSecretKeys.resize(vecEncrypted.size());
             for (size_t i = 0; i < vecEncrypted.size(); ++i) {
@@ -705,20 +1041,49 @@ void CQuorumManager::ProcessMessage(CNode* pFrom, const std::string& strCommand,
                 }
             }
 
-            CBLSSecretKey secretKeyShare = blsWorker.AggregateSecretKeys(vecSecretKeys);
-            if (!pQuorum->SetSecretKeyShare(secretKeyShare)) {
-                errorHandler("Invalid secret key share received");
-                return;
+            if (fChunk) {
+                if (!pQuorum->AddDataRecoveryChunk(request.GetChunkStart(), std::move(vecSecretKeys))) {
+                    errorHandler("Unexpected chunk", 0); // Don't bump score because we asked for it
+                    return;
+                }
+            } else {
+                CBLSSecretKey secretKeyShare = blsWorker.AggregateSecretKeys(vecSecretKeys);
+                if (!pQuorum->SetSecretKeyShare(secretKeyShare)) {
+                    errorHandler("Invalid secret key share received");
+                    return;
+                }
             }
         }
+
+        if (pQuorum->quorumVvec != nullptr && !pQuorum->skShare.IsValid()) {
+            FinishDataRecovery(pQuorum);
+        }
         pQuorum->WriteContributions(evoDb);
         return;
     }
 }
 
+bool CQuorumManager::FinishDataRecovery(const CQuorumPtr& pQuorum) const
+{
+    BLSSecretKeyVector vecSecretKeys;
+    if (!pQuorum->GetRecoveredContributions(vecSecretKeys)) {
+        return false;
+    }
+
+    CBLSSecretKey secretKeyShare = blsWorker.AggregateSecretKeys(vecSecretKeys);
+    if (!pQuorum->SetSecretKeyShare(secretKeyShare)) {
+        // We can't tell which member sent us a bad chunk, so all of them are requested again from other members
+        LogPrintf("CQuorumManager::%s -- invalid secret key share recovered for quorum %s, retrying\n", __func__, pQuorum->qc->quorumHash.ToString());
+        pQuorum->ResetDataRecovery();
+        return false;
+    }
+    LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- recovered secret key share for quorum %s\n", __func__, pQuorum->qc->quorumHash.ToString());
+    return true;
+}
+
 void CQuorumManager::StartCachePopulatorThread(const CQuorumCPtr pQuorum) const
 {
-    if (pQuorum->quorumVvec == nullptr) {
+    if (pQuorum->quorumVvec == nullptr || pQuorum->fCachePopulatorRunning.exchange(true)) {
         return;
     }
 
@@ -727,15 +1092,51 @@ void CQuorumManager::StartCachePopulatorThread(const CQuorumCPtr pQuorum) const
 
     // when then later some other thread tries to get keys, it will be much faster
     workerPool.push([pQuorum, t, this](int threadId) {
-        for (size_t i = 0; i < pQuorum->members.size() && !quorumThreadInterrupt; i++) {
-            if (pQuorum->qc->validMembers[i]) {
-                pQuorum->GetPubKeyShare(i);
-            }
+        pQuorum->BuildPubKeyShareTable(quorumThreadInterrupt);
+        if (!quorumThreadInterrupt) {
+            AddPubKeyShareTable(pQuorum);
         }
+        pQuorum->fCachePopulatorRunning = false;
         LogPrint(BCLog::LLMQ, "CQuorumManager::StartCachePopulatorThread -- done. time=%d\n", t.count());
     });
 }
 
+void CQuorumManager::AddPubKeyShareTable(const CQuorumCPtr& pQuorum) const
+{
+    LOCK(pubKeyShareTablesCs);
+
+    std::vector<CQuorumCPtr> vecQuorums;
+    vecQuorums.reserve(quorumsWithPubKeyShareTable.size() + 1);
+    for (const auto& wp : quorumsWithPubKeyShareTable) {
+        auto q = wp.lock();
+        if (q != nullptr && q != pQuorum) {
+            vecQuorums.emplace_back(std::move(q));
+        }
+    }
+    vecQuorums.emplace_back(pQuorum);
+
+    // most recently used quorums first, newest ones first when they were never used
+    std::sort(vecQuorums.begin(), vecQuorums.end(), [](const CQuorumCPtr& a, const CQuorumCPtr& b) {
+        const int64_t nTimeA = a->nLastUsedTime, nTimeB = b->nLastUsedTime;
+        if (nTimeA != nTimeB) {
+            return nTimeA > nTimeB;
+        }
+        return a->pindexQuorum->nHeight > b->pindexQuorum->nHeight;
+    });
+
+    size_t nMemoryUsage{0};
+    quorumsWithPubKeyShareTable.clear();
+    for (const auto& q : vecQuorums) {
+        nMemoryUsage += q->GetPubKeyShareTableMemoryUsage();
+        if (nMemoryUsage > nMaxPubKeyShareTablesMemory && q != vecQuorums.front()) {
+            LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- dropping public key share table of quorum %s\n", __func__, q->qc->quorumHash.ToString());
+            q->ClearPubKeyShareTable();
+            continue;
+        }
+        quorumsWithPubKeyShareTable.emplace_back(q);
+    }
+}
+
 void CQuorumManager::StartQuorumDataRecoveryThread(const CQuorumCPtr pQuorum, const CBlockIndex* pIndex, uint16_t nDataMaskIn) const
 {
     if (pQuorum->fQuorumDataRecoveryThreadRunning) {
@@ -747,16 +1148,24 @@ void CQuorumManager::StartQuorumDataRecoveryThread(const CQuorumCPtr pQuorum, co
     workerPool.push([pQuorum, pIndex, nDataMaskIn, this](int threadId) {
         size_t nTries{0};
         uint16_t nDataMask{nDataMaskIn};
-        int64_t nTimeLastSuccess{0};
-        uint256* pCurrentMemberHash{nullptr};
         std::vector<uint256> vecMemberHashes;
         const size_t nMyStartOffset{GetQuorumRecoveryStartOffset(pQuorum, pIndex)};
         const int64_t nRequestTimeout{10};
 
-        auto printLog = [&](const std::string& strMessage) {
-            const std::string strMember{pCurrentMemberHash == nullptr ? "nullptr" : pCurrentMemberHash->ToString()};
-            LogPrint(BCLog::LLMQ, "CQuorumManager::StartQuorumDataRecoveryThread -- %s - for llmqType %d, quorumHash %s, nDataMask (%d/%d), pCurrentMemberHash %s, nTries %d\n",
-                strMessage, pQuorum->qc->llmqType, pQuorum->qc->quorumHash.ToString(), nDataMask, nDataMaskIn, strMember, nTries);
+        // Each slot is requested from a different member in parallel. If we need the encrypted contributions, every
+        // slot covers one chunk of them and the first one also carries the quorum vvec. Otherwise there is only a
+        // single slot for the quorum vvec.
+        struct RecoverySlot {
+            size_t nChunk{0};
+            uint256* pMemberHash{nullptr};
+            int64_t nTime{0};
+        };
+        std::vector<RecoverySlot> vecSlots;
+
+        auto printLog = [&](const std::string& strMessage, const RecoverySlot* pSlot = nullptr) {
+            const std::string strMember{pSlot == nullptr || pSlot->pMemberHash == nullptr ? "nullptr" : pSlot->pMemberHash->ToString()};
+            LogPrint(BCLog::LLMQ, "CQuorumManager::StartQuorumDataRecoveryThread -- %s - for llmqType %d, quorumHash %s, nDataMask (%d/%d), pCurrentMemberHash %s, nChunk %d, nTries %d\n",
+                strMessage, pQuorum->qc->llmqType, pQuorum->qc->quorumHash.ToString(), nDataMask, nDataMaskIn, strMember, pSlot == nullptr ? 0 : pSlot->nChunk, nTries);
         };
         printLog("Start");
 
@@ -777,8 +1186,28 @@ void CQuorumManager::StartQuorumDataRecoveryThread(const CQuorumCPtr pQuorum, co
         }
         std::sort(vecMemberHashes.begin(), vecMemberHashes.end());
 
+        // Leave at least half of the members for retries of stragglers
+        size_t nSlots{1};
+        if (nDataMask & llmq::CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS) {
+            nSlots = std::max<size_t>(1, pQuorum->InitDataRecovery(std::min(QUORUM_DATA_RECOVERY_MAX_CHUNKS, vecMemberHashes.size() / 2)));
+        }
+        vecSlots.resize(nSlots);
+        for (size_t i = 0; i < vecSlots.size(); ++i) {
+            vecSlots[i].nChunk = i;
+        }
+
+        auto isSlotDone = [&](const RecoverySlot& slot) {
+            if ((nDataMask & llmq::CQuorumDataRequest::QUORUM_VERIFICATION_VECTOR) && slot.nChunk == 0) {
+                return false;
+            }
+            return !(nDataMask & llmq::CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS) || pQuorum->HasDataRecoveryChunk(slot.nChunk);
+        };
+
         printLog("Try to request");
 
+        // Sleep a bit depending on the start offset to balance out multiple requests to same masternode
+        quorumThreadInterrupt.sleep_for(std::chrono::milliseconds(nMyStartOffset * 100));
+
         while (nDataMask > 0 && !quorumThreadInterrupt) {
 
             if (nDataMask & llmq::CQuorumDataRequest::QUORUM_VERIFICATION_VECTOR && pQuorum->quorumVvec != nullptr) {
@@ -796,54 +1225,83 @@ void CQuorumManager::StartQuorumDataRecoveryThread(const CQuorumCPtr pQuorum, co
                 break;
             }
 
-            if ((GetAdjustedTime() - nTimeLastSuccess) > nRequestTimeout) {
-                if (nTries >= vecMemberHashes.size()) {
-                    printLog("All tried but failed");
-                    break;
+            bool fWaiting{false};
+            for (auto& slot : vecSlots) {
+                if (isSlotDone(slot)) {
+                    continue;
+                }
+                if (slot.pMemberHash != nullptr) {
+                    if ((GetAdjustedTime() - slot.nTime) <= nRequestTimeout) {
+                        fWaiting = true;
+                        continue;
+                    }
+                    // Straggler, try the next member. A late response is still accepted
+                    printLog("Timeout", &slot);
+                    pQuorum->AddDataRecoveryTimeout();
+                    slot.pMemberHash = nullptr;
                 }
-                // Access the member list of the quorum with the calculated offset applied to balance the load equally
-                pCurrentMemberHash = &vecMemberHashes[(nMyStartOffset + nTries++) % vecMemberHashes.size()];
-                {
+                while (slot.pMemberHash == nullptr && nTries < vecMemberHashes.size()) {
+                    // Access the member list of the quorum with the calculated offset applied to balance the load equally
+                    slot.pMemberHash = &vecMemberHashes[(nMyStartOffset + nTries++) % vecMemberHashes.size()];
                     LOCK(cs_data_requests);
-                    auto it = mapQuorumDataRequests.find(std::make_pair(*pCurrentMemberHash, true));
+                    auto it = mapQuorumDataRequests.find(std::make_pair(*slot.pMemberHash, true));
                     if (it != mapQuorumDataRequests.end() && !it->second.IsExpired()) {
-                        printLog("Already asked");
-                        continue;
+                        printLog("Already asked", &slot);
+                        slot.pMemberHash = nullptr;
                     }
                 }
-                // Sleep a bit depending on the start offset to balance out multiple requests to same masternode
-                quorumThreadInterrupt.sleep_for(std::chrono::milliseconds(nMyStartOffset * 100));
-                nTimeLastSuccess = GetAdjustedTime();
-                g_connman->AddPendingMasternode(*pCurrentMemberHash);
-                printLog("Connect");
+                if (slot.pMemberHash == nullptr) {
+                    continue;
+                }
+                fWaiting = true;
+                slot.nTime = GetAdjustedTime();
+                g_connman->AddPendingMasternode(*slot.pMemberHash);
+                printLog("Connect", &slot);
+            }
+
+            if (!fWaiting) {
+                printLog("All tried but failed");
+                break;
             }
 
             g_connman->ForEachNode([&](CNode* pNode) {
+                for (auto& slot : vecSlots) {
+                    if (slot.pMemberHash == nullptr || pNode->verifiedProRegTxHash != *slot.pMemberHash || isSlotDone(slot)) {
+                        continue;
+                    }
 
-                if (pCurrentMemberHash == nullptr || pNode->verifiedProRegTxHash != *pCurrentMemberHash) {
-                    return;
-                }
+                    uint16_t nSlotDataMask{nDataMask};
+                    uint16_t nChunkStart{0};
+                    uint16_t nChunkCount{0};
+                    if (slot.nChunk != 0) {
+                        nSlotDataMask &= ~llmq::CQuorumDataRequest::QUORUM_VERIFICATION_VECTOR;
+                    }
+                    // Older members can only send all contributions at once
+                    if ((nSlotDataMask & llmq::CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS) && pNode->nVersion >= LLMQ_DATA_CHUNKS_VERSION) {
+                        nSlotDataMask |= llmq::CQuorumDataRequest::ENCRYPTED_CONTRIBUTIONS_CHUNK;
+                        std::tie(nChunkStart, nChunkCount) = pQuorum->GetDataRecoveryChunk(slot.nChunk);
+                    }
 
-                if (quorumManager->RequestQuorumData(pNode, pQuorum->qc->llmqType, pQuorum->pindexQuorum, nDataMask, activeMasternodeInfo.proTxHash)) {
-                    nTimeLastSuccess = GetAdjustedTime();
-                    printLog("Requested");
-                } else {
-                    LOCK(cs_data_requests);
-                    auto it = mapQuorumDataRequests.find(std::make_pair(pNode->verifiedProRegTxHash, true));
-                    if (it == mapQuorumDataRequests.end()) {
-                        printLog("Failed");
-                        pNode->fDisconnect = true;
-                        pCurrentMemberHash = nullptr;
-                        return;
-                    } else if (it->second.IsProcessed()) {
-                        printLog("Processed");
-                        pNode->fDisconnect = true;
-                        pCurrentMemberHash = nullptr;
-                        return;
+                    if (quorumManager->RequestQuorumData(pNode, pQuorum->qc->llmqType, pQuorum->pindexQuorum, nSlotDataMask, activeMasternodeInfo.proTxHash, nChunkStart, nChunkCount)) {
+                        slot.nTime = GetAdjustedTime();
+                        pQuorum->AddDataRecoveryRequest();
+                        printLog("Requested", &slot);
                     } else {
-                        printLog("Waiting");
-                        return;
+                        LOCK(cs_data_requests);
+                        auto it = mapQuorumDataRequests.find(std::make_pair(pNode->verifiedProRegTxHash, true));
+                        if (it == mapQuorumDataRequests.end()) {
+                            printLog("Failed", &slot);
+                            pNode->fDisconnect = true;
+                            slot.pMemberHash = nullptr;
+                        } else if (it->second.IsProcessed()) {
+                            printLog("Processed", &slot);
+                            pNode->fDisconnect = true;
+                            slot.pMemberHash = nullptr;
+                        } else {
+                            printLog("Waiting", &slot);
+                        }
                     }
+                    return;
                 }
             });
             quorumThreadInterrupt.sleep_for(std::chrono::seconds(1));
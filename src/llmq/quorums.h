@@ -14,9 +14,12 @@
 #include <bls/bls.h>
 #include <bls/bls_worker.h>
 
+#include <ctpl_stl.h>
+
 #include <evo/evodb.h>
 
 class CNode;
+class UniValue;
 
 class CBlockIndex;
 
@@ -32,6 +35,14 @@ class CDKGSessionManager;
 // If true, we will connect to all new quorums and watch their communication
 static const bool DEFAULT_WATCH_QUORUMS = false;
 
+// Default for -llmq-pubkeyshare-mem, the maximum memory in MiB used by the public key share tables of all quorums.
+// Tables of the least recently used quorums are dropped first
+static const size_t DEFAULT_PUBKEY_SHARE_TABLES_MEMORY = 32;
+
+// The encrypted contributions of a quorum are recovered in up to this many chunks, each one requested from a different
+// member in parallel
+static const size_t QUORUM_DATA_RECOVERY_MAX_CHUNKS = 8;
+
 
 /**
  * An object of this class represents a QGETDATA request or a QDATA response header
@@ -43,6 +54,8 @@ public:
     enum Flags : uint16_t {
         QUORUM_VERIFICATION_VECTOR = 0x0001,
         ENCRYPTED_CONTRIBUTIONS = 0x0002,
+        // Only the range [nChunkStart, nChunkStart + nChunkCount) of the ENCRYPTED_CONTRIBUTIONS is requested
+        ENCRYPTED_CONTRIBUTIONS_CHUNK = 0x0004,
     };
     enum Errors : uint8_t {
         NONE = 0x00,
@@ -52,6 +65,7 @@ public:
         MASTERNODE_IS_NO_MEMBER = 0x04,
         QUORUM_VERIFICATION_VECTOR_MISSING = 0x05,
         ENCRYPTED_CONTRIBUTIONS_MISSING = 0x06,
+        ENCRYPTED_CONTRIBUTIONS_CHUNK_INVALID = 0x07,
         UNDEFINED = 0xFF,
     };
 
@@ -60,6 +74,8 @@ private:
     uint256 quorumHash;
     uint16_t nDataMask;
     uint256 proTxHash;
+    uint16_t nChunkStart{0};
+    uint16_t nChunkCount{0};
     Errors nError;
 
     int64_t nTime;
@@ -70,11 +86,14 @@ private:
 public:
 
     CQuorumDataRequest() : nTime(GetTime()) {}
-    CQuorumDataRequest(const Consensus::LLMQType llmqTypeIn, const uint256& quorumHashIn, const uint16_t nDataMaskIn, const uint256& proTxHashIn = uint256()) :
+    CQuorumDataRequest(const Consensus::LLMQType llmqTypeIn, const uint256& quorumHashIn, const uint16_t nDataMaskIn, const uint256& proTxHashIn = uint256(),
+                       const uint16_t nChunkStartIn = 0, const uint16_t nChunkCountIn = 0) :
         llmqType(llmqTypeIn),
         quorumHash(quorumHashIn),
         nDataMask(nDataMaskIn),
         proTxHash(proTxHashIn),
+        nChunkStart(nChunkStartIn),
+        nChunkCount(nChunkCountIn),
         nError(UNDEFINED),
         nTime(GetTime()),
         fProcessed(false) {}
@@ -84,6 +103,9 @@ public:
         bool fRead{false};
         SER_READ(obj, fRead = true);
         READWRITE(obj.llmqType, obj.quorumHash, obj.nDataMask, obj.proTxHash);
+        if (obj.nDataMask & ENCRYPTED_CONTRIBUTIONS_CHUNK) {
+            READWRITE(obj.nChunkStart, obj.nChunkCount);
+        }
         if (fRead) {
             try {
                 READWRITE(obj.nError);
@@ -99,6 +121,8 @@ public:
     const uint256& GetQuorumHash() const { return quorumHash; }
     uint16_t GetDataMask() const { return nDataMask; }
     const uint256& GetProTxHash() const { return proTxHash; }
+    uint16_t GetChunkStart() const { return nChunkStart; }
+    uint16_t GetChunkCount() const { return nChunkCount; }
 
     void SetError(Errors nErrorIn) { nError = nErrorIn; }
     Errors GetError() const { return nError; }
@@ -121,7 +145,9 @@ public:
         return llmqType == other.llmqType &&
                quorumHash == other.quorumHash &&
                nDataMask == other.nDataMask &&
-               proTxHash == other.proTxHash;
+               proTxHash == other.proTxHash &&
+               nChunkStart == other.nChunkStart &&
+               nChunkCount == other.nChunkCount;
     }
     bool operator!=(const CQuorumDataRequest& other) const
     {
@@ -137,6 +163,9 @@ public:
  * In case the local node is a member of the same quorum and successfully participated in the DKG, the quorum object
  * will also contain the secret key share and the quorum verification vector. The quorum vvec is then used to recover
  * the public key shares of individual members, which are needed to verify signature shares of these members.
+ *
+ * The commitment and members are always available. The vvec, secret key share and public key shares are only loaded
+ * when something actually needs them, see CQuorumManager::EnsureQuorumContributions.
  */
 
 class CQuorum;
@@ -166,6 +195,27 @@ private:
     // the public key shares are ready when needed later
     mutable CBLSWorkerCache blsCache;
     mutable std::atomic<bool> fQuorumDataRecoveryThreadRunning{false};
+    mutable std::atomic<bool> fCachePopulatorRunning{false};
+
+    // Guards the one time loading of quorumVvec and skShare from the DB or the DKG
+    mutable CCriticalSection cs_contributions;
+    mutable bool fContributionsLoaded GUARDED_BY(cs_contributions){false};
+    // Last time the vvec or secret key share was needed, used to drop public key share tables in LRU order
+    mutable std::atomic<int64_t> nLastUsedTime{0};
+
+    // Dense table of all public key shares, indexed by member index. It is built by the cache populator and read
+    // without locks (through std::atomic_load), so that verification of sig shares does not need to go through
+    // blsCache on every call. Tables of old quorums are dropped by CQuorumManager when the memory limit is reached
+    mutable std::shared_ptr<const std::vector<CBLSPublicKey>> pubKeyShareTable;
+
+    // Our decrypted contributions while they are recovered in chunks from multiple members, see
+    // CQuorumManager::StartQuorumDataRecoveryThread. An empty entry means the chunk is still missing
+    mutable CCriticalSection cs_dataRecovery;
+    mutable std::vector<BLSSecretKeyVector> vecRecoveryChunks GUARDED_BY(cs_dataRecovery);
+    mutable size_t nRecoveryChunkSize GUARDED_BY(cs_dataRecovery){0};
+    mutable int64_t nRecoveryStartTime GUARDED_BY(cs_dataRecovery){0};
+    mutable size_t nRecoveryRequests GUARDED_BY(cs_dataRecovery){0};
+    mutable size_t nRecoveryTimeouts GUARDED_BY(cs_dataRecovery){0};
 
 public:
     CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker);
@@ -182,9 +232,29 @@ public:
     CBLSPublicKey GetPubKeyShare(size_t memberIdx) const;
     const CBLSSecretKey& GetSkShare() const;
 
+    size_t GetPubKeyShareTableMemoryUsage() const;
+    //! Estimated memory used by the quorum object, its members, verification vector and public key share table
+    size_t GetMemoryUsage() const;
+
+    UniValue GetDataRecoveryStatus() const;
+
 private:
+    void BuildPubKeyShareTable(const CThreadInterrupt& interrupt) const;
+    void ClearPubKeyShareTable() const;
+
+    // Splits the encrypted contributions into at most nMaxChunks chunks and returns the resulting number of chunks
+    size_t InitDataRecovery(size_t nMaxChunks) const;
+    std::pair<uint16_t, uint16_t> GetDataRecoveryChunk(size_t nChunk) const;
+    bool HasDataRecoveryChunk(size_t nChunk) const;
+    bool AddDataRecoveryChunk(uint16_t nChunkStart, BLSSecretKeyVector&& vecSecretKeys) const;
+    bool GetRecoveredContributions(BLSSecretKeyVector& vecSecretKeysRet) const;
+    void ResetDataRecovery() const;
+    void AddDataRecoveryRequest() const;
+    void AddDataRecoveryTimeout() const;
+
     void WriteContributions(CEvoDB& evoDb) const;
-    bool ReadContributions(CEvoDB& evoDb);
+    // Reads the contributions without touching the quorum, so that multiple quorums can be read in parallel
+    bool ReadContributions(CEvoDB& evoDb, BLSVerificationVectorPtr& quorumVvecRet, CBLSSecretKey& skShareRet) const;
 };
 
 /**
@@ -204,9 +274,15 @@ private:
     mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, CQuorumPtr, StaticSaltedHasher>> mapQuorumsCache GUARDED_BY(quorumsCacheCs);
     mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::vector<CQuorumCPtr>, StaticSaltedHasher>> scanQuorumsCache GUARDED_BY(quorumsCacheCs);
 
+    // Quorums which currently hold a public key share table, see CQuorum::pubKeyShareTable
+    mutable CCriticalSection pubKeyShareTablesCs;
+    mutable std::vector<std::weak_ptr<const CQuorum>> quorumsWithPubKeyShareTable GUARDED_BY(pubKeyShareTablesCs);
+
     mutable ctpl::thread_pool workerPool;
     mutable CThreadInterrupt quorumThreadInterrupt;
 
+    const size_t nMaxPubKeyShareTablesMemory;
+
 public:
     CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager);
     ~CQuorumManager();
@@ -222,7 +298,15 @@ public:
 
     static bool HasQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash);
 
-    bool RequestQuorumData(CNode* pFrom, Consensus::LLMQType llmqType, const CBlockIndex* pQuorumIndex, uint16_t nDataMask, const uint256& proTxHash = uint256()) const;
+    bool RequestQuorumData(CNode* pFrom, Consensus::LLMQType llmqType, const CBlockIndex* pQuorumIndex, uint16_t nDataMask, const uint256& proTxHash = uint256(),
+                           uint16_t nChunkStart = 0, uint16_t nChunkCount = 0) const;
+
+    // Loads the quorum vvec and our secret key share of a quorum if not done yet and starts building its public key
+    // share table. Must be called before quorumVvec, skShare or GetPubKeyShare of a quorum are used
+    void EnsureQuorumContributions(const CQuorumCPtr& pQuorum) const;
+    // Same as above for multiple quorums at once. The contributions of all quorums which are not loaded yet are read
+    // from the DB or built from the DKG in parallel on the BLS workers
+    void EnsureQuorumContributions(const std::vector<CQuorumCPtr>& vecQuorums) const;
 
     // all these methods will lock cs_main for a short period of time
     CQuorumCPtr GetQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash) const;
@@ -236,7 +320,12 @@ private:
     void EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex *pindexNew) const;
 
     CQuorumPtr BuildQuorumFromCommitment(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum) const;
-    bool BuildQuorumContributions(const CFinalCommitmentPtr& fqc, const std::shared_ptr<CQuorum>& quorum) const;
+    // Building the contributions is split into starting the aggregation of the quorum vvec and skShare in the BLS
+    // worker and waiting for the results, so that the contributions of multiple quorums can be built at once
+    struct ContributionsBuild;
+    bool StartBuildQuorumContributions(const CQuorumCPtr& pQuorum, ContributionsBuild& build) const;
+    bool FinishBuildQuorumContributions(ContributionsBuild& build, BLSVerificationVectorPtr& quorumVvecRet, CBLSSecretKey& skShareRet) const;
+    bool BuildQuorumContributions(const CQuorumCPtr& pQuorum, BLSVerificationVectorPtr& quorumVvecRet, CBLSSecretKey& skShareRet) const;
 
     CQuorumCPtr GetQuorum(Consensus::LLMQType llmqType, const CBlockIndex* pindex) const;
     /// Returns the start offset for the masternode with the given proTxHash. This offset is applied when picking data recovery members of a quorum's
@@ -245,7 +334,10 @@ private:
     size_t GetQuorumRecoveryStartOffset(const CQuorumCPtr pQuorum, const CBlockIndex* pIndex) const;
 
     void StartCachePopulatorThread(const CQuorumCPtr pQuorum) const;
+    void AddPubKeyShareTable(const CQuorumCPtr& pQuorum) const;
     void StartQuorumDataRecoveryThread(const CQuorumCPtr pQuorum, const CBlockIndex* pIndex, uint16_t nDataMask) const;
+    // Aggregates our secret key share once the quorum vvec and all chunks of the encrypted contributions are available
+    bool FinishDataRecovery(const CQuorumPtr& pQuorum) const;
 };
 
 extern CQuorumManager* quorumManager;
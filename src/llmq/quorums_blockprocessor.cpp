@@ -5,7 +5,9 @@
 #include <llmq/quorums_blockprocessor.h>
 #include <llmq/quorums_commitment.h>
 #include <llmq/quorums_debug.h>
+#include <llmq/quorums_init.h>
 
+#include <bls/bls_worker.h>
 #include <evo/evodb.h>
 #include <evo/specialtx.h>
 
@@ -21,6 +23,7 @@
 #include <saltedhasher.h>
 #include <sync.h>
 
+#include <algorithm>
 #include <map>
 
 namespace llmq
@@ -37,6 +40,7 @@ CQuorumBlockProcessor::CQuorumBlockProcessor(CEvoDB &_evoDb) :
     evoDb(_evoDb)
 {
     CLLMQUtils::InitQuorumsCache(mapHasMinedCommitmentCache);
+    CLLMQUtils::InitQuorumsCache(mapMinedCommitmentHashCache);
 }
 
 void CQuorumBlockProcessor::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
@@ -123,7 +127,7 @@ void CQuorumBlockProcessor::ProcessMessage(CNode* pfrom, const std::string& strC
     }
 }
 
-bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck)
+bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckSigs)
 {
     AssertLockHeld(cs_main);
 
@@ -168,7 +172,7 @@ bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex*
 
     for (const auto& p : qcs) {
         const auto& qc = p.second;
-        if (!ProcessCommitment(pindex->nHeight, blockHash, qc, state, fJustCheck)) {
+        if (!ProcessCommitment(pindex->nHeight, blockHash, qc, state, fJustCheck, fCheckSigs)) {
             return false;
         }
     }
@@ -186,7 +190,7 @@ static std::tuple<std::string, Consensus::LLMQType, uint32_t> BuildInversedHeigh
     return std::make_tuple(DB_MINED_COMMITMENT_BY_INVERSED_HEIGHT, llmqType, htobe32(std::numeric_limits<uint32_t>::max() - nMinedHeight));
 }
 
-bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck)
+bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck, bool fCheckSigs)
 {
     const auto& llmq_params = GetLLMQParams(qc.llmqType);
 
@@ -223,7 +227,7 @@ bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockH
 
     auto quorumIndex = LookupBlockIndex(qc.quorumHash);
 
-    if (!qc.Verify(quorumIndex, true)) {
+    if (!qc.Verify(quorumIndex, fCheckSigs)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-qc-invalid");
     }
 
@@ -235,10 +239,12 @@ bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockH
     auto cacheKey = std::make_pair(llmq_params.type, quorumHash);
     evoDb.Write(std::make_pair(DB_MINED_COMMITMENT, cacheKey), std::make_pair(qc, blockHash));
     evoDb.Write(BuildInversedHeightKey(llmq_params.type, nHeight), quorumIndex->nHeight);
+    AddMinedCommitmentToIndex(llmq_params.type, nHeight, blockHash, quorumIndex->nHeight);
 
     {
         LOCK(minableCommitmentsCs);
         mapHasMinedCommitmentCache[qc.llmqType].erase(qc.quorumHash);
+        mapMinedCommitmentHashCache[qc.llmqType].insert(qc.quorumHash, {nHeight, blockHash, ::SerializeHash(qc)});
         minableCommitmentsByQuorum.erase(cacheKey);
         minableCommitments.erase(::SerializeHash(qc));
     }
@@ -267,9 +273,11 @@ bool CQuorumBlockProcessor::UndoBlock(const CBlock& block, const CBlockIndex* pi
 
         evoDb.Erase(std::make_pair(DB_MINED_COMMITMENT, std::make_pair(qc.llmqType, qc.quorumHash)));
         evoDb.Erase(BuildInversedHeightKey(qc.llmqType, pindex->nHeight));
+        RemoveMinedCommitmentFromIndex(qc.llmqType, pindex->nHeight, pindex->GetBlockHash());
         {
             LOCK(minableCommitmentsCs);
             mapHasMinedCommitmentCache[qc.llmqType].erase(qc.quorumHash);
+            mapMinedCommitmentHashCache[qc.llmqType].erase(qc.quorumHash);
         }
 
         // if a reorg happened, we should allow to mine this commitment later
@@ -288,11 +296,16 @@ bool CQuorumBlockProcessor::UpgradeDB()
 
     if (chainActive.Tip() == nullptr) {
         // should have no records
-        return evoDb.IsEmpty();
+        if (!evoDb.IsEmpty()) {
+            return false;
+        }
+        LoadMinedCommitmentsIndex();
+        return true;
     }
 
     uint256 bestBlock;
     if (evoDb.GetRawDB().Read(DB_BEST_BLOCK_UPGRADE, bestBlock) && bestBlock == chainActive.Tip()->GetBlockHash()) {
+        LoadMinedCommitmentsIndex();
         return true;
     }
 
@@ -327,12 +340,80 @@ bool CQuorumBlockProcessor::UpgradeDB()
 
             pindex = chainActive.Next(pindex);
         }
+        evoDb.ClearReadCache();
     }
 
     LogPrintf("CQuorumBlockProcessor::%s -- Upgrade done...\n", __func__);
+    LoadMinedCommitmentsIndex();
     return true;
 }
 
+void CQuorumBlockProcessor::LoadMinedCommitmentsIndex()
+{
+    AssertLockHeld(cs_main);
+
+    // The DB is in sync with chainActive at this point, so the mined blocks can be taken from there
+    std::map<Consensus::LLMQType, std::vector<MinedCommitmentEntry>> mapIndex;
+    for (const auto& p : Params().GetConsensus().llmqs) {
+        const auto llmqType = p.first;
+        auto& vecEntries = mapIndex[llmqType];
+
+        LOCK(evoDb.cs);
+        auto dbIt = evoDb.GetCurTransaction().NewIteratorUniquePtr();
+        auto firstKey = BuildInversedHeightKey(llmqType, std::numeric_limits<int>::max());
+        dbIt->Seek(firstKey);
+        while (dbIt->Valid()) {
+            decltype(firstKey) curKey;
+            int nQuorumHeight;
+            if (!dbIt->GetKey(curKey) || std::get<0>(curKey) != DB_MINED_COMMITMENT_BY_INVERSED_HEIGHT || std::get<1>(curKey) != llmqType) {
+                break;
+            }
+            const int nMinedHeight = (int)(std::numeric_limits<uint32_t>::max() - be32toh(std::get<2>(curKey)));
+            if (dbIt->GetValue(nQuorumHeight) && chainActive[nMinedHeight] != nullptr) {
+                vecEntries.push_back({nMinedHeight, chainActive[nMinedHeight]->GetBlockHash(), nQuorumHeight});
+            }
+            dbIt->Next();
+        }
+        // the DB is ordered by inversed height
+        std::reverse(vecEntries.begin(), vecEntries.end());
+    }
+
+    LOCK(minedCommitmentsIndexCs);
+    mapMinedCommitmentsIndex = std::move(mapIndex);
+    fMinedCommitmentsIndexLoaded = true;
+}
+
+void CQuorumBlockProcessor::AddMinedCommitmentToIndex(Consensus::LLMQType llmqType, int nMinedHeight, const uint256& minedBlockHash, int nQuorumHeight)
+{
+    LOCK(minedCommitmentsIndexCs);
+    auto& vecEntries = mapMinedCommitmentsIndex[llmqType];
+    auto it = std::upper_bound(vecEntries.begin(), vecEntries.end(), nMinedHeight, [](int nHeight, const MinedCommitmentEntry& e) {
+        return nHeight < e.nMinedHeight;
+    });
+    for (auto it2 = it; it2 != vecEntries.begin() && (it2 - 1)->nMinedHeight == nMinedHeight; --it2) {
+        if ((it2 - 1)->minedBlockHash == minedBlockHash) {
+            return;
+        }
+    }
+    vecEntries.insert(it, {nMinedHeight, minedBlockHash, nQuorumHeight});
+}
+
+void CQuorumBlockProcessor::RemoveMinedCommitmentFromIndex(Consensus::LLMQType llmqType, int nMinedHeight, const uint256& minedBlockHash)
+{
+    LOCK(minedCommitmentsIndexCs);
+    auto& vecEntries = mapMinedCommitmentsIndex[llmqType];
+    auto it = std::lower_bound(vecEntries.begin(), vecEntries.end(), nMinedHeight, [](const MinedCommitmentEntry& e, int nHeight) {
+        return e.nMinedHeight < nHeight;
+    });
+    while (it != vecEntries.end() && it->nMinedHeight == nMinedHeight) {
+        if (it->minedBlockHash == minedBlockHash) {
+            it = vecEntries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 bool CQuorumBlockProcessor::GetCommitmentsFromBlock(const CBlock& block, const CBlockIndex* pindex, std::map<Consensus::LLMQType, CFinalCommitment>& ret, CValidationState& state)
 {
     AssertLockHeld(cs_main);
@@ -413,10 +494,14 @@ bool CQuorumBlockProcessor::HasMinedCommitment(Consensus::LLMQType llmqType, con
         }
     }
 
+    uint64_t nGen = evoDb.GetGeneration();
     fExists = evoDb.Exists(std::make_pair(DB_MINED_COMMITMENT, std::make_pair(llmqType, quorumHash)));
 
     LOCK(minableCommitmentsCs);
-    mapHasMinedCommitmentCache[llmqType].insert(quorumHash, fExists);
+    // a block which is being connected or disconnected might have changed it already
+    if (evoDb.IsCacheable(nGen)) {
+        mapHasMinedCommitmentCache[llmqType].insert(quorumHash, fExists);
+    }
 
     return fExists;
 }
@@ -432,9 +517,64 @@ CFinalCommitmentPtr CQuorumBlockProcessor::GetMinedCommitment(Consensus::LLMQTyp
     return std::make_shared<CFinalCommitment>(p.first);
 }
 
+bool CQuorumBlockProcessor::GetMinedCommitmentHash(Consensus::LLMQType llmqType, const uint256& quorumHash, const CBlockIndex* pindex, uint256& retCommitmentHash)
+{
+    AssertLockHeld(cs_main);
+
+    MinedCommitmentHash e;
+    {
+        LOCK(minableCommitmentsCs);
+        if (mapMinedCommitmentHashCache[llmqType].get(quorumHash, e)) {
+            auto pindexMined = pindex->GetAncestor(e.nMinedHeight);
+            if (pindexMined && pindexMined->GetBlockHash() == e.minedBlockHash) {
+                retCommitmentHash = e.commitmentHash;
+                return true;
+            }
+        }
+    }
+
+    uint256 minedBlockHash;
+    auto qc = GetMinedCommitment(llmqType, quorumHash, minedBlockHash);
+    if (qc == nullptr) {
+        return false;
+    }
+    retCommitmentHash = ::SerializeHash(*qc);
+
+    auto pindexMined = LookupBlockIndex(minedBlockHash);
+    if (pindexMined) {
+        LOCK(minableCommitmentsCs);
+        mapMinedCommitmentHashCache[llmqType].insert(quorumHash, {pindexMined->nHeight, minedBlockHash, retCommitmentHash});
+    }
+    return true;
+}
+
 // The returned quorums are in reversed order, so the most recent one is at index 0
 std::vector<const CBlockIndex*> CQuorumBlockProcessor::GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount)
 {
+    {
+        LOCK(minedCommitmentsIndexCs);
+        if (fMinedCommitmentsIndexLoaded) {
+            std::vector<const CBlockIndex*> ret;
+            ret.reserve(maxCount);
+
+            const auto& vecEntries = mapMinedCommitmentsIndex[llmqType];
+            auto it = std::upper_bound(vecEntries.begin(), vecEntries.end(), pindex->nHeight, [](int nHeight, const MinedCommitmentEntry& e) {
+                return nHeight < e.nMinedHeight;
+            });
+            while (it != vecEntries.begin() && ret.size() < maxCount) {
+                --it;
+                if (pindex->GetAncestor(it->nMinedHeight)->GetBlockHash() != it->minedBlockHash) {
+                    // mined in a block which is not part of this chain
+                    continue;
+                }
+                auto quorumIndex = pindex->GetAncestor(it->nQuorumHeight);
+                assert(quorumIndex);
+                ret.emplace_back(quorumIndex);
+            }
+            return ret;
+        }
+    }
+
     LOCK(evoDb.cs);
 
     auto dbIt = evoDb.GetCurTransaction().NewIteratorUniquePtr();
@@ -499,6 +639,50 @@ bool CQuorumBlockProcessor::HasMineableCommitment(const uint256& hash)
     return minableCommitments.count(hash) != 0;
 }
 
+void CQuorumBlockProcessor::PreVerifyCommitment(const CFinalCommitment& qc, const CBlockIndex* pindexQuorum)
+{
+    auto& workerPool = blsWorker->GetWorkerPool();
+    if (workerPool.Size() == 0) {
+        // nobody would ever run the job
+        return;
+    }
+
+    uint256 commitmentHash = ::SerializeHash(qc);
+    LOCK(preVerifiedCommitmentsCs);
+    std::shared_future<bool> f;
+    if (preVerifiedCommitments.get(commitmentHash, f)) {
+        return;
+    }
+    // The members only depend on the quorum block, so the result is the same as when verified while connecting
+    f = workerPool.Push(CBLSWorkerPool::Priority::THROUGHPUT, [qc, pindexQuorum](int) {
+        try {
+            return qc.Verify(pindexQuorum, true);
+        } catch (const std::exception& e) {
+            LogPrintf("CQuorumBlockProcessor::PreVerifyCommitment -- failed: %s\n", e.what());
+            return false;
+        }
+    }).share();
+    preVerifiedCommitments.insert(commitmentHash, f);
+}
+
+bool CQuorumBlockProcessor::ConsumePreVerifiedCommitment(const uint256& commitmentHash)
+{
+    std::shared_future<bool> f;
+    {
+        LOCK(preVerifiedCommitmentsCs);
+        if (!preVerifiedCommitments.get(commitmentHash, f)) {
+            return false;
+        }
+        preVerifiedCommitments.erase(commitmentHash);
+    }
+    try {
+        // throws if the workers were stopped before running the job
+        return f.get();
+    } catch (const std::future_error&) {
+        return false;
+    }
+}
+
 void CQuorumBlockProcessor::AddMineableCommitment(const CFinalCommitment& fqc)
 {
     bool relay = false;
@@ -7,6 +7,7 @@
 
 #include <llmq/quorums_utils.h>
 
+#include <future>
 #include <unordered_map>
 #include <unordered_lru_cache.h>
 #include <saltedhasher.h>
@@ -34,6 +35,33 @@ private:
 
     std::map<Consensus::LLMQType, unordered_lru_cache<uint256, bool, StaticSaltedHasher>> mapHasMinedCommitmentCache GUARDED_BY(minableCommitmentsCs);
 
+    // Hashes of mined commitments as used in the quorum merkle root of CbTx, keyed by quorumHash. Like the index below,
+    // entries remember the block they were mined in so that they are only used for chains containing that block.
+    struct MinedCommitmentHash {
+        int nMinedHeight;
+        uint256 minedBlockHash;
+        uint256 commitmentHash;
+    };
+    std::map<Consensus::LLMQType, unordered_lru_cache<uint256, MinedCommitmentHash, StaticSaltedHasher>> mapMinedCommitmentHashCache GUARDED_BY(minableCommitmentsCs);
+
+    // In-memory copy of the minedHeight->quorumHeight index in the DB, ordered by mined height. Entries are written
+    // while blocks are processed, which might still fail later, so every entry also remembers the block it was mined
+    // in and is only used when that block is part of the chain in question.
+    struct MinedCommitmentEntry {
+        int nMinedHeight;
+        uint256 minedBlockHash;
+        int nQuorumHeight;
+    };
+    CCriticalSection minedCommitmentsIndexCs;
+    bool fMinedCommitmentsIndexLoaded GUARDED_BY(minedCommitmentsIndexCs){false};
+    std::map<Consensus::LLMQType, std::vector<MinedCommitmentEntry>> mapMinedCommitmentsIndex GUARDED_BY(minedCommitmentsIndexCs);
+
+    // Verdicts of commitments which are verified on the BLS workers ahead of the blocks they are mined in, keyed by
+    // the commitment hash. Commitments of blocks which are never connected are evicted eventually.
+    static const size_t PRE_VERIFIED_COMMITMENTS_CACHE_SIZE = 256;
+    CCriticalSection preVerifiedCommitmentsCs;
+    unordered_lru_cache<uint256, std::shared_future<bool>, StaticSaltedHasher, PRE_VERIFIED_COMMITMENTS_CACHE_SIZE> preVerifiedCommitments GUARDED_BY(preVerifiedCommitmentsCs);
+
 public:
     explicit CQuorumBlockProcessor(CEvoDB& _evoDb);
 
@@ -41,9 +69,17 @@ public:
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv);
 
-    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
+    // fCheckSigs can be set to false when the signatures of all commitments in the block were verified already
+    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckSigs = true);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
 
+    // Starts a full verification of qc on the BLS workers, so that connecting the block it is mined in only has to
+    // consume the verdict. Only for commitments of blocks which will soon be connected, e.g. while syncing
+    void PreVerifyCommitment(const CFinalCommitment& qc, const CBlockIndex* pindexQuorum);
+    // Returns true if the commitment was successfully verified by PreVerifyCommitment, waits for a verification which
+    // is still in progress. Each verdict can only be consumed once
+    bool ConsumePreVerifiedCommitment(const uint256& commitmentHash);
+
     void AddMineableCommitment(const CFinalCommitment& fqc);
     bool HasMineableCommitment(const uint256& hash);
     bool GetMineableCommitmentByHash(const uint256& commitmentHash, CFinalCommitment& ret);
@@ -52,16 +88,24 @@ public:
 
     bool HasMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash);
     CFinalCommitmentPtr GetMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash, uint256& retMinedBlockHash);
+    // Same as ::SerializeHash(*GetMinedCommitment(...)), but usually without touching the DB. The commitment must have
+    // been mined in pindex or one of its ancestors
+    bool GetMinedCommitmentHash(Consensus::LLMQType llmqType, const uint256& quorumHash, const CBlockIndex* pindex, uint256& retCommitmentHash);
 
     std::vector<const CBlockIndex*> GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount);
     std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> GetMinedAndActiveCommitmentsUntilBlock(const CBlockIndex* pindex);
 
+    static bool IsMiningPhase(Consensus::LLMQType llmqType, int nHeight);
+
 private:
     static bool GetCommitmentsFromBlock(const CBlock& block, const CBlockIndex* pindex, std::map<Consensus::LLMQType, CFinalCommitment>& ret, CValidationState& state);
-    bool ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck);
-    static bool IsMiningPhase(Consensus::LLMQType llmqType, int nHeight);
+    bool ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck, bool fCheckSigs);
     bool IsCommitmentRequired(Consensus::LLMQType llmqType, int nHeight);
     static uint256 GetQuorumBlockHash(Consensus::LLMQType llmqType, int nHeight);
+
+    void LoadMinedCommitmentsIndex();
+    void AddMinedCommitmentToIndex(Consensus::LLMQType llmqType, int nMinedHeight, const uint256& minedBlockHash, int nQuorumHeight);
+    void RemoveMinedCommitmentFromIndex(Consensus::LLMQType llmqType, int nMinedHeight, const uint256& minedBlockHash);
 };
 
 extern CQuorumBlockProcessor* quorumBlockProcessor;
@@ -10,10 +10,14 @@
 #include <chain.h>
 #include <consensus/validation.h>
 #include <masternode/masternode-sync.h>
+#include <memusage.h>
 #include <net_processing.h>
 #include <scheduler.h>
 #include <spork.h>
+#include <statsd_client.h>
 #include <txmempool.h>
+#include <util/memaccounting.h>
+#include <util/trace.h>
 #include <util/validation.h>
 
 namespace llmq
@@ -35,13 +39,24 @@ std::string CChainLockSig::ToString() const
 
 CChainLocksHandler::CChainLocksHandler()
 {
-    scheduler = new CScheduler();
+    scheduler = new CScheduler("cl-schdlr");
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, scheduler);
     scheduler_thread = new boost::thread(boost::bind(&TraceThread<CScheduler::Function>, "cl-schdlr", serviceLoop));
+    memaccounting::Register("chainlocks", this, [this]() {
+        LOCK(cs);
+        size_t nUsage = memusage::DynamicUsage(blockTxs) + memusage::DynamicUsage(txFirstSeenTime) +
+                        memusage::DynamicUsage(unsafeBlockTxs) + memusage::DynamicUsage(seenChainLocks);
+        nUsage += blockTxs.size() * memusage::MallocUsage(sizeof(std::vector<uint256>)) + blockTxsTxCount * sizeof(uint256);
+        for (const auto& p : unsafeBlockTxs) {
+            nUsage += memusage::DynamicUsage(p.second);
+        }
+        return nUsage;
+    });
 }
 
 CChainLocksHandler::~CChainLocksHandler()
 {
+    memaccounting::Unregister(this);
     scheduler_thread->interrupt();
     scheduler_thread->join();
     delete scheduler_thread;
@@ -56,7 +71,7 @@ void CChainLocksHandler::Start()
         EnforceBestChainLock();
         // regularly retry signing the current chaintip as it might have failed before due to missing islocks
         TrySignChainTip();
-    }, 5000);
+    }, 5000, SchedulerTaskOptions{"chainlocks-periodic", SchedulerPriority::NORMAL, ""});
 }
 
 void CChainLocksHandler::Stop()
@@ -130,7 +145,7 @@ void CChainLocksHandler::ProcessNewChainLock(const NodeId from, const llmq::CCha
     }
 
     const uint256 requestId = ::SerializeHash(std::make_pair(CLSIG_REQUESTID_PREFIX, clsig.nHeight));
-    if (!llmq::CSigningManager::VerifyRecoveredSig(Params().GetConsensus().llmqTypeChainLocks, clsig.nHeight, requestId, clsig.blockHash, clsig.sig)) {
+    if (!llmq::CSigningManager::VerifyRecoveredSig(Params().GetConsensus().llmqTypeChainLocks, clsig.nHeight, requestId, clsig.blockHash, clsig.sig.Get())) {
         LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- invalid CLSIG (%s), peer=%d\n", __func__, clsig.ToString(), from);
         if (from != -1) {
             LOCK(cs_main);
@@ -149,6 +164,11 @@ void CChainLocksHandler::ProcessNewChainLock(const NodeId from, const llmq::CCha
         LOCK(cs);
         bestChainLockHash = hash;
         bestChainLock = clsig;
+        EvictBlockTxs(clsig.nHeight);
+
+        if (clsig.blockHash == lastTipHash) {
+            statsClient.histogram("chainlocks.tipToClsigMs", GetTimeMillis() - lastTipTime);
+        }
 
         if (pindex != nullptr) {
 
@@ -180,7 +200,7 @@ void CChainLocksHandler::ProcessNewChainLock(const NodeId from, const llmq::CCha
     scheduler->scheduleFromNow([&]() {
         CheckActiveState();
         EnforceBestChainLock();
-    }, 0);
+    }, 0, SchedulerTaskOptions{"chainlocks-enforce", SchedulerPriority::NORMAL, ""});
 
     LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- processed new CLSIG (%s), peer=%d\n",
               __func__, clsig.ToString(), from);
@@ -209,6 +229,16 @@ void CChainLocksHandler::AcceptedBlockHeader(const CBlockIndex* pindexNew)
 }
 
 void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
+{
+    {
+        LOCK(cs);
+        lastTipHash = pindexNew->GetBlockHash();
+        lastTipTime = GetTimeMillis();
+    }
+    ScheduleTrySignChainTip();
+}
+
+void CChainLocksHandler::ScheduleTrySignChainTip()
 {
     // don't call TrySignChainTip directly but instead let the scheduler call it. This way we ensure that cs_main is
     // never locked and TrySignChainTip is not called twice in parallel. Also avoids recursive calls due to
@@ -224,7 +254,7 @@ void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
         TrySignChainTip();
         LOCK(cs);
         tryLockChainTipScheduled = false;
-    }, 0);
+    }, 0, SchedulerTaskOptions{"chainlocks-trysign", SchedulerPriority::NORMAL, ""});
 }
 
 void CChainLocksHandler::CheckActiveState()
@@ -322,27 +352,8 @@ void CChainLocksHandler::TrySignChainTip()
                 break;
             }
 
-            auto txids = GetBlockTxs(pindexWalk->GetBlockHash());
-            if (!txids) {
-                pindexWalk = pindexWalk->pprev;
-                continue;
-            }
-
-            for (auto& txid : *txids) {
-                int64_t txAge = 0;
-                {
-                    LOCK(cs);
-                    auto it = txFirstSeenTime.find(txid);
-                    if (it != txFirstSeenTime.end()) {
-                        txAge = GetAdjustedTime() - it->second;
-                    }
-                }
-
-                if (txAge < WAIT_FOR_ISLOCK_TIMEOUT && !quorumInstantSendManager->IsLocked(txid)) {
-                    LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- not signing block %s due to TX %s not being islocked and not old enough. age=%d\n", __func__,
-                              pindexWalk->GetBlockHash().ToString(), txid.ToString(), txAge);
-                    return;
-                }
+            if (!IsBlockSafeToSign(pindexWalk)) {
+                return;
             }
 
             pindexWalk = pindexWalk->pprev;
@@ -363,17 +374,32 @@ void CChainLocksHandler::TrySignChainTip()
         lastSignedMsgHash = msgHash;
     }
 
+    TRACE2(chainlocks, sign_started, msgHash.begin(), pindex->nHeight);
     quorumSigningManager->AsyncSignIfMember(Params().GetConsensus().llmqTypeChainLocks, requestId, msgHash);
 }
 
-void CChainLocksHandler::TransactionAddedToMempool(const CTransactionRef& tx, int64_t nAcceptTime)
+void CChainLocksHandler::TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs)
+{
+    LOCK(cs);
+    for (const auto& p : txs) {
+        if (p.first->IsCoinBase() || p.first->vin.empty()) {
+            continue;
+        }
+        txFirstSeenTime.emplace(p.first->GetHash(), p.second);
+    }
+}
+
+void CChainLocksHandler::TransactionRemovedFromMempool(const CTransactionRef& tx)
 {
     if (tx->IsCoinBase() || tx->vin.empty()) {
         return;
     }
 
+    // TXs removed due to being included in a block are not signalled here, so this only forgets about TXs which
+    // are gone for good (expired, conflicted, replaced...). Worst case we start waiting for an islock again if it
+    // comes back later
     LOCK(cs);
-    txFirstSeenTime.emplace(tx->GetHash(), nAcceptTime);
+    txFirstSeenTime.erase(tx->GetHash());
 }
 
 void CChainLocksHandler::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
@@ -386,82 +412,160 @@ void CChainLocksHandler::BlockConnected(const std::shared_ptr<const CBlock>& pbl
     // We need this information later when we try to sign a new tip, so that we can determine if all included TXs are
     // safe.
 
-    LOCK(cs);
-
-    auto it = blockTxs.find(pindex->GetBlockHash());
-    if (it == blockTxs.end()) {
-        // we must create this entry even if there are no lockable transactions in the block, so that TrySignChainTip
-        // later knows about this block
-        it = blockTxs.emplace(pindex->GetBlockHash(), std::make_shared<std::unordered_set<uint256, StaticSaltedHasher>>()).first;
-    }
-    auto& txids = *it->second;
-
-    int64_t curTime = GetAdjustedTime();
-
+    // we must create the entry even if there are no lockable transactions in the block, so that TrySignChainTip
+    // later knows about this block
+    auto txids = std::make_shared<std::vector<uint256>>();
+    txids->reserve(pblock->vtx.size());
     for (const auto& tx : pblock->vtx) {
         if (tx->IsCoinBase() || tx->vin.empty()) {
             continue;
         }
-
-        txids.emplace(tx->GetHash());
-        txFirstSeenTime.emplace(tx->GetHash(), curTime);
+        txids->emplace_back(tx->GetHash());
     }
 
+    LOCK(cs);
+    AddBlockTxs(pindex, txids, GetAdjustedTime());
+    EvictBlockTxs(std::max(pindex->nHeight - MAX_BLOCKTXS_DEPTH, bestChainLock.nHeight));
 }
 
 void CChainLocksHandler::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
 {
     LOCK(cs);
-    blockTxs.erase(pindexDisconnected->GetBlockHash());
+    // the first seen times of the TXs are kept, as most of them will go back into the mempool
+    auto it = blockTxs.find(std::make_pair(pindexDisconnected->nHeight, pindexDisconnected->GetBlockHash()));
+    if (it != blockTxs.end()) {
+        blockTxsTxCount -= it->second->size();
+        blockTxs.erase(it);
+    }
+    unsafeBlockTxs.erase(pindexDisconnected->GetBlockHash());
 }
 
-CChainLocksHandler::BlockTxs::mapped_type CChainLocksHandler::GetBlockTxs(const uint256& blockHash)
+void CChainLocksHandler::NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks)
+{
+    bool fBlockBecameSafe = false;
+    {
+        LOCK(cs);
+        for (auto& p : unsafeBlockTxs) {
+            if (p.second.empty()) {
+                continue;
+            }
+            for (const auto& lock : locks) {
+                p.second.erase(lock.first->GetHash());
+            }
+            if (p.second.empty()) {
+                fBlockBecameSafe = true;
+            }
+        }
+    }
+    if (fBlockBecameSafe) {
+        // no need to wait for the next regular retry
+        ScheduleTrySignChainTip();
+    }
+}
+
+CChainLocksHandler::BlockTxids CChainLocksHandler::GetBlockTxs(const CBlockIndex* pindex)
 {
     AssertLockNotHeld(cs);
     AssertLockNotHeld(cs_main);
 
-    CChainLocksHandler::BlockTxs::mapped_type ret;
-
     {
         LOCK(cs);
-        auto it = blockTxs.find(blockHash);
+        auto it = blockTxs.find(std::make_pair(pindex->nHeight, pindex->GetBlockHash()));
         if (it != blockTxs.end()) {
-            ret = it->second;
+            return it->second;
         }
     }
-    if (!ret) {
-        // This should only happen when freshly started.
-        // If running for some time, SyncTransaction should have been called before which fills blockTxs.
-        LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- blockTxs for %s not found. Trying ReadBlockFromDisk\n", __func__,
-                 blockHash.ToString());
 
-        uint32_t blockTime;
-        {
-            LOCK(cs_main);
-            auto pindex = LookupBlockIndex(blockHash);
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                return nullptr;
-            }
+    // This should only happen when freshly started.
+    // If running for some time, SyncTransaction should have been called before which fills blockTxs.
+    LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- blockTxs for %s not found. Trying ReadBlockFromDisk\n", __func__,
+             pindex->GetBlockHash().ToString());
 
-            ret = std::make_shared<std::unordered_set<uint256, StaticSaltedHasher>>();
-            for (auto& tx : block.vtx) {
-                if (tx->IsCoinBase() || tx->vin.empty()) {
-                    continue;
-                }
-                ret->emplace(tx->GetHash());
-            }
+    CBlock block;
+    {
+        LOCK(cs_main);
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return nullptr;
+        }
+    }
 
-            blockTime = block.nTime;
+    auto txids = std::make_shared<std::vector<uint256>>();
+    txids->reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase() || tx->vin.empty()) {
+            continue;
         }
+        txids->emplace_back(tx->GetHash());
+    }
 
-        LOCK(cs);
-        blockTxs.emplace(blockHash, ret);
-        for (auto& txid : *ret) {
-            txFirstSeenTime.emplace(txid, blockTime);
+    LOCK(cs);
+    AddBlockTxs(pindex, txids, block.nTime);
+    return txids;
+}
+
+void CChainLocksHandler::AddBlockTxs(const CBlockIndex* pindex, const BlockTxids& txids, int64_t firstSeenTime)
+{
+    AssertLockHeld(cs);
+
+    if (!blockTxs.emplace(std::make_pair(pindex->nHeight, pindex->GetBlockHash()), txids).second) {
+        return;
+    }
+    blockTxsTxCount += txids->size();
+    unsafeBlockTxs.emplace(pindex->GetBlockHash(), std::unordered_set<uint256, StaticSaltedHasher>(txids->begin(), txids->end()));
+    for (const auto& txid : *txids) {
+        txFirstSeenTime.emplace(txid, firstSeenTime);
+    }
+}
+
+void CChainLocksHandler::EvictBlockTxs(int nHeight)
+{
+    AssertLockHeld(cs);
+
+    // Blocks at or below a ChainLocked height are either ChainLocked themselves or conflicting with the ChainLock, so
+    // in both cases we will never try to sign them. Same for blocks which are too deep for TrySignChainTip
+    auto itEnd = blockTxs.lower_bound(std::make_pair(nHeight + 1, uint256()));
+    for (auto it = blockTxs.begin(); it != itEnd; ++it) {
+        for (const auto& txid : *it->second) {
+            txFirstSeenTime.erase(txid);
+        }
+        blockTxsTxCount -= it->second->size();
+        unsafeBlockTxs.erase(it->first.second);
+    }
+    blockTxs.erase(blockTxs.begin(), itEnd);
+}
+
+bool CChainLocksHandler::IsBlockSafeToSign(const CBlockIndex* pindex)
+{
+    auto txids = GetBlockTxs(pindex);
+    if (!txids) {
+        return true;
+    }
+
+    LOCK(cs);
+    auto it = unsafeBlockTxs.find(pindex->GetBlockHash());
+    if (it == unsafeBlockTxs.end()) {
+        it = unsafeBlockTxs.emplace(pindex->GetBlockHash(), std::unordered_set<uint256, StaticSaltedHasher>(txids->begin(), txids->end())).first;
+    }
+    auto& unsafeTxids = it->second;
+
+    for (auto jt = unsafeTxids.begin(); jt != unsafeTxids.end(); ) {
+        const auto& txid = *jt;
+        int64_t txAge = 0;
+        auto kt = txFirstSeenTime.find(txid);
+        if (kt != txFirstSeenTime.end()) {
+            txAge = GetAdjustedTime() - kt->second;
         }
+
+        if (txAge < WAIT_FOR_ISLOCK_TIMEOUT && !quorumInstantSendManager->IsLocked(txid)) {
+            LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- not signing block %s due to TX %s not being islocked and not old enough. age=%d\n", __func__,
+                      pindex->GetBlockHash().ToString(), txid.ToString(), txAge);
+            return false;
+        }
+
+        // once safe, a TX stays safe
+        jt = unsafeTxids.erase(jt);
     }
-    return ret;
+    return true;
 }
 
 bool CChainLocksHandler::IsTxSafeForMining(const uint256& txid)
@@ -596,7 +700,8 @@ void CChainLocksHandler::HandleNewRecoveredSig(const llmq::CRecoveredSig& recove
 
         clsig.nHeight = lastSignedHeight;
         clsig.blockHash = lastSignedMsgHash;
-        clsig.sig = recoveredSig.sig.Get();
+        clsig.sig = recoveredSig.sig;
+        TRACE2(chainlocks, clsig_created, clsig.blockHash.begin(), clsig.nHeight);
     }
     ProcessNewChainLock(-1, clsig, ::SerializeHash(clsig));
 }
@@ -607,6 +712,12 @@ bool CChainLocksHandler::HasChainLock(int nHeight, const uint256& blockHash)
     return InternalHasChainLock(nHeight, blockHash);
 }
 
+bool CChainLocksHandler::HasChainLockAtDepth(int nHeight, const uint256& blockHash, int nMinDepth)
+{
+    LOCK(cs);
+    return InternalHasChainLock(nHeight, blockHash) && bestChainLockBlockIndex->nHeight - nHeight >= nMinDepth;
+}
+
 bool CChainLocksHandler::InternalHasChainLock(int nHeight, const uint256& blockHash)
 {
     AssertLockHeld(cs);
@@ -673,33 +784,30 @@ void CChainLocksHandler::Cleanup()
         if (GetTimeMillis() - lastCleanupTime < CLEANUP_INTERVAL) {
             return;
         }
+
+        for (auto it = seenChainLocks.begin(); it != seenChainLocks.end(); ) {
+            if (GetTimeMillis() - it->second >= CLEANUP_SEEN_TIMEOUT) {
+                it = seenChainLocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // blockTxs is already evicted on every new ChainLock and block, nothing to do here besides reporting
+        statsClient.gauge("chainlocks.blockTxs", blockTxs.size(), 1.0f);
+        statsClient.gauge("chainlocks.blockTxsTxCount", blockTxsTxCount, 1.0f);
+        statsClient.gauge("chainlocks.txFirstSeenTime", txFirstSeenTime.size(), 1.0f);
+
+        lastCleanupTime = GetTimeMillis();
+        if (GetTimeMillis() - lastTxsCleanupTime < CLEANUP_TXS_INTERVAL) {
+            return;
+        }
     }
 
     // need mempool.cs due to GetTransaction calls
     LOCK2(cs_main, mempool.cs);
     LOCK(cs);
 
-    for (auto it = seenChainLocks.begin(); it != seenChainLocks.end(); ) {
-        if (GetTimeMillis() - it->second >= CLEANUP_SEEN_TIMEOUT) {
-            it = seenChainLocks.erase(it);
-        } else {
-            ++it;
-        }
-    }
-
-    for (auto it = blockTxs.begin(); it != blockTxs.end(); ) {
-        auto pindex = LookupBlockIndex(it->first);
-        if (InternalHasChainLock(pindex->nHeight, pindex->GetBlockHash())) {
-            for (auto& txid : *it->second) {
-                txFirstSeenTime.erase(txid);
-            }
-            it = blockTxs.erase(it);
-        } else if (InternalHasConflictingChainLock(pindex->nHeight, pindex->GetBlockHash())) {
-            it = blockTxs.erase(it);
-        } else {
-            ++it;
-        }
-    }
     for (auto it = txFirstSeenTime.begin(); it != txFirstSeenTime.end(); ) {
         CTransactionRef tx;
         uint256 hashBlock;
@@ -708,7 +816,7 @@ void CChainLocksHandler::Cleanup()
             it = txFirstSeenTime.erase(it);
         } else if (!hashBlock.IsNull()) {
             auto pindex = LookupBlockIndex(hashBlock);
-            if (chainActive.Tip()->GetAncestor(pindex->nHeight) == pindex && chainActive.Height() - pindex->nHeight >= 6) {
+            if (chainActive.Tip()->GetAncestor(pindex->nHeight) == pindex && chainActive.Height() - pindex->nHeight >= MAX_BLOCKTXS_DEPTH) {
                 // tx got confirmed >= 6 times, so we can stop keeping track of it
                 it = txFirstSeenTime.erase(it);
             } else {
@@ -719,7 +827,7 @@ void CChainLocksHandler::Cleanup()
         }
     }
 
-    lastCleanupTime = GetTimeMillis();
+    lastTxsCleanupTime = GetTimeMillis();
 }
 
 bool AreChainLocksEnabled()
@@ -8,6 +8,7 @@
 #include <llmq/quorums_signing.h>
 
 #include <chainparams.h>
+#include <validationinterface.h>
 
 #include <atomic>
 #include <unordered_set>
@@ -27,7 +28,8 @@ class CChainLockSig
 public:
     int32_t nHeight{-1};
     uint256 blockHash;
-    CBLSSignature sig;
+    // lazy, so that duplicate CLSIGs received from multiple peers are dropped without decoding the signature
+    CBLSLazySignature sig;
 
 public:
     SERIALIZE_METHODS(CChainLockSig, obj)
@@ -43,6 +45,12 @@ class CChainLocksHandler : public CRecoveredSigsListener
 {
     static const int64_t CLEANUP_INTERVAL = 1000 * 30;
     static const int64_t CLEANUP_SEEN_TIMEOUT = 24 * 60 * 60 * 1000;
+    // TXs are normally forgotten when they leave the mempool or when their block is evicted from blockTxs. This less
+    // frequent sweep only catches TXs which vanished without us being notified, e.g. due to reorgs
+    static const int64_t CLEANUP_TXS_INTERVAL = 1000 * 60 * 10;
+
+    // TrySignChainTip only looks at the last few blocks, so there is no need to track TXs of deeper blocks
+    static const int MAX_BLOCKTXS_DEPTH = 6;
 
     // how long to wait for islocks until we consider a block with non-islocked TXs to be safe to sign
     static const int64_t WAIT_FOR_ISLOCK_TIMEOUT = 10 * 60;
@@ -62,18 +70,30 @@ private:
     const CBlockIndex* bestChainLockBlockIndex GUARDED_BY(cs) {nullptr};
     const CBlockIndex* lastNotifyChainLockBlockIndex GUARDED_BY(cs) {nullptr};
 
+    // the latest tip and when it was connected, for the CLSIG latency stats
+    uint256 lastTipHash GUARDED_BY(cs);
+    int64_t lastTipTime GUARDED_BY(cs) {0};
+
     int32_t lastSignedHeight GUARDED_BY(cs) {-1};
     uint256 lastSignedRequestId GUARDED_BY(cs);
     uint256 lastSignedMsgHash GUARDED_BY(cs);
 
-    // We keep track of txids from recently received blocks so that we can check if all TXs got islocked
-    typedef std::unordered_map<uint256, std::shared_ptr<std::unordered_set<uint256, StaticSaltedHasher>>> BlockTxs;
-    BlockTxs blockTxs GUARDED_BY(cs);
-    std::unordered_map<uint256, int64_t> txFirstSeenTime GUARDED_BY(cs);
+    // We keep track of txids from recently received blocks so that we can check if all TXs got islocked. Entries are
+    // ordered by height and evicted (together with the first seen times of their TXs) as soon as they are ChainLocked
+    // or more than MAX_BLOCKTXS_DEPTH blocks deep, so that memory usage does not depend on how often Cleanup() runs
+    typedef std::shared_ptr<const std::vector<uint256>> BlockTxids;
+    std::map<std::pair<int, uint256>, BlockTxids> blockTxs GUARDED_BY(cs);
+    size_t blockTxsTxCount GUARDED_BY(cs) {0};
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> txFirstSeenTime GUARDED_BY(cs);
+    // For each entry in blockTxs, the TXs which were neither islocked nor old enough when we last checked. TXs are removed
+    // as soon as they become safe, so that TrySignChainTip doesn't have to check all TXs of the last blocks again and
+    // again on every new tip
+    std::unordered_map<uint256, std::unordered_set<uint256, StaticSaltedHasher>, StaticSaltedHasher> unsafeBlockTxs GUARDED_BY(cs);
 
     std::map<uint256, int64_t> seenChainLocks GUARDED_BY(cs);
 
     int64_t lastCleanupTime GUARDED_BY(cs) {0};
+    int64_t lastTxsCleanupTime GUARDED_BY(cs) {0};
 
 public:
     explicit CChainLocksHandler();
@@ -90,15 +110,19 @@ public:
     void ProcessNewChainLock(NodeId from, const CChainLockSig& clsig, const uint256& hash);
     void AcceptedBlockHeader(const CBlockIndex* pindexNew);
     void UpdatedBlockTip(const CBlockIndex* pindexNew);
-    void TransactionAddedToMempool(const CTransactionRef& tx, int64_t nAcceptTime);
+    void TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx);
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted);
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected);
+    void NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks);
     void CheckActiveState();
     void TrySignChainTip();
     void EnforceBestChainLock();
     virtual void HandleNewRecoveredSig(const CRecoveredSig& recoveredSig);
 
     bool HasChainLock(int nHeight, const uint256& blockHash);
+    // Same as HasChainLock, but the ChainLocked block must also be at least nMinDepth blocks above the given one
+    bool HasChainLockAtDepth(int nHeight, const uint256& blockHash, int nMinDepth);
     bool HasConflictingChainLock(int nHeight, const uint256& blockHash);
 
     bool IsTxSafeForMining(const uint256& txid);
@@ -108,7 +132,12 @@ private:
     bool InternalHasChainLock(int nHeight, const uint256& blockHash);
     bool InternalHasConflictingChainLock(int nHeight, const uint256& blockHash);
 
-    BlockTxs::mapped_type GetBlockTxs(const uint256& blockHash);
+    BlockTxids GetBlockTxs(const CBlockIndex* pindex);
+    void AddBlockTxs(const CBlockIndex* pindex, const BlockTxids& txids, int64_t firstSeenTime);
+    void EvictBlockTxs(int nHeight);
+    bool IsBlockSafeToSign(const CBlockIndex* pindex);
+
+    void ScheduleTrySignChainTip();
 
     void Cleanup();
 };
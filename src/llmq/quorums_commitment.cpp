@@ -7,6 +7,7 @@
 #include <evo/deterministicmns.h>
 #include <evo/specialtx.h>
 
+#include <bls/bls_sigcache.h>
 #include <chainparams.h>
 #include <logging.h>
 #include <validation.h>
@@ -80,31 +81,87 @@ bool CFinalCommitment::Verify(const CBlockIndex* pQuorumIndex, bool checkSigs) c
     }
 
     // sigs are only checked when the block is processed
-    if (checkSigs) {
-        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(llmq_params.type, quorumHash, validMembers, quorumPublicKey, quorumVvecHash);
+    if (checkSigs && !VerifySigs(members)) {
+        return false;
+    }
 
-        std::vector<CBLSPublicKey> memberPubKeys;
-        for (size_t i = 0; i < members.size(); i++) {
-            if (!signers[i]) {
-                continue;
-            }
-            memberPubKeys.emplace_back(members[i]->pdmnState->pubKeyOperator.Get());
-        }
+    return true;
+}
 
-        if (!membersSig.VerifySecureAggregated(memberPubKeys, commitmentHash)) {
-            LogPrintfFinalCommitment("invalid aggregated members signature\n");
-            return false;
-        }
+bool CFinalCommitment::VerifySigs(const std::vector<CDeterministicMNCPtr>& members) const
+{
+    return VerifyMembersSig(members) && VerifyQuorumSig();
+}
 
-        if (!quorumSig.VerifyInsecure(quorumPublicKey, commitmentHash)) {
-            LogPrintfFinalCommitment("invalid quorum signature\n");
-            return false;
+bool CFinalCommitment::VerifyMembersSig(const std::vector<CDeterministicMNCPtr>& members) const
+{
+    uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(llmqType, quorumHash, validMembers, quorumPublicKey, quorumVvecHash);
+
+    // members usually come from the quorum members cache, so the operator keys were already deserialized before
+    std::vector<CBLSPublicKey> memberPubKeys;
+    memberPubKeys.reserve(CountSigners());
+    for (size_t i = 0; i < members.size() && i < signers.size(); i++) {
+        if (!signers[i]) {
+            continue;
         }
+        memberPubKeys.emplace_back(members[i]->pdmnState->pubKeyOperator.Get());
+    }
+
+    if (!membersSig.VerifySecureAggregated(memberPubKeys, commitmentHash)) {
+        LogPrintfFinalCommitment("invalid aggregated members signature\n");
+        return false;
     }
+    return true;
+}
 
+bool CFinalCommitment::VerifyQuorumSig() const
+{
+    uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(llmqType, quorumHash, validMembers, quorumPublicKey, quorumVvecHash);
+    if (!VerifyBLSSigCached(quorumSig, quorumPublicKey, commitmentHash)) {
+        LogPrintfFinalCommitment("invalid quorum signature\n");
+        return false;
+    }
     return true;
 }
 
+bool CFinalCommitment::VerifyQuorumSigs(const std::vector<const CFinalCommitment*>& qcs, std::vector<bool>& vValidRet)
+{
+    vValidRet.assign(qcs.size(), true);
+
+    std::vector<size_t> vIdx;
+    std::vector<CBLSSignature> vSigs;
+    std::vector<CBLSPublicKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    for (size_t i = 0; i < qcs.size(); i++) {
+        const auto& qc = *qcs[i];
+        if (!qc.quorumSig.IsValid() || !qc.quorumPublicKey.IsValid()) {
+            vValidRet[i] = false;
+            continue;
+        }
+        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(qc.llmqType, qc.quorumHash, qc.validMembers, qc.quorumPublicKey, qc.quorumVvecHash);
+        if (CBLSSigCacheEntry(qc.quorumPublicKey, commitmentHash, qc.quorumSig).IsCached()) {
+            continue;
+        }
+        vIdx.emplace_back(i);
+        vSigs.emplace_back(qc.quorumSig);
+        vPubKeys.emplace_back(qc.quorumPublicKey);
+        vHashes.emplace_back(commitmentHash);
+    }
+
+    // Each signature is weighted randomly inside the batch, so invalid ones can't cancel each other out
+    if (!vIdx.empty()) {
+        bool fAllValid = CBLSSignature::VerifyBatch(vSigs, vPubKeys, vHashes);
+        for (size_t j = 0; j < vIdx.size(); j++) {
+            if (fAllValid) {
+                CBLSSigCacheEntry(vPubKeys[j], vHashes[j], vSigs[j]).Add();
+            } else if (!qcs[vIdx[j]]->VerifyQuorumSig()) {
+                vValidRet[vIdx[j]] = false;
+            }
+        }
+    }
+    return std::find(vValidRet.begin(), vValidRet.end(), false) == vValidRet.end();
+}
+
 bool CFinalCommitment::VerifyNull() const
 {
     if (!Params().GetConsensus().llmqs.count(llmqType)) {
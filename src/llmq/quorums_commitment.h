@@ -50,6 +50,13 @@ public:
     }
 
     bool Verify(const CBlockIndex* pQuorumIndex, bool checkSigs) const;
+    // only checks the members and quorum signatures, members must be the result of GetAllQuorumMembers
+    bool VerifySigs(const std::vector<CDeterministicMNCPtr>& members) const;
+    bool VerifyMembersSig(const std::vector<CDeterministicMNCPtr>& members) const;
+    bool VerifyQuorumSig() const;
+    // Verifies the quorum signatures of multiple commitments in one weighted batch and only falls back to checking
+    // them individually if that fails. Returns false if any of them is invalid, vValidRet then tells which ones.
+    static bool VerifyQuorumSigs(const std::vector<const CFinalCommitment*>& qcs, std::vector<bool>& vValidRet);
     bool VerifyNull() const;
     bool VerifySizes(const Consensus::LLMQParams& params) const;
 
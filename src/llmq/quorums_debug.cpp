@@ -46,6 +46,16 @@ UniValue CDKGDebugSessionStatus::ToJson(int detailLevel) const
     ret.pushKV("sentPrematureCommitment", sentPrematureCommitment);
     ret.pushKV("aborted", aborted);
 
+    UniValue phaseTimesJson(UniValue::VOBJ);
+    for (const auto& p : phaseTimes) {
+        phaseTimesJson.pushKV(std::to_string(p.first), p.second);
+    }
+    ret.pushKV("phaseTimes", phaseTimesJson);
+    ret.pushKV("verifiedContributions", (int)verifiedContributions);
+    ret.pushKV("contributionsVerifyTime", contributionsVerifyTime);
+    ret.pushKV("finalCommitments", (int)finalCommitments);
+    ret.pushKV("finalizeTime", finalizeTime);
+
     struct ArrOrCount {
         int count{0};
         UniValue arr{UniValue::VARR};
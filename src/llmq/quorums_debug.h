@@ -10,6 +10,7 @@
 #include <univalue.h>
 
 #include <functional>
+#include <map>
 #include <set>
 
 class CDataStream;
@@ -69,6 +70,15 @@ public:
 
     std::vector<CDKGDebugMemberStatus> members;
 
+    // time spent in the processing part of each phase (e.g. VerifyAndComplain), in milliseconds
+    std::map<uint8_t, int64_t> phaseTimes;
+    // number of contributions verified against our id and the total time spent for it
+    uint32_t verifiedContributions{0};
+    int64_t contributionsVerifyTime{0};
+    // number of final commitments built at the end of the session and the time it took, in milliseconds
+    uint32_t finalCommitments{0};
+    int64_t finalizeTime{0};
+
 public:
     CDKGDebugSessionStatus() : statusBitset(0) {}
 
@@ -148,13 +148,19 @@ void CDKGSession::Contribute(CDKGPendingMessages& pendingMessages)
     }
 
     cxxtimer::Timer t1(true);
-    logger.Batch("generating contributions");
-    if (!blsWorker.GenerateContributions(params.threshold, memberIds, vvecContribution, skContributions)) {
-        // this should never happen actually
-        logger.Batch("GenerateContributions failed");
-        return;
+    if (dkgManager.GetCheckpointContributions(params.type, pindexQuorum, vvecContribution, skContributions)) {
+        // we must not generate new contributions when resuming, as other members might have received the old ones
+        logger.Batch("restored contributions from checkpoint");
+    } else {
+        logger.Batch("generating contributions");
+        if (!blsWorker.GenerateContributions(params.threshold, memberIds, vvecContribution, skContributions)) {
+            // this should never happen actually
+            logger.Batch("GenerateContributions failed");
+            return;
+        }
+        logger.Batch("generated contributions. time=%d", t1.count());
+        dkgManager.WriteCheckpointContributions(params.type, pindexQuorum, vvecContribution, skContributions);
     }
-    logger.Batch("generated contributions. time=%d", t1.count());
 
     SendContributions(pendingMessages);
 }
@@ -165,6 +171,11 @@ void CDKGSession::SendContributions(CDKGPendingMessages& pendingMessages)
 
     assert(AreWeMember());
 
+    if (resumedOwnMessages.count(MSG_QUORUM_CONTRIB)) {
+        logger.Batch("already sent before restart");
+        return;
+    }
+
     logger.Batch("sending contributions");
 
     if (ShouldSimulateError("contribution-omit")) {
@@ -180,21 +191,23 @@ void CDKGSession::SendContributions(CDKGPendingMessages& pendingMessages)
 
     cxxtimer::Timer t1(true);
     qc.contributions = std::make_shared<CBLSIESMultiRecipientObjects<CBLSSecretKey>>();
-    qc.contributions->InitEncrypt(members.size());
 
+    std::vector<CBLSPublicKey> recipients;
+    BLSSecretKeyVector skContribs = skContributions;
+    recipients.reserve(members.size());
     for (size_t i = 0; i < members.size(); i++) {
         const auto& m = members[i];
-        CBLSSecretKey skContrib = skContributions[i];
+        recipients.emplace_back(m->dmn->pdmnState->pubKeyOperator.Get());
 
         if (i != myIdx && ShouldSimulateError("contribution-lie")) {
             logger.Batch("lying for %s", m->dmn->proTxHash.ToString());
-            skContrib.MakeNewKey();
+            skContribs[i].MakeNewKey();
         }
+    }
 
-        if (!qc.contributions->Encrypt(i, m->dmn->pdmnState->pubKeyOperator.Get(), skContrib, PROTOCOL_VERSION)) {
-            logger.Batch("failed to encrypt contribution for %s", m->dmn->proTxHash.ToString());
-            return;
-        }
+    if (!blsWorker.EncryptContributionShares(recipients, skContribs, *qc.contributions, PROTOCOL_VERSION)) {
+        logger.Batch("failed to encrypt contributions");
+        return;
     }
 
     logger.Batch("encrypted contributions. time=%d", t1.count());
@@ -324,7 +337,14 @@ void CDKGSession::ReceiveMessage(const CDKGContribution& qc, bool& retBan)
 
     bool complain = false;
     CBLSSecretKey skContribution;
-    if (!qc.contributions->Decrypt(myIdx, *activeMasternodeInfo.blsKeyOperator, skContribution, PROTOCOL_VERSION)) {
+    auto itDecrypted = decryptedContributionShares.find(qc.contributions);
+    if (itDecrypted != decryptedContributionShares.end()) {
+        skContribution = itDecrypted->second;
+        decryptedContributionShares.erase(itDecrypted);
+    } else if (!qc.contributions->Decrypt(myIdx, *activeMasternodeInfo.blsKeyOperator, skContribution, PROTOCOL_VERSION)) {
+        skContribution = CBLSSecretKey();
+    }
+    if (!skContribution.IsValid()) {
         logger.Batch("contribution from %s could not be decrypted", member->dmn->proTxHash.ToString());
         complain = true;
     } else if (member->idx != myIdx && ShouldSimulateError("complain-lie")) {
@@ -356,6 +376,29 @@ void CDKGSession::ReceiveMessage(const CDKGContribution& qc, bool& retBan)
     }
 }
 
+void CDKGSession::WriteCheckpointMessage(int msgType, const CDataStream& msg)
+{
+    if (!AreWeMember()) {
+        return;
+    }
+    dkgManager.WriteCheckpointMessage(params.type, pindexQuorum, msgType, msg);
+}
+
+void CDKGSession::DecryptContributions(const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& encrypted)
+{
+    // entries left over from the previous batch belong to messages which were rejected before being decrypted
+    decryptedContributionShares.clear();
+
+    if (!AreWeMember()) {
+        return;
+    }
+
+    auto skShares = blsWorker.DecryptContributionShares(encrypted, myIdx, *activeMasternodeInfo.blsKeyOperator, PROTOCOL_VERSION);
+    for (size_t i = 0; i < encrypted.size(); i++) {
+        decryptedContributionShares.emplace(encrypted[i], skShares[i]);
+    }
+}
+
 // Verifies all pending secret key contributions in one batch
 // This is done by aggregating the verification vectors belonging to the secret key contributions
 // The resulting aggregated vvec is then used to recover a public key share
@@ -412,7 +455,14 @@ void CDKGSession::VerifyPendingContributions()
         }
     }
 
-    logger.Batch("verified %d pending contributions. time=%d", pend.size(), t1.count());
+    int64_t verifyTime = t1.count();
+    quorumDKGDebugManager->UpdateLocalSessionStatus(params.type, [&](CDKGDebugSessionStatus& status) {
+        status.verifiedContributions += memberIndexes.size();
+        status.contributionsVerifyTime += verifyTime;
+        return true;
+    });
+
+    logger.Batch("verified %d pending contributions. time=%d", pend.size(), verifyTime);
 }
 
 void CDKGSession::VerifyAndComplain(CDKGPendingMessages& pendingMessages)
@@ -501,6 +551,11 @@ void CDKGSession::SendComplaint(CDKGPendingMessages& pendingMessages)
 
     assert(AreWeMember());
 
+    if (resumedOwnMessages.count(MSG_QUORUM_COMPLAINT)) {
+        logger.Batch("already sent before restart");
+        return;
+    }
+
     CDKGComplaint qc(params);
     qc.llmqType = params.type;
     qc.quorumHash = pindexQuorum->GetBlockHash();
@@ -695,6 +750,11 @@ void CDKGSession::SendJustification(CDKGPendingMessages& pendingMessages, const
 
     assert(AreWeMember());
 
+    if (resumedOwnMessages.count(MSG_QUORUM_JUSTIFICATION)) {
+        logger.Batch("already sent before restart");
+        return;
+    }
+
     logger.Batch("sending justification for %d members", forMembers.size());
 
     CDKGJustification qj;
@@ -951,6 +1011,11 @@ void CDKGSession::SendCommitment(CDKGPendingMessages& pendingMessages)
 
     assert(AreWeMember());
 
+    if (resumedOwnMessages.count(MSG_QUORUM_PREMATURE_COMMITMENT)) {
+        logger.Batch("already sent before restart");
+        return;
+    }
+
     logger.Batch("sending commitment");
 
     CDKGPrematureCommitment qc(params);
@@ -1182,6 +1247,9 @@ void CDKGSession::ReceiveMessage(const CDKGPrematureCommitment& qc, bool& retBan
 
     LOCK(invCs);
     validCommitments.emplace(hash);
+    if (quorumVvec != nullptr) {
+        verifiedQuorumSigShares.emplace(hash);
+    }
 
     CInv inv(MSG_QUORUM_PREMATURE_COMMITMENT, hash);
     RelayInvToParticipants(inv);
@@ -1211,8 +1279,13 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
 
     CDKGLogger logger(*this, __func__);
 
-    typedef std::vector<bool> Key;
+    cxxtimer::Timer totalTimer(true);
+
+    // commitments only agree on the signed hash if validMembers, quorumPublicKey and quorumVvecHash match. The public
+    // key is derived from the vvec, so it is only compared within the group
+    typedef std::pair<std::vector<bool>, uint256> Key;
     std::map<Key, std::vector<CDKGPrematureCommitment>> commitmentsMap;
+    std::map<Key, bool> allSharesVerifiedMap;
 
     {
         LOCK(invCs);
@@ -1226,16 +1299,31 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
             // should have been verified before
             assert(qc.CountValidMembers() >= params.minSize);
 
-            auto it = commitmentsMap.find(qc.validMembers);
-            if (it == commitmentsMap.end()) {
-                it = commitmentsMap.emplace(qc.validMembers, std::vector<CDKGPrematureCommitment>()).first;
-            }
-
-            it->second.emplace_back(qc);
+            Key key(qc.validMembers, qc.quorumVvecHash);
+            commitmentsMap[key].emplace_back(qc);
+            auto it = allSharesVerifiedMap.emplace(key, true).first;
+            it->second &= verifiedQuorumSigShares.count(p.first) != 0;
         }
     }
 
-    std::vector<CFinalCommitment> finalCommitments;
+    struct Group {
+        CFinalCommitment fqc;
+        uint256 commitmentHash;
+        std::vector<CBLSSignature> aggSigs;
+        std::vector<CBLSPublicKey> aggPks;
+        std::vector<CBLSId> signerIds;
+        std::vector<CBLSSignature> thresholdSigs;
+        // all member sigs were batch verified before ReceiveMessage. If all quorumSig shares were verified as well,
+        // the aggregated and recovered sigs are valid by construction and don't need to be verified again
+        bool allSharesVerified{false};
+        bool recovered{false};
+        bool sigsValid{false};
+        int64_t aggTime{0};
+        int64_t recoverTime{0};
+        int64_t verifyTime{0};
+    };
+    std::vector<Group> groups;
+
     for (const auto& p : commitmentsMap) {
         auto& cvec = p.second;
         if (cvec.size() < params.minSize) {
@@ -1243,65 +1331,101 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
             continue;
         }
 
-        std::vector<CBLSId> signerIds;
-        std::vector<CBLSSignature> thresholdSigs;
-
         auto& first = cvec[0];
 
-        CFinalCommitment fqc(params, first.quorumHash);
-        fqc.validMembers = first.validMembers;
-        fqc.quorumPublicKey = first.quorumPublicKey;
-        fqc.quorumVvecHash = first.quorumVvecHash;
+        groups.emplace_back();
+        auto& g = groups.back();
+        g.fqc = CFinalCommitment(params, first.quorumHash);
+        g.fqc.validMembers = first.validMembers;
+        g.fqc.quorumPublicKey = first.quorumPublicKey;
+        g.fqc.quorumVvecHash = first.quorumVvecHash;
+        g.commitmentHash = CLLMQUtils::BuildCommitmentHash(g.fqc.llmqType, g.fqc.quorumHash, g.fqc.validMembers, g.fqc.quorumPublicKey, g.fqc.quorumVvecHash);
+        g.allSharesVerified = allSharesVerifiedMap.at(p.first);
 
-        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(fqc.llmqType, fqc.quorumHash, fqc.validMembers, fqc.quorumPublicKey, fqc.quorumVvecHash);
-
-        std::vector<CBLSSignature> aggSigs;
-        std::vector<CBLSPublicKey> aggPks;
-        aggSigs.reserve(cvec.size());
-        aggPks.reserve(cvec.size());
+        g.aggSigs.reserve(cvec.size());
+        g.aggPks.reserve(cvec.size());
+        g.signerIds.reserve(cvec.size());
+        g.thresholdSigs.reserve(cvec.size());
 
         for (const auto& qc : cvec) {
-            if (qc.quorumPublicKey != first.quorumPublicKey || qc.quorumVvecHash != first.quorumVvecHash) {
-                logger.Batch("quorumPublicKey or quorumVvecHash does not match, skipping");
+            if (qc.quorumPublicKey != first.quorumPublicKey) {
+                logger.Batch("quorumPublicKey does not match, skipping");
                 continue;
             }
 
             size_t signerIndex = membersMap[qc.proTxHash];
             const auto& m = members[signerIndex];
 
-            fqc.signers[signerIndex] = true;
-            aggSigs.emplace_back(qc.sig);
-            aggPks.emplace_back(m->dmn->pdmnState->pubKeyOperator.Get());
+            g.fqc.signers[signerIndex] = true;
+            g.aggSigs.emplace_back(qc.sig);
+            g.aggPks.emplace_back(m->dmn->pdmnState->pubKeyOperator.Get());
 
-            signerIds.emplace_back(m->id);
-            thresholdSigs.emplace_back(qc.quorumSig);
+            g.signerIds.emplace_back(m->id);
+            g.thresholdSigs.emplace_back(qc.quorumSig);
         }
+    }
 
-        cxxtimer::Timer t1(true);
-        fqc.membersSig = CBLSSignature::AggregateSecure(aggSigs, aggPks, commitmentHash);
-        t1.stop();
+    // aggregation and recovery of all groups run in parallel on the BLS workers
+    std::vector<std::function<void()>> jobs;
+    for (auto& g : groups) {
+        jobs.emplace_back([&g]() {
+            cxxtimer::Timer t(true);
+            g.fqc.membersSig = CBLSSignature::AggregateSecure(g.aggSigs, g.aggPks, g.commitmentHash);
+            g.aggTime = t.count();
+        });
+        jobs.emplace_back([&g]() {
+            cxxtimer::Timer t(true);
+            g.recovered = g.fqc.quorumSig.Recover(g.thresholdSigs, g.signerIds);
+            g.recoverTime = t.count();
+        });
+    }
+    blsWorker.RunJobs(jobs);
 
-        cxxtimer::Timer t2(true);
-        if (!fqc.quorumSig.Recover(thresholdSigs, signerIds)) {
-            logger.Batch("failed to recover quorum sig");
+    jobs.clear();
+    std::vector<CDeterministicMNCPtr> dmnMembers;
+    for (auto& g : groups) {
+        if (!g.recovered || g.allSharesVerified) {
+            g.sigsValid = g.recovered;
             continue;
         }
-        t2.stop();
+        if (dmnMembers.empty()) {
+            dmnMembers = CLLMQUtils::GetAllQuorumMembers(params.type, pindexQuorum);
+        }
+        jobs.emplace_back([&g, &dmnMembers]() {
+            cxxtimer::Timer t(true);
+            g.sigsValid = g.fqc.VerifySigs(dmnMembers);
+            g.verifyTime = t.count();
+        });
+    }
+    blsWorker.RunJobs(jobs);
 
-        cxxtimer::Timer t3(true);
-        if (!fqc.Verify(pindexQuorum, true)) {
+    std::vector<CFinalCommitment> finalCommitments;
+    for (const auto& g : groups) {
+        if (!g.recovered) {
+            logger.Batch("failed to recover quorum sig");
+            continue;
+        }
+        if (!g.sigsValid || !g.fqc.Verify(pindexQuorum, false)) {
             logger.Batch("failed to verify final commitment");
             continue;
         }
-        t3.stop();
 
-        finalCommitments.emplace_back(fqc);
+        finalCommitments.emplace_back(g.fqc);
 
-        logger.Batch("final commitment: validMembers=%d, signers=%d, quorumPublicKey=%s, time1=%d, time2=%d, time3=%d",
-                        fqc.CountValidMembers(), fqc.CountSigners(), fqc.quorumPublicKey.ToString(),
-                        t1.count(), t2.count(), t3.count());
+        logger.Batch("final commitment: validMembers=%d, signers=%d, quorumPublicKey=%s, sharesVerified=%d, time1=%d, time2=%d, time3=%d",
+                        g.fqc.CountValidMembers(), g.fqc.CountSigners(), g.fqc.quorumPublicKey.ToString(), g.allSharesVerified,
+                        g.aggTime, g.recoverTime, g.verifyTime);
     }
 
+    totalTimer.stop();
+    int64_t finalizeTime = totalTimer.count();
+    quorumDKGDebugManager->UpdateLocalSessionStatus(params.type, [&](CDKGDebugSessionStatus& status) {
+        status.finalCommitments = finalCommitments.size();
+        status.finalizeTime = finalizeTime;
+        return true;
+    });
+
+    logger.Batch("finalized %d commitments. time=%d", finalCommitments.size(), finalizeTime);
     logger.Flush();
 
     return finalCommitments;
@@ -251,6 +251,9 @@ private:
     BLSSecretKeyVector receivedSkContributions;
     /// Contains the received unverified/encrypted DKG contributions
     std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>> vecEncryptedContributions;
+    /// Our shares of the contributions in the current message batch, see DecryptContributions. Only accessed by the
+    /// phase handler thread
+    std::map<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>, CBLSSecretKey> decryptedContributionShares;
 
     uint256 myProTxHash;
     CBLSId myId;
@@ -269,8 +272,14 @@ private:
     mutable CCriticalSection cs_pending;
     std::vector<size_t> pendingContributionVerifications GUARDED_BY(cs_pending);
 
+    // inv types of our own messages which were restored from a checkpoint after a restart. These must not be sent
+    // again, as a second (different) message would make us a bad member
+    std::set<int> resumedOwnMessages;
+
     // filled by ReceivePrematureCommitment and used by FinalizeCommitments
     std::set<uint256> validCommitments GUARDED_BY(invCs);
+    // the valid commitments for which the quorumSig share was verified against the quorum vvec as well
+    std::set<uint256> verifiedQuorumSigShares GUARDED_BY(invCs);
 
 public:
     CDKGSession(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager) :
@@ -293,11 +302,16 @@ public:
      *    responsible for further verification of validity (e.g. validate vvecs and SK contributions).
      */
 
+    // Called for every message after ReceiveMessage, so that the round can be resumed after a restart
+    void WriteCheckpointMessage(int msgType, const CDataStream& msg);
+
     // Phase 1: contribution
     void Contribute(CDKGPendingMessages& pendingMessages);
     void SendContributions(CDKGPendingMessages& pendingMessages);
     bool PreVerifyMessage(const CDKGContribution& qc, bool& retBan) const;
     void ReceiveMessage(const CDKGContribution& qc, bool& retBan);
+    // Decrypts our shares of all contributions of a message batch in parallel, before ReceiveMessage is called for them
+    void DecryptContributions(const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& encrypted);
     void VerifyPendingContributions();
 
     // Phase 2: complaint
@@ -6,6 +6,7 @@
 
 #include <llmq/quorums_commitment.h>
 #include <llmq/quorums_dkgsession.h>
+#include <llmq/quorums_dkgsessionmgr.h>
 #include <llmq/quorums_blockprocessor.h>
 #include <llmq/quorums_debug.h>
 #include <llmq/quorums_utils.h>
@@ -16,6 +17,8 @@
 #include <chainparams.h>
 #include <net_processing.h>
 #include <spork.h>
+#include <statsd_client.h>
+#include <util/trace.h>
 
 namespace llmq
 {
@@ -26,15 +29,20 @@ CDKGPendingMessages::CDKGPendingMessages(size_t _maxMessagesPerNode, int _invTyp
 {
 }
 
-void CDKGPendingMessages::PushPendingMessage(NodeId from, CDataStream& vRecv)
+void CDKGPendingMessages::PushPendingMessage(NodeId from, CDataStream& vRecv, std::shared_ptr<void> msg)
 {
-    // this will also consume the data, even if we bail out early
-    auto pm = std::make_shared<CDataStream>(std::move(vRecv));
-
     CHashWriter hw(SER_GETHASH, 0);
-    hw.write(pm->data(), pm->size());
+    hw.write(vRecv.data(), vRecv.size());
     uint256 hash = hw.GetHash();
 
+    // this will also consume the data, even if we bail out early
+    PendingMessage pm{from, nullptr, std::move(msg)};
+    if (!pm.msg) {
+        pm.data = std::make_shared<CDataStream>(std::move(vRecv));
+    } else {
+        vRecv.clear();
+    }
+
     if (from != -1) {
         LOCK(cs_main);
         EraseObjectRequest(from, CInv(invType, hash));
@@ -54,14 +62,14 @@ void CDKGPendingMessages::PushPendingMessage(NodeId from, CDataStream& vRecv)
         return;
     }
 
-    pendingMessages.emplace_back(std::make_pair(from, std::move(pm)));
+    pendingMessages.emplace_back(std::move(pm));
 }
 
-std::list<CDKGPendingMessages::BinaryMessage> CDKGPendingMessages::PopPendingMessages(size_t maxCount)
+std::list<CDKGPendingMessages::PendingMessage> CDKGPendingMessages::PopPendingMessages(size_t maxCount)
 {
     LOCK(cs);
 
-    std::list<BinaryMessage> ret;
+    std::list<PendingMessage> ret;
     while (!pendingMessages.empty() && ret.size() < maxCount) {
         ret.emplace_back(std::move(pendingMessages.front()));
         pendingMessages.pop_front();
@@ -116,9 +124,13 @@ void CDKGSessionHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
     bool fNewPhase = (quorumStageInt % params.dkgPhaseBlocks) == 0;
     int phaseInt = quorumStageInt / params.dkgPhaseBlocks + 1;
     QuorumPhase oldPhase = phase;
-    if (fNewPhase && phaseInt >= QuorumPhase_Initialized && phaseInt <= QuorumPhase_Idle) {
+    // when freshly started, take the phase we are in right away so that an interrupted round can be resumed
+    if ((fNewPhase || oldPhase == QuorumPhase_None) && phaseInt >= QuorumPhase_Initialized && phaseInt <= QuorumPhase_Idle) {
         phase = static_cast<QuorumPhase>(phaseInt);
     }
+    if (phase != oldPhase) {
+        TRACE4(dkg, phase_changed, params.type, currentHeight, oldPhase, phase);
+    }
 
     LogPrint(BCLog::LLMQ_DKG, "CDKGSessionHandler::%s -- %s - currentHeight=%d, pindexQuorum->nHeight=%d, oldPhase=%d, newPhase=%d\n", __func__,
             params.name, currentHeight, pindexQuorum->nHeight, oldPhase, phase);
@@ -322,8 +334,17 @@ void CDKGSessionHandler::HandlePhase(QuorumPhase curPhase,
     LogPrint(BCLog::LLMQ_DKG, "CDKGSessionManager::%s -- %s - starting, curPhase=%d, nextPhase=%d\n", __func__, params.name, curPhase, nextPhase);
 
     SleepBeforePhase(curPhase, expectedQuorumHash, randomSleepFactor, runWhileWaiting);
+    int64_t nTimeStart = GetTimeMillis();
     startPhaseFunc();
+    int64_t nPhaseTime = GetTimeMillis() - nTimeStart;
+    quorumDKGDebugManager->UpdateLocalSessionStatus(params.type, [&](CDKGDebugSessionStatus& status) {
+        status.phaseTimes[(uint8_t)curPhase] = nPhaseTime;
+        return true;
+    });
     WaitForNextPhase(curPhase, nextPhase, expectedQuorumHash, runWhileWaiting);
+    TRACE4(dkg, phase_handled, params.type, curPhase, nPhaseTime, GetTimeMillis() - nTimeStart);
+    statsClient.histogram(strprintf("llmq.dkg.%s.phase%d.computeMs", params.name, curPhase), nPhaseTime);
+    statsClient.histogram(strprintf("llmq.dkg.%s.phase%d.totalMs", params.name, curPhase), GetTimeMillis() - nTimeStart);
 
     LogPrint(BCLog::LLMQ_DKG, "CDKGSessionManager::%s -- %s - done, curPhase=%d, nextPhase=%d\n", __func__, params.name, curPhase, nextPhase);
 }
@@ -423,6 +444,22 @@ std::set<NodeId> BatchVerifyMessageSigs(CDKGSession& session, const std::vector<
     return ret;
 }
 
+// Called for each batch of messages with valid signatures, before ReceiveMessage. Only contributions need preparation
+template<typename Message>
+static void PrepareMessages(CDKGSession& session, const std::vector<std::pair<NodeId, std::shared_ptr<Message>>>& messages)
+{
+}
+
+static void PrepareMessages(CDKGSession& session, const std::vector<std::pair<NodeId, std::shared_ptr<CDKGContribution>>>& messages)
+{
+    std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>> encrypted;
+    encrypted.reserve(messages.size());
+    for (const auto& p : messages) {
+        encrypted.emplace_back(p.second->contributions);
+    }
+    session.DecryptContributions(encrypted);
+}
+
 template<typename Message, int MessageType>
 bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendingMessages, size_t maxCount)
 {
@@ -471,6 +508,8 @@ bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendi
         }
     }
 
+    PrepareMessages(session, preverifiedMessages);
+
     for (const auto& p : preverifiedMessages) {
         const NodeId &nodeId = p.first;
         if (badNodes.count(nodeId)) {
@@ -483,17 +522,60 @@ bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendi
             LOCK(cs_main);
             Misbehaving(nodeId, 100);
             badNodes.emplace(nodeId);
+            continue;
         }
+        CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+        ds << *p.second;
+        session.WriteCheckpointMessage(MessageType, ds);
     }
 
     return true;
 }
 
+template<typename Message>
+void CDKGSessionHandler::ReplayCheckpointMessages(CDKGPendingMessages& pendingMessages, int msgType)
+{
+    auto msgs = dkgManager.GetCheckpointMessages(params.type, curSession->pindexQuorum, msgType);
+    for (const auto& v : msgs) {
+        CDataStream ds(v, SER_NETWORK, PROTOCOL_VERSION);
+        auto msg = std::make_shared<Message>();
+        try {
+            CDataStream ds2(ds);
+            ds2 >> *msg;
+        } catch (...) {
+            continue;
+        }
+        if (msg->proTxHash == curSession->myProTxHash) {
+            curSession->resumedOwnMessages.emplace(msgType);
+        }
+        pendingMessages.PushPendingMessage(-1, ds, std::move(msg));
+    }
+    LogPrint(BCLog::LLMQ_DKG, "CDKGSessionManager::%s -- %s - replayed %d messages of type %d\n", __func__, params.name, msgs.size(), msgType);
+}
+
 void CDKGSessionHandler::HandleDKGRound()
 {
     uint256 curQuorumHash;
+    QuorumPhase resumePhase{QuorumPhase_None};
 
-    WaitForNextPhase(QuorumPhase_None, QuorumPhase_Initialized, uint256(), []{return false;});
+    // Wait for the next round to start. If we were restarted in the middle of a round which we already contributed
+    // to, resume it instead. Otherwise other members would consider us as bad.
+    while (true) {
+        if (stopRequested) {
+            throw AbortPhaseException();
+        }
+        auto p = GetPhaseAndQuorumHash();
+        if (p.first == QuorumPhase_Initialized) {
+            break;
+        }
+        if (p.first >= QuorumPhase_Contribute && p.first <= QuorumPhase_Commit && dkgManager.HasCheckpoint(params.type, p.second)) {
+            resumePhase = p.first;
+            LogPrintf("CDKGSessionManager::%s -- %s - resuming DKG round for quorum %s in phase %d\n", __func__, params.name, p.second.ToString(), resumePhase);
+            break;
+        }
+        MilliSleep(100);
+    }
+    quorumDKGDebugManager->ResetLocalSessionStatus(params.type);
 
     {
         LOCK(cs);
@@ -510,6 +592,10 @@ void CDKGSessionHandler::HandleDKGRound()
         pindexQuorum = LookupBlockIndex(curQuorumHash);
     }
 
+    if (resumePhase == QuorumPhase_None) {
+        dkgManager.DeleteCheckpoints(params.type);
+    }
+
     if (!InitNewQuorum(pindexQuorum)) {
         // should actually never happen
         WaitForNewQuorum(curQuorumHash);
@@ -527,43 +613,51 @@ void CDKGSessionHandler::HandleDKGRound()
         CLLMQUtils::AddQuorumProbeConnections(params.type, pindexQuorum, curSession->myProTxHash);
     }
 
-    WaitForNextPhase(QuorumPhase_Initialized, QuorumPhase_Contribute, curQuorumHash, []{return false;});
-
-    // Contribute
-    auto fContributeStart = [this]() {
-        curSession->Contribute(pendingContributions);
-    };
-    auto fContributeWait = [this] {
-        return ProcessPendingMessageBatch<CDKGContribution, MSG_QUORUM_CONTRIB>(*curSession, pendingContributions, 8);
-    };
-    HandlePhase(QuorumPhase_Contribute, QuorumPhase_Complain, curQuorumHash, 0.05, fContributeStart, fContributeWait);
-
-    // Complain
-    auto fComplainStart = [this]() {
-        curSession->VerifyAndComplain(pendingComplaints);
-    };
-    auto fComplainWait = [this] {
-        return ProcessPendingMessageBatch<CDKGComplaint, MSG_QUORUM_COMPLAINT>(*curSession, pendingComplaints, 8);
-    };
-    HandlePhase(QuorumPhase_Complain, QuorumPhase_Justify, curQuorumHash, 0.05, fComplainStart, fComplainWait);
+    if (resumePhase == QuorumPhase_None) {
+        WaitForNextPhase(QuorumPhase_Initialized, QuorumPhase_Contribute, curQuorumHash, []{return false;});
+    }
 
-    // Justify
-    auto fJustifyStart = [this]() {
-        curSession->VerifyAndJustify(pendingJustifications);
+    struct Phase {
+        QuorumPhase phase;
+        QuorumPhase nextPhase;
+        double randomSleepFactor;
+        StartPhaseFunc startPhaseFunc;
+        WhileWaitFunc runWhileWaiting;
+        StartPhaseFunc replayFunc;
     };
-    auto fJustifyWait = [this] {
-        return ProcessPendingMessageBatch<CDKGJustification, MSG_QUORUM_JUSTIFICATION>(*curSession, pendingJustifications, 8);
+    const Phase phases[] = {
+        {QuorumPhase_Contribute, QuorumPhase_Complain, 0.05,
+            [this] { curSession->Contribute(pendingContributions); },
+            [this] { return ProcessPendingMessageBatch<CDKGContribution, MSG_QUORUM_CONTRIB>(*curSession, pendingContributions, 8); },
+            [this] { ReplayCheckpointMessages<CDKGContribution>(pendingContributions, MSG_QUORUM_CONTRIB); }},
+        {QuorumPhase_Complain, QuorumPhase_Justify, 0.05,
+            [this] { curSession->VerifyAndComplain(pendingComplaints); },
+            [this] { return ProcessPendingMessageBatch<CDKGComplaint, MSG_QUORUM_COMPLAINT>(*curSession, pendingComplaints, 8); },
+            [this] { ReplayCheckpointMessages<CDKGComplaint>(pendingComplaints, MSG_QUORUM_COMPLAINT); }},
+        {QuorumPhase_Justify, QuorumPhase_Commit, 0.05,
+            [this] { curSession->VerifyAndJustify(pendingJustifications); },
+            [this] { return ProcessPendingMessageBatch<CDKGJustification, MSG_QUORUM_JUSTIFICATION>(*curSession, pendingJustifications, 8); },
+            [this] { ReplayCheckpointMessages<CDKGJustification>(pendingJustifications, MSG_QUORUM_JUSTIFICATION); }},
+        {QuorumPhase_Commit, QuorumPhase_Finalize, 0.1,
+            [this] { curSession->VerifyAndCommit(pendingPrematureCommitments); },
+            [this] { return ProcessPendingMessageBatch<CDKGPrematureCommitment, MSG_QUORUM_PREMATURE_COMMITMENT>(*curSession, pendingPrematureCommitments, 8); },
+            [this] { ReplayCheckpointMessages<CDKGPrematureCommitment>(pendingPrematureCommitments, MSG_QUORUM_PREMATURE_COMMITMENT); }},
     };
-    HandlePhase(QuorumPhase_Justify, QuorumPhase_Commit, curQuorumHash, 0.05, fJustifyStart, fJustifyWait);
 
-    // Commit
-    auto fCommitStart = [this]() {
-        curSession->VerifyAndCommit(pendingPrematureCommitments);
-    };
-    auto fCommitWait = [this] {
-        return ProcessPendingMessageBatch<CDKGPrematureCommitment, MSG_QUORUM_PREMATURE_COMMITMENT>(*curSession, pendingPrematureCommitments, 8);
-    };
-    HandlePhase(QuorumPhase_Commit, QuorumPhase_Finalize, curQuorumHash, 0.1, fCommitStart, fCommitWait);
+    for (const auto& phase : phases) {
+        if (phase.phase < resumePhase) {
+            // This phase is already over. Only restore the session state it left behind, the replay will also
+            // prevent us from sending our messages again
+            phase.replayFunc();
+            phase.startPhaseFunc();
+            while (phase.runWhileWaiting()) {}
+            continue;
+        }
+        if (phase.phase == resumePhase) {
+            phase.replayFunc();
+        }
+        HandlePhase(phase.phase, phase.nextPhase, curQuorumHash, phase.randomSleepFactor, phase.startPhaseFunc, phase.runWhileWaiting);
+    }
 
     auto finalCommitments = curSession->FinalizeCommitments();
     for (const auto& fqc : finalCommitments) {
@@ -40,21 +40,28 @@ enum QuorumPhase {
 class CDKGPendingMessages
 {
 public:
-    typedef std::pair<NodeId, std::shared_ptr<CDataStream>> BinaryMessage;
+    struct PendingMessage {
+        NodeId from;
+        // The message as received from the network. Ownership of the receive buffer is taken over, so it is not copied
+        std::shared_ptr<CDataStream> data;
+        // Already deserialized message, only set for our own messages so that we don't deserialize what we just
+        // serialized. Points to an object of the message type this instance is responsible for
+        std::shared_ptr<void> msg;
+    };
 
 private:
     mutable CCriticalSection cs;
     const int invType;
     size_t maxMessagesPerNode GUARDED_BY(cs);
-    std::list<BinaryMessage> pendingMessages GUARDED_BY(cs);
+    std::list<PendingMessage> pendingMessages GUARDED_BY(cs);
     std::map<NodeId, size_t> messagesPerNode GUARDED_BY(cs);
     std::set<uint256> seenMessages GUARDED_BY(cs);
 
 public:
     explicit CDKGPendingMessages(size_t _maxMessagesPerNode, int _invType);
 
-    void PushPendingMessage(NodeId from, CDataStream& vRecv);
-    std::list<BinaryMessage> PopPendingMessages(size_t maxCount);
+    void PushPendingMessage(NodeId from, CDataStream& vRecv, std::shared_ptr<void> msg = nullptr);
+    std::list<PendingMessage> PopPendingMessages(size_t maxCount);
     bool HasSeen(const uint256& hash) const;
     void Clear();
 
@@ -63,28 +70,35 @@ public:
     {
         CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
         ds << msg;
-        PushPendingMessage(from, ds);
+        PushPendingMessage(from, ds, std::make_shared<Message>(msg));
     }
 
     // Might return nullptr messages, which indicates that deserialization failed for some reason
     template<typename Message>
     std::vector<std::pair<NodeId, std::shared_ptr<Message>>> PopAndDeserializeMessages(size_t maxCount)
     {
-        auto binaryMessages = PopPendingMessages(maxCount);
-        if (binaryMessages.empty()) {
+        auto pendingMessages = PopPendingMessages(maxCount);
+        if (pendingMessages.empty()) {
             return {};
         }
 
         std::vector<std::pair<NodeId, std::shared_ptr<Message>>> ret;
-        ret.reserve(binaryMessages.size());
-        for (const auto& bm : binaryMessages) {
-            auto msg = std::make_shared<Message>();
-            try {
-                *bm.second >> *msg;
-            } catch (...) {
-                msg = nullptr;
+        ret.reserve(pendingMessages.size());
+        for (auto& pm : pendingMessages) {
+            std::shared_ptr<Message> msg;
+            if (pm.msg) {
+                msg = std::static_pointer_cast<Message>(pm.msg);
+            } else {
+                msg = std::make_shared<Message>();
+                try {
+                    *pm.data >> *msg;
+                } catch (...) {
+                    msg = nullptr;
+                }
+                // free the receive buffer right away instead of keeping it until the whole batch is deserialized
+                pm.data.reset();
             }
-            ret.emplace_back(std::make_pair(bm.first, std::move(msg)));
+            ret.emplace_back(std::make_pair(pm.from, std::move(msg)));
         }
 
         return std::move(ret);
@@ -144,6 +158,8 @@ private:
     void WaitForNewQuorum(const uint256& oldQuorumHash) const;
     void SleepBeforePhase(QuorumPhase curPhase, const uint256& expectedQuorumHash, double randomSleepFactor, const WhileWaitFunc& runWhileWaiting);
     void HandlePhase(QuorumPhase curPhase, QuorumPhase nextPhase, const uint256& expectedQuorumHash, double randomSleepFactor, const StartPhaseFunc& startPhaseFunc, const WhileWaitFunc& runWhileWaiting);
+    template<typename Message>
+    void ReplayCheckpointMessages(CDKGPendingMessages& pendingMessages, int msgType);
     void HandleDKGRound();
     void PhaseHandlerThread();
 };
@@ -21,6 +21,8 @@ CDKGSessionManager* quorumDKGSessionManager;
 static const std::string DB_VVEC = "qdkg_V";
 static const std::string DB_SKCONTRIB = "qdkg_S";
 static const std::string DB_ENC_CONTRIB = "qdkg_E";
+static const std::string DB_CHECKPOINT_CONTRIB = "qdkg_CC";
+static const std::string DB_CHECKPOINT_MSG = "qdkg_CM";
 
 CDKGSessionManager::CDKGSessionManager(CDBWrapper& _llmqDb, CBLSWorker& _blsWorker) :
     llmqDb(_llmqDb),
@@ -277,6 +279,95 @@ bool CDKGSessionManager::GetEncryptedContributions(Consensus::LLMQType llmqType,
     return true;
 }
 
+void CDKGSessionManager::WriteCheckpointContributions(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const BLSVerificationVectorPtr& vvec, const BLSSecretKeyVector& skContributions)
+{
+    llmqDb.Write(std::make_tuple(DB_CHECKPOINT_CONTRIB, llmqType, pindexQuorum->GetBlockHash()), std::make_pair(*vvec, skContributions), true);
+}
+
+bool CDKGSessionManager::GetCheckpointContributions(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skContributionsRet) const
+{
+    std::pair<BLSVerificationVector, BLSSecretKeyVector> p;
+    if (!llmqDb.Read(std::make_tuple(DB_CHECKPOINT_CONTRIB, llmqType, pindexQuorum->GetBlockHash()), p)) {
+        return false;
+    }
+    vvecRet = std::make_shared<BLSVerificationVector>(std::move(p.first));
+    skContributionsRet = std::move(p.second);
+    return true;
+}
+
+bool CDKGSessionManager::HasCheckpoint(Consensus::LLMQType llmqType, const uint256& quorumHash) const
+{
+    return llmqDb.Exists(std::make_tuple(DB_CHECKPOINT_CONTRIB, llmqType, quorumHash));
+}
+
+void CDKGSessionManager::WriteCheckpointMessage(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, int msgType, const CDataStream& msg)
+{
+    CHashWriter hw(SER_GETHASH, 0);
+    hw.write(msg.data(), msg.size());
+    auto k = std::make_tuple(DB_CHECKPOINT_MSG, llmqType, pindexQuorum->GetBlockHash(), msgType, hw.GetHash());
+    // messages replayed from the checkpoint are processed again, no need to rewrite them
+    if (llmqDb.Exists(k)) {
+        return;
+    }
+    llmqDb.Write(k, std::vector<unsigned char>(msg.begin(), msg.end()));
+}
+
+std::vector<std::vector<unsigned char>> CDKGSessionManager::GetCheckpointMessages(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, int msgType) const
+{
+    std::vector<std::vector<unsigned char>> ret;
+
+    auto start = std::make_tuple(DB_CHECKPOINT_MSG, llmqType, pindexQuorum->GetBlockHash(), msgType, uint256());
+    std::unique_ptr<CDBIterator> pcursor(llmqDb.NewIterator());
+    pcursor->Seek(start);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_CHECKPOINT_MSG || std::get<1>(k) != llmqType ||
+            std::get<2>(k) != pindexQuorum->GetBlockHash() || std::get<3>(k) != msgType) {
+            break;
+        }
+        std::vector<unsigned char> v;
+        if (pcursor->GetValue(v)) {
+            ret.emplace_back(std::move(v));
+        }
+        pcursor->Next();
+    }
+    return ret;
+}
+
+void CDKGSessionManager::DeleteCheckpoints(Consensus::LLMQType llmqType)
+{
+    CDBBatch batch(llmqDb);
+
+    {
+        auto start = std::make_tuple(DB_CHECKPOINT_CONTRIB, llmqType, uint256());
+        std::unique_ptr<CDBIterator> pcursor(llmqDb.NewIterator());
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != DB_CHECKPOINT_CONTRIB || std::get<1>(k) != llmqType) {
+                break;
+            }
+            batch.Erase(k);
+            pcursor->Next();
+        }
+    }
+    {
+        auto start = std::make_tuple(DB_CHECKPOINT_MSG, llmqType, uint256(), 0, uint256());
+        std::unique_ptr<CDBIterator> pcursor(llmqDb.NewIterator());
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != DB_CHECKPOINT_MSG || std::get<1>(k) != llmqType) {
+                break;
+            }
+            batch.Erase(k);
+            pcursor->Next();
+        }
+    }
+
+    llmqDb.WriteBatch(batch);
+}
+
 void CDKGSessionManager::CleanupCache()
 {
     LOCK(contributionsCacheCs);
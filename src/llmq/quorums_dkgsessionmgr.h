@@ -70,6 +70,17 @@ public:
     /// Read encrypted (unverified) DKG contributions for the member with the given proTxHash from the llmqDb
     bool GetEncryptedContributions(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const std::vector<bool>& validMembers, const uint256& proTxHash, std::vector<CBLSIESEncryptedObject<CBLSSecretKey>>& vecRet) const;
 
+    // Checkpoints of the currently running DKG round, which allow a restarted node to resume the round with the same
+    // contributions and without losing the messages it already received. Only members write checkpoints
+    void WriteCheckpointContributions(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const BLSVerificationVectorPtr& vvec, const BLSSecretKeyVector& skContributions);
+    bool GetCheckpointContributions(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skContributionsRet) const;
+    bool HasCheckpoint(Consensus::LLMQType llmqType, const uint256& quorumHash) const;
+    /// Write a message which was received (or sent) and processed by the session. msgType is the inv type of the message
+    void WriteCheckpointMessage(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, int msgType, const CDataStream& msg);
+    std::vector<std::vector<unsigned char>> GetCheckpointMessages(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, int msgType) const;
+    /// Delete all checkpoints of the given LLMQ type, called when a new round starts
+    void DeleteCheckpoints(Consensus::LLMQType llmqType);
+
 private:
     void CleanupCache();
 };
@@ -4,18 +4,24 @@
 
 #include <llmq/quorums_chainlocks.h>
 #include <llmq/quorums.h>
+#include <llmq/quorums_init.h>
 #include <llmq/quorums_instantsend.h>
 #include <llmq/quorums_utils.h>
 #include <llmq/quorums_commitment.h>
 
 #include <bls/bls_batchverifier.h>
+#include <bls/bls_sigcache.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <index/txindex.h>
 #include <txmempool.h>
 #include <masternode/masternode-sync.h>
+#include <memusage.h>
 #include <net_processing.h>
 #include <spork.h>
+#include <statsd_client.h>
+#include <util/memaccounting.h>
+#include <util/trace.h>
 #include <validation.h>
 #include <util/validation.h>
 
@@ -33,7 +39,10 @@ static const std::string DB_ISLOCK_BY_HASH = "is_i";
 static const std::string DB_HASH_BY_TXID = "is_tx";
 static const std::string DB_HASH_BY_OUTPOINT = "is_in";
 static const std::string DB_MINED_BY_HEIGHT_AND_HASH = "is_m";
+// Legacy archive keys with one entry per lock, only written by older versions. No migration is needed for them, they are
+// removed by RemoveArchivedInstantSendLocks like the per height buckets once they are 100 blocks old
 static const std::string DB_ARCHIVED_BY_HEIGHT_AND_HASH = "is_a1";
+static const std::string DB_ARCHIVED_BY_HEIGHT = "is_a3";
 static const std::string DB_ARCHIVED_BY_HASH = "is_a2";
 
 static const std::string DB_VERSION = "is_v";
@@ -52,8 +61,93 @@ uint256 CInstantSendLock::GetRequestId() const
 
 ////////////////
 
+void CInstantSendLockIndex::Add(const uint256& islockHash, const CInstantSendLock& islock)
+{
+    {
+        auto& shard = GetShard(islock.txid);
+        LOCK(shard.cs);
+        shard.byTxid[islock.txid] = islockHash;
+    }
+    for (const auto& in : islock.inputs) {
+        auto& shard = GetShard(in.hash);
+        LOCK(shard.cs);
+        shard.byOutpoint[in] = std::make_pair(islockHash, islock.txid);
+    }
+}
+
+void CInstantSendLockIndex::Remove(const uint256& islockHash, const CInstantSendLock& islock)
+{
+    {
+        auto& shard = GetShard(islock.txid);
+        LOCK(shard.cs);
+        auto it = shard.byTxid.find(islock.txid);
+        if (it != shard.byTxid.end() && it->second == islockHash) {
+            shard.byTxid.erase(it);
+        }
+    }
+    for (const auto& in : islock.inputs) {
+        auto& shard = GetShard(in.hash);
+        LOCK(shard.cs);
+        auto it = shard.byOutpoint.find(in);
+        if (it != shard.byOutpoint.end() && it->second.first == islockHash) {
+            shard.byOutpoint.erase(it);
+        }
+    }
+}
+
+bool CInstantSendLockIndex::GetHashByTxid(const uint256& txid, uint256& islockHashRet) const
+{
+    auto& shard = GetShard(txid);
+    LOCK(shard.cs);
+    auto it = shard.byTxid.find(txid);
+    if (it == shard.byTxid.end()) {
+        return false;
+    }
+    islockHashRet = it->second;
+    return true;
+}
+
+bool CInstantSendLockIndex::GetByOutpoint(const COutPoint& outpoint, uint256& islockHashRet, uint256& txidRet) const
+{
+    auto& shard = GetShard(outpoint.hash);
+    LOCK(shard.cs);
+    auto it = shard.byOutpoint.find(outpoint);
+    if (it == shard.byOutpoint.end()) {
+        return false;
+    }
+    islockHashRet = it->second.first;
+    txidRet = it->second.second;
+    return true;
+}
+
+////////////////
+
 CInstantSendDb::CInstantSendDb(CDBWrapper& _db) : db(_db)
 {
+    LoadLockIndex();
+}
+
+void CInstantSendDb::LoadLockIndex()
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(DB_ISLOCK_BY_HASH, uint256());
+    it->Seek(firstKey);
+
+    CInstantSendLock islock;
+    size_t cnt = 0;
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_ISLOCK_BY_HASH) {
+            break;
+        }
+        if (it->GetValue(islock)) {
+            lockIndex.Add(std::get<1>(curKey), islock);
+            cnt++;
+        }
+        it->Next();
+    }
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSendDb::%s -- loaded %d islocks\n", __func__, cnt);
 }
 
 void CInstantSendDb::Upgrade()
@@ -81,6 +175,7 @@ void CInstantSendDb::Upgrade()
                     batch.Erase(std::make_tuple(DB_HASH_BY_OUTPOINT, in));
                 }
                 batch.Erase(curKey);
+                lockIndex.Remove(std::get<1>(curKey), islock);
             }
             it->Next();
         }
@@ -99,6 +194,8 @@ void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstant
     }
     db.WriteBatch(batch);
 
+    lockIndex.Add(hash, islock);
+
     auto p = std::make_shared<CInstantSendLock>(islock);
     islockCache.insert(hash, p);
     txidCache.insert(islock.txid, hash);
@@ -122,6 +219,8 @@ void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash,
         batch.Erase(std::make_tuple(DB_HASH_BY_OUTPOINT, in));
     }
 
+    lockIndex.Remove(hash, *islock);
+
     if (!keep_cache) {
         islockCache.erase(hash);
         txidCache.erase(islock->txid);
@@ -136,6 +235,11 @@ static std::tuple<std::string, uint32_t, uint256> BuildInversedISLockKey(const s
     return std::make_tuple(k, htobe32(std::numeric_limits<uint32_t>::max() - nHeight), islockHash);
 }
 
+static std::tuple<std::string, uint32_t> BuildInversedHeightKey(const std::string& k, int nHeight)
+{
+    return std::make_tuple(k, htobe32(std::numeric_limits<uint32_t>::max() - nHeight));
+}
+
 void CInstantSendDb::WriteInstantSendLockMined(const uint256& hash, int nHeight)
 {
     CDBBatch batch(db);
@@ -153,10 +257,22 @@ void CInstantSendDb::RemoveInstantSendLockMined(CDBBatch& batch, const uint256&
     batch.Erase(BuildInversedISLockKey(DB_MINED_BY_HEIGHT_AND_HASH, nHeight, hash));
 }
 
-void CInstantSendDb::WriteInstantSendLockArchived(CDBBatch& batch, const uint256& hash, int nHeight)
+void CInstantSendDb::WriteInstantSendLocksArchived(CDBBatch& batch, int nHeight, const std::vector<uint256>& hashes)
 {
-    batch.Write(BuildInversedISLockKey(DB_ARCHIVED_BY_HEIGHT_AND_HASH, nHeight, hash), true);
-    batch.Write(std::make_tuple(DB_ARCHIVED_BY_HASH, hash), true);
+    if (hashes.empty()) {
+        return;
+    }
+
+    // All archived islocks of one height are stored in a single bucket, so that pruning doesn't need one key per lock
+    auto k = BuildInversedHeightKey(DB_ARCHIVED_BY_HEIGHT, nHeight);
+    std::vector<uint256> bucket;
+    db.Read(k, bucket);
+    bucket.insert(bucket.end(), hashes.begin(), hashes.end());
+    batch.Write(k, bucket);
+
+    for (const auto& hash : hashes) {
+        batch.Write(std::make_tuple(DB_ARCHIVED_BY_HASH, hash), true);
+    }
 }
 
 std::unordered_map<uint256, CInstantSendLockPtr> CInstantSendDb::RemoveConfirmedInstantSendLocks(int nUntilHeight)
@@ -176,6 +292,7 @@ std::unordered_map<uint256, CInstantSendLockPtr> CInstantSendDb::RemoveConfirmed
 
     CDBBatch batch(db);
     std::unordered_map<uint256, CInstantSendLockPtr> ret;
+    std::map<int, std::vector<uint256>> archived;
     while (it->Valid()) {
         decltype(firstKey) curKey;
         if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_MINED_BY_HEIGHT_AND_HASH) {
@@ -194,13 +311,17 @@ std::unordered_map<uint256, CInstantSendLockPtr> CInstantSendDb::RemoveConfirmed
         }
 
         // archive the islock hash, so that we're still able to check if we've seen the islock in the past
-        WriteInstantSendLockArchived(batch, islockHash, nHeight);
+        archived[nHeight].emplace_back(islockHash);
 
         batch.Erase(curKey);
 
         it->Next();
     }
 
+    for (const auto& p : archived) {
+        WriteInstantSendLocksArchived(batch, p.first, p.second);
+    }
+
     db.WriteBatch(batch);
 
     return ret;
@@ -213,12 +334,31 @@ void CInstantSendDb::RemoveArchivedInstantSendLocks(int nUntilHeight)
     }
 
     auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    CDBBatch batch(db);
 
-    auto firstKey = BuildInversedISLockKey(DB_ARCHIVED_BY_HEIGHT_AND_HASH, nUntilHeight, uint256());
+    auto firstBucketKey = BuildInversedHeightKey(DB_ARCHIVED_BY_HEIGHT, nUntilHeight);
+    it->Seek(firstBucketKey);
 
+    std::vector<uint256> bucket;
+    while (it->Valid()) {
+        decltype(firstBucketKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_ARCHIVED_BY_HEIGHT) {
+            break;
+        }
+        if (it->GetValue(bucket)) {
+            for (const auto& islockHash : bucket) {
+                batch.Erase(std::make_tuple(DB_ARCHIVED_BY_HASH, islockHash));
+            }
+        }
+        batch.Erase(curKey);
+
+        it->Next();
+    }
+
+    // legacy keys with one entry per lock
+    auto firstKey = BuildInversedISLockKey(DB_ARCHIVED_BY_HEIGHT_AND_HASH, nUntilHeight, uint256());
     it->Seek(firstKey);
 
-    CDBBatch batch(db);
     while (it->Valid()) {
         decltype(firstKey) curKey;
         if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_ARCHIVED_BY_HEIGHT_AND_HASH) {
@@ -277,6 +417,17 @@ bool CInstantSendDb::KnownInstantSendLock(const uint256& islockHash) const
     return GetInstantSendLockByHash(islockHash) != nullptr || db.Exists(std::make_tuple(DB_ARCHIVED_BY_HASH, islockHash));
 }
 
+size_t CInstantSendDb::GetCacheMemoryUsage() const
+{
+    size_t nUsage = islockCache.dynamic_usage() + txidCache.dynamic_usage() + outpointCache.dynamic_usage();
+    islockCache.for_each([&nUsage](const uint256&, const CInstantSendLockPtr& islock) {
+        if (islock) {
+            nUsage += memusage::MallocUsage(sizeof(CInstantSendLock)) + memusage::DynamicUsage(islock->inputs);
+        }
+    });
+    return nUsage;
+}
+
 size_t CInstantSendDb::GetInstantSendLockCount() const
 {
     auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
@@ -382,6 +533,7 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
     stack.emplace_back(txid);
 
     CDBBatch batch(db);
+    std::vector<uint256> archived;
     while (!stack.empty()) {
         auto children = GetInstantSendLocksByParent(stack.back());
         stack.pop_back();
@@ -393,7 +545,7 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
             }
 
             RemoveInstantSendLock(batch, childIslockHash, childIsLock, false);
-            WriteInstantSendLockArchived(batch, childIslockHash, nHeight);
+            archived.emplace_back(childIslockHash);
             result.emplace_back(childIslockHash);
 
             if (added.emplace(childIsLock->txid).second) {
@@ -403,9 +555,11 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
     }
 
     RemoveInstantSendLock(batch, islockHash, nullptr, false);
-    WriteInstantSendLockArchived(batch, islockHash, nHeight);
+    archived.emplace_back(islockHash);
     result.emplace_back(islockHash);
 
+    WriteInstantSendLocksArchived(batch, nHeight, archived);
+
     db.WriteBatch(batch);
 
     return result;
@@ -417,9 +571,21 @@ CInstantSendManager::CInstantSendManager(CDBWrapper& _llmqDb) :
     db(_llmqDb)
 {
     workInterrupt.reset();
+    memaccounting::Register("instantsend", this, [this]() {
+        size_t nUsage = GetNonLockedTxsMemoryUsage();
+        LOCK(cs);
+        nUsage += db.GetCacheMemoryUsage();
+        nUsage += memusage::DynamicUsage(inputRequestIds) + memusage::DynamicUsage(creatingInstantSendLocks) +
+                  memusage::DynamicUsage(txToCreatingInstantSendLocks) + memusage::DynamicUsage(pendingInstantSendLocks) +
+                  memusage::DynamicUsage(mempoolTxsByOutpoint) + memusage::DynamicUsage(pendingRetryTxs);
+        return nUsage;
+    });
 }
 
-CInstantSendManager::~CInstantSendManager() = default;
+CInstantSendManager::~CInstantSendManager()
+{
+    memaccounting::Unregister(this);
+}
 
 void CInstantSendManager::Start()
 {
@@ -429,6 +595,7 @@ void CInstantSendManager::Start()
     }
 
     workThread = std::thread(&TraceThread<std::function<void()> >, "isman", std::function<void()>(std::bind(&CInstantSendManager::WorkThreadMain, this)));
+    applyThread = std::thread(&TraceThread<std::function<void()> >, "isman-apply", std::function<void()>(std::bind(&CInstantSendManager::ApplyThreadMain, this)));
 
     quorumSigningManager->RegisterRecoveredSigsListener(this);
 }
@@ -445,11 +612,19 @@ void CInstantSendManager::Stop()
     if (workThread.joinable()) {
         workThread.join();
     }
+    if (applyThread.joinable()) {
+        applyThread.join();
+    }
 }
 
 void CInstantSendManager::InterruptWorkerThread()
 {
     workInterrupt();
+    {
+        // make sure that nobody misses the interruption while going to sleep
+        std::lock_guard<std::mutex> lock(cs_verified);
+    }
+    cvVerified.notify_all();
 }
 
 void CInstantSendManager::ProcessTx(const CTransaction& tx, bool fRetroactive, const Consensus::Params& params)
@@ -578,22 +753,36 @@ bool CInstantSendManager::CheckCanLock(const COutPoint& outpoint, bool printDebu
         return false;
     }
 
-    CTransactionRef tx;
-    uint256 hashBlock;
-    // this relies on enabled txindex and won't work if we ever try to remove the requirement for txindex for masternodes
-    if (!GetTransaction(outpoint.hash, tx, params, hashBlock, false)) {
-        if (printDebug) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s: failed to find parent TX %s\n", __func__,
-                     txHash.ToString(), outpoint.hash.ToString());
+    const CBlockIndex* pindexMined{nullptr};
+    int nTxAge;
+    {
+        LOCK(cs_main);
+        // Unspent outputs know the height of the block which confirmed them, so there is no need to look up the
+        // parent TX through the txindex and read it from the block files
+        Coin coin;
+        if (pcoinsTip->GetCoin(outpoint, coin) && coin.nHeight <= chainActive.Height()) {
+            pindexMined = chainActive[coin.nHeight];
         }
-        return false;
     }
 
-    const CBlockIndex* pindexMined;
-    int nTxAge;
-    {
+    if (pindexMined == nullptr) {
+        // Outputs which are spent in the chain already, e.g. when TXs of a new block are retroactively locked
+        CTransactionRef tx;
+        uint256 hashBlock;
+        // this relies on enabled txindex and won't work if we ever try to remove the requirement for txindex for masternodes
+        if (!GetTransaction(outpoint.hash, tx, params, hashBlock, false)) {
+            if (printDebug) {
+                LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s: failed to find parent TX %s\n", __func__,
+                         txHash.ToString(), outpoint.hash.ToString());
+            }
+            return false;
+        }
         LOCK(cs_main);
         pindexMined = LookupBlockIndex(hashBlock);
+    }
+
+    {
+        LOCK(cs_main);
         nTxAge = chainActive.Height() - pindexMined->nHeight + 1;
     }
 
@@ -700,6 +889,7 @@ void CInstantSendManager::TrySignInstantSendLock(const CTransaction& tx)
         txToCreatingInstantSendLocks.emplace(tx.GetHash(), &e.first->second);
     }
 
+    TRACE2(instantsend, islock_sign_started, tx.GetHash().begin(), tx.vin.size());
     quorumSigningManager->AsyncSignIfMember(llmqType, id, tx.GetHash());
 }
 
@@ -726,6 +916,7 @@ void CInstantSendManager::HandleNewInstantSendLockRecoveredSig(const llmq::CReco
     }
 
     islock->sig = recoveredSig.sig;
+    TRACE1(instantsend, islock_created, islock->txid.begin());
     ProcessInstantSendLock(-1, ::SerializeHash(*islock), islock);
 }
 
@@ -736,6 +927,12 @@ void CInstantSendManager::ProcessMessage(CNode* pfrom, const std::string& strCom
     }
 
     if (strCommand == NetMsgType::ISLOCK) {
+        uint256 hash;
+        if (recentlySeenISLocks.ContainsMessage(vRecv, hash)) {
+            LOCK(cs_main);
+            EraseObjectRequest(pfrom->GetId(), CInv(MSG_ISLOCK, hash));
+            return;
+        }
         auto islock = std::make_shared<CInstantSendLock>();
         vRecv >> *islock;
         ProcessMessageInstantSendLock(pfrom, islock);
@@ -758,7 +955,7 @@ void CInstantSendManager::ProcessMessageInstantSendLock(const CNode* pfrom, cons
     }
 
     LOCK(cs);
-    if (pendingInstantSendLocks.count(hash) || db.KnownInstantSendLock(hash)) {
+    if (pendingInstantSendLocks.count(hash) || IsVerifiedInstantSendLockQueued(hash) || db.KnownInstantSendLock(hash)) {
         return;
     }
 
@@ -768,6 +965,26 @@ void CInstantSendManager::ProcessMessageInstantSendLock(const CNode* pfrom, cons
     pendingInstantSendLocks.emplace(hash, std::make_pair(pfrom->GetId(), islock));
 }
 
+bool CInstantSendManager::RestoreInstantSendLock(const CInstantSendLockPtr& islock)
+{
+    if (!IsInstantSendEnabled() || !PreVerifyInstantSendLock(*islock)) {
+        return false;
+    }
+
+    auto hash = ::SerializeHash(*islock);
+    LOCK(cs);
+    if (pendingInstantSendLocks.count(hash) || IsVerifiedInstantSendLockQueued(hash) || db.KnownInstantSendLock(hash)) {
+        return false;
+    }
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: restored islock from mempool.dat\n", __func__,
+            islock->txid.ToString(), hash.ToString());
+
+    // -1 as there is no peer to punish if it turns out to be invalid
+    pendingInstantSendLocks.emplace(hash, std::make_pair(-1, islock));
+    return true;
+}
+
 /**
  * Handles trivial ISLock verification
  * @param islock The islock message being undergoing verification
@@ -850,6 +1067,13 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
     CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
     std::unordered_map<uint256, CRecoveredSig> recSigs;
 
+    std::vector<const CBLSLazySignature*> lazySigs;
+    lazySigs.reserve(pend.size());
+    for (const auto& p : pend) {
+        lazySigs.emplace_back(&p.second.second->sig);
+    }
+    blsWorker->DecodeLazySignatures(lazySigs);
+
     size_t verifyCount = 0;
     size_t alreadyVerified = 0;
     for (const auto& p : pend) {
@@ -880,8 +1104,14 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             return {};
         }
         uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc->quorumHash, id, islock->txid);
-        batchVerifier.PushMessage(nodeId, hash, signHash, islock->sig.Get(), quorum->qc->quorumPublicKey);
-        verifyCount++;
+        // The batch below is aggregated without random weights, so its results are never added to the cache. Only
+        // signatures which were verified on their own elsewhere can be skipped here.
+        if (CBLSSigCacheEntry(quorum->qc->quorumPublicKey, signHash, islock->sig.Get()).IsCached()) {
+            alreadyVerified++;
+        } else {
+            batchVerifier.PushMessage(nodeId, hash, signHash, islock->sig.Get(), quorum->qc->quorumPublicKey);
+            verifyCount++;
+        }
 
         // We can reconstruct the CRecoveredSig objects from the islock and pass it to the signing manager, which
         // avoids unnecessary double-verification of the signature. We however only do this when verification here
@@ -900,9 +1130,12 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
     cxxtimer::Timer verifyTimer(true);
     batchVerifier.Verify();
     verifyTimer.stop();
+    statsClient.timing("instantsend.verifyMs", verifyTimer.count(), 1.0f);
+    statsClient.histogram("instantsend.verifyBatchSize", verifyCount);
 
     LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- verified locks. count=%d, alreadyVerified=%d, vt=%d, nodes=%d\n", __func__,
             verifyCount, alreadyVerified, verifyTimer.count(), batchVerifier.GetUniqueSourceCount());
+    TRACE4(instantsend, islocks_verified, verifyCount, alreadyVerified, batchVerifier.badMessages.size(), verifyTimer.count());
 
     std::unordered_set<uint256> badISLocks;
 
@@ -926,25 +1159,41 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             continue;
         }
 
-        ProcessInstantSendLock(nodeId, hash, islock);
-
-        // See comment further on top. We pass a reconstructed recovered sig to the signing manager to avoid
-        // double-verification of the sig.
+        std::shared_ptr<CRecoveredSig> recSig;
         auto it = recSigs.find(hash);
         if (it != recSigs.end()) {
-            auto recSig = std::make_shared<CRecoveredSig>(std::move(it->second));
-            if (!quorumSigningManager->HasRecoveredSigForId(llmqType, recSig->id)) {
-                recSig->UpdateHash();
-                LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: passing reconstructed recSig to signing mgr, peer=%d\n", __func__,
-                         islock->txid.ToString(), hash.ToString(), nodeId);
-                quorumSigningManager->PushReconstructedRecoveredSig(recSig);
-            }
+            recSig = std::make_shared<CRecoveredSig>(std::move(it->second));
         }
+        PushVerifiedInstantSendLock({nodeId, hash, islock, std::move(recSig), GetTimeMillis()});
     }
 
     return badISLocks;
 }
 
+void CInstantSendManager::PushVerifiedInstantSendLock(VerifiedInstantSendLock&& verified)
+{
+    std::unique_lock<std::mutex> lock(cs_verified);
+    // apply back pressure instead of dropping verified islocks
+    cvVerified.wait(lock, [&] {
+        return verifiedInstantSendLocks.size() < MAX_VERIFIED_INSTANTSEND_LOCKS || workInterrupt;
+    });
+    if (workInterrupt) {
+        return;
+    }
+    if (!verifiedInstantSendLockHashes.emplace(verified.hash).second) {
+        return;
+    }
+    verifiedInstantSendLocks.emplace_back(std::move(verified));
+    lock.unlock();
+    cvVerified.notify_all();
+}
+
+bool CInstantSendManager::IsVerifiedInstantSendLockQueued(const uint256& hash) const
+{
+    std::lock_guard<std::mutex> lock(cs_verified);
+    return verifiedInstantSendLockHashes.count(hash) != 0;
+}
+
 void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& hash, const CInstantSendLockPtr& islock)
 {
     {
@@ -961,11 +1210,12 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
         }
     }
 
-    CTransactionRef tx;
     uint256 hashBlock;
     const CBlockIndex* pindexMined{nullptr};
+    // usually the TX is still in the mempool, in which case it's not mined yet and there is no need to ask the txindex
+    CTransactionRef tx = mempool.get(islock->txid);
     // we ignore failure here as we must be able to propagate the lock even if we don't have the TX locally
-    if (GetTransaction(islock->txid, tx, Params().GetConsensus(), hashBlock) && !hashBlock.IsNull()) {
+    if (tx == nullptr && GetTransaction(islock->txid, tx, Params().GetConsensus(), hashBlock) && !hashBlock.IsNull()) {
         {
             LOCK(cs_main);
             pindexMined = LookupBlockIndex(hashBlock);
@@ -976,8 +1226,16 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
         if (pindexMined != nullptr && llmq::chainLocksHandler->HasChainLock(pindexMined->nHeight, pindexMined->GetBlockHash())) {
             LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txlock=%s, islock=%s: dropping islock as it already got a ChainLock in block %s, peer=%d\n", __func__,
                      islock->txid.ToString(), hash.ToString(), hashBlock.ToString(), from);
+            recentlySeenISLocks.Add(hash);
             return;
         }
+    } else if (tx != nullptr && !GetMockTime()) {
+        // the lock itself carries no creation time, so measure from when the TX entered our mempool. The entry time
+        // only has a resolution of seconds, which skews the values by up to a second
+        TxMempoolInfo info = mempool.info(islock->txid);
+        if (info.tx != nullptr) {
+            statsClient.histogram("instantsend.txToLockMs", std::max<int64_t>(0, GetTimeMillis() - info.nTime * 1000));
+        }
     }
 
     {
@@ -996,6 +1254,7 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
         }
 
         db.WriteNewInstantSendLock(hash, *islock);
+        recentlySeenISLocks.Add(hash);
         if (pindexMined) {
             db.WriteInstantSendLockMined(hash, pindexMined->nHeight);
         }
@@ -1030,7 +1289,24 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
 
 void CInstantSendManager::TransactionAddedToMempool(const CTransactionRef& tx)
 {
-    if (!IsInstantSendEnabled() || !masternodeSync.IsBlockchainSynced() || tx->vin.empty()) {
+    if (tx->vin.empty()) {
+        return;
+    }
+
+    {
+        LOCK(cs);
+        AddMempoolTxOutpoints(*tx);
+    }
+
+    // An islock which conflicts with this TX might have been processed after the TX was accepted but before this
+    // notification arrived, in which case RemoveMempoolConflictsForLock could not have seen the TX
+    auto conflictingLock = GetConflictingLock(*tx);
+    if (conflictingLock != nullptr) {
+        RemoveMempoolConflictsForLock(::SerializeHash(*conflictingLock), *conflictingLock);
+        return;
+    }
+
+    if (!IsInstantSendEnabled() || !masternodeSync.IsBlockchainSynced()) {
         return;
     }
 
@@ -1064,11 +1340,17 @@ void CInstantSendManager::TransactionAddedToMempool(const CTransactionRef& tx)
 
 void CInstantSendManager::TransactionRemovedFromMempool(const CTransactionRef& tx)
 {
-    if (tx->vin.empty() || !fUpgradedDB) {
+    if (tx->vin.empty()) {
         return;
     }
 
     LOCK(cs);
+    RemoveMempoolTxOutpoints(*tx);
+
+    if (!fUpgradedDB) {
+        return;
+    }
+
     CInstantSendLockPtr islock = db.GetInstantSendLockByTxid(tx->GetHash());
 
     if (islock == nullptr) {
@@ -1081,6 +1363,14 @@ void CInstantSendManager::TransactionRemovedFromMempool(const CTransactionRef& t
 
 void CInstantSendManager::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
 {
+    {
+        // TXs removed from the mempool due to inclusion in a block are not signalled through TransactionRemovedFromMempool
+        LOCK(cs);
+        for (const auto& tx : pblock->vtx) {
+            RemoveMempoolTxOutpoints(*tx);
+        }
+    }
+
     if (!IsInstantSendEnabled()) {
         return;
     }
@@ -1129,12 +1419,24 @@ void CInstantSendManager::AddNonLockedTx(const CTransactionRef& tx, const CBlock
     auto& info = res.first->second;
     info.pindexMined = pindexMined;
 
-    if (res.second) {
+    // the entry might already exist without a tx when a child was added first
+    if (!info.tx) {
         info.tx = tx;
         for (const auto& in : tx->vin) {
-            nonLockedTxs[in.prevout.hash].children.emplace(tx->GetHash());
+            auto& parentInfo = nonLockedTxs[in.prevout.hash];
+            if (parentInfo.children.emplace(tx->GetHash()).second && parentInfo.tx) {
+                info.pendingParents++;
+            }
             nonLockedTxsByOutpoints.emplace(in.prevout, tx->GetHash());
         }
+
+        // children that were added before us are now blocked by us as well
+        for (const auto& childTxid : info.children) {
+            auto it = nonLockedTxs.find(childTxid);
+            if (it != nonLockedTxs.end()) {
+                it->second.pendingParents++;
+            }
+        }
     }
 
     LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, pindexMined=%s\n", __func__,
@@ -1152,11 +1454,20 @@ void CInstantSendManager::RemoveNonLockedTx(const uint256& txid, bool retryChild
     const auto& info = it->second;
 
     size_t retryChildrenCount = 0;
-    if (retryChildren) {
-        // TX got locked, so we can retry locking children
+    if (info.tx) {
         for (auto& childTxid : info.children) {
-            pendingRetryTxs.emplace(childTxid);
-            retryChildrenCount++;
+            auto jt = nonLockedTxs.find(childTxid);
+            if (jt == nonLockedTxs.end()) {
+                continue;
+            }
+            auto& childInfo = jt->second;
+            assert(childInfo.pendingParents > 0);
+            childInfo.pendingParents--;
+            // TX got locked, so we can retry locking children which don't wait for other parents anymore
+            if (retryChildren && childInfo.pendingParents == 0) {
+                pendingRetryTxs.emplace(childTxid);
+                retryChildrenCount++;
+            }
         }
     }
 
@@ -1179,6 +1490,25 @@ void CInstantSendManager::RemoveNonLockedTx(const uint256& txid, bool retryChild
              txid.ToString(), retryChildren, retryChildrenCount);
 }
 
+void CInstantSendManager::AddMempoolTxOutpoints(const CTransaction& tx)
+{
+    AssertLockHeld(cs);
+    for (const auto& in : tx.vin) {
+        mempoolTxsByOutpoint[in.prevout] = tx.GetHash();
+    }
+}
+
+void CInstantSendManager::RemoveMempoolTxOutpoints(const CTransaction& tx)
+{
+    AssertLockHeld(cs);
+    for (const auto& in : tx.vin) {
+        auto it = mempoolTxsByOutpoint.find(in.prevout);
+        if (it != mempoolTxsByOutpoint.end() && it->second == tx.GetHash()) {
+            mempoolTxsByOutpoint.erase(it);
+        }
+    }
+}
+
 void CInstantSendManager::RemoveConflictedTx(const CTransaction& tx)
 {
     AssertLockHeld(cs);
@@ -1210,7 +1540,6 @@ void CInstantSendManager::NotifyChainLock(const CBlockIndex* pindexChainLock)
 void CInstantSendManager::UpdatedBlockTip(const CBlockIndex* pindexNew)
 {
     if (!fUpgradedDB) {
-        LOCK(cs_main);
         if (VersionBitsState(pindexNew, Params().GetConsensus(), Consensus::DEPLOYMENT_DIP0020, versionbitscache) == ThresholdState::ACTIVE) {
             db.Upgrade();
             fUpgradedDB = true;
@@ -1278,21 +1607,33 @@ void CInstantSendManager::HandleFullyConfirmedBlock(const CBlockIndex* pindex)
 
 void CInstantSendManager::RemoveMempoolConflictsForLock(const uint256& hash, const CInstantSendLock& islock)
 {
-    std::unordered_map<uint256, CTransactionRef> toDelete;
-
+    std::unordered_set<uint256, StaticSaltedHasher> conflicts;
     {
-        LOCK(mempool.cs);
-
+        LOCK(cs);
         for (auto& in : islock.inputs) {
-            auto it = mempool.mapNextTx.find(in);
-            if (it == mempool.mapNextTx.end()) {
+            auto it = mempoolTxsByOutpoint.find(in);
+            if (it == mempoolTxsByOutpoint.end() || it->second == islock.txid) {
                 continue;
             }
-            if (it->second->GetHash() != islock.txid) {
-                toDelete.emplace(it->second->GetHash(), mempool.get(it->second->GetHash()));
+            conflicts.emplace(it->second);
+
+            LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: mempool TX %s with input %s conflicts with islock\n", __func__,
+                     islock.txid.ToString(), hash.ToString(), it->second.ToString(), in.ToStringShort());
+        }
+    }
 
-                LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: mempool TX %s with input %s conflicts with islock\n", __func__,
-                         islock.txid.ToString(), hash.ToString(), it->second->GetHash().ToString(), in.ToStringShort());
+    // the common case, no need to lock the mempool
+    if (conflicts.empty()) {
+        return;
+    }
+
+    std::unordered_map<uint256, CTransactionRef> toDelete;
+    {
+        LOCK(mempool.cs);
+        for (const auto& txid : conflicts) {
+            auto tx = mempool.get(txid);
+            if (tx) {
+                toDelete.emplace(txid, tx);
             }
         }
 
@@ -1417,9 +1758,9 @@ void CInstantSendManager::RemoveConflictingLock(const uint256& islockHash, const
 void CInstantSendManager::AskNodesForLockedTx(const uint256& txid)
 {
     std::vector<CNode*> nodesToAskFor;
+    const CPeerSlotSet knownSlots = g_known_inventory.GetKnownSlots(txid);
     g_connman->ForEachNode([&](CNode* pnode) {
-        LOCK(pnode->cs_inventory);
-        if (pnode->filterInventoryKnown.contains(txid)) {
+        if (knownSlots.Contains(pnode->nKnownSlot)) {
             pnode->AddRef();
             nodesToAskFor.emplace_back(pnode);
         }
@@ -1509,9 +1850,12 @@ bool CInstantSendManager::AlreadyHave(const CInv& inv) const
     if (!IsInstantSendEnabled()) {
         return true;
     }
+    if (recentlySeenISLocks.Contains(inv.hash)) {
+        return true;
+    }
 
     LOCK(cs);
-    return pendingInstantSendLocks.count(inv.hash) != 0 || db.KnownInstantSendLock(inv.hash);
+    return pendingInstantSendLocks.count(inv.hash) != 0 || IsVerifiedInstantSendLockQueued(inv.hash) || db.KnownInstantSendLock(inv.hash);
 }
 
 bool CInstantSendManager::GetInstantSendLockByHash(const uint256& hash, llmq::CInstantSendLock& ret) const
@@ -1535,8 +1879,13 @@ CInstantSendLockPtr CInstantSendManager::GetInstantSendLockByTxid(const uint256&
         return nullptr;
     }
 
+    uint256 islockHash;
+    if (!db.GetLockIndex().GetHashByTxid(txid, islockHash)) {
+        return nullptr;
+    }
+
     LOCK(cs);
-    return db.GetInstantSendLockByTxid(txid);
+    return db.GetInstantSendLockByHash(islockHash);
 }
 
 bool CInstantSendManager::GetInstantSendLockHashByTxid(const uint256& txid, uint256& ret) const
@@ -1545,9 +1894,7 @@ bool CInstantSendManager::GetInstantSendLockHashByTxid(const uint256& txid, uint
         return false;
     }
 
-    LOCK(cs);
-    ret = db.GetInstantSendLockHashByTxid(txid);
-    return !ret.IsNull();
+    return db.GetLockIndex().GetHashByTxid(txid, ret);
 }
 
 bool CInstantSendManager::IsLocked(const uint256& txHash) const
@@ -1556,8 +1903,8 @@ bool CInstantSendManager::IsLocked(const uint256& txHash) const
         return false;
     }
 
-    LOCK(cs);
-    return db.KnownInstantSendLock(db.GetInstantSendLockHashByTxid(txHash));
+    uint256 islockHash;
+    return db.GetLockIndex().GetHashByTxid(txHash, islockHash);
 }
 
 bool CInstantSendManager::IsConflicted(const CTransaction& tx) const
@@ -1571,15 +1918,15 @@ CInstantSendLockPtr CInstantSendManager::GetConflictingLock(const CTransaction&
         return nullptr;
     }
 
-    LOCK(cs);
     for (const auto& in : tx.vin) {
-        auto otherIsLock = db.GetInstantSendLockByInput(in.prevout);
-        if (!otherIsLock) {
+        uint256 otherIslockHash, otherTxid;
+        if (!db.GetLockIndex().GetByOutpoint(in.prevout, otherIslockHash, otherTxid)) {
             continue;
         }
 
-        if (otherIsLock->txid != tx.GetHash()) {
-            return otherIsLock;
+        if (otherTxid != tx.GetHash()) {
+            LOCK(cs);
+            return db.GetInstantSendLockByHash(otherIslockHash);
         }
     }
     return nullptr;
@@ -1590,6 +1937,22 @@ size_t CInstantSendManager::GetInstantSendLockCount() const
     return db.GetInstantSendLockCount();
 }
 
+size_t CInstantSendManager::GetNonLockedTxsCount() const
+{
+    LOCK(cs);
+    return nonLockedTxs.size();
+}
+
+size_t CInstantSendManager::GetNonLockedTxsMemoryUsage() const
+{
+    LOCK(cs);
+    size_t usage = memusage::DynamicUsage(nonLockedTxs) + memusage::DynamicUsage(nonLockedTxsByOutpoints);
+    for (const auto& p : nonLockedTxs) {
+        usage += memusage::DynamicUsage(p.second.children);
+    }
+    return usage;
+}
+
 void CInstantSendManager::WorkThreadMain()
 {
     while (!workInterrupt) {
@@ -1602,6 +1965,53 @@ void CInstantSendManager::WorkThreadMain()
     }
 }
 
+void CInstantSendManager::ApplyThreadMain()
+{
+    auto llmqType = Params().GetConsensus().llmqTypeInstantSend;
+
+    while (!workInterrupt) {
+        VerifiedInstantSendLock verified;
+        size_t queueSize;
+        {
+            std::unique_lock<std::mutex> lock(cs_verified);
+            cvVerified.wait(lock, [&] {
+                return !verifiedInstantSendLocks.empty() || workInterrupt;
+            });
+            if (workInterrupt) {
+                return;
+            }
+            verified = std::move(verifiedInstantSendLocks.front());
+            verifiedInstantSendLocks.pop_front();
+            queueSize = verifiedInstantSendLocks.size();
+        }
+        // the verification stage might wait for free space
+        cvVerified.notify_all();
+
+        int64_t nTimeStart = GetTimeMillis();
+        statsClient.timing("instantsend.applyWaitMs", nTimeStart - verified.nTimeVerified, 1.0f);
+        statsClient.gauge("instantsend.verifiedQueueSize", queueSize, 1.0f);
+
+        ProcessInstantSendLock(verified.from, verified.hash, verified.islock);
+
+        // See comment in ProcessPendingInstantSendLocks. We pass a reconstructed recovered sig to the signing manager
+        // to avoid double-verification of the sig.
+        if (verified.recSig && !quorumSigningManager->HasRecoveredSigForId(llmqType, verified.recSig->id)) {
+            verified.recSig->UpdateHash();
+            LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: passing reconstructed recSig to signing mgr, peer=%d\n", __func__,
+                     verified.islock->txid.ToString(), verified.hash.ToString(), verified.from);
+            quorumSigningManager->PushReconstructedRecoveredSig(verified.recSig);
+        }
+
+        {
+            // only remove it now, so that ProcessMessage doesn't accept the same islock again while it's being applied
+            std::lock_guard<std::mutex> lock(cs_verified);
+            verifiedInstantSendLockHashes.erase(verified.hash);
+        }
+
+        statsClient.timing("instantsend.applyMs", GetTimeMillis() - nTimeStart, 1.0f);
+    }
+}
+
 bool IsInstantSendEnabled()
 {
     return !fReindex && !fImporting && sporkManager.IsSporkActive(SPORK_2_INSTANTSEND_ENABLED);
@@ -13,6 +13,10 @@
 #include <threadinterrupt.h>
 #include <chain.h>
 
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -37,6 +41,34 @@ public:
 
 typedef std::shared_ptr<CInstantSendLock> CInstantSendLockPtr;
 
+/**
+ * In-memory index of all islocks stored in CInstantSendDb, by txid and by input. It is split into shards which have their
+ * own locks, so that the very frequent IsLocked and conflict checks neither need CInstantSendManager::cs nor the db.
+ */
+class CInstantSendLockIndex
+{
+private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard {
+        mutable CCriticalSection cs;
+        std::unordered_map<uint256, uint256, StaticSaltedHasher> byTxid GUARDED_BY(cs);
+        // outpoint -> (islock hash, txid of islock)
+        std::unordered_map<COutPoint, std::pair<uint256, uint256>, SaltedOutpointHasher> byOutpoint GUARDED_BY(cs);
+    };
+    std::array<Shard, SHARD_COUNT> shards;
+
+    Shard& GetShard(const uint256& hash) { return shards[hash.GetCheapHash() % SHARD_COUNT]; }
+    const Shard& GetShard(const uint256& hash) const { return shards[hash.GetCheapHash() % SHARD_COUNT]; }
+
+public:
+    void Add(const uint256& islockHash, const CInstantSendLock& islock);
+    void Remove(const uint256& islockHash, const CInstantSendLock& islock);
+
+    bool GetHashByTxid(const uint256& txid, uint256& islockHashRet) const;
+    bool GetByOutpoint(const COutPoint& outpoint, uint256& islockHashRet, uint256& txidRet) const;
+};
+
 class CInstantSendDb
 {
 private:
@@ -50,6 +82,11 @@ private:
     mutable unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 10000> txidCache;
     mutable unordered_lru_cache<COutPoint, uint256, SaltedOutpointHasher, 10000> outpointCache;
 
+    // Kept in sync with the islocks in the db. Unlike the caches above, this can be used without holding any lock
+    CInstantSendLockIndex lockIndex;
+
+    void LoadLockIndex();
+
     void WriteInstantSendLockMined(CDBBatch& batch, const uint256& hash, int nHeight);
     void RemoveInstantSendLockMined(CDBBatch& batch, const uint256& hash, int nHeight);
 
@@ -62,13 +99,15 @@ public:
     void RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock, bool keep_cache = true);
 
     void WriteInstantSendLockMined(const uint256& hash, int nHeight);
-    static void WriteInstantSendLockArchived(CDBBatch& batch, const uint256& hash, int nHeight);
+    void WriteInstantSendLocksArchived(CDBBatch& batch, int nHeight, const std::vector<uint256>& hashes);
     std::unordered_map<uint256, CInstantSendLockPtr> RemoveConfirmedInstantSendLocks(int nUntilHeight);
     void RemoveArchivedInstantSendLocks(int nUntilHeight);
     void WriteBlockInstantSendLocks(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected);
     void RemoveBlockInstantSendLocks(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected);
     bool KnownInstantSendLock(const uint256& islockHash) const;
     size_t GetInstantSendLockCount() const;
+    //! Approximate memory used by the caches, not including the lock index
+    size_t GetCacheMemoryUsage() const;
 
     CInstantSendLockPtr GetInstantSendLockByHash(const uint256& hash, bool use_cache = true) const;
     uint256 GetInstantSendLockHashByTxid(const uint256& txid) const;
@@ -77,19 +116,45 @@ public:
 
     std::vector<uint256> GetInstantSendLocksByParent(const uint256& parent) const;
     std::vector<uint256> RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight);
+
+    const CInstantSendLockIndex& GetLockIndex() const { return lockIndex; }
 };
 
 class CInstantSendManager : public CRecoveredSigsListener
 {
 private:
+    // Maximum number of verified islocks waiting for the apply thread. Verification pauses when this is reached
+    static const size_t MAX_VERIFIED_INSTANTSEND_LOCKS = 256;
+
     mutable CCriticalSection cs;
     CInstantSendDb db;
 
     std::atomic<bool> fUpgradedDB{false};
 
+    // Incoming islocks are processed in stages: ProcessMessage pre-verifies and dedupes them into
+    // pendingInstantSendLocks, workThread batch-verifies them and applyThread writes them to the db, relays them and
+    // resolves conflicts. This way, slow db writes or conflict resolution don't delay verification of the next batch
     std::thread workThread;
+    std::thread applyThread;
     CThreadInterrupt workInterrupt;
 
+    struct VerifiedInstantSendLock {
+        NodeId from;
+        uint256 hash;
+        CInstantSendLockPtr islock;
+        // reconstructed from the islock, see ProcessPendingInstantSendLocks
+        std::shared_ptr<CRecoveredSig> recSig;
+        int64_t nTimeVerified;
+    };
+    // Lock order is cs -> cs_verified
+    mutable std::mutex cs_verified;
+    std::condition_variable cvVerified;
+    std::deque<VerifiedInstantSendLock> verifiedInstantSendLocks GUARDED_BY(cs_verified);
+    std::unordered_set<uint256, StaticSaltedHasher> verifiedInstantSendLockHashes GUARDED_BY(cs_verified);
+
+    // islocks which were written to the db or dropped because of a ChainLock after verification
+    CRecentlySeenHashes recentlySeenISLocks;
+
     /**
      * Request ids of inputs that we signed. Used to determine if a recovered signature belongs to an
      * in-progress input lock.
@@ -110,14 +175,22 @@ private:
 
     // TXs which are neither IS locked nor ChainLocked. We use this to determine for which TXs we need to retry IS locking
     // of child TXs
+    // Entries without tx are parents which are not tracked themselves (e.g. already locked), but still have non-locked
+    // children. pendingParents is the number of distinct parents of tx which are tracked and not locked yet. Children
+    // are only retried when this drops to zero
     struct NonLockedTxInfo {
         const CBlockIndex* pindexMined{nullptr};
         CTransactionRef tx;
         std::unordered_set<uint256, StaticSaltedHasher> children;
+        size_t pendingParents{0};
     };
     std::unordered_map<uint256, NonLockedTxInfo, StaticSaltedHasher> nonLockedTxs GUARDED_BY(cs);
     std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> nonLockedTxsByOutpoints GUARDED_BY(cs);
 
+    // Spent outpoints of all mempool TXs, locked or not. Maintained through the mempool and block notifications, so that
+    // conflicts with a new islock can be found without going through mempool.cs
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mempoolTxsByOutpoint GUARDED_BY(cs);
+
     std::unordered_set<uint256, StaticSaltedHasher> pendingRetryTxs GUARDED_BY(cs);
 
 public:
@@ -144,11 +217,15 @@ private:
     static bool PreVerifyInstantSendLock(const CInstantSendLock& islock);
     bool ProcessPendingInstantSendLocks();
     std::unordered_set<uint256> ProcessPendingInstantSendLocks(int signOffset, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLockPtr>, StaticSaltedHasher>& pend, bool ban);
+    void PushVerifiedInstantSendLock(VerifiedInstantSendLock&& verified);
+    bool IsVerifiedInstantSendLockQueued(const uint256& hash) const;
     void ProcessInstantSendLock(NodeId from, const uint256& hash, const CInstantSendLockPtr& islock);
 
     void AddNonLockedTx(const CTransactionRef& tx, const CBlockIndex* pindexMined);
     void RemoveNonLockedTx(const uint256& txid, bool retryChildren);
     void RemoveConflictedTx(const CTransaction& tx);
+    void AddMempoolTxOutpoints(const CTransaction& tx);
+    void RemoveMempoolTxOutpoints(const CTransaction& tx);
     void TruncateRecoveredSigsForInputs(const CInstantSendLock& islock);
 
     void RemoveMempoolConflictsForLock(const uint256& hash, const CInstantSendLock& islock);
@@ -157,6 +234,7 @@ private:
     void ProcessPendingRetryLockTxs();
 
     void WorkThreadMain();
+    void ApplyThreadMain();
 
     void HandleFullyConfirmedBlock(const CBlockIndex* pindex);
 
@@ -183,7 +261,16 @@ public:
 
     void RemoveConflictingLock(const uint256& islockHash, const CInstantSendLock& islock);
 
+    /**
+     * Queue the islock of a transaction loaded from mempool.dat for verification, unless it's known already. It's
+     * verified like one received from a peer, without signing anything again. Returns false if it wasn't queued.
+     */
+    bool RestoreInstantSendLock(const CInstantSendLockPtr& islock);
+
     size_t GetInstantSendLockCount() const;
+
+    size_t GetNonLockedTxsCount() const;
+    size_t GetNonLockedTxsMemoryUsage() const;
 };
 
 extern CInstantSendManager* quorumInstantSendManager;
@@ -4,17 +4,20 @@
 
 #include <llmq/quorums.h>
 #include <llmq/quorums_commitment.h>
+#include <llmq/quorums_init.h>
 #include <llmq/quorums_signing.h>
 #include <llmq/quorums_utils.h>
 #include <llmq/quorums_signing_shares.h>
 
 #include <masternode/activemasternode.h>
 #include <bls/bls_batchverifier.h>
+#include <bls/bls_sigcache.h>
 #include <chainparams.h>
 #include <cxxtimer.hpp>
 #include <net_processing.h>
 #include <netmessagemaker.h>
 #include <scheduler.h>
+#include <statsd_client.h>
 #include <validation.h>
 
 #include <algorithm>
@@ -38,7 +41,8 @@ UniValue CRecoveredSig::ToJson() const
 }
 
 CRecoveredSigsDb::CRecoveredSigsDb(CDBWrapper& _db) :
-    db(_db)
+    db(_db),
+    pendingBatch(_db)
 {
     if (Params().NetworkIDString() == CBaseChainParams::TESTNET) {
         // TODO this can be completely removed after some time (when we're pretty sure the conversion has been run on most testnet MNs)
@@ -53,6 +57,32 @@ CRecoveredSigsDb::CRecoveredSigsDb(CDBWrapper& _db) :
     }
 }
 
+CRecoveredSigsDb::~CRecoveredSigsDb()
+{
+    if (compactionFuture.valid()) {
+        compactionFuture.wait();
+    }
+    FlushPendingWrites();
+}
+
+void CRecoveredSigsDb::FlushPendingWrites(bool fForce)
+{
+    LOCK(cs);
+    if (pendingBatch.SizeEstimate() == 0) {
+        return;
+    }
+    if (!fForce && GetTimeMillis() - lastFlushTime < PENDING_WRITES_FLUSH_INTERVAL) {
+        return;
+    }
+
+    db.WriteBatch(pendingBatch);
+    pendingBatch.Clear();
+    pendingRecSigs.clear();
+    pendingRecSigsByHash.clear();
+    pendingSignHashes.clear();
+    lastFlushTime = GetTimeMillis();
+}
+
 // This converts time values in "rs_t" from host endianness to big endianness, which is required to have proper ordering of the keys
 void CRecoveredSigsDb::ConvertInvalidTimeKeys()
 {
@@ -128,6 +158,14 @@ void CRecoveredSigsDb::AddVoteTimeKeys()
 
 bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash) const
 {
+    {
+        LOCK(cs);
+        auto it = pendingRecSigs.find(std::make_pair(llmqType, id));
+        if (it != pendingRecSigs.end() && it->second.msgHash == msgHash) {
+            return true;
+        }
+    }
+
     auto k = std::make_tuple(std::string("rs_r"), llmqType, id, msgHash);
     return db.Exists(k);
 }
@@ -141,6 +179,9 @@ bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const
         if (hasSigForIdCache.get(cacheKey, ret)) {
             return ret;
         }
+        if (pendingRecSigs.count(cacheKey)) {
+            return true;
+        }
     }
 
 
@@ -160,6 +201,9 @@ bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
         if (hasSigForSessionCache.get(signHash, ret)) {
             return ret;
         }
+        if (pendingSignHashes.count(signHash)) {
+            return true;
+        }
     }
 
     auto k = std::make_tuple(std::string("rs_s"), signHash);
@@ -178,6 +222,9 @@ bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
         if (hasSigForHashCache.get(hash, ret)) {
             return ret;
         }
+        if (pendingRecSigsByHash.count(hash)) {
+            return true;
+        }
     }
 
     auto k = std::make_tuple(std::string("rs_h"), hash);
@@ -190,6 +237,15 @@ bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
 
 bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret) const
 {
+    {
+        LOCK(cs);
+        auto it = pendingRecSigs.find(std::make_pair(llmqType, id));
+        if (it != pendingRecSigs.end()) {
+            ret = it->second;
+            return true;
+        }
+    }
+
     auto k = std::make_tuple(std::string("rs_r"), llmqType, id);
 
     CDataStream ds(SER_DISK, CLIENT_VERSION);
@@ -207,9 +263,18 @@ bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint
 
 bool CRecoveredSigsDb::GetRecoveredSigByHash(const uint256& hash, CRecoveredSig& ret)
 {
-    auto k1 = std::make_tuple(std::string("rs_h"), hash);
     std::pair<Consensus::LLMQType, uint256> k2;
-    if (!db.Read(k1, k2)) {
+    bool pending;
+    {
+        LOCK(cs);
+        auto it = pendingRecSigsByHash.find(hash);
+        pending = it != pendingRecSigsByHash.end();
+        if (pending) {
+            k2 = it->second;
+        }
+    }
+    auto k1 = std::make_tuple(std::string("rs_h"), hash);
+    if (!pending && !db.Read(k1, k2)) {
         return false;
     }
 
@@ -223,7 +288,8 @@ bool CRecoveredSigsDb::GetRecoveredSigById(Consensus::LLMQType llmqType, const u
 
 void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
 {
-    CDBBatch batch(db);
+    LOCK(cs);
+    auto& batch = pendingBatch;
 
     uint32_t curTime = GetAdjustedTime();
 
@@ -248,13 +314,16 @@ void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
     auto k5 = std::make_tuple(std::string("rs_t"), (uint32_t)htobe32(curTime), recSig.llmqType, recSig.id);
     batch.Write(k5, (uint8_t)1);
 
-    db.WriteBatch(batch);
+    pendingRecSigs.emplace(std::make_pair(recSig.llmqType, recSig.id), recSig);
+    pendingRecSigsByHash.emplace(recSig.GetHash(), std::make_pair(recSig.llmqType, recSig.id));
+    pendingSignHashes.emplace(signHash);
 
-    {
-        LOCK(cs);
-        hasSigForIdCache.insert(std::make_pair(recSig.llmqType, recSig.id), true);
-        hasSigForSessionCache.insert(signHash, true);
-        hasSigForHashCache.insert(recSig.GetHash(), true);
+    hasSigForIdCache.insert(std::make_pair(recSig.llmqType, recSig.id), true);
+    hasSigForSessionCache.insert(signHash, true);
+    hasSigForHashCache.insert(recSig.GetHash(), true);
+
+    if (batch.SizeEstimate() >= PENDING_WRITES_MAX_SIZE) {
+        FlushPendingWrites();
     }
 }
 
@@ -302,6 +371,8 @@ void CRecoveredSigsDb::RemoveRecoveredSig(CDBBatch& batch, Consensus::LLMQType l
 void CRecoveredSigsDb::RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
 {
     LOCK(cs);
+    // make sure that the keys we delete are actually in the db
+    FlushPendingWrites();
     CDBBatch batch(db);
     RemoveRecoveredSig(batch, llmqType, id, true, true);
     db.WriteBatch(batch);
@@ -312,6 +383,7 @@ void CRecoveredSigsDb::RemoveRecoveredSig(Consensus::LLMQType llmqType, const ui
 void CRecoveredSigsDb::TruncateRecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
 {
     LOCK(cs);
+    FlushPendingWrites();
     CDBBatch batch(db);
     RemoveRecoveredSig(batch, llmqType, id, false, false);
     db.WriteBatch(batch);
@@ -319,6 +391,8 @@ void CRecoveredSigsDb::TruncateRecoveredSig(Consensus::LLMQType llmqType, const
 
 void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
 {
+    FlushPendingWrites();
+
     std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
 
     auto start = std::make_tuple(std::string("rs_t"), (uint32_t)0, (Consensus::LLMQType)0, uint256());
@@ -326,7 +400,6 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
     pcursor->Seek(start);
 
     std::vector<std::pair<Consensus::LLMQType, uint256>> toDelete;
-    std::vector<decltype(start)> toDelete2;
 
     while (pcursor->Valid()) {
         decltype(start) k;
@@ -339,7 +412,6 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
         }
 
         toDelete.emplace_back(std::get<2>(k), std::get<3>(k));
-        toDelete2.emplace_back(k);
 
         pcursor->Next();
     }
@@ -362,17 +434,22 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
         }
     }
 
-    for (const auto& e : toDelete2) {
-        batch.Erase(e);
-    }
-
     db.WriteBatch(batch);
 
+    // the time keys are ordered, so we can remove all of them in one go
+    auto end = std::make_tuple(std::string("rs_t"), (uint32_t)htobe32(endTime), (Consensus::LLMQType)0, uint256());
+    db.EraseRange(start, end);
+
+    // 4 keys per recovered sig (rs_r twice, rs_h, rs_s) plus the time key
+    deletedKeysSinceCompaction += toDelete.size() * 5;
+    MaybeCompactCleanedUpRanges();
+
     LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%d -- deleted %d entries\n", __func__, toDelete.size());
 }
 
 bool CRecoveredSigsDb::HasVotedOnId(Consensus::LLMQType llmqType, const uint256& id) const
 {
+    // votes are never pending (see WriteVoteForId)
     auto k = std::make_tuple(std::string("rs_v"), llmqType, id);
     return db.Exists(k);
 }
@@ -388,15 +465,18 @@ void CRecoveredSigsDb::WriteVoteForId(Consensus::LLMQType llmqType, const uint25
     auto k1 = std::make_tuple(std::string("rs_v"), llmqType, id);
     auto k2 = std::make_tuple(std::string("rs_vt"), (uint32_t)htobe32(GetAdjustedTime()), llmqType, id);
 
-    CDBBatch batch(db);
-    batch.Write(k1, msgHash);
-    batch.Write(k2, (uint8_t)1);
-
-    db.WriteBatch(batch);
+    // Votes must never get lost as we would otherwise risk voting for a different msgHash after a restart. So instead
+    // of delaying the vote, we flush it together with all pending recovered sigs
+    LOCK(cs);
+    pendingBatch.Write(k1, msgHash);
+    pendingBatch.Write(k2, (uint8_t)1);
+    FlushPendingWrites();
 }
 
 void CRecoveredSigsDb::CleanupOldVotes(int64_t maxAge)
 {
+    FlushPendingWrites();
+
     std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
 
     auto start = std::make_tuple(std::string("rs_vt"), (uint32_t)0, (Consensus::LLMQType)0, uint256());
@@ -418,7 +498,6 @@ void CRecoveredSigsDb::CleanupOldVotes(int64_t maxAge)
         Consensus::LLMQType llmqType = std::get<2>(k);
         const uint256& id = std::get<3>(k);
 
-        batch.Erase(k);
         batch.Erase(std::make_tuple(std::string("rs_v"), llmqType, id));
 
         cnt++;
@@ -433,9 +512,44 @@ void CRecoveredSigsDb::CleanupOldVotes(int64_t maxAge)
 
     db.WriteBatch(batch);
 
+    auto end = std::make_tuple(std::string("rs_vt"), (uint32_t)htobe32(endTime), (Consensus::LLMQType)0, uint256());
+    db.EraseRange(start, end);
+
+    deletedKeysSinceCompaction += cnt * 2;
+    MaybeCompactCleanedUpRanges();
+
     LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%d -- deleted %d entries\n", __func__, cnt);
 }
 
+void CRecoveredSigsDb::MaybeCompactCleanedUpRanges()
+{
+    if (deletedKeysSinceCompaction < COMPACTION_MIN_DELETED_KEYS) {
+        return;
+    }
+    if (GetTimeMillis() - lastCompactionTime < COMPACTION_INTERVAL) {
+        return;
+    }
+    if (compactionFuture.valid() && compactionFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%s -- compacting after %d deleted keys\n", __func__, deletedKeysSinceCompaction);
+
+    deletedKeysSinceCompaction = 0;
+    lastCompactionTime = GetTimeMillis();
+
+    // Compaction can take a while, so we do it in the background. Only the time keys are ordered by age, all other keys
+    // are spread over the whole range of their prefix
+    compactionFuture = std::async(std::launch::async, [this] {
+        util::ThreadRename("llmq-compact");
+        uint256 maxHash;
+        memset(maxHash.begin(), 0xff, maxHash.size());
+        for (const char* prefix : {"rs_r", "rs_h", "rs_s", "rs_t", "rs_v", "rs_vt"}) {
+            db.CompactRange(std::make_tuple(std::string(prefix), uint256(), uint256()), std::make_tuple(std::string(prefix), maxHash, maxHash));
+        }
+    });
+}
+
 //////////////////
 
 CSigningManager::CSigningManager(CDBWrapper& llmqDb, bool fMemory) :
@@ -448,6 +562,9 @@ bool CSigningManager::AlreadyHave(const CInv& inv)
     if (inv.type != MSG_QUORUM_RECOVERED_SIG) {
         return false;
     }
+    if (recentlySeenRecSigs.Contains(inv.hash)) {
+        return true;
+    }
     {
         LOCK(cs);
         if (pendingReconstructedRecoveredSigs.count(inv.hash)) {
@@ -473,6 +590,12 @@ bool CSigningManager::GetRecoveredSigForGetData(const uint256& hash, CRecoveredS
 void CSigningManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
 {
     if (strCommand == NetMsgType::QSIGREC) {
+        uint256 hash;
+        if (recentlySeenRecSigs.ContainsMessage(vRecv, hash)) {
+            LOCK(cs_main);
+            EraseObjectRequest(pfrom->GetId(), CInv(MSG_QUORUM_RECOVERED_SIG, hash));
+            return;
+        }
         auto recoveredSig = std::make_shared<CRecoveredSig>();
         vRecv >> *recoveredSig;
         ProcessMessageRecoveredSig(pfrom, recoveredSig);
@@ -633,7 +756,16 @@ bool CSigningManager::ProcessPendingRecoveredSigs()
     // craftable by individual entities, making the rogue public key attack impossible
     CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false);
 
+    std::vector<const CBLSLazySignature*> lazySigs;
+    for (const auto& p : recSigsByNode) {
+        for (const auto& recSig : p.second) {
+            lazySigs.emplace_back(&recSig->sig);
+        }
+    }
+    blsWorker->DecodeLazySignatures(lazySigs);
+
     size_t verifyCount = 0;
+    size_t alreadyVerified = 0;
     for (const auto& p : recSigsByNode) {
         NodeId nodeId = p.first;
         const auto& v = p.second;
@@ -646,7 +778,14 @@ bool CSigningManager::ProcessPendingRecoveredSigs()
             }
 
             const auto& quorum = quorums.at(std::make_pair(recSig->llmqType, recSig->quorumHash));
-            batchVerifier.PushMessage(nodeId, recSig->GetHash(), CLLMQUtils::BuildSignHash(*recSig), recSig->sig.Get(), quorum->qc->quorumPublicKey);
+            uint256 signHash = CLLMQUtils::BuildSignHash(*recSig);
+            // The batch is aggregated without random weights, so its results are never added to the cache. Only
+            // signatures which were verified on their own, e.g. by VerifyRecoveredSig, can be skipped here.
+            if (CBLSSigCacheEntry(quorum->qc->quorumPublicKey, signHash, recSig->sig.Get()).IsCached()) {
+                alreadyVerified++;
+                continue;
+            }
+            batchVerifier.PushMessage(nodeId, recSig->GetHash(), signHash, recSig->sig.Get(), quorum->qc->quorumPublicKey);
             verifyCount++;
         }
     }
@@ -654,8 +793,9 @@ bool CSigningManager::ProcessPendingRecoveredSigs()
     cxxtimer::Timer verifyTimer(true);
     batchVerifier.Verify();
     verifyTimer.stop();
+    statsClient.histogram("llmq.recsigs.verifyBatchSize", verifyCount);
 
-    LogPrint(BCLog::LLMQ, "CSigningManager::%s -- verified recovered sig(s). count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), recSigsByNode.size());
+    LogPrint(BCLog::LLMQ, "CSigningManager::%s -- verified recovered sig(s). count=%d, alreadyVerified=%d, vt=%d, nodes=%d\n", __func__, verifyCount, alreadyVerified, verifyTimer.count(), recSigsByNode.size());
 
     std::unordered_set<uint256, StaticSaltedHasher> processed;
     for (const auto& p : recSigsByNode) {
@@ -723,6 +863,7 @@ void CSigningManager::ProcessRecoveredSig(const std::shared_ptr<const CRecovered
         }
 
         db.WriteRecoveredSig(*recoveredSig);
+        recentlySeenRecSigs.Add(recoveredSig->GetHash());
 
         pendingReconstructedRecoveredSigs.erase(recoveredSig->GetHash());
     }
@@ -756,6 +897,8 @@ void CSigningManager::TruncateRecoveredSig(Consensus::LLMQType llmqType, const u
 
 void CSigningManager::Cleanup()
 {
+    db.FlushPendingWrites(false);
+
     int64_t now = GetTimeMillis();
     if (now - lastCleanupTime < 5000) {
         return;
@@ -897,10 +1040,49 @@ bool CSigningManager::GetVoteForId(Consensus::LLMQType llmqType, const uint256&
     return db.GetVoteForId(llmqType, id, msgHashRet);
 }
 
-CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType, const uint256& selectionHash, int signHeight, int signOffset)
+namespace {
+// The quorums which are eligible for signing at one block, together with hash writers which already contain the
+// llmqType and the quorum hash, so that scoring them for a request only needs to hash the selection hash
+struct QuorumSelection {
+    std::vector<CQuorumCPtr> quorums;
+    std::vector<CHashWriter> scoreWriters;
+};
+typedef std::shared_ptr<const QuorumSelection> QuorumSelectionPtr;
+} // namespace
+
+// Keyed by the block the scan starts at, so entries never become invalid. Sign and verification heights are usually
+// close to the tip, so only a few blocks are needed at the same time
+static CCriticalSection cs_quorumSelectionCache;
+static unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, QuorumSelectionPtr, StaticSaltedHasher, 64> quorumSelectionCache GUARDED_BY(cs_quorumSelectionCache);
+
+static QuorumSelectionPtr GetQuorumSelection(Consensus::LLMQType llmqType, const CBlockIndex* pindexStart)
 {
-    size_t poolSize = GetLLMQParams(llmqType).signingActiveQuorumCount;
+    auto cacheKey = std::make_pair(llmqType, pindexStart->GetBlockHash());
+    QuorumSelectionPtr selection;
+    {
+        LOCK(cs_quorumSelectionCache);
+        if (quorumSelectionCache.get(cacheKey, selection)) {
+            return selection;
+        }
+    }
+
+    auto newSelection = std::make_shared<QuorumSelection>();
+    newSelection->quorums = quorumManager->ScanQuorums(llmqType, pindexStart, GetLLMQParams(llmqType).signingActiveQuorumCount);
+    newSelection->scoreWriters.reserve(newSelection->quorums.size());
+    for (const auto& quorum : newSelection->quorums) {
+        CHashWriter h(SER_NETWORK, 0);
+        h << llmqType;
+        h << quorum->qc->quorumHash;
+        newSelection->scoreWriters.emplace_back(std::move(h));
+    }
+
+    LOCK(cs_quorumSelectionCache);
+    quorumSelectionCache.insert(cacheKey, newSelection);
+    return newSelection;
+}
 
+CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType, const uint256& selectionHash, int signHeight, int signOffset)
+{
     CBlockIndex* pindexStart;
     {
         LOCK(cs_main);
@@ -914,22 +1096,24 @@ CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType
         pindexStart = chainActive[startBlockHeight];
     }
 
-    auto quorums = quorumManager->ScanQuorums(llmqType, pindexStart, poolSize);
-    if (quorums.empty()) {
+    auto selection = GetQuorumSelection(llmqType, pindexStart);
+    if (selection->quorums.empty()) {
         return nullptr;
     }
 
-    std::vector<std::pair<uint256, size_t>> scores;
-    scores.reserve(quorums.size());
-    for (size_t i = 0; i < quorums.size(); i++) {
-        CHashWriter h(SER_NETWORK, 0);
-        h << llmqType;
-        h << quorums[i]->qc->quorumHash;
+    // the quorum with the lowest score wins
+    size_t bestIndex = 0;
+    uint256 bestScore;
+    for (size_t i = 0; i < selection->quorums.size(); i++) {
+        CHashWriter h(selection->scoreWriters[i]);
         h << selectionHash;
-        scores.emplace_back(h.GetHash(), i);
+        uint256 score = h.GetHash();
+        if (i == 0 || score < bestScore) {
+            bestIndex = i;
+            bestScore = score;
+        }
     }
-    std::sort(scores.begin(), scores.end());
-    return quorums[scores.front().second];
+    return selection->quorums[bestIndex];
 }
 
 bool CSigningManager::VerifyRecoveredSig(Consensus::LLMQType llmqType, int signedAtHeight, const uint256& id, const uint256& msgHash, const CBLSSignature& sig, const int signOffset)
@@ -940,7 +1124,7 @@ bool CSigningManager::VerifyRecoveredSig(Consensus::LLMQType llmqType, int signe
     }
 
     uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc->quorumHash, id, msgHash);
-    return sig.VerifyInsecure(quorum->qc->quorumPublicKey, signHash);
+    return VerifyBLSSigCached(sig, quorum->qc->quorumPublicKey, signHash);
 }
 
 } // namespace llmq
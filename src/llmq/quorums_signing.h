@@ -8,13 +8,17 @@
 #include <bls/bls.h>
 
 #include <consensus/params.h>
+#include <hash.h>
 #include <saltedhasher.h>
+#include <streams.h>
 #include <univalue.h>
 #include <unordered_lru_cache.h>
 
 #include <evo/evodb.h>
 
+#include <future>
 #include <unordered_map>
+#include <unordered_set>
 #include <sync.h>
 #include <random.h>
 
@@ -66,18 +70,75 @@ public:
     UniValue ToJson() const;
 };
 
+/**
+ * Hashes of recently seen valid recovered sigs or islocks. AlreadyHave and ProcessMessage consult it before any db access
+ * and before deserializing a message, so that the same object announced or sent by many peers is dropped early. It has
+ * its own lock, so these duplicates don't contend for the locks of the managers and dbs.
+ */
+class CRecentlySeenHashes
+{
+private:
+    mutable CCriticalSection cs;
+    mutable unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hashes GUARDED_BY(cs);
+
+public:
+    void Add(const uint256& hash)
+    {
+        LOCK(cs);
+        hashes.insert(hash, true);
+    }
+    bool Contains(const uint256& hash) const
+    {
+        LOCK(cs);
+        return hashes.exists(hash);
+    }
+    // The hash of these objects is the hash of their serialization, so it can be taken from the receive buffer. Trailing
+    // garbage leads to a different hash, such messages just take the slow path
+    bool ContainsMessage(const CDataStream& vRecv, uint256& hashRet) const
+    {
+        hashRet = Hash(vRecv.begin(), vRecv.end());
+        return Contains(hashRet);
+    }
+};
+
 class CRecoveredSigsDb
 {
 private:
+    // Recovered sigs are not written one by one but collected in pendingBatch, which is flushed after this time...
+    static const int64_t PENDING_WRITES_FLUSH_INTERVAL = 100;
+    // ...or when it reaches this size
+    static const size_t PENDING_WRITES_MAX_SIZE = 1 << 20;
+
+    // Cleanup leaves lots of tombstones in the db. When enough keys were deleted, the affected key ranges are compacted
+    // in the background, but not more often than COMPACTION_INTERVAL
+    static const size_t COMPACTION_MIN_DELETED_KEYS = 100000;
+    static const int64_t COMPACTION_INTERVAL = 60 * 60 * 1000;
+
     CDBWrapper& db;
 
-    CCriticalSection cs;
+    mutable CCriticalSection cs;
     unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher, 30000> hasSigForIdCache GUARDED_BY(cs);
     unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForSessionCache GUARDED_BY(cs);
     unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForHashCache GUARDED_BY(cs);
 
+    // Not yet flushed writes. The read paths look into the maps below before going to the db
+    CDBBatch pendingBatch GUARDED_BY(cs);
+    int64_t lastFlushTime GUARDED_BY(cs){0};
+    std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CRecoveredSig, StaticSaltedHasher> pendingRecSigs GUARDED_BY(cs);
+    std::unordered_map<uint256, std::pair<Consensus::LLMQType, uint256>, StaticSaltedHasher> pendingRecSigsByHash GUARDED_BY(cs);
+    std::unordered_set<uint256, StaticSaltedHasher> pendingSignHashes GUARDED_BY(cs);
+
+    // Only accessed from the cleanup methods, which are called from the worker thread of CSigSharesManager
+    size_t deletedKeysSinceCompaction{0};
+    int64_t lastCompactionTime{0};
+    std::future<void> compactionFuture;
+
 public:
     explicit CRecoveredSigsDb(CDBWrapper& _db);
+    ~CRecoveredSigsDb();
+
+    // Writes all pending writes to the db. If fForce is false, this only happens when the flush interval has passed
+    void FlushPendingWrites(bool fForce = true);
 
     void ConvertInvalidTimeKeys();
     void AddVoteTimeKeys();
@@ -102,6 +163,8 @@ public:
     void CleanupOldVotes(int64_t maxAge);
 
 private:
+    void MaybeCompactCleanedUpRanges();
+
     bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret) const;
     void RemoveRecoveredSig(CDBBatch& batch, Consensus::LLMQType llmqType, const uint256& id, bool deleteHashKey, bool deleteTimeKey);
 };
@@ -134,6 +197,8 @@ private:
 
     FastRandomContext rnd GUARDED_BY(cs);
 
+    CRecentlySeenHashes recentlySeenRecSigs;
+
     int64_t lastCleanupTime{0};
 
     std::vector<CRecoveredSigsListener*> recoveredSigsListeners GUARDED_BY(cs);
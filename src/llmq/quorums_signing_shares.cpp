@@ -4,6 +4,7 @@
 
 #include <llmq/quorums.h>
 #include <llmq/quorums_commitment.h>
+#include <llmq/quorums_init.h>
 #include <llmq/quorums_signing.h>
 #include <llmq/quorums_signing_shares.h>
 #include <llmq/quorums_utils.h>
@@ -15,6 +16,9 @@
 #include <net_processing.h>
 #include <netmessagemaker.h>
 #include <spork.h>
+#include <statsd_client.h>
+#include <util/memaccounting.h>
+#include <util/trace.h>
 #include <validation.h>
 
 #include <cxxtimer.hpp>
@@ -38,23 +42,20 @@ std::string CSigSesAnn::ToString() const
 
 void CSigSharesInv::Merge(const CSigSharesInv& inv2)
 {
-    for (size_t i = 0; i < inv.size(); i++) {
-        if (inv2.inv[i]) {
-            inv[i] = inv2.inv[i];
-        }
-    }
+    assert(inv2.size <= size);
+    inv |= inv2.inv;
 }
 
 size_t CSigSharesInv::CountSet() const
 {
-    return (size_t)std::count(inv.begin(), inv.end(), true);
+    return inv.count();
 }
 
 std::string CSigSharesInv::ToString() const
 {
     std::string str = "(";
     bool first = true;
-    for (size_t i = 0; i < inv.size(); i++) {
+    for (size_t i = 0; i < size; i++) {
         if (!inv[i]) {
             continue;
         }
@@ -69,35 +70,58 @@ std::string CSigSharesInv::ToString() const
     return str;
 }
 
-void CSigSharesInv::Init(size_t size)
+void CSigSharesInv::Init(size_t _size)
 {
-    inv.resize(size, false);
+    assert(_size <= Consensus::MAX_LLMQ_SIZE);
+    size = (uint16_t)_size;
 }
 
 bool CSigSharesInv::IsSet(uint16_t quorumMember) const
 {
-    assert(quorumMember < inv.size());
+    assert(quorumMember < size);
     return inv[quorumMember];
 }
 
 void CSigSharesInv::Set(uint16_t quorumMember, bool v)
 {
-    assert(quorumMember < inv.size());
+    assert(quorumMember < size);
     inv[quorumMember] = v;
 }
 
 void CSigSharesInv::SetAll(bool v)
 {
-    for (size_t i = 0; i < inv.size(); i++) {
-        inv[i] = v;
+    inv.reset();
+    if (v) {
+        for (size_t i = 0; i < size; i++) {
+            inv.set(i);
+        }
+    }
+}
+
+std::vector<bool> CSigSharesInv::ToVector() const
+{
+    std::vector<bool> vec(size);
+    for (size_t i = 0; i < size; i++) {
+        vec[i] = inv[i];
+    }
+    return vec;
+}
+
+void CSigSharesInv::FromVector(const std::vector<bool>& vec)
+{
+    assert(vec.size() <= Consensus::MAX_LLMQ_SIZE);
+    size = (uint16_t)vec.size();
+    inv.reset();
+    for (size_t i = 0; i < vec.size(); i++) {
+        inv[i] = vec[i];
     }
 }
 
 std::string CBatchedSigShares::ToInvString() const
 {
     CSigSharesInv inv;
-    // we use 400 here no matter what the real size is. We don't really care about that size as we just want to call ToString()
-    inv.Init(400);
+    // we use the maximum size here no matter what the real size is. We don't really care about that size as we just want to call ToString()
+    inv.Init(Consensus::MAX_LLMQ_SIZE);
     for (size_t i = 0; i < sigShares.size(); i++) {
         inv.inv[sigShares[i].first] = true;
     }
@@ -122,7 +146,7 @@ static void InitSession(CSigSharesNodeState::Session& s, const uint256& signHash
 CSigSharesNodeState::Session& CSigSharesNodeState::GetOrCreateSessionFromShare(const llmq::CSigShare& sigShare)
 {
     auto& s = sessions[sigShare.GetSignHash()];
-    if (s.announced.inv.empty()) {
+    if (!s.announced.IsInitialized()) {
         InitSession(s, sigShare.GetSignHash(), sigShare);
     }
     return s;
@@ -132,7 +156,7 @@ CSigSharesNodeState::Session& CSigSharesNodeState::GetOrCreateSessionFromAnn(con
 {
     auto signHash = CLLMQUtils::BuildSignHash(ann.llmqType, ann.quorumHash, ann.id, ann.msgHash);
     auto& s = sessions[signHash];
-    if (s.announced.inv.empty()) {
+    if (!s.announced.IsInitialized()) {
         InitSession(s, signHash, ann);
     }
     return s;
@@ -180,17 +204,44 @@ void CSigSharesNodeState::RemoveSession(const uint256& signHash)
         sessions.erase(it);
     }
     requestedSigShares.EraseAllForSignHash(signHash);
-    pendingIncomingSigShares.EraseAllForSignHash(signHash);
 }
 
 //////////////////////
 
-CSigSharesManager::CSigSharesManager()
+size_t CSigSharesNodeState::DynamicMemoryUsage() const
+{
+    // the invs of the sessions are stored inline and accounted for by the map
+    return memusage::DynamicUsage(sessions) + memusage::DynamicUsage(sessionByRecvId) + requestedSigShares.DynamicMemoryUsage();
+}
+
+CSigSharesManager::CSigSharesManager(CBLSWorker& _blsWorker) :
+    blsWorker(_blsWorker)
 {
     workInterrupt.reset();
+    memaccounting::Register("llmq.sigshares", this, [this]() {
+        size_t nUsage;
+        {
+            LOCK(cs);
+            nUsage = sigShares.DynamicMemoryUsage() + memusage::DynamicUsage(signedSessions) +
+                     memusage::DynamicUsage(timeSeenForSessions) + memusage::DynamicUsage(timeStartedForSessions) +
+                     memusage::DynamicUsage(nodeStates) + sigSharesRequested.DynamicMemoryUsage() +
+                     sigSharesQueuedToAnnounce.DynamicMemoryUsage();
+            for (const auto& p : nodeStates) {
+                nUsage += p.second.DynamicMemoryUsage();
+            }
+        }
+        LOCK(cs_pendingIncoming);
+        for (const auto& p : pendingIncomingSigShares) {
+            nUsage += p.second.DynamicMemoryUsage();
+        }
+        return nUsage + memusage::DynamicUsage(pendingIncomingSigShares);
+    });
 }
 
-CSigSharesManager::~CSigSharesManager() = default;
+CSigSharesManager::~CSigSharesManager()
+{
+    memaccounting::Unregister(this);
+}
 
 void CSigSharesManager::StartWorkerThread()
 {
@@ -254,14 +305,14 @@ void CSigSharesManager::ProcessMessage(CNode* pfrom, const std::string& strComma
     }
 
     if (strCommand == NetMsgType::QSIGSESANN) {
-        std::vector<CSigSesAnn> msgs;
+        CBatchedSigSesAnns msgs;
         vRecv >> msgs;
-        if (msgs.size() > MAX_MSGS_CNT_QSIGSESANN) {
-            LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- too many announcements in QSIGSESANN message. cnt=%d, max=%d, node=%d\n", __func__, msgs.size(), MAX_MSGS_CNT_QSIGSESANN, pfrom->GetId());
+        if (msgs.anns.size() > MAX_MSGS_CNT_QSIGSESANN) {
+            LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- too many announcements in QSIGSESANN message. cnt=%d, max=%d, node=%d\n", __func__, msgs.anns.size(), MAX_MSGS_CNT_QSIGSESANN, pfrom->GetId());
             BanNode(pfrom->GetId());
             return;
         }
-        for (const auto& ann : msgs) {
+        for (const auto& ann : msgs.anns) {
             if (!ProcessMessageSigSesAnn(pfrom, ann)) {
                 BanNode(pfrom->GetId());
                 return;
@@ -350,7 +401,7 @@ bool CSigSharesManager::ProcessMessageSigSesAnn(CNode* pfrom, const CSigSesAnn&
 
 bool CSigSharesManager::VerifySigSharesInv(Consensus::LLMQType llmqType, const CSigSharesInv& inv)
 {
-    return inv.inv.size() == GetLLMQParams(llmqType).size;
+    return inv.size == GetLLMQParams(llmqType).size;
 }
 
 bool CSigSharesManager::ProcessMessageSigSharesInv(CNode* pfrom, const CSigSharesInv& inv)
@@ -372,6 +423,7 @@ bool CSigSharesManager::ProcessMessageSigSharesInv(CNode* pfrom, const CSigShare
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- signHash=%s, inv={%s}, node=%d\n", __func__,
             sessionInfo.signHash.ToString(), inv.ToString(), pfrom->GetId());
 
+    quorumManager->EnsureQuorumContributions(sessionInfo.quorum);
     if (sessionInfo.quorum->quorumVvec == nullptr) {
         // TODO we should allow to ask other nodes for the quorum vvec if we missed it in the DKG
         LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- we don't have the quorum vvec for %s, not requesting sig shares. node=%d\n", __func__,
@@ -467,10 +519,10 @@ bool CSigSharesManager::ProcessMessageBatchedSigShares(CNode* pfrom, const CBatc
         return true;
     }
 
-    LOCK(cs);
-    auto& nodeState = nodeStates[pfrom->GetId()];
+    LOCK(cs_pendingIncoming);
+    auto& pendingSigShares = pendingIncomingSigShares[pfrom->GetId()];
     for (const auto& s : sigShares) {
-        nodeState.pendingIncomingSigShares.Add(s.GetKey(), s);
+        pendingSigShares.Add(s.GetKey(), s);
     }
     return true;
 }
@@ -489,6 +541,7 @@ void CSigSharesManager::ProcessMessageSigShare(NodeId fromId, const CSigShare& s
         // we're not a member so we can't verify it (we actually shouldn't have received it)
         return;
     }
+    quorumManager->EnsureQuorumContributions(quorum);
     if (quorum->quorumVvec == nullptr) {
         // TODO we should allow to ask other nodes for the quorum vvec if we missed it in the DKG
         LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- we don't have the quorum vvec for %s, no verification possible. node=%d\n", __func__,
@@ -507,19 +560,14 @@ void CSigSharesManager::ProcessMessageSigShare(NodeId fromId, const CSigShare& s
         return;
     }
 
-    {
-        LOCK(cs);
-
-        if (sigShares.Has(sigShare.GetKey())) {
-            return;
-        }
-
-        if (quorumSigningManager->HasRecoveredSigForId(sigShare.llmqType, sigShare.id)) {
-            return;
-        }
+    if (quorumSigningManager->HasRecoveredSigForId(sigShare.llmqType, sigShare.id)) {
+        return;
+    }
 
-        auto& nodeState = nodeStates[fromId];
-        nodeState.pendingIncomingSigShares.Add(sigShare.GetKey(), sigShare);
+    {
+        // Sig shares we already have are filtered out in CollectPendingSigSharesToVerify, so we don't need cs here
+        LOCK(cs_pendingIncoming);
+        pendingIncomingSigShares[fromId].Add(sigShare.GetKey(), sigShare);
     }
 
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- signHash=%s, id=%s, msgHash=%s, member=%d, node=%d\n", __func__,
@@ -538,6 +586,7 @@ bool CSigSharesManager::PreVerifyBatchedSigShares(const CSigSharesNodeState::Ses
         // we're not a member so we can't verify it (we actually shouldn't have received it)
         return false;
     }
+    quorumManager->EnsureQuorumContributions(session.quorum);
     if (session.quorum->quorumVvec == nullptr) {
         // TODO we should allow to ask other nodes for the quorum vvec if we missed it in the DKG
         LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- we don't have the quorum vvec for %s, no verification possible.\n", __func__,
@@ -575,7 +624,8 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
 {
     {
         LOCK(cs);
-        if (nodeStates.empty()) {
+        LOCK(cs_pendingIncoming);
+        if (pendingIncomingSigShares.empty()) {
             return;
         }
 
@@ -586,13 +636,13 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
         // the whole verification process
 
         std::unordered_set<std::pair<NodeId, uint256>, StaticSaltedHasher> uniqueSignHashes;
-        CLLMQUtils::IterateNodesRandom(nodeStates, [&]() {
+        CLLMQUtils::IterateNodesRandom(pendingIncomingSigShares, [&]() {
             return uniqueSignHashes.size() < maxUniqueSessions;
-        }, [&](NodeId nodeId, CSigSharesNodeState& ns) {
-            if (ns.pendingIncomingSigShares.Empty()) {
+        }, [&](NodeId nodeId, SigShareMap<CSigShare>& pendingSigShares) {
+            if (pendingSigShares.Empty()) {
                 return false;
             }
-            auto& sigShare = *ns.pendingIncomingSigShares.GetFirst();
+            auto& sigShare = *pendingSigShares.GetFirst();
 
             AssertLockHeld(cs);
             bool alreadyHave = this->sigShares.Has(sigShare.GetKey());
@@ -600,9 +650,17 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
                 uniqueSignHashes.emplace(nodeId, sigShare.GetSignHash());
                 retSigShares[nodeId].emplace_back(sigShare);
             }
-            ns.pendingIncomingSigShares.Erase(sigShare.GetKey());
-            return !ns.pendingIncomingSigShares.Empty();
-        }, rnd);
+            pendingSigShares.Erase(sigShare.GetKey());
+            return !pendingSigShares.Empty();
+        }, rndPendingIncoming);
+
+        for (auto it = pendingIncomingSigShares.begin(); it != pendingIncomingSigShares.end(); ) {
+            if (it->second.Empty()) {
+                it = pendingIncomingSigShares.erase(it);
+            } else {
+                ++it;
+            }
+        }
 
         if (retSigShares.empty()) {
             return;
@@ -647,6 +705,15 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
     CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
 
     cxxtimer::Timer prepareTimer(true);
+    // The sig shares were only unserialized so far. Decode all of them in parallel before checking them one by one
+    std::vector<const CBLSLazySignature*> lazySigs;
+    for (const auto& p : sigSharesByNodes) {
+        for (const auto& sigShare : p.second) {
+            lazySigs.emplace_back(&sigShare.sigShare);
+        }
+    }
+    blsWorker.DecodeLazySignatures(lazySigs);
+
     size_t verifyCount = 0;
     for (auto& p : sigSharesByNodes) {
         auto nodeId = p.first;
@@ -684,6 +751,7 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
     cxxtimer::Timer verifyTimer(true);
     batchVerifier.Verify();
     verifyTimer.stop();
+    statsClient.histogram("llmq.sigs.verifyBatchSize", verifyCount);
 
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- verified sig shares. count=%d, pt=%d, vt=%d, nodes=%d\n", __func__, verifyCount, prepareTimer.count(), verifyTimer.count(), sigSharesByNodes.size());
 
@@ -750,6 +818,9 @@ void CSigSharesManager::ProcessSigShare(const CSigShare& sigShare, CConnman& con
 
         // Update the time we've seen the last sigShare
         timeSeenForSessions[sigShare.GetSignHash()] = GetAdjustedTime();
+        if (timeStartedForSessions.emplace(sigShare.GetSignHash(), GetTimeMillis()).second) {
+            TRACE3(llmq, sigshares_session_started, sigShare.GetSignHash().begin(), llmqType, sigShare.quorumMember);
+        }
 
         if (!quorumNodes.empty()) {
             // don't announce and wait for other nodes to request this share and directly send it to them
@@ -780,12 +851,18 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
         return;
     }
 
+    auto signHash = CLLMQUtils::BuildSignHash(quorum->params.type, quorum->qc->quorumHash, id, msgHash);
+
     std::vector<CBLSSignature> sigSharesForRecovery;
     std::vector<CBLSId> idsForRecovery;
     {
         LOCK(cs);
 
-        auto signHash = CLLMQUtils::BuildSignHash(quorum->params.type, quorum->qc->quorumHash, id, msgHash);
+        if (pendingRecoveries.count(signHash)) {
+            // recovery for this session is already running
+            return;
+        }
+
         auto sigShares = this->sigShares.GetAllForSignHash(signHash);
         if (!sigShares) {
             return;
@@ -803,19 +880,39 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
         if (sigSharesForRecovery.size() < quorum->params.threshold) {
             return;
         }
+
+        pendingRecoveries.emplace(signHash);
     }
 
-    // now recover it
+    // now recover it. This is done in blsWorker so that multiple sessions can be recovered in parallel and the
+    // worker thread can continue verifying sig shares in the meantime
     cxxtimer::Timer t(true);
-    CBLSSignature recoveredSig;
-    if (!recoveredSig.Recover(sigSharesForRecovery, idsForRecovery)) {
+    blsWorker.AsyncRecoverSig(sigSharesForRecovery, idsForRecovery, [this, quorum, id, msgHash, signHash, t](const CBLSSignature& recoveredSig) {
+        FinishRecoverSig(quorum, id, msgHash, recoveredSig, t.count());
+        LOCK(cs);
+        pendingRecoveries.erase(signHash);
+    });
+}
+
+void CSigSharesManager::FinishRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, const CBLSSignature& recoveredSig, int64_t recoveryTime)
+{
+    TRACE5(llmq, sigshares_session_recovered, quorum->params.type, id.begin(), msgHash.begin(), recoveryTime, recoveredSig.IsValid());
+    if (!recoveredSig.IsValid()) {
         LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- failed to recover signature. id=%s, msgHash=%s, time=%d\n", __func__,
-                  id.ToString(), msgHash.ToString(), t.count());
+                  id.ToString(), msgHash.ToString(), recoveryTime);
         return;
     }
 
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
-              id.ToString(), msgHash.ToString(), t.count());
+              id.ToString(), msgHash.ToString(), recoveryTime);
+    statsClient.histogram("llmq.sigs.recoverMs", recoveryTime);
+    {
+        LOCK(cs);
+        auto it = timeStartedForSessions.find(CLLMQUtils::BuildSignHash(quorum->params.type, quorum->qc->quorumHash, id, msgHash));
+        if (it != timeStartedForSessions.end()) {
+            statsClient.histogram("llmq.sigs.firstShareToRecoveryMs", GetTimeMillis() - it->second);
+        }
+    }
 
     auto rs = std::make_shared<CRecoveredSig>();
     rs->llmqType = quorum->params.type;
@@ -839,7 +936,14 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
         }
     }
 
-    quorumSigningManager->ProcessRecoveredSig(rs);
+    // this is picked up by the worker thread (see CSigningManager::ProcessPendingRecoveredSigs)
+    quorumSigningManager->PushReconstructedRecoveredSig(rs);
+}
+
+bool CSigSharesManager::HasPendingRecoveries()
+{
+    LOCK(cs);
+    return !pendingRecoveries.empty();
 }
 
 CDeterministicMNCPtr CSigSharesManager::SelectMemberForRecovery(const CQuorumCPtr& quorum, const uint256 &id, int attempt)
@@ -906,7 +1010,12 @@ void CSigSharesManager::CollectSigSharesToRequest(std::unordered_map<NodeId, std
                 continue;
             }
 
-            for (size_t i = 0; i < session.announced.inv.size(); i++) {
+            if (sigShares.CountForSignHash(signHash) >= (size_t)GetLLMQParams(session.llmqType).threshold) {
+                // we can already recover the signature on our own, requesting more shares is wasted bandwidth
+                continue;
+            }
+
+            for (size_t i = 0; i < session.announced.size; i++) {
                 if (!session.announced.inv[i]) {
                     continue;
                 }
@@ -944,7 +1053,7 @@ void CSigSharesManager::CollectSigSharesToRequest(std::unordered_map<NodeId, std
                     invMap = &sigSharesToRequest[nodeId];
                 }
                 auto& inv = (*invMap)[signHash];
-                if (inv.inv.empty()) {
+                if (!inv.IsInitialized()) {
                     inv.Init(GetLLMQParams(session.llmqType).size);
                 }
                 inv.inv[k.second] = true;
@@ -984,7 +1093,7 @@ void CSigSharesManager::CollectSigSharesToSend(std::unordered_map<NodeId, std::u
 
             CBatchedSigShares batchedSigShares;
 
-            for (size_t i = 0; i < session.requested.inv.size(); i++) {
+            for (size_t i = 0; i < session.requested.size; i++) {
                 if (!session.requested.inv[i]) {
                     continue;
                 }
@@ -1061,6 +1170,8 @@ void CSigSharesManager::CollectSigSharesToAnnounce(std::unordered_map<NodeId, st
     AssertLockHeld(cs);
 
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, std::unordered_set<NodeId>, StaticSaltedHasher> quorumNodesMap;
+    // sessions of which a node already knows enough shares to recover the signature on its own
+    std::unordered_map<NodeId, std::unordered_set<uint256, StaticSaltedHasher>> saturatedSessions;
 
     sigSharesQueuedToAnnounce.ForEach([&](const SigShareKey& sigShareKey, bool) {
         AssertLockHeld(cs);
@@ -1095,8 +1206,18 @@ void CSigSharesManager::CollectSigSharesToAnnounce(std::unordered_map<NodeId, st
                 continue;
             }
 
+            auto& saturated = saturatedSessions[nodeId];
+            if (saturated.count(signHash)) {
+                continue;
+            }
+            if (session.knows.CountSet() >= (size_t)GetLLMQParams(sigShare->llmqType).threshold) {
+                // he has or can request enough shares to recover, announcing more only costs bandwidth
+                saturated.emplace(signHash);
+                continue;
+            }
+
             auto& inv = sigSharesToAnnounce[nodeId][signHash];
-            if (inv.inv.empty()) {
+            if (!inv.IsInitialized()) {
                 inv.Init(GetLLMQParams(sigShare->llmqType).size);
             }
             inv.inv[quorumMember] = true;
@@ -1169,19 +1290,19 @@ bool CSigSharesManager::SendMessages()
 
         auto it1 = sigSessionAnnouncements.find(pnode->GetId());
         if (it1 != sigSessionAnnouncements.end()) {
-            std::vector<CSigSesAnn> msgs;
-            msgs.reserve(it1->second.size());
+            CBatchedSigSesAnns msgs;
+            msgs.anns.reserve(std::min(it1->second.size(), MAX_MSGS_CNT_QSIGSESANN));
             for (auto& sigSesAnn : it1->second) {
                 LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::SendMessages -- QSIGSESANN signHash=%s, sessionId=%d, node=%d\n",
                          CLLMQUtils::BuildSignHash(sigSesAnn).ToString(), sigSesAnn.sessionId, pnode->GetId());
-                msgs.emplace_back(sigSesAnn);
-                if (msgs.size() == MAX_MSGS_CNT_QSIGSESANN) {
+                msgs.anns.emplace_back(sigSesAnn);
+                if (msgs.anns.size() == MAX_MSGS_CNT_QSIGSESANN) {
                     g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::QSIGSESANN, msgs));
-                    msgs.clear();
+                    msgs.anns.clear();
                     didSend = true;
                 }
             }
-            if (!msgs.empty()) {
+            if (!msgs.anns.empty()) {
                 g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::QSIGSESANN, msgs));
                 didSend = true;
             }
@@ -1371,6 +1492,7 @@ void CSigSharesManager::Cleanup()
         }
         for (auto& signHash : timeoutSessions) {
             size_t count = sigShares.CountForSignHash(signHash);
+            TRACE2(llmq, sigshares_session_timeout, signHash.begin(), count);
 
             if (count > 0) {
                 auto m = sigShares.GetAllForSignHash(signHash);
@@ -1405,10 +1527,13 @@ void CSigSharesManager::Cleanup()
     // Find node states for peers that disappeared from CConnman
     std::unordered_set<NodeId> nodeStatesToDelete;
     {
-        LOCK(cs);
+        LOCK2(cs, cs_pendingIncoming);
         for (const auto& p : nodeStates) {
             nodeStatesToDelete.emplace(p.first);
         }
+        for (const auto& p : pendingIncomingSigShares) {
+            nodeStatesToDelete.emplace(p.first);
+        }
     }
     g_connman->ForEachNode([&](CNode* pnode) {
         nodeStatesToDelete.erase(pnode->GetId());
@@ -1416,6 +1541,7 @@ void CSigSharesManager::Cleanup()
 
     // Now delete these node states
     LOCK(cs);
+    RemovePendingIncomingSigShares(nodeStatesToDelete);
     for (const auto& nodeId : nodeStatesToDelete) {
         auto it = nodeStates.find(nodeId);
         if (it == nodeStates.end()) {
@@ -1446,6 +1572,24 @@ void CSigSharesManager::RemoveSigSharesForSession(const uint256& signHash)
     sigShares.EraseAllForSignHash(signHash);
     signedSessions.erase(signHash);
     timeSeenForSessions.erase(signHash);
+    auto itStarted = timeStartedForSessions.find(signHash);
+    if (itStarted != timeStartedForSessions.end()) {
+        statsClient.histogram("llmq.sigs.sessionLifetimeMs", GetTimeMillis() - itStarted->second);
+        timeStartedForSessions.erase(itStarted);
+    }
+
+    LOCK(cs_pendingIncoming);
+    for (auto& p : pendingIncomingSigShares) {
+        p.second.EraseAllForSignHash(signHash);
+    }
+}
+
+void CSigSharesManager::RemovePendingIncomingSigShares(const std::unordered_set<NodeId>& nodeIds)
+{
+    LOCK(cs_pendingIncoming);
+    for (const auto& nodeId : nodeIds) {
+        pendingIncomingSigShares.erase(nodeId);
+    }
 }
 
 void CSigSharesManager::RemoveBannedNodeStates()
@@ -1461,11 +1605,13 @@ void CSigSharesManager::RemoveBannedNodeStates()
                 AssertLockHeld(cs);
                 sigSharesRequested.Erase(k);
             });
+            toRemove.emplace(it->first);
             it = nodeStates.erase(it);
         } else {
             ++it;
         }
     }
+    RemovePendingIncomingSigShares(toRemove);
 }
 
 void CSigSharesManager::BanNode(NodeId nodeId)
@@ -1524,7 +1670,9 @@ void CSigSharesManager::WorkThreadMain()
         quorumSigningManager->Cleanup();
 
         // TODO Wakeup when pending signing is needed?
-        if (!fMoreWork && !workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+        // While recoveries are running in blsWorker, poll more often so that recovered sigs are processed right away
+        int64_t sleepTime = HasPendingRecoveries() ? 5 : 100;
+        if (!fMoreWork && !workInterrupt.sleep_for(std::chrono::milliseconds(sleepTime))) {
             return;
         }
     }
@@ -1532,7 +1680,7 @@ void CSigSharesManager::WorkThreadMain()
 
 void CSigSharesManager::AsyncSign(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash)
 {
-    LOCK(cs);
+    LOCK(cs_pendingSigns);
     pendingSigns.emplace_back(quorum, id, msgHash);
 }
 
@@ -1540,7 +1688,7 @@ void CSigSharesManager::SignPendingSigShares()
 {
     std::vector<std::tuple<const CQuorumCPtr, uint256, uint256>> v;
     {
-        LOCK(cs);
+        LOCK(cs_pendingSigns);
         v = std::move(pendingSigns);
     }
 
@@ -1572,6 +1720,7 @@ CSigShare CSigSharesManager::CreateSigShare(const CQuorumCPtr& quorum, const uin
         return {};
     }
 
+    quorumManager->EnsureQuorumContributions(quorum);
     const CBLSSecretKey& skShare = quorum->GetSkShare();
     if (!skShare.IsValid()) {
         LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- we don't have our skShare for quorum %s\n", __func__, quorum->qc->quorumHash.ToString());
@@ -1601,6 +1750,8 @@ CSigShare CSigSharesManager::CreateSigShare(const CQuorumCPtr& quorum, const uin
 
     sigShare.UpdateKey();
 
+    TRACE3(llmq, sigshare_created, signHash.begin(), quorum->params.type, t.count());
+
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- created sigShare. signHash=%s, id=%s, msgHash=%s, llmqType=%d, quorum=%s, time=%s\n", __func__,
               signHash.ToString(), sigShare.id.ToString(), sigShare.msgHash.ToString(), quorum->params.type, quorum->qc->quorumHash.ToString(), t.count());
 
@@ -6,16 +6,22 @@
 #define BITCOIN_LLMQ_QUORUMS_SIGNING_SHARES_H
 
 #include <chainparams.h>
+#include <memusage.h>
 #include <net.h>
 #include <random.h>
 #include <saltedhasher.h>
 #include <serialize.h>
 #include <sync.h>
 #include <uint256.h>
+#include <version.h>
 
+#include <algorithm>
+#include <bitset>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
+class CBLSWorker;
 class CEvoDB;
 class CScheduler;
 
@@ -75,23 +81,114 @@ public:
     std::string ToString() const;
 };
 
+// Sent through the message QSIGSESANN. Peers starting with LLMQ_COMPACT_SIGSHARES_VERSION group the announcements by
+// quorum, so that llmqType and quorumHash are only sent once for all sessions of the same quorum
+class CBatchedSigSesAnns
+{
+public:
+    std::vector<CSigSesAnn> anns;
+
+public:
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        if (s.GetVersion() < LLMQ_COMPACT_SIGSHARES_VERSION) {
+            s << anns;
+            return;
+        }
+
+        // groups in the order of their first announcement, there are only a few quorums per message
+        std::vector<std::vector<const CSigSesAnn*>> groups;
+        for (const auto& ann : anns) {
+            auto it = std::find_if(groups.begin(), groups.end(), [&](const std::vector<const CSigSesAnn*>& group) {
+                return group[0]->llmqType == ann.llmqType && group[0]->quorumHash == ann.quorumHash;
+            });
+            if (it == groups.end()) {
+                groups.emplace_back();
+                it = groups.end() - 1;
+            }
+            it->emplace_back(&ann);
+        }
+
+        WriteCompactSize(s, groups.size());
+        for (const auto& group : groups) {
+            s << group[0]->llmqType << group[0]->quorumHash;
+            WriteCompactSize(s, group.size());
+            for (const auto* ann : group) {
+                s << VARINT(ann->sessionId) << ann->id << ann->msgHash;
+            }
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        anns.clear();
+        if (s.GetVersion() < LLMQ_COMPACT_SIGSHARES_VERSION) {
+            s >> anns;
+            return;
+        }
+
+        uint64_t groupCount = ReadCompactSize(s);
+        for (uint64_t i = 0; i < groupCount; i++) {
+            CSigSesAnn ann;
+            s >> ann.llmqType >> ann.quorumHash;
+            uint64_t count = ReadCompactSize(s);
+            if (count == 0) {
+                throw std::ios_base::failure("empty announcement group");
+            }
+            for (uint64_t j = 0; j < count; j++) {
+                s >> VARINT(ann.sessionId) >> ann.id >> ann.msgHash;
+                anns.emplace_back(ann);
+            }
+        }
+    }
+};
+
+// The bits are stored inline and sized for the largest quorum, so that the three invs of every session with every
+// node don't need heap allocations of their own
 class CSigSharesInv
 {
 public:
     uint32_t sessionId{(uint32_t)-1};
-    std::vector<bool> inv;
+    // the size of the quorum, only the first size bits of inv are used
+    uint16_t size{0};
+    std::bitset<Consensus::MAX_LLMQ_SIZE> inv;
 
 public:
-    SERIALIZE_METHODS(CSigSharesInv, obj)
+    template<typename Stream>
+    void Serialize(Stream& s) const
     {
-        uint64_t invSize = obj.inv.size();
-        READWRITE(VARINT(obj.sessionId), COMPACTSIZE(invSize));
-        autobitset_t bitset = std::make_pair(obj.inv, (size_t)invSize);
-        READWRITE(AUTOBITSET(bitset));
-        SER_READ(obj, obj.inv = bitset.first);
+        uint64_t invSize = size;
+        s << VARINT(sessionId) << COMPACTSIZE(invSize);
+        if (s.GetVersion() < LLMQ_COMPACT_SIGSHARES_VERSION) {
+            autobitset_t bitset = std::make_pair(ToVector(), (size_t)size);
+            s << AUTOBITSET(bitset);
+        } else {
+            WriteCompact(s);
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        uint64_t invSize;
+        s >> VARINT(sessionId) >> COMPACTSIZE(invSize);
+        if (invSize > Consensus::MAX_LLMQ_SIZE) {
+            throw std::ios_base::failure("invalid inv size");
+        }
+        if (s.GetVersion() < LLMQ_COMPACT_SIGSHARES_VERSION) {
+            autobitset_t bitset = std::make_pair(std::vector<bool>(), (size_t)invSize);
+            s >> AUTOBITSET(bitset);
+            FromVector(bitset.first);
+        } else {
+            size = (uint16_t)invSize;
+            ReadCompact(s);
+        }
     }
 
     void Init(size_t size);
+    bool IsInitialized() const { return size != 0; }
     bool IsSet(uint16_t quorumMember) const;
     void Set(uint16_t quorumMember, bool v);
     void SetAll(bool v);
@@ -99,6 +196,131 @@ public:
 
     size_t CountSet() const;
     std::string ToString() const;
+
+private:
+    std::vector<bool> ToVector() const;
+    void FromVector(const std::vector<bool>& vec);
+
+    // Encodings of the bits used by the compact format. Invs are usually either sparse (single shares announced or
+    // requested) or almost full (QGETSIGSHARES for all missing shares), so the smallest of a plain bitmap, the offsets
+    // of the set bits and the lengths of alternating runs of unset and set bits is sent.
+    enum : uint8_t {
+        COMPACT_BITMAP = 0,
+        COMPACT_OFFSETS = 1,
+        COMPACT_RUNS = 2,
+    };
+
+    template<typename Stream>
+    void WriteCompact(Stream& s) const
+    {
+        size_t bitmapSize = GetSizeOfFixedBitSet(size);
+        size_t offsetsSize = 1; // stopper
+        size_t runsSize = 0;
+        int32_t last = -1;
+        bool runValue = false;
+        uint32_t runLength = 0;
+        for (int32_t i = 0; i < size; i++) {
+            if (inv[i]) {
+                offsetsSize += GetSizeOfVarInt<VarIntMode::DEFAULT, uint32_t>(i - last);
+                last = i;
+            }
+            if (inv[i] != runValue) {
+                runsSize += GetSizeOfVarInt<VarIntMode::DEFAULT, uint32_t>(runLength);
+                runValue = inv[i];
+                runLength = 0;
+            }
+            runLength++;
+        }
+        if (size != 0) {
+            runsSize += GetSizeOfVarInt<VarIntMode::DEFAULT, uint32_t>(runLength);
+        }
+
+        if (bitmapSize <= offsetsSize && bitmapSize <= runsSize) {
+            ser_writedata8(s, COMPACT_BITMAP);
+            unsigned char bytes[(Consensus::MAX_LLMQ_SIZE + 7) / 8] = {};
+            for (size_t i = 0; i < size; i++) {
+                bytes[i / 8] |= inv[i] << (i % 8);
+            }
+            s.write((char*)bytes, bitmapSize);
+        } else if (offsetsSize <= runsSize) {
+            ser_writedata8(s, COMPACT_OFFSETS);
+            last = -1;
+            for (int32_t i = 0; i < size; i++) {
+                if (inv[i]) {
+                    WriteVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s, i - last);
+                    last = i;
+                }
+            }
+            WriteVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s, 0);
+        } else {
+            // starts with a (possibly empty) run of unset bits, the last run ends at size
+            ser_writedata8(s, COMPACT_RUNS);
+            runValue = false;
+            runLength = 0;
+            for (size_t i = 0; i < size; i++) {
+                if (inv[i] != runValue) {
+                    WriteVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s, runLength);
+                    runValue = inv[i];
+                    runLength = 0;
+                }
+                runLength++;
+            }
+            WriteVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s, runLength);
+        }
+    }
+
+    template<typename Stream>
+    void ReadCompact(Stream& s)
+    {
+        inv.reset();
+        uint8_t encoding = ser_readdata8(s);
+        if (encoding == COMPACT_BITMAP) {
+            unsigned char bytes[(Consensus::MAX_LLMQ_SIZE + 7) / 8] = {};
+            size_t bitmapSize = GetSizeOfFixedBitSet(size);
+            s.read((char*)bytes, bitmapSize);
+            for (size_t i = 0; i < bitmapSize * 8; i++) {
+                if (!(bytes[i / 8] & (1 << (i % 8)))) {
+                    continue;
+                }
+                if (i >= size) {
+                    throw std::ios_base::failure("Out-of-range bits set");
+                }
+                inv.set(i);
+            }
+        } else if (encoding == COMPACT_OFFSETS) {
+            int32_t last = -1;
+            while (true) {
+                uint32_t offset = ReadVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s);
+                if (offset == 0) {
+                    break;
+                }
+                if (offset > (uint32_t)(size - 1 - last)) {
+                    throw std::ios_base::failure("out of bounds index");
+                }
+                last += offset;
+                inv.set(last);
+            }
+        } else if (encoding == COMPACT_RUNS) {
+            size_t pos = 0;
+            bool runValue = false;
+            while (pos < size) {
+                uint32_t runLength = ReadVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s);
+                // only the first run may be empty
+                if ((runLength == 0 && (runValue || pos != 0)) || runLength > size - pos) {
+                    throw std::ios_base::failure("invalid run length");
+                }
+                if (runValue) {
+                    for (size_t i = pos; i < pos + runLength; i++) {
+                        inv.set(i);
+                    }
+                }
+                pos += runLength;
+                runValue = !runValue;
+            }
+        } else {
+            throw std::ios_base::failure("invalid inv encoding");
+        }
+    }
 };
 
 // sent through the message QBSIGSHARES as a vector of multiple batches
@@ -117,58 +339,167 @@ public:
     std::string ToInvString() const;
 };
 
+// Maps SigShareKey (signHash + quorum member) to T
+// All entries of one signing session are stored in a dense vector sorted by quorum member index, together with a
+// bitmap of the members present. Sessions themselves are stored in a flat vector and indexed by signHash. This avoids
+// one heap allocation per sig share and keeps ForEach/EraseIf iteration cache friendly. Pointers and references
+// returned by Get/GetFirst/GetAllForSignHash are only valid until the next modification of the map.
 template<typename T>
 class SigShareMap
 {
+public:
+    class SessionEntries
+    {
+        friend class SigShareMap;
+
+    public:
+        typedef std::pair<uint16_t, T> value_type;
+        typedef typename std::vector<value_type>::iterator iterator;
+        typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    private:
+        std::vector<value_type> entries;
+        std::vector<bool> members;
+
+    public:
+        iterator begin() { return entries.begin(); }
+        iterator end() { return entries.end(); }
+        const_iterator begin() const { return entries.begin(); }
+        const_iterator end() const { return entries.end(); }
+
+        size_t size() const { return entries.size(); }
+        bool empty() const { return entries.empty(); }
+
+        size_t count(uint16_t quorumMember) const
+        {
+            return quorumMember < members.size() && members[quorumMember] ? 1 : 0;
+        }
+
+    private:
+        iterator LowerBound(uint16_t quorumMember)
+        {
+            return std::lower_bound(entries.begin(), entries.end(), quorumMember, [](const value_type& a, uint16_t b) {
+                return a.first < b;
+            });
+        }
+
+        T* Get(uint16_t quorumMember)
+        {
+            if (!count(quorumMember)) {
+                return nullptr;
+            }
+            return &LowerBound(quorumMember)->second;
+        }
+
+        bool Add(uint16_t quorumMember, const T& v)
+        {
+            if (count(quorumMember)) {
+                return false;
+            }
+            if (quorumMember >= members.size()) {
+                members.resize(quorumMember + 1);
+            }
+            members[quorumMember] = true;
+            entries.emplace(LowerBound(quorumMember), quorumMember, v);
+            return true;
+        }
+
+        bool Erase(uint16_t quorumMember)
+        {
+            if (!count(quorumMember)) {
+                return false;
+            }
+            members[quorumMember] = false;
+            entries.erase(LowerBound(quorumMember));
+            return true;
+        }
+    };
+
 private:
-    std::unordered_map<uint256, std::unordered_map<uint16_t, T>, StaticSaltedHasher> internalMap;
+    std::vector<std::pair<uint256, SessionEntries>> sessions;
+    std::unordered_map<uint256, size_t, StaticSaltedHasher> sessionIndexes;
+    size_t totalSize{0};
+
+    SessionEntries* FindSession(const uint256& signHash)
+    {
+        auto it = sessionIndexes.find(signHash);
+        if (it == sessionIndexes.end()) {
+            return nullptr;
+        }
+        return &sessions[it->second].second;
+    }
+
+    const SessionEntries* FindSession(const uint256& signHash) const
+    {
+        auto it = sessionIndexes.find(signHash);
+        if (it == sessionIndexes.end()) {
+            return nullptr;
+        }
+        return &sessions[it->second].second;
+    }
+
+    void RemoveSessionAt(size_t idx)
+    {
+        totalSize -= sessions[idx].second.size();
+        sessionIndexes.erase(sessions[idx].first);
+        if (idx != sessions.size() - 1) {
+            sessions[idx] = std::move(sessions.back());
+            sessionIndexes[sessions[idx].first] = idx;
+        }
+        sessions.pop_back();
+    }
 
 public:
     bool Add(const SigShareKey& k, const T& v)
     {
-        auto& m = internalMap[k.first];
-        return m.emplace(k.second, v).second;
+        auto it = sessionIndexes.find(k.first);
+        if (it == sessionIndexes.end()) {
+            it = sessionIndexes.emplace(k.first, sessions.size()).first;
+            sessions.emplace_back(k.first, SessionEntries());
+        }
+        if (!sessions[it->second].second.Add(k.second, v)) {
+            return false;
+        }
+        totalSize++;
+        return true;
     }
 
     void Erase(const SigShareKey& k)
     {
-        auto it = internalMap.find(k.first);
-        if (it == internalMap.end()) {
+        auto it = sessionIndexes.find(k.first);
+        if (it == sessionIndexes.end()) {
             return;
         }
-        it->second.erase(k.second);
-        if (it->second.empty()) {
-            internalMap.erase(it);
+        auto& session = sessions[it->second].second;
+        if (!session.Erase(k.second)) {
+            return;
+        }
+        totalSize--;
+        if (session.empty()) {
+            RemoveSessionAt(it->second);
         }
     }
 
     void Clear()
     {
-        internalMap.clear();
+        sessions.clear();
+        sessionIndexes.clear();
+        totalSize = 0;
     }
 
     bool Has(const SigShareKey& k) const
     {
-        auto it = internalMap.find(k.first);
-        if (it == internalMap.end()) {
-            return false;
-        }
-        return it->second.count(k.second) != 0;
+        auto session = FindSession(k.first);
+        return session && session->count(k.second) != 0;
     }
 
     T* Get(const SigShareKey& k)
     {
-        auto it = internalMap.find(k.first);
-        if (it == internalMap.end()) {
-            return nullptr;
-        }
-
-        auto jt = it->second.find(k.second);
-        if (jt == it->second.end()) {
+        auto session = FindSession(k.first);
+        if (!session) {
             return nullptr;
         }
-
-        return &jt->second;
+        return session->Get(k.second);
     }
 
     T& GetOrAdd(const SigShareKey& k)
@@ -183,67 +514,76 @@ public:
 
     const T* GetFirst() const
     {
-        if (internalMap.empty()) {
+        if (sessions.empty()) {
             return nullptr;
         }
-        return &internalMap.begin()->second.begin()->second;
+        return &sessions.front().second.begin()->second;
     }
 
     size_t Size() const
     {
-        size_t s = 0;
-        for (auto& p : internalMap) {
-            s += p.second.size();
+        return totalSize;
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        size_t nUsage = memusage::DynamicUsage(sessions) + memusage::DynamicUsage(sessionIndexes);
+        for (const auto& p : sessions) {
+            nUsage += memusage::DynamicUsage(p.second.entries) + memusage::MallocUsage((p.second.members.capacity() + 7) / 8);
         }
-        return s;
+        return nUsage;
     }
 
     size_t CountForSignHash(const uint256& signHash) const
     {
-        auto it = internalMap.find(signHash);
-        if (it == internalMap.end()) {
+        auto session = FindSession(signHash);
+        if (!session) {
             return 0;
         }
-        return it->second.size();
+        return session->size();
     }
 
     bool Empty() const
     {
-        return internalMap.empty();
+        return sessions.empty();
     }
 
-    const std::unordered_map<uint16_t, T>* GetAllForSignHash(const uint256& signHash)
+    const SessionEntries* GetAllForSignHash(const uint256& signHash) const
     {
-        auto it = internalMap.find(signHash);
-        if (it == internalMap.end()) {
-            return nullptr;
-        }
-        return &it->second;
+        return FindSession(signHash);
     }
 
     void EraseAllForSignHash(const uint256& signHash)
     {
-        internalMap.erase(signHash);
+        auto it = sessionIndexes.find(signHash);
+        if (it == sessionIndexes.end()) {
+            return;
+        }
+        RemoveSessionAt(it->second);
     }
 
     template<typename F>
     void EraseIf(F&& f)
     {
-        for (auto it = internalMap.begin(); it != internalMap.end(); ) {
+        for (size_t i = 0; i < sessions.size(); ) {
             SigShareKey k;
-            k.first = it->first;
-            for (auto jt = it->second.begin(); jt != it->second.end(); ) {
-                k.second = jt->first;
-                if (f(k, jt->second)) {
-                    jt = it->second.erase(jt);
-                } else {
-                    ++jt;
+            k.first = sessions[i].first;
+            auto& session = sessions[i].second;
+            auto& entries = session.entries;
+            size_t oldSize = entries.size();
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [&](typename SessionEntries::value_type& p) {
+                k.second = p.first;
+                if (f(k, p.second)) {
+                    session.members[p.first] = false;
+                    return true;
                 }
-            }
-            if (it->second.empty()) {
-                it = internalMap.erase(it);
+                return false;
+            }), entries.end());
+            totalSize -= oldSize - entries.size();
+            if (entries.empty()) {
+                RemoveSessionAt(i);
             } else {
-                ++it;
+                ++i;
             }
         }
     }
@@ -251,7 +591,7 @@ public:
     template<typename F>
     void ForEach(F&& f)
     {
-        for (auto& p : internalMap) {
+        for (auto& p : sessions) {
             SigShareKey k;
             k.first = p.first;
             for (auto& p2 : p.second) {
@@ -299,7 +639,6 @@ public:
     std::unordered_map<uint32_t, Session*> sessionByRecvId;
     uint32_t nextSendSessionId{1};
 
-    SigShareMap<CSigShare> pendingIncomingSigShares;
     SigShareMap<int64_t> requestedSigShares;
 
     bool banned{false};
@@ -311,6 +650,8 @@ public:
     bool GetSessionInfoByRecvId(uint32_t sessionId, SessionInfo& retInfo);
 
     void RemoveSession(const uint256& signHash);
+
+    size_t DynamicMemoryUsage() const;
 };
 
 class CSignedSession
@@ -342,6 +683,8 @@ class CSigSharesManager : public CRecoveredSigsListener
 private:
     CCriticalSection cs;
 
+    CBLSWorker& blsWorker;
+
     std::thread workThread;
     CThreadInterrupt workInterrupt;
 
@@ -350,20 +693,33 @@ private:
 
     // stores time of last receivedSigShare. Used to detect timeouts
     std::unordered_map<uint256, int64_t, StaticSaltedHasher> timeSeenForSessions GUARDED_BY(cs);
+    // stores time of the first sigShare in milliseconds, for the session latency stats
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> timeStartedForSessions GUARDED_BY(cs);
 
     std::unordered_map<NodeId, CSigSharesNodeState> nodeStates GUARDED_BY(cs);
     SigShareMap<std::pair<NodeId, int64_t>> sigSharesRequested GUARDED_BY(cs);
     SigShareMap<bool> sigSharesQueuedToAnnounce GUARDED_BY(cs);
 
-    std::vector<std::tuple<const CQuorumCPtr, uint256, uint256>> pendingSigns GUARDED_BY(cs);
-
     FastRandomContext rnd GUARDED_BY(cs);
 
+    // signHashes of sessions for which recovery is currently running in blsWorker
+    std::unordered_set<uint256, StaticSaltedHasher> pendingRecoveries GUARDED_BY(cs);
+
+    // Sig shares received from other nodes which still need verification. These are kept outside of cs so that the
+    // network thread can queue incoming sig shares while the worker thread is busy collecting messages to send.
+    // Lock order is cs -> cs_pendingIncoming
+    CCriticalSection cs_pendingIncoming;
+    std::unordered_map<NodeId, SigShareMap<CSigShare>> pendingIncomingSigShares GUARDED_BY(cs_pendingIncoming);
+    FastRandomContext rndPendingIncoming GUARDED_BY(cs_pendingIncoming);
+
+    CCriticalSection cs_pendingSigns;
+    std::vector<std::tuple<const CQuorumCPtr, uint256, uint256>> pendingSigns GUARDED_BY(cs_pendingSigns);
+
     int64_t lastCleanupTime{0};
     std::atomic<uint32_t> recoveredSigsCounter{0};
 
 public:
-    CSigSharesManager();
+    explicit CSigSharesManager(CBLSWorker& _blsWorker);
     ~CSigSharesManager();
 
     void StartWorkerThread();
@@ -405,6 +761,8 @@ private:
 
     void ProcessSigShare(const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum);
     void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash);
+    void FinishRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, const CBLSSignature& recoveredSig, int64_t recoveryTime);
+    bool HasPendingRecoveries();
 
 private:
     bool GetSessionInfoByRecvId(NodeId nodeId, uint32_t sessionId, CSigSharesNodeState::SessionInfo& retInfo);
@@ -412,6 +770,7 @@ private:
 
     void Cleanup();
     void RemoveSigSharesForSession(const uint256& signHash);
+    void RemovePendingIncomingSigShares(const std::unordered_set<NodeId>& nodeIds);
     void RemoveBannedNodeStates();
 
     void BanNode(NodeId nodeId);
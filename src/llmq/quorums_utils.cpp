@@ -20,8 +20,51 @@
 namespace llmq
 {
 
-CCriticalSection cs_llmq_vbc;
-VersionBitsCache llmq_versionbitscache;
+static const size_t QUORUM_CANDIDATES_CACHE_SIZE = 16;
+static const size_t QUORUM_CONNECTIONS_CACHE_SIZE = 128;
+
+// The candidates don't depend on the LLMQ type, so multiple LLMQ types starting a DKG at the same block share them. The
+// scores can't be shared as the LLMQ type is part of the modifier
+static std::shared_ptr<const std::vector<CDeterministicMNCPtr>> GetQuorumCandidates(const CBlockIndex* pindexQuorum)
+{
+    static CCriticalSection cs_candidates;
+    static unordered_lru_cache<uint256, std::shared_ptr<const std::vector<CDeterministicMNCPtr>>, StaticSaltedHasher> mapQuorumCandidates(QUORUM_CANDIDATES_CACHE_SIZE);
+
+    std::shared_ptr<const std::vector<CDeterministicMNCPtr>> candidates;
+    {
+        LOCK(cs_candidates);
+        if (mapQuorumCandidates.get(pindexQuorum->GetBlockHash(), candidates)) {
+            return candidates;
+        }
+    }
+
+    candidates = std::make_shared<const std::vector<CDeterministicMNCPtr>>(deterministicMNManager->GetListForBlock(pindexQuorum).GetQuorumCandidates());
+    LOCK(cs_candidates);
+    mapQuorumCandidates.insert(pindexQuorum->GetBlockHash(), candidates);
+    return candidates;
+}
+
+// Connections and relay members of all active quorums are recalculated on every block, see EnsureQuorumConnections
+static std::set<uint256> GetCachedQuorumConnections(bool fRelayMembers, Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& forMember, bool onlyOutbound,
+                                                    const std::function<std::set<uint256>()>& calc)
+{
+    static CCriticalSection cs_connections;
+    static unordered_lru_cache<uint256, std::set<uint256>, StaticSaltedHasher> mapQuorumConnections(QUORUM_CONNECTIONS_CACHE_SIZE);
+
+    const uint256 key = ::SerializeHash(std::make_tuple(fRelayMembers, llmqType, pindexQuorum->GetBlockHash(), forMember, onlyOutbound));
+    std::set<uint256> result;
+    {
+        LOCK(cs_connections);
+        if (mapQuorumConnections.get(key, result)) {
+            return result;
+        }
+    }
+
+    result = calc();
+    LOCK(cs_connections);
+    mapQuorumConnections.insert(key, result);
+    return result;
+}
 
 std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
@@ -42,9 +85,8 @@ std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLM
         }
     }
 
-    auto allMns = deterministicMNManager->GetListForBlock(pindexQuorum);
     auto modifier = ::SerializeHash(std::make_pair(llmqType, pindexQuorum->GetBlockHash()));
-    quorumMembers = allMns.CalculateQuorum(GetLLMQParams(llmqType).size, modifier);
+    quorumMembers = CDeterministicMNList::CalculateQuorum(*GetQuorumCandidates(pindexQuorum), GetLLMQParams(llmqType).size, modifier);
     LOCK(cs_members);
     mapQuorumMembers[llmqType].insert(pindexQuorum->GetBlockHash(), quorumMembers);
     return quorumMembers;
@@ -117,28 +159,37 @@ uint256 CLLMQUtils::DeterministicOutboundConnection(const uint256& proTxHash1, c
 std::set<uint256> CLLMQUtils::GetQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& forMember, bool onlyOutbound)
 {
     if (IsAllMembersConnectedEnabled(llmqType)) {
-        auto mns = GetAllQuorumMembers(llmqType, pindexQuorum);
-        std::set<uint256> result;
+        return GetCachedQuorumConnections(false, llmqType, pindexQuorum, forMember, onlyOutbound, [&]() {
+            auto mns = GetAllQuorumMembers(llmqType, pindexQuorum);
+            std::set<uint256> result;
 
-        for (const auto& dmn : mns) {
-            if (dmn->proTxHash == forMember) {
-                continue;
-            }
-            // Determine which of the two MNs (forMember vs dmn) should initiate the outbound connection and which
-            // one should wait for the inbound connection. We do this in a deterministic way, so that even when we
-            // end up with both connecting to each other, we know which one to disconnect
-            uint256 deterministicOutbound = DeterministicOutboundConnection(forMember, dmn->proTxHash);
-            if (!onlyOutbound || deterministicOutbound == dmn->proTxHash) {
-                result.emplace(dmn->proTxHash);
+            for (const auto& dmn : mns) {
+                if (dmn->proTxHash == forMember) {
+                    continue;
+                }
+                // Determine which of the two MNs (forMember vs dmn) should initiate the outbound connection and which
+                // one should wait for the inbound connection. We do this in a deterministic way, so that even when we
+                // end up with both connecting to each other, we know which one to disconnect
+                uint256 deterministicOutbound = DeterministicOutboundConnection(forMember, dmn->proTxHash);
+                if (!onlyOutbound || deterministicOutbound == dmn->proTxHash) {
+                    result.emplace(dmn->proTxHash);
+                }
             }
-        }
-        return result;
+            return result;
+        });
     } else {
         return GetQuorumRelayMembers(llmqType, pindexQuorum, forMember, onlyOutbound);
     }
 }
 
 std::set<uint256> CLLMQUtils::GetQuorumRelayMembers(Consensus::LLMQType llmqType, const CBlockIndex *pindexQuorum, const uint256 &forMember, bool onlyOutbound)
+{
+    return GetCachedQuorumConnections(true, llmqType, pindexQuorum, forMember, onlyOutbound, [&]() {
+        return CalcQuorumRelayMembers(llmqType, pindexQuorum, forMember, onlyOutbound);
+    });
+}
+
+std::set<uint256> CLLMQUtils::CalcQuorumRelayMembers(Consensus::LLMQType llmqType, const CBlockIndex *pindexQuorum, const uint256 &forMember, bool onlyOutbound)
 {
     auto mns = GetAllQuorumMembers(llmqType, pindexQuorum);
     std::set<uint256> result;
@@ -301,10 +352,8 @@ bool CLLMQUtils::IsQuorumActive(Consensus::LLMQType llmqType, const uint256& quo
 
 bool CLLMQUtils::IsQuorumTypeEnabled(Consensus::LLMQType llmqType, const CBlockIndex* pindex)
 {
-    LOCK(cs_llmq_vbc);
-
     const Consensus::Params& consensusParams = Params().GetConsensus();
-    bool f_dip0020_Active = VersionBitsState(pindex, consensusParams, Consensus::DEPLOYMENT_DIP0020, llmq_versionbitscache) == ThresholdState::ACTIVE;
+    bool f_dip0020_Active = VersionBitsState(pindex, consensusParams, Consensus::DEPLOYMENT_DIP0020, versionbitscache) == ThresholdState::ACTIVE;
 
     switch (llmqType)
     {
@@ -23,11 +23,6 @@ class CBLSPublicKey;
 namespace llmq
 {
 
-// Use a separate cache instance instead of versionbitscache to avoid locking cs_main
-// and dealing with all kinds of deadlocks.
-extern CCriticalSection cs_llmq_vbc;
-extern VersionBitsCache llmq_versionbitscache;
-
 static const bool DEFAULT_ENABLE_QUORUM_DATA_RECOVERY = true;
 
 enum class QvvecSyncMode {
@@ -120,6 +115,9 @@ public:
                                                     std::forward_as_tuple(llmq.second.signingActiveQuorumCount + 1));
         }
     }
+
+private:
+    static std::set<uint256> CalcQuorumRelayMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& forMember, bool onlyOutbound);
 };
 
 const Consensus::LLMQParams& GetLLMQParams(const Consensus::LLMQType llmqType);
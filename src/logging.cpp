@@ -37,6 +37,7 @@ static int FileWriteStr(const std::string &str, FILE *fp)
 bool BCLog::Logger::StartLogging()
 {
     StdLockGuard scoped_lock(m_cs);
+    StdLockGuard write_lock(m_write_cs);
 
     assert(m_buffering);
     assert(m_fileout == nullptr);
@@ -67,9 +68,63 @@ bool BCLog::Logger::StartLogging()
     }
     if (m_print_to_console) fflush(stdout);
 
+    if (m_log_async && (m_print_to_console || m_print_to_file)) {
+        m_async_running = true;
+        m_async_stop = false;
+        m_async_thread = std::thread(&BCLog::Logger::AsyncWriterThread, this);
+    }
+
     return true;
 }
 
+void BCLog::Logger::StopAsyncLogging()
+{
+    {
+        StdLockGuard scoped_lock(m_cs);
+        if (!m_async_running) {
+            return;
+        }
+        m_async_stop = true;
+    }
+    m_async_cond.notify_one();
+    m_async_thread.join();
+}
+
+void BCLog::Logger::AsyncWriterThread()
+{
+    util::ThreadRename("logger");
+
+    std::deque<std::string> msgs;
+    while (true) {
+        uint64_t nDropped;
+        {
+            std::unique_lock<std::mutex> lock(m_cs);
+            while (!m_async_stop && m_async_queue.empty()) {
+                m_async_cond.wait(lock);
+            }
+            if (m_async_queue.empty()) {
+                // stop requested and everything written, later messages are written by the callers again
+                m_async_running = false;
+                return;
+            }
+            msgs.swap(m_async_queue);
+            m_async_queue_bytes = 0;
+            nDropped = m_async_dropped;
+            m_async_dropped = 0;
+        }
+
+        StdLockGuard write_lock(m_write_cs);
+        if (nDropped) {
+            WriteStr(strprintf("%s Dropped %u log messages, the log writer couldn't keep up\n", FormatISO8601DateTime(GetTime()), nDropped));
+        }
+        for (const std::string& str : msgs) {
+            WriteStr(str);
+        }
+        if (m_print_to_console) fflush(stdout);
+        msgs.clear();
+    }
+}
+
 void BCLog::Logger::EnableCategory(BCLog::LogFlags flag)
 {
     m_categories |= flag;
@@ -267,10 +322,32 @@ void BCLog::Logger::LogPrintStr(const std::string& str)
         return;
     }
 
+    if (m_async_running) {
+        // never block the caller on a slow writer, rather lose some messages
+        if (m_async_queue_bytes + str_prefixed.size() > m_log_queue_bytes) {
+            m_async_dropped++;
+            return;
+        }
+        // the writer only waits when the queue is empty
+        bool fWakeWriter = m_async_queue.empty();
+        m_async_queue_bytes += str_prefixed.size();
+        m_async_queue.emplace_back(std::move(str_prefixed));
+        if (fWakeWriter) {
+            m_async_cond.notify_one();
+        }
+        return;
+    }
+
+    StdLockGuard write_lock(m_write_cs);
+    WriteStr(str_prefixed);
+    if (m_print_to_console) fflush(stdout);
+}
+
+void BCLog::Logger::WriteStr(const std::string& str_prefixed)
+{
     if (m_print_to_console) {
         // print to console
         fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
-        fflush(stdout);
     }
     if (m_print_to_file) {
         assert(m_fileout != nullptr);
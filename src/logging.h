@@ -11,16 +11,22 @@
 #include <threadsafety.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <list>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 static const bool DEFAULT_LOGTIMEMICROS  = false;
 static const bool DEFAULT_LOGIPS         = false;
 static const bool DEFAULT_LOGTIMESTAMPS  = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const bool DEFAULT_LOGASYNC       = true;
+//! Messages which don't fit into the queue of the log writer thread anymore are dropped instead of blocking the caller
+static const size_t DEFAULT_LOG_QUEUE_BYTES = 16 * 1024 * 1024;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogThreadNames;
@@ -84,11 +90,25 @@ namespace BCLog {
     {
     private:
         mutable StdMutex m_cs; // Can not use Mutex from sync.h because in debug mode it would cause a deadlock when a potential deadlock was detected
+        //! Held while writing to the outputs, which the writer thread does when logging asynchronously. Always acquired after m_cs.
+        StdMutex m_write_cs;
 
-        FILE* m_fileout GUARDED_BY(m_cs) = nullptr;
+        FILE* m_fileout GUARDED_BY(m_write_cs) = nullptr;
         std::list<std::string> m_msgs_before_open GUARDED_BY(m_cs);
         bool m_buffering GUARDED_BY(m_cs) = true; //!< Buffer messages before logging can be started.
 
+        /**
+         * When logging asynchronously, the calling thread only prefixes the
+         * message and queues it, the writer thread does the I/O.
+         */
+        bool m_async_running GUARDED_BY(m_cs) = false;
+        bool m_async_stop GUARDED_BY(m_cs) = false;
+        std::deque<std::string> m_async_queue GUARDED_BY(m_cs);
+        size_t m_async_queue_bytes GUARDED_BY(m_cs) = 0;
+        uint64_t m_async_dropped GUARDED_BY(m_cs) = 0;
+        std::condition_variable m_async_cond;
+        std::thread m_async_thread;
+
         /**
          * m_started_new_line is a state variable that will suppress printing of
          * the timestamp when multiple calls are made that don't end in a
@@ -102,6 +122,11 @@ namespace BCLog {
         std::string LogTimestampStr(const std::string& str);
         std::string LogThreadNameStr(const std::string &str);
 
+        /** Write to the console and the debug log file */
+        void WriteStr(const std::string& str) EXCLUSIVE_LOCKS_REQUIRED(m_write_cs);
+        // The condition variable needs a plain std::unique_lock, which the analysis doesn't understand
+        void AsyncWriterThread() NO_THREAD_SAFETY_ANALYSIS;
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -109,6 +134,9 @@ namespace BCLog {
         bool m_log_timestamps = DEFAULT_LOGTIMESTAMPS;
         bool m_log_time_micros = DEFAULT_LOGTIMEMICROS;
         bool m_log_threadnames = DEFAULT_LOGTHREADNAMES;
+        //! Write the log from a separate thread once logging is started
+        bool m_log_async = DEFAULT_LOGASYNC;
+        size_t m_log_queue_bytes = DEFAULT_LOG_QUEUE_BYTES;
 
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
@@ -125,6 +153,8 @@ namespace BCLog {
 
         /** Start logging (and flush all buffered messages) */
         bool StartLogging();
+        /** Write all queued messages and stop the writer thread, later messages are written synchronously */
+        void StopAsyncLogging();
 
         void ShrinkDebugFile();
 
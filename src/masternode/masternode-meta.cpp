@@ -15,13 +15,15 @@ UniValue CMasternodeMetaInfo::ToJson() const
     UniValue ret(UniValue::VOBJ);
 
     auto now = GetAdjustedTime();
+    int64_t nLastAttempt = lastOutboundAttempt;
+    int64_t nLastSuccess = lastOutboundSuccess;
 
-    ret.pushKV("lastDSQ", nLastDsq);
-    ret.pushKV("mixingTxCount", nMixingTxCount);
-    ret.pushKV("lastOutboundAttempt", lastOutboundAttempt);
-    ret.pushKV("lastOutboundAttemptElapsed", now - lastOutboundAttempt);
-    ret.pushKV("lastOutboundSuccess", lastOutboundSuccess);
-    ret.pushKV("lastOutboundSuccessElapsed", now - lastOutboundSuccess);
+    ret.pushKV("lastDSQ", nLastDsq.load());
+    ret.pushKV("mixingTxCount", nMixingTxCount.load());
+    ret.pushKV("lastOutboundAttempt", nLastAttempt);
+    ret.pushKV("lastOutboundAttemptElapsed", now - nLastAttempt);
+    ret.pushKV("lastOutboundSuccess", nLastSuccess);
+    ret.pushKV("lastOutboundSuccessElapsed", now - nLastSuccess);
 
     return ret;
 }
@@ -62,7 +64,6 @@ CMasternodeMetaInfoPtr CMasternodeMetaMan::GetMetaInfo(const uint256& proTxHash,
 // masternodes before we ever see a masternode that we know already mixed someone's funds earlier.
 int64_t CMasternodeMetaMan::GetDsqThreshold(const uint256& proTxHash, int nMnCount)
 {
-    LOCK(cs);
     auto metaInfo = GetMetaInfo(proTxHash);
     if (metaInfo == nullptr) {
         // return a threshold which is slightly above nDsqCount i.e. a no-go
@@ -73,26 +74,19 @@ int64_t CMasternodeMetaMan::GetDsqThreshold(const uint256& proTxHash, int nMnCou
 
 void CMasternodeMetaMan::AllowMixing(const uint256& proTxHash)
 {
-    LOCK(cs);
     auto mm = GetMetaInfo(proTxHash);
-    nDsqCount++;
-    LOCK(mm->cs);
-    mm->nLastDsq = nDsqCount;
+    mm->nLastDsq = ++nDsqCount;
     mm->nMixingTxCount = 0;
 }
 
 void CMasternodeMetaMan::DisallowMixing(const uint256& proTxHash)
 {
-    LOCK(cs);
     auto mm = GetMetaInfo(proTxHash);
-
-    LOCK(mm->cs);
     mm->nMixingTxCount++;
 }
 
 bool CMasternodeMetaMan::AddGovernanceVote(const uint256& proTxHash, const uint256& nGovernanceObjectHash)
 {
-    LOCK(cs);
     auto mm = GetMetaInfo(proTxHash);
     mm->AddGovernanceVote(nGovernanceObjectHash);
     return true;
@@ -100,9 +94,16 @@ bool CMasternodeMetaMan::AddGovernanceVote(const uint256& proTxHash, const uint2
 
 void CMasternodeMetaMan::RemoveGovernanceObject(const uint256& nGovernanceObjectHash)
 {
-    LOCK(cs);
-    for(auto& p : metaInfos) {
-        p.second->RemoveGovernanceObject(nGovernanceObjectHash);
+    std::vector<CMasternodeMetaInfoPtr> vecMetaInfos;
+    {
+        LOCK(cs);
+        vecMetaInfos.reserve(metaInfos.size());
+        for (const auto& p : metaInfos) {
+            vecMetaInfos.emplace_back(p.second);
+        }
+    }
+    for (const auto& mm : vecMetaInfos) {
+        mm->RemoveGovernanceObject(nGovernanceObjectHash);
     }
 }
 
@@ -130,6 +131,7 @@ std::string CMasternodeMetaMan::ToString() const
 {
     std::ostringstream info;
 
+    LOCK(cs);
     info << "Masternodes: meta infos object count: " << (int)metaInfos.size() <<
          ", nDsqCount: " << (int)nDsqCount;
     return info.str();
@@ -12,6 +12,9 @@
 #include <uint256.h>
 #include <sync.h>
 
+#include <atomic>
+#include <memory>
+
 class CConnman;
 
 static const int MASTERNODE_MAX_MIXING_TXES             = 5;
@@ -23,52 +26,63 @@ class CMasternodeMetaInfo
     friend class CMasternodeMetaMan;
 
 private:
+    // only protects mapGovernanceObjectsVotedOn, the counters below are atomic so that net threads don't contend on them
     mutable CCriticalSection cs;
 
     uint256 proTxHash;
 
     //the dsq count from the last dsq broadcast of this node
-    int64_t nLastDsq = 0;
-    int nMixingTxCount = 0;
+    std::atomic<int64_t> nLastDsq{0};
+    std::atomic<int> nMixingTxCount{0};
 
     // KEEP TRACK OF GOVERNANCE ITEMS EACH MASTERNODE HAS VOTE UPON FOR RECALCULATION
     std::map<uint256, int> mapGovernanceObjectsVotedOn;
 
-    int64_t lastOutboundAttempt = 0;
-    int64_t lastOutboundSuccess = 0;
+    std::atomic<int64_t> lastOutboundAttempt{0};
+    std::atomic<int64_t> lastOutboundSuccess{0};
 
 public:
     CMasternodeMetaInfo() = default;
     explicit CMasternodeMetaInfo(const uint256& _proTxHash) : proTxHash(_proTxHash) {}
     CMasternodeMetaInfo(const CMasternodeMetaInfo& ref) :
         proTxHash(ref.proTxHash),
-        nLastDsq(ref.nLastDsq),
-        nMixingTxCount(ref.nMixingTxCount),
-        mapGovernanceObjectsVotedOn(ref.mapGovernanceObjectsVotedOn),
-        lastOutboundAttempt(ref.lastOutboundAttempt),
-        lastOutboundSuccess(ref.lastOutboundSuccess)
+        nLastDsq(ref.nLastDsq.load()),
+        nMixingTxCount(ref.nMixingTxCount.load()),
+        mapGovernanceObjectsVotedOn(WITH_LOCK(ref.cs, return ref.mapGovernanceObjectsVotedOn)),
+        lastOutboundAttempt(ref.lastOutboundAttempt.load()),
+        lastOutboundSuccess(ref.lastOutboundSuccess.load())
+    {
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
     {
+        LOCK(cs);
+        s << proTxHash << nLastDsq.load() << nMixingTxCount.load() << mapGovernanceObjectsVotedOn
+          << lastOutboundAttempt.load() << lastOutboundSuccess.load();
     }
 
-    SERIALIZE_METHODS(CMasternodeMetaInfo, obj)
+    template<typename Stream>
+    void Unserialize(Stream& s)
     {
-        LOCK(obj.cs);
-        READWRITE(
-                obj.proTxHash,
-                obj.nLastDsq,
-                obj.nMixingTxCount,
-                obj.mapGovernanceObjectsVotedOn,
-                obj.lastOutboundAttempt,
-                obj.lastOutboundSuccess
-                );
+        LOCK(cs);
+        int64_t nLastDsqTmp, lastOutboundAttemptTmp, lastOutboundSuccessTmp;
+        int nMixingTxCountTmp;
+        s >> proTxHash >> nLastDsqTmp >> nMixingTxCountTmp >> mapGovernanceObjectsVotedOn
+          >> lastOutboundAttemptTmp >> lastOutboundSuccessTmp;
+        nLastDsq = nLastDsqTmp;
+        nMixingTxCount = nMixingTxCountTmp;
+        lastOutboundAttempt = lastOutboundAttemptTmp;
+        lastOutboundSuccess = lastOutboundSuccessTmp;
     }
 
     UniValue ToJson() const;
 
 public:
-    const uint256& GetProTxHash() const { LOCK(cs); return proTxHash; }
-    int64_t GetLastDsq() const { LOCK(cs); return nLastDsq; }
-    int GetMixingTxCount() const { LOCK(cs); return nMixingTxCount; }
+    // proTxHash is only ever set on construction/deserialization, before the object is shared
+    const uint256& GetProTxHash() const { return proTxHash; }
+    int64_t GetLastDsq() const { return nLastDsq; }
+    int GetMixingTxCount() const { return nMixingTxCount; }
 
     bool IsValidForMixingTxes() const { return GetMixingTxCount() <= MASTERNODE_MAX_MIXING_TXES; }
 
@@ -77,10 +91,10 @@ public:
 
     void RemoveGovernanceObject(const uint256& nGovernanceObjectHash);
 
-    void SetLastOutboundAttempt(int64_t t) { LOCK(cs); lastOutboundAttempt = t; }
-    int64_t GetLastOutboundAttempt() const { LOCK(cs); return lastOutboundAttempt; }
-    void SetLastOutboundSuccess(int64_t t) { LOCK(cs); lastOutboundSuccess = t; }
-    int64_t GetLastOutboundSuccess() const { LOCK(cs); return lastOutboundSuccess; }
+    void SetLastOutboundAttempt(int64_t t) { lastOutboundAttempt = t; }
+    int64_t GetLastOutboundAttempt() const { return lastOutboundAttempt; }
+    void SetLastOutboundSuccess(int64_t t) { lastOutboundSuccess = t; }
+    int64_t GetLastOutboundSuccess() const { return lastOutboundSuccess; }
 };
 typedef std::shared_ptr<CMasternodeMetaInfo> CMasternodeMetaInfoPtr;
 
@@ -95,7 +109,7 @@ private:
     std::vector<uint256> vecDirtyGovernanceObjectHashes;
 
     // keep track of dsq count to prevent masternodes from gaming coinjoin queue
-    int64_t nDsqCount = 0;
+    std::atomic<int64_t> nDsqCount{0};
 
 public:
     template<typename Stream>
@@ -106,7 +120,7 @@ public:
         for (auto& p : metaInfos) {
             tmpMetaInfo.emplace_back(*p.second);
         }
-        s << SERIALIZATION_VERSION_STRING << tmpMetaInfo << nDsqCount;
+        s << SERIALIZATION_VERSION_STRING << tmpMetaInfo << nDsqCount.load();
     }
 
     template<typename Stream>
@@ -120,7 +134,9 @@ public:
             return;
         }
         std::vector<CMasternodeMetaInfo> tmpMetaInfo;
-        s >> tmpMetaInfo >> nDsqCount;
+        int64_t nDsqCountTmp;
+        s >> tmpMetaInfo >> nDsqCountTmp;
+        nDsqCount = nDsqCountTmp;
         metaInfos.clear();
         for (auto& mm : tmpMetaInfo) {
             metaInfos.emplace(mm.GetProTxHash(), std::make_shared<CMasternodeMetaInfo>(std::move(mm)));
@@ -130,7 +146,7 @@ public:
 public:
     CMasternodeMetaInfoPtr GetMetaInfo(const uint256& proTxHash, bool fCreate = true);
 
-    int64_t GetDsqCount() { LOCK(cs); return nDsqCount; }
+    int64_t GetDsqCount() const { return nDsqCount; }
     int64_t GetDsqThreshold(const uint256& proTxHash, int nMnCount);
 
     void AllowMixing(const uint256& proTxHash);
@@ -79,7 +79,7 @@ void CMasternodeSync::SwitchToNextAsset(CConnman& connman)
             uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
 
             connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "full-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, FulfilledRequest::FULL_SYNC);
             });
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Sync has finished\n");
 
@@ -121,9 +121,6 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
     static int nTick = 0;
     nTick++;
 
-    const static int64_t nSyncStart = GetTimeMillis();
-    const static std::string strAllow = strprintf("allow-sync-%lld", nSyncStart);
-
     // reset the sync process if the last call to this function was more than 60 minutes ago (client was in sleep mode)
     static int64_t nTimeLastProcess = GetTime();
     if(GetTime() - nTimeLastProcess > 60*60 && !fMasternodeMode) {
@@ -150,11 +147,12 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
 
     LOCK(cs);
     // Calculate "progress" for LOG reporting / GUI notification
-    double nSyncProgress = double(nTriedPeerCount + (nCurrentAsset - 1) * 8) / (8*4);
+    double nSyncProgress = double(std::min(nTriedPeerCount, 8) + (nCurrentAsset - 1) * 8) / (8*4);
     LogPrint(BCLog::MNSYNC, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTriedPeerCount %d nSyncProgress %f\n", nTick, nCurrentAsset, nTriedPeerCount, nSyncProgress);
     uiInterface.NotifyAdditionalDataSyncProgressChanged(nSyncProgress);
 
     std::vector<CNode*> vNodesCopy = connman.CopyNodeVector(CConnman::FullyConnectedOnly);
+    int nGovernanceRequests = 0;
 
     for (auto& pnode : vNodesCopy)
     {
@@ -181,13 +179,13 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
 
         // NORMAL NETWORK MODE - TESTNET/MAINNET
         {
-            if ((pnode->fWhitelisted || pnode->m_manual_connection) && !netfulfilledman.HasFulfilledRequest(pnode->addr, strAllow)) {
+            if ((pnode->fWhitelisted || pnode->m_manual_connection) && !netfulfilledman.HasFulfilledRequest(pnode->addr, FulfilledRequest::ALLOW_SYNC)) {
                 netfulfilledman.RemoveAllFulfilledRequests(pnode->addr);
-                netfulfilledman.AddFulfilledRequest(pnode->addr, strAllow);
+                netfulfilledman.AddFulfilledRequest(pnode->addr, FulfilledRequest::ALLOW_SYNC);
                 LogPrintf("CMasternodeSync::ProcessTick -- skipping mnsync restrictions for peer=%d\n", pnode->GetId());
             }
 
-            if(netfulfilledman.HasFulfilledRequest(pnode->addr, "full-sync")) {
+            if(netfulfilledman.HasFulfilledRequest(pnode->addr, FulfilledRequest::FULL_SYNC)) {
                 // We already fully synced from this node recently,
                 // disconnect to free this connection slot for another peer.
                 pnode->fDisconnect = true;
@@ -197,9 +195,9 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
 
             // SPORK : ALWAYS ASK FOR SPORKS AS WE SYNC
 
-            if(!netfulfilledman.HasFulfilledRequest(pnode->addr, "spork-sync")) {
+            if(!netfulfilledman.HasFulfilledRequest(pnode->addr, FulfilledRequest::SPORK_SYNC)) {
                 // always get sporks first, only request once from each peer
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "spork-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, FulfilledRequest::SPORK_SYNC);
                 // get current network sporks
                 connman.PushMessage(pnode, msgMaker.Make(NetMsgType::GETSPORKS));
                 LogPrint(BCLog::MNSYNC, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- requesting sporks from peer=%d\n", nTick, nCurrentAsset, pnode->GetId());
@@ -223,9 +221,9 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                     if (gArgs.GetBoolArg("-syncmempool", DEFAULT_SYNC_MEMPOOL)) {
                         // Now that the blockchain is synced request the mempool from the connected outbound nodes if possible
                         for (auto pNodeTmp : vNodesCopy) {
-                            bool fRequestedEarlier = netfulfilledman.HasFulfilledRequest(pNodeTmp->addr, "mempool-sync");
+                            bool fRequestedEarlier = netfulfilledman.HasFulfilledRequest(pNodeTmp->addr, FulfilledRequest::MEMPOOL_SYNC);
                             if (pNodeTmp->nVersion >= 70216 && !pNodeTmp->fInbound && !fRequestedEarlier) {
-                                netfulfilledman.AddFulfilledRequest(pNodeTmp->addr, "mempool-sync");
+                                netfulfilledman.AddFulfilledRequest(pNodeTmp->addr, FulfilledRequest::MEMPOOL_SYNC);
                                 connman.PushMessage(pNodeTmp, msgMaker.Make(NetMsgType::MEMPOOL));
                                 LogPrint(BCLog::MNSYNC, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- syncing mempool from peer=%d\n", nTick, nCurrentAsset, pNodeTmp->GetId());
                             }
@@ -257,7 +255,7 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                 }
 
                 // only request obj sync once from each peer, then request votes on per-obj basis
-                if(netfulfilledman.HasFulfilledRequest(pnode->addr, "governance-sync")) {
+                if(netfulfilledman.HasFulfilledRequest(pnode->addr, FulfilledRequest::GOVERNANCE_SYNC)) {
                     int nObjsLeftToAsk = governance.RequestGovernanceObjectVotes(pnode, connman);
                     static int64_t nTimeNoObjectsLeft = 0;
                     // check for data
@@ -289,15 +287,18 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                     }
                     continue;
                 }
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "governance-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, FulfilledRequest::GOVERNANCE_SYNC);
 
                 if (pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
                 nTriedPeerCount++;
 
                 SendGovernanceSyncRequest(pnode, connman);
 
+                // ask a few peers in parallel, votes are then requested per object from all of them
+                if (++nGovernanceRequests < MASTERNODE_SYNC_GOVERNANCE_REQUESTS_PER_TICK) continue;
+
                 connman.ReleaseNodeVector(vNodesCopy);
-                return; //this will cause each peer to get one request each six seconds for the various assets we need
+                return; //this will cause up to MASTERNODE_SYNC_GOVERNANCE_REQUESTS_PER_TICK new peers to get a request each six seconds
             }
         }
     }
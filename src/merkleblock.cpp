@@ -7,7 +7,9 @@
 
 #include <hash.h>
 #include <consensus/consensus.h>
+#include <streams.h>
 #include <util/strencodings.h>
+#include <version.h>
 
 
 std::vector<unsigned char> BitsToBytes(const std::vector<bool>& bits)
@@ -28,7 +30,40 @@ std::vector<bool> BytesToBits(const std::vector<unsigned char>& bytes)
     return ret;
 }
 
-CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std::set<uint256>* txids)
+CBlockBloomElements::CBlockBloomElements(Span<const unsigned char> serializedBlock)
+{
+    SpanReader s(SER_NETWORK, PROTOCOL_VERSION, serializedBlock);
+    s >> static_cast<CBlockHeader&>(block);
+    uint64_t nTx = ReadCompactSize(s);
+    for (uint64_t i = 0; i < nTx; i++) {
+        size_t nBegin = serializedBlock.size() - s.size();
+        CTransactionRef tx;
+        s >> tx;
+        vTxRanges.emplace_back(nBegin, serializedBlock.size() - s.size() - nBegin);
+        block.vtx.emplace_back(std::move(tx));
+    }
+
+    vtx.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        vtx.emplace_back(tx);
+    }
+}
+
+size_t CBlockBloomElements::GetElementsSize() const
+{
+    size_t nSize = 0;
+    for (const auto& txElements : vtx) {
+        nSize += txElements.GetDataSize();
+    }
+    return nSize;
+}
+
+CMerkleBlock::CMerkleBlock(const CBlockBloomElements& elements, CBloomFilter& filter) :
+    CMerkleBlock(elements.block, &filter, nullptr, &elements.vtx)
+{
+}
+
+CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std::set<uint256>* txids, const std::vector<CTxBloomElements>* elements)
 {
     header = block.GetBlockHeader();
 
@@ -55,7 +90,7 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std:
 
         if (txids && txids->count(hash)) {
             vMatch.push_back(true);
-        } else if (isAllowedType && filter && filter->IsRelevantAndUpdate(*block.vtx[i])) {
+        } else if (isAllowedType && filter && (elements ? filter->IsRelevantAndUpdate((*elements)[i]) : filter->IsRelevantAndUpdate(*block.vtx[i]))) {
             vMatch.push_back(true);
             vMatchedTxn.emplace_back(i, hash);
         } else {
@@ -17,6 +17,26 @@
 std::vector<unsigned char> BitsToBytes(const std::vector<bool>& bits);
 std::vector<bool> BytesToBits(const std::vector<unsigned char>& bytes);
 
+/**
+ * A block together with the bloom filter elements of all of its transactions (see CTxBloomElements) and the location
+ * of every transaction in the serialized block. It allows serving a block as filtered block to many peers without
+ * parsing its scripts or serializing its transactions again.
+ */
+class CBlockBloomElements
+{
+public:
+    CBlock block;
+    std::vector<CTxBloomElements> vtx;
+    //! Offset and size of every transaction in the serialized block
+    std::vector<std::pair<uint32_t, uint32_t>> vTxRanges;
+
+    //! Decode a block serialized as it's sent over the network, throws std::ios_base::failure if it's invalid
+    explicit CBlockBloomElements(Span<const unsigned char> serializedBlock);
+
+    //! The size of all extracted elements
+    size_t GetElementsSize() const;
+};
+
 /** Data structure that represents a partial merkle tree.
  *
  * It represents a subset of the txid's of a known block, in a way that
@@ -141,10 +161,13 @@ public:
      * Note that this will call IsRelevantAndUpdate on the filter for each transaction,
      * thus the filter will likely be modified.
      */
-    CMerkleBlock(const CBlock& block, CBloomFilter& filter) : CMerkleBlock(block, &filter, nullptr) { }
+    CMerkleBlock(const CBlock& block, CBloomFilter& filter) : CMerkleBlock(block, &filter, nullptr, nullptr) { }
+
+    // Same as above, using the already extracted bloom filter elements of the block
+    CMerkleBlock(const CBlockBloomElements& elements, CBloomFilter& filter);
 
     // Create from a CBlock, matching the txids in the set
-    CMerkleBlock(const CBlock& block, const std::set<uint256>& txids) : CMerkleBlock(block, nullptr, &txids) { }
+    CMerkleBlock(const CBlock& block, const std::set<uint256>& txids) : CMerkleBlock(block, nullptr, &txids, nullptr) { }
 
     CMerkleBlock() {}
 
@@ -152,7 +175,7 @@ public:
 
 private:
     // Combined constructor to consolidate code
-    CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std::set<uint256>* txids);
+    CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std::set<uint256>* txids, const std::vector<CTxBloomElements>* elements);
 };
 
 #endif // BITCOIN_MERKLEBLOCK_H
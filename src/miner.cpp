@@ -108,7 +108,21 @@ void BlockAssembler::resetBlock()
     nFees = 0;
 }
 
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
+// Same parent and the same transactions, including the coinbase with its CbTx merkle roots
+static bool HasSameBody(const CBlock& a, const CBlock& b)
+{
+    if (a.hashPrevBlock != b.hashPrevBlock || a.nVersion != b.nVersion || a.nBits != b.nBits || a.vtx.size() != b.vtx.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.vtx.size(); i++) {
+        if (a.vtx[i]->GetHash() != b.vtx[i]->GetHash()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, const CBlock* pblockValidated)
 {
     int64_t nTimeStart = GetTimeMicros();
 
@@ -231,8 +245,11 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblocktemplate->nPrevBits = pindexPrev->nBits;
     pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*pblock->vtx[0]);
 
+    // Connecting a block which only differs in its header time from an already validated one can't have a different
+    // result, so a refresh which selected the same transactions again doesn't need to do it again
     CValidationState state;
-    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+    if ((!pblockValidated || !HasSameBody(*pblock, *pblockValidated)) &&
+        !TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     int64_t nTime2 = GetTimeMicros();
@@ -156,8 +156,11 @@ public:
     explicit BlockAssembler(const CChainParams& params);
     BlockAssembler(const CChainParams& params, const Options& options);
 
-    /** Construct a new block template with coinbase to scriptPubKeyIn */
-    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn);
+    /**
+     * Construct a new block template with coinbase to scriptPubKeyIn. The template is checked with TestBlockValidity,
+     * unless it has the same parent and transactions as pblockValidated, which must have passed that check before.
+     */
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, const CBlock* pblockValidated = nullptr);
 
 private:
     // utility functions
@@ -20,7 +20,9 @@
 #include <netbase.h>
 #include <scheduler.h>
 #include <ui_interface.h>
+#include <util/lz4.h>
 #include <util/strencodings.h>
+#include <util/trace.h>
 #include <validation.h>
 
 #include <masternode/masternode-meta.h>
@@ -764,7 +766,7 @@ std::string CNode::GetLogString() const
 
 #undef X
 #define X(name) stats.name = name
-void CNode::copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap)
+void CNode::copyStats(CNodeStats &stats, const ASMap &m_asmap)
 {
     stats.nodeid = this->GetId();
     X(nServices);
@@ -792,12 +794,21 @@ void CNode::copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
         X(nSendBytes);
+        X(nSendBytesCompressed);
+        X(nSendBytesUncompressed);
+        stats.nSendQueueSize = nSendSize;
+        stats.nSendQueueBulkSize = nSendMsgBulkSize;
     }
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
     }
+    X(fSendCompressed);
+    X(nRecvBytesCompressed);
+    X(nRecvBytesUncompressed);
+    X(nRecvBuffersAllocated);
+    X(nRecvBuffersReused);
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -849,6 +860,17 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         int handled;
         if (!msg.in_data) {
             handled = msg.readHeader(pch, nBytes);
+            if (msg.in_data && msg.hdr.nMessageSize > 0) {
+                LOCK(cs_vRecvBufferPool);
+                if (vRecvBufferPool.empty()) {
+                    nRecvBuffersAllocated++;
+                } else {
+                    nRecvBufferPoolBytes -= vRecvBufferPool.back().capacity();
+                    msg.vRecv.SwapBuffer(vRecvBufferPool.back());
+                    vRecvBufferPool.pop_back();
+                    nRecvBuffersReused++;
+                }
+            }
         } else {
             handled = msg.readData(pch, nBytes);
         }
@@ -946,18 +968,33 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
+    if (vRecv.capacity() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        vRecv.reserve(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
     }
 
+    // Append, so that the buffer isn't zero filled before it's overwritten
     hasher.Write({(const unsigned char*)pch, nCopy});
-    memcpy(&vRecv[nDataPos], pch, nCopy);
+    vRecv.write(pch, nCopy);
     nDataPos += nCopy;
 
     return nCopy;
 }
 
+void CNode::RecycleRecvBuffer(CDataStream& vRecv)
+{
+    CSerializeData buffer;
+    vRecv.SwapBuffer(buffer);
+    buffer.clear();
+
+    LOCK(cs_vRecvBufferPool);
+    if (buffer.capacity() == 0 || nRecvBufferPoolBytes + buffer.capacity() > MAX_RECV_BUFFER_POOL_BYTES) {
+        return;
+    }
+    nRecvBufferPoolBytes += buffer.capacity();
+    vRecvBufferPool.emplace_back(std::move(buffer));
+}
+
 const uint256& CNetMessage::GetMessageHash() const
 {
     assert(complete());
@@ -966,33 +1003,155 @@ const uint256& CNetMessage::GetMessageHash() const
     return data_hash;
 }
 
+#ifndef WIN32
+// Max number of queued buffers handed to a single sendmsg() call
+static const int SEND_MAX_IOV = 64;
+#endif
+
+// Max number of bulk bytes handed to the socket ahead of LLMQ-critical messages
+static const size_t SEND_BULK_WINDOW = 64 * 1024;
+
+// Messages which are time critical for InstantSend, ChainLocks and LLMQ signing. These are queued in front of
+// blocks, txes and sync data which are still waiting in vSendMsgBulk.
+static bool IsPrioritySendMsg(const std::string& command)
+{
+    return command == NetMsgType::ISLOCK ||
+           command == NetMsgType::CLSIG ||
+           command == NetMsgType::QSIGREC ||
+           command == NetMsgType::QSIGSHARE ||
+           command == NetMsgType::QBSIGSHARES ||
+           command == NetMsgType::QSIGSHARESINV ||
+           command == NetMsgType::QGETSIGSHARES ||
+           command == NetMsgType::QSIGSESANN;
+}
+
+bool IsCompressibleMsg(const std::string& command)
+{
+    return command == NetMsgType::QDATA ||
+           command == NetMsgType::MNLISTDIFF ||
+           command == NetMsgType::MNGOVERNANCEOBJECT ||
+           command == NetMsgType::MNGOVERNANCEOBJECTVOTE;
+}
+
+// LZ4MSG consists of the command of the wrapped message, the size of its payload and the LZ4 block of the payload.
+// Returns false if compression doesn't make the message smaller, in which case it should be sent as is
+static bool CompressMsg(const CSerializedNetMsg& msg, CSerializedNetMsg& compressedRet)
+{
+    std::vector<uint8_t> compressed;
+    util::LZ4Compress(msg.data, compressed);
+
+    compressedRet.command = NetMsgType::LZ4MSG;
+    compressedRet.data.clear();
+    compressedRet.data.reserve(CMessageHeader::COMMAND_SIZE + 4 + compressed.size());
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, compressedRet.data, 0, msg.command, (uint32_t)msg.data.size()};
+    compressedRet.data.insert(compressedRet.data.end(), compressed.begin(), compressed.end());
+    return compressedRet.data.size() < msg.data.size();
+}
+
+bool DecompressMsg(CDataStream& vRecv, std::string& strCommandRet)
+{
+    std::string strCommand;
+    uint32_t nSize;
+    try {
+        vRecv >> LIMITED_STRING(strCommand, CMessageHeader::COMMAND_SIZE) >> nSize;
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (!IsCompressibleMsg(strCommand) || nSize > MAX_PROTOCOL_MESSAGE_LENGTH) {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    if (!util::LZ4Decompress(MakeUCharSpan(vRecv), nSize, data)) {
+        return false;
+    }
+    vRecv.clear();
+    vRecv.write((const char*)data.data(), data.size());
+    strCommandRet = std::move(strCommand);
+    return true;
+}
+
+std::list<std::vector<unsigned char>>::iterator CNode::CommitBulkSendMsgs()
+{
+    AssertLockHeld(cs_vSend);
+
+    auto itFirst = vSendMsg.end();
+    // nSendSize includes the bulk messages, but not the part of the first buffer which was already sent
+    while (!vSendMsgBulk.empty() && nSendSize - nSendMsgBulkSize - nSendOffset < SEND_BULK_WINDOW) {
+        auto& msg = vSendMsgBulk.front();
+        nSendMsgBulkSize -= msg.first.size() + msg.second.size();
+        auto itHeader = vSendMsg.insert(vSendMsg.end(), std::move(msg.first));
+        if (!msg.second.empty()) {
+            vSendMsg.push_back(std::move(msg.second));
+        }
+        if (itFirst == vSendMsg.end()) {
+            itFirst = itHeader;
+        }
+        vSendMsgBulk.pop_front();
+    }
+    nSendMsgSize = vSendMsg.size() + vSendMsgBulk.size();
+    return itFirst;
+}
+
 size_t CConnman::SocketSendData(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend)
 {
+    pnode->CommitBulkSendMsgs();
     auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = 0;
+        assert(it->size() > pnode->nSendOffset);
+        size_t nRequested = 0;
+        int64_t nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            const auto &data = *it;
+            nRequested = data.size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, nRequested, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // PushMessage queues headers and payloads as separate buffers, gather as many of them as we can into
+            // a single call instead of doing one send() per buffer
+            struct iovec iov[SEND_MAX_IOV];
+            int nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto jt = it; jt != pnode->vSendMsg.end() && nIov < SEND_MAX_IOV; ++jt, ++nIov) {
+                iov[nIov].iov_base = const_cast<unsigned char*>(jt->data()) + nOffset;
+                iov[nIov].iov_len = jt->size() - nOffset;
+                nRequested += iov[nIov].iov_len;
+                nOffset = 0;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                size_t nRemaining = it->size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            auto itCommitted = pnode->CommitBulkSendMsgs();
+            if (it == pnode->vSendMsg.end()) {
+                it = itCommitted;
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nRequested) {
+                // could not send everything; stop sending more
                 pnode->fCanSendData = false;
                 break;
             }
@@ -1017,7 +1176,7 @@ size_t CConnman::SocketSendData(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
-    pnode->nSendMsgSize = pnode->vSendMsg.size();
+    pnode->nSendMsgSize = pnode->vSendMsg.size() + pnode->vSendMsgBulk.size();
     return nSentSize;
 }
 
@@ -1353,6 +1512,15 @@ void CConnman::DisconnectNodes()
 
                 // remove from vNodes
                 it = vNodes.erase(it);
+                if (!pnode->verifiedProRegTxHash.IsNull()) {
+                    auto range = mapVerifiedMasternodeNodes.equal_range(pnode->verifiedProRegTxHash);
+                    for (auto itMn = range.first; itMn != range.second; ++itMn) {
+                        if (itMn->second == pnode) {
+                            mapVerifiedMasternodeNodes.erase(itMn);
+                            break;
+                        }
+                    }
+                }
 
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
@@ -1554,10 +1722,16 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
+#if defined(USE_KQUEUE) || defined(USE_EPOLL)
+// How many ready sockets a single epoll_wait/kevent call may return. Masternodes keep hundreds of quorum
+// connections, so a small batch means many extra wakeups of the socket handler during signing bursts.
+static const size_t SOCKET_EVENTS_MAX_EVENTS = 256;
+#endif
+
 #ifdef USE_KQUEUE
 void CConnman::SocketEventsKqueue(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll)
 {
-    const size_t maxEvents = 64;
+    const size_t maxEvents = SOCKET_EVENTS_MAX_EVENTS;
     struct kevent events[maxEvents];
 
     struct timespec timeout;
@@ -1592,7 +1766,7 @@ void CConnman::SocketEventsKqueue(std::set<SOCKET> &recv_set, std::set<SOCKET> &
 #ifdef USE_EPOLL
 void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll)
 {
-    const size_t maxEvents = 64;
+    const size_t maxEvents = SOCKET_EVENTS_MAX_EVENTS;
     epoll_event events[maxEvents];
 
     wakeupSelectNeeded = true;
@@ -1789,6 +1963,10 @@ void CConnman::SocketHandler()
     std::set<SOCKET> recv_set, send_set, error_set;
     SocketEvents(recv_set, send_set, error_set, fOnlyPoll);
 
+    statsClient.count("net.socketEvents.recv", recv_set.size(), 0.01f);
+    statsClient.count("net.socketEvents.send", send_set.size(), 0.01f);
+    statsClient.count("net.socketEvents.error", error_set.size(), 0.01f);
+
 #ifdef USE_WAKEUP_PIPE
     // drain the wakeup pipe
     if (recv_set.count(wakeupPipe[0])) {
@@ -2050,6 +2228,15 @@ void CConnman::WakeMessageHandler()
     condMsgProc.notify_one();
 }
 
+void CConnman::WakeMasternodeConnections()
+{
+    {
+        LOCK(mutexMasternodeConn);
+        fMasternodeConnWake = true;
+    }
+    condMasternodeConn.notify_one();
+}
+
 void CConnman::WakeSelect()
 {
 #ifdef USE_WAKEUP_PIPE
@@ -2621,7 +2808,14 @@ void CConnman::ThreadOpenMasternodeConnections()
         if (didConnect) {
             sleepTime = 100;
         }
-        if (!interruptNet.sleep_for(std::chrono::milliseconds(sleepTime)))
+        {
+            // New quorum connections are usually set at the start of a DKG round, don't let them wait for the
+            // next poll as the handshakes have to finish before the contribution phase starts
+            WAIT_LOCK(mutexMasternodeConn, lock);
+            condMasternodeConn.wait_for(lock, std::chrono::milliseconds(sleepTime), [this]() EXCLUSIVE_LOCKS_REQUIRED(mutexMasternodeConn) { return fMasternodeConnWake || interruptNet; });
+            fMasternodeConnWake = false;
+        }
+        if (interruptNet)
             return;
 
         didConnect = false;
@@ -3274,7 +3468,8 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
-    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
+    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000,
+                            SchedulerTaskOptions{"dumpaddresses", SchedulerPriority::LOW, ""});
 
     return true;
 }
@@ -3311,6 +3506,10 @@ void CConnman::Interrupt()
     condMsgProc.notify_all();
 
     interruptNet();
+    {
+        LOCK(mutexMasternodeConn);
+    }
+    condMasternodeConn.notify_all();
     InterruptSocks5(true);
 
     if (semOutbound) {
@@ -3381,6 +3580,7 @@ void CConnman::Stop()
     }
     vNodes.clear();
     mapSocketToNode.clear();
+    mapVerifiedMasternodeNodes.clear();
     {
         LOCK(cs_vNodes);
         mapReceivableNodes.clear();
@@ -3500,10 +3700,18 @@ bool CConnman::AddPendingMasternode(const uint256& proTxHash)
 
 void CConnman::SetMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes)
 {
-    LOCK(cs_vPendingMasternodes);
-    auto it = masternodeQuorumNodes.emplace(std::make_pair(llmqType, quorumHash), proTxHashes);
-    if (!it.second) {
-        it.first->second = proTxHashes;
+    bool fChanged;
+    {
+        LOCK(cs_vPendingMasternodes);
+        auto it = masternodeQuorumNodes.emplace(std::make_pair(llmqType, quorumHash), proTxHashes);
+        fChanged = it.second;
+        if (!it.second && it.first->second != proTxHashes) {
+            it.first->second = proTxHashes;
+            fChanged = true;
+        }
+    }
+    if (fChanged) {
+        WakeMasternodeConnections();
     }
 }
 
@@ -3625,8 +3833,39 @@ bool CConnman::IsMasternodeQuorumRelayMember(const uint256& protxHash)
 
 void CConnman::AddPendingProbeConnections(const std::set<uint256> &proTxHashes)
 {
-    LOCK(cs_vPendingMasternodes);
-    masternodePendingProbes.insert(proTxHashes.begin(), proTxHashes.end());
+    {
+        LOCK(cs_vPendingMasternodes);
+        masternodePendingProbes.insert(proTxHashes.begin(), proTxHashes.end());
+    }
+    WakeMasternodeConnections();
+}
+
+void CConnman::SetVerifiedMasternodeNode(const uint256& proRegTxHash, CNode* pnode)
+{
+    LOCK(cs_vNodes);
+    if (pnode->fDisconnect) {
+        // DisconnectNodes might have removed it from vNodes already
+        return;
+    }
+    auto range = mapVerifiedMasternodeNodes.equal_range(proRegTxHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == pnode) {
+            return;
+        }
+    }
+    mapVerifiedMasternodeNodes.emplace(proRegTxHash, pnode);
+}
+
+bool CConnman::ForVerifiedMasternodeNode(const uint256& proRegTxHash, std::function<bool(CNode* pnode)> func)
+{
+    LOCK(cs_vNodes);
+    auto range = mapVerifiedMasternodeNodes.equal_range(proRegTxHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (func(it->second)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 size_t CConnman::GetNodeCount(NumConnections flags)
@@ -3690,7 +3929,7 @@ void CConnman::RelayTransaction(const CTransaction& tx)
 {
     uint256 hash = tx.GetHash();
     int nInv = MSG_TX;
-    if (CCoinJoin::GetDSTX(hash)) {
+    if (CCoinJoin::HasDSTX(hash)) {
         nInv = MSG_DSTX;
     }
     CInv inv(nInv, hash);
@@ -3698,20 +3937,28 @@ void CConnman::RelayTransaction(const CTransaction& tx)
 }
 
 void CConnman::RelayInv(CInv &inv, const int minProtoVersion) {
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        if (pnode->nVersion < minProtoVersion || !pnode->CanRelay())
+    // Only hold cs_vNodes while taking refs, so that relaying from the LLMQ worker threads doesn't block the
+    // socket and message handler threads while we lock every node's cs_inventory
+    auto vNodesCopy = CopyNodeVector([&](const CNode* pnode) {
+        return pnode->nVersion >= minProtoVersion && pnode->CanRelay();
+    });
+    // one lookup to find the peers which know inv already instead of one per peer
+    const CPeerSlotSet knownSlots = inv.type != MSG_BLOCK ? g_known_inventory.GetKnownSlots(inv.hash) : CPeerSlotSet();
+    for (const auto& pnode : vNodesCopy) {
+        if (knownSlots.Contains(pnode->nKnownSlot)) {
             continue;
+        }
         pnode->PushInventory(inv);
     }
+    ReleaseNodeVector(vNodesCopy);
 }
 
 void CConnman::RelayInvFiltered(CInv &inv, const CTransaction& relatedTx, const int minProtoVersion)
 {
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        if (pnode->nVersion < minProtoVersion || !pnode->CanRelay())
-            continue;
+    auto vNodesCopy = CopyNodeVector([&](const CNode* pnode) {
+        return pnode->nVersion >= minProtoVersion && pnode->CanRelay();
+    });
+    for (const auto& pnode : vNodesCopy) {
         {
             LOCK(pnode->cs_filter);
             if(pnode->pfilter && !pnode->pfilter->IsRelevantAndUpdate(relatedTx))
@@ -3719,20 +3966,22 @@ void CConnman::RelayInvFiltered(CInv &inv, const CTransaction& relatedTx, const
         }
         pnode->PushInventory(inv);
     }
+    ReleaseNodeVector(vNodesCopy);
 }
 
 void CConnman::RelayInvFiltered(CInv &inv, const uint256& relatedTxHash, const int minProtoVersion)
 {
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        if (pnode->nVersion < minProtoVersion || !pnode->CanRelay())
-            continue;
+    auto vNodesCopy = CopyNodeVector([&](const CNode* pnode) {
+        return pnode->nVersion >= minProtoVersion && pnode->CanRelay();
+    });
+    for (const auto& pnode : vNodesCopy) {
         {
             LOCK(pnode->cs_filter);
             if(pnode->pfilter && !pnode->pfilter->contains(relatedTxHash)) continue;
         }
         pnode->PushInventory(inv);
     }
+    ReleaseNodeVector(vNodesCopy);
 }
 
 void CConnman::RecordBytesRecv(uint64_t bytes)
@@ -3872,8 +4121,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     addrBind(addrBindIn),
     fInbound(fInboundIn),
     nKeyedNetGroup(nKeyedNetGroupIn),
-    addrKnown(5000, 0.001),
-    filterInventoryKnown(50000, 0.000001),
+    nKnownSlot(AllocatePeerSlot()),
     id(idIn),
     nLocalHostNonce(nLocalHostNonceIn),
     nLocalServices(nLocalServicesIn),
@@ -3905,7 +4153,6 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nSendOffset = 0;
     hashContinue = uint256();
     nStartingHeight = -1;
-    filterInventoryKnown.reset();
     fSendMempool = false;
     fGetAddr = false;
     nNextLocalAddrSend = 0;
@@ -3943,6 +4190,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
 CNode::~CNode()
 {
     CloseSocket(hSocket);
+    ReleasePeerSlot(nKnownSlot);
 }
 
 bool CConnman::NodeFullyConnected(const CNode* pnode)
@@ -3952,9 +4200,20 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
+    size_t nUncompressedSize = 0;
+    if (pnode->fSendCompressed && msg.data.size() >= MIN_COMPRESSED_MSG_SIZE && IsCompressibleMsg(msg.command)) {
+        CSerializedNetMsg compressedMsg;
+        if (CompressMsg(msg, compressedMsg)) {
+            LogPrint(BCLog::NET, "compressed %s (%d -> %d bytes) peer=%d\n", SanitizeString(msg.command.c_str()), msg.data.size(), compressedMsg.data.size(), pnode->GetId());
+            nUncompressedSize = msg.data.size();
+            msg = std::move(compressedMsg);
+        }
+    }
+
     size_t nMessageSize = msg.data.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+    TRACE3(net, outbound_message, pnode->GetId(), msg.command.c_str(), nMessageSize);
     statsClient.count("bandwidth.message." + SanitizeString(msg.command.c_str()) + ".bytesSent", nTotalSize, 1.0f);
     statsClient.inc("message.sent." + SanitizeString(msg.command.c_str()), 1.0f);
 
@@ -3969,18 +4228,28 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
-        bool hasPendingData = !pnode->vSendMsg.empty();
+        bool hasPendingData = !pnode->vSendMsg.empty() || !pnode->vSendMsgBulk.empty();
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
+        if (nUncompressedSize != 0) {
+            pnode->nSendBytesCompressed += nMessageSize;
+            pnode->nSendBytesUncompressed += nUncompressedSize;
+        }
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
-        pnode->nSendMsgSize = pnode->vSendMsg.size();
+        if (pnode->fSuccessfullyConnected && IsPrioritySendMsg(msg.command)) {
+            pnode->vSendMsg.push_back(std::move(serializedHeader));
+            if (nMessageSize)
+                pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->nSendMsgSize = pnode->vSendMsg.size() + pnode->vSendMsgBulk.size();
+        } else {
+            pnode->vSendMsgBulk.emplace_back(std::move(serializedHeader), std::move(msg.data));
+            pnode->nSendMsgBulkSize += nTotalSize;
+            pnode->CommitBulkSendMsgs();
+        }
 
         {
             LOCK(cs_mapNodesWithDataToSend);
@@ -15,6 +15,7 @@
 #include <hash.h>
 #include <limitedmap.h>
 #include <netaddress.h>
+#include <net_known.h>
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
@@ -63,6 +64,8 @@ static const unsigned int MAX_LOCATOR_SZ = 101;
 static const unsigned int MAX_ADDR_TO_SEND = 1000;
 /** Maximum length of incoming protocol messages (no message over 3 MiB is currently acceptable). */
 static const unsigned int MAX_PROTOCOL_MESSAGE_LENGTH = 3 * 1024 * 1024;
+/** Maximum total capacity of the receive buffers a connection keeps to reuse for new messages */
+static const size_t MAX_RECV_BUFFER_POOL_BYTES = 256 * 1024;
 /** Maximum length of the user agent string in `version` message */
 static const unsigned int MAX_SUBVERSION_LENGTH = 256;
 /** Maximum number of automatic outgoing nodes */
@@ -91,6 +94,10 @@ static const uint64_t MAX_UPLOAD_TIMEFRAME = 60 * 60 * 24;
 static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** -p2pcompression default */
+static const bool DEFAULT_P2P_COMPRESSION = true;
+/** Bulk messages smaller than this are sent uncompressed, LZ4 can't save much on them */
+static const size_t MIN_COMPRESSED_MSG_SIZE = 512;
 
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
@@ -135,6 +142,15 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** Bulk message types which CConnman::PushMessage compresses into LZ4MSG for peers that sent SENDLZ4 */
+bool IsCompressibleMsg(const std::string& command);
+
+/**
+ * Replace the payload of an LZ4MSG by the message it wraps. Fails if the payload is malformed, wraps a message type
+ * which is not compressible or would decompress to more than MAX_PROTOCOL_MESSAGE_LENGTH bytes.
+ */
+bool DecompressMsg(CDataStream& vRecv, std::string& strCommandRet);
+
 class NetEventsInterface;
 class CConnman
 {
@@ -170,6 +186,7 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        bool m_p2p_compression = DEFAULT_P2P_COMPRESSION;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
@@ -193,6 +210,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_p2p_compression = connOptions.m_p2p_compression;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -428,6 +446,10 @@ public:
     bool IsMasternodeQuorumNode(const CNode* pnode);
     bool IsMasternodeQuorumRelayMember(const uint256& protxHash);
     void AddPendingProbeConnections(const std::set<uint256>& proTxHashes);
+    // Remembers pnode as one of the connections which successfully authenticated via MNAUTH as proRegTxHash
+    void SetVerifiedMasternodeNode(const uint256& proRegTxHash, CNode* pnode);
+    // Calls func on the connections which authenticated as proRegTxHash until it returns true, without walking vNodes
+    bool ForVerifiedMasternodeNode(const uint256& proRegTxHash, std::function<bool(CNode* pnode)> func);
 
     size_t GetNodeCount(NumConnections num);
     size_t GetMaxOutboundNodeCount();
@@ -469,7 +491,11 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    /** Whether we announce SENDLZ4 to peers and accept LZ4MSG from them */
+    bool IsCompressionEnabled() const { return m_p2p_compression; }
+
     void WakeMessageHandler();
+    void WakeMasternodeConnections();
     void WakeSelect();
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
@@ -570,6 +596,8 @@ private:
     // P2P timeout in seconds
     int64_t m_peer_connect_timeout;
 
+    bool m_p2p_compression{DEFAULT_P2P_COMPRESSION};
+
     // Whitelisted ranges. Any node connecting from these is automatically
     // whitelisted (as well as those connecting to whitelisted binds).
     std::vector<CSubNet> vWhitelistedRange;
@@ -596,6 +624,7 @@ private:
     std::vector<CNode*> vNodes;
     std::list<CNode*> vNodesDisconnected;
     std::unordered_map<SOCKET, CNode*> mapSocketToNode;
+    std::unordered_multimap<uint256, CNode*, StaticSaltedHasher> mapVerifiedMasternodeNodes; // protected by cs_vNodes
     mutable CCriticalSection cs_vNodes;
     std::atomic<NodeId> nLastNodeId;
     unsigned int nPrevNodeCount;
@@ -624,6 +653,11 @@ private:
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
+    /** flag for waking ThreadOpenMasternodeConnections when new masternode connections are wanted */
+    bool fMasternodeConnWake GUARDED_BY(mutexMasternodeConn){false};
+    std::condition_variable condMasternodeConn;
+    Mutex mutexMasternodeConn;
+
     CThreadInterrupt interruptNet;
 
 #ifdef USE_WAKEUP_PIPE
@@ -766,8 +800,17 @@ public:
     int nStartingHeight;
     uint64_t nSendBytes;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
+    size_t nSendQueueSize;
+    size_t nSendQueueBulkSize;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    bool fSendCompressed;
+    uint64_t nSendBytesCompressed;
+    uint64_t nSendBytesUncompressed;
+    uint64_t nRecvBytesCompressed;
+    uint64_t nRecvBytesUncompressed;
+    uint64_t nRecvBuffersAllocated;
+    uint64_t nRecvBuffersReused;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -845,6 +888,9 @@ public:
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend);
     std::list<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    // header and payload of messages queued behind the LLMQ-critical ones, moved to vSendMsg by CommitBulkSendMsgs
+    std::deque<std::pair<std::vector<unsigned char>, std::vector<unsigned char>>> vSendMsgBulk GUARDED_BY(cs_vSend);
+    size_t nSendMsgBulkSize GUARDED_BY(cs_vSend){0}; // total size of all vSendMsgBulk entries
     std::atomic<size_t> nSendMsgSize;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
@@ -856,6 +902,16 @@ public:
 
     CCriticalSection cs_sendProcessing;
 
+    /** Receive buffers of processed messages, which new messages are received into. Message payloads are public, so
+        they don't need to be allocated and zeroed on free (see zero_after_free_allocator) for every single message.
+        Messages which don't fit the recycled capacity still allocate, and larger buffers are freed as usual. */
+    Mutex cs_vRecvBufferPool;
+    std::vector<CSerializeData> vRecvBufferPool GUARDED_BY(cs_vRecvBufferPool);
+    size_t nRecvBufferPoolBytes GUARDED_BY(cs_vRecvBufferPool){0};
+    //! Messages with a payload which got a fresh buffer, and which reused a recycled one
+    std::atomic<uint64_t> nRecvBuffersAllocated{0};
+    std::atomic<uint64_t> nRecvBuffersReused{0};
+
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes GUARDED_BY(cs_vRecv);
     std::atomic<int> nRecvVersion;
@@ -933,14 +989,13 @@ public:
 
     // flood relay
     std::vector<CAddress> vAddrToSend;
-    CRollingBloomFilter addrKnown;
     bool fGetAddr;
     std::set<uint256> setKnown;
     int64_t nNextAddrSend GUARDED_BY(cs_sendProcessing);
     int64_t nNextLocalAddrSend GUARDED_BY(cs_sendProcessing);
 
-    // inventory based relay
-    CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_inventory);
+    // inventory based relay, what the peer knows is tracked in g_known_inventory/g_known_addresses under this slot
+    const int nKnownSlot;
     // Set of transaction ids we still have to announce.
     // They are sorted by the mempool before relay, so the order is not important.
     std::set<uint256> setInventoryTxToSend;
@@ -979,6 +1034,14 @@ public:
     // If true, we will send him CoinJoin queue messages
     std::atomic<bool> fSendDSQueue{false};
 
+    // If true, the peer accepts bulk messages compressed into LZ4MSG, see IsCompressibleMsg
+    std::atomic<bool> fSendCompressed{false};
+    // Payload sizes of the LZ4MSG messages we sent/received and of the messages they wrapped
+    uint64_t nSendBytesCompressed GUARDED_BY(cs_vSend){0};
+    uint64_t nSendBytesUncompressed GUARDED_BY(cs_vSend){0};
+    std::atomic<uint64_t> nRecvBytesCompressed{0};
+    std::atomic<uint64_t> nRecvBytesUncompressed{0};
+
     // Challenge sent in VERSION to be answered with MNAUTH (only happens between MNs)
     mutable CCriticalSection cs_mnauth;
     uint256 sentMNAuthChallenge;
@@ -1034,6 +1097,8 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    //! Give the receive buffer of a processed message back, so that a later message can be received into it
+    void RecycleRecvBuffer(CDataStream& vRecv);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -1063,9 +1128,21 @@ public:
 
 
 
-    void AddAddressKnown(const CAddress& _addr)
+    static uint256 GetAddressKnownKey(const CAddress& _addr)
     {
-        addrKnown.insert(_addr.GetKey());
+        const std::vector<unsigned char> key = _addr.GetKey();
+        return Hash(key.begin(), key.end());
+    }
+
+    //! Returns false if the peer knew the address already
+    bool AddAddressKnown(const CAddress& _addr)
+    {
+        return g_known_addresses.Insert(nKnownSlot, GetAddressKnownKey(_addr));
+    }
+
+    bool IsAddressKnown(const CAddress& _addr) const
+    {
+        return g_known_addresses.Contains(nKnownSlot, GetAddressKnownKey(_addr));
     }
 
     void PushAddress(const CAddress& _addr, FastRandomContext &insecure_rand)
@@ -1078,7 +1155,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
-        if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey()) && addr_format_supported) {
+        if (_addr.IsValid() && addr_format_supported && !IsAddressKnown(_addr)) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
             } else {
@@ -1095,17 +1172,19 @@ public:
 
     void AddInventoryKnown(const uint256& hash)
     {
-        {
-            LOCK(cs_inventory);
-            filterInventoryKnown.insert(hash);
-        }
+        g_known_inventory.Insert(nKnownSlot, hash);
+    }
+
+    bool IsInventoryKnown(const uint256& hash) const
+    {
+        return g_known_inventory.Contains(nKnownSlot, hash);
     }
 
     void PushInventory(const CInv& inv)
     {
         LOCK(cs_inventory);
         if (inv.type == MSG_TX || inv.type == MSG_DSTX) {
-            if (!filterInventoryKnown.contains(inv.hash)) {
+            if (!IsInventoryKnown(inv.hash)) {
                 LogPrint(BCLog::NET, "%s -- adding new inv: %s peer=%d\n", __func__, inv.ToString(), id);
                 setInventoryTxToSend.insert(inv.hash);
             } else {
@@ -1115,7 +1194,7 @@ public:
             LogPrint(BCLog::NET, "%s -- adding new inv: %s peer=%d\n", __func__, inv.ToString(), id);
             vInventoryBlockToSend.push_back(inv.hash);
         } else {
-            if (!filterInventoryKnown.contains(inv.hash)) {
+            if (!IsInventoryKnown(inv.hash)) {
                 LogPrint(BCLog::NET, "%s -- adding new inv: %s peer=%d\n", __func__, inv.ToString(), id);
                 vInventoryOtherToSend.push_back(inv);
             } else {
@@ -1132,7 +1211,9 @@ public:
 
     void CloseSocketDisconnect(CConnman* connman);
 
-    void copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap);
+    void copyStats(CNodeStats &stats, const ASMap &m_asmap);
+
+    std::list<std::vector<unsigned char>>::iterator CommitBulkSendMsgs() EXCLUSIVE_LOCKS_REQUIRED(cs_vSend);
 
     ServiceFlags GetLocalServices() const
     {
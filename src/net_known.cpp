@@ -0,0 +1,127 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <net_known.h>
+
+#include <assert.h>
+
+CPeerKnownTable g_known_inventory(MAX_KNOWN_INVENTORY_PER_PEER);
+CPeerKnownTable g_known_addresses(MAX_KNOWN_ADDRESSES_PER_PEER);
+
+static CCriticalSection cs_peer_slots;
+static std::vector<bool> g_peer_slots_used GUARDED_BY(cs_peer_slots);
+
+CPeerKnownTable::CPeerKnownTable(size_t nMaxPerPeerIn) :
+    nMaxPerPeer(nMaxPerPeerIn)
+{
+}
+
+void CPeerKnownTable::ForgetKnown(int slot, const uint256& hash)
+{
+    AssertLockHeld(cs);
+    auto it = mapKnown.find(hash);
+    assert(it != mapKnown.end());
+    it->second.Erase(slot);
+    if (it->second.IsEmpty()) {
+        mapKnown.erase(it);
+    }
+}
+
+bool CPeerKnownTable::Insert(int slot, const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapKnown.find(hash);
+    if (it == mapKnown.end()) {
+        it = mapKnown.emplace(hash, CPeerSlotSet()).first;
+    } else if (it->second.Contains(slot)) {
+        return false;
+    }
+    it->second.Insert(slot);
+
+    if ((size_t)slot >= vPeers.size()) {
+        vPeers.resize(slot + 1);
+    }
+    PeerKnown& peer = vPeers[slot];
+    // pointers to the keys stay valid until the element is erased, unlike iterators which rehashing invalidates.
+    // Elements are only erased once no peer knows them anymore, so this peer's pointers are valid as long as it knows
+    // the objects.
+    if (peer.vOrder.size() < nMaxPerPeer) {
+        peer.vOrder.emplace_back(&it->first);
+    } else {
+        // copied, as the key must not be a reference into the element which might get erased
+        const uint256 oldest = *peer.vOrder[peer.nOrderPos];
+        peer.vOrder[peer.nOrderPos] = &it->first;
+        peer.nOrderPos = (peer.nOrderPos + 1) % nMaxPerPeer;
+        ForgetKnown(slot, oldest);
+    }
+    return true;
+}
+
+bool CPeerKnownTable::Contains(int slot, const uint256& hash) const
+{
+    LOCK(cs);
+    auto it = mapKnown.find(hash);
+    return it != mapKnown.end() && it->second.Contains(slot);
+}
+
+CPeerSlotSet CPeerKnownTable::GetKnownSlots(const uint256& hash) const
+{
+    LOCK(cs);
+    auto it = mapKnown.find(hash);
+    if (it == mapKnown.end()) {
+        return CPeerSlotSet();
+    }
+    return it->second;
+}
+
+void CPeerKnownTable::EraseSlot(int slot)
+{
+    LOCK(cs);
+    if ((size_t)slot >= vPeers.size()) {
+        return;
+    }
+    PeerKnown& peer = vPeers[slot];
+    for (const uint256* hash : peer.vOrder) {
+        // copied for the same reason as in Insert
+        ForgetKnown(slot, uint256(*hash));
+    }
+    peer = PeerKnown();
+}
+
+size_t CPeerKnownTable::Size() const
+{
+    LOCK(cs);
+    return mapKnown.size();
+}
+
+void CPeerKnownTable::Clear()
+{
+    LOCK(cs);
+    mapKnown.clear();
+    vPeers.clear();
+}
+
+int AllocatePeerSlot()
+{
+    LOCK(cs_peer_slots);
+    for (size_t i = 0; i < g_peer_slots_used.size(); i++) {
+        if (!g_peer_slots_used[i]) {
+            g_peer_slots_used[i] = true;
+            return i;
+        }
+    }
+    g_peer_slots_used.emplace_back(true);
+    return g_peer_slots_used.size() - 1;
+}
+
+void ReleasePeerSlot(int slot)
+{
+    // slots are only reused after this, so the next peer doesn't inherit what this one knew
+    g_known_inventory.EraseSlot(slot);
+    g_known_addresses.EraseSlot(slot);
+
+    LOCK(cs_peer_slots);
+    assert(slot >= 0 && (size_t)slot < g_peer_slots_used.size() && g_peer_slots_used[slot]);
+    g_peer_slots_used[slot] = false;
+}
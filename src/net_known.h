@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NET_KNOWN_H
+#define BITCOIN_NET_KNOWN_H
+
+#include <prevector.h>
+#include <saltedhasher.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+//! Number of inventory items each peer is remembered to know, same as the rolling filter this replaced
+static const size_t MAX_KNOWN_INVENTORY_PER_PEER = 50000;
+//! Number of addresses each peer is remembered to know, same as the rolling filter this replaced
+static const size_t MAX_KNOWN_ADDRESSES_PER_PEER = 5000;
+
+/**
+ * A set of peer slots. Slots are small integers handed out by AllocatePeerSlot, so a couple of words cover all
+ * connections without a heap allocation.
+ */
+class CPeerSlotSet
+{
+private:
+    prevector<2, uint64_t> vWords;
+
+public:
+    bool Contains(int slot) const
+    {
+        size_t word = slot / 64;
+        return word < vWords.size() && ((vWords[word] >> (slot % 64)) & 1);
+    }
+    void Insert(int slot)
+    {
+        size_t word = slot / 64;
+        if (word >= vWords.size()) {
+            vWords.resize(word + 1);
+        }
+        vWords[word] |= uint64_t{1} << (slot % 64);
+    }
+    void Erase(int slot)
+    {
+        size_t word = slot / 64;
+        if (word < vWords.size()) {
+            vWords[word] &= ~(uint64_t{1} << (slot % 64));
+        }
+    }
+    bool IsEmpty() const
+    {
+        for (uint64_t word : vWords) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * Remembers which peers know about the most recently relayed objects (inventory items or addresses), either because
+ * they announced them to us or because we announced them to them. Each object is stored once for all peers which know
+ * it, so the peers which still need it are found with a single lookup. Every peer has its own quota of
+ * nMaxPerPeer objects and only its own oldest objects are forgotten once it is exceeded, so a peer flooding us with
+ * new hashes can't make us forget what the other peers know.
+ */
+class CPeerKnownTable
+{
+private:
+    //! Objects known by one peer in the order it learned them, as a ring buffer of up to nMaxPerPeer keys of mapKnown
+    struct PeerKnown {
+        std::vector<const uint256*> vOrder;
+        size_t nOrderPos{0};
+    };
+
+    mutable CCriticalSection cs;
+    const size_t nMaxPerPeer;
+    std::unordered_map<uint256, CPeerSlotSet, StaticSaltedHasher> mapKnown GUARDED_BY(cs);
+    //! Indexed by slot
+    std::vector<PeerKnown> vPeers GUARDED_BY(cs);
+
+    void ForgetKnown(int slot, const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    explicit CPeerKnownTable(size_t nMaxPerPeerIn);
+
+    /** Mark hash as known by the peer, returns false if it knew it already */
+    bool Insert(int slot, const uint256& hash);
+    bool Contains(int slot, const uint256& hash) const;
+    /** All peers which know hash */
+    CPeerSlotSet GetKnownSlots(const uint256& hash) const;
+    /** Forget everything the peer knows, before its slot is handed to another peer */
+    void EraseSlot(int slot);
+    size_t Size() const;
+    void Clear();
+};
+
+extern CPeerKnownTable g_known_inventory;
+extern CPeerKnownTable g_known_addresses;
+
+/** Hand out the lowest free peer slot */
+int AllocatePeerSlot();
+/** Forget what the peer of slot knows and make the slot available again */
+void ReleasePeerSlot(int slot);
+
+#endif // BITCOIN_NET_KNOWN_H
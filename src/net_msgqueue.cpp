@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <net_msgqueue.h>
+
+#include <logging.h>
+#include <net.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+
+#include <cassert>
+
+CNetMsgQueue::CNetMsgQueue(std::string _threadName, size_t _nMaxSize, Handler _handler) :
+    threadName(std::move(_threadName)),
+    nMaxSize(_nMaxSize),
+    handler(std::move(_handler))
+{
+}
+
+CNetMsgQueue::~CNetMsgQueue()
+{
+    Stop();
+}
+
+void CNetMsgQueue::Start()
+{
+    // can't start new thread if we have one running already
+    assert(!thread.joinable());
+
+    thread = std::thread(&TraceThread<std::function<void()> >,
+        threadName,
+        std::function<void()>(std::bind(&CNetMsgQueue::ThreadMain, this)));
+}
+
+void CNetMsgQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStopped = true;
+    }
+    cond.notify_all();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    std::deque<Entry> dropped;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        dropped.swap(queue);
+    }
+    for (auto& entry : dropped) {
+        entry.pfrom->Release();
+    }
+}
+
+void CNetMsgQueue::Push(CNode* pfrom, const std::string& strCommand, const CDataStream& vRecv)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    // apply back pressure instead of dropping messages
+    cond.wait(lock, [&] {
+        return queue.size() < nMaxSize || fStopped;
+    });
+    if (fStopped) {
+        return;
+    }
+    queue.emplace_back(Entry{pfrom->AddRef(), strCommand, vRecv});
+    lock.unlock();
+    cond.notify_all();
+}
+
+size_t CNetMsgQueue::Size() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return queue.size();
+}
+
+void CNetMsgQueue::ThreadMain()
+{
+    while (true) {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [&] {
+            return !queue.empty() || fStopped;
+        });
+        if (fStopped) {
+            return;
+        }
+        Entry entry = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        // Push() might wait for free space
+        cond.notify_all();
+
+        try {
+            handler(entry.pfrom, entry.strCommand, entry.vRecv);
+        } catch (const std::exception& e) {
+            LogPrint(BCLog::NET, "CNetMsgQueue::%s -- %s: processing %s from peer=%d failed: %s\n", __func__, threadName,
+                     SanitizeString(entry.strCommand), entry.pfrom->GetId(), e.what());
+        }
+        entry.pfrom->Release();
+    }
+}
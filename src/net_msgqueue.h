@@ -0,0 +1,67 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NET_MSGQUEUE_H
+#define BITCOIN_NET_MSGQUEUE_H
+
+#include <streams.h>
+#include <threadsafety.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class CNode;
+
+/**
+ * Processes the messages of one message family (e.g. governance) on a dedicated thread, so that slow handlers of that
+ * family don't hold up ThreadMessageHandler and all other peers and messages with it. Messages are processed in the
+ * order they were pushed, which keeps the order of each peer's messages within the family. Messages of other families
+ * are not ordered against these.
+ */
+class CNetMsgQueue
+{
+public:
+    typedef std::function<void(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)> Handler;
+
+    CNetMsgQueue(std::string _threadName, size_t _nMaxSize, Handler _handler);
+    ~CNetMsgQueue();
+
+    void Start();
+    //! Stops the thread and drops all queued messages. Must be called before the nodes are deleted
+    void Stop();
+
+    /**
+     * Queues a message for the thread. The node is referenced until the message was processed or dropped. Blocks
+     * while the queue is full, which applies back pressure to the caller instead of dropping messages.
+     * After Stop(), messages are dropped right away.
+     */
+    void Push(CNode* pfrom, const std::string& strCommand, const CDataStream& vRecv);
+
+    size_t Size() const;
+
+private:
+    struct Entry {
+        CNode* pfrom;
+        std::string strCommand;
+        CDataStream vRecv;
+    };
+
+    const std::string threadName;
+    const size_t nMaxSize;
+    const Handler handler;
+
+    mutable std::mutex cs;
+    std::condition_variable cond;
+    std::deque<Entry> queue GUARDED_BY(cs);
+    bool fStopped GUARDED_BY(cs){false};
+    std::thread thread;
+
+    void ThreadMain();
+};
+
+#endif // BITCOIN_NET_MSGQUEUE_H
@@ -6,6 +6,7 @@
 #include <netaddress.h>
 #include <netbase.h>
 #include <crypto/common.h>
+#include <crypto/siphash.h>
 #include <crypto/sha3.h>
 #include <hash.h>
 #include <prevector.h>
@@ -648,34 +649,22 @@ uint32_t CNetAddr::GetNetClass() const
     return m_net;
 }
 
-uint32_t CNetAddr::GetMappedAS(const std::vector<bool> &asmap) const {
+uint32_t CNetAddr::GetMappedAS(const ASMap &asmap) const {
     uint32_t net_class = GetNetClass();
-    if (asmap.size() == 0 || (net_class != NET_IPV4 && net_class != NET_IPV6)) {
+    if (asmap.IsEmpty() || (net_class != NET_IPV4 && net_class != NET_IPV6)) {
         return 0; // Indicates not found, safe because AS0 is reserved per RFC7607.
     }
-    std::vector<bool> ip_bits(128);
+    uint8_t ip[ADDR_IPV6_SIZE];
     if (HasLinkedIPv4()) {
         // For lookup, treat as if it was just an IPv4 address (IPV4_IN_IPV6_PREFIX + IPv4 bits)
-        for (int8_t byte_i = 0; byte_i < 12; ++byte_i) {
-            for (uint8_t bit_i = 0; bit_i < 8; ++bit_i) {
-                ip_bits[byte_i * 8 + bit_i] = (IPV4_IN_IPV6_PREFIX[byte_i] >> (7 - bit_i)) & 1;
-            }
-        }
-        uint32_t ipv4 = GetLinkedIPv4();
-        for (int i = 0; i < 32; ++i) {
-            ip_bits[96 + i] = (ipv4 >> (31 - i)) & 1;
-        }
+        memcpy(ip, IPV4_IN_IPV6_PREFIX.data(), IPV4_IN_IPV6_PREFIX.size());
+        WriteBE32(ip + IPV4_IN_IPV6_PREFIX.size(), GetLinkedIPv4());
     } else {
         // Use all 128 bits of the IPv6 address otherwise
         assert(IsIPv6());
-        for (int8_t byte_i = 0; byte_i < 16; ++byte_i) {
-            uint8_t cur_byte = m_addr[byte_i];
-            for (uint8_t bit_i = 0; bit_i < 8; ++bit_i) {
-                ip_bits[byte_i * 8 + bit_i] = (cur_byte >> (7 - bit_i)) & 1;
-            }
-        }
+        memcpy(ip, m_addr.data(), ADDR_IPV6_SIZE);
     }
-    uint32_t mapped_as = Interpret(asmap, ip_bits);
+    uint32_t mapped_as = asmap.Lookup(ip);
     return mapped_as;
 }
 
@@ -689,7 +678,7 @@ uint32_t CNetAddr::GetMappedAS(const std::vector<bool> &asmap) const {
  * @note No two connections will be attempted to addresses with the same network
  *       group.
  */
-std::vector<unsigned char> CNetAddr::GetGroup(const std::vector<bool> &asmap) const
+std::vector<unsigned char> CNetAddr::GetGroup(const ASMap &asmap) const
 {
     std::vector<unsigned char> vchRet;
     uint32_t net_class = GetNetClass();
@@ -926,6 +915,11 @@ std::vector<unsigned char> CService::GetKey() const
     return key;
 }
 
+uint64_t CService::GetSipHash(uint64_t k0, uint64_t k1) const
+{
+    return CSipHasher(k0, k1).Write(m_addr.data(), m_addr.size()).Write(((uint64_t)m_net << 16) | port).Finalize();
+}
+
 std::string CService::ToStringPort() const
 {
     return strprintf("%u", port);
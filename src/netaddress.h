@@ -15,6 +15,7 @@
 #include <serialize.h>
 #include <span.h>
 #include <tinyformat.h>
+#include <util/asmap.h>
 #include <util/strencodings.h>
 #include <util/string.h>
 
@@ -208,8 +209,8 @@ class CNetAddr
         // The AS on the BGP path to the node we use to diversify
         // peers in AddrMan bucketing based on the AS infrastructure.
         // The ip->AS mapping depends on how asmap is constructed.
-        uint32_t GetMappedAS(const std::vector<bool> &asmap) const;
-        std::vector<unsigned char> GetGroup(const std::vector<bool> &asmap) const;
+        uint32_t GetMappedAS(const ASMap &asmap) const;
+        std::vector<unsigned char> GetGroup(const ASMap &asmap) const;
         std::vector<unsigned char> GetAddrBytes() const;
         int GetReachabilityFrom(const CNetAddr *paddrPartner = nullptr) const;
 
@@ -500,6 +501,8 @@ class CService : public CNetAddr
         friend bool operator!=(const CService& a, const CService& b) { return !(a == b); }
         friend bool operator<(const CService& a, const CService& b);
         std::vector<unsigned char> GetKey() const;
+        //! SipHash of the same data as GetKey(), without allocating it
+        uint64_t GetSipHash(uint64_t k0, uint64_t k1) const;
         std::string ToString(bool fUseGetnameinfo = true) const;
         std::string ToStringPort() const;
         std::string ToStringIPPort(bool fUseGetnameinfo = true) const;
@@ -4,85 +4,150 @@
 
 #include <chainparams.h>
 #include <netfulfilledman.h>
+#include <protocol.h>
+#include <random.h>
 #include <shutdown.h>
 #include <util/system.h>
 
 CNetFulfilledRequestManager netfulfilledman;
 
-void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
+// Names of the requests in netfulfilled.dat, requests without a name are not persisted
+static const std::array<const char*, (size_t)FulfilledRequest::COUNT> REQUEST_NAMES = {
+    "full-sync",
+    "spork-sync",
+    "mempool-sync",
+    "governance-sync",
+    NetMsgType::MNGOVERNANCESYNC,
+    nullptr,
+};
+
+CNetFulfilledRequestManager::ServiceHasher::ServiceHasher() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max()))
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
 }
 
-bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
+CService CNetFulfilledRequestManager::Squash(const CService& addr)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
-
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+    return Params().AllowMultiplePorts() ? addr : CService(addr, 0);
 }
 
-void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CService& addr, const std::string& strRequest)
+void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, FulfilledRequest request)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    AddFulfilledRequest(Squash(addr), request, GetTime() + Params().FulfilledRequestExpireTime());
+}
 
-    if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
+void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addrSquashed, FulfilledRequest request, int64_t nExpire)
+{
+    Shard& shard = GetShard(addrSquashed);
+    LOCK(shard.cs);
+    auto it = shard.mapFulfilledRequests.emplace(addrSquashed, fulfilledreqmapentry_t{}).first;
+    it->second[(size_t)request] = nExpire;
+    auto& bucket = shard.mapExpiryWheel[nExpire / WHEEL_BUCKET_SECONDS];
+    if (bucket.empty() || bucket.back() != addrSquashed) {
+        bucket.emplace_back(addrSquashed);
     }
 }
 
-void CNetFulfilledRequestManager::RemoveAllFulfilledRequests(const CService& addr)
+bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, FulfilledRequest request)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    CService addrSquashed = Squash(addr);
+    Shard& shard = GetShard(addrSquashed);
+    LOCK(shard.cs);
+    auto it = shard.mapFulfilledRequests.find(addrSquashed);
+    return it != shard.mapFulfilledRequests.end() && it->second[(size_t)request] > GetTime();
+}
 
-    if (it != mapFulfilledRequests.end()) {
-        mapFulfilledRequests.erase(it++);
-    }
+void CNetFulfilledRequestManager::RemoveAllFulfilledRequests(const CService& addr)
+{
+    CService addrSquashed = Squash(addr);
+    Shard& shard = GetShard(addrSquashed);
+    LOCK(shard.cs);
+    // the entries in the wheel are skipped when they expire
+    shard.mapFulfilledRequests.erase(addrSquashed);
 }
 
 void CNetFulfilledRequestManager::CheckAndRemove()
 {
-    LOCK(cs_mapFulfilledRequests);
-
     int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
-
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
-            } else {
-                ++it_entry;
+
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        // only buckets which expired completely are processed, the rest is handled in the next round
+        auto itBucket = shard.mapExpiryWheel.begin();
+        while (itBucket != shard.mapExpiryWheel.end() && (itBucket->first + 1) * WHEEL_BUCKET_SECONDS <= now) {
+            for (const auto& addr : itBucket->second) {
+                auto it = shard.mapFulfilledRequests.find(addr);
+                if (it == shard.mapFulfilledRequests.end()) {
+                    continue;
+                }
+                bool fExpired = true;
+                for (auto& nExpire : it->second) {
+                    if (now > nExpire) {
+                        nExpire = 0;
+                    } else {
+                        fExpired = false;
+                    }
+                }
+                if (fExpired) {
+                    shard.mapFulfilledRequests.erase(it);
+                }
             }
-        }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
+            itBucket = shard.mapExpiryWheel.erase(itBucket);
         }
     }
 }
 
 void CNetFulfilledRequestManager::Clear()
 {
-    LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests.clear();
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        shard.mapFulfilledRequests.clear();
+        shard.mapExpiryWheel.clear();
+    }
+}
+
+CNetFulfilledRequestManager::legacymap_t CNetFulfilledRequestManager::ToLegacyMap() const
+{
+    legacymap_t mapRequests;
+    for (const auto& shard : shards) {
+        LOCK(shard.cs);
+        for (const auto& p : shard.mapFulfilledRequests) {
+            for (size_t i = 0; i < p.second.size(); i++) {
+                if (p.second[i] != 0 && REQUEST_NAMES[i] != nullptr) {
+                    mapRequests[p.first][REQUEST_NAMES[i]] = p.second[i];
+                }
+            }
+        }
+    }
+    return mapRequests;
+}
+
+void CNetFulfilledRequestManager::FromLegacyMap(const legacymap_t& mapRequests)
+{
+    Clear();
+    for (const auto& p : mapRequests) {
+        for (const auto& p2 : p.second) {
+            for (size_t i = 0; i < REQUEST_NAMES.size(); i++) {
+                // requests which are unknown or not persisted (e.g. the session specific "allow-sync-<time>") are dropped
+                if (REQUEST_NAMES[i] != nullptr && p2.first == REQUEST_NAMES[i]) {
+                    AddFulfilledRequest(p.first, (FulfilledRequest)i, p2.second);
+                    break;
+                }
+            }
+        }
+    }
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
 {
+    size_t nCount = 0;
+    for (const auto& shard : shards) {
+        LOCK(shard.cs);
+        nCount += shard.mapFulfilledRequests.size();
+    }
     std::ostringstream info;
-    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
+    info << "Nodes with fulfilled requests: " << (int)nCount;
     return info.str();
 }
 
@@ -9,34 +9,93 @@
 #include <serialize.h>
 #include <sync.h>
 
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
+enum class FulfilledRequest : uint8_t {
+    //! We fully synced from the peer
+    FULL_SYNC,
+    //! We asked the peer for sporks
+    SPORK_SYNC,
+    //! We asked the peer for its mempool
+    MEMPOOL_SYNC,
+    //! We asked the peer for governance objects
+    GOVERNANCE_SYNC,
+    //! The peer asked us for governance objects
+    GOVERNANCE_SYNC_SERVED,
+    //! Sync restrictions are lifted for the (whitelisted or manually connected) peer, only valid in this session
+    ALLOW_SYNC,
+
+    COUNT
+};
+
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
 // and from being banned for doing so too often.
+//
+// The requests are kept in shards, each with its own lock and a time wheel with buckets of one minute, so that
+// CheckAndRemove only visits the addresses of which requests actually expired.
 class CNetFulfilledRequestManager
 {
 private:
-    typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
-    typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
+    static const size_t SHARD_COUNT = 16;
+    static const int64_t WHEEL_BUCKET_SECONDS = 60;
+
+    //! Expiry time per request type, 0 if not fulfilled
+    typedef std::array<int64_t, (size_t)FulfilledRequest::COUNT> fulfilledreqmapentry_t;
+
+    struct ServiceHasher
+    {
+        uint64_t k0, k1;
+        ServiceHasher();
+        size_t operator()(const CService& addr) const { return addr.GetSipHash(k0, k1); }
+    };
 
-    //keep track of what node has/was asked for and when
-    fulfilledreqmap_t mapFulfilledRequests;
-    mutable CCriticalSection cs_mapFulfilledRequests;
+    struct Shard
+    {
+        mutable Mutex cs;
+        //keep track of what node has/was asked for and when
+        std::unordered_map<CService, fulfilledreqmapentry_t, ServiceHasher> mapFulfilledRequests GUARDED_BY(cs);
+        //! Addresses by the bucket their requests expire in. An address is added again whenever it gets a new request
+        std::map<int64_t, std::vector<CService>> mapExpiryWheel GUARDED_BY(cs);
+    };
+
+    std::array<Shard, SHARD_COUNT> shards;
+    ServiceHasher shardHasher;
+
+    //! Format of netfulfilled.dat, which is kept from when requests were identified by strings
+    typedef std::map<CService, std::map<std::string, int64_t>> legacymap_t;
+
+    Shard& GetShard(const CService& addr) { return shards[shardHasher(addr) % SHARD_COUNT]; }
+    static CService Squash(const CService& addr);
+    void AddFulfilledRequest(const CService& addrSquashed, FulfilledRequest request, int64_t nExpire);
 
-    void RemoveFulfilledRequest(const CService& addr, const std::string& strRequest);
+    legacymap_t ToLegacyMap() const;
+    void FromLegacyMap(const legacymap_t& mapRequests);
 
 public:
     CNetFulfilledRequestManager() {}
 
-    SERIALIZE_METHODS(CNetFulfilledRequestManager, obj)
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << ToLegacyMap();
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
     {
-        LOCK(obj.cs_mapFulfilledRequests);
-        READWRITE(obj.mapFulfilledRequests);
+        legacymap_t mapRequests;
+        s >> mapRequests;
+        FromLegacyMap(mapRequests);
     }
 
-    void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
-    bool HasFulfilledRequest(const CService& addr, const std::string& strRequest);
+    void AddFulfilledRequest(const CService& addr, FulfilledRequest request);
+    bool HasFulfilledRequest(const CService& addr, FulfilledRequest request);
 
     void RemoveAllFulfilledRequests(const CService& addr);
 
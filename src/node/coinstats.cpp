@@ -8,13 +8,19 @@
 #include <amount.h>
 #include <coins.h>
 #include <chain.h>
+#include <crypto/muhash.h>
+#include <ctpl_stl.h>
 #include <hash.h>
 #include <serialize.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <txdb.h>
 #include <validation.h>
 #include <uint256.h>
 // #include <util/system.h>
 #include <util/system.h>
 
+#include <atomic>
 #include <map>
 
 #include <boost/thread.hpp>
@@ -38,9 +44,121 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
     ss << VARINT(0u);
 }
 
+//! Statistics of a part of the UTXO set
+struct CCoinsStatsPart
+{
+    uint64_t nTransactions{0};
+    uint64_t nTransactionOutputs{0};
+    uint64_t nBogoSize{0};
+    CAmount nTotalAmount{0};
+    MuHash3072 muhash;
+    bool fFailed{false};
+};
+
+static void GetPartStats(CCoinsViewCursor& cursor, CCoinsStatsPart& part, bool fMuHash)
+{
+    uint256 prevHash;
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    while (cursor.Valid()) {
+        if (ShutdownRequested()) {
+            part.fFailed = true;
+            return;
+        }
+        COutPoint key;
+        Coin coin;
+        if (!cursor.GetKey(key) || !cursor.GetValue(coin)) {
+            part.fFailed = true;
+            return;
+        }
+        // All outputs of a transaction are next to each other
+        if (part.nTransactions == 0 || key.hash != prevHash) {
+            part.nTransactions++;
+            prevHash = key.hash;
+        }
+        part.nTransactionOutputs++;
+        part.nTotalAmount += coin.out.nValue;
+        part.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+                          2 /* scriptPubKey len */ + coin.out.scriptPubKey.size() /* scriptPubKey */;
+        if (fMuHash) {
+            ss.clear();
+            ss << key << (uint32_t)(coin.nHeight * 2 + coin.fCoinBase) << coin.out;
+            part.muhash.Insert(MakeUCharSpan(ss));
+        }
+        cursor.Next();
+    }
+}
+
+//! Calculate the statistics for parts of the UTXO set in parallel, and combine them
+static bool GetUTXOStatsParallel(CCoinsView* view, CCoinsStats& stats, CoinStatsHashType hash_type)
+{
+    // Only the coins database can be split into parts, which are taken from the same snapshot of it
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    auto viewDB = dynamic_cast<CCoinsViewDB*>(view);
+    int nThreads = std::max(1, GetNumCores());
+    if (viewDB) {
+        // Use more parts than threads, so that the threads which got the small ones pick up more
+        cursors = viewDB->PartitionedCursors(std::min(256, nThreads * 8));
+    } else {
+        cursors.emplace_back(view->Cursor());
+    }
+    assert(!cursors.empty() && cursors[0]);
+    nThreads = std::min(nThreads, (int)cursors.size());
+
+    bool fMuHash = hash_type == CoinStatsHashType::MUHASH;
+    std::vector<CCoinsStatsPart> parts(cursors.size());
+    std::atomic<size_t> nextPart{0};
+    auto getStats = [&]() {
+        for (size_t i = nextPart++; i < cursors.size(); i = nextPart++) {
+            GetPartStats(*cursors[i], parts[i], fMuHash);
+        }
+    };
+    if (nThreads > 1) {
+        ctpl::thread_pool pool(nThreads - 1);
+        RenameThreadPool(pool, "dash-utxostats");
+        std::vector<std::future<void>> futures;
+        for (int i = 1; i < nThreads; i++) {
+            futures.emplace_back(pool.push([&getStats](int) { getStats(); }));
+        }
+        getStats();
+        for (auto& future : futures) {
+            future.get();
+        }
+    } else {
+        getStats();
+    }
+
+    stats.hashBlock = cursors[0]->GetBestBlock();
+    {
+        LOCK(cs_main);
+        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
+    }
+    MuHash3072 muhash;
+    for (auto& part : parts) {
+        if (part.fFailed) {
+            return error("%s: unable to read value", __func__);
+        }
+        stats.nTransactions += part.nTransactions;
+        stats.nTransactionOutputs += part.nTransactionOutputs;
+        stats.nBogoSize += part.nBogoSize;
+        stats.nTotalAmount += part.nTotalAmount;
+        if (fMuHash) {
+            muhash *= part.muhash;
+        }
+    }
+    if (fMuHash) {
+        muhash.Finalize(stats.hashSerialized);
+    }
+    stats.nDiskSize = view->EstimateSize();
+    return true;
+}
+
 //! Calculate statistics about the unspent transaction output set
-bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
+bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats, CoinStatsHashType hash_type)
 {
+    if (hash_type != CoinStatsHashType::HASH_SERIALIZED) {
+        return GetUTXOStatsParallel(view, stats, hash_type);
+    }
+
     std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
     assert(pcursor);
 
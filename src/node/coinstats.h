@@ -13,6 +13,14 @@
 
 class CCoinsView;
 
+enum class CoinStatsHashType {
+    //! SHA256 over all coins in database order, only computed by a single thread
+    HASH_SERIALIZED,
+    //! MuHash3072 over all coins, independent of their order, so that parts of the UTXO set are hashed in parallel
+    MUHASH,
+    NONE,
+};
+
 struct CCoinsStats
 {
     int nHeight;
@@ -27,7 +35,7 @@ struct CCoinsStats
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nDiskSize(0), nTotalAmount(0) {}
 };
 
-//! Calculate statistics about the unspent transaction output set
-bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats);
+//! Calculate statistics about the unspent transaction output set. hashSerialized is the hash of type hash_type.
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats, CoinStatsHashType hash_type = CoinStatsHashType::HASH_SERIALIZED);
 
 #endif // BITCOIN_NODE_COINSTATS_H
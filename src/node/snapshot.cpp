@@ -0,0 +1,202 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/snapshot.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/merkle.h>
+#include <crypto/muhash.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <validation.h>
+
+#include <evo/cbtx.h>
+#include <evo/deterministicmns.h>
+#include <evo/simplifiedmns.h>
+#include <evo/specialtx.h>
+
+#include <llmq/quorums_blockprocessor.h>
+#include <llmq/quorums_utils.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+bool WriteSnapshot(CAutoFile& file, CCoinsView* view, CSnapshotMetadata& metadataRet, std::string& strError)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    CDeterministicMNList mnList;
+    std::vector<CSnapshotCommitment> commitments;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+
+        const CBlockIndex* pindexBase = chainActive.Tip();
+        // The cursor iterates a snapshot of the coins database, so cs_main is only needed until everything else is
+        // taken from the same block
+        pcursor = std::unique_ptr<CCoinsViewCursor>(view->Cursor());
+        if (!pcursor || pcursor->GetBestBlock() != pindexBase->GetBlockHash()) {
+            strError = "Coins database is not at the chain tip";
+            return false;
+        }
+        metadataRet = CSnapshotMetadata();
+        metadataRet.baseBlockHash = pindexBase->GetBlockHash();
+        metadataRet.nBaseHeight = pindexBase->nHeight;
+
+        mnList = deterministicMNManager->GetListForBlock(pindexBase);
+        for (const auto& p : llmq::quorumBlockProcessor->GetMinedAndActiveCommitmentsUntilBlock(pindexBase)) {
+            for (const CBlockIndex* pindexQuorum : p.second) {
+                CSnapshotCommitment commitment;
+                auto qc = llmq::quorumBlockProcessor->GetMinedCommitment(p.first, pindexQuorum->GetBlockHash(), commitment.minedBlockHash);
+                if (!qc) {
+                    strError = strprintf("Mined commitment for quorum %s not found", pindexQuorum->GetBlockHash().ToString());
+                    return false;
+                }
+                commitment.qc = *qc;
+                commitments.emplace_back(std::move(commitment));
+            }
+        }
+    }
+
+    // the number of coins is only known at the end, so the header is written again afterwards
+    file << metadataRet;
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) {
+            strError = "Shutdown requested";
+            return false;
+        }
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            strError = "Unable to read UTXO set";
+            return false;
+        }
+        file << key << coin;
+        metadataRet.nCoinsCount++;
+        pcursor->Next();
+    }
+    file << mnList;
+    file << commitments;
+
+    if (fseek(file.Get(), 0, SEEK_SET) != 0) {
+        strError = "Unable to write snapshot header";
+        return false;
+    }
+    file << metadataRet;
+    return true;
+}
+
+static bool CheckSnapshotQuorums(const std::vector<CSnapshotCommitment>& commitments, const CCbTx& cbTx, std::string& strError)
+{
+    std::map<Consensus::LLMQType, int> counts;
+    std::vector<uint256> qcHashes;
+    qcHashes.reserve(commitments.size());
+    for (const auto& commitment : commitments) {
+        const auto& qc = commitment.qc;
+        if (!Params().GetConsensus().llmqs.count(qc.llmqType) || qc.IsNull()) {
+            strError = strprintf("Invalid commitment for quorum %s", qc.quorumHash.ToString());
+            return false;
+        }
+        if (++counts[qc.llmqType] > llmq::GetLLMQParams(qc.llmqType).signingActiveQuorumCount) {
+            strError = strprintf("Too many commitments for llmqType %d", qc.llmqType);
+            return false;
+        }
+        qcHashes.emplace_back(::SerializeHash(qc));
+    }
+    // same as CalcCbTxMerkleRootQuorums
+    std::sort(qcHashes.begin(), qcHashes.end());
+    bool mutated = false;
+    if (ComputeMerkleRoot(qcHashes, &mutated) != cbTx.merkleRootQuorums || mutated) {
+        strError = "Quorum commitments don't match merkleRootQuorums of the base block";
+        return false;
+    }
+    return true;
+}
+
+bool VerifySnapshot(CAutoFile& file, CSnapshotVerification& verificationRet, std::string& strError)
+{
+    const auto& consensusParams = Params().GetConsensus();
+    auto& metadata = verificationRet.metadata;
+    CDeterministicMNList mnList;
+    std::vector<CSnapshotCommitment> commitments;
+
+    try {
+        file >> metadata;
+        if (metadata.nMagic != CSnapshotMetadata::SNAPSHOT_MAGIC || metadata.nVersion != CSnapshotMetadata::CURRENT_VERSION) {
+            strError = "Not a snapshot or unsupported snapshot version";
+            return false;
+        }
+
+        // the same serialization of the coins as the muhash of gettxoutsetinfo
+        MuHash3072 muhash;
+        CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+        for (uint64_t i = 0; i < metadata.nCoinsCount; i++) {
+            if (ShutdownRequested()) {
+                strError = "Shutdown requested";
+                return false;
+            }
+            COutPoint key;
+            Coin coin;
+            file >> key >> coin;
+            ss.clear();
+            ss << key << (uint32_t)(coin.nHeight * 2 + coin.fCoinBase) << coin.out;
+            muhash.Insert(MakeUCharSpan(ss));
+        }
+        muhash.Finalize(verificationRet.coinsHash);
+
+        file >> mnList;
+        file >> commitments;
+    } catch (const std::exception& e) {
+        strError = strprintf("Unable to read snapshot: %s", e.what());
+        return false;
+    }
+    verificationRet.nMNCount = mnList.GetAllMNsCount();
+    verificationRet.nCommitmentCount = commitments.size();
+
+    const CBlockIndex* pindexBase;
+    {
+        LOCK(cs_main);
+        pindexBase = LookupBlockIndex(metadata.baseBlockHash);
+    }
+    if (!pindexBase || pindexBase->nHeight != metadata.nBaseHeight) {
+        strError = strprintf("Unknown base block %s", metadata.baseBlockHash.ToString());
+        return false;
+    }
+    if (mnList.GetBlockHash() != metadata.baseBlockHash) {
+        strError = "Masternode list is not for the base block";
+        return false;
+    }
+    if (pindexBase->nHeight < consensusParams.DIP0003Height) {
+        // no CbTx to check against yet
+        return true;
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindexBase, consensusParams)) {
+        strError = "Base block not available on disk";
+        return false;
+    }
+    CCbTx cbTx;
+    if (block.vtx.empty() || block.vtx[0]->nType != TRANSACTION_COINBASE || !GetTxPayload(*block.vtx[0], cbTx)) {
+        strError = "Base block has no valid CbTx";
+        return false;
+    }
+
+    bool mutated = false;
+    if (CSimplifiedMNList(mnList).CalcMerkleRoot(&mutated) != cbTx.merkleRootMNList || mutated) {
+        strError = "Masternode list doesn't match merkleRootMNList of the base block";
+        return false;
+    }
+    verificationRet.fMNListChecked = true;
+
+    if (cbTx.nVersion >= 2) {
+        if (!CheckSnapshotQuorums(commitments, cbTx, strError)) {
+            return false;
+        }
+        verificationRet.fQuorumsChecked = true;
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_SNAPSHOT_H
+#define BITCOIN_NODE_SNAPSHOT_H
+
+#include <llmq/quorums_commitment.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <string>
+
+class CAutoFile;
+class CCoinsView;
+
+/**
+ * Header of a chain state snapshot as written by the dumpsnapshot RPC. It is followed by nCoinsCount pairs of
+ * COutPoint and Coin, the deterministic masternode list at the base block and the mined commitments of all active
+ * quorums at the base block. The masternode list and the commitments can be checked against the merkle roots which
+ * the CbTx of the base block commits to, the coins against the muhash reported by gettxoutsetinfo of a trusted node.
+ */
+class CSnapshotMetadata
+{
+public:
+    static const uint32_t SNAPSHOT_MAGIC = 0x70616e73; // "snap"
+    static const int32_t CURRENT_VERSION = 1;
+
+    uint32_t nMagic{SNAPSHOT_MAGIC};
+    int32_t nVersion{CURRENT_VERSION};
+    uint256 baseBlockHash;
+    int32_t nBaseHeight{0};
+    uint64_t nCoinsCount{0};
+
+    SERIALIZE_METHODS(CSnapshotMetadata, obj)
+    {
+        READWRITE(obj.nMagic, obj.nVersion, obj.baseBlockHash, obj.nBaseHeight, obj.nCoinsCount);
+    }
+};
+
+/** A commitment of an active quorum together with the block it was mined in */
+struct CSnapshotCommitment
+{
+    uint256 minedBlockHash;
+    llmq::CFinalCommitment qc;
+
+    SERIALIZE_METHODS(CSnapshotCommitment, obj)
+    {
+        READWRITE(obj.minedBlockHash, obj.qc);
+    }
+};
+
+/** Results of VerifySnapshot */
+struct CSnapshotVerification
+{
+    CSnapshotMetadata metadata;
+    //! MuHash3072 of all coins, comparable with gettxoutsetinfo "muhash" at the base block
+    uint256 coinsHash;
+    size_t nMNCount{0};
+    size_t nCommitmentCount{0};
+    //! false if the base block is from before DIP3 or its CbTx doesn't commit to quorums yet
+    bool fMNListChecked{false};
+    bool fQuorumsChecked{false};
+};
+
+/** Write the UTXO set, masternode list and active quorum commitments at the chain tip to file */
+bool WriteSnapshot(CAutoFile& file, CCoinsView* view, CSnapshotMetadata& metadataRet, std::string& strError);
+
+/**
+ * Read a snapshot from file and check the masternode list and quorum commitments against the CbTx of the base block,
+ * which must be known and available on disk
+ */
+bool VerifySnapshot(CAutoFile& file, CSnapshotVerification& verificationRet, std::string& strError);
+
+#endif // BITCOIN_NODE_SNAPSHOT_H
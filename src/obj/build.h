@@ -0,0 +1 @@
+#define BUILD_SUFFIX 0bc5ec2
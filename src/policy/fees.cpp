@@ -518,6 +518,7 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         mapMemPoolTxs.erase(hash);
+        mapSmartFeeCache.clear();
         return true;
     } else {
         return false;
@@ -571,6 +572,7 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
         return;
     }
     trackedTxs++;
+    mapSmartFeeCache.clear();
 
     // Feerates are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
@@ -623,6 +625,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
         // transaction fees."
         return;
     }
+    mapSmartFeeCache.clear();
 
     // Must update nBestSeenHeight in sync with ClearCurrent so that
     // calls to removeTx (via processBlockTx) correctly calculate age
@@ -820,6 +823,26 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
 {
     LOCK(cs_feeEstimator);
 
+    // Wallets ask for the same estimate several times while building a transaction, and
+    // the answer only changes when a block or tracked mempool transaction is processed.
+    // Only valid targets are cached, which keeps the cache bounded.
+    if (confTarget <= 0 || (unsigned int)confTarget > longStats->GetMaxConfirms()) {
+        return estimateSmartFeeUncached(confTarget, feeCalc, conservative);
+    }
+    auto it = mapSmartFeeCache.find(std::make_pair(confTarget, conservative));
+    if (it == mapSmartFeeCache.end()) {
+        FeeCalculation calc;
+        CFeeRate feeRate = estimateSmartFeeUncached(confTarget, &calc, conservative);
+        it = mapSmartFeeCache.emplace(std::make_pair(confTarget, conservative), std::make_pair(feeRate, calc)).first;
+    }
+    if (feeCalc) *feeCalc = it->second.second;
+    return it->second.first;
+}
+
+CFeeRate CBlockPolicyEstimator::estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    AssertLockHeld(cs_feeEstimator);
+
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -971,6 +994,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            mapSmartFeeCache.clear();
         }
     }
     catch (const std::exception& e) {
@@ -8,8 +8,12 @@
 #include <arith_uint256.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <hash.h>
 #include <primitives/block.h>
+#include <saltedhasher.h>
+#include <sync.h>
 #include <uint256.h>
+#include <unordered_lru_cache.h>
 
 #include <math.h>
 
@@ -79,7 +83,9 @@ unsigned int static KimotoGravityWell(const CBlockIndex* pindexLast, const Conse
     return bnNew.GetCompact();
 }
 
-unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const Consensus::Params& params) {
+static const size_t DGW_CACHE_SIZE = 1024;
+
+unsigned int static DarkGravityWaveUncached(const CBlockIndex* pindexLast, const Consensus::Params& params) {
     /* current difficulty formula, dash - DarkGravity v3, written by Evan Duffield - evan@dash.org */
     const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
     int64_t nPastBlocks = 24;
@@ -129,6 +135,35 @@ unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const Consens
     return bnNew.GetCompact();
 }
 
+// The result only depends on the last 24 blocks, but the same pindexLast is evaluated many times: for every block
+// template, in TestBlockValidity, and when headers or blocks of competing tips share the parent. The weighted
+// average over the window can't be updated incrementally (it starts at the newest block), so the result of the
+// whole window is memoized per block instead.
+unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const Consensus::Params& params) {
+    // Index entries which are not part of the block index (e.g. in unit tests) have no hash to key the cache with
+    if (!pindexLast || !pindexLast->phashBlock) {
+        return DarkGravityWaveUncached(pindexLast, params);
+    }
+
+    static CCriticalSection cs_dgw;
+    static unordered_lru_cache<uint256, unsigned int, StaticSaltedHasher> mapDGWCache(DGW_CACHE_SIZE);
+
+    // Include the parameters the calculation depends on, so that different networks (as in unit tests) can't clash
+    const uint256 key = ::SerializeHash(std::make_tuple(pindexLast->GetBlockHash(), params.powLimit, params.nPowTargetSpacing));
+    unsigned int nBits;
+    {
+        LOCK(cs_dgw);
+        if (mapDGWCache.get(key, nBits)) {
+            return nBits;
+        }
+    }
+
+    nBits = DarkGravityWaveUncached(pindexLast, params);
+    LOCK(cs_dgw);
+    mapDGWCache.insert(key, nBits);
+    return nBits;
+}
+
 unsigned int GetNextWorkRequiredBTC(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
 {
     assert(pindexLast != nullptr);
@@ -167,14 +167,31 @@ static int ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1
 }
 
 bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchSig) const {
+    Parsed parsed;
+    if (!Parse(parsed))
+        return false;
+    return VerifyParsed(parsed, hash, vchSig);
+}
+
+static_assert(sizeof(CPubKey::Parsed) == sizeof(secp256k1_pubkey), "CPubKey::Parsed must hold a secp256k1_pubkey");
+
+bool CPubKey::Parse(Parsed& parsedRet) const {
     if (!IsValid())
         return false;
     secp256k1_pubkey pubkey;
-    secp256k1_ecdsa_signature sig;
     assert(secp256k1_context_verify && "secp256k1_context_verify must be initialized to use CPubKey.");
     if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
         return false;
     }
+    memcpy(parsedRet.data, pubkey.data, sizeof(parsedRet.data));
+    return true;
+}
+
+bool CPubKey::VerifyParsed(const Parsed& parsed, const uint256& hash, const std::vector<unsigned char>& vchSig) {
+    secp256k1_pubkey pubkey;
+    secp256k1_ecdsa_signature sig;
+    memcpy(pubkey.data, parsed.data, sizeof(pubkey.data));
+    assert(secp256k1_context_verify && "secp256k1_context_verify must be initialized to use CPubKey.");
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
         return false;
     }
@@ -188,6 +188,20 @@ public:
      */
     bool Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const;
 
+    //! A public key in the parsed (uncompressed) form used by libsecp256k1
+    struct Parsed {
+        unsigned char data[64];
+    };
+
+    /**
+     * Parse the public key, so that signatures can be verified against it without parsing (and for compressed
+     * keys, decompressing) it again. Returns false if the key is not fully valid.
+     */
+    bool Parse(Parsed& parsedRet) const;
+
+    //! Verify a DER signature (~72 bytes) against a public key returned by Parse
+    static bool VerifyParsed(const Parsed& parsed, const uint256& hash, const std::vector<unsigned char>& vchSig);
+
     /**
      * Check whether a signature is normalized (lower-S).
      */
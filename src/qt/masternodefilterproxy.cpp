@@ -0,0 +1,50 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qt/masternodefilterproxy.h>
+
+#include <qt/masternodetablemodel.h>
+
+MasternodeFilterProxy::MasternodeFilterProxy(QObject* parent) :
+    QSortFilterProxyModel(parent)
+{
+    setSortRole(MasternodeTableModel::SortRole);
+}
+
+void MasternodeFilterProxy::setSearchString(const QString& search_string)
+{
+    if (m_search_string == search_string) return;
+    m_search_string = search_string;
+    invalidateFilter();
+}
+
+void MasternodeFilterProxy::setMyMasternodes(const QSet<QString>& proTxHashes)
+{
+    if (m_my_masternodes_only && m_my_masternodes == proTxHashes) return;
+    m_my_masternodes_only = true;
+    m_my_masternodes = proTxHashes;
+    invalidateFilter();
+}
+
+void MasternodeFilterProxy::clearMyMasternodes()
+{
+    if (!m_my_masternodes_only) return;
+    m_my_masternodes_only = false;
+    m_my_masternodes.clear();
+    invalidateFilter();
+}
+
+bool MasternodeFilterProxy::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+{
+    QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
+
+    if (m_my_masternodes_only && !m_my_masternodes.contains(index.data(MasternodeTableModel::ProTxHashRole).toString())) {
+        return false;
+    }
+    // The texts of a row are formatted once and then cached by the model, so this doesn't format every row again
+    if (!m_search_string.isEmpty() && !index.data(MasternodeTableModel::FilterRole).toString().contains(m_search_string)) {
+        return false;
+    }
+    return true;
+}
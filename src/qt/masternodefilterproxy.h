@@ -0,0 +1,35 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QT_MASTERNODEFILTERPROXY_H
+#define BITCOIN_QT_MASTERNODEFILTERPROXY_H
+
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include <QString>
+
+/** Filter the masternode list by a search string and, optionally, to the masternodes of the wallet. */
+class MasternodeFilterProxy : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit MasternodeFilterProxy(QObject* parent = nullptr);
+
+    void setSearchString(const QString& search_string);
+    /** Only show the masternodes with these ProTx hashes */
+    void setMyMasternodes(const QSet<QString>& proTxHashes);
+    /** Show all masternodes again */
+    void clearMyMasternodes();
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override;
+
+private:
+    QString m_search_string;
+    bool m_my_masternodes_only{false};
+    QSet<QString> m_my_masternodes;
+};
+
+#endif // BITCOIN_QT_MASTERNODEFILTERPROXY_H
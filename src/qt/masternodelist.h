@@ -2,7 +2,6 @@
 #define BITCOIN_QT_MASTERNODELIST_H
 
 #include <primitives/transaction.h>
-#include <sync.h>
 #include <util/system.h>
 
 #include <QMenu>
@@ -21,6 +20,8 @@ class CDeterministicMN;
 typedef std::shared_ptr<const CDeterministicMN> CDeterministicMNCPtr;
 
 class ClientModel;
+class MasternodeFilterProxy;
+class MasternodeTableModel;
 class WalletModel;
 
 QT_BEGIN_NAMESPACE
@@ -36,21 +37,6 @@ public:
     explicit MasternodeList(QWidget* parent = 0);
     ~MasternodeList();
 
-    enum {
-        COLUMN_SERVICE,
-        COLUMN_STATUS,
-        COLUMN_POSE,
-        COLUMN_REGISTERED,
-        COLUMN_LAST_PAYMENT,
-        COLUMN_NEXT_PAYMENT,
-        COLUMN_PAYOUT_ADDRESS,
-        COLUMN_OPERATOR_REWARD,
-        COLUMN_COLLATERAL_ADDRESS,
-        COLUMN_OWNER_ADDRESS,
-        COLUMN_VOTING_ADDRESS,
-        COLUMN_PROTX_HASH,
-    };
-
     void setClientModel(ClientModel* clientModel);
     void setWalletModel(WalletModel* walletModel);
 
@@ -64,9 +50,8 @@ private:
     Ui::MasternodeList* ui;
     ClientModel* clientModel;
     WalletModel* walletModel;
-
-    // Protects tableWidgetMasternodesDIP3
-    CCriticalSection cs_dip3list;
+    MasternodeTableModel* masternodeModel;
+    MasternodeFilterProxy* masternodeProxyModel;
 
     QString strCurrentFilterDIP3;
 
@@ -75,6 +60,8 @@ private:
     CDeterministicMNCPtr GetSelectedDIP3MN();
 
     void updateDIP3List();
+    void updateMyMasternodesFilter();
+    void updateCountLabel();
 
 Q_SIGNALS:
     void doubleClicked(const QModelIndex&);
@@ -0,0 +1,228 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qt/masternodetablemodel.h>
+
+#include <coins.h>
+#include <interfaces/node.h>
+#include <key_io.h>
+#include <qt/clientmodel.h>
+#include <script/standard.h>
+
+#include <algorithm>
+
+MasternodeTableModel::MasternodeTableModel(ClientModel* _clientModel, QObject* parent) :
+    QAbstractTableModel(parent),
+    clientModel(_clientModel)
+{
+    columns << tr("Service") << tr("Status") << tr("PoSe Score") << tr("Registered") << tr("Last Paid")
+            << tr("Next Payment") << tr("Payout Address") << tr("Operator Reward") << tr("Collateral Address")
+            << tr("Owner Address") << tr("Voting Address");
+}
+
+int MasternodeTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return entries.size();
+}
+
+int MasternodeTableModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return NUMBER_OF_COLUMNS;
+}
+
+QString MasternodeTableModel::formatText(const MasternodeTableEntry& entry, int column) const
+{
+    const auto& dmn = entry.dmn;
+    switch (column) {
+    case Service:
+        return QString::fromStdString(dmn->pdmnState->addr.ToString());
+    case Status:
+        return CDeterministicMNList::IsMNValid(dmn) ? tr("ENABLED") : (CDeterministicMNList::IsMNPoSeBanned(dmn) ? tr("POSE_BANNED") : tr("UNKNOWN"));
+    case PoSeScore:
+        return QString::number(dmn->pdmnState->nPoSePenalty);
+    case Registered:
+        return QString::number(dmn->pdmnState->nRegisteredHeight);
+    case LastPayment:
+        return QString::number(dmn->pdmnState->nLastPaidHeight);
+    case NextPayment:
+        return entry.nNextPayment ? QString::number(entry.nNextPayment) : QString("UNKNOWN");
+    case PayoutAddress: {
+        CTxDestination payeeDest;
+        if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
+            return QString::fromStdString(EncodeDestination(payeeDest));
+        }
+        return tr("UNKNOWN");
+    }
+    case OperatorReward: {
+        if (!dmn->nOperatorReward) {
+            return tr("NONE");
+        }
+        QString operatorRewardStr = QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
+        if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
+            CTxDestination operatorDest;
+            if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
+                operatorRewardStr += tr("to %1").arg(QString::fromStdString(EncodeDestination(operatorDest)));
+            } else {
+                operatorRewardStr += tr("to UNKNOWN");
+            }
+        } else {
+            operatorRewardStr += tr("but not claimed");
+        }
+        return operatorRewardStr;
+    }
+    case CollateralAddress:
+        return entry.collateralAddress;
+    case OwnerAddress:
+        return QString::fromStdString(EncodeDestination(dmn->pdmnState->keyIDOwner));
+    case VotingAddress:
+        return QString::fromStdString(EncodeDestination(dmn->pdmnState->keyIDVoting));
+    }
+    return QString();
+}
+
+const QStringList& MasternodeTableModel::texts(const MasternodeTableEntry& entry) const
+{
+    if (entry.cachedTexts.isEmpty()) {
+        for (int column = 0; column < NUMBER_OF_COLUMNS; column++) {
+            // the next payment changes with every block, it's cheap to format anyway
+            entry.cachedTexts << (column == NextPayment ? QString() : formatText(entry, column));
+        }
+        entry.cachedFilterText = entry.cachedTexts.join(" ") + " " + QString::fromStdString(entry.dmn->proTxHash.ToString());
+    }
+    return entry.cachedTexts;
+}
+
+QVariant MasternodeTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= (int)entries.size()) {
+        return QVariant();
+    }
+    const MasternodeTableEntry& entry = entries[index.row()];
+    const auto& dmn = entry.dmn;
+
+    switch (role) {
+    case Qt::DisplayRole:
+        if (index.column() == NextPayment) {
+            return formatText(entry, NextPayment);
+        }
+        return texts(entry).value(index.column());
+    case SortRole:
+        switch (index.column()) {
+        case Service: {
+            auto addr_key = dmn->pdmnState->addr.GetKey();
+            return QByteArray(reinterpret_cast<const char*>(addr_key.data()), addr_key.size());
+        }
+        case PoSeScore:
+            return dmn->pdmnState->nPoSePenalty;
+        case Registered:
+            return dmn->pdmnState->nRegisteredHeight;
+        case LastPayment:
+            return dmn->pdmnState->nLastPaidHeight;
+        case NextPayment:
+            return entry.nNextPayment;
+        case OperatorReward:
+            return dmn->nOperatorReward;
+        }
+        return texts(entry).value(index.column());
+    case FilterRole:
+        texts(entry);
+        return entry.cachedFilterText + " " + formatText(entry, NextPayment);
+    case ProTxHashRole:
+        return QString::fromStdString(dmn->proTxHash.ToString());
+    }
+    return QVariant();
+}
+
+QVariant MasternodeTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section < columns.size()) {
+        return columns[section];
+    }
+    return QVariant();
+}
+
+void MasternodeTableModel::updateList(const CDeterministicMNList& newList)
+{
+    if (newList.GetBlockHash() == mnList.GetBlockHash()) {
+        return;
+    }
+    CDeterministicMNListDiff diff = mnList.BuildDiff(newList);
+    mnList = newList;
+
+    if (!diff.removedMns.empty()) {
+        // remove from the back, so that the rows of the remaining removals stay valid
+        std::vector<int> vecRemovedRows;
+        for (uint64_t internalId : diff.removedMns) {
+            auto it = mapRows.find(internalId);
+            if (it != mapRows.end()) {
+                vecRemovedRows.emplace_back(it->second);
+            }
+        }
+        std::sort(vecRemovedRows.rbegin(), vecRemovedRows.rend());
+        for (int row : vecRemovedRows) {
+            beginRemoveRows(QModelIndex(), row, row);
+            entries.erase(entries.begin() + row);
+            endRemoveRows();
+        }
+        mapRows.clear();
+        for (size_t i = 0; i < entries.size(); i++) {
+            mapRows.emplace(entries[i].dmn->GetInternalId(), i);
+        }
+    }
+
+    for (const auto& p : diff.updatedMNs) {
+        auto it = mapRows.find(p.first);
+        auto dmn = mnList.GetMNByInternalId(p.first);
+        if (it == mapRows.end() || !dmn) {
+            continue;
+        }
+        MasternodeTableEntry& entry = entries[it->second];
+        entry.dmn = dmn;
+        entry.cachedTexts.clear();
+        Q_EMIT dataChanged(index(it->second, 0), index(it->second, NUMBER_OF_COLUMNS - 1));
+    }
+
+    if (!diff.addedMNs.empty()) {
+        std::vector<MasternodeTableEntry> vecAdded;
+        vecAdded.reserve(diff.addedMNs.size());
+        for (const auto& dmn : diff.addedMNs) {
+            MasternodeTableEntry entry;
+            entry.dmn = dmn;
+            // the collateral of a masternode can't change, so it's only looked up once
+            entry.collateralAddress = tr("UNKNOWN");
+            CTxDestination collateralDest;
+            Coin coin;
+            if (clientModel->node().getUnspentOutput(dmn->collateralOutpoint, coin) && ExtractDestination(coin.out.scriptPubKey, collateralDest)) {
+                entry.collateralAddress = QString::fromStdString(EncodeDestination(collateralDest));
+            }
+            vecAdded.emplace_back(std::move(entry));
+        }
+        beginInsertRows(QModelIndex(), entries.size(), entries.size() + vecAdded.size() - 1);
+        for (auto& entry : vecAdded) {
+            mapRows.emplace(entry.dmn->GetInternalId(), entries.size());
+            entries.emplace_back(std::move(entry));
+        }
+        endInsertRows();
+    }
+
+    // The projected payees shift with every block
+    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
+    std::map<uint256, int> nextPayments;
+    for (size_t i = 0; i < projectedPayees.size(); i++) {
+        nextPayments.emplace(projectedPayees[i]->proTxHash, mnList.GetHeight() + (int)i + 1);
+    }
+    for (auto& entry : entries) {
+        auto it = nextPayments.find(entry.dmn->proTxHash);
+        entry.nNextPayment = it != nextPayments.end() ? it->second : 0;
+    }
+    if (!entries.empty()) {
+        Q_EMIT dataChanged(index(0, NextPayment), index(entries.size() - 1, NextPayment));
+    }
+}
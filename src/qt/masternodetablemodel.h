@@ -0,0 +1,92 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QT_MASTERNODETABLEMODEL_H
+#define BITCOIN_QT_MASTERNODETABLEMODEL_H
+
+#include <evo/deterministicmns.h>
+
+#include <map>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QStringList>
+
+class ClientModel;
+
+/** A row of the masternode table. The texts of the columns are only formatted when they're requested, which usually
+    only happens for the visible rows, and are kept until the masternode changes.
+ */
+struct MasternodeTableEntry
+{
+    CDeterministicMNCPtr dmn;
+    //! Address of the collateral, looked up once when the masternode is added
+    QString collateralAddress;
+    //! Height of the next payment, 0 if unknown
+    int nNextPayment{0};
+
+    mutable QStringList cachedTexts;
+    mutable QString cachedFilterText;
+};
+
+/** Model for the deterministic masternode list. It's updated from the differences between the previously shown and
+    the current list, so only added, removed and changed masternodes are touched.
+ */
+class MasternodeTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit MasternodeTableModel(ClientModel* clientModel, QObject* parent = nullptr);
+
+    enum ColumnIndex {
+        Service = 0,
+        Status = 1,
+        PoSeScore = 2,
+        Registered = 3,
+        LastPayment = 4,
+        NextPayment = 5,
+        PayoutAddress = 6,
+        OperatorReward = 7,
+        CollateralAddress = 8,
+        OwnerAddress = 9,
+        VotingAddress = 10,
+        NUMBER_OF_COLUMNS
+    };
+
+    enum RoleIndex {
+        /** Unformatted value of the column, used for sorting */
+        SortRole = Qt::UserRole,
+        /** Texts of all columns of a row, used for filtering */
+        FilterRole,
+        /** ProTx hash of the masternode as string */
+        ProTxHashRole
+    };
+
+    /** @name Methods overridden from QAbstractTableModel
+        @{*/
+    int rowCount(const QModelIndex& parent) const override;
+    int columnCount(const QModelIndex& parent) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    /*@}*/
+
+    /** Apply the differences between the currently shown list and mnList to the model */
+    void updateList(const CDeterministicMNList& mnList);
+
+    const CDeterministicMNList& getList() const { return mnList; }
+
+private:
+    ClientModel* clientModel;
+    QStringList columns;
+    CDeterministicMNList mnList;
+    std::vector<MasternodeTableEntry> entries;
+    //! Row of each masternode by its internal id
+    std::map<uint64_t, int> mapRows;
+
+    QString formatText(const MasternodeTableEntry& entry, int column) const;
+    const QStringList& texts(const MasternodeTableEntry& entry) const;
+};
+
+#endif // BITCOIN_QT_MASTERNODETABLEMODEL_H
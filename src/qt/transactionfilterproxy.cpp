@@ -31,9 +31,12 @@ bool TransactionFilterProxy::filterAcceptsRow(int sourceRow, const QModelIndex &
 {
     QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
 
-    int status = index.data(TransactionTableModel::StatusRole).toInt();
-    if (!showInactive && status == TransactionStatus::Conflicted)
-        return false;
+    // Don't compute the status of every row if it isn't needed for filtering
+    if (!showInactive) {
+        int status = index.data(TransactionTableModel::StatusRole).toInt();
+        if (status == TransactionStatus::Conflicted)
+            return false;
+    }
 
     int type = index.data(TransactionTableModel::TypeRole).toInt();
     if (!(TYPE(type) & typeFilter))
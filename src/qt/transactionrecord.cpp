@@ -329,8 +329,24 @@ void TransactionRecord::updateStatus(const interfaces::WalletTxStatus& wtx, int
 
 bool TransactionRecord::statusUpdateNeeded(int numBlocks, int chainLockHeight) const
 {
-    return status.cur_num_blocks != numBlocks || status.needsUpdate
-        || (!status.lockedByChainLocks && status.cachedChainLockHeight != chainLockHeight);
+    if (status.cur_num_blocks != numBlocks || status.needsUpdate) {
+        return true;
+    }
+    // A new ChainLock only changes transactions which are mined at or below the locked height
+    return !status.lockedByChainLocks && status.cachedChainLockHeight != chainLockHeight
+        && status.depth > 0 && status.cur_num_blocks - status.depth + 1 <= chainLockHeight;
+}
+
+bool TransactionRecord::advanceStatus(int numBlocks)
+{
+    // A ChainLocked block can't be reorganized away, so a new tip only adds confirmations
+    if (status.needsUpdate || !status.lockedByChainLocks || status.status != TransactionStatus::Confirmed
+        || numBlocks < status.cur_num_blocks) {
+        return false;
+    }
+    status.depth += numBlocks - status.cur_num_blocks;
+    status.cur_num_blocks = numBlocks;
+    return true;
 }
 
 void TransactionRecord::updateLabel(interfaces::Wallet& wallet)
@@ -167,6 +167,11 @@ public:
      */
     bool statusUpdateNeeded(int numBlocks, int chainLockHeight) const;
 
+    /** Update the status of a ChainLocked and confirmed transaction to a new tip without asking the wallet, only its
+        depth changes then. Returns false if the status has to be updated from the core wallet tx.
+     */
+    bool advanceStatus(int numBlocks);
+
     /** Update label from address book.
      */
     void updateLabel(interfaces::Wallet& wallet);
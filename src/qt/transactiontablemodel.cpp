@@ -176,14 +176,21 @@ public:
     void updateAddressBook(interfaces::Wallet& wallet, const QString& address, const QString& label, bool isMine, const QString& purpose, int status)
     {
         std::string address2 = address.toStdString();
+        // The notification carries the new label already, no need to look it up for every record
+        QString newLabel = status == CT_DELETED ? QString() : label;
+        int lowerIndex = -1, upperIndex = -1;
         int index = 0;
         for (auto& rec : cachedWallet) {
-            if (rec.strAddress == address2) {
-                rec.updateLabel(wallet);
-                Q_EMIT parent->dataChanged(parent->index(index, TransactionTableModel::ToAddress), parent->index(index, TransactionTableModel::ToAddress));
+            if (rec.strAddress == address2 && IsValidDestination(rec.txDest)) {
+                rec.label = newLabel;
+                if (lowerIndex < 0) lowerIndex = index;
+                upperIndex = index;
             }
             index++;
         }
+        if (lowerIndex >= 0) {
+            Q_EMIT parent->dataChanged(parent->index(lowerIndex, TransactionTableModel::ToAddress), parent->index(upperIndex, TransactionTableModel::ToAddress));
+        }
     }
 
     int size()
@@ -191,24 +198,31 @@ public:
         return cachedWallet.size();
     }
 
-    TransactionRecord *index(interfaces::Wallet& wallet, int numBlocks, int idx)
+    TransactionRecord *index(int idx)
     {
         if (idx >= 0 && idx < cachedWallet.size()) {
-            TransactionRecord *rec = &cachedWallet[idx];
-
-            // If a status update is needed (blocks came in since last check),
-            // try to update the status of this transaction from the wallet.
-            // Otherwise, simply re-use the cached status.
-            interfaces::WalletTxStatus wtx;
-            int64_t adjustedTime;
-            if (rec->statusUpdateNeeded(numBlocks, parent->getChainLockHeight()) && wallet.tryGetTxStatus(rec->hash, wtx, adjustedTime)) {
-                rec->updateStatus(wtx, numBlocks, adjustedTime, parent->getChainLockHeight());
-            }
-            return rec;
+            return &cachedWallet[idx];
         }
         return 0;
     }
 
+    /* The status is only computed when it's actually requested, which is usually only for the visible rows.
+     */
+    void updateStatus(interfaces::Wallet& wallet, int numBlocks, TransactionRecord *rec)
+    {
+        // If a status update is needed (blocks came in since last check),
+        // try to update the status of this transaction from the wallet.
+        // Otherwise, simply re-use the cached status.
+        if (!rec->statusUpdateNeeded(numBlocks, parent->getChainLockHeight()) || rec->advanceStatus(numBlocks)) {
+            return;
+        }
+        interfaces::WalletTxStatus wtx;
+        int64_t adjustedTime;
+        if (wallet.tryGetTxStatus(rec->hash, wtx, adjustedTime)) {
+            rec->updateStatus(wtx, numBlocks, adjustedTime, parent->getChainLockHeight());
+        }
+    }
+
     QString describe(interfaces::Node& node, interfaces::Wallet& wallet, TransactionRecord *rec, int unit)
     {
         return TransactionDesc::toHTML(node, wallet, rec, unit);
@@ -566,6 +580,23 @@ QVariant TransactionTableModel::data(const QModelIndex &index, int role) const
         return QVariant();
     TransactionRecord *rec = static_cast<TransactionRecord*>(index.internalPointer());
 
+    switch(role)
+    {
+    case RawDecorationRole:
+    case Qt::EditRole:
+        if (index.column() != Status) {
+            break;
+        }
+        // fall through
+    case Qt::ToolTipRole:
+    case Qt::ForegroundRole:
+    case TxPlainTextRole:
+    case ConfirmedRole:
+    case StatusRole:
+        priv->updateStatus(walletModel->wallet(), walletModel->getNumBlocks(), rec);
+        break;
+    }
+
     switch(role)
     {
     case RawDecorationRole:
@@ -728,10 +759,10 @@ QVariant TransactionTableModel::headerData(int section, Qt::Orientation orientat
 QModelIndex TransactionTableModel::index(int row, int column, const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    TransactionRecord *data = priv->index(walletModel->wallet(), walletModel->getNumBlocks(), row);
+    TransactionRecord *data = priv->index(row);
     if(data)
     {
-        return createIndex(row, column, priv->index(walletModel->wallet(), walletModel->getNumBlocks(), row));
+        return createIndex(row, column, data);
     }
     return QModelIndex();
 }
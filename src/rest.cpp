@@ -7,8 +7,13 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <evo/deterministicmns.h>
+#include <evo/simplifiedmns.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <llmq/quorums_blockprocessor.h>
+#include <llmq/quorums_chainlocks.h>
+#include <llmq/quorums_commitment.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
@@ -25,6 +30,10 @@
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+//! Cache lifetime of responses which can't change anymore (ChainLocked blocks)
+static const int64_t REST_CACHE_MAX_AGE_FINAL = 365 * 24 * 60 * 60;
+//! Cache lifetime of responses which may still change due to a reorg or a new ChainLock
+static const int64_t REST_CACHE_MAX_AGE_TIP = 10;
 
 enum class RetFormat {
     UNDEF,
@@ -118,6 +127,60 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+/**
+ * Writes the ETag and Cache-Control headers of a response which is fully determined by the given block hash(es), so
+ * that caching proxies can serve it without asking us again. If the client already has this version of the response,
+ * the request is answered with 304 and false is returned.
+ */
+static bool WriteCacheHeaders(HTTPRequest* req, const std::string& etag, bool fFinal)
+{
+    const std::string quotedETag = "\"" + etag + "\"";
+    req->WriteHeader("ETag", quotedETag);
+    if (fFinal) {
+        req->WriteHeader("Cache-Control", strprintf("public, max-age=%d, immutable", REST_CACHE_MAX_AGE_FINAL));
+    } else {
+        req->WriteHeader("Cache-Control", strprintf("public, max-age=%d", REST_CACHE_MAX_AGE_TIP));
+    }
+
+    const auto ifNoneMatch = req->GetHeader("if-none-match");
+    if (ifNoneMatch.first && (ifNoneMatch.second == quotedETag || ifNoneMatch.second == "*")) {
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return false;
+    }
+    return true;
+}
+
+//! A block can't be reorged anymore once it's ChainLocked
+static bool IsBlockFinal(const CBlockIndex* pindex)
+{
+    return llmq::chainLocksHandler != nullptr && llmq::chainLocksHandler->HasChainLock(pindex->nHeight, pindex->GetBlockHash());
+}
+
+//! Writes a serialized object in the requested format, with json being used for RetFormat::JSON
+static bool WriteSerializedReply(HTTPRequest* req, RetFormat rf, const CDataStream& ss, const UniValue& json)
+{
+    switch (rf) {
+    case RetFormat::BINARY: {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss.str());
+        return true;
+    }
+    case RetFormat::HEX: {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ss) + "\n");
+        return true;
+    }
+    case RetFormat::JSON: {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, json.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
@@ -619,6 +682,140 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+static bool rest_mnlistdiff(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Use /rest/mnlistdiff/<basehash>/<hash>.<ext>.");
+
+    uint256 baseBlockHash, blockHash;
+    if (!ParseHashStr(path[0], baseBlockHash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + SanitizeString(path[0]));
+    if (!ParseHashStr(path[1], blockHash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + SanitizeString(path[1]));
+
+    CSimplifiedMNListDiff mnListDiff;
+    bool fFinal;
+    {
+        LOCK(cs_main);
+        std::string strError;
+        if (!BuildSimplifiedMNListDiff(baseBlockHash, blockHash, mnListDiff, strError))
+            return RESTERR(req, HTTP_NOT_FOUND, strError);
+        fFinal = IsBlockFinal(LookupBlockIndex(blockHash));
+    }
+
+    // Both blocks are in the active chain, so the diff only changes when the chain is reorganized
+    if (!WriteCacheHeaders(req, baseBlockHash.ToString() + "-" + blockHash.ToString(), fFinal))
+        return true;
+
+    CDataStream ssDiff(SER_NETWORK, PROTOCOL_VERSION);
+    ssDiff << mnListDiff;
+    UniValue json;
+    if (rf == RetFormat::JSON) {
+        mnListDiff.ToJson(json);
+    }
+    return WriteSerializedReply(req, rf, ssDiff, json);
+}
+
+static bool rest_quorumcommitment(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Use /rest/quorumcommitment/<llmqtype>/<quorumhash>.<ext>.");
+
+    // LLMQType is a uint8_t, so check the range before the cast to not accept e.g. 356 as 100
+    int32_t nLLMQType;
+    if (!ParseInt32(path[0], &nLLMQType) || nLLMQType < 0 || nLLMQType > std::numeric_limits<uint8_t>::max() ||
+        !Params().GetConsensus().llmqs.count((Consensus::LLMQType)nLLMQType))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid LLMQ type: " + SanitizeString(path[0]));
+    const auto llmqType = (Consensus::LLMQType)nLLMQType;
+
+    uint256 quorumHash;
+    if (!ParseHashStr(path[1], quorumHash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + SanitizeString(path[1]));
+
+    if (llmq::quorumBlockProcessor == nullptr)
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Quorum commitments are not available");
+
+    uint256 minedBlockHash;
+    llmq::CFinalCommitmentPtr commitment = llmq::quorumBlockProcessor->GetMinedCommitment(llmqType, quorumHash, minedBlockHash);
+    if (commitment == nullptr)
+        return RESTERR(req, HTTP_NOT_FOUND, "commitment for quorum " + quorumHash.ToString() + " not found");
+
+    bool fFinal;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexMined = LookupBlockIndex(minedBlockHash);
+        if (pindexMined == nullptr || !chainActive.Contains(pindexMined))
+            return RESTERR(req, HTTP_NOT_FOUND, "commitment for quorum " + quorumHash.ToString() + " not found");
+        fFinal = IsBlockFinal(pindexMined);
+    }
+
+    if (!WriteCacheHeaders(req, minedBlockHash.ToString() + "-" + quorumHash.ToString(), fFinal))
+        return true;
+
+    CDataStream ssCommitment(SER_NETWORK, PROTOCOL_VERSION);
+    ssCommitment << *commitment;
+    UniValue json(UniValue::VOBJ);
+    if (rf == RetFormat::JSON) {
+        commitment->ToJson(json);
+        json.pushKV("minedBlock", minedBlockHash.ToString());
+    }
+    return WriteSerializedReply(req, rf, ssCommitment, json);
+}
+
+static bool rest_chainlock(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    if (llmq::chainLocksHandler == nullptr)
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "ChainLocks are not available");
+
+    // "best" is answered with whatever the best ChainLock currently is, so it's only cached briefly. A ChainLock for a
+    // specific block hash never changes.
+    llmq::CChainLockSig clsig;
+    const bool fBest = param == "best";
+    if (fBest) {
+        clsig = llmq::chainLocksHandler->GetBestChainLock();
+        if (clsig.IsNull())
+            return RESTERR(req, HTTP_NOT_FOUND, "no ChainLock known");
+    } else {
+        uint256 blockHash;
+        if (!ParseHashStr(param, blockHash))
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + SanitizeString(param));
+        // Only the signature of the best ChainLock is kept around, older ones are dropped once superseded
+        clsig = llmq::chainLocksHandler->GetBestChainLock();
+        if (clsig.IsNull() || clsig.blockHash != blockHash)
+            return RESTERR(req, HTTP_NOT_FOUND, "no ChainLock known for block " + blockHash.ToString());
+    }
+
+    if (!WriteCacheHeaders(req, clsig.blockHash.ToString(), !fBest))
+        return true;
+
+    CDataStream ssCLSig(SER_NETWORK, PROTOCOL_VERSION);
+    ssCLSig << clsig;
+    UniValue json(UniValue::VOBJ);
+    json.pushKV("blockhash", clsig.blockHash.GetHex());
+    json.pushKV("height", clsig.nHeight);
+    json.pushKV("signature", clsig.sig.Get().ToString());
+    return WriteSerializedReply(req, rf, ssCLSig, json);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -632,6 +829,9 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/mnlistdiff/", rest_mnlistdiff},
+      {"/rest/quorumcommitment/", rest_quorumcommitment},
+      {"/rest/chainlock/", rest_chainlock},
 };
 
 bool StartREST()
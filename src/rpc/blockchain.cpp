@@ -11,14 +11,17 @@
 #include <checkpoints.h>
 #include <coins.h>
 #include <node/coinstats.h>
+#include <node/snapshot.h>
 #include <core_io.h>
 #include <consensus/validation.h>
 #include <validation.h>
+#include <index/blockfilterindex.h>
 #include <index/txindex.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -238,7 +241,7 @@ static UniValue getbestchainlock(const JSONRPCRequest& request)
     }
     result.pushKV("blockhash", clsig.blockHash.GetHex());
     result.pushKV("height", clsig.nHeight);
-    result.pushKV("signature", clsig.sig.ToString());
+    result.pushKV("signature", clsig.sig.Get().ToString());
 
     LOCK(cs_main);
     result.pushKV("known_block", mapBlockIndex.count(clsig.blockHash) > 0);
@@ -488,11 +491,16 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
 }
 
 UniValue mempoolToJSON(bool fVerbose)
+{
+    return mempoolToJSON(JSONRPCRequest(), fVerbose);
+}
+
+UniValue mempoolToJSON(const JSONRPCRequest& request, bool fVerbose)
 {
     if (fVerbose)
     {
         LOCK(mempool.cs);
-        UniValue o(UniValue::VOBJ);
+        RPCStreamingResult o(request, UniValue::VOBJ);
         for (const CTxMemPoolEntry& e : mempool.mapTx)
         {
             const uint256& hash = e.GetTx().GetHash();
@@ -500,18 +508,18 @@ UniValue mempoolToJSON(bool fVerbose)
             entryToJSON(info, e);
             o.pushKV(hash.ToString(), info);
         }
-        return o;
+        return o.Finish();
     }
     else
     {
         std::vector<uint256> vtxid;
         mempool.queryHashes(vtxid);
 
-        UniValue a(UniValue::VARR);
+        RPCStreamingResult a(request, UniValue::VARR);
         for (const uint256& hash : vtxid)
             a.push_back(hash.ToString());
 
-        return a;
+        return a.Finish();
     }
 }
 
@@ -544,7 +552,7 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    return mempoolToJSON(request, fVerbose);
 }
 
 static UniValue getmempoolancestors(const JSONRPCRequest& request)
@@ -1149,11 +1157,16 @@ static UniValue pruneblockchain(const JSONRPCRequest& request)
 
 static UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
             "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"   (string, optional, default: \"hash_serialized_2\") Which UTXO set hash should be calculated.\n"
+            "                   \"hash_serialized_2\" hashes the coins in the order of the database, \"muhash\" calculates a hash\n"
+            "                   which doesn't depend on the order of the coins and uses multiple threads, \"none\" only calculates\n"
+            "                   the statistics, also using multiple threads.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
@@ -1161,26 +1174,44 @@ static UniValue gettxoutsetinfo(const JSONRPCRequest& request)
             "  \"transactions\": n,      (numeric) The number of transactions with unspent outputs\n"
             "  \"txouts\": n,            (numeric) The number of unspent transaction outputs\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (only present if 'hash_serialized_2' hash_type is chosen)\n"
+            "  \"muhash\": \"hash\",     (string) The MuHash3072 of the UTXO set (only present if 'muhash' hash_type is chosen)\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
     UniValue ret(UniValue::VOBJ);
 
+    CoinStatsHashType hash_type = CoinStatsHashType::HASH_SERIALIZED;
+    if (!request.params[0].isNull()) {
+        std::string strHashType = request.params[0].get_str();
+        if (strHashType == "muhash") {
+            hash_type = CoinStatsHashType::MUHASH;
+        } else if (strHashType == "none") {
+            hash_type = CoinStatsHashType::NONE;
+        } else if (strHashType != "hash_serialized_2") {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", strHashType));
+        }
+    }
+
     CCoinsStats stats;
     FlushStateToDisk();
-    if (GetUTXOStats(pcoinsdbview.get(), stats)) {
+    if (GetUTXOStats(pcoinsdbview.get(), stats, hash_type)) {
         ret.pushKV("height", (int64_t)stats.nHeight);
         ret.pushKV("bestblock", stats.hashBlock.GetHex());
         ret.pushKV("transactions", (int64_t)stats.nTransactions);
         ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
         ret.pushKV("bogosize", (int64_t)stats.nBogoSize);
-        ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+        if (hash_type == CoinStatsHashType::HASH_SERIALIZED) {
+            ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+        } else if (hash_type == CoinStatsHashType::MUHASH) {
+            ret.pushKV("muhash", stats.hashSerialized.GetHex());
+        }
         ret.pushKV("disk_size", stats.nDiskSize);
         ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
     } else {
@@ -1189,6 +1220,108 @@ static UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue dumpsnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumpsnapshot \"path\"\n"
+            "\nWrites the UTXO set, the deterministic masternode list and the commitments of all active quorums at the\n"
+            "chain tip to a file, which can be checked with verifysnapshot.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"        (string, required) Path to the output file. If relative, will be prefixed by datadir.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"base_hash\": \"hash\",    (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,        (numeric) The height of that block\n"
+            "  \"coins_written\": n,      (numeric) The number of coins written\n"
+            "  \"path\": \"path\",         (string) The absolute path of the file\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpsnapshot", "\"snapshot.dat\"")
+            + HelpExampleRpc("dumpsnapshot", "\"snapshot.dat\"")
+        );
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    // write to a temporary file first, so that an incomplete snapshot can't be mistaken for a complete one
+    fs::path temppath = fs::absolute(request.params[0].get_str() + ".incomplete", GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open " + temppath.string() + " for writing");
+    }
+
+    CSnapshotMetadata metadata;
+    std::string strError;
+    if (!WriteSnapshot(file, pcoinsdbview.get(), metadata, strError)) {
+        file.fclose();
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_INTERNAL_ERROR, strError);
+    }
+    file.fclose();
+    fs::rename(temppath, path);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", metadata.baseBlockHash.GetHex());
+    ret.pushKV("base_height", metadata.nBaseHeight);
+    ret.pushKV("coins_written", (int64_t)metadata.nCoinsCount);
+    ret.pushKV("path", path.string());
+    return ret;
+}
+
+static UniValue verifysnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "verifysnapshot \"path\"\n"
+            "\nReads a file written by dumpsnapshot and checks the masternode list and quorum commitments in it against\n"
+            "the CbTx of the block the snapshot was taken at. The coins can't be checked against the chain, compare the\n"
+            "returned muhash with the result of gettxoutsetinfo \"muhash\" of a trusted node at the same block instead.\n"
+            "\nArguments:\n"
+            "1. \"path\"        (string, required) Path to the snapshot file. If relative, will be prefixed by datadir.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"base_hash\": \"hash\",      (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,          (numeric) The height of that block\n"
+            "  \"coins\": n,                (numeric) The number of coins in the snapshot\n"
+            "  \"muhash\": \"hash\",         (string) The MuHash3072 of the coins in the snapshot\n"
+            "  \"masternodes\": n,          (numeric) The number of masternodes in the snapshot\n"
+            "  \"commitments\": n,          (numeric) The number of quorum commitments in the snapshot\n"
+            "  \"mnlist_verified\": true|false,  (boolean) If the masternode list matched merkleRootMNList\n"
+            "  \"quorums_verified\": true|false, (boolean) If the commitments matched merkleRootQuorums\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("verifysnapshot", "\"snapshot.dat\"")
+            + HelpExampleRpc("verifysnapshot", "\"snapshot.dat\"")
+        );
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open " + path.string() + " for reading");
+    }
+
+    CSnapshotVerification verification;
+    std::string strError;
+    if (!VerifySnapshot(file, verification, strError)) {
+        throw JSONRPCError(RPC_VERIFY_ERROR, strError);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", verification.metadata.baseBlockHash.GetHex());
+    ret.pushKV("base_height", verification.metadata.nBaseHeight);
+    ret.pushKV("coins", (int64_t)verification.metadata.nCoinsCount);
+    ret.pushKV("muhash", verification.coinsHash.GetHex());
+    ret.pushKV("masternodes", (int64_t)verification.nMNCount);
+    ret.pushKV("commitments", (int64_t)verification.nCommitmentCount);
+    ret.pushKV("mnlist_verified", verification.fMNListChecked);
+    ret.pushKV("quorums_verified", verification.fQuorumsChecked);
+    return ret;
+}
+
 static UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1296,6 +1429,80 @@ static UniValue verifychain(const JSONRPCRequest& request)
     return CVerifyDB().VerifyDB(Params(), pcoinsTip.get(), nCheckLevel, nCheckDepth);
 }
 
+static UniValue replayblocks(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "replayblocks nblocks\n"
+            "\nDisconnects the last nblocks blocks in memory and connects them again from the block files, reporting the\n"
+            "time spent in each stage of block validation. Nothing is written to the chainstate, so the same blocks can be\n"
+            "replayed repeatedly, e.g. on a copy of a datadir whose tip is the last block of the range to profile.\n"
+            "Holds cs_main for the whole replay, so it is meant for profiling on an otherwise idle node.\n"
+            "\nArguments:\n"
+            "1. nblocks      (numeric, required) The number of blocks to replay, fewer are replayed if they don't fit into -dbcache.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"start_height\": n,       (numeric) The first replayed block\n"
+            "  \"end_height\": n,         (numeric) The last replayed block\n"
+            "  \"transactions\": n,       (numeric) The number of transactions in the replayed blocks\n"
+            "  \"inputs\": n,             (numeric) The number of inputs of the non-coinbase transactions\n"
+            "  \"disconnect_ms\": x.xx,   (numeric) Time spent rewinding to the first block, not part of the replay\n"
+            "  \"total_ms\": x.xx,        (numeric) Time spent replaying the blocks\n"
+            "  \"stages\": {              (json object) Time spent in each stage in total and per block\n"
+            "    \"name\": {               Stage name: read, deserialize, connect_block (everything from check_block to\n"
+            "                             indexes), check_block, special_txs, quorum_commitments, dmn_list,\n"
+            "                             cbtx_merkle_roots, script_checks, dash_specific, indexes, evodb_writes (part of\n"
+            "                             the stages from special_txs to cbtx_merkle_roots), coins_flush\n"
+            "      \"ms\": x.xx,\n"
+            "      \"ms_per_block\": x.xx\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("replayblocks", "1000")
+            + HelpExampleRpc("replayblocks", "1000")
+        );
+
+    int nBlocks = request.params[0].get_int();
+    CBlockReplayStats stats;
+    std::string strError;
+    if (!ReplayBlocksForBenchmark(Params(), nBlocks, stats, strError)) {
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+
+    const int nReplayed = stats.nEndHeight - stats.nStartHeight + 1;
+    UniValue stages(UniValue::VOBJ);
+    auto pushStage = [&](const std::string& name, int64_t nMicros) {
+        UniValue stage(UniValue::VOBJ);
+        stage.pushKV("ms", nMicros * 0.001);
+        stage.pushKV("ms_per_block", nMicros * 0.001 / nReplayed);
+        stages.pushKV(name, stage);
+    };
+    pushStage("read", stats.nTimeReadFromDisk);
+    pushStage("deserialize", stats.nTimeDeserialize);
+    pushStage("connect_block", stats.nTimeConnectBlock);
+    pushStage("check_block", stats.connect.nCheckBlock);
+    pushStage("special_txs", stats.connect.nSpecialTxs);
+    pushStage("quorum_commitments", stats.connect.nQuorumCommitments);
+    pushStage("dmn_list", stats.connect.nDMNList);
+    pushStage("cbtx_merkle_roots", stats.connect.nCbTxMerkleRoots);
+    pushStage("script_checks", stats.connect.nScriptChecks);
+    pushStage("dash_specific", stats.connect.nDashSpecific);
+    pushStage("indexes", stats.connect.nIndexes);
+    pushStage("evodb_writes", stats.nTimeEvoDbWrites);
+    pushStage("coins_flush", stats.nTimeCoinsFlush);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("start_height", stats.nStartHeight);
+    ret.pushKV("end_height", stats.nEndHeight);
+    ret.pushKV("transactions", (uint64_t)stats.nTxs);
+    ret.pushKV("inputs", (uint64_t)stats.nInputs);
+    ret.pushKV("disconnect_ms", stats.nTimeDisconnect * 0.001);
+    ret.pushKV("total_ms", stats.nTimeTotal * 0.001);
+    ret.pushKV("stages", stages);
+    return ret;
+}
+
 /** Implementation of IsSuperMajority with better feedback */
 static UniValue SoftForkMajorityDesc(int version, CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
@@ -2273,6 +2480,82 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=\"basic\") The type name of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",  (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hash\"  (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+    }
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    std::string filtertype_name = BlockFilterTypeName(BlockFilterType::BASIC_FILTER);
+    if (!request.params[1].isNull()) {
+        filtertype_name = request.params[1].get_str();
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    BlockFilterIndex* index = g_blockfilterindex.get();
+    if (!index || index->GetFilterType() != filtertype) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = index->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!index->LookupFilter(block_index, filter) ||
+        !index->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
@@ -2282,6 +2565,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getbestchainlock",       &getbestchainlock,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
     { "blockchain",         "getblockhashes",         &getblockhashes,         {"high","low"} },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
@@ -2297,7 +2581,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "getspecialtxes",         &getspecialtxes,         {"blockhash", "type", "count", "skip", "verbosity"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type"} },
+    { "blockchain",         "dumpsnapshot",           &dumpsnapshot,           {"path"} },
+    { "blockchain",         "verifysnapshot",         &verifysnapshot,         {"path"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
@@ -2307,6 +2593,7 @@ static const CRPCCommand commands[] =
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
     { "hidden",             "reconsiderblock",        &reconsiderblock,        {"blockhash"} },
+    { "hidden",             "replayblocks",           &replayblocks,           {"nblocks"} },
     { "hidden",             "waitfornewblock",        &waitfornewblock,        {"timeout"} },
     { "hidden",             "waitforblock",           &waitforblock,           {"blockhash","timeout"} },
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
@@ -12,6 +12,7 @@
 class CBlock;
 class CBlockIndex;
 class UniValue;
+class JSONRPCRequest;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
 
@@ -34,6 +35,8 @@ UniValue mempoolInfoToJSON();
 
 /** Mempool to JSON */
 UniValue mempoolToJSON(bool fVerbose = false);
+/** Mempool to JSON, streamed if the request supports it (see RPCStreamingResult) */
+UniValue mempoolToJSON(const JSONRPCRequest& request, bool fVerbose);
 
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
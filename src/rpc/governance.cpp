@@ -16,6 +16,7 @@
 #include <messagesigner.h>
 #include <net.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <util/system.h>
 #include <validation.h>
 #include <wallet/rpcwallet.h>
@@ -680,9 +681,9 @@ static UniValue gobject_vote_alias(const JSONRPCRequest& request)
 }
 #endif
 
-static UniValue ListObjects(const std::string& strCachedSignal, const std::string& strType, int nStartTime)
+static UniValue ListObjects(const JSONRPCRequest& request, const std::string& strCachedSignal, const std::string& strType, int nStartTime)
 {
-    UniValue objResult(UniValue::VOBJ);
+    RPCStreamingResult objResult(request, UniValue::VOBJ);
 
     // GET MATCHING GOVERNANCE OBJECTS
 
@@ -736,7 +737,7 @@ static UniValue ListObjects(const std::string& strCachedSignal, const std::strin
         objResult.pushKV(pGovObj->GetHash().ToString(), bObj);
     }
 
-    return objResult;
+    return objResult.Finish();
 }
 
 static void gobject_list_help()
@@ -769,7 +770,7 @@ static UniValue gobject_list(const JSONRPCRequest& request)
     if (strType != "proposals" && strType != "triggers" && strType != "all")
         return "Invalid type, should be 'proposals', 'triggers' or 'all'";
 
-    return ListObjects(strCachedSignal, strType, 0);
+    return ListObjects(request, strCachedSignal, strType, 0);
 }
 
 static void gobject_diff_help()
@@ -802,7 +803,7 @@ static UniValue gobject_diff(const JSONRPCRequest& request)
     if (strType != "proposals" && strType != "triggers" && strType != "all")
         return "Invalid type, should be 'proposals', 'triggers' or 'all'";
 
-    return ListObjects(strCachedSignal, strType, governance.GetLastDiffTime());
+    return ListObjects(request, strCachedSignal, strType, governance.GetLastDiffTime());
 }
 
 static void gobject_get_help()
@@ -8,16 +8,22 @@
 #include <clientversion.h>
 #include <consensus/consensus.h>
 #include <core_io.h>
+#include <dbwrapper.h>
+#include <evo/deterministicmns.h>
 #include <evo/mnauth.h>
 #include <httpserver.h>
+#include <index/blockfilterindex.h>
+#include <index/txindex.h>
 #include <key_io.h>
 #include <net.h>
 #include <netbase.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <scheduler.h>
 #include <timedata.h>
 #include <txmempool.h>
+#include <util/memaccounting.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <validation.h>
@@ -29,9 +35,12 @@
 #endif
 #include <warnings.h>
 
+#include <llmq/quorums_instantsend.h>
 #include <masternode/masternode-sync.h>
 #include <spork.h>
 
+#include <algorithm>
+#include <limits>
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
@@ -516,6 +525,50 @@ static bool getAddressesFromParams(const UniValue& params, std::vector<std::pair
     return true;
 }
 
+static size_t getLimitFromParams(const UniValue& params)
+{
+    if (!params[0].isObject()) {
+        return 0;
+    }
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNull()) {
+        return 0;
+    }
+    int limit = limitValue.get_int();
+    if (limit < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit must not be negative");
+    }
+    return (size_t)limit;
+}
+
+/**
+ * Reads the address index entries of all addresses. With a limit, every address is read up to (roughly) limit
+ * entries and all entries above the lowest height at which an address was cut off are dropped, so that the
+ * returned page is complete up to its last height for all addresses.
+ */
+static void getAddressIndexPage(const std::vector<std::pair<uint160, int> >& addresses, int start, int end, size_t limit,
+                                std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex)
+{
+    int cutoffHeight = std::numeric_limits<int>::max();
+
+    for (const auto& address : addresses) {
+        size_t oldSize = addressIndex.size();
+        if (!GetAddressIndex(address.first, address.second, addressIndex, start, end, limit)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (limit > 0 && addressIndex.size() - oldSize >= limit) {
+            cutoffHeight = std::min(cutoffHeight, addressIndex.back().first.blockHeight);
+        }
+    }
+
+    if (addresses.size() > 1 && cutoffHeight != std::numeric_limits<int>::max()) {
+        addressIndex.erase(std::remove_if(addressIndex.begin(), addressIndex.end(),
+            [cutoffHeight](const std::pair<CAddressIndexKey, CAmount>& e) {
+                return e.first.blockHeight > cutoffHeight;
+            }), addressIndex.end());
+    }
+}
+
 static bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
                 std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
     return a.second.blockHeight < b.second.blockHeight;
@@ -679,6 +732,8 @@ static UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Stop after roughly this many index entries. Entries of a block are never\n"
+            "            split, so the next page can be requested with \"start\" set to the last returned height + 1\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -718,20 +773,9 @@ static UniValue getaddressdeltas(const JSONRPCRequest& request)
     }
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressIndexPage(addresses, start, end, getLimitFromParams(request.params), addressIndex);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
-
-    UniValue result(UniValue::VARR);
+    RPCStreamingResult result(request, UniValue::VARR);
 
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         std::string address;
@@ -749,7 +793,7 @@ static UniValue getaddressdeltas(const JSONRPCRequest& request)
         result.push_back(delta);
     }
 
-    return result;
+    return result.Finish();
 }
 
 static UniValue getaddressbalance(const JSONRPCRequest& request)
@@ -786,33 +830,60 @@ static UniValue getaddressbalance(const JSONRPCRequest& request)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
+    CAmount balance = 0;
+    CAmount balance_spendable = 0;
+    CAmount balance_immature = 0;
+    CAmount received = 0;
 
     int nHeight;
-    {
+    if (fAddressBalanceIndex) {
+        // the aggregates must match the height used to find the immature coinbase outputs
         LOCK(cs_main);
         nHeight = chainActive.Height();
-    }
 
-    CAmount balance = 0;
-    CAmount balance_spendable = 0;
-    CAmount balance_immature = 0;
-    CAmount received = 0;
+        for (const auto& address : addresses) {
+            CAddressBalanceValue value;
+            if (!GetAddressBalance(address.first, address.second, value)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+            balance += value.balance;
+            received += value.received;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+            // only the last COINBASE_MATURITY blocks can contain immature outputs
+            if (!GetAddressIndex(address.first, address.second, addressIndex, std::max(1, nHeight - COINBASE_MATURITY + 1), std::max(1, nHeight))) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
         }
-        if (it->first.txindex == 0 && nHeight - it->first.blockHeight < COINBASE_MATURITY) {
-            balance_immature += it->second;
-        } else {
-            balance_spendable += it->second;
+
+        for (const auto& p : addressIndex) {
+            if (p.first.txindex == 0 && nHeight - p.first.blockHeight < COINBASE_MATURITY) {
+                balance_immature += p.second;
+            }
+        }
+        balance_spendable = balance - balance_immature;
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+
+        {
+            LOCK(cs_main);
+            nHeight = chainActive.Height();
+        }
+
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            if (it->second > 0) {
+                received += it->second;
+            }
+            if (it->first.txindex == 0 && nHeight - it->first.blockHeight < COINBASE_MATURITY) {
+                balance_immature += it->second;
+            } else {
+                balance_spendable += it->second;
+            }
+            balance += it->second;
         }
-        balance += it->second;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -840,6 +911,8 @@ static UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Stop after roughly this many index entries. Entries of a block are never\n"
+            "            split, so the next page can be requested with \"start\" set to the last returned height + 1\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -869,32 +942,21 @@ static UniValue getaddresstxids(const JSONRPCRequest& request)
     }
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
+    getAddressIndexPage(addresses, start, end, getLimitFromParams(request.params), addressIndex);
 
     std::set<std::pair<int, std::string> > txids;
     UniValue result(UniValue::VARR);
 
+    // entries of a single address are ordered by (height, txindex, txhash), so duplicates are always adjacent
+    const uint256* prevTxHash = nullptr;
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        std::string txid = it->first.txhash.GetHex();
-
         if (addresses.size() > 1) {
-            txids.insert(std::make_pair(height, txid));
+            txids.insert(std::make_pair(it->first.blockHeight, it->first.txhash.GetHex()));
         } else {
-            if (txids.insert(std::make_pair(height, txid)).second) {
-                result.push_back(txid);
+            if (prevTxHash == nullptr || *prevTxHash != it->first.txhash) {
+                result.push_back(it->first.txhash.GetHex());
             }
+            prevTxHash = &it->first.txhash;
         }
     }
 
@@ -965,6 +1027,11 @@ static UniValue RPCLockedMemoryInfo()
     obj.pushKV("locked", uint64_t(stats.locked));
     obj.pushKV("chunks_used", uint64_t(stats.chunks_used));
     obj.pushKV("chunks_free", uint64_t(stats.chunks_free));
+    obj.pushKV("unlocked", uint64_t(stats.unlocked));
+    obj.pushKV("arenas", uint64_t(stats.arenas));
+    obj.pushKV("slabs", uint64_t(stats.slabs));
+    obj.pushKV("slab_chunks_used", uint64_t(stats.slab_chunks_used));
+    obj.pushKV("slab_chunks_free", uint64_t(stats.slab_chunks_free));
     return obj;
 }
 
@@ -1000,6 +1067,7 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "1. \"mode\"     (string, optional, default: \"stats\") Determines what kind of information is returned.\n"
             "  - \"stats\" returns general statistics about memory usage in the daemon.\n"
             "  - \"mallocinfo\" returns an XML string describing low-level heap state (only available if compiled with glibc 2.10+).\n"
+            "  - \"subsystems\" returns the estimated memory usage of the LLMQ, InstantSend, ChainLocks, governance, CoinJoin and spork subsystems.\n"
             "\nResult (mode \"stats\"):\n"
             "{\n"
             "  \"locked\": {               (json object) Information about locked memory manager\n"
@@ -1009,10 +1077,35 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "    \"unlocked\": xxxxx,      (numeric) Amount of bytes that failed locking\n"
+            "    \"arenas\": xxxxx,        (numeric) Number of arenas\n"
+            "    \"slabs\": xxxxx,         (numeric) Number of slabs small allocations are served from\n"
+            "    \"slab_chunks_used\": xxxxx, (numeric) Number of allocated chunks in slabs\n"
+            "    \"slab_chunks_free\": xxxxx, (numeric) Number of unused chunks in slabs\n"
+            "  },\n"
+            "  \"instantsend\": {          (json object) Information about InstantSend\n"
+            "    \"nonlockedtxs\": xxxxx,  (numeric) Number of tracked non-locked transactions\n"
+            "    \"nonlockedtxs_bytes\": xxxxx, (numeric) Memory used by the graph of non-locked transactions\n"
+            "  },\n"
+            "  \"mnlistcache\": {          (json object) Information about the masternode list cache\n"
+            "    \"lists\": xxxxx,         (numeric) Number of cached masternode lists\n"
+            "    \"diffs\": xxxxx,         (numeric) Number of cached masternode list diffs\n"
+            "    \"usage\": xxxxx,         (numeric) Estimated memory used by cached lists and diffs\n"
+            "    \"max_usage\": xxxxx,     (numeric) Memory limit of the cache (-mnlistcachesize)\n"
+            "    \"list_hits\": xxxxx,     (numeric) Number of lists found in the cache\n"
+            "    \"list_misses\": xxxxx,   (numeric) Number of list snapshots read from disk\n"
+            "    \"diff_hits\": xxxxx,     (numeric) Number of diffs found in the cache\n"
+            "    \"diff_misses\": xxxxx,   (numeric) Number of diffs read from disk\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
             "\"<malloc version=\"1\">...\"\n"
+            "\nResult (mode \"subsystems\"):\n"
+            "{\n"
+            "  \"name\": xxxxx,           (numeric) Estimated number of bytes used by the subsystem\n"
+            "  ...\n"
+            "  \"total\": xxxxx           (numeric) Sum of all subsystems\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmemoryinfo", "")
             + HelpExampleRpc("getmemoryinfo", "")
@@ -1022,6 +1115,17 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        if (llmq::quorumInstantSendManager) {
+            UniValue isObj(UniValue::VOBJ);
+            isObj.pushKV("nonlockedtxs", (uint64_t)llmq::quorumInstantSendManager->GetNonLockedTxsCount());
+            isObj.pushKV("nonlockedtxs_bytes", (uint64_t)llmq::quorumInstantSendManager->GetNonLockedTxsMemoryUsage());
+            obj.pushKV("instantsend", isObj);
+        }
+        if (deterministicMNManager) {
+            UniValue mnListCacheObj;
+            deterministicMNManager->CacheStatsToJson(mnListCacheObj);
+            obj.pushKV("mnlistcache", mnListCacheObj);
+        }
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -1029,6 +1133,15 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
 #else
         throw JSONRPCError(RPC_INVALID_PARAMETER, "mallocinfo is only available when compiled with glibc 2.10+");
 #endif
+    } else if (mode == "subsystems") {
+        UniValue obj(UniValue::VOBJ);
+        size_t nTotal = 0;
+        for (const auto& p : memaccounting::GetUsage()) {
+            obj.pushKV(p.first, (uint64_t)p.second);
+            nTotal += p.second;
+        }
+        obj.pushKV("total", (uint64_t)nTotal);
+        return obj;
     } else {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "unknown mode " + mode);
     }
@@ -1123,6 +1236,263 @@ static UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue SummaryToJSON(const IndexSummary& summary, const std::string& index_name)
+{
+    UniValue ret_summary(UniValue::VOBJ);
+    if (!index_name.empty() && index_name != summary.name) return ret_summary;
+
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("synced", summary.synced);
+    entry.pushKV("best_block_height", summary.best_block_height);
+    ret_summary.pushKV(summary.name, entry);
+    return ret_summary;
+}
+
+static UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getindexinfo ( \"index_name\" )\n"
+            "\nReturns the status of one or all available indices currently running in the node.\n"
+            "\nArguments:\n"
+            "1. \"index_name\"    (string, optional) Filter results for an index with a specific name.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\" : {                   (json object) The name of the index\n"
+            "    \"synced\" : true|false,      (boolean) Whether the index is synced or not\n"
+            "    \"best_block_height\" : n     (numeric) The block height to which the index is synced\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+            + HelpExampleCli("getindexinfo", "txindex")
+            + HelpExampleRpc("getindexinfo", "txindex")
+        );
+
+    UniValue result(UniValue::VOBJ);
+    const std::string index_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+
+    if (g_txindex) {
+        result.pushKVs(SummaryToJSON(g_txindex->GetSummary(), index_name));
+    }
+
+    if (g_blockfilterindex) {
+        result.pushKVs(SummaryToJSON(g_blockfilterindex->GetSummary(), index_name));
+    }
+
+    return result;
+}
+
+static UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getdbstats\n"
+            "\nReturns the tuning and LevelDB statistics of all open databases.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\" : {                     (json object) The name of the database\n"
+            "    \"tuning\" : {                 (json object) The tuning applied to the database, see -dbtune\n"
+            "      \"bloombits\" : n,\n"
+            "      \"blocksize\" : n,\n"
+            "      \"blockcache\" : n,\n"
+            "      \"writebuffer\" : n\n"
+            "    },\n"
+            "    \"memory_usage\" : n,          (numeric) Approximate memory usage in bytes\n"
+            "    \"files_per_level\" : [n,...], (json array) Number of table files per level\n"
+            "    \"read_amplification\" : n,    (numeric) Worst case number of table files a point lookup has to check\n"
+            "    \"compaction_seconds\" : x.x,  (numeric) Total time spent in compactions\n"
+            "    \"compaction_read_mb\" : x.x,  (numeric) Total data read by compactions\n"
+            "    \"compaction_written_mb\" : x.x (numeric) Total data written by compactions\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue result(UniValue::VOBJ);
+    for (const DBStats& stats : CDBWrapper::GetAllDBStats()) {
+        UniValue tuning(UniValue::VOBJ);
+        tuning.pushKV("bloombits", stats.tuning.nBloomBits);
+        tuning.pushKV("blocksize", (uint64_t)stats.tuning.nBlockSize);
+        tuning.pushKV("blockcache", stats.tuning.nBlockCachePercent);
+        tuning.pushKV("writebuffer", stats.tuning.nWriteBufferPercent);
+
+        UniValue files(UniValue::VARR);
+        for (int nFiles : stats.vFilesPerLevel) {
+            files.push_back(nFiles);
+        }
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("tuning", tuning);
+        entry.pushKV("memory_usage", (uint64_t)stats.nMemoryUsage);
+        entry.pushKV("files_per_level", files);
+        entry.pushKV("read_amplification", stats.nReadAmplification);
+        entry.pushKV("compaction_seconds", stats.nCompactionSeconds);
+        entry.pushKV("compaction_read_mb", stats.nCompactionReadMB);
+        entry.pushKV("compaction_written_mb", stats.nCompactionWrittenMB);
+        result.pushKV(stats.name, entry);
+    }
+    return result;
+}
+
+static UniValue getschedulerinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getschedulerinfo\n"
+            "\nReturns the runtime statistics of the named background tasks of all schedulers.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"scheduler\" : \"name\",     (string) The name of the scheduler\n"
+            "    \"task\" : \"name\",          (string) The name of the task\n"
+            "    \"runs\" : n,                 (numeric) How often the task ran\n"
+            "    \"total_ms\" : x.x,           (numeric) Total runtime of the task\n"
+            "    \"max_ms\" : x.x,             (numeric) Longest single run of the task\n"
+            "    \"max_delay_ms\" : x.x        (numeric) Longest time the task waited for a free thread after it was due\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getschedulerinfo", "")
+            + HelpExampleRpc("getschedulerinfo", "")
+        );
+
+    UniValue result(UniValue::VARR);
+    for (const SchedulerTaskStats& stats : CScheduler::GetAllTaskStats()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("scheduler", stats.scheduler);
+        entry.pushKV("task", stats.name);
+        entry.pushKV("runs", stats.nRuns);
+        entry.pushKV("total_ms", stats.nTotalMicros / 1000.0);
+        entry.pushKV("max_ms", stats.nMaxMicros / 1000.0);
+        entry.pushKV("max_delay_ms", stats.nMaxDelayMicros / 1000.0);
+        result.push_back(entry);
+    }
+    return result;
+}
+
+static UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error(
+            "getlockstats ( count reset )\n"
+            "\nReturns the lock contention statistics recorded with -lockstats, by lock and call site.\n"
+            "Hold times are sampled for one in " + std::to_string(LOCK_STATS_HOLD_SAMPLE_RATE) + " acquisitions.\n"
+            "\nArguments:\n"
+            "1. count    (numeric, optional, default=5) The number of call sites with the most waiting to show per lock\n"
+            "2. reset    (boolean, optional, default=false) Reset the statistics after returning them\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"lock\" : \"name\",            (string) The name of the lock, with the file for generic member names\n"
+            "    \"contentions\" : n,          (numeric) How often a thread had to wait for the lock\n"
+            "    \"wait_ms\" : x.x,            (numeric) Total time threads waited for the lock\n"
+            "    \"max_wait_ms\" : x.x,        (numeric) Longest single wait\n"
+            "    \"hold_samples\" : n,         (numeric) Number of sampled acquisitions\n"
+            "    \"avg_hold_ms\" : x.x,        (numeric) Average time the lock was held in the sampled acquisitions\n"
+            "    \"max_hold_ms\" : x.x,        (numeric) Longest sampled hold time\n"
+            "    \"sites\" : [                 (json array) The call sites with the most waiting\n"
+            "      {\n"
+            "        \"site\" : \"file:line\",   (string) The call site\n"
+            "        \"contentions\" : n,\n"
+            "        \"wait_ms\" : x.x,\n"
+            "        \"max_wait_ms\" : x.x,\n"
+            "        \"avg_hold_ms\" : x.x\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "10 true")
+            + HelpExampleRpc("getlockstats", "10, true")
+        );
+
+    if (!g_lock_stats_enabled) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Lock statistics are disabled, start with -lockstats");
+    }
+
+    int nCount = request.params[0].isNull() ? 5 : request.params[0].get_int();
+    bool fReset = !request.params[1].isNull() && request.params[1].get_bool();
+
+    struct LockTotals
+    {
+        LockSiteStatsEntry totals;
+        std::vector<LockSiteStatsEntry> sites;
+    };
+    std::map<std::string, LockTotals> mapLocks;
+    for (LockSiteStatsEntry& site : GetLockSiteStats()) {
+        // LOCK(::cs_main) and LOCK(cs_main) are the same lock, while a bare "cs" is only unique per file
+        std::string strName = site.name;
+        if (strName.compare(0, 2, "::") == 0) {
+            strName = strName.substr(2);
+        }
+        if (strName.find_first_of(".>:") == std::string::npos && strName.size() <= 4) {
+            strName += " (" + site.file + ")";
+        }
+        LockTotals& lock = mapLocks[strName];
+        lock.totals.nContentions += site.nContentions;
+        lock.totals.nWaitMicros += site.nWaitMicros;
+        lock.totals.nMaxWaitMicros = std::max(lock.totals.nMaxWaitMicros, site.nMaxWaitMicros);
+        lock.totals.nHoldSamples += site.nHoldSamples;
+        lock.totals.nHoldMicros += site.nHoldMicros;
+        lock.totals.nMaxHoldMicros = std::max(lock.totals.nMaxHoldMicros, site.nMaxHoldMicros);
+        lock.sites.emplace_back(std::move(site));
+    }
+    if (fReset) {
+        ResetLockSiteStats();
+    }
+
+    std::vector<std::pair<std::string, LockTotals*>> vecLocks;
+    for (auto& p : mapLocks) {
+        if (p.second.totals.nContentions || p.second.totals.nHoldSamples) {
+            vecLocks.emplace_back(p.first, &p.second);
+        }
+    }
+    std::sort(vecLocks.begin(), vecLocks.end(), [](const std::pair<std::string, LockTotals*>& a, const std::pair<std::string, LockTotals*>& b) {
+        return a.second->totals.nWaitMicros > b.second->totals.nWaitMicros;
+    });
+
+    auto avgHoldMs = [](const LockSiteStatsEntry& e) {
+        return e.nHoldSamples ? e.nHoldMicros / 1000.0 / e.nHoldSamples : 0.0;
+    };
+
+    UniValue result(UniValue::VARR);
+    for (const auto& p : vecLocks) {
+        const LockSiteStatsEntry& totals = p.second->totals;
+        std::vector<LockSiteStatsEntry>& sites = p.second->sites;
+        std::sort(sites.begin(), sites.end(), [](const LockSiteStatsEntry& a, const LockSiteStatsEntry& b) {
+            return a.nWaitMicros > b.nWaitMicros;
+        });
+
+        UniValue sitesArr(UniValue::VARR);
+        for (int i = 0; i < (int)sites.size() && i < nCount; i++) {
+            UniValue site(UniValue::VOBJ);
+            site.pushKV("site", strprintf("%s:%d", sites[i].file, sites[i].line));
+            site.pushKV("contentions", sites[i].nContentions);
+            site.pushKV("wait_ms", sites[i].nWaitMicros / 1000.0);
+            site.pushKV("max_wait_ms", sites[i].nMaxWaitMicros / 1000.0);
+            site.pushKV("avg_hold_ms", avgHoldMs(sites[i]));
+            sitesArr.push_back(site);
+        }
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("lock", p.first);
+        entry.pushKV("contentions", totals.nContentions);
+        entry.pushKV("wait_ms", totals.nWaitMicros / 1000.0);
+        entry.pushKV("max_wait_ms", totals.nMaxWaitMicros / 1000.0);
+        entry.pushKV("hold_samples", totals.nHoldSamples);
+        entry.pushKV("avg_hold_ms", avgHoldMs(totals));
+        entry.pushKV("max_hold_ms", totals.nMaxHoldMicros / 1000.0);
+        entry.pushKV("sites", sitesArr);
+        result.push_back(entry);
+    }
+    return result;
+}
+
 static UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1140,12 +1510,16 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "debug",                  &debug,                  {} },
+    { "control",            "getdbstats",             &getdbstats,             {} },
+    { "control",            "getschedulerinfo",       &getschedulerinfo,       {} },
+    { "control",            "getlockstats",           &getlockstats,           {"count", "reset"} },
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
     { "util",               "validateaddress",        &validateaddress,        {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, {"privkey","message"} },
+    { "util",               "getindexinfo",           &getindexinfo,           {"index_name"} },
     { "blockchain",         "getspentinfo",           &getspentinfo,           {"json"} },
 
     /* Address index */
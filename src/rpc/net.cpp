@@ -92,6 +92,18 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"lastrecv\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,            (numeric) The total bytes sent\n"
             "    \"bytesrecv\": n,            (numeric) The total bytes received\n"
+            "    \"compression\": {           (json object) LZ4 compression of quorum data, masternode list diffs and governance objects\n"
+            "       \"enabled\": true|false,   (boolean) Whether we send compressed messages to the peer\n"
+            "       \"bytessent\": n,          (numeric) The payload bytes of the compressed messages sent\n"
+            "       \"bytessent_uncompressed\": n, (numeric) The payload bytes these messages would have had uncompressed\n"
+            "       \"bytesrecv\": n,          (numeric) The payload bytes of the compressed messages received\n"
+            "       \"bytesrecv_uncompressed\": n, (numeric) The payload bytes these messages had after decompression\n"
+            "       \"ratio\": x.xxx           (numeric) Uncompressed divided by compressed bytes of all sent and received compressed messages\n"
+            "    },\n"
+            "    \"sendqueue\": n,            (numeric) The bytes queued for sending\n"
+            "    \"sendqueue_bulk\": n,       (numeric) The part of sendqueue which is waiting behind LLMQ-critical messages\n"
+            "    \"recvbuffers_allocated\": n, (numeric) The number of received messages which needed a new buffer\n"
+            "    \"recvbuffers_reused\": n,  (numeric) The number of received messages which reused the buffer of a processed one\n"
             "    \"conntime\": ttt,           (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
             "    \"timeoffset\": ttt,         (numeric) The time offset in seconds\n"
             "    \"pingtime\": n,             (numeric) ping time (if available)\n"
@@ -160,6 +172,21 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
         obj.pushKV("lastrecv", stats.nLastRecv);
         obj.pushKV("bytessent", stats.nSendBytes);
         obj.pushKV("bytesrecv", stats.nRecvBytes);
+        UniValue compression(UniValue::VOBJ);
+        compression.pushKV("enabled", stats.fSendCompressed);
+        compression.pushKV("bytessent", stats.nSendBytesCompressed);
+        compression.pushKV("bytessent_uncompressed", stats.nSendBytesUncompressed);
+        compression.pushKV("bytesrecv", stats.nRecvBytesCompressed);
+        compression.pushKV("bytesrecv_uncompressed", stats.nRecvBytesUncompressed);
+        uint64_t nCompressed = stats.nSendBytesCompressed + stats.nRecvBytesCompressed;
+        if (nCompressed != 0) {
+            compression.pushKV("ratio", (double)(stats.nSendBytesUncompressed + stats.nRecvBytesUncompressed) / nCompressed);
+        }
+        obj.pushKV("compression", compression);
+        obj.pushKV("sendqueue", (uint64_t)stats.nSendQueueSize);
+        obj.pushKV("sendqueue_bulk", (uint64_t)stats.nSendQueueBulkSize);
+        obj.pushKV("recvbuffers_allocated", stats.nRecvBuffersAllocated);
+        obj.pushKV("recvbuffers_reused", stats.nRecvBuffersReused);
         obj.pushKV("conntime", stats.nTimeConnected);
         obj.pushKV("timeoffset", stats.nTimeOffset);
         if (stats.dPingTime > 0.0)
@@ -0,0 +1,150 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/resultcache.h>
+
+#include <evo/deterministicmns.h>
+#include <governance/governance.h>
+#include <rpc/server.h>
+#include <sync.h>
+#include <unordered_lru_cache.h>
+#include <validation.h>
+
+#include <univalue.h>
+
+#include <memory>
+
+namespace {
+
+enum RPCStateDependency {
+    DEPENDS_ON_TIP = 1 << 0,
+    DEPENDS_ON_MN_LIST = 1 << 1,
+    DEPENDS_ON_GOVERNANCE = 1 << 2,
+};
+
+struct CachedResult
+{
+    RPCStateEpoch epoch;
+    std::shared_ptr<const UniValue> result;
+};
+
+Mutex cs_rpcResultCache;
+unordered_lru_cache<std::string, CachedResult, std::hash<std::string>, RPC_RESULT_CACHE_SIZE> rpcResultCache GUARDED_BY(cs_rpcResultCache);
+
+std::string GetSubCommand(const UniValue& params, size_t nIndex)
+{
+    if (params.size() <= nIndex || !params[nIndex].isStr()) {
+        return "";
+    }
+    return params[nIndex].get_str();
+}
+
+/** Whether the optional bool parameter is absent or false, like ParseBoolV would read it */
+bool IsParamFalse(const UniValue& params, size_t nIndex)
+{
+    if (params.size() <= nIndex || params[nIndex].isNull()) {
+        return true;
+    }
+    const UniValue& v = params[nIndex];
+    if (v.isBool()) {
+        return !v.get_bool();
+    }
+    return v.isStr() && (v.get_str() == "false" || v.get_str() == "0");
+}
+
+/** Which parts of the state the result of the request depends on, or 0 if it must not be cached */
+int GetStateDependencies(const JSONRPCRequest& request)
+{
+    // Named parameters would need the argument names of the sub-commands, just don't cache them
+    if (!request.params.isArray() && !request.params.isNull()) {
+        return 0;
+    }
+    const std::string& strMethod = request.strMethod;
+    if (strMethod == "masternodelist") {
+        return DEPENDS_ON_TIP | DEPENDS_ON_MN_LIST;
+    }
+    const std::string strCommand = GetSubCommand(request.params, 0);
+    if (strMethod == "masternode" && (strCommand == "list" || strCommand == "count")) {
+        return DEPENDS_ON_TIP | DEPENDS_ON_MN_LIST;
+    }
+    // detailed entries contain the wallet of the request and the MN meta info, which change without a new MN list
+    if (strMethod == "protx" && strCommand == "list" && GetSubCommand(request.params, 1) != "wallet" && IsParamFalse(request.params, 2)) {
+        return DEPENDS_ON_TIP | DEPENDS_ON_MN_LIST;
+    }
+    // the secret key share of quorum info can show up without a new block (e.g. through data recovery)
+    if (strMethod == "quorum" && (strCommand == "list" || (strCommand == "info" && request.params.size() <= 3))) {
+        return DEPENDS_ON_TIP | DEPENDS_ON_MN_LIST;
+    }
+    if (strMethod == "gobject" && strCommand == "count") {
+        return DEPENDS_ON_GOVERNANCE;
+    }
+    return 0;
+}
+
+RPCStateEpoch GetCurrentEpoch(int nDependencies)
+{
+    RPCStateEpoch epoch;
+    if (nDependencies & DEPENDS_ON_TIP) {
+        LOCK(g_best_block_mutex);
+        epoch.tipHash = g_best_block;
+    }
+    if ((nDependencies & DEPENDS_ON_MN_LIST) && deterministicMNManager) {
+        epoch.nMNListCounter = deterministicMNManager->GetTipListChangeCounter();
+    }
+    if (nDependencies & DEPENDS_ON_GOVERNANCE) {
+        epoch.nGovernanceCounter = governance.GetChangeCounter();
+    }
+    return epoch;
+}
+
+bool operator==(const RPCStateEpoch& a, const RPCStateEpoch& b)
+{
+    return a.tipHash == b.tipHash && a.nMNListCounter == b.nMNListCounter && a.nGovernanceCounter == b.nGovernanceCounter;
+}
+
+} // anonymous namespace
+
+bool RPCResultCacheLookup(const JSONRPCRequest& request, RPCResultCacheKey& key, UniValue& result)
+{
+    key.fCacheable = false;
+    if (request.fHelp) {
+        return false;
+    }
+    int nDependencies = GetStateDependencies(request);
+    if (nDependencies == 0) {
+        return false;
+    }
+
+    key.fCacheable = true;
+    key.strKey = request.strMethod + request.params.write();
+    // taken before the result is computed, so that a result is never stored for an older epoch than it reflects
+    key.epoch = GetCurrentEpoch(nDependencies);
+
+    std::shared_ptr<const UniValue> cachedResult;
+    {
+        LOCK(cs_rpcResultCache);
+        CachedResult cached;
+        if (!rpcResultCache.get(key.strKey, cached) || !(cached.epoch == key.epoch)) {
+            return false;
+        }
+        cachedResult = cached.result;
+    }
+    // copy outside of the lock, results like masternode list can be large
+    result = *cachedResult;
+    return true;
+}
+
+void RPCResultCacheStore(const RPCResultCacheKey& key, const UniValue& result)
+{
+    assert(key.fCacheable);
+    CachedResult cached{key.epoch, std::make_shared<const UniValue>(result)};
+    LOCK(cs_rpcResultCache);
+    rpcResultCache.emplace(key.strKey, std::move(cached));
+}
+
+void RPCResultCacheClear()
+{
+    LOCK(cs_rpcResultCache);
+    rpcResultCache.clear();
+}
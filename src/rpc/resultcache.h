@@ -0,0 +1,48 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_RESULTCACHE_H
+#define BITCOIN_RPC_RESULTCACHE_H
+
+#include <uint256.h>
+
+#include <string>
+
+class JSONRPCRequest;
+class UniValue;
+
+/** Maximum number of cached RPC results */
+static const size_t RPC_RESULT_CACHE_SIZE = 64;
+
+/** The state an RPC result was computed for. Cached results are only used as long as the parts of the state their
+ * method depends on are unchanged.
+ */
+struct RPCStateEpoch
+{
+    uint256 tipHash;
+    uint64_t nMNListCounter{0};
+    uint64_t nGovernanceCounter{0};
+};
+
+/** A request which is eligible for caching, together with the state epoch at the time of the lookup */
+struct RPCResultCacheKey
+{
+    bool fCacheable{false};
+    std::string strKey;
+    RPCStateEpoch epoch;
+};
+
+/**
+ * Look up the result of a request which only depends on the chain tip, the masternode list or governance
+ * (e.g. masternode list, protx list, quorum info, gobject count). Returns true if a result computed in the
+ * current epoch was found. Otherwise, if the request is cacheable, key is set up for RPCResultCacheStore.
+ * This does not lock cs_main.
+ */
+bool RPCResultCacheLookup(const JSONRPCRequest& request, RPCResultCacheKey& key, UniValue& result);
+/** Store the result of a request for which RPCResultCacheLookup returned false */
+void RPCResultCacheStore(const RPCResultCacheKey& key, const UniValue& result);
+/** Drop all cached results */
+void RPCResultCacheClear();
+
+#endif // BITCOIN_RPC_RESULTCACHE_H
@@ -8,6 +8,7 @@
 #include <index/txindex.h>
 #include <messagesigner.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <txmempool.h>
 #include <util/moneystr.h>
 #include <util/validation.h>
@@ -975,7 +976,7 @@ static UniValue protx_list(const JSONRPCRequest& request)
         type = request.params[1].get_str();
     }
 
-    UniValue ret(UniValue::VARR);
+    RPCStreamingResult ret(request, UniValue::VARR);
 
     if (g_txindex) {
         g_txindex->BlockUntilSyncedToCurrentChain();
@@ -1031,16 +1032,28 @@ static UniValue protx_list(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid height specified");
         }
 
-        CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(chainActive[height]);
+        // the list at the tip shares its columnar view with all other users of it
+        CDeterministicMNList mnList = deterministicMNManager->GetListAtChainTip();
+        if (mnList.GetBlockHash() != chainActive[height]->GetBlockHash()) {
+            mnList = deterministicMNManager->GetListForBlock(chainActive[height]);
+        }
+        auto columns = mnList.GetColumns();
         bool onlyValid = type == "valid";
-        mnList.ForEachMN(onlyValid, [&](const CDeterministicMNCPtr& dmn) {
-            ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed));
-        });
+        for (size_t i = 0; i < columns->size(); i++) {
+            if (onlyValid && !columns->IsValid(i)) {
+                continue;
+            }
+            if (detailed) {
+                ret.push_back(BuildDMNListEntry(pwallet, columns->dmns[i], true));
+            } else {
+                ret.push_back(columns->proTxHashes[i].ToString());
+            }
+        }
     } else {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid type specified");
     }
 
-    return ret;
+    return ret.Finish();
 }
 
 static void protx_info_help()
@@ -5,6 +5,7 @@
 #include <chainparams.h>
 #include <index/txindex.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <validation.h>
 
 #include <masternode/activemasternode.h>
@@ -97,6 +98,10 @@ static UniValue BuildQuorumInfo(const llmq::CQuorumCPtr& quorum, bool includeMem
 {
     UniValue ret(UniValue::VOBJ);
 
+    if (includeMembers || includeSkShare) {
+        llmq::quorumManager->EnsureQuorumContributions(quorum);
+    }
+
     ret.pushKV("height", quorum->pindexQuorum->nHeight);
     ret.pushKV("type", quorum->params.name);
     ret.pushKV("quorumHash", quorum->qc->quorumHash.ToString());
@@ -122,6 +127,9 @@ static UniValue BuildQuorumInfo(const llmq::CQuorumCPtr& quorum, bool includeMem
         ret.pushKV("members", membersArr);
     }
     ret.pushKV("quorumPublicKey", quorum->qc->quorumPublicKey.ToString());
+    if (includeMembers) {
+        ret.pushKV("dataRecovery", quorum->GetDataRecoveryStatus());
+    }
     const CBLSSecretKey& skShare = quorum->GetSkShare();
     if (includeSkShare && skShare.IsValid()) {
         ret.pushKV("secretKeyShare", skShare.ToString());
@@ -281,7 +289,7 @@ static UniValue quorum_memberof(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "masternode not found");
     }
 
-    UniValue result(UniValue::VARR);
+    RPCStreamingResult result(request, UniValue::VARR);
 
     for (const auto& type : llmq::CLLMQUtils::GetEnabledQuorumTypes(pindexTip)) {
         const auto& llmq_params = llmq::GetLLMQParams(type);
@@ -300,7 +308,7 @@ static UniValue quorum_memberof(const JSONRPCRequest& request)
         }
     }
 
-    return result;
+    return result.Finish();
 }
 
 static void quorum_sign_help()
@@ -7,8 +7,10 @@
 #include <rpc/server.h>
 
 #include <fs.h>
+#include <httpserver.h>
 #include <key_io.h>
 #include <random.h>
+#include <rpc/resultcache.h>
 #include <shutdown.h>
 #include <sync.h>
 #include <ui_interface.h>
@@ -21,6 +23,10 @@
 #include <boost/algorithm/string/split.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <set>
 #include <memory> // for unique_ptr
 #include <unordered_map>
 
@@ -36,6 +42,72 @@ static std::map<std::string, std::unique_ptr<RPCTimerBase> > deadlineTimers;
 // Any commands submitted by this user will have their commands filtered based on the mapPlatformRestrictions
 static const std::string defaultPlatformUser = "platform-user";
 
+// Entries of a batch request for these methods may be executed in parallel. They only read state and either don't
+// need cs_main or only hold it for short lookups.
+static const std::set<std::string> PARALLEL_BATCH_RPC_METHODS = {
+    "decoderawtransaction",
+    "decodescript",
+    "getaddressbalance",
+    "getaddressdeltas",
+    "getaddressmempool",
+    "getaddresstxids",
+    "getaddressutxos",
+    "getbestblockhash",
+    "getblock",
+    "getblockcount",
+    "getblockfilter",
+    "getblockhash",
+    "getblockheader",
+    "getblockheaders",
+    "getmempoolentry",
+    "getrawtransaction",
+    "getspentinfo",
+    "gettxout",
+    "gettxoutproof",
+    "validateaddress",
+    "verifytxoutproof",
+};
+
+/** Upper bounds (in microseconds) of the latency histogram buckets, the last bucket is unbounded */
+static const std::array<int64_t, 5> RPC_LATENCY_BUCKETS{{1000, 10000, 100000, 1000000, 10000000}};
+static const std::array<std::string, 6> RPC_LATENCY_BUCKET_NAMES{{"<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s"}};
+
+struct RPCMethodStats
+{
+    uint64_t nCalls{0};
+    uint64_t nErrors{0};
+    int64_t nTotalMicros{0};
+    int64_t nMaxMicros{0};
+    std::array<uint64_t, RPC_LATENCY_BUCKETS.size() + 1> vHistogram{};
+};
+static Mutex cs_rpcStats;
+static std::map<std::string, RPCMethodStats> mapRPCStats GUARDED_BY(cs_rpcStats);
+
+/** Records the latency of a call into the per-method stats when it goes out of scope */
+class RPCLatencyRecorder
+{
+private:
+    const std::string& strMethod;
+    const int64_t nStart;
+
+public:
+    bool fError{true};
+
+    explicit RPCLatencyRecorder(const std::string& _strMethod) : strMethod(_strMethod), nStart(GetTimeMicros()) {}
+    ~RPCLatencyRecorder()
+    {
+        const int64_t nMicros = GetTimeMicros() - nStart;
+        const size_t nBucket = std::upper_bound(RPC_LATENCY_BUCKETS.begin(), RPC_LATENCY_BUCKETS.end(), nMicros) - RPC_LATENCY_BUCKETS.begin();
+        LOCK(cs_rpcStats);
+        RPCMethodStats& stats = mapRPCStats[strMethod];
+        stats.nCalls++;
+        stats.nErrors += fError;
+        stats.nTotalMicros += nMicros;
+        stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+        stats.vHistogram[nBucket]++;
+    }
+};
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -330,6 +402,66 @@ static UniValue uptime(const JSONRPCRequest& jsonRequest)
     return GetTime() - GetStartupTime();
 }
 
+static UniValue getrpcstats(const JSONRPCRequest& jsonRequest)
+{
+    if (jsonRequest.fHelp || jsonRequest.params.size() > 0)
+        throw std::runtime_error(
+                "getrpcstats\n"
+                        "\nReturns latency statistics of all RPC methods called since startup and the current depth of the\n"
+                        "HTTP work queues.\n"
+                        "\nResult:\n"
+                        "{\n"
+                        "  \"methods\": {\n"
+                        "    \"name\": {                (json object) The method name\n"
+                        "      \"calls\": n,            (numeric) Number of calls\n"
+                        "      \"errors\": n,           (numeric) Number of calls which failed\n"
+                        "      \"total_ms\": n,         (numeric) Total time spent in the method, in milliseconds\n"
+                        "      \"avg_ms\": n,           (numeric) Average time per call, in milliseconds\n"
+                        "      \"max_ms\": n,           (numeric) Longest call, in milliseconds\n"
+                        "      \"histogram\": {         (json object) Number of calls per latency bucket\n"
+                        "        \"<1ms\": n,\n"
+                        "        ...\n"
+                        "        \">=10s\": n\n"
+                        "      }\n"
+                        "    },\n"
+                        "    ...\n"
+                        "  },\n"
+                        "  \"queue\": n,              (numeric) Number of queued cheap HTTP requests\n"
+                        "  \"slow_queue\": n          (numeric) Number of queued expensive HTTP requests (see -rpcslowmethod)\n"
+                        "}\n"
+                        "\nExamples:\n"
+                + HelpExampleCli("getrpcstats", "")
+                + HelpExampleRpc("getrpcstats", "")
+        );
+
+    UniValue methods(UniValue::VOBJ);
+    {
+        LOCK(cs_rpcStats);
+        for (const auto& p : mapRPCStats) {
+            const RPCMethodStats& stats = p.second;
+            UniValue histogram(UniValue::VOBJ);
+            for (size_t i = 0; i < stats.vHistogram.size(); i++) {
+                histogram.pushKV(RPC_LATENCY_BUCKET_NAMES[i], stats.vHistogram[i]);
+            }
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("calls", stats.nCalls);
+            obj.pushKV("errors", stats.nErrors);
+            obj.pushKV("total_ms", stats.nTotalMicros / 1000.0);
+            obj.pushKV("avg_ms", stats.nCalls ? stats.nTotalMicros / 1000.0 / stats.nCalls : 0.0);
+            obj.pushKV("max_ms", stats.nMaxMicros / 1000.0);
+            obj.pushKV("histogram", histogram);
+            methods.pushKV(p.first, obj);
+        }
+    }
+
+    auto queueDepth = HTTPWorkQueueDepth();
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("methods", methods);
+    ret.pushKV("queue", (uint64_t)queueDepth.first);
+    ret.pushKV("slow_queue", (uint64_t)queueDepth.second);
+    return ret;
+}
+
 /**
  * Call Table
  */
@@ -339,6 +471,7 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   {"command","subcommand"}  },
     { "control",            "stop",                   &stop,                   {"wait"}  },
+    { "control",            "getrpcstats",            &getrpcstats,            {}  },
     { "control",            "uptime",                 &uptime,                 {}  },
 };
 
@@ -394,6 +527,7 @@ void StopRPC()
 {
     LogPrint(BCLog::RPC, "Stopping RPC\n");
     deadlineTimers.clear();
+    RPCResultCacheClear();
     DeleteAuthCookie();
     g_rpcSignals.Stopped();
 }
@@ -489,11 +623,88 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
+static bool IsParallelBatchEntry(const UniValue& req)
+{
+    if (!req.isObject()) {
+        return false;
+    }
+    const UniValue& method = find_value(req.get_obj(), "method");
+    return method.isStr() && PARALLEL_BATCH_RPC_METHODS.count(method.get_str());
+}
+
+/** A run of batch entries which are executed in parallel by the thread handling the batch and idle HTTP workers */
+struct ParallelBatch
+{
+    const JSONRPCRequest jreq;
+    const std::vector<UniValue> vReq;
+    std::vector<UniValue> vResults;
+    std::atomic<size_t> nNext{0};
+
+    Mutex cs;
+    std::condition_variable cond GUARDED_BY(cs);
+    size_t nDone GUARDED_BY(cs){0};
+
+    ParallelBatch(const JSONRPCRequest& _jreq, std::vector<UniValue>&& _vReq) :
+        jreq(_jreq), vReq(std::move(_vReq)), vResults(vReq.size())
+    {
+    }
+
+    /** Execute entries until none are left */
+    void Work()
+    {
+        size_t i;
+        while ((i = nNext++) < vReq.size()) {
+            vResults[i] = JSONRPCExecOne(jreq, vReq[i]);
+            LOCK(cs);
+            if (++nDone == vReq.size()) {
+                cond.notify_all();
+            }
+        }
+    }
+
+    void WaitDone()
+    {
+        WAIT_LOCK(cs, lock);
+        while (nDone < vReq.size()) {
+            cond.wait(lock);
+        }
+    }
+};
+
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
 {
+    const size_t nMaxHelpers = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L) - 1;
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        // Consecutive read-only entries are executed in parallel, all other entries in order, so that e.g. a
+        // transaction sent in a batch is visible to the entries after it
+        size_t runEnd = reqIdx;
+        while (runEnd < vReq.size() && IsParallelBatchEntry(vReq[runEnd])) {
+            runEnd++;
+        }
+        if (runEnd - reqIdx < 2 || nMaxHelpers == 0) {
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+            reqIdx++;
+            continue;
+        }
+
+        auto batch = std::make_shared<ParallelBatch>(jreq, std::vector<UniValue>(vReq.getValues().begin() + reqIdx, vReq.getValues().begin() + runEnd));
+        // This thread works on the entries as well, so helpers which can't be queued or don't get to run in time
+        // don't hold up the batch. Helpers which start late find nothing left to do.
+        for (size_t i = 0; i < std::min(runEnd - reqIdx - 1, nMaxHelpers); i++) {
+            if (!HTTPEnqueueWork([batch] { batch->Work(); })) {
+                break;
+            }
+        }
+        batch->Work();
+        batch->WaitDone();
+        for (auto& result : batch->vResults) {
+            ret.push_back(std::move(result));
+        }
+        reqIdx = runEnd;
+    }
 
     return ret.write() + "\n";
 }
@@ -613,14 +824,30 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    RPCLatencyRecorder latencyRecorder(pcmd->name);
     try
     {
+        UniValue result;
+        RPCResultCacheKey cacheKey;
+        if (RPCResultCacheLookup(request, cacheKey, result)) {
+            latencyRecorder.fError = false;
+            return result;
+        }
+
         // Execute, convert arguments to array if necessary
-        if (request.params.isObject()) {
-            return pcmd->actor(transformNamedArguments(request, pcmd->argNames));
+        if (cacheKey.fCacheable) {
+            // cached results must be complete, don't let the RPC stream them
+            JSONRPCRequest requestNoStream = request;
+            requestNoStream.resultWriter = nullptr;
+            result = pcmd->actor(requestNoStream);
+            RPCResultCacheStore(cacheKey, result);
+        } else if (request.params.isObject()) {
+            result = pcmd->actor(transformNamedArguments(request, pcmd->argNames));
         } else {
-            return pcmd->actor(request);
+            result = pcmd->actor(request);
         }
+        latencyRecorder.fError = false;
+        return result;
     }
     catch (const std::exception& e)
     {
@@ -18,6 +18,7 @@
 #include <univalue.h>
 
 class CRPCCommand;
+class JSONStreamWriter;
 
 namespace RPCServer
 {
@@ -44,8 +45,10 @@ public:
     std::string URI;
     std::string authUser;
     std::string peerAddr;
+    /** Set by callers which can send the result while it is produced, see RPCStreamingResult */
+    JSONStreamWriter* resultWriter;
 
-    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
+    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false), resultWriter(nullptr) {}
     void parse(const UniValue& valRequest);
 };
 
@@ -6,6 +6,7 @@
 #include <keystore.h>
 #include <pubkey.h>
 #include <rpc/protocol.h>
+#include <rpc/server.h>
 #include <rpc/util.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
@@ -92,3 +93,126 @@ UniValue DescribeAddress(const CTxDestination& dest)
 {
     return boost::apply_visitor(DescribeAddressVisitor(), dest);
 }
+
+JSONStreamWriter::JSONStreamWriter(Sink _sink, size_t _nFlushSize) : sink(std::move(_sink)), nFlushSize(_nFlushSize)
+{
+}
+
+void JSONStreamWriter::BeforeValue()
+{
+    assert(!fComplete);
+    if (vOpen.empty()) {
+        return;
+    }
+    if (vOpen.back().first == '}') {
+        assert(fAfterKey);
+        fAfterKey = false;
+        return;
+    }
+    if (!vOpen.back().second) {
+        buf += ',';
+    }
+    vOpen.back().second = false;
+}
+
+void JSONStreamWriter::AfterValue()
+{
+    if (vOpen.empty()) {
+        fComplete = true;
+    }
+    if (buf.size() >= nFlushSize) {
+        Flush();
+    }
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    BeforeValue();
+    buf += '[';
+    vOpen.emplace_back(']', true);
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    BeforeValue();
+    buf += '{';
+    vOpen.emplace_back('}', true);
+}
+
+void JSONStreamWriter::End()
+{
+    assert(!vOpen.empty() && !fAfterKey);
+    buf += vOpen.back().first;
+    vOpen.pop_back();
+    AfterValue();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vOpen.empty() && vOpen.back().first == '}' && !fAfterKey);
+    if (!vOpen.back().second) {
+        buf += ',';
+    }
+    vOpen.back().second = false;
+    // let UniValue take care of escaping
+    buf += UniValue(key).write();
+    buf += ':';
+    fAfterKey = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    BeforeValue();
+    buf += value.write();
+    AfterValue();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (!buf.empty()) {
+        sink(buf);
+        buf.clear();
+    }
+}
+
+RPCStreamingResult::RPCStreamingResult(const JSONRPCRequest& request, UniValue::VType type) :
+    writer(request.resultWriter),
+    result(type)
+{
+    assert(type == UniValue::VARR || type == UniValue::VOBJ);
+    if (writer) {
+        if (type == UniValue::VARR) {
+            writer->BeginArray();
+        } else {
+            writer->BeginObject();
+        }
+    }
+}
+
+void RPCStreamingResult::push_back(const UniValue& value)
+{
+    if (writer) {
+        writer->Value(value);
+    } else {
+        result.push_back(value);
+    }
+}
+
+void RPCStreamingResult::pushKV(const std::string& key, const UniValue& value)
+{
+    if (writer) {
+        writer->Key(key);
+        writer->Value(value);
+    } else {
+        result.pushKV(key, value);
+    }
+}
+
+UniValue RPCStreamingResult::Finish()
+{
+    if (writer) {
+        writer->End();
+        return NullUniValue;
+    }
+    return std::move(result);
+}
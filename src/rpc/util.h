@@ -12,12 +12,15 @@
 
 #include <boost/variant/static_visitor.hpp>
 
+#include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
 class CKeyStore;
 class CPubKey;
 class CScript;
+class JSONRPCRequest;
 
 CPubKey HexToPubKey(const std::string& hex_in);
 CPubKey AddrToPubKey(CKeyStore* const keystore, const std::string& addr_in);
@@ -25,4 +28,61 @@ CScript CreateMultisigRedeemscript(const int required, const std::vector<CPubKey
 
 UniValue DescribeAddress(const CTxDestination& dest);
 
+/** Incrementally writes a JSON document. The output is collected in a buffer and handed to the sink whenever the
+ * buffer exceeds nFlushSize, so large documents never exist as a complete UniValue tree or string.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+    static const size_t DEFAULT_FLUSH_SIZE = 1 << 20;
+
+    explicit JSONStreamWriter(Sink _sink, size_t _nFlushSize = DEFAULT_FLUSH_SIZE);
+
+    void BeginArray();
+    void BeginObject();
+    /** Close the innermost array or object */
+    void End();
+    /** Write the key of the next object member */
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    /** Hand all buffered output to the sink */
+    void Flush();
+
+    /** Whether a complete top-level value has been written */
+    bool IsComplete() const { return fComplete; }
+
+private:
+    Sink sink;
+    const size_t nFlushSize;
+    std::string buf;
+    //! closing character and whether no element was written yet, for every open array and object
+    std::vector<std::pair<char, bool>> vOpen;
+    bool fAfterKey{false};
+    bool fComplete{false};
+
+    void BeforeValue();
+    void AfterValue();
+};
+
+/** The result of an RPC which can be streamed element by element. If the caller of the RPC supports it (see
+ * JSONRPCRequest::resultWriter), elements are written to the caller's JSONStreamWriter as they are pushed, otherwise
+ * they are collected into a UniValue as usual. Only use this for the complete result of an RPC. Streamed output is
+ * not sent before the RPC returns, so the RPC may still fail after elements were pushed.
+ */
+class RPCStreamingResult
+{
+public:
+    RPCStreamingResult(const JSONRPCRequest& request, UniValue::VType type);
+
+    void push_back(const UniValue& value);
+    void pushKV(const std::string& key, const UniValue& value);
+    /** Return the result, or null if it was streamed */
+    UniValue Finish();
+
+private:
+    JSONStreamWriter* writer;
+    UniValue result;
+};
+
 #endif // BITCOIN_RPC_UTIL_H
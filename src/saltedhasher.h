@@ -31,6 +31,16 @@ struct SaltedHasherImpl<std::pair<N, uint256>>
     }
 };
 
+template<typename N>
+struct SaltedHasherImpl<std::pair<uint160, N>>
+{
+    static std::size_t CalcHash(const std::pair<uint160, N>& v, uint64_t k0, uint64_t k1)
+    {
+        uint32_t n = (uint32_t) v.second;
+        return CSipHasher(k0, k1).Write(v.first.begin(), v.first.size()).Write((const unsigned char*)&n, sizeof(n)).Finalize();
+    }
+};
+
 template<>
 struct SaltedHasherImpl<uint256>
 {
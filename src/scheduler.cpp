@@ -6,18 +6,27 @@
 
 #include <random.h>
 #include <reverselock.h>
+#include <util/time.h>
 
 #include <assert.h>
 #include <boost/bind.hpp>
 #include <utility>
 
-CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
+//! all currently existing schedulers, for GetAllTaskStats()
+static Mutex g_schedulers_mutex;
+static std::set<const CScheduler*> g_schedulers GUARDED_BY(g_schedulers_mutex);
+
+CScheduler::CScheduler(const std::string& nameIn) : name(nameIn), nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
 {
+    LOCK(g_schedulers_mutex);
+    g_schedulers.emplace(this);
 }
 
 CScheduler::~CScheduler()
 {
     assert(nThreadsServicingQueue == 0);
+    LOCK(g_schedulers_mutex);
+    g_schedulers.erase(this);
 }
 
 
@@ -73,14 +82,58 @@ void CScheduler::serviceQueue()
             if (shouldStop() || taskQueue.empty())
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+            auto it = pickTask(now);
+            if (it == taskQueue.end()) {
+                // All due tasks wait for another task of their concurrency class to finish, which will notify us.
+                // Don't sleep past the next task which isn't due yet though.
+                auto itNext = taskQueue.upper_bound(now);
+                if (itNext == taskQueue.end()) {
+                    newTaskScheduled.wait(lock);
+                } else {
+#if BOOST_VERSION < 105000
+                    newTaskScheduled.timed_wait(lock, toPosixTime(itNext->first));
+#else
+                    newTaskScheduled.wait_until<>(lock, itNext->first);
+#endif
+                }
+                continue;
+            }
 
-            {
+            Task task = std::move(it->second);
+            const int64_t nDelayMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(now - it->first).count();
+            taskQueue.erase(it);
+            const std::string& strClass = task.options.concurrencyClass;
+            if (!strClass.empty()) {
+                setRunningClasses.emplace(strClass);
+            }
+
+            int64_t nStart = GetTimeMicros();
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
+            } catch (...) {
+                if (!strClass.empty()) {
+                    setRunningClasses.erase(strClass);
+                    newTaskScheduled.notify_all();
+                }
+                throw;
+            }
+            int64_t nDuration = GetTimeMicros() - nStart;
+
+            const std::string& strName = task.options.name.empty() ? "unnamed" : task.options.name;
+            SchedulerTaskStats& stats = mapTaskStats[strName];
+            stats.nRuns++;
+            stats.nTotalMicros += nDuration;
+            stats.nMaxMicros = std::max(stats.nMaxMicros, nDuration);
+            stats.nMaxDelayMicros = std::max(stats.nMaxDelayMicros, nDelayMicros);
+
+            if (!strClass.empty()) {
+                setRunningClasses.erase(strClass);
+                // wake up the threads waiting for this concurrency class
+                newTaskScheduled.notify_all();
             }
         } catch (...) {
             --nThreadsServicingQueue;
@@ -91,6 +144,22 @@ void CScheduler::serviceQueue()
     newTaskScheduled.notify_one();
 }
 
+std::multimap<boost::chrono::system_clock::time_point, CScheduler::Task>::iterator CScheduler::pickTask(boost::chrono::system_clock::time_point now)
+{
+    auto itBest = taskQueue.end();
+    for (auto it = taskQueue.begin(); it != taskQueue.end() && it->first <= now; ++it) {
+        const SchedulerTaskOptions& options = it->second.options;
+        if (!options.concurrencyClass.empty() && setRunningClasses.count(options.concurrencyClass)) {
+            continue;
+        }
+        // among tasks of the same priority the one which is due the longest runs first
+        if (itBest == taskQueue.end() || options.priority > itBest->second.options.priority) {
+            itBest = it;
+        }
+    }
+    return itBest;
+}
+
 void CScheduler::stop(bool drain)
 {
     {
@@ -103,29 +172,29 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, const SchedulerTaskOptions& options)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        taskQueue.insert(std::make_pair(t, Task{f, options}));
     }
     newTaskScheduled.notify_one();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds, const SchedulerTaskOptions& options)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds), options);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds, const SchedulerTaskOptions& options)
 {
     f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaMilliSeconds), deltaMilliSeconds);
+    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaMilliSeconds, options), deltaMilliSeconds, options);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds, const SchedulerTaskOptions& options)
 {
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaMilliSeconds), deltaMilliSeconds);
+    scheduleFromNow(boost::bind(&Repeat, this, f, deltaMilliSeconds, options), deltaMilliSeconds, options);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
@@ -145,6 +214,29 @@ bool CScheduler::AreThreadsServicingQueue() const {
     return nThreadsServicingQueue;
 }
 
+std::vector<SchedulerTaskStats> CScheduler::GetTaskStats() const
+{
+    std::vector<SchedulerTaskStats> result;
+    boost::unique_lock<boost::mutex> lock(newTaskMutex);
+    for (const auto& p : mapTaskStats) {
+        result.emplace_back(p.second);
+        result.back().scheduler = name;
+        result.back().name = p.first;
+    }
+    return result;
+}
+
+std::vector<SchedulerTaskStats> CScheduler::GetAllTaskStats()
+{
+    std::vector<SchedulerTaskStats> result;
+    LOCK(g_schedulers_mutex);
+    for (const CScheduler* pscheduler : g_schedulers) {
+        auto stats = pscheduler->GetTaskStats();
+        result.insert(result.end(), stats.begin(), stats.end());
+    }
+    return result;
+}
+
 
 void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
     {
@@ -155,7 +247,7 @@ void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
         if (m_are_callbacks_running) return;
         if (m_callbacks_pending.empty()) return;
     }
-    m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this));
+    m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this), boost::chrono::system_clock::now(), m_options);
 }
 
 void SingleThreadedSchedulerClient::ProcessQueue() {
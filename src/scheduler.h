@@ -13,9 +13,43 @@
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
 #include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <sync.h>
 
+//! Number of threads servicing the main scheduler queue
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+static const int MAX_SCHEDULER_THREADS = 8;
+
+enum class SchedulerPriority {
+    LOW,
+    NORMAL,
+    HIGH,
+};
+
+struct SchedulerTaskOptions
+{
+    //! runtime statistics are recorded per name
+    std::string name;
+    SchedulerPriority priority{SchedulerPriority::NORMAL};
+    //! tasks of the same concurrency class never run at the same time, empty if the task may run concurrently with any other
+    std::string concurrencyClass;
+};
+
+/** Runtime statistics of the tasks of one name */
+struct SchedulerTaskStats
+{
+    std::string scheduler;
+    std::string name;
+    uint64_t nRuns{0};
+    int64_t nTotalMicros{0};
+    int64_t nMaxMicros{0};
+    //! how much later than scheduled the task started at most, because the workers were busy
+    int64_t nMaxDelayMicros{0};
+};
+
 //
 // Simple class for background tasks that should be run
 // periodically or once "after a while"
@@ -33,27 +67,32 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Tasks can be given a name, under which their runtime is recorded, a
+// priority, which decides which of several due tasks runs first, and a
+// concurrency class. Multiple threads may service the queue, but tasks
+// of the same concurrency class never run at the same time.
+//
 
 class CScheduler
 {
 public:
-    CScheduler();
+    explicit CScheduler(const std::string& name = "scheduler");
     ~CScheduler();
 
     typedef std::function<void()> Function;
 
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now());
+    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now(), const SchedulerTaskOptions& options = SchedulerTaskOptions());
 
     // Convenience method: call f once deltaMilliSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaMilliSeconds);
+    void scheduleFromNow(Function f, int64_t deltaMilliSeconds, const SchedulerTaskOptions& options = SchedulerTaskOptions());
 
     // Another convenience method: call f approximately
     // every deltaMilliSeconds forever, starting deltaMilliSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaMilliSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaMilliSeconds);
+    void scheduleEvery(Function f, int64_t deltaMilliSeconds, const SchedulerTaskOptions& options = SchedulerTaskOptions());
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -74,14 +113,31 @@ public:
     // Returns true if there are threads actively running in serviceQueue()
     bool AreThreadsServicingQueue() const;
 
+    // Returns the runtime statistics of the tasks of this scheduler, by task name
+    std::vector<SchedulerTaskStats> GetTaskStats() const;
+    // Returns the runtime statistics of the tasks of all schedulers
+    static std::vector<SchedulerTaskStats> GetAllTaskStats();
+
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task
+    {
+        Function f;
+        SchedulerTaskOptions options;
+    };
+
+    const std::string name;
+    std::multimap<boost::chrono::system_clock::time_point, Task> taskQueue;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
+    //! concurrency classes of the tasks which are running right now
+    std::set<std::string> setRunningClasses;
+    std::map<std::string, SchedulerTaskStats> mapTaskStats;
     bool shouldStop() const { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    //! Pick the due task with the highest priority whose concurrency class isn't running, taskQueue.end() if there is none
+    std::multimap<boost::chrono::system_clock::time_point, Task>::iterator pickTask(boost::chrono::system_clock::time_point now);
 };
 
 /**
@@ -97,6 +153,7 @@ private:
 class SingleThreadedSchedulerClient {
 private:
     CScheduler *m_pscheduler;
+    const SchedulerTaskOptions m_options;
 
     CCriticalSection m_cs_callbacks_pending;
     std::list<std::function<void ()>> m_callbacks_pending GUARDED_BY(m_cs_callbacks_pending);
@@ -106,7 +163,7 @@ private:
     void ProcessQueue();
 
 public:
-    explicit SingleThreadedSchedulerClient(CScheduler *pschedulerIn) : m_pscheduler(pschedulerIn) {}
+    explicit SingleThreadedSchedulerClient(CScheduler *pschedulerIn, const SchedulerTaskOptions& optionsIn = SchedulerTaskOptions()) : m_pscheduler(pschedulerIn), m_options(optionsIn) {}
 
     /**
      * Add a callback to be executed. Callbacks are executed serially
@@ -10,6 +10,7 @@
 #include <crypto/sha256.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <streams.h>
 #include <uint256.h>
 
 typedef std::vector<unsigned char> valtype;
@@ -1404,6 +1405,9 @@ public:
     }
 };
 
+//! Size of an input with a blanked script in the legacy signature hash serialization: prevout, empty script, sequence
+static const size_t LEGACY_BLANKED_INPUT_SIZE = 36 + 1 + 4;
+
 template <class T>
 uint256 GetPrevoutHash(const T& txTo)
 {
@@ -1442,6 +1446,33 @@ PrecomputedTransactionData::PrecomputedTransactionData(const T& txTo)
     hashPrevouts = GetPrevoutHash(txTo);
     hashSequence = GetSequenceHash(txTo);
     hashOutputs = GetOutputsHash(txTo);
+
+    if (txTo.vin.size() < 2) {
+        return;
+    }
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << (int32_t)(txTo.nVersion | (txTo.nType << 16));
+    WriteCompactSize(ss, txTo.vin.size());
+    CVectorWriter blankedInputs(SER_GETHASH, 0, vchLegacyBlankedInputs, 0);
+    vchLegacyBlankedInputs.reserve(txTo.vin.size() * LEGACY_BLANKED_INPUT_SIZE);
+    vecLegacyPrefixes.reserve(txTo.vin.size());
+    for (const auto& txin : txTo.vin) {
+        vecLegacyPrefixes.push_back(ss);
+        blankedInputs << txin.prevout << CScript() << txin.nSequence;
+        ss.write((const char*)vchLegacyBlankedInputs.data() + vchLegacyBlankedInputs.size() - LEGACY_BLANKED_INPUT_SIZE, LEGACY_BLANKED_INPUT_SIZE);
+    }
+    assert(vchLegacyBlankedInputs.size() == txTo.vin.size() * LEGACY_BLANKED_INPUT_SIZE);
+
+    CVectorWriter suffix(SER_GETHASH, 0, vchLegacySuffix, 0);
+    WriteCompactSize(suffix, txTo.vout.size());
+    for (const auto& txout : txTo.vout) {
+        suffix << txout;
+    }
+    suffix << txTo.nLockTime;
+    if (txTo.nVersion == 3 && txTo.nType != TRANSACTION_NORMAL) {
+        suffix << txTo.vExtraPayload;
+    }
+    fLegacyReady = true;
 }
 
 // explicit instantiation
@@ -1466,12 +1497,37 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, nHashType);
 
+    // Unless only some outputs are signed, the serialization only differs between inputs in the signed input. With
+    // SIGHASH_ALL, everything in front of it is the same as for all previous inputs, and everything after it is the
+    // same for all inputs. Hash the same bytes as txTmp would serialize, but take the shared parts from the cache.
+    const bool fAllOutputs = (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE;
+    if (cache && cache->fLegacyReady && fAllOutputs && cache->vecLegacyPrefixes.size() == txTo.vin.size()) {
+        const bool fAnyoneCanPay = !!(nHashType & SIGHASH_ANYONECANPAY);
+        CHashWriter ss = fAnyoneCanPay ? CHashWriter(SER_GETHASH, 0) : cache->vecLegacyPrefixes[nIn];
+        if (fAnyoneCanPay) {
+            ss << (int32_t)(txTo.nVersion | (txTo.nType << 16));
+            WriteCompactSize(ss, 1);
+        }
+        txTmp.SerializeInput(ss, nIn);
+        if (!fAnyoneCanPay) {
+            const size_t nBegin = (nIn + 1) * LEGACY_BLANKED_INPUT_SIZE;
+            ss.write((const char*)cache->vchLegacyBlankedInputs.data() + nBegin, cache->vchLegacyBlankedInputs.size() - nBegin);
+        }
+        ss.write((const char*)cache->vchLegacySuffix.data(), cache->vchLegacySuffix.size());
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
     return ss.GetHash();
 }
 
+// explicit instantiation, SignatureHash is also used outside of the signature checkers
+template uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache);
+template uint256 SignatureHash(const CScript& scriptCode, const CMutableTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache);
+
 template <class T>
 bool GenericTransactionSignatureChecker<T>::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <hash.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
 
@@ -110,6 +111,19 @@ struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs;
 
+    /**
+     * Shared parts of the legacy signature hash serialization, only set up for transactions with multiple inputs.
+     * SIGHASH_ALL resumes from the hasher state after the inputs preceding the signed one, and all hash types which
+     * commit to every output append the serialized outputs instead of serializing them again for every input.
+     */
+    bool fLegacyReady{false};
+    //! Hasher after the version, the input count and the blanked inputs before each input
+    std::vector<CHashWriter> vecLegacyPrefixes;
+    //! All inputs with blanked scripts, as SIGHASH_ALL serializes the inputs which are not signed
+    std::vector<unsigned char> vchLegacyBlankedInputs;
+    //! The output count, outputs, lock time and extra payload
+    std::vector<unsigned char> vchLegacySuffix;
+
     template <class T>
     explicit PrecomputedTransactionData(const T& tx);
 };
@@ -5,7 +5,9 @@
 
 #include <script/sigcache.h>
 
+#include <crypto/siphash.h>
 #include <memusage.h>
+#include <primitives/block.h>
 #include <pubkey.h>
 #include <random.h>
 #include <uint256.h>
@@ -14,6 +16,8 @@
 #include <cuckoocache.h>
 #include <boost/thread.hpp>
 
+#include <limits>
+
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
@@ -86,9 +90,85 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
     signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
     if (signatureCache.Get(entry, !store))
         return true;
-    if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
+    bool fValid = blockPubKeys ? blockPubKeys->Verify(pubkey, sighash, vchSig) : TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash);
+    if (!fValid)
         return false;
     if (store)
         signatureCache.Set(entry);
     return true;
 }
+
+size_t CBlockPubKeys::PubKeyHasher::operator()(const CPubKey& pubkey) const
+{
+    return CSipHasher(k0, k1).Write(pubkey.begin(), pubkey.size()).Finalize();
+}
+
+/** Add the pushes of a script which have the size and header byte of a public key */
+static void AddPushedPubKeys(const CScript& script, std::vector<CPubKey>& vecPubKeys)
+{
+    CScript::const_iterator pc = script.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> vchPush;
+    while (script.GetOp(pc, opcode, vchPush)) {
+        if (CPubKey::ValidSize(vchPush)) {
+            vecPubKeys.emplace_back(vchPush);
+        }
+    }
+}
+
+CBlockPubKeys::CBlockPubKeys(const CBlock& block) :
+    mapSlots(0, PubKeyHasher{GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max())})
+{
+    // Only the scripts of the block itself are looked at, as the coins spent by it are not all known yet. These are
+    // the keys of P2PKH inputs, and of multisig redeem scripts, which are the last push of P2SH inputs.
+    std::vector<CPubKey> vecPubKeys;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+        for (const auto& txin : tx->vin) {
+            AddPushedPubKeys(txin.scriptSig, vecPubKeys);
+
+            CScript::const_iterator pc = txin.scriptSig.begin();
+            opcodetype opcode;
+            std::vector<unsigned char> vchPush, vchLastPush;
+            while (txin.scriptSig.GetOp(pc, opcode, vchPush)) {
+                vchLastPush.swap(vchPush);
+            }
+            if (!vchLastPush.empty() && !CPubKey::ValidSize(vchLastPush)) {
+                AddPushedPubKeys(CScript(vchLastPush.begin(), vchLastPush.end()), vecPubKeys);
+            }
+        }
+    }
+
+    mapSlots.reserve(vecPubKeys.size());
+    for (const auto& pubkey : vecPubKeys) {
+        mapSlots.emplace(pubkey, mapSlots.size());
+    }
+    vecSlots = std::vector<Slot>(mapSlots.size());
+}
+
+bool CBlockPubKeys::Verify(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig) const
+{
+    auto it = mapSlots.find(pubkey);
+    if (it == mapSlots.end()) {
+        return pubkey.Verify(hash, vchSig);
+    }
+    Slot& slot = vecSlots[it->second];
+    uint8_t state = slot.state.load(std::memory_order_acquire);
+    if (state == VALID) {
+        return CPubKey::VerifyParsed(slot.parsed, hash, vchSig);
+    } else if (state == INVALID) {
+        return false;
+    }
+
+    // Not parsed yet, or another check is parsing it right now. Don't wait for it, but parse it here as well.
+    CPubKey::Parsed parsed;
+    bool fValid = pubkey.Parse(parsed);
+    uint8_t expected = UNPARSED;
+    if (slot.state.compare_exchange_strong(expected, PARSING, std::memory_order_acquire)) {
+        slot.parsed = parsed;
+        slot.state.store(fValid ? VALID : INVALID, std::memory_order_release);
+    }
+    return fValid && CPubKey::VerifyParsed(parsed, hash, vchSig);
+}
@@ -6,8 +6,11 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <pubkey.h>
 #include <script/interpreter.h>
 
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -17,7 +20,7 @@ static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
-class CPubKey;
+class CBlock;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -40,13 +43,51 @@ public:
     }
 };
 
+/**
+ * The public keys pushed by the inputs of a block, collected before its script checks are queued. Each distinct key
+ * is parsed (and for compressed keys, decompressed) by the first script check which verifies against it, all other
+ * checks using the same key verify against the parsed key. The set of keys doesn't change once the checks run, so
+ * they can look up keys without locking.
+ */
+class CBlockPubKeys
+{
+private:
+    enum : uint8_t {
+        UNPARSED,
+        PARSING,
+        VALID,
+        INVALID,
+    };
+    struct Slot {
+        std::atomic<uint8_t> state{UNPARSED};
+        CPubKey::Parsed parsed;
+    };
+    struct PubKeyHasher {
+        uint64_t k0, k1;
+        size_t operator()(const CPubKey& pubkey) const;
+    };
+
+    std::unordered_map<CPubKey, size_t, PubKeyHasher> mapSlots;
+    //! Parsed keys, indexed by the values of mapSlots
+    mutable std::vector<Slot> vecSlots;
+
+public:
+    explicit CBlockPubKeys(const CBlock& block);
+
+    size_t size() const { return vecSlots.size(); }
+
+    /** Same as pubkey.Verify(hash, vchSig), but parses the key at most once if it's one of the block's keys */
+    bool Verify(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig) const;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    const CBlockPubKeys* blockPubKeys;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amount, PrecomputedTransactionData& txdataIn, bool storeIn=true) : TransactionSignatureChecker(txToIn, nInIn, amount, txdataIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amount, PrecomputedTransactionData& txdataIn, bool storeIn=true, const CBlockPubKeys* blockPubKeysIn=nullptr) : TransactionSignatureChecker(txToIn, nInIn, amount, txdataIn), store(storeIn), blockPubKeys(blockPubKeysIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
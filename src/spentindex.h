@@ -8,6 +8,7 @@
 
 #include <uint256.h>
 #include <amount.h>
+#include <saltedhasher.h>
 #include <script/script.h>
 #include <serialize.h>
 
@@ -34,6 +35,18 @@ struct CSpentIndexKey {
         outputIndex = 0;
     }
 
+    friend bool operator==(const CSpentIndexKey& a, const CSpentIndexKey& b) {
+        return a.txid == b.txid && a.outputIndex == b.outputIndex;
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CSpentIndexKey>
+{
+    static std::size_t CalcHash(const CSpentIndexKey& v, uint64_t k0, uint64_t k1)
+    {
+        return SipHashUint256Extra(k0, k1, v.txid, v.outputIndex);
+    }
 };
 
 struct CSpentIndexValue {
@@ -227,6 +240,25 @@ struct CAddressUnspentValue {
     }
 };
 
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+
+    SERIALIZE_METHODS(CAddressBalanceValue, obj)
+    {
+        READWRITE(obj.balance, obj.received);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+    }
+};
+
 struct CAddressIndexKey {
     unsigned int type;
     uint160 hashBytes;
@@ -7,9 +7,11 @@
 #include <chainparams.h>
 #include <key_io.h>
 #include <validation.h>
+#include <memusage.h>
 #include <messagesigner.h>
 #include <net_processing.h>
 #include <netmessagemaker.h>
+#include <util/memaccounting.h>
 
 #include <string>
 
@@ -34,6 +36,22 @@ CSporkManager::CSporkManager()
         sporkDefsById.emplace(sporkDef.sporkId, &sporkDef);
         sporkDefsByName.emplace(sporkDef.name, &sporkDef);
     }
+    memaccounting::Register("spork", this, [this]() {
+        LOCK(cs);
+        size_t nUsage = memusage::DynamicUsage(mapSporksByHash) + memusage::DynamicUsage(mapSporksActive);
+        size_t nMessages = mapSporksByHash.size();
+        for (const auto& p : mapSporksActive) {
+            nUsage += memusage::DynamicUsage(p.second);
+            nMessages += p.second.size();
+        }
+        // each message holds a compact signature
+        return nUsage + nMessages * memusage::MallocUsage(CPubKey::COMPACT_SIGNATURE_SIZE);
+    });
+}
+
+CSporkManager::~CSporkManager()
+{
+    memaccounting::Unregister(this);
 }
 
 bool CSporkManager::SporkValueIsActive(SporkId nSporkID, int64_t &nActiveValueRet) const
@@ -141,6 +159,16 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             return;
         }
 
+        {
+            LOCK(cs); // make sure to not lock this together with cs_main
+            // The hash covers the signature too, so this is the exact message we verified and accepted already.
+            // Peers relay sporks to each other all the time, don't recover the signer's key again for these.
+            if (mapSporksByHash.count(hash)) {
+                LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
+                return;
+            }
+        }
+
         CKeyID keyIDSigner;
 
         if (!spork.GetSignerKeyID(keyIDSigner) || !setSporkPubKeyIDs.count(keyIDSigner)) {
@@ -170,6 +170,7 @@ private:
 public:
 
     CSporkManager();
+    ~CSporkManager();
 
     template<typename Stream>
     void Serialize(Stream &s) const
@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <random.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 
@@ -72,8 +73,58 @@ struct _StatsdClientData {
     bool    init;
 
     char    errmsg[1024];
+
+    Mutex cs_aggregates;
+    std::map<std::string, int64_t> mapCounts GUARDED_BY(cs_aggregates);
+    std::map<std::string, Histogram> mapHistograms GUARDED_BY(cs_aggregates);
 };
 
+uint32_t Histogram::BucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    int exponent = 63;
+    while (!(value >> exponent)) {
+        exponent--;
+    }
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Histogram::BucketLowerBound(uint32_t index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    return (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS);
+}
+
+void Histogram::Add(uint64_t value)
+{
+    mapBuckets[BucketIndex(value)]++;
+    nCount++;
+    nSum += value;
+    nMax = std::max(nMax, value);
+}
+
+uint64_t Histogram::Percentile(double percentile) const
+{
+    if (nCount == 0) {
+        return 0;
+    }
+    // rank of the value, starting at 1
+    uint64_t nRank = std::max<uint64_t>(1, (uint64_t)std::ceil(percentile / 100.0 * nCount));
+    uint64_t nSeen = 0;
+    for (const auto& p : mapBuckets) {
+        nSeen += p.second;
+        if (nSeen >= nRank) {
+            return BucketLowerBound(p.first);
+        }
+    }
+    return BucketLowerBound(mapBuckets.rbegin()->first);
+}
+
 StatsdClient::StatsdClient(const std::string& host, int port, const std::string& ns)
 {
     d = new _StatsdClientData;
@@ -98,10 +149,15 @@ void StatsdClient::config(const std::string& host, int port, const std::string&
     CloseSocket(d->sock);
 }
 
-int StatsdClient::init()
+bool StatsdClient::enabled()
 {
     static bool fEnabled = gArgs.GetBoolArg("-statsenabled", DEFAULT_STATSD_ENABLE);
-    if (!fEnabled) return -3;
+    return fEnabled;
+}
+
+int StatsdClient::init()
+{
+    if (!enabled()) return -3;
 
     if ( d->init ) return 0;
 
@@ -131,6 +187,16 @@ int StatsdClient::init()
     return 0;
 }
 
+std::string StatsdClient::fullKey(std::string key)
+{
+    // partition stats by node name if set
+    if (!d->nodename.empty())
+        key = key + "." + d->nodename;
+
+    cleanup(key);
+    return d->ns + key;
+}
+
 /* will change the original string */
 void StatsdClient::cleanup(std::string& key)
 {
@@ -172,6 +238,74 @@ int StatsdClient::timing(const std::string& key, size_t ms, float sample_rate)
     return send(key, ms, "ms", sample_rate);
 }
 
+void StatsdClient::aggregateCount(const std::string& key, int64_t value)
+{
+    if (!enabled()) {
+        return;
+    }
+    LOCK(d->cs_aggregates);
+    d->mapCounts[key] += value;
+}
+
+void StatsdClient::histogram(const std::string& key, uint64_t value)
+{
+    if (!enabled()) {
+        return;
+    }
+    LOCK(d->cs_aggregates);
+    d->mapHistograms[key].Add(value);
+}
+
+int StatsdClient::flush()
+{
+    std::map<std::string, int64_t> mapCounts;
+    std::map<std::string, Histogram> mapHistograms;
+    {
+        LOCK(d->cs_aggregates);
+        mapCounts.swap(d->mapCounts);
+        mapHistograms.swap(d->mapHistograms);
+    }
+    if (mapCounts.empty() && mapHistograms.empty()) {
+        return 0;
+    }
+    // make sure the namespace and node name are known before the keys are built
+    int ret = init();
+    if (ret) {
+        return ret;
+    }
+
+    std::vector<std::string> vecLines;
+    for (const auto& p : mapCounts) {
+        vecLines.emplace_back(strprintf("%s:%d|c", fullKey(p.first), p.second));
+    }
+    for (const auto& p : mapHistograms) {
+        const Histogram& h = p.second;
+        vecLines.emplace_back(strprintf("%s:%u|c", fullKey(p.first + ".count"), h.Count()));
+        vecLines.emplace_back(strprintf("%s:%f|g", fullKey(p.first + ".mean"), (double)h.Sum() / h.Count()));
+        vecLines.emplace_back(strprintf("%s:%u|g", fullKey(p.first + ".p50"), h.Percentile(50)));
+        vecLines.emplace_back(strprintf("%s:%u|g", fullKey(p.first + ".p90"), h.Percentile(90)));
+        vecLines.emplace_back(strprintf("%s:%u|g", fullKey(p.first + ".p99"), h.Percentile(99)));
+        vecLines.emplace_back(strprintf("%s:%u|g", fullKey(p.first + ".max"), h.Max()));
+    }
+
+    // statsd accepts multiple metrics per packet, separated by newlines
+    std::string packet;
+    for (const std::string& line : vecLines) {
+        if (!packet.empty() && packet.size() + 1 + line.size() > STATSD_MAX_PACKET_SIZE) {
+            ret = std::min(ret, send(packet));
+            packet.clear();
+        }
+        if (!packet.empty()) {
+            packet += '\n';
+        }
+        packet += line;
+    }
+    if (!packet.empty()) {
+        ret = std::min(ret, send(packet));
+    }
+    return ret;
+}
+
 int StatsdClient::send(std::string key, size_t value, const std::string& type, float sample_rate)
 {
     if (!should_send(sample_rate)) {
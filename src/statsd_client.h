@@ -1,6 +1,8 @@
 #ifndef BITCOIN_STATSD_CLIENT_H
 #define BITCOIN_STATSD_CLIENT_H
 
+#include <cstdint>
+#include <map>
 #include <string>
 
 static const bool DEFAULT_STATSD_ENABLE = false;
@@ -13,9 +15,43 @@ static const std::string DEFAULT_STATSD_NAMESPACE = "";
 static const int DEFAULT_STATSD_PERIOD = 60;
 static const int MIN_STATSD_PERIOD = 5;
 static const int MAX_STATSD_PERIOD = 60 * 60;
+// locally aggregated counters and histograms are sent every 10 seconds
+static const int STATSD_FLUSH_INTERVAL = 10;
+// maximum size of a batched packet, fits into the usual MTU
+static const size_t STATSD_MAX_PACKET_SIZE = 1432;
 
 namespace statsd {
 
+/**
+ * Log-linear histogram in the style of HdrHistogram. Values below 16 are
+ * counted exactly, larger ones in 16 buckets per power of two, so the
+ * reported percentiles are off by at most 1/16 of the value.
+ */
+class Histogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+    void Add(uint64_t value);
+    //! Returns the lower bound of the bucket containing the given percentile (0 to 100)
+    uint64_t Percentile(double percentile) const;
+
+    uint64_t Count() const { return nCount; }
+    uint64_t Sum() const { return nSum; }
+    uint64_t Max() const { return nMax; }
+
+    static uint32_t BucketIndex(uint64_t value);
+    static uint64_t BucketLowerBound(uint32_t index);
+
+private:
+    //! only the used buckets, usually a few dozen
+    std::map<uint32_t, uint64_t> mapBuckets;
+    uint64_t nCount{0};
+    uint64_t nSum{0};
+    uint64_t nMax{0};
+};
+
 struct _StatsdClientData;
 
 class StatsdClient {
@@ -36,6 +72,20 @@ class StatsdClient {
         int gaugeDouble(const std::string& key, double value, float sample_rate = 1.0);
         int timing(const std::string& key, size_t ms, float sample_rate = 1.0);
 
+        //! Allows to skip building keys and values which would not be sent anyway
+        bool enabled();
+
+    public:
+        /**
+         * Aggregated locally and only sent by flush(), so these are cheap
+         * enough for hot paths. Histograms are sent as count, mean, p50, p90,
+         * p99 and max gauges below the key.
+         */
+        void aggregateCount(const std::string& key, int64_t value);
+        void histogram(const std::string& key, uint64_t value);
+        //! Send all aggregated values in batched packets and reset them
+        int flush();
+
     public:
         /**
          * (Low Level Api) manually send a message
@@ -54,6 +104,8 @@ class StatsdClient {
     protected:
         int init();
         static void cleanup(std::string& key);
+        //! Apply the namespace and node name to a key
+        std::string fullKey(std::string key);
 
     protected:
         struct _StatsdClientData* d;
@@ -290,7 +290,7 @@ size_t PosixLockedPageAllocator::GetLimit()
 // Implementation: LockedPool
 
 LockedPool::LockedPool(std::unique_ptr<LockedPageAllocator> allocator_in, LockingFailed_Callback lf_cb_in):
-    allocator(std::move(allocator_in)), lf_cb(lf_cb_in), cumulative_bytes_locked(0)
+    allocator(std::move(allocator_in)), lf_cb(lf_cb_in), cumulative_bytes_locked(0), cumulative_bytes_unlocked(0)
 {
 }
 
@@ -305,6 +305,56 @@ void* LockedPool::alloc(size_t size)
     if (size == 0 || size > ARENA_SIZE)
         return nullptr;
 
+    if (size <= SLAB_MAX_CHUNK) {
+        return alloc_from_slab(size);
+    }
+    return alloc_chunk(size);
+}
+
+void LockedPool::free(void *ptr)
+{
+    // Freeing the nullptr pointer is OK.
+    if (ptr == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Slab* slab = find_slab(ptr);
+    if (slab) {
+        free_to_slab(*slab, ptr);
+    } else {
+        free_chunk(ptr);
+    }
+}
+
+LockedPool::Stats LockedPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    LockedPool::Stats r{0, 0, 0, cumulative_bytes_locked, 0, 0, cumulative_bytes_unlocked, arenas.size(), slabs.size(), 0, 0};
+    for (const auto &arena: arenas) {
+        Arena::Stats i = arena.stats();
+        r.used += i.used;
+        r.free += i.free;
+        r.total += i.total;
+        r.chunks_used += i.chunks_used;
+        r.chunks_free += i.chunks_free;
+    }
+    // A slab is a single used chunk of its arena, count its chunks instead
+    for (const auto& p : slabs) {
+        const Slab& slab = p.second;
+        size_t free_bytes = slab.free_chunks.size() * slab.chunk_size + SLAB_SIZE % slab.chunk_size;
+        r.used -= free_bytes;
+        r.free += free_bytes;
+        r.chunks_used += slab.chunks_used;
+        r.chunks_used--;
+        r.slab_chunks_used += slab.chunks_used;
+        r.slab_chunks_free += slab.free_chunks.size();
+    }
+    return r;
+}
+
+void* LockedPool::alloc_chunk(size_t size)
+{
     // Try allocating from each current arena
     for (auto &arena: arenas) {
         void *addr = arena.alloc(size);
@@ -313,15 +363,14 @@ void* LockedPool::alloc(size_t size)
         }
     }
     // If that fails, create a new one
-    if (new_arena(ARENA_SIZE, ARENA_ALIGN)) {
+    if (new_arena(ARENA_SIZE, ARENA_ALIGN, size)) {
         return arenas.back().alloc(size);
     }
     return nullptr;
 }
 
-void LockedPool::free(void *ptr)
+void LockedPool::free_chunk(void* ptr)
 {
-    std::lock_guard<std::mutex> lock(mutex);
     // TODO we can do better than this linear search by keeping a map of arena
     // extents to arena, and looking up the address.
     for (auto &arena: arenas) {
@@ -333,33 +382,95 @@ void LockedPool::free(void *ptr)
     throw std::runtime_error("LockedPool: invalid address not pointing to any arena");
 }
 
-LockedPool::Stats LockedPool::stats() const
+void* LockedPool::alloc_from_slab(size_t size)
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    LockedPool::Stats r{0, 0, 0, cumulative_bytes_locked, 0, 0};
-    for (const auto &arena: arenas) {
-        Arena::Stats i = arena.stats();
-        r.used += i.used;
-        r.free += i.free;
-        r.total += i.total;
-        r.chunks_used += i.chunks_used;
-        r.chunks_free += i.chunks_free;
+    size_t chunk_size = align_up(size, ARENA_ALIGN);
+    auto& available = slabs_available[chunk_size / ARENA_ALIGN - 1];
+    if (available.empty()) {
+        char* base = static_cast<char*>(alloc_chunk(SLAB_SIZE));
+        if (!base) {
+            // There might still be room for the allocation itself
+            return alloc_chunk(size);
+        }
+        Slab& slab = slabs[base];
+        slab.base = base;
+        slab.chunk_size = chunk_size;
+        size_t count = SLAB_SIZE / chunk_size;
+        slab.free_chunks.reserve(count);
+        // Hand out the chunks from the start of the slab
+        for (size_t i = count; i > 0; i--) {
+            slab.free_chunks.emplace_back(base + (i - 1) * chunk_size);
+        }
+        available.emplace(base);
     }
-    return r;
+
+    // Prefer the slab with the lowest address, so that the others can drain and be released
+    Slab& slab = slabs.at(*available.begin());
+    char* ptr = slab.free_chunks.back();
+    slab.free_chunks.pop_back();
+    slab.used.set((ptr - slab.base) / ARENA_ALIGN);
+    slab.chunks_used++;
+    if (slab.free_chunks.empty()) {
+        available.erase(slab.base);
+    }
+    return ptr;
+}
+
+LockedPool::Slab* LockedPool::find_slab(void* ptr)
+{
+    auto it = slabs.upper_bound(static_cast<char*>(ptr));
+    if (it == slabs.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (static_cast<char*>(ptr) >= it->first + SLAB_SIZE) {
+        return nullptr;
+    }
+    return &it->second;
 }
 
-bool LockedPool::new_arena(size_t size, size_t align)
+void LockedPool::free_to_slab(Slab& slab, void* ptr)
+{
+    size_t offset = static_cast<char*>(ptr) - slab.base;
+    size_t index = offset / ARENA_ALIGN;
+    if (offset % slab.chunk_size != 0 || !slab.used.test(index)) {
+        throw std::runtime_error("LockedPool: invalid or double free");
+    }
+    slab.used.reset(index);
+    slab.free_chunks.emplace_back(static_cast<char*>(ptr));
+    slab.chunks_used--;
+
+    auto& available = slabs_available[slab.chunk_size / ARENA_ALIGN - 1];
+    available.emplace(slab.base);
+    // Release empty slabs to their arena, but keep the last one with free chunks of its size around, so that
+    // allocating and freeing a single key doesn't create and release a slab every time
+    if (slab.chunks_used == 0 && available.size() > 1) {
+        char* base = slab.base;
+        available.erase(base);
+        slabs.erase(base);
+        free_chunk(base);
+    }
+}
+
+bool LockedPool::new_arena(size_t size, size_t align, size_t min_size)
 {
     bool locked;
+    size_t limit = allocator->GetLimit();
     // If this is the first arena, handle this specially: Cap the upper size
     // by the process limit. This makes sure that the first arena will at least
     // be locked. An exception to this is if the process limit is 0:
     // in this case no memory can be locked at all so we'll skip past this logic.
     if (arenas.empty()) {
-        size_t limit = allocator->GetLimit();
         if (limit > 0) {
             size = std::min(size, limit);
         }
+    } else if (limit > cumulative_bytes_locked && limit - cumulative_bytes_locked < size) {
+        // Use up what's left of the limit in a smaller arena before falling back to memory that can't be locked,
+        // as long as the allocation still fits into it
+        size_t remaining = limit - cumulative_bytes_locked;
+        if (remaining >= min_size) {
+            size = remaining;
+        }
     }
     void *addr = allocator->AllocateLocked(size, &locked);
     if (!addr) {
@@ -373,6 +484,9 @@ bool LockedPool::new_arena(size_t size, size_t align)
             return false;
         }
     }
+    if (!locked) {
+        cumulative_bytes_unlocked += size;
+    }
     arenas.emplace_back(allocator.get(), addr, size, align);
     return true;
 }
@@ -6,11 +6,15 @@
 #define BITCOIN_SUPPORT_LOCKEDPOOL_H
 
 #include <stdint.h>
+#include <array>
+#include <bitset>
 #include <list>
 #include <map>
 #include <mutex>
 #include <memory>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 /**
  * OS-dependent allocation and deallocation of locked/pinned memory pages.
@@ -137,6 +141,16 @@ public:
      */
     static const size_t ARENA_ALIGN = 16;
 
+    /** Allocations up to this size are served from slabs of equally sized chunks. Most secrets are small and of
+     * a few fixed sizes (32-byte private keys, BLS secret key shares and their limbs), so keeping them in slabs
+     * avoids scattering many tiny chunks over the arenas, which fragments them and slows down best-fit
+     * allocation.
+     */
+    static const size_t SLAB_MAX_CHUNK = 64;
+    /** Size of one slab. A slab is allocated from an arena as a single chunk.
+     */
+    static const size_t SLAB_SIZE = 4096;
+
     /** Callback when allocation succeeds but locking fails.
      */
     typedef bool (*LockingFailed_Callback)();
@@ -150,6 +164,11 @@ public:
         size_t locked;
         size_t chunks_used;
         size_t chunks_free;
+        size_t unlocked;
+        size_t arenas;
+        size_t slabs;
+        size_t slab_chunks_used;
+        size_t slab_chunks_free;
     };
 
     /** Create a new LockedPool. This takes ownership of the MemoryPageLocker,
@@ -194,11 +213,33 @@ private:
         LockedPageAllocator *allocator;
     };
 
-    bool new_arena(size_t size, size_t align);
+    /** A chunk of an arena which is split into chunks of a single size */
+    struct Slab
+    {
+        char* base;
+        size_t chunk_size;
+        size_t chunks_used{0};
+        std::vector<char*> free_chunks;
+        std::bitset<SLAB_SIZE / ARENA_ALIGN> used;
+    };
+
+    bool new_arena(size_t size, size_t align, size_t min_size);
+    /** Allocate from the arenas, creating a new one if necessary */
+    void* alloc_chunk(size_t size);
+    void free_chunk(void* ptr);
+    void* alloc_from_slab(size_t size);
+    /** Return the slab ptr was allocated from, or nullptr if it wasn't allocated from a slab */
+    Slab* find_slab(void* ptr);
+    void free_to_slab(Slab& slab, void* ptr);
 
     std::list<LockedPageArena> arenas;
     LockingFailed_Callback lf_cb;
     size_t cumulative_bytes_locked;
+    size_t cumulative_bytes_unlocked;
+    /** All slabs by their base address */
+    std::map<char*, Slab> slabs;
+    /** Base addresses of the slabs with free chunks, for each chunk size */
+    std::array<std::set<char*>, SLAB_MAX_CHUNK / ARENA_ALIGN> slabs_available;
     /** Mutex protects access to this pool's data structures, including arenas.
      */
     mutable std::mutex mutex;
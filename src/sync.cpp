@@ -11,10 +11,149 @@
 
 #include <stdio.h>
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
 
+std::atomic<bool> g_lock_stats_enabled{DEFAULT_LOCK_STATS};
+
+/**
+ * Call sites are identified by the lock name and file name pointers and the
+ * line, which are string literals and constants. LOCK2 takes two locks on the
+ * same line, so the line alone is not enough. The slots are claimed lock-free, so that
+ * recording never takes another lock.
+ */
+struct LockSiteStats
+{
+    std::atomic<uint64_t> key{0};
+    std::atomic<bool> ready{false};
+    const char* pszName{nullptr};
+    const char* pszFile{nullptr};
+    int nLine{0};
+
+    std::atomic<uint64_t> nContentions{0};
+    std::atomic<uint64_t> nWaitMicros{0};
+    std::atomic<uint64_t> nMaxWaitMicros{0};
+    std::atomic<uint64_t> nHoldSamples{0};
+    std::atomic<uint64_t> nHoldMicros{0};
+    std::atomic<uint64_t> nMaxHoldMicros{0};
+};
+
+static const size_t LOCK_STATS_SITES = 4096;
+static LockSiteStats g_lock_sites[LOCK_STATS_SITES];
+
+/** Returns site if it belongs to the call site, or nullptr (with fContinue set) if it belongs to another one */
+static LockSiteStats* MatchLockSite(LockSiteStats& site, const char* pszName, const char* pszFile, int nLine, bool& fContinue)
+{
+    fContinue = false;
+    if (!site.ready.load(std::memory_order_acquire)) {
+        // the claiming thread may still be filling in the call site, don't record this acquisition
+        return nullptr;
+    }
+    if (site.pszName == pszName && site.pszFile == pszFile && site.nLine == nLine) {
+        return &site;
+    }
+    // same hash, different call site
+    fContinue = true;
+    return nullptr;
+}
+
+LockSiteStats* GetLockSite(const char* pszName, const char* pszFile, int nLine)
+{
+    // 0 marks a free slot
+    uint64_t key = ((uint64_t)(uintptr_t)pszFile * 0x9E3779B97F4A7C15ULL) ^
+                   ((uint64_t)(uintptr_t)pszName * 0xC2B2AE3D27D4EB4FULL) ^ (uint64_t)nLine;
+    if (key == 0) key = 1;
+    bool fContinue;
+    for (size_t i = 0; i < LOCK_STATS_SITES; i++) {
+        LockSiteStats& site = g_lock_sites[(key + i) % LOCK_STATS_SITES];
+        uint64_t siteKey = site.key.load(std::memory_order_acquire);
+        if (siteKey == 0) {
+            if (site.key.compare_exchange_strong(siteKey, key)) {
+                site.pszName = pszName;
+                site.pszFile = pszFile;
+                site.nLine = nLine;
+                site.ready.store(true, std::memory_order_release);
+                return &site;
+            }
+        }
+        if (siteKey == key) {
+            LockSiteStats* pSite = MatchLockSite(site, pszName, pszFile, nLine, fContinue);
+            if (!fContinue) {
+                return pSite;
+            }
+        }
+    }
+    return nullptr;
+}
+
+static void UpdateMax(std::atomic<uint64_t>& max, uint64_t value)
+{
+    uint64_t prev = max.load(std::memory_order_relaxed);
+    while (value > prev && !max.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+}
+
+void RecordLockWait(LockSiteStats* site, int64_t nMicros)
+{
+    site->nContentions.fetch_add(1, std::memory_order_relaxed);
+    site->nWaitMicros.fetch_add(nMicros, std::memory_order_relaxed);
+    UpdateMax(site->nMaxWaitMicros, nMicros);
+}
+
+void RecordLockHold(LockSiteStats* site, int64_t nMicros)
+{
+    site->nHoldSamples.fetch_add(1, std::memory_order_relaxed);
+    site->nHoldMicros.fetch_add(nMicros, std::memory_order_relaxed);
+    UpdateMax(site->nMaxHoldMicros, nMicros);
+}
+
+bool SampleLockHold()
+{
+    static thread_local uint32_t nAcquisitions = 0;
+    return ++nAcquisitions % LOCK_STATS_HOLD_SAMPLE_RATE == 0;
+}
+
+int64_t LockStatsMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<LockSiteStatsEntry> GetLockSiteStats()
+{
+    std::vector<LockSiteStatsEntry> result;
+    for (const LockSiteStats& site : g_lock_sites) {
+        if (!site.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+        LockSiteStatsEntry entry;
+        entry.name = site.pszName;
+        entry.file = site.pszFile;
+        entry.line = site.nLine;
+        entry.nContentions = site.nContentions.load(std::memory_order_relaxed);
+        entry.nWaitMicros = site.nWaitMicros.load(std::memory_order_relaxed);
+        entry.nMaxWaitMicros = site.nMaxWaitMicros.load(std::memory_order_relaxed);
+        entry.nHoldSamples = site.nHoldSamples.load(std::memory_order_relaxed);
+        entry.nHoldMicros = site.nHoldMicros.load(std::memory_order_relaxed);
+        entry.nMaxHoldMicros = site.nMaxHoldMicros.load(std::memory_order_relaxed);
+        result.emplace_back(std::move(entry));
+    }
+    return result;
+}
+
+void ResetLockSiteStats()
+{
+    // the call sites stay claimed, only the counters are reset
+    for (LockSiteStats& site : g_lock_sites) {
+        site.nContentions = 0;
+        site.nWaitMicros = 0;
+        site.nMaxWaitMicros = 0;
+        site.nHoldSamples = 0;
+        site.nHoldMicros = 0;
+        site.nMaxHoldMicros = 0;
+    }
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 #if !defined(HAVE_THREAD_LOCAL)
 static_assert(false, "thread_local is not supported");
@@ -9,10 +9,13 @@
 #include <threadsafety.h>
 #include <util/macros.h>
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 /////////////////////////////////////////////////
 //                                             //
@@ -122,14 +125,73 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Lock contention profiling, enabled by -lockstats. Every contended
+ * acquisition records the time spent waiting at its call site, and one in
+ * LOCK_STATS_HOLD_SAMPLE_RATE acquisitions records how long the lock was held.
+ * When disabled, this costs a relaxed atomic load per lock.
+ */
+static const bool DEFAULT_LOCK_STATS = false;
+static const int LOCK_STATS_HOLD_SAMPLE_RATE = 64;
+
+extern std::atomic<bool> g_lock_stats_enabled;
+
+struct LockSiteStats;
+
+/** Statistics of one call site, as returned by GetLockSiteStats() */
+struct LockSiteStatsEntry
+{
+    std::string name;
+    std::string file;
+    int line{0};
+    uint64_t nContentions{0};
+    uint64_t nWaitMicros{0};
+    uint64_t nMaxWaitMicros{0};
+    uint64_t nHoldSamples{0};
+    uint64_t nHoldMicros{0};
+    uint64_t nMaxHoldMicros{0};
+};
+
+//! Returns the statistics slot of a call site, nullptr if all slots are taken
+LockSiteStats* GetLockSite(const char* pszName, const char* pszFile, int nLine);
+void RecordLockWait(LockSiteStats* site, int64_t nMicros);
+void RecordLockHold(LockSiteStats* site, int64_t nMicros);
+//! Whether the current acquisition should sample the hold time
+bool SampleLockHold();
+int64_t LockStatsMicros();
+std::vector<LockSiteStatsEntry> GetLockSiteStats();
+void ResetLockSiteStats();
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
 {
 private:
+    //! Call site and start of the hold time, if it's sampled
+    LockSiteStats* m_lock_site{nullptr};
+    int64_t m_hold_start{0};
+
+    void EnterWithStats(const char* pszName, const char* pszFile, int nLine)
+    {
+        LockSiteStats* site = GetLockSite(pszName, pszFile, nLine);
+        if (!Base::try_lock()) {
+            int64_t nWaitStart = LockStatsMicros();
+            Base::lock();
+            if (site) RecordLockWait(site, LockStatsMicros() - nWaitStart);
+        }
+        if (site && SampleLockHold()) {
+            m_lock_site = site;
+            m_hold_start = LockStatsMicros();
+        }
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
+        if (g_lock_stats_enabled.load(std::memory_order_relaxed)) {
+            EnterWithStats(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!Base::try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -171,8 +233,11 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            // the hold time includes the time the lock was temporarily released, e.g. while waiting on a condition variable
+            if (m_lock_site) RecordLockHold(m_lock_site, LockStatsMicros() - m_hold_start);
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -727,6 +727,48 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_new_bucket)
 
 }
 
+static void CheckASMapLookup(const std::vector<bool>& bits, const uint8_t (&ip)[16])
+{
+    std::vector<bool> ip_bits(128);
+    for (int i = 0; i < 128; ++i) {
+        ip_bits[i] = (ip[i / 8] >> (7 - i % 8)) & 1;
+    }
+    BOOST_CHECK_EQUAL(ASMap(bits).Lookup(ip), Interpret(bits, ip_bits));
+}
+
+BOOST_AUTO_TEST_CASE(addrman_asmap_compiled)
+{
+    std::vector<bool> bits = FromBytes(raw_tests::asmap, sizeof(raw_tests::asmap) * 8);
+    ASMap asmap(bits);
+    BOOST_CHECK(asmap.IsCompiled());
+
+    uint8_t ip[16];
+    for (int i = 0; i < 1000; i++) {
+        // half of them IPv4-in-IPv6 addresses
+        for (int j = 0; j < 16; j++) {
+            ip[j] = InsecureRandBits(8);
+        }
+        if (i % 2 == 0) {
+            memcpy(ip, IPV4_IN_IPV6_PREFIX.data(), IPV4_IN_IPV6_PREFIX.size());
+        }
+        CheckASMapLookup(bits, ip);
+    }
+
+    // the compiled trie must give the same results as Interpret for truncated and garbage asmaps too
+    for (int i = 0; i < 200; i++) {
+        std::vector<bool> garbage(i % 2 ? InsecureRandRange(bits.size()) : 1 + InsecureRandRange(2000));
+        for (size_t j = 0; j < garbage.size(); j++) {
+            garbage[j] = i % 2 ? bits[j] : InsecureRandBool();
+        }
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 16; k++) {
+                ip[k] = InsecureRandBits(8);
+            }
+            CheckASMapLookup(garbage, ip);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(addrman_serialization)
 {
     std::vector<bool> asmap1 = FromBytes(raw_tests::asmap, sizeof(raw_tests::asmap) * 8);
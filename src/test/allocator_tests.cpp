@@ -8,6 +8,8 @@
 #include <test/test_dash.h>
 
 #include <memory>
+#include <set>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -206,6 +208,94 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_mock)
     BOOST_CHECK(pool.stats().used == 0);
 }
 
+BOOST_AUTO_TEST_CASE(lockedpool_tests_slabs)
+{
+    std::unique_ptr<LockedPageAllocator> x = MakeUnique<TestLockedPageAllocator>(1, 1);
+    LockedPool pool(std::move(x));
+
+    // Small allocations are packed into slabs
+    const size_t count = 300;
+    const size_t per_slab = LockedPool::SLAB_SIZE / 32;
+    std::vector<void*> ptrs;
+    for (size_t i = 0; i < count; i++) {
+        void* ptr = pool.alloc(32);
+        BOOST_CHECK(ptr);
+        ptrs.push_back(ptr);
+    }
+    BOOST_CHECK(std::set<void*>(ptrs.begin(), ptrs.end()).size() == count);
+    LockedPool::Stats stats = pool.stats();
+    BOOST_CHECK(stats.slabs == (count + per_slab - 1) / per_slab);
+    BOOST_CHECK(stats.slab_chunks_used == count);
+    BOOST_CHECK(stats.used == count * 32);
+    BOOST_CHECK(stats.used + stats.free == stats.total);
+    BOOST_CHECK(stats.chunks_used == count);
+
+    // Other sizes get their own slabs
+    void* b0 = pool.alloc(40);
+    BOOST_CHECK(b0);
+    BOOST_CHECK(pool.stats().slabs == stats.slabs + 1);
+    BOOST_CHECK(pool.stats().used == count * 32 + 48);
+    pool.free(b0);
+
+    pool.free(ptrs[0]);
+    BOOST_CHECK_THROW(pool.free(ptrs[0]), std::runtime_error);
+    BOOST_CHECK_THROW(pool.free(static_cast<char*>(ptrs[1]) + 16), std::runtime_error);
+    for (size_t i = 1; i < count; i++) {
+        pool.free(ptrs[i]);
+    }
+
+    // Empty slabs are released, except for one of each size
+    stats = pool.stats();
+    BOOST_CHECK(stats.slabs == 2);
+    BOOST_CHECK(stats.slab_chunks_used == 0);
+    BOOST_CHECK(stats.used == 0);
+    BOOST_CHECK(stats.chunks_used == 0);
+}
+
+/** Mock LockedPageAllocator with a limit on locked memory */
+class LimitedLockedPageAllocator: public TestLockedPageAllocator
+{
+public:
+    LimitedLockedPageAllocator(int count_in, int lockedcount_in, size_t limit_in): TestLockedPageAllocator(count_in, lockedcount_in), limit(limit_in) {}
+    size_t GetLimit() override
+    {
+        return limit;
+    }
+private:
+    size_t limit;
+};
+
+BOOST_AUTO_TEST_CASE(lockedpool_tests_growth)
+{
+    const size_t limit = LockedPool::ARENA_SIZE + LockedPool::ARENA_SIZE / 4;
+    std::unique_ptr<LockedPageAllocator> x = MakeUnique<LimitedLockedPageAllocator>(3, 2, limit);
+    LockedPool pool(std::move(x));
+
+    void* a0 = pool.alloc(LockedPool::ARENA_SIZE);
+    BOOST_CHECK(a0);
+    BOOST_CHECK(pool.stats().locked == LockedPool::ARENA_SIZE);
+
+    // The second arena only takes what's left of the limit
+    void* a1 = pool.alloc(LockedPool::ARENA_SIZE / 8);
+    BOOST_CHECK(a1);
+    BOOST_CHECK(pool.stats().arenas == 2);
+    BOOST_CHECK(pool.stats().locked == limit);
+    BOOST_CHECK(pool.stats().total == limit);
+    BOOST_CHECK(pool.stats().unlocked == 0);
+
+    // Anything beyond can't be locked anymore
+    void* a2 = pool.alloc(LockedPool::ARENA_SIZE / 2);
+    BOOST_CHECK(a2);
+    BOOST_CHECK(pool.stats().arenas == 3);
+    BOOST_CHECK(pool.stats().locked == limit);
+    BOOST_CHECK(pool.stats().unlocked == LockedPool::ARENA_SIZE);
+
+    pool.free(a0);
+    pool.free(a1);
+    pool.free(a2);
+    BOOST_CHECK(pool.stats().used == 0);
+}
+
 // These tests used the live LockedPoolManager object, this is also used
 // by other tests so the conditions are somewhat less controllable and thus the
 // tests are somewhat more error-prone.
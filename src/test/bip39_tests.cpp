@@ -24,6 +24,8 @@ BOOST_FIXTURE_TEST_SUITE(bip39_tests, BasicTestingSetup)
 BOOST_AUTO_TEST_CASE(bip39_vectors)
 {
     UniValue tests = read_json(std::string(json_tests::bip39_vectors, json_tests::bip39_vectors + sizeof(json_tests::bip39_vectors)));
+    std::vector<std::pair<SecureString, SecureString>> vecMnemonics;
+    std::vector<std::string> vecExpectedSeeds;
 
     for (unsigned int i = 0; i < tests.size(); i++) {
         // printf("%d\n", i);
@@ -51,6 +53,8 @@ BOOST_AUTO_TEST_CASE(bip39_vectors)
         CMnemonic::ToSeed(mnemonic, passphrase, seed);
         // printf("seed: %s\n", HexStr(seed).c_str());
         BOOST_CHECK(HexStr(seed) == test[2].get_str());
+        vecMnemonics.emplace_back(mnemonic, passphrase);
+        vecExpectedSeeds.emplace_back(test[2].get_str());
 
         CExtKey key;
         CExtPubKey pubkey;
@@ -61,6 +65,16 @@ BOOST_AUTO_TEST_CASE(bip39_vectors)
         // printf("CBitcoinExtKey: %s\n", EncodeExtKey(key).c_str());
         BOOST_CHECK(EncodeExtKey(key) == test[3].get_str());
     }
+
+    // the batch derivation must yield the same seeds, in the same order
+    for (int nThreads : {1, 3, 0}) {
+        std::vector<SecureVector> vecSeeds;
+        CMnemonic::ToSeeds(vecMnemonics, vecSeeds, nThreads);
+        BOOST_REQUIRE_EQUAL(vecSeeds.size(), vecExpectedSeeds.size());
+        for (size_t i = 0; i < vecSeeds.size(); i++) {
+            BOOST_CHECK_EQUAL(HexStr(vecSeeds[i]), vecExpectedSeeds[i]);
+        }
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
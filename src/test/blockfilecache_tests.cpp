@@ -0,0 +1,81 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilecache.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <streams.h>
+#include <test/test_dash.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockfilecache_tests)
+
+BOOST_FIXTURE_TEST_CASE(blockfilecache_read, TestChain100Setup)
+{
+    for (const CBlockIndex* pindex = WITH_LOCK(cs_main, return chainActive.Tip()); pindex; pindex = pindex->pprev) {
+        // The first read decodes the block, the second one is served from the decoded blocks
+        for (int i = 0; i < 2; i++) {
+            CBlock block;
+            BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+            BOOST_CHECK(block.GetHash() == pindex->GetBlockHash());
+
+            std::vector<unsigned char> raw;
+            BOOST_REQUIRE(ReadRawBlockFromDisk(raw, pindex, Params().MessageStart()));
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << block;
+            BOOST_CHECK(raw == std::vector<unsigned char>(ss.begin(), ss.end()));
+        }
+
+        CBlockFileCache::MappedFilePtr file;
+        Span<const unsigned char> data;
+        CDiskBlockPos pos = WITH_LOCK(cs_main, return pindex->GetBlockPos());
+        BOOST_REQUIRE(blockFileCache.GetRawBlock(pos, Params().MessageStart(), file, data));
+        CBlock block;
+        SpanReader(SER_DISK, CLIENT_VERSION, data) >> block;
+        BOOST_CHECK(block.GetHash() == pindex->GetBlockHash());
+
+        // A position which isn't the start of a block is rejected
+        pos.nPos += 1;
+        BOOST_CHECK(!blockFileCache.GetRawBlock(pos, Params().MessageStart(), file, data));
+    }
+
+    // Blocks which are appended after the file was mapped can be read as well
+    const CBlockIndex* pindexOldTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CreateAndProcessBlock({}, scriptPubKey);
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    BOOST_REQUIRE(pindexTip != pindexOldTip);
+    std::vector<unsigned char> raw;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw, pindexTip, Params().MessageStart()));
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pindexTip, Params().GetConsensus()));
+    BOOST_CHECK(block.GetHash() == pindexTip->GetBlockHash());
+
+    blockFileCache.Clear();
+    BOOST_CHECK(ReadBlockFromDisk(block, pindexTip, Params().GetConsensus()));
+
+    // Decoded blocks are shared with the cache instead of being copied
+    std::shared_ptr<const CBlock> pblock1, pblock2;
+    BOOST_CHECK(ReadBlockFromDisk(pblock1, pindexTip, Params().GetConsensus()));
+    BOOST_CHECK(ReadBlockFromDisk(pblock2, pindexTip, Params().GetConsensus()));
+    BOOST_CHECK(pblock1 && pblock1 == pblock2);
+    BOOST_CHECK(pblock1->GetHash() == pindexTip->GetBlockHash());
+}
+
+BOOST_AUTO_TEST_CASE(span_reader)
+{
+    std::vector<unsigned char> data{1, 2, 3, 4, 5};
+    SpanReader reader(SER_NETWORK, PROTOCOL_VERSION, data);
+    uint8_t a;
+    uint32_t b;
+    reader >> a >> b;
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(b, 0x05040302U);
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK_THROW(reader >> a, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
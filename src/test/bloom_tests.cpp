@@ -559,6 +559,48 @@ static std::vector<unsigned char> RandomData()
     return std::vector<unsigned char>(r.begin(), r.end());
 }
 
+BOOST_AUTO_TEST_CASE(merkle_block_bloom_elements)
+{
+    CBlock block = getBlock13b8a();
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+    std::vector<unsigned char> vBlock(stream.begin(), stream.end());
+
+    CBlockBloomElements elements(vBlock);
+    BOOST_CHECK(elements.block.GetHash() == block.GetHash());
+    BOOST_REQUIRE_EQUAL(elements.vTxRanges.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        CDataStream txStream(SER_NETWORK, PROTOCOL_VERSION);
+        txStream << *block.vtx[i];
+        const auto& range = elements.vTxRanges[i];
+        BOOST_CHECK(std::vector<unsigned char>(vBlock.begin() + range.first, vBlock.begin() + range.first + range.second) == std::vector<unsigned char>(txStream.begin(), txStream.end()));
+    }
+
+    // Matching with the extracted elements must give the same results and filter updates as matching the block
+    for (unsigned char nFlags : {BLOOM_UPDATE_NONE, BLOOM_UPDATE_ALL, BLOOM_UPDATE_P2PUBKEY_ONLY}) {
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = *block.vtx[i];
+            CBloomFilter filter(10, 0.000001, 0, nFlags);
+            // an output script element, which leads to matching the spending tx if the filter is updated
+            CScript::const_iterator pc = tx.vout[0].scriptPubKey.begin();
+            opcodetype opcode;
+            std::vector<unsigned char> vElement;
+            while (tx.vout[0].scriptPubKey.GetOp(pc, opcode, vElement) && vElement.empty()) {}
+            filter.insert(vElement);
+            filter.insert(block.vtx[(i + 2) % block.vtx.size()]->GetHash());
+
+            CBloomFilter filter2 = filter;
+            CMerkleBlock merkleBlock(block, filter);
+            CMerkleBlock merkleBlock2(elements, filter2);
+            BOOST_CHECK(merkleBlock.vMatchedTxn == merkleBlock2.vMatchedTxn);
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION), ss2(SER_NETWORK, PROTOCOL_VERSION);
+            ss << merkleBlock << filter;
+            ss2 << merkleBlock2 << filter2;
+            BOOST_CHECK(ss.str() == ss2.str());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(rolling_bloom)
 {
     SeedInsecureRand(/* deterministic */ true);
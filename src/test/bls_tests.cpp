@@ -4,6 +4,10 @@
 
 #include <bls/bls.h>
 #include <bls/bls_batchverifier.h>
+#include <bls/bls_sigcache.h>
+#include <evo/providertx.h>
+#include <llmq/quorums_commitment.h>
+#include <llmq/quorums_utils.h>
 #include <random.h>
 #include <test/test_dash.h>
 
@@ -47,6 +51,39 @@ BOOST_AUTO_TEST_CASE(bls_sig_tests)
     BOOST_CHECK(sig2.VerifyInsecure(sk2.GetPublicKey(), msgHash1));
 }
 
+BOOST_AUTO_TEST_CASE(bls_lazy_serialize_tests)
+{
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    auto sig = sk.Sign(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
+
+    CBLSLazySignature lazySig;
+    lazySig.Set(sig);
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << lazySig;
+    BOOST_CHECK_EQUAL(ds.size(), CBLSSignature::SerSize);
+
+    // the bytes are kept until the object is needed and then decoded
+    CDataStream ds2(ds);
+    CBLSLazySignature lazySig2;
+    ds2 >> lazySig2;
+    BOOST_CHECK(lazySig2 == lazySig);
+    BOOST_CHECK(lazySig2.GetHash() == lazySig.GetHash());
+    BOOST_CHECK(lazySig2.Get() == sig);
+
+    // the same bytes unserialized into a non-lazy object
+    CBLSSignature sig2;
+    ds >> sig2;
+    BOOST_CHECK(sig2 == sig);
+
+    // a default constructed lazy object serializes as all zeros and decodes into an invalid object
+    CDataStream ds3(SER_NETWORK, PROTOCOL_VERSION);
+    ds3 << CBLSLazySignature();
+    CBLSLazySignature lazySig3;
+    ds3 >> lazySig3;
+    BOOST_CHECK(!lazySig3.Get().IsValid());
+}
+
 BOOST_AUTO_TEST_CASE(bls_key_agg_tests)
 {
     CBLSSecretKey sk1, sk2;
@@ -309,6 +346,123 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     // last message invalid from one source
     AddMessage(msgs, 1, 7, 1, false);
     Verify(msgs);
+
+    msgs.clear();
+    // many sources with only a few bad messages spread between them, which requires multiple bisection steps
+    for (uint32_t i = 0; i < 64; i++) {
+        AddMessage(msgs, i / 4, i, i, i != 13 && i != 14 && i != 50);
+    }
+    Verify(msgs);
+}
+
+BOOST_AUTO_TEST_CASE(bls_sigcache_tests)
+{
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    CBLSPublicKey pk = sk.GetPublicKey();
+    uint256 msgHash = GetRandHash();
+    CBLSSignature sig = sk.Sign(msgHash);
+
+    CBLSSecretKey sk2;
+    sk2.MakeNewKey();
+    CBLSSignature badSig = sk2.Sign(msgHash);
+
+    BOOST_CHECK(!CBLSSigCacheEntry(pk, msgHash, sig).IsCached());
+    BOOST_CHECK(VerifyBLSSigCached(sig, pk, msgHash));
+    BOOST_CHECK(CBLSSigCacheEntry(pk, msgHash, sig).IsCached());
+
+    // invalid signatures are never cached
+    BOOST_CHECK(!VerifyBLSSigCached(badSig, pk, msgHash));
+    BOOST_CHECK(!CBLSSigCacheEntry(pk, msgHash, badSig).IsCached());
+
+    // the entry covers the message and the key
+    BOOST_CHECK(!CBLSSigCacheEntry(pk, GetRandHash(), sig).IsCached());
+    BOOST_CHECK(!CBLSSigCacheEntry(sk2.GetPublicKey(), msgHash, sig).IsCached());
+}
+
+BOOST_AUTO_TEST_CASE(bls_cancelling_sigs_tests)
+{
+    // Two valid signatures, one tweaked by +delta and the other by -delta. Both are invalid, but their plain aggregate
+    // is the same as the aggregate of the untweaked signatures.
+    std::vector<CBLSSecretKey> sks(2);
+    std::vector<CBLSPublicKey> pks;
+    std::vector<uint256> hashes;
+    std::vector<CBLSSignature> sigs;
+    for (auto& sk : sks) {
+        sk.MakeNewKey();
+        pks.emplace_back(sk.GetPublicKey());
+        hashes.emplace_back(GetRandHash());
+        sigs.emplace_back(sk.Sign(hashes.back()));
+    }
+    CBLSSecretKey skDelta;
+    skDelta.MakeNewKey();
+    CBLSSignature delta = skDelta.Sign(GetRandHash());
+    std::vector<CBLSSignature> tweaked = sigs;
+    tweaked[0].AggregateInsecure(delta);
+    tweaked[1].SubInsecure(delta);
+
+    BOOST_CHECK(!tweaked[0].VerifyInsecure(pks[0], hashes[0]));
+    BOOST_CHECK(!tweaked[1].VerifyInsecure(pks[1], hashes[1]));
+    BOOST_CHECK(CBLSSignature::AggregateInsecure(tweaked).VerifyInsecureAggregated(pks, hashes));
+
+    // the random weights of a batch keep the errors from cancelling out
+    BOOST_CHECK(!CBLSSignature::VerifyBatch(tweaked, pks, hashes));
+    BOOST_CHECK(CBLSSignature::VerifyBatch(sigs, pks, hashes));
+    // also when both signatures are of the same message
+    std::vector<uint256> sameHashes(2, hashes[0]);
+    std::vector<CBLSSignature> sameSigs{sks[0].Sign(hashes[0]), sks[1].Sign(hashes[0])};
+    BOOST_CHECK(CBLSSignature::VerifyBatch(sameSigs, pks, sameHashes));
+    sameSigs[0].AggregateInsecure(delta);
+    sameSigs[1].SubInsecure(delta);
+    BOOST_CHECK(!CBLSSignature::VerifyBatch(sameSigs, pks, sameHashes));
+
+    // operator signatures of ProUpServTx and ProUpRevTx
+    std::vector<CProTxOperatorSig> operatorSigs;
+    for (size_t i = 0; i < sks.size(); i++) {
+        operatorSigs.emplace_back(CProTxOperatorSig{hashes[i], tweaked[i], pks[i]});
+    }
+    std::vector<bool> vValid;
+    BOOST_CHECK(!VerifyProTxOperatorSigs(operatorSigs, vValid));
+    BOOST_CHECK(vValid == std::vector<bool>(2, false));
+    for (size_t i = 0; i < sks.size(); i++) {
+        BOOST_CHECK(!CBLSSigCacheEntry(pks[i], hashes[i], tweaked[i]).IsCached());
+        operatorSigs[i].sig = sigs[i];
+    }
+    BOOST_CHECK(VerifyProTxOperatorSigs(operatorSigs, vValid));
+    BOOST_CHECK(vValid == std::vector<bool>(2, true));
+
+    // quorum signatures of final commitments
+    std::vector<llmq::CFinalCommitment> qcs(2);
+    std::vector<uint256> commitmentHashes;
+    std::vector<CBLSSignature> quorumSigs;
+    for (size_t i = 0; i < qcs.size(); i++) {
+        auto& qc = qcs[i];
+        qc.llmqType = Consensus::LLMQ_TEST;
+        qc.quorumHash = GetRandHash();
+        qc.quorumPublicKey = pks[i];
+        qc.quorumVvecHash = GetRandHash();
+        commitmentHashes.emplace_back(llmq::CLLMQUtils::BuildCommitmentHash(qc.llmqType, qc.quorumHash, qc.validMembers, qc.quorumPublicKey, qc.quorumVvecHash));
+        qc.quorumSig = sks[i].Sign(commitmentHashes.back());
+        BOOST_CHECK(qc.VerifyQuorumSig());
+    }
+    qcs[0].quorumSig.AggregateInsecure(delta);
+    qcs[1].quorumSig.SubInsecure(delta);
+    for (const auto& qc : qcs) {
+        quorumSigs.emplace_back(qc.quorumSig);
+        BOOST_CHECK(!qc.VerifyQuorumSig());
+    }
+    BOOST_CHECK(CBLSSignature::AggregateInsecure(quorumSigs).VerifyInsecureAggregated(pks, commitmentHashes));
+    std::vector<const llmq::CFinalCommitment*> qcPtrs{&qcs[0], &qcs[1]};
+    BOOST_CHECK(!llmq::CFinalCommitment::VerifyQuorumSigs(qcPtrs, vValid));
+    BOOST_CHECK(vValid == std::vector<bool>(2, false));
+
+    // a single invalid commitment is found without failing the valid one
+    qcs[0].quorumSig = sks[0].Sign(commitmentHashes[0]);
+    BOOST_CHECK(!llmq::CFinalCommitment::VerifyQuorumSigs(qcPtrs, vValid));
+    BOOST_CHECK(vValid[0] && !vValid[1]);
+    qcs[1].quorumSig = sks[1].Sign(commitmentHashes[1]);
+    BOOST_CHECK(llmq::CFinalCommitment::VerifyQuorumSigs(qcPtrs, vValid));
+    BOOST_CHECK(vValid == std::vector<bool>(2, true));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
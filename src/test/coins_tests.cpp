@@ -8,6 +8,7 @@
 #include <undo.h>
 #include <util/strencodings.h>
 #include <test/test_dash.h>
+#include <txdb.h>
 #include <validation.h>
 #include <consensus/validation.h>
 
@@ -52,7 +53,7 @@ public:
 
     uint256 GetBestBlock() const override { return hashBestBlock_; }
 
-    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase = true) override
     {
         for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
             if (it->second.flags & CCoinsCacheEntry::DIRTY) {
@@ -63,7 +64,7 @@ public:
                     map_.erase(it->first);
                 }
             }
-            mapCoins.erase(it++);
+            it = erase ? mapCoins.erase(it) : std::next(it);
         }
         if (!hashBlock.IsNull())
             hashBestBlock_ = hashBlock;
@@ -591,7 +592,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     view.BatchWrite(map, {});
 }
@@ -860,4 +862,99 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    COutPoint outpoint1(InsecureRand256(), 0);
+    COutPoint outpoint2(InsecureRand256(), 0);
+    Coin coin1;
+    SetCoinsValue(VALUE1, coin1);
+    Coin coin2;
+    SetCoinsValue(VALUE2, coin2);
+    cache.AddCoin(outpoint1, std::move(coin1), false);
+    cache.AddCoin(outpoint2, std::move(coin2), false);
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+
+    // spend one coin and sync, the other one must stay cached as a clean entry
+    CCoinsViewCacheTest cache2(&base);
+    BOOST_CHECK(!cache2.AccessCoin(outpoint1).IsSpent());
+    BOOST_CHECK(cache2.SpendCoin(outpoint2));
+    cache2.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache2.Sync());
+    cache2.SelfTest();
+
+    BOOST_CHECK_EQUAL(cache2.GetCacheSize(), 1U);
+    BOOST_CHECK(cache2.HaveCoinInCache(outpoint1));
+    BOOST_CHECK_EQUAL(cache2.map().at(outpoint1).flags, 0);
+    BOOST_CHECK(!cache2.HaveCoinInCache(outpoint2));
+    Coin coin;
+    BOOST_CHECK(!base.GetCoin(outpoint2, coin) || coin.IsSpent());
+    BOOST_CHECK(base.GetCoin(outpoint1, coin) && !coin.IsSpent());
+    BOOST_CHECK(base.GetBestBlock() == cache2.GetBestBlock());
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_partitioned_cursors)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    std::map<COutPoint, CAmount> expected;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 300; i++) {
+            uint256 txid = InsecureRand256();
+            int nOutputs = 1 + InsecureRandRange(3);
+            for (int n = 0; n < nOutputs; n++) {
+                CAmount nValue = 1 + InsecureRandRange(MAX_MONEY);
+                cache.AddCoin(COutPoint(txid, n), Coin(CTxOut(nValue, CScript() << OP_TRUE), 1, false), false);
+                expected.emplace(COutPoint(txid, n), nValue);
+            }
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+    uint256 hashBestBlock = db.GetBestBlock();
+
+    for (int nParts : {1, 7, 256}) {
+        auto cursors = db.PartitionedCursors(nParts);
+        BOOST_CHECK_EQUAL(cursors.size(), (size_t)nParts);
+
+        // Changes after the cursors were created aren't visible to them
+        {
+            CCoinsViewCache cache(&db);
+            cache.AddCoin(COutPoint(InsecureRand256(), 0), Coin(CTxOut(1, CScript() << OP_TRUE), 1, false), false);
+            cache.SetBestBlock(InsecureRand256());
+            BOOST_CHECK(cache.Flush());
+        }
+
+        std::map<COutPoint, CAmount> found;
+        std::map<uint256, size_t> txPart;
+        for (size_t i = 0; i < cursors.size(); i++) {
+            BOOST_CHECK(cursors[i]->GetBestBlock() == hashBestBlock);
+            for (; cursors[i]->Valid(); cursors[i]->Next()) {
+                COutPoint key;
+                Coin coin;
+                BOOST_CHECK(cursors[i]->GetKey(key));
+                BOOST_CHECK(cursors[i]->GetValue(coin));
+                BOOST_CHECK(found.emplace(key, coin.out.nValue).second);
+                // all outputs of a transaction are in the same part
+                BOOST_CHECK_EQUAL(txPart.emplace(key.hash, i).first->second, i);
+            }
+        }
+        BOOST_CHECK(found == expected);
+
+        // Update what's expected for the next round
+        std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+        expected.clear();
+        for (; cursor->Valid(); cursor->Next()) {
+            COutPoint key;
+            Coin coin;
+            BOOST_CHECK(cursor->GetKey(key) && cursor->GetValue(coin));
+            expected.emplace(key, coin.out.nValue);
+        }
+        hashBestBlock = db.GetBestBlock();
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
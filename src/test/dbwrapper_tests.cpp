@@ -159,6 +159,29 @@ BOOST_AUTO_TEST_CASE(dbwrapper_batch)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_erase_range)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_erase_range"));
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+
+    // big endian, so that the serialized keys are ordered
+    for (uint32_t i = 0; i < 100; i++) {
+        dbw.Write(std::make_pair('t', htobe32(i)), i);
+    }
+    dbw.Write('u', (uint32_t)0);
+
+    BOOST_CHECK_EQUAL(dbw.EraseRange(std::make_pair('t', htobe32(10)), std::make_pair('t', htobe32(50))), 40);
+
+    uint32_t res;
+    for (uint32_t i = 0; i < 100; i++) {
+        BOOST_CHECK_EQUAL(dbw.Read(std::make_pair('t', htobe32(i)), res), i < 10 || i >= 50);
+    }
+
+    // everything left with the 't' prefix
+    BOOST_CHECK_EQUAL(dbw.EraseRange(std::make_pair('t', (uint32_t)0), std::make_pair('t', (uint32_t)0xffffffff)), 60);
+    BOOST_CHECK(dbw.Read('u', res));
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 {
     // Perform tests both obfuscated and non-obfuscated.
@@ -199,6 +222,206 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_transaction)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_compact_transaction"));
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    typedef CDBCompactTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    CDBBatch batch(dbw);
+    RootTransaction rootTx(dbw, batch);
+    CDBTransaction<RootTransaction, RootTransaction> curTx(rootTx, rootTx);
+
+    uint256 in = InsecureRand256();
+    uint256 in2 = InsecureRand256();
+    uint256 in3 = InsecureRand256();
+    uint256 res;
+    BOOST_CHECK(dbw.Write('a', in));
+    BOOST_CHECK(dbw.Write('b', in));
+
+    // writes of the same key are combined
+    rootTx.Write('c', in);
+    rootTx.Write('c', in2);
+    rootTx.Erase('a');
+    BOOST_CHECK_EQUAL(rootTx.GetWritesCount(), 2U);
+    BOOST_CHECK(rootTx.GetMemoryUsage() > 0);
+    BOOST_CHECK(rootTx.Read('c', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+    BOOST_CHECK(!rootTx.Exists('a'));
+    BOOST_CHECK(rootTx.Read('b', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+
+    // commit a nested transaction into it
+    curTx.Write('d', in3);
+    curTx.Erase('c');
+    curTx.Commit();
+    BOOST_CHECK(!rootTx.Exists('c'));
+    BOOST_CHECK(rootTx.Read('d', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in3.ToString());
+
+    // iteration merges the overlay with the DB
+    std::vector<char> keys;
+    auto it = curTx.NewIteratorUniquePtr();
+    for (it->Seek('a'); it->Valid(); it->Next()) {
+        char key;
+        BOOST_CHECK(it->GetKey(key));
+        keys.emplace_back(key);
+    }
+    BOOST_CHECK(keys == std::vector<char>({'b', 'd'}));
+
+    rootTx.Commit();
+    BOOST_CHECK(rootTx.IsClean());
+    BOOST_CHECK_EQUAL(rootTx.GetMemoryUsage(), 0U);
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK(!dbw.Exists('a'));
+    BOOST_CHECK(!dbw.Exists('c'));
+    BOOST_CHECK(dbw.Read('d', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in3.ToString());
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_transaction_iterator)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_transaction_iterator"));
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    typedef CDBCompactTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    CDBBatch batch(dbw);
+    RootTransaction rootTx(dbw, batch);
+    CDBTransaction<RootTransaction, RootTransaction> curTx(rootTx, rootTx);
+
+    // random deletes and overwrites on both transaction levels, checked against a plain map
+    std::map<uint32_t, uint32_t> expected;
+    for (uint32_t i = 0; i < 1000; i++) {
+        BOOST_CHECK(dbw.Write(std::make_pair('k', htobe32(i)), i));
+        expected[i] = i;
+    }
+    for (int i = 0; i < 500; i++) {
+        uint32_t key = InsecureRandRange(1200);
+        if (InsecureRandBool()) {
+            rootTx.Erase(std::make_pair('k', htobe32(key)));
+            expected.erase(key);
+        } else {
+            rootTx.Write(std::make_pair('k', htobe32(key)), key + 1);
+            expected[key] = key + 1;
+        }
+    }
+    for (int i = 0; i < 500; i++) {
+        uint32_t key = InsecureRandRange(1200);
+        if (InsecureRandBool()) {
+            curTx.Erase(std::make_pair('k', htobe32(key)));
+            expected.erase(key);
+        } else {
+            curTx.Write(std::make_pair('k', htobe32(key)), key + 2);
+            expected[key] = key + 2;
+        }
+    }
+
+    for (uint32_t seek : {0U, 1U, 500U, 999U, 1100U}) {
+        auto it = curTx.NewIteratorUniquePtr();
+        it->Seek(std::make_pair('k', htobe32(seek)));
+        auto expectedIt = expected.lower_bound(seek);
+        for (; it->Valid(); it->Next(), ++expectedIt) {
+            std::pair<char, uint32_t> key;
+            uint32_t value;
+            BOOST_REQUIRE(expectedIt != expected.end());
+            BOOST_CHECK(it->GetKey(key));
+            BOOST_CHECK(it->GetValue(value));
+            BOOST_CHECK_EQUAL(be32toh(key.second), expectedIt->first);
+            BOOST_CHECK_EQUAL(value, expectedIt->second);
+        }
+        BOOST_CHECK(expectedIt == expected.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_transaction_read_cache)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_compact_transaction_read_cache"));
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    typedef CDBCompactTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    CDBBatch batch(dbw);
+    RootTransaction rootTx(dbw, batch, 1 << 20);
+
+    uint256 in = InsecureRand256();
+    uint256 in2 = InsecureRand256();
+    uint256 res;
+    uint32_t res32;
+    BOOST_CHECK(dbw.Write('a', in));
+
+    // the first read fills the cache
+    BOOST_CHECK_EQUAL(rootTx.GetReadCacheMemoryUsage(), 0U);
+    BOOST_CHECK(rootTx.Read('a', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    BOOST_CHECK(rootTx.GetReadCacheMemoryUsage() > 0);
+
+    // reading with another type is a miss and does not return the cached value
+    BOOST_CHECK(rootTx.Read('a', res32));
+    BOOST_CHECK_EQUAL(res32, ReadLE32(in.begin()));
+
+    // writes and erases invalidate the cached value
+    rootTx.Write('a', in2);
+    BOOST_CHECK(rootTx.Read('a', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+    rootTx.Erase('a');
+    BOOST_CHECK(!rootTx.Read('a', res));
+
+    // committing keeps the cache valid, clearing drops it
+    rootTx.Write('b', in);
+    BOOST_CHECK(rootTx.Read('b', res));
+    rootTx.Commit();
+    BOOST_CHECK(rootTx.GetReadCacheMemoryUsage() > 0);
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK(rootTx.Read('b', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    rootTx.Clear();
+    BOOST_CHECK_EQUAL(rootTx.GetReadCacheMemoryUsage(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_tuning)
+{
+    DBTuning tuning;
+    std::string strError;
+
+    BOOST_CHECK(GetDBTuning("chainstate", tuning, strError));
+    BOOST_CHECK_EQUAL(tuning.nBloomBits, 10);
+    BOOST_CHECK_EQUAL(tuning.nBlockCachePercent, 50);
+
+    gArgs.ForceSetArg("-dbtune", "llmq:profile=rangescan,bloombits=0");
+    BOOST_CHECK(CheckDBTuneArgs(strError));
+    BOOST_CHECK(GetDBTuning("llmq", tuning, strError));
+    BOOST_CHECK_EQUAL(tuning.nBloomBits, 0);
+    BOOST_CHECK_EQUAL(tuning.nBlockSize, 64U * 1024);
+    BOOST_CHECK_EQUAL(tuning.nWriteBufferPercent, 30);
+    // other databases are not affected
+    BOOST_CHECK(GetDBTuning("chainstate", tuning, strError));
+    BOOST_CHECK_EQUAL(tuning.nBlockSize, 4096U);
+
+    // a database opened with a tuning still works
+    {
+        fs::path ph = SetDataDir(std::string("llmq"));
+        CDBWrapper dbw(ph, (1 << 20), true, false, true);
+        uint256 in = InsecureRand256();
+        uint256 res;
+        BOOST_CHECK(dbw.Write('k', in));
+        BOOST_CHECK(dbw.Read('k', res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+
+        DBStats stats = dbw.GetStats();
+        BOOST_CHECK_EQUAL(stats.name, "llmq");
+        BOOST_CHECK_EQUAL(stats.tuning.nBlockSize, 64U * 1024);
+    }
+
+    gArgs.ForceSetArg("-dbtune", "llmq:blockcache=80");
+    BOOST_CHECK(!CheckDBTuneArgs(strError));
+    gArgs.ForceSetArg("-dbtune", "llmq:profile=unknown");
+    BOOST_CHECK(!CheckDBTuneArgs(strError));
+    gArgs.ForceSetArg("-dbtune", "llmq");
+    BOOST_CHECK(!CheckDBTuneArgs(strError));
+    // LevelDB is built without snappy, so compression can't be tuned
+    gArgs.ForceSetArg("-dbtune", "llmq:compression=1");
+    BOOST_CHECK(!CheckDBTuneArgs(strError));
+
+    gArgs.ForceSetArg("-dbtune", "");
+    BOOST_CHECK(CheckDBTuneArgs(strError));
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
@@ -305,6 +305,20 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
         BOOST_ASSERT(chainActive.Height() == nHeight + 1);
         BOOST_ASSERT(deterministicMNManager->GetListAtChainTip().HasMN(tx.GetHash()));
 
+        // unique properties are found by the ProTx values as well as by the (lazy) values of the MN state
+        auto mnList = deterministicMNManager->GetListAtChainTip();
+        auto dmn = mnList.GetMN(tx.GetHash());
+        CProRegTx proTx;
+        BOOST_ASSERT(GetTxPayload(tx, proTx));
+        BOOST_CHECK(mnList.GetMNByCollateral(dmn->collateralOutpoint) == dmn);
+        BOOST_CHECK(mnList.GetMNByService(proTx.addr) == dmn);
+        BOOST_CHECK(mnList.GetUniquePropertyMN(proTx.keyIDOwner) == dmn);
+        BOOST_CHECK(mnList.GetUniquePropertyMN(proTx.pubKeyOperator) == dmn);
+        BOOST_CHECK(mnList.GetUniquePropertyMN(dmn->pdmnState->pubKeyOperator) == dmn);
+        CBLSSecretKey otherOperatorKey;
+        otherOperatorKey.MakeNewKey();
+        BOOST_CHECK(!mnList.HasUniqueProperty(otherOperatorKey.GetPublicKey()));
+
         nHeight++;
     }
 
@@ -647,4 +661,82 @@ BOOST_FIXTURE_TEST_CASE(dip3_verify_db, TestChainDIP3Setup)
     BOOST_ASSERT(CVerifyDB().VerifyDB(Params(), pcoinsTip.get(), 4, 2));
 }
 
+BOOST_FIXTURE_TEST_CASE(dip3_reorg_lists, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(m_coinbase_txns);
+    int port = 1;
+
+    // hash of the serialized list of every block we connected, as it was built when the block was connected first
+    std::map<uint256, uint256> listHashes;
+    listHashes.emplace(chainActive.Tip()->GetBlockHash(), ::SerializeHash(deterministicMNManager->GetListAtChainTip()));
+
+    // register one MN per block on top of the current tip
+    auto createChain = [&](size_t nBlocks, std::vector<CBlockIndex*>& vecIndexes, std::vector<uint256>& vecProTxHashes) {
+        for (size_t i = 0; i < nBlocks; i++) {
+            CKey ownerKey;
+            CBLSSecretKey operatorKey;
+            auto tx = CreateProRegTx(utxos, port++, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey);
+            CreateAndProcessBlock({tx}, coinbaseKey);
+            deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+            BOOST_ASSERT(deterministicMNManager->GetListAtChainTip().HasMN(tx.GetHash()));
+            vecIndexes.emplace_back(chainActive.Tip());
+            vecProTxHashes.emplace_back(tx.GetHash());
+            listHashes.emplace(chainActive.Tip()->GetBlockHash(), ::SerializeHash(deterministicMNManager->GetListAtChainTip()));
+        }
+    };
+
+    auto checkLists = [&](const std::vector<CBlockIndex*>& vecActive, const std::vector<uint256>& vecActiveProTxHashes, const std::vector<uint256>& vecInactiveProTxHashes) {
+        BOOST_ASSERT(chainActive.Tip() == vecActive.back());
+        for (const auto& p : listHashes) {
+            CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(p.first));
+            BOOST_CHECK(::SerializeHash(deterministicMNManager->GetListForBlock(pindex)) == p.second);
+        }
+        auto mnList = deterministicMNManager->GetListAtChainTip();
+        BOOST_CHECK(::SerializeHash(mnList) == listHashes.at(vecActive.back()->GetBlockHash()));
+        for (const auto& proTxHash : vecActiveProTxHashes) {
+            BOOST_CHECK(mnList.HasMN(proTxHash));
+        }
+        for (const auto& proTxHash : vecInactiveProTxHashes) {
+            BOOST_CHECK(!mnList.HasMN(proTxHash));
+        }
+    };
+
+    const CBlockIndex* pindexFork = chainActive.Tip();
+    std::vector<CBlockIndex*> chainA, chainB;
+    std::vector<uint256> proTxHashesA, proTxHashesB;
+
+    createChain(3, chainA, proTxHashesA);
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_ASSERT(InvalidateBlock(state, Params(), chainA[0]));
+    }
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    BOOST_ASSERT(chainActive.Tip() == pindexFork);
+
+    createChain(2, chainB, proTxHashesB);
+    checkLists(chainB, proTxHashesB, proTxHashesA);
+
+    // the longer chain wins once it is valid again, this disconnects two blocks and connects three in one step
+    {
+        LOCK(cs_main);
+        ResetBlockFailureFlags(chainA[0]);
+    }
+    CValidationState state;
+    BOOST_ASSERT(ActivateBestChain(state, Params()));
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    checkLists(chainA, proTxHashesA, proTxHashesB);
+
+    // and back again
+    {
+        LOCK(cs_main);
+        BOOST_ASSERT(InvalidateBlock(state, Params(), chainA[0]));
+    }
+    BOOST_ASSERT(ActivateBestChain(state, Params()));
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    checkLists(chainB, proTxHashesB, proTxHashesA);
+
+    BOOST_ASSERT(CVerifyDB().VerifyDB(Params(), pcoinsTip.get(), 4, 2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/test_dash.h>
+
+#include <evo/evodb.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+BOOST_FIXTURE_TEST_SUITE(evo_evodb_tests, BasicTestingSetup)
+
+struct ReadResult {
+    bool fFound{false};
+    int nValue{0};
+    bool fCacheable{false};
+};
+
+// reads like a read-through cache would, from a thread which doesn't own the current transaction
+static ReadResult ReadFromOtherThread(CEvoDB& db, const std::string& key)
+{
+    ReadResult r;
+    std::thread t([&] {
+        uint64_t nGen = db.GetGeneration();
+        r.fFound = db.Read(key, r.nValue);
+        r.fCacheable = db.IsCacheable(nGen);
+    });
+    t.join();
+    return r;
+}
+
+BOOST_AUTO_TEST_CASE(evodb_read_during_open_block)
+{
+    CEvoDB db(1 << 20, true, true);
+
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), 1);
+        dbTx->Commit();
+    }
+
+    // nothing uncommitted, so reads from any thread are up to date
+    auto r = ReadFromOtherThread(db, "a");
+    BOOST_CHECK(r.fFound && r.nValue == 1 && r.fCacheable);
+
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), 2);
+        db.Write(std::string("b"), 3);
+
+        // other threads still see the committed data, which must not end up in their caches
+        r = ReadFromOtherThread(db, "a");
+        BOOST_CHECK(r.fFound && r.nValue == 1 && !r.fCacheable);
+        r = ReadFromOtherThread(db, "b");
+        BOOST_CHECK(!r.fFound && !r.fCacheable);
+
+        // the owner of the transaction sees its own writes
+        uint64_t nGen = db.GetGeneration();
+        int nValue;
+        BOOST_CHECK(db.Read(std::string("a"), nValue) && nValue == 2);
+        BOOST_CHECK(db.IsCacheable(nGen));
+
+        // a write after the read makes it outdated, even for the owner
+        db.Erase(std::string("b"));
+        BOOST_CHECK(!db.IsCacheable(nGen));
+
+        dbTx->Commit();
+    }
+
+    r = ReadFromOtherThread(db, "a");
+    BOOST_CHECK(r.fFound && r.nValue == 2 && r.fCacheable);
+    r = ReadFromOtherThread(db, "b");
+    BOOST_CHECK(!r.fFound && r.fCacheable);
+
+    // a read which happened before the block was committed is outdated after the commit
+    uint64_t nGen = db.GetGeneration();
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), 4);
+        dbTx->Commit();
+    }
+    BOOST_CHECK(!db.IsCacheable(nGen));
+
+    // same for a rolled back block
+    nGen = db.GetGeneration();
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), 5);
+        dbTx->Rollback();
+    }
+    BOOST_CHECK(!db.IsCacheable(nGen));
+    r = ReadFromOtherThread(db, "a");
+    BOOST_CHECK(r.fFound && r.nValue == 4 && r.fCacheable);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
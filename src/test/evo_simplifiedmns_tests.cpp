@@ -5,11 +5,15 @@
 #include <test/test_dash.h>
 
 #include <bls/bls.h>
+#include <consensus/merkle.h>
 #include <evo/simplifiedmns.h>
 #include <netbase.h>
+#include <random.h>
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+
 BOOST_FIXTURE_TEST_SUITE(evo_simplifiedmns_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
@@ -67,4 +71,91 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree)
+{
+    FastRandomContext rnd(true);
+    std::vector<CSimplifiedMNListEntry> entries;
+    auto addEntry = [&]() {
+        CSimplifiedMNListEntry smle;
+        smle.proRegTxHash = rnd.rand256();
+        smle.confirmedHash = rnd.rand256();
+        smle.keyIDVoting = CKeyID(uint160(rnd.randbytes(20)));
+        smle.isValid = true;
+        entries.emplace_back(smle);
+    };
+
+    CSimplifiedMNListMerkleTree tree;
+    auto check = [&]() {
+        CSimplifiedMNList sml(entries);
+        bool mutated1 = false, mutated2 = false;
+        BOOST_CHECK(tree.CalcMerkleRoot(sml, &mutated2) == sml.CalcMerkleRoot(&mutated1));
+        BOOST_CHECK_EQUAL(mutated1, mutated2);
+    };
+
+    check();
+    for (size_t i = 0; i < 37; i++) {
+        addEntry();
+        check();
+    }
+    for (size_t i = 0; i < 20; i++) {
+        // modify, remove and add entries at random positions
+        entries[rnd.randrange(entries.size())].isValid ^= true;
+        check();
+        entries.erase(entries.begin() + rnd.randrange(entries.size()));
+        check();
+        addEntry();
+        addEntry();
+        check();
+    }
+    // identical entries result in identical leaves, which must be detected as mutation
+    entries.emplace_back(entries.back());
+    check();
+    entries.clear();
+    check();
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_parallel)
+{
+    // every index is visited exactly once, no matter how the ranges are split up
+    for (size_t count : {0, 1, 1023, 1024, 1025, 5000, 5003}) {
+        std::vector<std::atomic<int>> visited(count);
+        ParallelForSimplifiedMNs(count, [&](size_t begin, size_t end) {
+            BOOST_CHECK(begin < end && end <= count);
+            for (size_t i = begin; i < end; i++) {
+                visited[i]++;
+            }
+        });
+        for (size_t i = 0; i < count; i++) {
+            BOOST_CHECK_EQUAL(visited[i].load(), 1);
+        }
+    }
+
+    // large enough to be built and hashed in parallel
+    FastRandomContext rnd(true);
+    std::vector<CSimplifiedMNListEntry> entries(5000);
+    for (auto& smle : entries) {
+        smle.proRegTxHash = rnd.rand256();
+        smle.confirmedHash = rnd.rand256();
+        smle.keyIDVoting = CKeyID(uint160(rnd.randbytes(20)));
+        smle.isValid = rnd.randbool();
+    }
+    CSimplifiedMNList sml(entries);
+
+    std::sort(entries.begin(), entries.end(), [](const CSimplifiedMNListEntry& a, const CSimplifiedMNListEntry& b) {
+        return a.proRegTxHash.Compare(b.proRegTxHash) < 0;
+    });
+    BOOST_REQUIRE_EQUAL(sml.mnList.size(), entries.size());
+    std::vector<uint256> leaves;
+    for (size_t i = 0; i < entries.size(); i++) {
+        BOOST_CHECK(*sml.mnList[i] == entries[i]);
+        leaves.emplace_back(entries[i].CalcHash());
+    }
+    uint256 expectedMerkleRoot = ComputeMerkleRoot(leaves);
+    BOOST_CHECK(sml.CalcMerkleRoot() == expectedMerkleRoot);
+
+    CSimplifiedMNListMerkleTree tree;
+    BOOST_CHECK(tree.CalcMerkleRoot(sml) == expectedMerkleRoot);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
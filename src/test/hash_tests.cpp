@@ -16,7 +16,11 @@ BOOST_FIXTURE_TEST_SUITE(hash_tests, BasicTestingSetup)
 BOOST_AUTO_TEST_CASE(murmurhash3)
 {
 
-#define T(expected, seed, data) BOOST_CHECK_EQUAL(MurmurHash3(seed, ParseHex(data)), expected)
+#define T(expected, seed, data) do { \
+        BOOST_CHECK_EQUAL(MurmurHash3(seed, ParseHex(data)), expected); \
+        std::vector<unsigned char> vData = ParseHex(data); \
+        BOOST_CHECK_EQUAL(CMurmurHash3Multi(vData).Hash(seed), expected); \
+    } while (0)
 
     // Test MurmurHash3 with various inputs. Of course this is retested in the
     // bloom filter tests - they would fail if MurmurHash3() had any problems -
@@ -46,6 +50,19 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(murmurhash3_multi)
+{
+    // Up to and beyond the longest data which is mixed in advance
+    for (size_t nSize = 0; nSize <= 530; nSize++) {
+        std::vector<unsigned char> vData = insecure_rand_ctx.randbytes(nSize);
+        CMurmurHash3Multi hasher(vData);
+        for (int i = 0; i < 4; i++) {
+            uint32_t nSeed = InsecureRand32();
+            BOOST_CHECK_EQUAL(hasher.Hash(nSeed), MurmurHash3(nSeed, vData));
+        }
+    }
+}
+
 /*
    SipHash-2-4 output with
    k = 00 01 02 ...
@@ -150,4 +167,22 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(siphash_batch)
+{
+    // Check consistency between SipHashUint256Batch and SipHashUint256, including counts which aren't a multiple of
+    // the batch size
+    for (size_t count : {0, 1, 3, 4, 5, 8, 13}) {
+        std::vector<uint256> vals(count);
+        for (auto& val : vals) {
+            val = InsecureRand256();
+        }
+        uint64_t k0 = InsecureRandBits(64), k1 = InsecureRandBits(64);
+        std::vector<uint64_t> out(count);
+        SipHashUint256Batch(k0, k1, vals.data(), out.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            BOOST_CHECK_EQUAL(out[i], SipHashUint256(k0, k1, vals[i]));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,7 +5,9 @@
 #include <key.h>
 
 #include <key_io.h>
+#include <primitives/block.h>
 #include <script/script.h>
+#include <script/sigcache.h>
 #include <uint256.h>
 #include <util/system.h>
 #include <util/strencodings.h>
@@ -188,4 +190,44 @@ BOOST_AUTO_TEST_CASE(key_signature_tests)
     BOOST_CHECK(found_small);
 }
 
+BOOST_AUTO_TEST_CASE(block_pubkeys)
+{
+    CKey key1 = DecodeSecret(strSecret1C);
+    CKey key2 = DecodeSecret(strSecret2);
+    CKey keyOther = DecodeSecret(strSecret2C);
+    uint256 hash = InsecureRand256();
+    std::vector<unsigned char> sig1, sig2, sigOther;
+    BOOST_REQUIRE(key1.Sign(hash, sig1) && key2.Sign(hash, sig2) && keyOther.Sign(hash, sigOther));
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << ToByteVector(keyOther.GetPubKey());
+    // a P2PKH input spending from key1 and a P2SH multisig input with key1 and key2
+    CMutableTransaction tx;
+    tx.vin.resize(2);
+    tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    tx.vin[0].scriptSig = CScript() << sig1 << ToByteVector(key1.GetPubKey());
+    tx.vin[1].prevout = COutPoint(InsecureRand256(), 0);
+    CScript redeemScript = CScript() << OP_1 << ToByteVector(key1.GetPubKey()) << ToByteVector(key2.GetPubKey()) << OP_2 << OP_CHECKMULTISIG;
+    tx.vin[1].scriptSig = CScript() << OP_0 << sig2 << std::vector<unsigned char>(redeemScript.begin(), redeemScript.end());
+
+    CBlock block;
+    block.vtx.emplace_back(MakeTransactionRef(coinbase));
+    block.vtx.emplace_back(MakeTransactionRef(tx));
+    CBlockPubKeys blockPubKeys(block);
+    // the coinbase is skipped and key1 is only added once
+    BOOST_CHECK_EQUAL(blockPubKeys.size(), 2U);
+
+    // verifying a second time uses the parsed key
+    for (int i = 0; i < 2; i++) {
+        BOOST_CHECK(blockPubKeys.Verify(key1.GetPubKey(), hash, sig1));
+        BOOST_CHECK(blockPubKeys.Verify(key2.GetPubKey(), hash, sig2));
+        BOOST_CHECK(!blockPubKeys.Verify(key1.GetPubKey(), hash, sig2));
+        BOOST_CHECK(!blockPubKeys.Verify(key2.GetPubKey(), InsecureRand256(), sig2));
+    }
+    // keys which are not part of the block are verified as well
+    BOOST_CHECK(blockPubKeys.Verify(keyOther.GetPubKey(), hash, sigOther));
+    BOOST_CHECK(!blockPubKeys.Verify(keyOther.GetPubKey(), hash, sig1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,316 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/test_dash.h>
+
+#include <llmq/quorums.h>
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_signing_shares.h>
+#include <random.h>
+#include <streams.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace llmq;
+
+// see CSigSharesInv
+static const uint8_t COMPACT_BITMAP = 0;
+static const uint8_t COMPACT_OFFSETS = 1;
+static const uint8_t COMPACT_RUNS = 2;
+
+static const int LEGACY_VERSION = LLMQ_COMPACT_SIGSHARES_VERSION - 1;
+
+static CSigSharesInv MakeInv(size_t size, const std::vector<uint16_t>& setBits)
+{
+    CSigSharesInv inv;
+    inv.sessionId = 1;
+    inv.Init(size);
+    for (auto i : setBits) {
+        inv.Set(i, true);
+    }
+    return inv;
+}
+
+// Stream with the session id and inv size of a compact inv, the encoding and its data have to be appended
+static CDataStream MakeCompactStream(uint32_t sessionId, uint64_t size)
+{
+    CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+    ds << VARINT(sessionId) << COMPACTSIZE(size);
+    return ds;
+}
+
+static void CheckRoundTrip(const CSigSharesInv& inv, int nVersion, int expectedEncoding = -1)
+{
+    CDataStream ds(SER_NETWORK, nVersion);
+    ds << inv;
+
+    if (expectedEncoding != -1) {
+        size_t nPrefix = MakeCompactStream(inv.sessionId, inv.size).size();
+        BOOST_REQUIRE(ds.size() > nPrefix);
+        BOOST_CHECK_EQUAL((int)(uint8_t)ds[nPrefix], expectedEncoding);
+    }
+
+    CSigSharesInv inv2;
+    ds >> inv2;
+    BOOST_CHECK(ds.empty());
+    BOOST_CHECK_EQUAL(inv2.sessionId, inv.sessionId);
+    BOOST_CHECK_EQUAL(inv2.size, inv.size);
+    BOOST_CHECK(inv2.inv == inv.inv);
+}
+
+static void CheckReadFails(CDataStream& ds)
+{
+    CSigSharesInv inv;
+    BOOST_CHECK_THROW(ds >> inv, std::ios_base::failure);
+}
+
+BOOST_FIXTURE_TEST_SUITE(llmq_signing_shares_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sigsharesinv_compact_roundtrip)
+{
+    // about half of the bits set, nothing beats the bitmap
+    std::vector<uint16_t> bits;
+    for (uint16_t i = 0; i < 400; i++) {
+        if (InsecureRandBool()) {
+            bits.emplace_back(i);
+        }
+    }
+    CheckRoundTrip(MakeInv(400, bits), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_BITMAP);
+
+    // sparse invs are sent as offsets
+    CheckRoundTrip(MakeInv(400, {}), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_OFFSETS);
+    CheckRoundTrip(MakeInv(400, {0}), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_OFFSETS);
+    CheckRoundTrip(MakeInv(400, {399}), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_OFFSETS);
+    CheckRoundTrip(MakeInv(400, {3, 130, 131, 398}), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_OFFSETS);
+
+    // almost full invs are sent as runs
+    std::vector<uint16_t> allBut;
+    for (uint16_t i = 0; i < 400; i++) {
+        if (i != 17 && i != 200) {
+            allBut.emplace_back(i);
+        }
+    }
+    CheckRoundTrip(MakeInv(400, allBut), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_RUNS);
+    auto full = MakeInv(400, {});
+    full.SetAll(true);
+    CheckRoundTrip(full, LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_RUNS);
+
+    // small quorums
+    CheckRoundTrip(MakeInv(0, {}), LLMQ_COMPACT_SIGSHARES_VERSION, COMPACT_BITMAP);
+    CheckRoundTrip(MakeInv(3, {1}), LLMQ_COMPACT_SIGSHARES_VERSION);
+    CheckRoundTrip(MakeInv(1, {0}), LLMQ_COMPACT_SIGSHARES_VERSION);
+}
+
+BOOST_AUTO_TEST_CASE(sigsharesinv_legacy_roundtrip)
+{
+    auto inv = MakeInv(400, {5});
+    CheckRoundTrip(inv, LEGACY_VERSION);
+    CheckRoundTrip(MakeInv(400, {}), LEGACY_VERSION);
+    CheckRoundTrip(MakeInv(50, {0, 1, 2, 49}), LEGACY_VERSION);
+
+    // old peers get the auto bitset
+    CDataStream ds(SER_NETWORK, LEGACY_VERSION);
+    ds << inv;
+    CDataStream dsExpected(SER_NETWORK, LEGACY_VERSION);
+    uint64_t size = 400;
+    std::vector<bool> vec(400, false);
+    vec[5] = true;
+    autobitset_t bitset = std::make_pair(vec, (size_t)400);
+    dsExpected << VARINT(inv.sessionId) << COMPACTSIZE(size) << AUTOBITSET(bitset);
+    BOOST_CHECK(ds.str() == dsExpected.str());
+}
+
+BOOST_AUTO_TEST_CASE(sigsharesinv_malformed)
+{
+    // truncated data of each encoding
+    std::vector<uint16_t> evenBits, allButFirst;
+    for (uint16_t i = 0; i < 400; i++) {
+        if (i % 2 == 0) {
+            evenBits.emplace_back(i);
+        }
+        if (i != 0) {
+            allButFirst.emplace_back(i);
+        }
+    }
+    for (const auto& inv : {MakeInv(400, evenBits), MakeInv(400, {100, 399}), MakeInv(400, allButFirst)}) {
+        CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+        ds << inv;
+        for (size_t nLen = 0; nLen < ds.size(); nLen++) {
+            CDataStream truncated(ds.begin(), ds.begin() + nLen, SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+            CheckReadFails(truncated);
+        }
+    }
+
+    // inv size larger than any quorum
+    {
+        CDataStream ds = MakeCompactStream(1, Consensus::MAX_LLMQ_SIZE + 1);
+        ds << COMPACT_OFFSETS << VARINT(uint32_t{0});
+        CheckReadFails(ds);
+    }
+
+    // unknown encoding
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << uint8_t{3};
+        CheckReadFails(ds);
+    }
+
+    // bitmap with a bit beyond the inv size
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_BITMAP << uint8_t{0} << uint8_t{0x80};
+        CheckReadFails(ds);
+    }
+
+    // offset beyond the inv size, for the first and for a later bit
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_OFFSETS << VARINT(uint32_t{11}) << VARINT(uint32_t{0});
+        CheckReadFails(ds);
+    }
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_OFFSETS << VARINT(uint32_t{5}) << VARINT(uint32_t{6}) << VARINT(uint32_t{0});
+        CheckReadFails(ds);
+    }
+    {
+        // the last valid index still works
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_OFFSETS << VARINT(uint32_t{5}) << VARINT(uint32_t{5}) << VARINT(uint32_t{0});
+        CSigSharesInv inv;
+        ds >> inv;
+        BOOST_CHECK(inv.IsSet(4) && inv.IsSet(9));
+        BOOST_CHECK_EQUAL(inv.CountSet(), 2U);
+    }
+
+    // runs longer than the inv
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_RUNS << VARINT(uint32_t{5}) << VARINT(uint32_t{6});
+        CheckReadFails(ds);
+    }
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_RUNS << VARINT(uint32_t{0xffffffff});
+        CheckReadFails(ds);
+    }
+    // empty run which is not the first one
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_RUNS << VARINT(uint32_t{5}) << VARINT(uint32_t{0}) << VARINT(uint32_t{5});
+        CheckReadFails(ds);
+    }
+    // runs which don't reach the end of the inv
+    {
+        CDataStream ds = MakeCompactStream(1, 10);
+        ds << COMPACT_RUNS << VARINT(uint32_t{5}) << VARINT(uint32_t{4});
+        CheckReadFails(ds);
+    }
+}
+
+static CSigSesAnn MakeAnn(uint32_t sessionId, const uint256& quorumHash)
+{
+    CSigSesAnn ann;
+    ann.sessionId = sessionId;
+    ann.llmqType = Consensus::LLMQ_TEST;
+    ann.quorumHash = quorumHash;
+    ann.id = InsecureRand256();
+    ann.msgHash = InsecureRand256();
+    return ann;
+}
+
+static bool AnnsEqual(const std::vector<CSigSesAnn>& a, const std::vector<CSigSesAnn>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const CSigSesAnn& x, const CSigSesAnn& y) {
+        return x.sessionId == y.sessionId && x.llmqType == y.llmqType && x.quorumHash == y.quorumHash &&
+               x.id == y.id && x.msgHash == y.msgHash;
+    });
+}
+
+BOOST_AUTO_TEST_CASE(batchedsigsesanns_roundtrip)
+{
+    uint256 quorumHash1 = InsecureRand256();
+    uint256 quorumHash2 = InsecureRand256();
+    CBatchedSigSesAnns batch;
+    batch.anns = {MakeAnn(1, quorumHash1), MakeAnn(2, quorumHash2), MakeAnn(3, quorumHash1), MakeAnn(200, quorumHash2)};
+
+    // old peers get the announcements in their original order
+    {
+        CDataStream ds(SER_NETWORK, LEGACY_VERSION);
+        ds << batch;
+        CBatchedSigSesAnns batch2;
+        ds >> batch2;
+        BOOST_CHECK(ds.empty());
+        BOOST_CHECK(AnnsEqual(batch2.anns, batch.anns));
+    }
+
+    // the compact format groups them by quorum, in the order of the first announcement of each quorum
+    CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+    ds << batch;
+    CDataStream dsLegacy(SER_NETWORK, LEGACY_VERSION);
+    dsLegacy << batch;
+    BOOST_CHECK(ds.size() < dsLegacy.size());
+    CBatchedSigSesAnns batch2;
+    ds >> batch2;
+    BOOST_CHECK(ds.empty());
+    std::vector<CSigSesAnn> expected{batch.anns[0], batch.anns[2], batch.anns[1], batch.anns[3]};
+    BOOST_CHECK(AnnsEqual(batch2.anns, expected));
+
+    // nothing to announce
+    batch.anns.clear();
+    ds << batch;
+    ds >> batch2;
+    BOOST_CHECK(batch2.anns.empty());
+}
+
+BOOST_AUTO_TEST_CASE(batchedsigsesanns_malformed)
+{
+    CBatchedSigSesAnns batch;
+
+    // truncated data
+    {
+        CBatchedSigSesAnns batch2;
+        batch2.anns = {MakeAnn(1, InsecureRand256()), MakeAnn(2, InsecureRand256())};
+        CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+        ds << batch2;
+        for (size_t nLen = 0; nLen < ds.size(); nLen++) {
+            CDataStream truncated(ds.begin(), ds.begin() + nLen, SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+            BOOST_CHECK_THROW(truncated >> batch, std::ios_base::failure);
+        }
+    }
+
+    // empty group
+    {
+        CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+        WriteCompactSize(ds, 1);
+        ds << Consensus::LLMQ_TEST << InsecureRand256();
+        WriteCompactSize(ds, 0);
+        BOOST_CHECK_THROW(ds >> batch, std::ios_base::failure);
+    }
+
+    // oversized group and announcement counts
+    {
+        CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+        WriteCompactSize(ds, MAX_SIZE + 1);
+        BOOST_CHECK_THROW(ds >> batch, std::ios_base::failure);
+    }
+    {
+        CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+        WriteCompactSize(ds, 1);
+        ds << Consensus::LLMQ_TEST << InsecureRand256();
+        WriteCompactSize(ds, MAX_SIZE + 1);
+        BOOST_CHECK_THROW(ds >> batch, std::ios_base::failure);
+    }
+    {
+        // a large but valid count without the data to back it
+        CDataStream ds(SER_NETWORK, LLMQ_COMPACT_SIGSHARES_VERSION);
+        WriteCompactSize(ds, 1);
+        ds << Consensus::LLMQ_TEST << InsecureRand256();
+        WriteCompactSize(ds, 1000000);
+        BOOST_CHECK_THROW(ds >> batch, std::ios_base::failure);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include <test/test_dash.h>
 
 #include <chrono>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -33,4 +34,52 @@ BOOST_AUTO_TEST_CASE(logging_timer)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(logging_async)
+{
+    BCLog::Logger logger;
+    logger.m_print_to_file = true;
+    logger.m_file_path = GetDataDir() / "async.log";
+    logger.m_log_timestamps = false;
+    logger.m_log_async = true;
+    BOOST_CHECK(logger.StartLogging());
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&logger, i] {
+            for (int j = 0; j < 1000; j++) {
+                logger.LogPrintStr(strprintf("thread %d message %d\n", i, j));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logger.StopAsyncLogging();
+
+    // all messages were written and the messages of each thread are in order
+    fsbridge::ifstream file(logger.m_file_path);
+    std::string line;
+    std::vector<int> vecNext(4, 0);
+    int nLines = 0;
+    while (std::getline(file, line)) {
+        int i, j;
+        if (sscanf(line.c_str(), "thread %d message %d", &i, &j) != 2) {
+            continue;
+        }
+        BOOST_CHECK_EQUAL(j, vecNext[i]++);
+        nLines++;
+    }
+    BOOST_CHECK_EQUAL(nLines, 4000);
+
+    // after stopping, messages are written synchronously
+    logger.LogPrintStr("sync message\n");
+    file.close();
+    file.open(logger.m_file_path);
+    bool fFound = false;
+    while (std::getline(file, line)) {
+        fFound |= line == "sync message";
+    }
+    BOOST_CHECK(fFound);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,14 +10,18 @@
 #include <span.h>
 #include <streams.h>
 #include <net.h>
+#include <net_msgqueue.h>
 #include <netbase.h>
 #include <chainparams.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <version.h>
 
+#include <algorithm>
 #include <ios>
+#include <map>
 #include <memory>
+#include <mutex>
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -193,6 +197,154 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+static std::vector<char> MakeRawPing(uint64_t nonce)
+{
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    payload << nonce;
+    uint256 hash = Hash(payload.begin(), payload.end());
+    CMessageHeader hdr(Params().MessageStart(), NetMsgType::PING, payload.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream msg(SER_NETWORK, PROTOCOL_VERSION);
+    msg << hdr;
+    msg += payload;
+    return std::vector<char>(msg.begin(), msg.end());
+}
+
+BOOST_AUTO_TEST_CASE(cnode_recv_buffer_recycling)
+{
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode = MakeUnique<CNode>(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), std::string(), true);
+
+    auto receive = [&](uint64_t nonce) {
+        std::vector<char> raw = MakeRawPing(nonce);
+        bool complete;
+        BOOST_CHECK(pnode->ReceiveMsgBytes(raw.data(), raw.size(), complete));
+        BOOST_CHECK(complete);
+    };
+    auto checkStats = [&](uint64_t nAllocated, uint64_t nReused) {
+        CNodeStats stats;
+        pnode->copyStats(stats, std::vector<bool>());
+        BOOST_CHECK_EQUAL(stats.nRecvBuffersAllocated, nAllocated);
+        BOOST_CHECK_EQUAL(stats.nRecvBuffersReused, nReused);
+    };
+
+    // nothing to reuse yet
+    receive(1);
+    checkStats(1, 0);
+
+    // the buffer of a processed message is reused
+    CDataStream processed(SER_NETWORK, PROTOCOL_VERSION);
+    processed << uint64_t(1);
+    pnode->RecycleRecvBuffer(processed);
+    BOOST_CHECK_EQUAL(processed.capacity(), 0U);
+    receive(2);
+    checkStats(1, 1);
+
+    // buffers which exceed the pool's capacity are freed instead
+    CDataStream large(SER_NETWORK, PROTOCOL_VERSION);
+    large.reserve(MAX_RECV_BUFFER_POOL_BYTES + 1);
+    pnode->RecycleRecvBuffer(large);
+    receive(3);
+    checkStats(2, 1);
+}
+
+BOOST_AUTO_TEST_CASE(peer_known_table)
+{
+    CPeerKnownTable table(100);
+    const int slot1 = AllocatePeerSlot();
+    const int slot2 = AllocatePeerSlot();
+    BOOST_CHECK(slot1 != slot2);
+
+    const uint256 hash = InsecureRand256();
+    BOOST_CHECK(table.Insert(slot1, hash));
+    BOOST_CHECK(!table.Insert(slot1, hash));
+    BOOST_CHECK(table.Contains(slot1, hash));
+    BOOST_CHECK(!table.Contains(slot2, hash));
+    BOOST_CHECK(table.GetKnownSlots(hash).Contains(slot1));
+    BOOST_CHECK(!table.GetKnownSlots(hash).Contains(slot2));
+
+    // slots beyond the inline words of CPeerSlotSet
+    BOOST_CHECK(table.Insert(200, hash));
+    BOOST_CHECK(table.Contains(200, hash));
+    BOOST_CHECK(!table.Contains(199, hash));
+    table.EraseSlot(200);
+    BOOST_CHECK(!table.Contains(200, hash));
+    BOOST_CHECK(table.Contains(slot1, hash));
+
+    // a peer which exceeds its quota only forgets its own oldest entries
+    BOOST_CHECK(table.Insert(slot2, hash));
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK(table.Insert(slot2, InsecureRand256()));
+    }
+    BOOST_CHECK_EQUAL(table.Size(), 101U);
+    BOOST_CHECK(!table.Contains(slot2, hash));
+    BOOST_CHECK(table.Contains(slot1, hash));
+    BOOST_CHECK(table.GetKnownSlots(hash).Contains(slot1));
+    BOOST_CHECK(!table.GetKnownSlots(hash).Contains(slot2));
+
+    // entries are dropped once no peer knows them anymore
+    table.EraseSlot(slot2);
+    BOOST_CHECK_EQUAL(table.Size(), 1U);
+    table.EraseSlot(slot1);
+    BOOST_CHECK_EQUAL(table.Size(), 0U);
+    BOOST_CHECK(table.Insert(slot1, hash));
+
+    // a released slot is handed out again, without anything known by its previous peer
+    g_known_inventory.Insert(slot1, hash);
+    ReleasePeerSlot(slot1);
+    BOOST_CHECK_EQUAL(AllocatePeerSlot(), slot1);
+    BOOST_CHECK(!g_known_inventory.Contains(slot1, hash));
+    ReleasePeerSlot(slot1);
+    ReleasePeerSlot(slot2);
+}
+
+BOOST_AUTO_TEST_CASE(net_msg_queue)
+{
+    CAddress addr(CService(), NODE_NETWORK);
+    CNode node1(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), std::string(), true);
+    CNode node2(2, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), std::string(), true);
+
+    std::mutex cs;
+    std::map<NodeId, std::vector<int>> processed;
+    auto handler = [&](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv) {
+        int n;
+        vRecv >> n;
+        std::lock_guard<std::mutex> lock(cs);
+        processed[pfrom->GetId()].emplace_back(n);
+    };
+
+    // messages of each peer are processed in order and the nodes are released afterwards
+    CNetMsgQueue queue("testmsg", 10, handler);
+    queue.Start();
+    for (int i = 0; i < 100; i++) {
+        CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+        ds << i;
+        queue.Push(i % 3 ? &node1 : &node2, "test", ds);
+    }
+    while (queue.Size() != 0 || node1.GetRefCount() != 0 || node2.GetRefCount() != 0) {
+        MilliSleep(1);
+    }
+    BOOST_CHECK_EQUAL(processed[1].size() + processed[2].size(), 100U);
+    BOOST_CHECK(std::is_sorted(processed[1].begin(), processed[1].end()));
+    BOOST_CHECK(std::is_sorted(processed[2].begin(), processed[2].end()));
+    queue.Stop();
+
+    // queued messages still reference their nodes and are dropped on Stop()
+    CNetMsgQueue queue2("testmsg", 10, handler);
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << 1;
+    queue2.Push(&node1, "test", ds);
+    queue2.Push(&node1, "test", ds);
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 2);
+    queue2.Stop();
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 0);
+    queue2.Push(&node1, "test", ds);
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 0);
+    BOOST_CHECK_EQUAL(queue2.Size(), 0U);
+}
+
 BOOST_AUTO_TEST_CASE(PoissonNextSend)
 {
     g_mock_deterministic_tests = true;
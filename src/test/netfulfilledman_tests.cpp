@@ -0,0 +1,58 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <netbase.h>
+#include <netfulfilledman.h>
+#include <streams.h>
+#include <test/test_dash.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(netfulfilledman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_expiry_and_serialization)
+{
+    int64_t nStart = GetTime();
+    SetMockTime(nStart);
+
+    CNetFulfilledRequestManager man;
+    CService addr1 = LookupNumeric("1.2.3.4", 9999);
+    CService addr2 = LookupNumeric("5.6.7.8", 9999);
+
+    man.AddFulfilledRequest(addr1, FulfilledRequest::SPORK_SYNC);
+    man.AddFulfilledRequest(addr1, FulfilledRequest::ALLOW_SYNC);
+    BOOST_CHECK(man.HasFulfilledRequest(addr1, FulfilledRequest::SPORK_SYNC));
+    BOOST_CHECK(!man.HasFulfilledRequest(addr1, FulfilledRequest::FULL_SYNC));
+    BOOST_CHECK(!man.HasFulfilledRequest(addr2, FulfilledRequest::SPORK_SYNC));
+    // ports are ignored on mainnet
+    BOOST_CHECK(man.HasFulfilledRequest(LookupNumeric("1.2.3.4", 1234), FulfilledRequest::SPORK_SYNC));
+
+    // session specific requests are not persisted
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CNetFulfilledRequestManager man2;
+    ss >> man2;
+    BOOST_CHECK(man2.HasFulfilledRequest(addr1, FulfilledRequest::SPORK_SYNC));
+    BOOST_CHECK(!man2.HasFulfilledRequest(addr1, FulfilledRequest::ALLOW_SYNC));
+
+    int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    SetMockTime(nStart + nExpireTime / 2);
+    man.AddFulfilledRequest(addr2, FulfilledRequest::GOVERNANCE_SYNC);
+
+    SetMockTime(nStart + nExpireTime + 120);
+    BOOST_CHECK(!man.HasFulfilledRequest(addr1, FulfilledRequest::SPORK_SYNC));
+    BOOST_CHECK(man.HasFulfilledRequest(addr2, FulfilledRequest::GOVERNANCE_SYNC));
+    man.CheckAndRemove();
+    BOOST_CHECK_EQUAL(man.ToString(), "Nodes with fulfilled requests: 1");
+
+    SetMockTime(nStart + nExpireTime * 2);
+    man.CheckAndRemove();
+    BOOST_CHECK_EQUAL(man.ToString(), "Nodes with fulfilled requests: 0");
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,71 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/test_dash.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // freelist should be used
+    void* block = resource.Allocate(8, 8);
+    resource.Deallocate(block, 8, 8);
+
+    // a second allocation of the same size reuses the block
+    void* b = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(b, block);
+
+    // larger than MAX_BLOCK_SIZE_BYTES goes to operator new
+    void* large = resource.Allocate(16, 8);
+    BOOST_CHECK(large != nullptr);
+    resource.Deallocate(large, 16, 8);
+    resource.Deallocate(b, 8, 8);
+
+    // exhausting the chunk allocates a new one
+    for (size_t i = 0; i < 1024 / 8 + 1; i++) {
+        resource.Allocate(8, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(random_allocations)
+{
+    using Map = std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                   PoolAllocator<std::pair<const uint64_t, uint64_t>, sizeof(std::pair<const uint64_t, uint64_t>) + sizeof(void*) * 4, alignof(void*)>>;
+    Map::allocator_type::ResourceType resource(65536);
+    Map m{0, std::hash<uint64_t>{}, std::equal_to<uint64_t>{}, &resource};
+    std::map<uint64_t, uint64_t> ref;
+
+    for (int i = 0; i < 20000; i++) {
+        uint64_t key = InsecureRandRange(1000);
+        if (InsecureRandRange(3) == 0) {
+            BOOST_CHECK_EQUAL(m.erase(key), ref.erase(key));
+        } else {
+            m[key] = i;
+            ref[key] = i;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(m.size(), ref.size());
+    for (const auto& p : ref) {
+        BOOST_CHECK_EQUAL(m.at(p.first), p.second);
+    }
+
+    // the memory usage accounts for all chunks of the resource
+    BOOST_CHECK(memusage::DynamicUsage(m) >= resource.NumAllocatedChunks() * resource.ChunkSizeBytes());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
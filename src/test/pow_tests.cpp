@@ -140,6 +140,41 @@ BOOST_AUTO_TEST_CASE(get_next_work)
     BOOST_CHECK_EQUAL(GetNextWorkRequired(&blockIndexLast, &blockHeader, chainParamsDev->GetConsensus()), 0x207fffffU); // Block #123457 has 0x207fffff
 }
 
+/* Test that the memoized DGW result matches the calculation for the same chain without block hashes */
+BOOST_AUTO_TEST_CASE(get_next_work_cached)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    gArgs.SoftSetBoolArg("-devnet", true);
+    const auto chainParamsDev = CreateChainParams(CBaseChainParams::DEVNET);
+
+    const size_t nBlocks = 40;
+    std::vector<uint256> hashes(nBlocks);
+    std::vector<CBlockIndex> withHashes(nBlocks);
+    std::vector<CBlockIndex> withoutHashes(nBlocks);
+    for (size_t i = 0; i < nBlocks; i++) {
+        hashes[i] = InsecureRand256();
+        for (auto* blocks : {&withHashes, &withoutHashes}) {
+            CBlockIndex& index = (*blocks)[i];
+            index.nHeight = 1000000 + i;
+            index.nTime = 1600000000 + i * 150 + (i % 3) * 60;
+            index.nBits = 0x1b100000 + (i % 7) * 0x1000;
+            index.pprev = i > 0 ? &(*blocks)[i - 1] : nullptr;
+        }
+        withHashes[i].phashBlock = &hashes[i];
+    }
+
+    CBlockHeader blockHeader;
+    for (size_t i = 24; i < nBlocks; i++) {
+        blockHeader.nTime = withHashes[i].nTime + 150;
+        for (const auto* params : {&chainParams->GetConsensus(), &chainParamsDev->GetConsensus()}) {
+            unsigned int nExpected = GetNextWorkRequired(&withoutHashes[i], &blockHeader, *params);
+            // the first call fills the cache, the second one is served from it
+            BOOST_CHECK_EQUAL(GetNextWorkRequired(&withHashes[i], &blockHeader, *params), nExpected);
+            BOOST_CHECK_EQUAL(GetNextWorkRequired(&withHashes[i], &blockHeader, *params), nExpected);
+        }
+    }
+}
+
 /* Test the constraint on the upper bound for next work */
 // BOOST_AUTO_TEST_CASE(get_next_work_pow_limit)
 // {
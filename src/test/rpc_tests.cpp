@@ -4,8 +4,11 @@
 
 #include <rpc/server.h>
 #include <rpc/client.h>
+#include <rpc/resultcache.h>
+#include <rpc/util.h>
 
 #include <core_io.h>
+#include <governance/governance.h>
 #include <key_io.h>
 #include <netbase.h>
 
@@ -416,4 +419,107 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_size)
     }
 }
 
+BOOST_AUTO_TEST_CASE(rpc_json_stream_writer)
+{
+    UniValue expected(UniValue::VOBJ);
+    UniValue arr(UniValue::VARR);
+    arr.push_back(1);
+    arr.push_back("two \"quoted\"");
+    arr.push_back(UniValue(UniValue::VOBJ));
+    expected.pushKV("a", arr);
+    expected.pushKV("b\n", NullUniValue);
+
+    // a tiny flush size makes the sink see many small pieces
+    std::string out;
+    size_t nFlushes = 0;
+    JSONStreamWriter writer([&](const std::string& str) { out += str; nFlushes++; }, 4);
+    writer.BeginObject();
+    writer.Key("a");
+    writer.BeginArray();
+    writer.Value(1);
+    writer.Value("two \"quoted\"");
+    writer.BeginObject();
+    writer.End();
+    writer.End();
+    BOOST_CHECK(!writer.IsComplete());
+    writer.Key("b\n");
+    writer.Value(NullUniValue);
+    writer.End();
+    BOOST_CHECK(writer.IsComplete());
+    writer.Flush();
+    BOOST_CHECK(nFlushes > 1);
+    BOOST_CHECK_EQUAL(out, expected.write());
+
+    // the same result is built as a UniValue when the request can't be streamed
+    JSONRPCRequest request;
+    RPCStreamingResult collected(request, UniValue::VARR);
+    collected.push_back(1);
+    collected.push_back("two \"quoted\"");
+    collected.push_back(UniValue(UniValue::VOBJ));
+    BOOST_CHECK_EQUAL(collected.Finish().write(), arr.write());
+
+    out.clear();
+    JSONStreamWriter writer2([&](const std::string& str) { out += str; });
+    request.resultWriter = &writer2;
+    RPCStreamingResult streamed(request, UniValue::VARR);
+    streamed.push_back(1);
+    streamed.push_back("two \"quoted\"");
+    streamed.push_back(UniValue(UniValue::VOBJ));
+    BOOST_CHECK(streamed.Finish().isNull());
+    writer2.Flush();
+    BOOST_CHECK_EQUAL(out, arr.write());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_result_cache)
+{
+    RPCResultCacheClear();
+
+    JSONRPCRequest request;
+    request.strMethod = "gobject";
+    request.params.setArray();
+    request.params.push_back("count");
+
+    UniValue result;
+    RPCResultCacheKey key;
+    BOOST_CHECK(!RPCResultCacheLookup(request, key, result));
+    BOOST_CHECK(key.fCacheable);
+    RPCResultCacheStore(key, UniValue("cached"));
+    BOOST_CHECK(RPCResultCacheLookup(request, key, result));
+    BOOST_CHECK_EQUAL(result.get_str(), "cached");
+
+    // other parameters are cached separately
+    JSONRPCRequest request2 = request;
+    request2.params.push_back("json");
+    BOOST_CHECK(!RPCResultCacheLookup(request2, key, result));
+
+    // a governance change invalidates the result
+    governance.Clear();
+    BOOST_CHECK(!RPCResultCacheLookup(request, key, result));
+
+    // requests which depend on anything else are not cached
+    request.params.setArray();
+    request.params.push_back("list");
+    BOOST_CHECK(!RPCResultCacheLookup(request, key, result));
+    BOOST_CHECK(!key.fCacheable);
+
+    // detailed protx lists depend on the wallet and the MN meta info
+    request.strMethod = "protx";
+    request.params.setArray();
+    request.params.push_back("list");
+    request.params.push_back("valid");
+    BOOST_CHECK(!RPCResultCacheLookup(request, key, result));
+    BOOST_CHECK(key.fCacheable);
+    request.params.push_back(false);
+    BOOST_CHECK(!RPCResultCacheLookup(request, key, result));
+    BOOST_CHECK(key.fCacheable);
+    request.params.setArray();
+    request.params.push_back("list");
+    request.params.push_back("valid");
+    request.params.push_back(true);
+    BOOST_CHECK(!RPCResultCacheLookup(request, key, result));
+    BOOST_CHECK(!key.fCacheable);
+
+    RPCResultCacheClear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include <random.h>
 #include <scheduler.h>
+#include <util/time.h>
 
 #include <test/test_dash.h>
 
@@ -11,6 +12,8 @@
 #include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+
 BOOST_AUTO_TEST_SUITE(scheduler_tests)
 
 static void microTask(CScheduler& s, boost::mutex& mutex, int& counter, int delta, boost::chrono::system_clock::time_point rescheduleTime)
@@ -174,4 +177,57 @@ BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
     BOOST_CHECK_EQUAL(counter2, 100);
 }
 
+BOOST_AUTO_TEST_CASE(scheduler_priority)
+{
+    CScheduler scheduler;
+
+    // all tasks are due, so they run by priority and then by time
+    std::vector<int> order;
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    scheduler.schedule([&order] { order.push_back(3); }, now - boost::chrono::milliseconds(3), SchedulerTaskOptions{"low", SchedulerPriority::LOW, ""});
+    scheduler.schedule([&order] { order.push_back(1); }, now - boost::chrono::milliseconds(2), SchedulerTaskOptions{"normal1", SchedulerPriority::NORMAL, ""});
+    scheduler.schedule([&order] { order.push_back(0); }, now - boost::chrono::milliseconds(1), SchedulerTaskOptions{"high", SchedulerPriority::HIGH, ""});
+    scheduler.schedule([&order] { order.push_back(2); }, now, SchedulerTaskOptions{"normal2", SchedulerPriority::NORMAL, ""});
+
+    scheduler.stop(true);
+    scheduler.serviceQueue();
+
+    BOOST_CHECK(order == std::vector<int>({0, 1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(scheduler_concurrency_class)
+{
+    CScheduler scheduler;
+
+    std::atomic<int> nRunning{0};
+    std::atomic<int> nMaxRunning{0};
+    std::atomic<int> nRuns{0};
+    for (int i = 0; i < 50; i++) {
+        scheduler.scheduleFromNow([&] {
+            int n = ++nRunning;
+            int nMax = nMaxRunning;
+            while (n > nMax && !nMaxRunning.compare_exchange_weak(nMax, n)) {}
+            MilliSleep(1);
+            --nRunning;
+            ++nRuns;
+        }, 0, SchedulerTaskOptions{"exclusive", SchedulerPriority::NORMAL, "test"});
+    }
+
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++) {
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    }
+    scheduler.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(nRuns, 50);
+    BOOST_CHECK_EQUAL(nMaxRunning, 1);
+
+    std::vector<SchedulerTaskStats> vecStats = scheduler.GetTaskStats();
+    BOOST_CHECK_EQUAL(vecStats.size(), 1U);
+    BOOST_CHECK_EQUAL(vecStats[0].name, "exclusive");
+    BOOST_CHECK_EQUAL(vecStats[0].nRuns, 50U);
+    BOOST_CHECK(vecStats[0].nMaxMicros <= vecStats[0].nTotalMicros);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,55 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <statsd_client.h>
+#include <test/test_dash.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(statsd_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(histogram_buckets)
+{
+    using statsd::Histogram;
+
+    // small values are exact
+    for (uint64_t i = 0; i < 32; i++) {
+        BOOST_CHECK_EQUAL(Histogram::BucketLowerBound(Histogram::BucketIndex(i)), i);
+    }
+
+    // larger values are off by less than 1/16
+    for (uint64_t value : {100ULL, 1000ULL, 12345ULL, 1000000ULL, 0xffffffffffffffffULL}) {
+        uint64_t lower = Histogram::BucketLowerBound(Histogram::BucketIndex(value));
+        BOOST_CHECK(lower <= value);
+        BOOST_CHECK(value - lower < value / 16 + 1);
+    }
+
+    // the buckets are ordered like the values
+    uint32_t prev = 0;
+    for (uint64_t value = 1; value < 100000; value = value * 3 / 2 + 1) {
+        BOOST_CHECK(Histogram::BucketIndex(value) >= prev);
+        prev = Histogram::BucketIndex(value);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(histogram_percentiles)
+{
+    statsd::Histogram h;
+    BOOST_CHECK_EQUAL(h.Percentile(50), 0U);
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        h.Add(i);
+    }
+    BOOST_CHECK_EQUAL(h.Count(), 1000U);
+    BOOST_CHECK_EQUAL(h.Sum(), 500500U);
+    BOOST_CHECK_EQUAL(h.Max(), 1000U);
+
+    uint64_t p50 = h.Percentile(50);
+    uint64_t p99 = h.Percentile(99);
+    BOOST_CHECK(p50 <= 500 && p50 > 500 - 500 / 16);
+    BOOST_CHECK(p99 <= 990 && p99 > 990 - 990 / 16);
+    BOOST_CHECK(h.Percentile(100) <= 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
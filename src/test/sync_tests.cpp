@@ -4,6 +4,9 @@
 
 #include <sync.h>
 #include <test/test_dash.h>
+#include <util/time.h>
+
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -49,4 +52,65 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    bool prev = g_lock_stats_enabled;
+    g_lock_stats_enabled = true;
+
+    Mutex lockStatsTestMutex;
+    int nLine = 0;
+    for (int i = 0; i < LOCK_STATS_HOLD_SAMPLE_RATE * 2; i++) {
+        LOCK(lockStatsTestMutex); nLine = __LINE__;
+    }
+
+    // another thread has to wait for the lock
+    std::thread waiter;
+    {
+        LOCK(lockStatsTestMutex);
+        std::atomic<bool> fStarted{false};
+        waiter = std::thread([&] {
+            fStarted = true;
+            LOCK(lockStatsTestMutex);
+        });
+        while (!fStarted) {
+            MilliSleep(1);
+        }
+        MilliSleep(50);
+    }
+    waiter.join();
+
+    g_lock_stats_enabled = prev;
+
+    bool fFoundLoop = false;
+    uint64_t nContentions = 0;
+    for (const LockSiteStatsEntry& entry : GetLockSiteStats()) {
+        if (entry.name != "lockStatsTestMutex") continue;
+        if (entry.line == nLine) {
+            fFoundLoop = true;
+            BOOST_CHECK(entry.nHoldSamples >= 1);
+        }
+        nContentions += entry.nContentions;
+        if (entry.nContentions) {
+            BOOST_CHECK(entry.nMaxWaitMicros > 0);
+        }
+    }
+    BOOST_CHECK(fFoundLoop);
+    BOOST_CHECK_EQUAL(nContentions, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(lock_stats_sites)
+{
+    // LOCK2 takes two locks with the same file and line
+    static const char* pszName1 = "lockSiteTestMutex1";
+    static const char* pszName2 = "lockSiteTestMutex2";
+    static const char* pszFile = __FILE__;
+    LockSiteStats* site1 = GetLockSite(pszName1, pszFile, 1000000);
+    LockSiteStats* site2 = GetLockSite(pszName2, pszFile, 1000000);
+    BOOST_CHECK(site1 != nullptr);
+    BOOST_CHECK(site2 != nullptr);
+    BOOST_CHECK(site1 != site2);
+    BOOST_CHECK(GetLockSite(pszName1, pszFile, 1000000) == site1);
+    BOOST_CHECK(GetLockSite(pszName2, pszFile, 1000000) == site2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,10 +4,12 @@
 
 #include <test/test_dash.h>
 
+#include <bls/bls_sigcache.h>
 #include <chainparams.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <crypto/siphash.h>
 #include <index/txindex.h>
 #include <miner.h>
 #include <net_processing.h>
@@ -67,6 +69,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     : m_path_root(fs::temp_directory_path() / "test_dash" / strprintf("%lu_%i", (unsigned long)GetTime(), (int)(InsecureRandRange(1 << 30))))
 {
     SHA256AutoDetect();
+    SipHashAutoDetect();
     RandomInit();
     ECC_Start();
     BLSInit();
@@ -74,6 +77,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitBLSSignatureCache();
     CCoinJoin::InitStandardDenominations();
     fCheckBlockIndex = true;
     SelectParams(chainName);
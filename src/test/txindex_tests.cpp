@@ -39,6 +39,11 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
         MilliSleep(100);
     }
 
+    // Check that the summary reports the index as synced to the tip.
+    IndexSummary summary = txindex.GetSummary();
+    BOOST_CHECK(summary.synced);
+    BOOST_CHECK_EQUAL(summary.best_block_height, WITH_LOCK(cs_main, return chainActive.Height()));
+
     // Check that txindex excludes genesis block transactions.
     const CBlock& genesis_block = Params().GenesisBlock();
     for (const auto& txn : genesis_block.vtx) {
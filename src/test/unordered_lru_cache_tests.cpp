@@ -0,0 +1,96 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/test_dash.h>
+#include <unordered_lru_cache.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+BOOST_FIXTURE_TEST_SUITE(unordered_lru_cache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+    unordered_lru_cache<int, int, std::hash<int>> cache(3);
+    cache.insert(1, 10);
+    cache.insert(2, 20);
+    cache.insert(3, 30);
+
+    // touching 1 makes 2 the least recently used entry
+    int v;
+    BOOST_CHECK(cache.get(1, v) && v == 10);
+    cache.insert(4, 40);
+    BOOST_CHECK_EQUAL(cache.size(), 3U);
+    BOOST_CHECK(!cache.exists(2));
+    BOOST_CHECK(cache.exists(1) && cache.exists(3) && cache.exists(4));
+
+    // overwriting an entry touches it as well
+    cache.insert(3, 31);
+    cache.insert(5, 50);
+    BOOST_CHECK(!cache.exists(1));
+    BOOST_CHECK(cache.get(3, v) && v == 31);
+
+    cache.erase(4);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    cache.insert(6, 60);
+    cache.insert(7, 70);
+    BOOST_CHECK(!cache.exists(5));
+    BOOST_CHECK(cache.exists(3) && cache.exists(6) && cache.exists(7));
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+    cache.insert(8, 80);
+    BOOST_CHECK(cache.get(8, v) && v == 80);
+}
+
+BOOST_AUTO_TEST_CASE(lru_weight)
+{
+    unordered_lru_cache<int, std::string, std::hash<int>> cache(100);
+    cache.set_max_weight(10, [](const int&, const std::string& s) { return s.size(); });
+    cache.insert(1, "aaaa");
+    cache.insert(2, "bbbb");
+    BOOST_CHECK_EQUAL(cache.total_weight(), 8U);
+    cache.insert(3, "cccc");
+    BOOST_CHECK(!cache.exists(1));
+    BOOST_CHECK_EQUAL(cache.total_weight(), 8U);
+
+    // replacing a value updates its weight
+    cache.insert(2, "b");
+    BOOST_CHECK_EQUAL(cache.total_weight(), 5U);
+
+    // a single entry exceeding the limit is kept until the next insertion
+    cache.insert(4, std::string(20, 'd'));
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+    BOOST_CHECK(cache.exists(4));
+    cache.insert(5, "e");
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+    BOOST_CHECK_EQUAL(cache.total_weight(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_concurrent)
+{
+    sharded_lru_cache<uint64_t, uint64_t, std::hash<uint64_t>, 4> cache(1000);
+
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, t] {
+            for (uint64_t i = 0; i < 10000; i++) {
+                uint64_t key = t * 100000 + i;
+                cache.insert(key, key * 2);
+                uint64_t v;
+                if (cache.get(key, v)) {
+                    assert(v == key * 2);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    BOOST_CHECK(cache.size() <= 1000);
+    BOOST_CHECK(cache.size() > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
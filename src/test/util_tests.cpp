@@ -7,8 +7,11 @@
 #include <clientversion.h>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <util/memaccounting.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/threadaffinity.h>
+#include <util/lz4.h>
 #include <util/moneystr.h>
 #include <test/test_dash.h>
 #include <util/vector.h>
@@ -1328,4 +1331,97 @@ BOOST_AUTO_TEST_CASE(test_Capitalize)
     BOOST_CHECK_EQUAL(Capitalize("\x00\xfe\xff"), "\x00\xfe\xff");
 }
 
+BOOST_AUTO_TEST_CASE(thread_affinity_cpu_list)
+{
+    std::set<int> cpus;
+    BOOST_CHECK(util::ParseCpuList("0-3,8,10-11", cpus));
+    BOOST_CHECK(cpus == std::set<int>({0, 1, 2, 3, 8, 10, 11}));
+
+    cpus.clear();
+    BOOST_CHECK(util::ParseCpuList("5", cpus));
+    BOOST_CHECK(cpus == std::set<int>({5}));
+
+    BOOST_CHECK(!util::ParseCpuList("", cpus));
+    BOOST_CHECK(!util::ParseCpuList("3-1", cpus));
+    BOOST_CHECK(!util::ParseCpuList("-1", cpus));
+    BOOST_CHECK(!util::ParseCpuList("0-", cpus));
+    BOOST_CHECK(!util::ParseCpuList("1,,2", cpus));
+    BOOST_CHECK(!util::ParseCpuList("a-b", cpus));
+    BOOST_CHECK(!util::ParseCpuList("0-100000", cpus));
+
+    std::string strError;
+    BOOST_CHECK(!util::SetThreadAffinityRules({"scriptch"}, strError));
+    BOOST_CHECK(!util::SetThreadAffinityRules({"scriptch:"}, strError));
+    BOOST_CHECK(util::SetThreadAffinityRules({}, strError));
+}
+
+BOOST_AUTO_TEST_CASE(lz4_roundtrip)
+{
+    std::vector<uint8_t> repetitive, random;
+    for (int i = 0; i < 10000; i++) {
+        repetitive.push_back("abcdefgh"[i % 8]);
+    }
+    for (int i = 0; i < 5000; i++) {
+        random.push_back((uint8_t)InsecureRandBits(8));
+    }
+    std::vector<std::vector<uint8_t>> inputs{{}, {1, 2, 3}, repetitive, random};
+
+    for (const auto& data : inputs) {
+        std::vector<uint8_t> compressed, decompressed;
+        util::LZ4Compress(data, compressed);
+        BOOST_CHECK(util::LZ4Decompress(compressed, data.size(), decompressed));
+        BOOST_CHECK(decompressed == data);
+        // the decompressed size must match exactly
+        BOOST_CHECK(!util::LZ4Decompress(compressed, data.size() + 1, decompressed));
+        if (!data.empty()) {
+            BOOST_CHECK(!util::LZ4Decompress(compressed, data.size() - 1, decompressed));
+        }
+    }
+
+    std::vector<uint8_t> compressed, decompressed;
+    util::LZ4Compress(repetitive, compressed);
+    BOOST_CHECK(compressed.size() < 100);
+
+    // a match referring to data before the start of the block
+    BOOST_CHECK(!util::LZ4Decompress(std::vector<uint8_t>{0x10, 'a', 0x02, 0x00}, 5, decompressed));
+    // truncated literals
+    BOOST_CHECK(!util::LZ4Decompress(std::vector<uint8_t>{0x50, 'a', 'b'}, 5, decompressed));
+    // an overlapping match repeats the previous byte
+    BOOST_CHECK(util::LZ4Decompress(std::vector<uint8_t>{0x11, 'a', 0x01, 0x00, 0x10, 'b'}, 7, decompressed));
+    BOOST_CHECK(decompressed == std::vector<uint8_t>({'a', 'a', 'a', 'a', 'a', 'a', 'b'}));
+
+    // sizes which the data can't decompress to are rejected before allocating the output
+    BOOST_CHECK(!util::LZ4Decompress(std::vector<uint8_t>{0x10, 'a'}, 2 * util::LZ4_MAX_RATIO + 1, decompressed));
+    BOOST_CHECK(!util::LZ4Decompress(std::vector<uint8_t>{}, 1, decompressed));
+    BOOST_CHECK(!util::LZ4Decompress(std::vector<uint8_t>{0x10, 'a'}, std::numeric_limits<uint32_t>::max(), decompressed));
+    // the densest blocks stay below the limit
+    std::vector<uint8_t> zeros(1000000, 0);
+    util::LZ4Compress(zeros, compressed);
+    BOOST_CHECK(compressed.size() * util::LZ4_MAX_RATIO >= zeros.size());
+    BOOST_CHECK(util::LZ4Decompress(compressed, zeros.size(), decompressed));
+    BOOST_CHECK(decompressed == zeros);
+}
+
+BOOST_AUTO_TEST_CASE(memaccounting_register)
+{
+    int owner1, owner2;
+    memaccounting::Register("test.subsystem", &owner1, []() { return size_t(100); });
+    memaccounting::Register("test.subsystem", &owner2, []() { return size_t(20); });
+    memaccounting::Register("test.other", &owner2, []() { return size_t(3); });
+
+    // estimators of the same name are added up
+    auto usage = memaccounting::GetUsage();
+    BOOST_CHECK_EQUAL(usage.at("test.subsystem"), 120U);
+    BOOST_CHECK_EQUAL(usage.at("test.other"), 3U);
+
+    // all estimators of an owner are removed
+    memaccounting::Unregister(&owner2);
+    usage = memaccounting::GetUsage();
+    BOOST_CHECK_EQUAL(usage.at("test.subsystem"), 100U);
+    BOOST_CHECK(!usage.count("test.other"));
+
+    memaccounting::Unregister(&owner1);
+    BOOST_CHECK(!memaccounting::GetUsage().count("test.subsystem"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
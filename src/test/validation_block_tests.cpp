@@ -14,6 +14,8 @@
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <future>
+
 struct RegtestingSetup : public TestingSetup {
     RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
 };
@@ -177,4 +179,63 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, chainActive.Tip()->GetBlockHash());
 }
 
+struct BatchSubscriber : public CValidationInterface {
+    // (kind, number of events) for every callback, in the order they were delivered
+    std::vector<std::pair<char, size_t>> m_calls;
+    std::vector<int64_t> m_accept_times;
+
+    void TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs) override
+    {
+        m_calls.emplace_back('t', txs.size());
+        for (const auto& p : txs) {
+            m_accept_times.push_back(p.second);
+        }
+    }
+
+    void NotifyRecoveredSigs(const std::vector<std::shared_ptr<const llmq::CRecoveredSig>>& sigs) override
+    {
+        m_calls.emplace_back('r', sigs.size());
+    }
+
+    void ChainStateFlushed(const CBlockLocator& locator) override
+    {
+        m_calls.emplace_back('f', 1);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(validationinterface_batched_events)
+{
+    SyncWithValidationInterfaceQueue();
+
+    BatchSubscriber sub;
+    RegisterValidationInterface(&sub);
+
+    // Keep the background queue busy, so that all events below are queued before any of them is dispatched
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    CallFunctionInValidationInterfaceQueue([released] { released.wait(); });
+
+    const CTransactionRef tx = MakeTransactionRef(CMutableTransaction());
+    for (int i = 0; i < 5; i++) {
+        GetMainSignals().TransactionAddedToMempool(tx, i);
+    }
+    GetMainSignals().NotifyRecoveredSig(nullptr);
+    GetMainSignals().NotifyRecoveredSig(nullptr);
+    for (int i = 5; i < 8; i++) {
+        GetMainSignals().TransactionAddedToMempool(tx, i);
+    }
+    // Non-batched events close the current batch, so the ones after it are delivered separately
+    GetMainSignals().ChainStateFlushed(CBlockLocator());
+    GetMainSignals().TransactionAddedToMempool(tx, 8);
+
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&sub);
+
+    const std::vector<std::pair<char, size_t>> expected_calls{{'t', 5}, {'r', 2}, {'t', 3}, {'f', 1}, {'t', 1}};
+    BOOST_CHECK(sub.m_calls == expected_calls);
+    const std::vector<int64_t> expected_times{0, 1, 2, 3, 4, 5, 6, 7, 8};
+    BOOST_CHECK(sub.m_accept_times == expected_times);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
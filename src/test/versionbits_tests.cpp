@@ -335,5 +335,51 @@ BOOST_AUTO_TEST_CASE(versionbits_computeblockversion)
     //BOOST_CHECK_EQUAL(ComputeBlockVersion(lastBlock, mainnetParams) & VERSIONBITS_TOP_MASK, VERSIONBITS_TOP_BITS);
 }
 
+BOOST_AUTO_TEST_CASE(versionbits_cache)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    const auto pos = Consensus::DEPLOYMENT_TESTDUMMY;
+    const int bit = params.vDeployments[pos].bit;
+    const int64_t nTime = params.vDeployments[pos].nStartTime;
+    const int nPeriod = params.nMinerConfirmationWindow;
+
+    // STARTED in the second period, signalled in the second period, LOCKED_IN in the third and ACTIVE afterwards
+    VersionBitsTester activeChain;
+    activeChain.Mine(nPeriod, nTime, VERSIONBITS_LAST_OLD_BLOCK_VERSION);
+    activeChain.Mine(nPeriod * 2, nTime, VERSIONBITS_TOP_BITS | (1 << bit));
+    const CBlockIndex* pindexActiveTip = activeChain.Mine(nPeriod * 6, nTime, VERSIONBITS_LAST_OLD_BLOCK_VERSION).Tip();
+    auto expectedState = [&](int nHeight) {
+        const ThresholdState states[] = {ThresholdState::DEFINED, ThresholdState::STARTED, ThresholdState::LOCKED_IN};
+        return nHeight / nPeriod < 3 ? states[nHeight / nPeriod] : ThresholdState::ACTIVE;
+    };
+    // never signalled, so it stays STARTED
+    VersionBitsTester startedChain;
+    const CBlockIndex* pindexStartedTip = startedChain.Mine(nPeriod * 6, nTime, VERSIONBITS_LAST_OLD_BLOCK_VERSION).Tip();
+
+    VersionBitsCache cache;
+    auto checkChains = [&]() {
+        for (int nHeight = 0; nHeight < nPeriod * 6; nHeight++) {
+            BOOST_CHECK(cache.State(pindexActiveTip->GetAncestor(nHeight), params, pos) == expectedState(nHeight + 1));
+            BOOST_CHECK(cache.State(pindexStartedTip->GetAncestor(nHeight), params, pos) == (nHeight + 1 < nPeriod ? ThresholdState::DEFINED : ThresholdState::STARTED));
+        }
+        BOOST_CHECK_EQUAL(cache.StateSinceHeight(pindexActiveTip, params, pos), nPeriod * 3);
+        BOOST_CHECK_EQUAL(cache.StateSinceHeight(pindexStartedTip, params, pos), nPeriod);
+    };
+
+    // states computed while the blocks are connected
+    for (int nHeight = 0; nHeight < nPeriod * 6; nHeight++) {
+        const CBlockIndex* pindex = pindexActiveTip->GetAncestor(nHeight);
+        cache.UpdateTip(pindex, params);
+        BOOST_CHECK(cache.State(pindex, params, pos) == expectedState(nHeight + 1));
+    }
+    checkChains();
+
+    // states computed on demand, starting at the tip
+    cache.Clear();
+    BOOST_CHECK(cache.State(pindexActiveTip, params, pos) == ThresholdState::ACTIVE);
+    checkChains();
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -24,6 +24,7 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCEINDEX = 'A';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
@@ -73,7 +74,7 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -108,8 +109,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        it = erase ? mapCoins.erase(it) : std::next(it);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -169,16 +169,44 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
-    } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
-    }
+    i->CacheKey();
     return i;
 }
 
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::PartitionedCursors(int nParts) const
+{
+    assert(nParts >= 1 && nParts <= 256);
+
+    // See Cursor() for the const-cast
+    CDBWrapper& mutableDb = const_cast<CDBWrapper&>(db);
+    auto snapshot = mutableDb.GetSnapshot();
+
+    // The best block has to be read from the snapshot too
+    uint256 hashBestChain;
+    {
+        std::unique_ptr<CDBIterator> it(mutableDb.NewIterator(snapshot.get()));
+        it->Seek(DB_BEST_BLOCK);
+        char key;
+        if (it->Valid() && it->GetKey(key) && key == DB_BEST_BLOCK) {
+            it->GetValue(hashBestChain);
+        }
+    }
+
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    for (int i = 0; i < nParts; i++) {
+        int nBeginByte = 256 * i / nParts;
+        int nEndByte = 256 * (i + 1) / nParts;
+        std::unique_ptr<CCoinsViewDBCursor> cursor(new CCoinsViewDBCursor(snapshot, mutableDb.NewIterator(snapshot.get()), hashBestChain, nEndByte));
+        // Keys are the txid in its serialized byte order, so this sorts before all outputs with nBeginByte as first byte
+        uint256 seekHash;
+        *seekHash.begin() = (unsigned char)nBeginByte;
+        cursor->pcursor->Seek(std::make_pair(DB_COIN, seekHash));
+        cursor->CacheKey();
+        cursors.emplace_back(std::move(cursor));
+    }
+    return cursors;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -207,8 +235,13 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
+    CacheKey();
+}
+
+void CCoinsViewDBCursor::CacheKey()
+{
     CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) || (nEndByte < 256 && *keyTmp.second.hash.begin() >= nEndByte)) {
         keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
     } else {
         keyTmp.first = entry.key;
@@ -231,8 +264,7 @@ bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return Read(std::make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
+static void BatchSpentIndex(CDBBatch& batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
@@ -240,11 +272,9 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
             batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
+static void BatchAddressUnspentIndex(CDBBatch& batch, const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -252,6 +282,27 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
             batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
+}
+
+static void BatchAddressIndex(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect, bool fErase) {
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (fErase) {
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+        }
+    }
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+    CDBBatch batch(*this);
+    BatchSpentIndex(batch, vect);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+    CDBBatch batch(*this);
+    BatchAddressUnspentIndex(batch, vect);
     return WriteBatch(batch);
 }
 
@@ -283,25 +334,25 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
 
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    BatchAddressIndex(batch, vect, false);
     return WriteBatch(batch);
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+    BatchAddressIndex(batch, vect, true);
     return WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end, size_t limit) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    size_t nRead = 0;
+    int lastHeight = -1;
 
-    if (start > 0 && end > 0) {
+    if (start > 0) {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
@@ -314,9 +365,15 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            // never split the entries of a block, so that the caller can continue at the next height
+            if (limit > 0 && nRead >= limit && key.second.blockHeight != lastHeight) {
+                break;
+            }
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
                 addressIndex.push_back(std::make_pair(key.second, nValue));
+                lastHeight = key.second.blockHeight;
+                nRead++;
                 pcursor->Next();
             } else {
                 return error("failed to get address index value");
@@ -335,6 +392,59 @@ bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex)
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value) {
+    if (!Read(std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash)), value)) {
+        // addresses which never appeared on chain don't have an entry
+        value.SetNull();
+    }
+    return true;
+}
+
+void CBlockTreeDB::BatchAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fErase) {
+    std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> deltas;
+    for (const auto& p : vect) {
+        // only apply entries which actually change the address index, so that replaying a block (e.g. after an
+        // unclean shutdown) doesn't count it twice
+        if (Exists(std::make_pair(DB_ADDRESSINDEX, p.first)) != fErase) {
+            continue;
+        }
+        CAmount nSign = fErase ? -1 : 1;
+        auto& delta = deltas[std::make_pair(p.first.type, p.first.hashBytes)];
+        delta.balance += nSign * p.second;
+        if (p.second > 0) {
+            delta.received += nSign * p.second;
+        }
+    }
+    for (const auto& p : deltas) {
+        CAddressIndexIteratorKey key(p.first.first, p.first.second);
+        CAddressBalanceValue value;
+        ReadAddressBalance(key.hashBytes, key.type, value);
+        value.balance += p.second.balance;
+        value.received += p.second.received;
+        batch.Write(std::make_pair(DB_ADDRESSBALANCEINDEX, key), value);
+    }
+}
+
+bool CBlockTreeDB::UpdateBlockIndexes(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool fEraseAddressIndex, bool fUpdateBalances,
+                                      const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                                      const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &spentIndex,
+                                      const CTimestampIndexKey* timestampIndex) {
+    CDBBatch batch(*this);
+    if (fUpdateBalances) {
+        BatchAddressBalances(batch, addressIndex, fEraseAddressIndex);
+    }
+    BatchAddressIndex(batch, addressIndex, fEraseAddressIndex);
+    BatchAddressUnspentIndex(batch, addressUnspentIndex);
+    BatchSpentIndex(batch, spentIndex);
+    if (timestampIndex) {
+        batch.Write(std::make_pair(DB_TIMESTAMPINDEX, *timestampIndex), 0);
+    }
+    if (batch.SizeEstimate() == 0) {
+        return true;
+    }
+    return WriteBatch(batch);
+}
+
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -381,8 +491,14 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
+                // The block hash is part of the key, so take it from there instead of relying on the copy in the
+                // value, which would be recomputed with X11 if it was ever missing.
+                if (!diskindex.hash.IsNull() && diskindex.hash != key.second) {
+                    return error("%s: block index entry %s is stored under key %s", __func__, diskindex.hash.ToString(), key.second.ToString());
+                }
+
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(key.second);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -40,6 +40,8 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the block filter index DB specific cache (MiB)
+static const int64_t nMaxBlockFilterIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -56,8 +58,14 @@ public:
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     CCoinsViewCursor *Cursor() const override;
+    /**
+     * Split the coins into nParts disjoint ranges of txids and return a cursor for each of them. All outputs of a
+     * transaction are in the same range, and all cursors read from the same snapshot of the database, so they can be
+     * used from different threads while the database is updated. nParts must be between 1 and 256.
+     */
+    std::vector<std::unique_ptr<CCoinsViewCursor>> PartitionedCursors(int nParts) const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -80,8 +88,17 @@ public:
 private:
     CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(std::shared_ptr<const leveldb::Snapshot> snapshotIn, CDBIterator* pcursorIn, const uint256 &hashBlockIn, int nEndByteIn):
+        CCoinsViewCursor(hashBlockIn), snapshot(std::move(snapshotIn)), pcursor(pcursorIn), nEndByte(nEndByteIn) {}
+    /** Cache the key of the current record */
+    void CacheKey();
+
+    //! Declared before pcursor, so that it's released after it
+    std::shared_ptr<const leveldb::Snapshot> snapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! The cursor stops at the first txid which starts with this byte or a higher one, 256 for no limit
+    int nEndByte{256};
 
     friend class CCoinsViewDB;
 };
@@ -93,6 +110,8 @@ private:
     CCriticalSection cs;
     unordered_limitedmap<uint256, bool> mapHasTxIndexCache;
 
+    void BatchAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fErase);
+
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -110,8 +129,15 @@ public:
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0, size_t limit = 0);
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    //! Applies the address, address unspent, spent and timestamp index changes of a connected (or disconnected) block
+    //! with a single batch write. With fUpdateBalances, the per address balances are updated as well.
+    bool UpdateBlockIndexes(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool fEraseAddressIndex, bool fUpdateBalances,
+                            const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                            const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &spentIndex,
+                            const CTimestampIndexKey* timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
@@ -5,46 +5,112 @@
 #ifndef BITCOIN_UNORDERED_LRU_CACHE_H
 #define BITCOIN_UNORDERED_LRU_CACHE_H
 
+#include <memusage.h>
+#include <sync.h>
+#include <util/memory.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
-template<typename Key, typename Value, typename Hasher, size_t MaxSize = 0, size_t TruncateThreshold = 0>
+/**
+ * A LRU cache with O(1) lookup, touch and eviction.
+ *
+ * The recency list is intrusive: every entry of the map holds pointers to its neighbours, so no additional
+ * allocations are needed. The pointers stay valid when the map rehashes, as unordered_map never moves its nodes.
+ *
+ * The cache is bounded by the number of entries and optionally by the sum of the weights of all entries (see
+ * set_max_weight). The least recently used entries are evicted as soon as one of the bounds is exceeded.
+ *
+ * This class is not thread-safe, see sharded_lru_cache for a variant which can be used from multiple threads.
+ */
+template<typename Key, typename Value, typename Hasher, size_t MaxSize = 0>
 class unordered_lru_cache
 {
+public:
+    //! Returns the weight of an entry, e.g. its (approximate) memory usage in bytes
+    typedef std::function<size_t(const Key&, const Value&)> Weigher;
+
 private:
-    typedef std::unordered_map<Key, std::pair<Value, int64_t>, Hasher> MapType;
+    struct Entry;
+    typedef std::unordered_map<Key, Entry, Hasher> MapType;
+    typedef typename MapType::value_type Node;
+
+    struct Entry
+    {
+        Value value;
+        size_t weight{0};
+        Node* prev{nullptr};
+        Node* next{nullptr};
+
+        template<typename Value2>
+        explicit Entry(Value2&& v) : value(std::forward<Value2>(v)) {}
+    };
 
     MapType cacheMap;
+    //! Most recently used entry
+    Node* head{nullptr};
+    //! Least recently used entry, evicted first
+    Node* tail{nullptr};
+
     size_t maxSize;
-    size_t truncateThreshold;
-    int64_t accessCounter{0};
+    size_t maxWeight{0};
+    size_t totalWeight{0};
+    Weigher weigher;
 
 public:
-    explicit unordered_lru_cache(size_t _maxSize = MaxSize, size_t _truncateThreshold = TruncateThreshold) :
-        maxSize(_maxSize),
-        truncateThreshold(_truncateThreshold == 0 ? _maxSize * 2 : _truncateThreshold)
+    explicit unordered_lru_cache(size_t _maxSize = MaxSize) :
+        maxSize(_maxSize)
     {
         // either specify maxSize through template arguments or the contructor and fail otherwise
         assert(_maxSize != 0);
     }
 
+    // The entries point to each other, copying the map would leave them pointing into the original
+    unordered_lru_cache(const unordered_lru_cache&) = delete;
+    unordered_lru_cache& operator=(const unordered_lru_cache&) = delete;
+
     size_t max_size() const { return maxSize; }
 
+    /**
+     * Additionally bound the cache by the sum of weight(key, value) of all entries. The weight of an entry is
+     * determined when it is inserted. The most recently inserted entry is never evicted, even if it alone exceeds
+     * the limit.
+     */
+    void set_max_weight(size_t _maxWeight, Weigher _weigher)
+    {
+        assert(cacheMap.empty());
+        maxWeight = _maxWeight;
+        weigher = std::move(_weigher);
+    }
+
+    size_t total_weight() const { return totalWeight; }
+
     template<typename Value2>
     void _emplace(const Key& key, Value2&& v)
     {
-        truncate_if_needed();
         auto it = cacheMap.find(key);
         if (it == cacheMap.end()) {
-            cacheMap.emplace(key, std::make_pair(std::forward<Value2>(v), accessCounter++));
+            it = cacheMap.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Value2>(v))).first;
         } else {
-            it->second.first = std::forward<Value2>(v);
-            it->second.second = accessCounter++;
+            it->second.value = std::forward<Value2>(v);
+            totalWeight -= it->second.weight;
+            unlink(&*it);
+        }
+        if (weigher) {
+            it->second.weight = weigher(it->first, it->second.value);
+            totalWeight += it->second.weight;
         }
+        push_front(&*it);
+        truncate_if_needed();
     }
 
     void emplace(const Key& key, Value&& v)
     {
-        _emplace(key, v);
+        _emplace(key, std::move(v));
     }
 
     void insert(const Key& key, const Value& v)
@@ -56,8 +122,8 @@ public:
     {
         auto it = cacheMap.find(key);
         if (it != cacheMap.end()) {
-            it->second.second = accessCounter++;
-            value = it->second.first;
+            touch(&*it);
+            value = it->second.value;
             return true;
         }
         return false;
@@ -67,7 +133,7 @@ public:
     {
         auto it = cacheMap.find(key);
         if (it != cacheMap.end()) {
-            it->second.second = accessCounter++;
+            touch(&*it);
             return true;
         }
         return false;
@@ -75,36 +141,177 @@ public:
 
     void erase(const Key& key)
     {
-        cacheMap.erase(key);
+        auto it = cacheMap.find(key);
+        if (it != cacheMap.end()) {
+            erase(it);
+        }
     }
 
     void clear()
     {
         cacheMap.clear();
+        head = tail = nullptr;
+        totalWeight = 0;
+    }
+
+    size_t size() const { return cacheMap.size(); }
+
+    //! Memory used by the map itself, not including what the values point to
+    size_t dynamic_usage() const
+    {
+        return memusage::DynamicUsage(cacheMap);
+    }
+
+    //! Call f(key, value) for all entries, without touching their access time
+    template<typename Callback>
+    void for_each(Callback&& f) const
+    {
+        for (const auto& p : cacheMap) {
+            f(p.first, p.second.value);
+        }
     }
 
 private:
+    void unlink(Node* n)
+    {
+        Entry& e = n->second;
+        (e.prev ? e.prev->second.next : head) = e.next;
+        (e.next ? e.next->second.prev : tail) = e.prev;
+        e.prev = e.next = nullptr;
+    }
+
+    void push_front(Node* n)
+    {
+        n->second.next = head;
+        (head ? head->second.prev : tail) = n;
+        head = n;
+    }
+
+    void touch(Node* n)
+    {
+        if (n != head) {
+            unlink(n);
+            push_front(n);
+        }
+    }
+
+    void erase(typename MapType::iterator it)
+    {
+        unlink(&*it);
+        totalWeight -= it->second.weight;
+        cacheMap.erase(it);
+    }
+
     void truncate_if_needed()
     {
-        typedef typename MapType::iterator Iterator;
+        while (cacheMap.size() > maxSize || (maxWeight != 0 && totalWeight > maxWeight && tail != head)) {
+            erase(cacheMap.find(tail->first));
+        }
+    }
+};
+
+/**
+ * A thread-safe LRU cache, split into Shards independent unordered_lru_cache instances which are each protected by
+ * their own mutex. Keys are distributed over the shards by their hash, so concurrent accesses to different keys
+ * rarely contend. The LRU order is only maintained per shard, the cache as a whole is thus only approximately LRU.
+ *
+ * Values are returned by copy, so this is best used with small values or shared pointers.
+ */
+template<typename Key, typename Value, typename Hasher, size_t Shards = 16>
+class sharded_lru_cache
+{
+private:
+    struct Shard
+    {
+        mutable Mutex cs;
+        unordered_lru_cache<Key, Value, Hasher> cache GUARDED_BY(cs);
+
+        explicit Shard(size_t maxSize) : cache(maxSize) {}
+    };
 
-        if (cacheMap.size() <= truncateThreshold) {
-            return;
+    Hasher hasher;
+    std::array<std::unique_ptr<Shard>, Shards> shards;
+
+    Shard& GetShard(const Key& key)
+    {
+        // Fold in the upper bits, as the lower ones also determine the bucket inside the shard
+        uint64_t h = hasher(key);
+        return *shards[(h ^ (h >> 32)) % Shards];
+    }
+
+public:
+    //! maxSize is split evenly across all shards
+    explicit sharded_lru_cache(size_t maxSize)
+    {
+        static_assert(Shards != 0, "at least one shard is needed");
+        for (auto& shard : shards) {
+            shard = MakeUnique<Shard>(std::max<size_t>(1, (maxSize + Shards - 1) / Shards));
         }
+    }
 
-        std::vector<Iterator> vec;
-        vec.reserve(cacheMap.size());
-        for (auto it = cacheMap.begin(); it != cacheMap.end(); ++it) {
-            vec.emplace_back(it);
+    //! See unordered_lru_cache::set_max_weight, the weight limit is split evenly across all shards
+    void set_max_weight(size_t maxWeight, typename unordered_lru_cache<Key, Value, Hasher>::Weigher weigher)
+    {
+        for (auto& shard : shards) {
+            LOCK(shard->cs);
+            shard->cache.set_max_weight(std::max<size_t>(1, maxWeight / Shards), weigher);
         }
-        // sort by last access time (descending order)
-        std::sort(vec.begin(), vec.end(), [](const Iterator& it1, const Iterator& it2) {
-            return it1->second.second > it2->second.second;
-        });
+    }
+
+    void insert(const Key& key, const Value& v)
+    {
+        Shard& shard = GetShard(key);
+        LOCK(shard.cs);
+        shard.cache.insert(key, v);
+    }
 
-        for (size_t i = maxSize; i < vec.size(); i++) {
-            cacheMap.erase(vec[i]);
+    bool get(const Key& key, Value& value)
+    {
+        Shard& shard = GetShard(key);
+        LOCK(shard.cs);
+        return shard.cache.get(key, value);
+    }
+
+    bool exists(const Key& key)
+    {
+        Shard& shard = GetShard(key);
+        LOCK(shard.cs);
+        return shard.cache.exists(key);
+    }
+
+    void erase(const Key& key)
+    {
+        Shard& shard = GetShard(key);
+        LOCK(shard.cs);
+        shard.cache.erase(key);
+    }
+
+    void clear()
+    {
+        for (auto& shard : shards) {
+            LOCK(shard->cs);
+            shard->cache.clear();
+        }
+    }
+
+    size_t size() const
+    {
+        size_t ret = 0;
+        for (const auto& shard : shards) {
+            LOCK(shard->cs);
+            ret += shard->cache.size();
+        }
+        return ret;
+    }
+
+    size_t dynamic_usage() const
+    {
+        size_t ret = 0;
+        for (const auto& shard : shards) {
+            LOCK(shard->cs);
+            ret += shard->cache.dynamic_usage() + memusage::MallocUsage(sizeof(Shard));
         }
+        return ret;
     }
 };
 
@@ -2,10 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <util/asmap.h>
+
 #include <vector>
 #include <assert.h>
 #include <crypto/common.h>
 
+#include <algorithm>
+
 namespace {
 
 uint32_t DecodeBits(std::vector<bool>::const_iterator& bitpos, const std::vector<bool>::const_iterator& endpos, uint8_t minval, const std::vector<uint8_t> &bit_sizes)
@@ -101,3 +105,111 @@ uint32_t Interpret(const std::vector<bool> &asmap, const std::vector<bool> &ip)
     }
     return 0; // 0 is not a valid ASN
 }
+
+//! Lookups always walk the full IPv6 (or IPv4-in-IPv6) address
+static const int ASMAP_IP_BITS = 128;
+
+ASMap::ASMap(std::vector<bool> bits) : vBits(std::move(bits))
+{
+    if (vBits.empty()) {
+        return;
+    }
+    // every instruction is decoded once for asmaps which are trees, give up on anything taking (much) longer
+    size_t budget = vBits.size();
+    fCompiled = Compile(vBits.begin(), 0, 0, nRoot, budget);
+    if (!fCompiled) {
+        std::vector<Node>().swap(vNodes);
+        std::vector<uint32_t>().swap(vLeaves);
+    }
+}
+
+uint32_t ASMap::AddLeaf(uint32_t asn)
+{
+    vLeaves.push_back(asn);
+    return LEAF_FLAG | (vLeaves.size() - 1);
+}
+
+// Mirrors Interpret() for an address of which depth bits were consumed already. Each consumed bit becomes a node,
+// once all bits are consumed the remaining instructions resolve to a leaf just like Interpret() would resolve them.
+bool ASMap::Compile(std::vector<bool>::const_iterator pos, uint32_t default_asn, int depth, uint32_t& refRet, size_t& budget)
+{
+    const std::vector<bool>::const_iterator endpos = vBits.end();
+    uint32_t opcode, jump, match, matchlen;
+    while (pos != endpos) {
+        if (budget == 0) {
+            return false;
+        }
+        budget--;
+        opcode = DecodeType(pos, endpos);
+        if (opcode == 0) {
+            refRet = AddLeaf(DecodeASN(pos, endpos));
+            return true;
+        } else if (opcode == 1) {
+            jump = DecodeJump(pos, endpos);
+            if (depth == ASMAP_IP_BITS) break;
+            const uint32_t node = vNodes.size();
+            vNodes.emplace_back();
+            uint32_t child0, child1;
+            if (!Compile(pos, default_asn, depth + 1, child0, budget)) {
+                return false;
+            }
+            if (jump >= endpos - pos) {
+                child1 = AddLeaf(0);
+            } else if (!Compile(pos + jump, default_asn, depth + 1, child1, budget)) {
+                return false;
+            }
+            vNodes[node].child[0] = child0;
+            vNodes[node].child[1] = child1;
+            refRet = node;
+            return true;
+        } else if (opcode == 2) {
+            match = DecodeMatch(pos, endpos);
+            matchlen = CountBits(match) - 1;
+            // bits past the end of the address are skipped
+            const uint32_t nodes = std::min<uint32_t>(matchlen, ASMAP_IP_BITS - depth);
+            if (nodes == 0) continue;
+            const uint32_t first = vNodes.size();
+            vNodes.resize(first + nodes);
+            const uint32_t mismatch = AddLeaf(default_asn);
+            uint32_t next;
+            if (!Compile(pos, default_asn, depth + nodes, next, budget)) {
+                return false;
+            }
+            for (uint32_t bit = nodes; bit-- > 0;) {
+                const bool expected = (match >> (matchlen - 1 - bit)) & 1;
+                vNodes[first + bit].child[expected] = next;
+                vNodes[first + bit].child[!expected] = mismatch;
+                next = first + bit;
+            }
+            refRet = first;
+            return true;
+        } else if (opcode == 3) {
+            default_asn = DecodeASN(pos, endpos);
+        } else {
+            break;
+        }
+    }
+    refRet = AddLeaf(0); // 0 is not a valid ASN
+    return true;
+}
+
+uint32_t ASMap::Lookup(const uint8_t (&ip)[16]) const
+{
+    if (!fCompiled) {
+        if (vBits.empty()) {
+            return 0;
+        }
+        std::vector<bool> ip_bits(ASMAP_IP_BITS);
+        for (int i = 0; i < ASMAP_IP_BITS; ++i) {
+            ip_bits[i] = (ip[i / 8] >> (7 - i % 8)) & 1;
+        }
+        return Interpret(vBits, ip_bits);
+    }
+    uint32_t ref = nRoot;
+    for (int i = 0; i < ASMAP_IP_BITS && !(ref & LEAF_FLAG); ++i) {
+        ref = vNodes[ref].child[(ip[i / 8] >> (7 - i % 8)) & 1];
+    }
+    // no nodes are created for bits past the end of the address
+    assert(ref & LEAF_FLAG);
+    return vLeaves[ref & ~LEAF_FLAG];
+}
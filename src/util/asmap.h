@@ -5,6 +5,48 @@
 #ifndef BITCOIN_UTIL_ASMAP_H
 #define BITCOIN_UTIL_ASMAP_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
 uint32_t Interpret(const std::vector<bool> &asmap, const std::vector<bool> &ip);
 
+/**
+ * An asmap together with a binary trie compiled from it once, so that lookups follow one node per address bit instead
+ * of decoding the variable length instructions of the asmap again for every address. Interpret() stays the reference
+ * implementation, the trie gives the same result for every 128 bit address. Asmaps which would need disproportionately
+ * many nodes (they are trees when generated by the asmap tooling) are not compiled and are interpreted directly.
+ */
+class ASMap
+{
+private:
+    struct Node {
+        uint32_t child[2];
+    };
+
+    //! Children with this bit set are indexes into vLeaves, others into vNodes
+    static const uint32_t LEAF_FLAG = 0x80000000;
+
+    std::vector<bool> vBits;
+    std::vector<Node> vNodes;
+    std::vector<uint32_t> vLeaves;
+    uint32_t nRoot{0};
+    bool fCompiled{false};
+
+    uint32_t AddLeaf(uint32_t asn);
+    bool Compile(std::vector<bool>::const_iterator pos, uint32_t default_asn, int depth, uint32_t& refRet, size_t& budget);
+
+public:
+    ASMap() = default;
+    // implicit so that the raw bits can be passed wherever an asmap is expected
+    ASMap(std::vector<bool> bits);
+
+    const std::vector<bool>& GetBits() const { return vBits; }
+    bool IsEmpty() const { return vBits.empty(); }
+    bool IsCompiled() const { return fCompiled; }
+
+    /** Map a 16 byte IPv6 (or IPv4-in-IPv6) address to its ASN, 0 if it isn't mapped */
+    uint32_t Lookup(const uint8_t (&ip)[16]) const;
+};
+
 #endif // BITCOIN_UTIL_ASMAP_H
@@ -0,0 +1,175 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/lz4.h>
+
+#include <cstring>
+
+// See https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md for the format and the restrictions below
+static const size_t MIN_MATCH = 4;
+//! The last 5 bytes of a block are always literals
+static const size_t LAST_LITERALS = 5;
+//! The last match must start at least 12 bytes before the end of the block
+static const size_t MF_LIMIT = 12;
+static const size_t MAX_DISTANCE = 65535;
+static const int HASH_LOG = 12;
+//! After this many (1 << SKIP_TRIGGER) bytes without a match, the search starts skipping bytes
+static const int SKIP_TRIGGER = 6;
+
+static inline uint32_t ReadLE32Unaligned(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Hash4(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - HASH_LOG);
+}
+
+static void WriteLength(std::vector<uint8_t>& out, size_t len)
+{
+    // the first 15 are stored in the token
+    len -= 15;
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back((uint8_t)len);
+}
+
+static bool ReadLength(Span<const uint8_t> in, size_t& pos, size_t& len)
+{
+    uint8_t b;
+    do {
+        if (pos >= in.size()) {
+            return false;
+        }
+        b = in[pos++];
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+static void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t nLiterals, size_t nOffset, size_t nMatchLen)
+{
+    size_t tokenPos = out.size();
+    out.push_back(0);
+    uint8_t token = (uint8_t)((nLiterals >= 15 ? 15 : nLiterals) << 4);
+    if (nLiterals >= 15) {
+        WriteLength(out, nLiterals);
+    }
+    out.insert(out.end(), literals, literals + nLiterals);
+    if (nMatchLen != 0) {
+        out.push_back((uint8_t)(nOffset & 0xff));
+        out.push_back((uint8_t)(nOffset >> 8));
+        size_t len = nMatchLen - MIN_MATCH;
+        token |= (uint8_t)(len >= 15 ? 15 : len);
+        if (len >= 15) {
+            WriteLength(out, len);
+        }
+    }
+    out[tokenPos] = token;
+}
+
+void util::LZ4Compress(Span<const uint8_t> data, std::vector<uint8_t>& compressedRet)
+{
+    const uint8_t* const base = data.data();
+    const size_t size = data.size();
+
+    compressedRet.clear();
+    compressedRet.reserve(size + size / 255 + 16);
+
+    size_t anchor = 0;
+    if (size > MF_LIMIT) {
+        std::vector<uint32_t> table(1 << HASH_LOG, 0);
+        const size_t matchLimit = size - LAST_LITERALS;
+        size_t pos = 1;
+        table[Hash4(ReadLE32Unaligned(base))] = 0;
+        while (pos + MF_LIMIT <= size) {
+            uint32_t seq = ReadLE32Unaligned(base + pos);
+            uint32_t h = Hash4(seq);
+            size_t ref = table[h];
+            table[h] = (uint32_t)pos;
+            if (ref >= pos || pos - ref > MAX_DISTANCE || ReadLE32Unaligned(base + ref) != seq) {
+                pos += 1 + ((pos - anchor) >> SKIP_TRIGGER);
+                continue;
+            }
+
+            while (pos > anchor && ref > 0 && base[pos - 1] == base[ref - 1]) {
+                pos--;
+                ref--;
+            }
+            size_t len = MIN_MATCH;
+            while (pos + len < matchLimit && base[pos + len] == base[ref + len]) {
+                len++;
+            }
+            WriteSequence(compressedRet, base + anchor, pos - anchor, pos - ref, len);
+            pos += len;
+            anchor = pos;
+            if (pos + MF_LIMIT <= size) {
+                // makes the next match more likely to be found right away
+                table[Hash4(ReadLE32Unaligned(base + pos - 2))] = (uint32_t)(pos - 2);
+            }
+        }
+    }
+    WriteSequence(compressedRet, base + anchor, size - anchor, 0, 0);
+}
+
+bool util::LZ4Decompress(Span<const uint8_t> compressed, size_t nDecompressedSize, std::vector<uint8_t>& dataRet)
+{
+    // The size usually comes from the peer which sent the data, don't allocate more than the data can decompress to
+    if (nDecompressedSize > compressed.size() * LZ4_MAX_RATIO) {
+        return false;
+    }
+    dataRet.resize(nDecompressedSize);
+    uint8_t* const out = dataRet.data();
+    size_t outPos = 0;
+    size_t pos = 0;
+
+    while (pos < compressed.size()) {
+        uint8_t token = compressed[pos++];
+        size_t nLiterals = token >> 4;
+        if (nLiterals == 15 && !ReadLength(compressed, pos, nLiterals)) {
+            return false;
+        }
+        if (nLiterals > compressed.size() - pos || nLiterals > nDecompressedSize - outPos) {
+            return false;
+        }
+        if (nLiterals != 0) {
+            memcpy(out + outPos, compressed.data() + pos, nLiterals);
+        }
+        pos += nLiterals;
+        outPos += nLiterals;
+        if (pos == compressed.size()) {
+            // the last sequence has no match
+            break;
+        }
+
+        if (compressed.size() - pos < 2) {
+            return false;
+        }
+        size_t nOffset = compressed[pos] | ((size_t)compressed[pos + 1] << 8);
+        pos += 2;
+        if (nOffset == 0 || nOffset > outPos) {
+            return false;
+        }
+        size_t nMatchLen = token & 15;
+        if (nMatchLen == 15 && !ReadLength(compressed, pos, nMatchLen)) {
+            return false;
+        }
+        nMatchLen += MIN_MATCH;
+        if (nMatchLen > nDecompressedSize - outPos) {
+            return false;
+        }
+        // matches may overlap with their own output, so this can't be a memcpy/memmove
+        const uint8_t* src = out + outPos - nOffset;
+        for (size_t i = 0; i < nMatchLen; i++) {
+            out[outPos + i] = src[i];
+        }
+        outPos += nMatchLen;
+    }
+    return outPos == nDecompressedSize;
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_LZ4_H
+#define BITCOIN_UTIL_LZ4_H
+
+#include <span.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+/**
+ * Compress data into the LZ4 block format. The output can be decompressed by any LZ4 implementation (e.g.
+ * LZ4_decompress_safe), but the original size is not part of the block and must be transferred separately.
+ */
+void LZ4Compress(Span<const uint8_t> data, std::vector<uint8_t>& compressedRet);
+
+/** No LZ4 block decompresses to more than this many bytes per compressed byte */
+static const size_t LZ4_MAX_RATIO = 255;
+
+/**
+ * Decompress an LZ4 block which must decompress to exactly nDecompressedSize bytes. Returns false on malformed input,
+ * without ever writing or allocating more than nDecompressedSize bytes. Sizes above LZ4_MAX_RATIO times the
+ * compressed size are rejected before anything is allocated.
+ */
+bool LZ4Decompress(Span<const uint8_t> compressed, size_t nDecompressedSize, std::vector<uint8_t>& dataRet);
+
+} // namespace util
+
+#endif // BITCOIN_UTIL_LZ4_H
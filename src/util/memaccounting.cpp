@@ -0,0 +1,53 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/memaccounting.h>
+
+#include <mutex>
+
+namespace memaccounting {
+
+namespace {
+struct Registry
+{
+    // the estimators are called with the mutex held, so that their owners can't be destroyed in the meantime
+    std::mutex mutex;
+    std::multimap<const void*, std::pair<std::string, UsageFunc>> estimators;
+};
+
+Registry& GetRegistry()
+{
+    // constructed on first use, which is before any of the global subsystems registering themselves is done being
+    // constructed, so it's also destroyed after them
+    static Registry registry;
+    return registry;
+}
+} // namespace
+
+void Register(const std::string& name, const void* owner, UsageFunc func)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.estimators.emplace(owner, std::make_pair(name, std::move(func)));
+}
+
+void Unregister(const void* owner)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.estimators.erase(owner);
+}
+
+std::map<std::string, size_t> GetUsage()
+{
+    std::map<std::string, size_t> result;
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& p : registry.estimators) {
+        result[p.second.first] += p.second.second();
+    }
+    return result;
+}
+
+} // namespace memaccounting
@@ -0,0 +1,30 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_MEMACCOUNTING_H
+#define BITCOIN_UTIL_MEMACCOUNTING_H
+
+#include <functional>
+#include <map>
+#include <string>
+
+/**
+ * Registry of the memory used by the subsystems which don't report it elsewhere, like the LLMQ, governance and
+ * spork managers. Each subsystem registers an estimator based on the memusage.h functions when it's created and
+ * unregisters it when it's destroyed. The estimators are called by getmemoryinfo "subsystems".
+ */
+namespace memaccounting {
+
+typedef std::function<size_t()> UsageFunc;
+
+/** Register an estimator of the memory used by a subsystem. Estimators of the same name are added up. */
+void Register(const std::string& name, const void* owner, UsageFunc func);
+/** Remove all estimators of the owner, must be called before it's destroyed */
+void Unregister(const void* owner);
+/** Returns the estimated memory usage in bytes by subsystem name */
+std::map<std::string, size_t> GetUsage();
+
+} // namespace memaccounting
+
+#endif // BITCOIN_UTIL_MEMACCOUNTING_H
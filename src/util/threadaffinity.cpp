@@ -0,0 +1,132 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/dash-config.h>
+#endif
+
+#include <util/threadaffinity.h>
+
+#include <fs.h>
+#include <logging.h>
+#include <tinyformat.h>
+#include <util/strencodings.h>
+#include <util/string.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include <boost/algorithm/string.hpp>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+//! Upper bound for core numbers, same as CPU_SETSIZE of glibc
+static const int MAX_AFFINITY_CPUS = 1024;
+
+static std::mutex g_affinity_mutex;
+static std::vector<std::pair<std::string, std::set<int>>> g_affinity_rules;
+
+static bool ReadNodeCpuList(int node, std::set<int>& cpusRet)
+{
+    fsbridge::ifstream file(strprintf("/sys/devices/system/node/node%d/cpulist", node));
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line)) {
+        return false;
+    }
+    boost::trim(line);
+    return !line.empty() && util::ParseCpuList(line, cpusRet);
+}
+
+bool util::ParseCpuList(const std::string& str, std::set<int>& cpusRet)
+{
+    std::vector<std::string> tokens;
+    boost::split(tokens, str, boost::is_any_of(","));
+    for (const auto& token : tokens) {
+        int32_t first, last;
+        size_t dash = token.find('-');
+        if (token.compare(0, 4, "node") == 0) {
+            int32_t node;
+            if (!ParseInt32(token.substr(4), &node) || node < 0 || !ReadNodeCpuList(node, cpusRet)) {
+                return false;
+            }
+            continue;
+        } else if (dash == std::string::npos) {
+            if (!ParseInt32(token, &first)) {
+                return false;
+            }
+            last = first;
+        } else if (!ParseInt32(token.substr(0, dash), &first) || !ParseInt32(token.substr(dash + 1), &last)) {
+            return false;
+        }
+        if (first < 0 || last < first || last >= MAX_AFFINITY_CPUS) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpusRet.emplace(cpu);
+        }
+    }
+    return true;
+}
+
+bool util::SetThreadAffinityRules(const std::vector<std::string>& rules, std::string& strError)
+{
+    std::vector<std::pair<std::string, std::set<int>>> parsedRules;
+    for (const auto& rule : rules) {
+        size_t colon = rule.find(':');
+        std::set<int> cpus;
+        if (colon == std::string::npos || !ParseCpuList(rule.substr(colon + 1), cpus) || cpus.empty()) {
+            strError = strprintf("Invalid thread affinity rule '%s', expected <thread name prefix>:<cpu list>", rule);
+            return false;
+        }
+        parsedRules.emplace_back(rule.substr(0, colon), std::move(cpus));
+    }
+#if !defined(__linux__)
+    if (!parsedRules.empty()) {
+        strError = "Thread affinity rules are only supported on Linux";
+        return false;
+    }
+#endif
+
+    for (const auto& rule : parsedRules) {
+        std::vector<int> cpus(rule.second.begin(), rule.second.end());
+        LogPrintf("Pinning threads starting with '%s' to cores %s\n", rule.first, Join(cpus, ",", [](int cpu) { return strprintf("%d", cpu); }));
+    }
+    std::lock_guard<std::mutex> lock(g_affinity_mutex);
+    g_affinity_rules = std::move(parsedRules);
+    return true;
+}
+
+void util::ApplyThreadAffinity(const std::string& name)
+{
+    const std::set<int>* cpus = nullptr;
+    size_t matchLength = 0;
+    std::lock_guard<std::mutex> lock(g_affinity_mutex);
+    for (const auto& rule : g_affinity_rules) {
+        if (name.compare(0, rule.first.size(), rule.first) == 0 && (!cpus || rule.first.size() > matchLength)) {
+            cpus = &rule.second;
+            matchLength = rule.first.size();
+        }
+    }
+    if (!cpus) {
+        return;
+    }
+
+#if defined(__linux__)
+    // Memory is placed on the NUMA node of the core which touches it first, so pinning right when the thread is named
+    // also keeps the working memory it allocates afterwards local
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : *cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        LogPrintf("Failed to set the affinity of thread %s: %s\n", name, strerror(errno));
+    }
+#endif
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_THREADAFFINITY_H
+#define BITCOIN_UTIL_THREADAFFINITY_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace util {
+
+/**
+ * Parse a list of cores like "0-3,8,10-11". "node<n>" stands for all cores of NUMA node n as reported by
+ * /sys/devices/system/node/node<n>/cpulist.
+ */
+bool ParseCpuList(const std::string& str, std::set<int>& cpusRet);
+
+/**
+ * Set the rules for pinning threads to cores, each of the form "<thread name prefix>:<cpu list>". Threads are pinned
+ * when they are named through ThreadRename, so the rules must be set before the thread pools are started. A thread
+ * matching multiple prefixes uses the rule with the longest one.
+ */
+bool SetThreadAffinityRules(const std::vector<std::string>& rules, std::string& strError);
+
+/** Pin the calling thread to the cores of the rule matching name, does nothing if no rule matches */
+void ApplyThreadAffinity(const std::string& name);
+
+} // namespace util
+
+#endif // BITCOIN_UTIL_THREADAFFINITY_H
@@ -9,6 +9,7 @@
 #include <atomic>
 #include <thread>
 
+#include <util/threadaffinity.h>
 #include <util/threadnames.h>
 
 #ifdef HAVE_SYS_PRCTL_H
@@ -53,5 +54,6 @@ static void SetInternalName(std::string name) { }
 void util::ThreadRename(std::string&& name)
 {
     SetThreadName(("dash-" + name).c_str());
+    ApplyThreadAffinity(name);
     SetInternalName(std::move(name));
 }
@@ -0,0 +1,43 @@
+// Copyright (c) 2021 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_TRACE_H
+#define BITCOIN_UTIL_TRACE_H
+
+#if defined(HAVE_CONFIG_H)
+#include <config/dash-config.h>
+#endif
+
+// Userspace, Statically Defined Tracing (USDT) tracepoints. When enabled, each tracepoint compiles to a single nop
+// and a note in the binary which tracers like bpftrace attach to. Arguments are evaluated even without a tracer
+// attached, so only pass values which are already at hand. See doc/tracing.md for the list of tracepoints.
+#ifdef ENABLE_TRACING
+
+#include <sys/sdt.h>
+
+#define TRACE(context, event) DTRACE_PROBE(context, event)
+#define TRACE1(context, event, a) DTRACE_PROBE1(context, event, a)
+#define TRACE2(context, event, a, b) DTRACE_PROBE2(context, event, a, b)
+#define TRACE3(context, event, a, b, c) DTRACE_PROBE3(context, event, a, b, c)
+#define TRACE4(context, event, a, b, c, d) DTRACE_PROBE4(context, event, a, b, c, d)
+#define TRACE5(context, event, a, b, c, d, e) DTRACE_PROBE5(context, event, a, b, c, d, e)
+#define TRACE6(context, event, a, b, c, d, e, f) DTRACE_PROBE6(context, event, a, b, c, d, e, f)
+#define TRACE7(context, event, a, b, c, d, e, f, g) DTRACE_PROBE7(context, event, a, b, c, d, e, f, g)
+
+#else
+
+// the arguments are still referenced (but never evaluated) so that they keep compiling and don't cause unused
+// variable warnings
+#define TRACE(context, event) do {} while (0)
+#define TRACE1(context, event, a) do { if (false) { (void)(a); } } while (0)
+#define TRACE2(context, event, a, b) do { if (false) { (void)(a); (void)(b); } } while (0)
+#define TRACE3(context, event, a, b, c) do { if (false) { (void)(a); (void)(b); (void)(c); } } while (0)
+#define TRACE4(context, event, a, b, c, d) do { if (false) { (void)(a); (void)(b); (void)(c); (void)(d); } } while (0)
+#define TRACE5(context, event, a, b, c, d, e) do { if (false) { (void)(a); (void)(b); (void)(c); (void)(d); (void)(e); } } while (0)
+#define TRACE6(context, event, a, b, c, d, e, f) do { if (false) { (void)(a); (void)(b); (void)(c); (void)(d); (void)(e); (void)(f); } } while (0)
+#define TRACE7(context, event, a, b, c, d, e, f, g) do { if (false) { (void)(a); (void)(b); (void)(c); (void)(d); (void)(e); (void)(f); (void)(g); } } while (0)
+
+#endif
+
+#endif // BITCOIN_UTIL_TRACE_H
@@ -7,6 +7,7 @@
 #include <validation.h>
 
 #include <arith_uint256.h>
+#include <blockfilecache.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -36,7 +37,9 @@
 #include <txmempool.h>
 #include <ui_interface.h>
 #include <undo.h>
+#include <util/memory.h>
 #include <util/system.h>
+#include <util/trace.h>
 #include <util/moneystr.h>
 #include <util/strencodings.h>
 #include <util/validation.h>
@@ -53,9 +56,12 @@
 
 #include <statsd_client.h>
 
+#include <deque>
 #include <future>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -102,6 +108,9 @@ enum DisconnectResult
 
 class ConnectTrace;
 
+/** Number of block index entries allocated at once */
+static const size_t BLOCK_INDEX_CHUNK_SIZE = 4096;
+
 /**
  * CChainState stores and provides an API to update our local knowledge of the
  * current best chain and header tree.
@@ -178,7 +187,7 @@ public:
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to mapBlockIndex.
      */
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
@@ -207,7 +216,9 @@ private:
     bool ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Allocate an entry for mapBlockIndex, which is owned by this object and lives until UnloadBlockIndex() */
+    CBlockIndex* NewBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /**
@@ -223,6 +234,13 @@ private:
 
 
     bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Storage of the entries in mapBlockIndex. They are allocated BLOCK_INDEX_CHUNK_SIZE at a time instead of
+     * one by one, which saves the allocator overhead of over a million small allocations at startup.
+     */
+    std::vector<std::unique_ptr<CBlockIndex[]>> m_block_index_chunks;
+    size_t m_block_index_chunk_used = BLOCK_INDEX_CHUNK_SIZE;
 } g_chainstate;
 
 
@@ -237,9 +255,12 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 bool g_parallel_script_checks{false};
+/** Transactions with fewer inputs than this have their scripts checked on the calling thread only when entering the mempool */
+static const unsigned int MIN_INPUTS_FOR_PARALLEL_MEMPOOL_SCRIPT_CHECKS = 8;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fAddressIndex = false;
+bool fAddressBalanceIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
 bool fHavePruned = false;
@@ -250,12 +271,14 @@ unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+CBlockConnectTimings g_block_connect_timings;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
 std::atomic<bool> fDIP0001ActiveAtTip{false};
 
 uint256 hashAssumeValid;
+int nAssumeValidChainLockDepth = DEFAULT_ASSUMEVALID_CHAINLOCK_DEPTH;
 arith_uint256 nMinimumChainWork;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
@@ -326,7 +349,8 @@ enum class FlushStateMode {
 static bool FlushStateToDisk(const CChainParams& chainParams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight=0);
 static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight);
 static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr, const CBlockPubKeys* blockPubKeys = nullptr);
+static bool CheckInputScriptsParallel(const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags, PrecomputedTransactionData& txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
 bool CheckFinalTx(const CTransaction &tx, int flags)
@@ -822,6 +846,12 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         PrecomputedTransactionData txdata(tx);
+        if (g_parallel_script_checks && tx.vin.size() >= MIN_INPUTS_FOR_PARALLEL_MEMPOOL_SCRIPT_CHECKS) {
+            // Verify the signatures of large transactions, e.g. CoinJoin ones, on the script
+            // check threads first. The result is left to CheckInputs below, which reports
+            // failures the usual way and only has to look up the now cached signatures.
+            CheckInputScriptsParallel(tx, view, scriptVerifyFlags, txdata);
+        }
         if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false, txdata))
             return false; // state filled in by CheckInputs
 
@@ -947,17 +977,28 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end, size_t limit)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end, limit))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value)
+{
+    if (!fAddressBalanceIndex)
+        return error("address balance index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, value))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -1044,31 +1085,65 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+bool ReadBlockFromDisk(std::shared_ptr<const CBlock>& pblockRet, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
-    block.SetNull();
+    if (blockFileCache.GetBlock(pos, pblockRet)) {
+        return true;
+    }
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    auto pblock = std::make_shared<CBlock>();
+    CBlock& block = *pblock;
+    size_t nSize;
+    CBlockFileCache::MappedFilePtr mappedFile;
+    Span<const unsigned char> blockData;
+    if (blockFileCache.GetRawBlock(pos, Params().MessageStart(), mappedFile, blockData)) {
+        try {
+            SpanReader(SER_DISK, CLIENT_VERSION, blockData) >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        nSize = blockData.size();
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        long nEndPos = ftell(filein.Get());
+        if (nEndPos < 0)
+            return error("ReadBlockFromDisk: ftell failed for %s", pos.ToString());
+        nSize = (size_t)nEndPos - pos.nPos;
     }
 
     // Check the header
     if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 
+    blockFileCache.AddBlock(pos, pblock, nSize);
+    pblockRet = std::move(pblock);
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    block.SetNull();
+
+    std::shared_ptr<const CBlock> pblock;
+    if (!ReadBlockFromDisk(pblock, pos, consensusParams))
+        return false;
+    block = *pblock;
+    return true;
+}
+
+bool ReadBlockFromDisk(std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     CDiskBlockPos blockPos;
     {
@@ -1076,14 +1151,70 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
         blockPos = pindex->GetBlockPos();
     }
 
-    if (!ReadBlockFromDisk(block, blockPos, consensusParams))
+    if (!ReadBlockFromDisk(pblock, blockPos, consensusParams))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash())
+    if (pblock->GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                 pindex->ToString(), pindex->GetBlockPos().ToString());
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    block.SetNull();
+
+    std::shared_ptr<const CBlock> pblock;
+    if (!ReadBlockFromDisk(pblock, pindex, consensusParams))
+        return false;
+    block = *pblock;
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+
+    CBlockFileCache::MappedFilePtr mappedFile;
+    Span<const unsigned char> blockData;
+    if (blockFileCache.GetRawBlock(pos, message_start, mappedFile, blockData)) {
+        block.assign(blockData.begin(), blockData.end());
+        return true;
+    }
+
+    // The block file can't be mapped, read the block and the size in front of it from the file
+    const unsigned int nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.nPos < nHeaderSize) {
+        return error("%s: Invalid position %s", __func__, pos.ToString());
+    }
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - nHeaderSize), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    }
+
+    try {
+        CMessageHeader::MessageStartChars blk_start;
+        unsigned int blk_size;
+        filein >> blk_start >> blk_size;
+        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                    HexStr(blk_start), HexStr(message_start));
+        }
+        if (blk_size > MaxBlockSize()) {
+            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                    blk_size, MaxBlockSize());
+        }
+        block.resize(blk_size);
+        filein.read((char*)block.data(), blk_size);
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 double ConvertBitsToDouble(unsigned int nBits)
 {
     int nShift = (nBits >> 24) & 0xff;
@@ -1412,8 +1543,7 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 
 bool CScriptCheck::operator()() {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    PrecomputedTransactionData txdata(*ptxTo);
-    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, txdata, cacheStore), &error);
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, *txdata, cacheStore, blockPubKeys), &error);
 }
 
 int GetSpendHeight(const CCoinsViewCache& inputs)
@@ -1450,7 +1580,7 @@ void InitScriptExecutionCache() {
  *
  * Non-static (and re-declared) in src/test/txvalidationcache_tests.cpp
  */
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks, const CBlockPubKeys* blockPubKeys) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
     if (!tx.IsCoinBase())
@@ -1495,7 +1625,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 // spent being checked as a part of CScriptCheck.
 
                 // Verify signature
-                CScriptCheck check(coin.out, tx, i, flags, cacheSigStore, &txdata);
+                CScriptCheck check(coin.out, tx, i, flags, cacheSigStore, &txdata, blockPubKeys);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1543,7 +1673,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
 
 namespace {
 
-bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+bool UndoWriteToDisk(const CDataStream& ssUndo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1551,7 +1681,7 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
         return error("%s: OpenUndoFile failed", __func__);
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, blockundo);
+    unsigned int nSize = ssUndo.size();
     fileout << messageStart << nSize;
 
     // Write undo data
@@ -1559,68 +1689,85 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    fileout.write(ssUndo.data(), ssUndo.size());
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
-    hasher << blockundo;
+    hasher.write(ssUndo.data(), ssUndo.size());
     fileout << hasher.GetHash();
 
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+/** Abort with a message */
+static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+    return false;
+}
+
+static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
+{
+    AbortNode(strMessage, userMessage);
+    return state.Error(strMessage);
+}
+
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
         return error("%s: no undo data available", __func__);
     }
 
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    // Open history file to read, starting at the size field of the index header
+    CDiskBlockPos sizePos(pos.nFile, pos.nPos - sizeof(unsigned int));
+    CAutoFile filein(OpenUndoFile(sizePos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
-    // Read block
+    // Read the undo data with a single read and verify the checksum over the raw bytes, which also avoids issues
+    // with reserializing possibly losing data
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
     try {
-        verifier << pindex->pprev->GetBlockHash();
-        verifier >> blockundo;
+        unsigned int nSize;
+        filein >> nSize;
+        if (nSize > MAX_SIZE) {
+            return error("%s: Invalid undo data size %u", __func__, nSize);
+        }
+        ssUndo.resize(nSize);
+        filein.read(ssUndo.data(), nSize);
         filein >> hashChecksum;
     }
     catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        return error("%s: I/O error - %s", __func__, e.what());
     }
 
     // Verify checksum
-    if (hashChecksum != verifier.GetHash())
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << pindex->pprev->GetBlockHash();
+    hasher.write(ssUndo.data(), ssUndo.size());
+    if (hashChecksum != hasher.GetHash())
         return error("%s: Checksum mismatch", __func__);
 
-    return true;
-}
-
-/** Abort with a message */
-static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
-{
-    SetMiscWarning(strMessage);
-    LogPrintf("*** %s\n", strMessage);
-    uiInterface.ThreadSafeMessageBox(
-        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
-        "", CClientUIInterface::MSG_ERROR);
-    StartShutdown();
-    return false;
-}
+    try {
+        ssUndo >> blockundo;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s", __func__, e.what());
+    }
 
-static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
-{
-    AbortNode(strMessage, userMessage);
-    return state.Error(strMessage);
+    return true;
 }
 
-} // namespace
-
 /**
  * Restore the UTXO in a Coin at a given COutPoint
  * @param undo The Coin to be restored.
@@ -1801,22 +1948,10 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     }
 
 
-    if (fSpentIndex) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            AbortNode("Failed to delete spent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
-    if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
+    // the vectors are only filled for the enabled indexes
+    if (!pblocktree->UpdateBlockIndexes(addressIndex, true, fAddressBalanceIndex, addressUnspentIndex, spentIndex, nullptr)) {
+        AbortNode("Failed to update address/spent indexes");
+        return DISCONNECT_FAILED;
     }
 
     // move best block pointer to prevout block
@@ -1864,10 +1999,13 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
 {
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
+        // serialize only once, the same bytes are used for the size, the checksum and the file
+        CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+        ssUndo << blockundo;
         CDiskBlockPos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
+        if (!FindUndoPos(state, pindex->nFile, _pos, ssUndo.size() + 40))
             return error("ConnectBlock(): FindUndoPos failed");
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+        if (!UndoWriteToDisk(ssUndo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
             return AbortNode(state, "Failed to write undo data");
 
         // update nUndoPos in block index
@@ -1891,12 +2029,27 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
-// Protected by cs_main
+/**
+ * Run the input scripts of a mempool transaction on the script check threads, storing
+ * the valid signatures in the signature cache. Failures aren't classified here, so
+ * callers still need to run CheckInputs afterwards, which then mostly hits the cache.
+ */
+static bool CheckInputScriptsParallel(const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags, PrecomputedTransactionData& txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::vector<CScriptCheck> vChecks;
+    CValidationState stateDummy;
+    if (!CheckInputs(tx, stateDummy, inputs, true, flags, true, false, txdata, &vChecks)) {
+        return false;
+    }
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 VersionBitsCache versionbitscache;
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params, bool fCheckMasternodesUpgraded)
 {
-    LOCK(cs_main);
     int32_t nVersion = VERSIONBITS_TOP_BITS;
 
     for (int i = 0; i < (int)Consensus::MAX_VERSION_BITS_DEPLOYMENTS; i++) {
@@ -2058,7 +2211,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     // Special case for the genesis block, skipping connection of its transactions
     // (its coinbase is unspendable)
-    if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock) {
+    if (pindex->GetBlockHash() == chainparams.GetConsensus().hashGenesisBlock) {
         if (!fJustCheck)
             view.SetBestBlock(pindex->GetBlockHash());
         return true;
@@ -2091,8 +2244,18 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             }
         }
     }
+    if (fScriptChecks && nAssumeValidChainLockDepth > 0 && pindexBestHeader->GetAncestor(pindex->nHeight) == pindex) {
+        // A ChainLock is signed by a LLMQ after the block was validated by its members, and its signature was verified
+        // against the quorum which was active at that height. Like -assumevalid, this only moves the trust from the
+        // scripts to someone who validated them, but the anchor follows the chain instead of being a hardcoded hash.
+        fScriptChecks = !llmq::chainLocksHandler->HasChainLockAtDepth(pindex->nHeight, pindex->GetBlockHash(), nAssumeValidChainLockDepth);
+        if (!fScriptChecks) {
+            LogPrint(BCLog::CHAINLOCKS, "%s: skipping script checks for block %s below the best ChainLock\n", __func__, pindex->GetBlockHash().ToString());
+        }
+    }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    g_block_connect_timings.nCheckBlock += nTime1 - nTimeStart;
     LogPrint(BCLog::BENCHMARK, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
@@ -2137,7 +2300,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // make sure old budget is the real one
     if (pindex->nHeight == chainparams.GetConsensus().nSuperblockStartBlock &&
         chainparams.GetConsensus().nSuperblockStartHash != uint256() &&
-        block.GetHash() != chainparams.GetConsensus().nSuperblockStartHash)
+        pindex->GetBlockHash() != chainparams.GetConsensus().nSuperblockStartHash)
             return state.DoS(100, error("ConnectBlock(): invalid superblock start"),
                              REJECT_INVALID, "bad-sb-start");
 
@@ -2157,6 +2320,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     CBlockUndo blockundo;
 
+    // Collect the public keys of the block up front, so that the script check threads parse each of them only once.
+    // It must outlive the checks, which is why it's declared before control.
+    std::unique_ptr<CBlockPubKeys> blockPubKeys;
+    if (fScriptChecks && g_parallel_script_checks) {
+        blockPubKeys = MakeUnique<CBlockPubKeys>(block);
+    }
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && g_parallel_script_checks ? &scriptcheckqueue : nullptr);
 
     std::vector<int> prevheights;
@@ -2270,7 +2439,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (fScriptChecks && !CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], g_parallel_script_checks ? &vChecks : nullptr)) {
+            if (fScriptChecks && !CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], g_parallel_script_checks ? &vChecks : nullptr, blockPubKeys.get())) {
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             }
@@ -2317,77 +2486,94 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    g_block_connect_timings.nScriptChecks += nTime3 - nTime2_1;
     LogPrint(BCLog::BENCHMARK, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
-    if (!control.Wait())
-        return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
-    int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
-    LogPrint(BCLog::BENCHMARK, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
+    // DASH
+
+    // The Dash specific block rules below don't depend on the outcome of script verification, so they are checked
+    // while the script check workers are still busy with the inputs queued above. Script failures still take
+    // precedence over failures of these rules, so the DoS score and reject reason of a block stay the same.
+    CValidationState stateDash;
+    auto checkDashBlockRules = [&]() -> bool {
+        // It's possible that we simply don't have enough data and this could fail
+        // (i.e. block itself could be a correct one and we need to store it),
+        // that's why this is in ConnectBlock. Could be the other way around however -
+        // the peer who sent us this block is missing some data and wasn't able
+        // to recognize that block is actually invalid.
+
+        // DASH : CHECK TRANSACTIONS FOR INSTANTSEND
+
+        if (llmq::RejectConflictingBlocks()) {
+            // Require other nodes to comply, send them some data in case they are missing it.
+            for (const auto& tx : block.vtx) {
+                // skip txes that have no inputs
+                if (tx->vin.empty()) continue;
+                llmq::CInstantSendLockPtr conflictLock = llmq::quorumInstantSendManager->GetConflictingLock(*tx);
+                if (!conflictLock) {
+                    continue;
+                }
+                if (llmq::chainLocksHandler->HasChainLock(pindex->nHeight, pindex->GetBlockHash())) {
+                    llmq::quorumInstantSendManager->RemoveConflictingLock(::SerializeHash(*conflictLock), *conflictLock);
+                    assert(llmq::quorumInstantSendManager->GetConflictingLock(*tx) == nullptr);
+                } else {
+                    // The node which relayed this should switch to correct chain.
+                    // TODO: relay instantsend data/proof.
+                    return stateDash.DoS(10, error("ConnectBlock(DASH): transaction %s conflicts with transaction lock %s", tx->GetHash().ToString(), conflictLock->txid.ToString()),
+                                     REJECT_INVALID, "conflict-tx-lock");
+                }
+            }
+        } else if (!fReindex && !fImporting) {
+            LogPrintf("ConnectBlock(DASH): spork is off, skipping transaction locking checks\n");
+        }
 
+        int64_t nTime5_1 = GetTimeMicros(); nTimeISFilter += nTime5_1 - nTime3;
+        LogPrint(BCLog::BENCHMARK, "      - IS filter: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_1 - nTime3), nTimeISFilter * MICRO, nTimeISFilter * MILLI / nBlocksTotal);
 
-    // DASH
+        // DASH : MODIFIED TO CHECK MASTERNODE PAYMENTS AND SUPERBLOCKS
 
-    // It's possible that we simply don't have enough data and this could fail
-    // (i.e. block itself could be a correct one and we need to store it),
-    // that's why this is in ConnectBlock. Could be the other way around however -
-    // the peer who sent us this block is missing some data and wasn't able
-    // to recognize that block is actually invalid.
+        // TODO: resync data (both ways?) and try to reprocess this block later.
+        CAmount blockReward = nFees + GetBlockSubsidy(pindex->pprev->nBits, pindex->pprev->nHeight, chainparams.GetConsensus());
+        std::string strError = "";
 
-    // DASH : CHECK TRANSACTIONS FOR INSTANTSEND
+        int64_t nTime5_2 = GetTimeMicros(); nTimeSubsidy += nTime5_2 - nTime5_1;
+        LogPrint(BCLog::BENCHMARK, "      - GetBlockSubsidy: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_2 - nTime5_1), nTimeSubsidy * MICRO, nTimeSubsidy * MILLI / nBlocksTotal);
 
-    if (llmq::RejectConflictingBlocks()) {
-        // Require other nodes to comply, send them some data in case they are missing it.
-        for (const auto& tx : block.vtx) {
-            // skip txes that have no inputs
-            if (tx->vin.empty()) continue;
-            llmq::CInstantSendLockPtr conflictLock = llmq::quorumInstantSendManager->GetConflictingLock(*tx);
-            if (!conflictLock) {
-                continue;
-            }
-            if (llmq::chainLocksHandler->HasChainLock(pindex->nHeight, pindex->GetBlockHash())) {
-                llmq::quorumInstantSendManager->RemoveConflictingLock(::SerializeHash(*conflictLock), *conflictLock);
-                assert(llmq::quorumInstantSendManager->GetConflictingLock(*tx) == nullptr);
-            } else {
-                // The node which relayed this should switch to correct chain.
-                // TODO: relay instantsend data/proof.
-                return state.DoS(10, error("ConnectBlock(DASH): transaction %s conflicts with transaction lock %s", tx->GetHash().ToString(), conflictLock->txid.ToString()),
-                                 REJECT_INVALID, "conflict-tx-lock");
-            }
+        if (!IsBlockValueValid(block, pindex->nHeight, blockReward, strError)) {
+            return stateDash.DoS(0, error("ConnectBlock(DASH): %s", strError), REJECT_INVALID, "bad-cb-amount");
         }
-    } else if (!fReindex && !fImporting) {
-        LogPrintf("ConnectBlock(DASH): spork is off, skipping transaction locking checks\n");
-    }
 
-    int64_t nTime5_1 = GetTimeMicros(); nTimeISFilter += nTime5_1 - nTime4;
-    LogPrint(BCLog::BENCHMARK, "      - IS filter: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_1 - nTime4), nTimeISFilter * MICRO, nTimeISFilter * MILLI / nBlocksTotal);
+        int64_t nTime5_3 = GetTimeMicros(); nTimeValueValid += nTime5_3 - nTime5_2;
+        LogPrint(BCLog::BENCHMARK, "      - IsBlockValueValid: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_3 - nTime5_2), nTimeValueValid * MICRO, nTimeValueValid * MILLI / nBlocksTotal);
 
-    // DASH : MODIFIED TO CHECK MASTERNODE PAYMENTS AND SUPERBLOCKS
+        if (!IsBlockPayeeValid(*block.vtx[0], pindex->nHeight, blockReward)) {
+            return stateDash.DoS(0, error("ConnectBlock(DASH): couldn't find masternode or superblock payments"),
+                                    REJECT_INVALID, "bad-cb-payee");
+        }
 
-    // TODO: resync data (both ways?) and try to reprocess this block later.
-    CAmount blockReward = nFees + GetBlockSubsidy(pindex->pprev->nBits, pindex->pprev->nHeight, chainparams.GetConsensus());
-    std::string strError = "";
+        int64_t nTime5_4 = GetTimeMicros(); nTimePayeeValid += nTime5_4 - nTime5_3;
+        LogPrint(BCLog::BENCHMARK, "      - IsBlockPayeeValid: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_4 - nTime5_3), nTimePayeeValid * MICRO, nTimePayeeValid * MILLI / nBlocksTotal);
 
-    int64_t nTime5_2 = GetTimeMicros(); nTimeSubsidy += nTime5_2 - nTime5_1;
-    LogPrint(BCLog::BENCHMARK, "      - GetBlockSubsidy: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_2 - nTime5_1), nTimeSubsidy * MICRO, nTimeSubsidy * MILLI / nBlocksTotal);
+        int64_t nTime4 = GetTimeMicros(); nTimeDashSpecific += nTime4 - nTime3;
+        LogPrint(BCLog::BENCHMARK, "    - Dash specific: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime4 - nTime3), nTimeDashSpecific * MICRO, nTimeDashSpecific * MILLI / nBlocksTotal);
 
-    if (!IsBlockValueValid(block, pindex->nHeight, blockReward, strError)) {
-        return state.DoS(0, error("ConnectBlock(DASH): %s", strError), REJECT_INVALID, "bad-cb-amount");
-    }
+        return true;
+    };
+    bool fDashValid = checkDashBlockRules();
+    int64_t nTime4_1 = GetTimeMicros();
+    g_block_connect_timings.nDashSpecific += nTime4_1 - nTime3;
 
-    int64_t nTime5_3 = GetTimeMicros(); nTimeValueValid += nTime5_3 - nTime5_2;
-    LogPrint(BCLog::BENCHMARK, "      - IsBlockValueValid: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_3 - nTime5_2), nTimeValueValid * MICRO, nTimeValueValid * MILLI / nBlocksTotal);
+    if (!control.Wait())
+        return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    int64_t nTime5 = GetTimeMicros(); nTimeVerify += nTime5 - nTime2;
+    g_block_connect_timings.nScriptChecks += nTime5 - nTime4_1;
+    LogPrint(BCLog::BENCHMARK, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime5 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime5 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
-    if (!IsBlockPayeeValid(*block.vtx[0], pindex->nHeight, blockReward)) {
-        return state.DoS(0, error("ConnectBlock(DASH): couldn't find masternode or superblock payments"),
-                                REJECT_INVALID, "bad-cb-payee");
+    if (!fDashValid) {
+        state = stateDash;
+        return false;
     }
 
-    int64_t nTime5_4 = GetTimeMicros(); nTimePayeeValid += nTime5_4 - nTime5_3;
-    LogPrint(BCLog::BENCHMARK, "      - IsBlockPayeeValid: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_4 - nTime5_3), nTimePayeeValid * MICRO, nTimePayeeValid * MILLI / nBlocksTotal);
-
-    int64_t nTime5 = GetTimeMicros(); nTimeDashSpecific += nTime5 - nTime4;
-    LogPrint(BCLog::BENCHMARK, "    - Dash specific: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeDashSpecific * MICRO, nTimeDashSpecific * MILLI / nBlocksTotal);
-
     // END DASH
 
     if (fJustCheck)
@@ -2401,29 +2587,18 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
+    // the vectors are only filled for the enabled indexes, write all of them with a single batch
+    const CTimestampIndexKey timestampIndex(pindex->nTime, pindex->GetBlockHash());
+    if (!pblocktree->UpdateBlockIndexes(addressIndex, false, fAddressBalanceIndex, addressUnspentIndex, spentIndex, fTimestampIndex ? &timestampIndex : nullptr)) {
+        return AbortNode(state, "Failed to write address/spent/timestamp indexes");
     }
 
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (fTimestampIndex)
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime6 = GetTimeMicros(); nTimeIndex += nTime6 - nTime5;
+    g_block_connect_timings.nIndexes += nTime6 - nTime5;
     LogPrint(BCLog::BENCHMARK, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime6 - nTime5), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
     evoDb->WriteBestBlock(pindex->GetBlockHash());
@@ -2431,6 +2606,16 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int64_t nTime7 = GetTimeMicros(); nTimeCallbacks += nTime7 - nTime6;
     LogPrint(BCLog::BENCHMARK, "    - Callbacks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime7 - nTime6), nTimeCallbacks * MICRO, nTimeCallbacks * MILLI / nBlocksTotal);
 
+    TRACE7(validation, connectblock_stages,
+        pindex->phashBlock->begin(),
+        pindex->nHeight,
+        nTime1 - nTimeStart, // sanity checks
+        nTime2 - nTime1, // fork checks
+        nTime3 - nTime2, // connect transactions, including special txes
+        nTime5 - nTime3, // Dash specific checks and waiting for script checks
+        nTime7 - nTime5 // undo data, indexes and callbacks
+    );
+
     boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
     boost::posix_time::time_duration diff = finish - start;
     statsClient.timing("ConnectBlock_ms", diff.total_milliseconds(), 1.0f);
@@ -2497,18 +2682,24 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
         int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
-        cacheSize += evoDb->GetMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
+        // EvoDB has its own budget (-evodbcache), but it can only be flushed together with the coins cache as both have
+        // to agree on the best block.
+        int64_t nEvoDbSize = evoDb->GetMemoryUsage();
+        int64_t nEvoDbSpace = evoDb->GetMaxMemoryUsage();
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
-        bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
+        bool fCacheLarge = mode == FlushStateMode::PERIODIC && (cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024) ||
+                                                               nEvoDbSize > (9 * nEvoDbSpace) / 10);
         // The cache is over the limit, we have to write now.
-        bool fCacheCritical = mode == FlushStateMode::IF_NEEDED && cacheSize > nCoinCacheUsage;
+        bool fCacheCritical = mode == FlushStateMode::IF_NEEDED && (cacheSize > (int64_t)nCoinCacheUsage || nEvoDbSize > nEvoDbSpace);
         // It's been a while since we wrote the block index to disk. Do this frequently, so we don't need to redownload after a crash.
         bool fPeriodicWrite = mode == FlushStateMode::PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // Only empty the coins cache when it has to shrink, otherwise write the dirty coins but keep it warm.
+        bool fEmptyCache = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical;
         // Write blocks and block index to disk.
         if (fDoFullFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
@@ -2562,12 +2753,14 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
+            int64_t nFlushStart = GetTimeMicros();
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            if (!(fEmptyCache ? pcoinsTip->Flush() : pcoinsTip->Sync()))
                 return AbortNode(state, "Failed to write to coin database");
             if (!evoDb->CommitRootTransaction()) {
                 return AbortNode(state, "Failed to commit EvoDB");
             }
+            TRACE5(utxocache, flush, GetTimeMicros() - nFlushStart, (int)mode, coins_count, coins_mem_usage, fEmptyCache);
             nLastFlush = nNow;
             full_flush_completed = true;
         }
@@ -2627,6 +2820,8 @@ void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainPar
         g_best_block_cv.notify_all();
     }
 
+    versionbitscache.UpdateTip(pindexNew, chainParams.GetConsensus());
+
     std::string warningMessages;
     if (!IsInitialBlockDownload())
     {
@@ -2687,10 +2882,10 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     CBlockIndex *pindexDelete = chainActive.Tip();
     assert(pindexDelete);
     // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus()))
+    std::shared_ptr<const CBlock> pblock;
+    if (!ReadBlockFromDisk(pblock, pindexDelete, chainparams.GetConsensus()))
         return error("DisconnectTip(): Failed to read block");
+    const CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
@@ -2732,6 +2927,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2816,10 +3012,8 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+        if (!ReadBlockFromDisk(pthisBlock, pindexNew, chainparams.GetConsensus()))
             return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
     }
@@ -2828,6 +3022,25 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    {
+        // Read the coins spent by this block from the coins DB in parallel instead of one by one in ConnectBlock.
+        // Holding cs_main guarantees that the DB is not flushed to while reading.
+        static const int MAX_COINS_PREFETCH_THREADS = 8;
+        std::vector<COutPoint> vPrevouts;
+        for (const auto& tx : blockConnecting.vtx) {
+            if (tx->IsCoinBase()) {
+                continue;
+            }
+            for (const auto& txin : tx->vin) {
+                vPrevouts.emplace_back(txin.prevout);
+            }
+        }
+        auto stats = pcoinsTip->Prefetch(vPrevouts, std::min(GetNumCores(), MAX_COINS_PREFETCH_THREADS));
+        int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+        LogPrint(BCLog::BENCHMARK, "  - Prefetch coins: %.2fms [%.2fs] (%u cached, %u fetched, %u missing)\n", (nTimePrefetched - nTime2) * MILLI, nTimePrefetch * MICRO,
+                 stats.nCached, stats.nFetched, stats.nMissing);
+        nTime2 = nTimePrefetched;
+    }
     {
         auto dbTx = evoDb->BeginTransaction();
 
@@ -2863,6 +3076,15 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     LogPrint(BCLog::BENCHMARK, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCHMARK, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
+    TRACE6(validation, block_connected,
+        pindexNew->phashBlock->begin(),
+        pindexNew->nHeight,
+        blockConnecting.vtx.size(),
+        nTime3 - nTime2, // ConnectBlock
+        nTime4 - nTime3, // coins cache and evodb flush
+        nTime6 - nTime1 // total
+    );
+
     boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
     boost::posix_time::time_duration diff = finish - start;
     statsClient.timing("ConnectTip_ms", diff.total_milliseconds(), 1.0f);
@@ -2959,6 +3181,9 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
+    if (chainActive.Tip() && pindexFork && chainActive.Tip() != pindexFork) {
+        PrepareUndoSpecialTxsInBlocks(chainActive.Tip(), pindexFork);
+    }
     while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
         if (!DisconnectTip(state, chainparams, &disconnectpool)) {
             // This is likely a fatal error, but keep the mempool consistent,
@@ -2991,6 +3216,10 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
         }
         nHeight = nTargetHeight;
 
+        if (IsInitialBlockDownload()) {
+            PreVerifySpecialTxsInBlocks(vpindexToConnect, chainparams.GetConsensus());
+        }
+
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
@@ -3085,6 +3314,7 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
 
     CBlockIndex *pindexMostWork = nullptr;
     CBlockIndex *pindexNewTip = nullptr;
+    const uint256 hashBlock = pblock ? pblock->GetHash() : uint256();
     int nStopAtHeight = gArgs.GetArg("-stopatheight", DEFAULT_STOPATHEIGHT);
     do {
         boost::this_thread::interruption_point();
@@ -3119,7 +3349,7 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
 
                 bool fInvalidFound = false;
                 std::shared_ptr<const CBlock> nullBlockPtr;
-                if (!ActivateBestChainStep(state, chainparams, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace))
+                if (!ActivateBestChainStep(state, chainparams, pindexMostWork, pblock && hashBlock == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace))
                     return false;
                 blocks_connected = true;
 
@@ -3420,19 +3650,19 @@ void ResetBlockFailureFlags(CBlockIndex *pindex) {
     return g_chainstate.ResetBlockFailureFlags(pindex);
 }
 
-CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block, enum BlockStatus nStatus)
+CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block, const uint256& hash, enum BlockStatus nStatus)
 {
     assert(!(nStatus & BLOCK_FAILED_MASK)); // no failed blocks alowed
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = NewBlockIndex();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3601,16 +3831,17 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+/** Context-independent header checks. The caller passes in the X11 hash of the header, so that it is computed only once per header. */
+static bool CheckBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(hash, block.nBits, consensusParams))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     // Check DevNet
     if (!consensusParams.hashDevnetGenesisBlock.IsNull() &&
             block.hashPrevBlock == consensusParams.hashGenesisBlock &&
-            block.GetHash() != consensusParams.hashDevnetGenesisBlock) {
+            hash != consensusParams.hashDevnetGenesisBlock) {
         return state.DoS(100, error("CheckBlockHeader(): wrong devnet genesis"),
                          REJECT_INVALID, "devnet-genesis");
     }
@@ -3629,7 +3860,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
+    if (!CheckBlockHeader(block, block.GetHash(), state, consensusParams, fCheckPOW))
         return false;
 
     // Check the merkle root.
@@ -3811,11 +4042,10 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
 
@@ -3833,7 +4063,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, hash, state, chainparams.GetConsensus()))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3894,13 +4124,13 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 
         if (llmq::chainLocksHandler->HasConflictingChainLock(pindexPrev->nHeight + 1, hash)) {
             if (pindex == nullptr) {
-                AddToBlockIndex(block, BLOCK_CONFLICT_CHAINLOCK);
+                AddToBlockIndex(block, hash, BLOCK_CONFLICT_CHAINLOCK);
             }
             return state.DoS(10, error("%s: header %s conflicts with chainlock", __func__, hash.ToString()), REJECT_INVALID, "bad-chainlock");
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3913,15 +4143,47 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
     return true;
 }
 
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    // spawning a thread is not worth it for less than this many headers
+    static const size_t MIN_HEADERS_PER_THREAD = 128;
+    static const int MAX_HEADER_HASH_THREADS = 8;
+
+    std::vector<uint256> hashes(headers.size());
+    const int nThreads = (int)std::max<size_t>(1, std::min<size_t>(std::min(GetNumCores(), MAX_HEADER_HASH_THREADS), headers.size() / MIN_HEADERS_PER_THREAD));
+    auto hash = [&](int nThread) {
+        for (size_t i = nThread; i < headers.size(); i += nThreads) {
+            hashes[i] = headers[i].GetHash();
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    for (int i = 1; i < nThreads; i++) {
+        vThreads.emplace_back(hash, i);
+    }
+    hash(0);
+    for (auto& t : vThreads) {
+        t.join();
+    }
+    return hashes;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
+    return ProcessNewBlockHeaders(headers, GetBlockHeaderHashes(headers), state, chainparams, ppindex, first_invalid);
+}
+
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+{
+    assert(headers.size() == hashes.size());
     if (first_invalid != nullptr) first_invalid->SetNull();
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, hashes[i], state, chainparams, &pindex)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3966,7 +4228,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex))
+    if (!AcceptBlockHeader(block, block.GetHash(), state, chainparams, &pindex))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -4086,11 +4348,10 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     }
 
     CCoinsViewCache viewNew(pcoinsTip.get());
-    uint256 block_hash(block.GetHash());
     CBlockIndex indexDummy(block);
     indexDummy.pprev = pindexPrev;
     indexDummy.nHeight = pindexPrev->nHeight + 1;
-    indexDummy.phashBlock = &block_hash;
+    indexDummy.phashBlock = &hash;
 
     // begin tx and let it rollback
     auto dbTx = evoDb->BeginTransaction();
@@ -4162,6 +4423,7 @@ void PruneOneBlockFile(const int fileNumber)
 
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
+    blockFileCache.RemoveFiles(setFilesToPrune);
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
         fs::remove(GetBlockPosFilename(pos, "blk"));
@@ -4321,6 +4583,17 @@ fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix)
     return GetBlocksDir() / strprintf("%s%05u.dat", prefix, pos.nFile);
 }
 
+CBlockIndex* CChainState::NewBlockIndex()
+{
+    AssertLockHeld(cs_main);
+
+    if (m_block_index_chunk_used == BLOCK_INDEX_CHUNK_SIZE) {
+        m_block_index_chunks.emplace_back(new CBlockIndex[BLOCK_INDEX_CHUNK_SIZE]);
+        m_block_index_chunk_used = 0;
+    }
+    return &m_block_index_chunks.back()[m_block_index_chunk_used++];
+}
+
 CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -4334,7 +4607,7 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = NewBlockIndex();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -4343,8 +4616,11 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 
 bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlockTreeDB& blocktree)
 {
+    int64_t nTime1 = GetTimeMicros();
     if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
         return false;
+    int64_t nTime2 = GetTimeMicros();
+    LogPrint(BCLog::BENCHMARK, "%s: read %u block index entries: %.2fms\n", __func__, mapBlockIndex.size(), MILLI * (nTime2 - nTime1));
 
     // Calculate nChainWork
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
@@ -4360,6 +4636,8 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
         }
     }
     sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    int64_t nTime3 = GetTimeMicros();
+    LogPrint(BCLog::BENCHMARK, "%s: sort by height: %.2fms\n", __func__, MILLI * (nTime3 - nTime2));
     for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight)
     {
         if (ShutdownRequested()) return false;
@@ -4393,6 +4671,8 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
     }
+    int64_t nTime4 = GetTimeMicros();
+    LogPrint(BCLog::BENCHMARK, "%s: calculate chain work and link skip pointers: %.2fms\n", __func__, MILLI * (nTime4 - nTime3));
 
     return true;
 }
@@ -4451,6 +4731,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Check whether we have an address balance index
+    pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+    LogPrintf("%s: address balance index %s\n", __func__, fAddressBalanceIndex ? "enabled" : "disabled");
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -4608,6 +4892,107 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     return true;
 }
 
+bool ReplayBlocksForBenchmark(const CChainParams& chainparams, int nBlocks, CBlockReplayStats& statsRet, std::string& strError)
+{
+    LOCK(cs_main);
+    statsRet = CBlockReplayStats();
+    if (chainActive.Tip() == nullptr || nBlocks <= 0 || nBlocks >= chainActive.Height()) {
+        strError = "Invalid number of blocks";
+        return false;
+    }
+
+    // begin tx and let it rollback, same as VerifyDB
+    auto dbTx = evoDb->BeginTransaction();
+    CCoinsViewCache coins(pcoinsTip.get());
+    CValidationState state;
+
+    int64_t nTimeStart = GetTimeMicros();
+    CBlockIndex* pindex = chainActive.Tip();
+    for (; pindex->nHeight > chainActive.Height() - nBlocks; pindex = pindex->pprev) {
+        if (ShutdownRequested()) {
+            strError = "Shutdown requested";
+            return false;
+        }
+        if ((coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) > nCoinCacheUsage) {
+            LogPrintf("%s: coins cache is full, replaying from height %d only\n", __func__, pindex->nHeight + 1);
+            break;
+        }
+        CBlock block;
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            strError = strprintf("Failed to read block %s", pindex->GetBlockHash().ToString());
+            return false;
+        }
+        if (g_chainstate.DisconnectBlock(block, pindex, coins) != DISCONNECT_OK) {
+            strError = strprintf("Failed to disconnect block %s", pindex->GetBlockHash().ToString());
+            return false;
+        }
+    }
+    statsRet.nTimeDisconnect = GetTimeMicros() - nTimeStart;
+    if (pindex == chainActive.Tip()) {
+        strError = "Coins cache is too small to disconnect any block";
+        return false;
+    }
+    statsRet.nStartHeight = pindex->nHeight + 1;
+    statsRet.nEndHeight = chainActive.Height();
+
+    const CBlockConnectTimings timingsStart = g_block_connect_timings;
+    const uint64_t nEvoDbWriteMicrosStart = evoDb->GetWriteMicros();
+    nTimeStart = GetTimeMicros();
+    while (pindex != chainActive.Tip()) {
+        if (ShutdownRequested()) {
+            strError = "Shutdown requested";
+            return false;
+        }
+        pindex = chainActive.Next(pindex);
+
+        int64_t nTime1 = GetTimeMicros();
+        std::vector<unsigned char> vchBlock;
+        if (!ReadRawBlockFromDisk(vchBlock, pindex, chainparams.MessageStart())) {
+            strError = strprintf("Failed to read block %s", pindex->GetBlockHash().ToString());
+            return false;
+        }
+        int64_t nTime2 = GetTimeMicros();
+        CBlock block;
+        try {
+            VectorReader(SER_DISK, CLIENT_VERSION, vchBlock, 0) >> block;
+        } catch (const std::exception& e) {
+            strError = strprintf("Failed to deserialize block %s: %s", pindex->GetBlockHash().ToString(), e.what());
+            return false;
+        }
+        if (block.GetHash() != pindex->GetBlockHash()) {
+            strError = strprintf("Block file contains %s instead of %s", block.GetHash().ToString(), pindex->GetBlockHash().ToString());
+            return false;
+        }
+        int64_t nTime3 = GetTimeMicros();
+        CCoinsViewCache view(&coins);
+        if (!g_chainstate.ConnectBlock(block, state, pindex, view, chainparams)) {
+            strError = strprintf("Failed to connect block %s: %s", pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+            return false;
+        }
+        int64_t nTime4 = GetTimeMicros();
+        bool flushed = view.Flush();
+        assert(flushed);
+        int64_t nTime5 = GetTimeMicros();
+
+        statsRet.nTimeReadFromDisk += nTime2 - nTime1;
+        statsRet.nTimeDeserialize += nTime3 - nTime2;
+        statsRet.nTimeConnectBlock += nTime4 - nTime3;
+        statsRet.nTimeCoinsFlush += nTime5 - nTime4;
+        statsRet.nTxs += block.vtx.size();
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                statsRet.nInputs += tx->vin.size();
+            }
+        }
+    }
+    statsRet.nTimeTotal = GetTimeMicros() - nTimeStart;
+    statsRet.connect = g_block_connect_timings - timingsStart;
+    statsRet.nTimeEvoDbWrites = evoDb->GetWriteMicros() - nEvoDbWriteMicrosStart;
+
+    LogPrintf("%s: replayed blocks %d-%d in %.2fms\n", __func__, statsRet.nStartHeight, statsRet.nEndHeight, statsRet.nTimeTotal * MILLI);
+    return true;
+}
+
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
 bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
 {
@@ -4719,6 +5104,8 @@ void CChainState::UnloadBlockIndex() {
     nBlockSequenceId = 1;
     m_failed_blocks.clear();
     setBlockIndexCandidates.clear();
+    m_block_index_chunks.clear();
+    m_block_index_chunk_used = BLOCK_INDEX_CHUNK_SIZE;
 }
 
 // May NOT be used after any connections are up as much
@@ -4734,6 +5121,7 @@ void UnloadBlockIndex()
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
+    blockFileCache.Clear();
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
     versionbitscache.Clear();
@@ -4741,9 +5129,6 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
     fHavePruned = false;
 
@@ -4773,6 +5158,10 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         pblocktree->WriteFlag("addressindex", fAddressIndex);
 
+        // Use the provided setting for -addressbalanceindex in the new database
+        fAddressBalanceIndex = fAddressIndex && gArgs.GetBoolArg("-addressbalanceindex", DEFAULT_ADDRESSBALANCEINDEX);
+        pblocktree->WriteFlag("addressbalanceindex", fAddressBalanceIndex);
+
         // Use the provided setting for -timestampindex in the new database
         fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
         pblocktree->WriteFlag("timestampindex", fTimestampIndex);
@@ -4789,7 +5178,7 @@ bool CChainState::AddGenesisBlock(const CChainParams& chainparams, const CBlock&
     CDiskBlockPos blockPos = SaveBlockToDisk(block, 0, chainparams, nullptr);
     if (blockPos.IsNull())
         return error("%s: writing genesis block to disk failed (%s)", __func__, FormatStateMessage(state));
-    CBlockIndex *pindex = AddToBlockIndex(block);
+    CBlockIndex *pindex = AddToBlockIndex(block, block.GetHash());
     ReceivedBlockTransactions(block, pindex, blockPos);
     return true;
 }
@@ -5172,7 +5561,55 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+//! Version 1 files don't contain the islocks of the transactions
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_ISLOCKS = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+//! Number of transactions read from mempool.dat at once, the signatures of each batch are verified in parallel
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+struct MempoolDumpEntry
+{
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+    llmq::CInstantSendLockPtr islock;
+};
+
+/**
+ * Verify the signatures of a batch of transactions read from mempool.dat on the script check threads, so that
+ * accepting them one by one under cs_main afterwards mostly hits the signature cache. Transactions may spend outputs
+ * of earlier ones of the same batch. Failures are left to AcceptToMemoryPool, which reports them the usual way.
+ */
+static void VerifyMempoolBatchScripts(const std::vector<MempoolDumpEntry>& batch)
+{
+    if (!g_parallel_script_checks) {
+        return;
+    }
+    std::vector<CScriptCheck> vChecks;
+    // the checks keep pointers into it, so it must not reallocate
+    std::deque<PrecomputedTransactionData> txdata;
+    {
+        LOCK2(cs_main, mempool.cs);
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), mempool);
+        CCoinsViewCache view(&viewMemPool);
+        for (const auto& entry : batch) {
+            const CTransaction& tx = *entry.tx;
+            bool fHaveInputs = !tx.IsCoinBase();
+            for (const auto& txin : tx.vin) {
+                fHaveInputs &= view.HaveCoin(txin.prevout);
+            }
+            if (fHaveInputs) {
+                txdata.emplace_back(tx);
+                CValidationState stateDummy;
+                CheckInputs(tx, stateDummy, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata.back(), &vChecks);
+            }
+            AddCoins(view, tx, MEMPOOL_HEIGHT, true);
+        }
+    }
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
 
 bool LoadMempool()
 {
@@ -5189,33 +5626,54 @@ bool LoadMempool()
     int64_t expired = 0;
     int64_t failed = 0;
     int64_t already_there = 0;
+    int64_t restored_islocks = 0;
     int64_t nNow = GetTime();
+    int64_t nStart = GetTimeMicros();
 
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_ISLOCKS) {
             return false;
         }
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        std::vector<MempoolDumpEntry> batch;
+        while (num) {
+            batch.clear();
+            for (; num && batch.size() < MEMPOOL_LOAD_BATCH_SIZE; num--) {
+                MempoolDumpEntry entry;
+                file >> entry.tx;
+                file >> entry.nTime;
+                file >> entry.nFeeDelta;
+                if (version != MEMPOOL_DUMP_VERSION_NO_ISLOCKS) {
+                    bool fHasISLock;
+                    file >> fHasISLock;
+                    if (fHasISLock) {
+                        entry.islock = std::make_shared<llmq::CInstantSendLock>();
+                        file >> *entry.islock;
+                    }
+                }
+                if (entry.nTime + nExpiryTimeout > nNow) {
+                    batch.emplace_back(std::move(entry));
+                } else {
+                    ++expired;
+                }
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           false /* bypass_limits */, 0 /* nAbsurdFee */, false /* test_accept */);
+            VerifyMempoolBatchScripts(batch);
+
+            for (const auto& entry : batch) {
+                const CTransactionRef& tx = entry.tx;
+                CAmount amountdelta = entry.nFeeDelta;
+                if (amountdelta) {
+                    mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                }
+                CValidationState state;
+                {
+                    LOCK(cs_main);
+                    AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, entry.nTime,
+                                               false /* bypass_limits */, 0 /* nAbsurdFee */, false /* test_accept */);
+                }
                 if (state.IsValid()) {
                     ++count;
                 } else {
@@ -5227,10 +5685,15 @@ bool LoadMempool()
                         ++already_there;
                     } else {
                         ++failed;
+                        continue;
                     }
                 }
-            } else {
-                ++expired;
+                // The islock is normally still in the InstantSend db. If it isn't, e.g. because it was pruned in the
+                // meantime, queue it for verification instead of waiting for the quorum to sign it again.
+                if (entry.islock && entry.islock->txid == tx->GetHash() && llmq::quorumInstantSendManager &&
+                    llmq::quorumInstantSendManager->RestoreInstantSendLock(entry.islock)) {
+                    ++restored_islocks;
+                }
             }
             if (ShutdownRequested())
                 return false;
@@ -5246,7 +5709,8 @@ bool LoadMempool()
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there, %i islocks restored (%.2fs)\n",
+              count, failed, expired, already_there, restored_islocks, (GetTimeMicros() - nStart) * MICRO);
     return true;
 }
 
@@ -5286,6 +5750,12 @@ bool DumpMempool()
             file << *(i.tx);
             file << (int64_t)i.nTime;
             file << (int64_t)i.nFeeDelta;
+            // so that the lock survives even if the InstantSend db doesn't have it anymore when loading
+            llmq::CInstantSendLockPtr islock = llmq::quorumInstantSendManager ? llmq::quorumInstantSendManager->GetInstantSendLockByTxid(i.tx->GetHash()) : nullptr;
+            file << (islock != nullptr);
+            if (islock) {
+                file << *islock;
+            }
             mapDeltas.erase(i.tx->GetHash());
         }
 
@@ -35,12 +35,14 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
 class CScriptCheck;
 class CBlockPolicyEstimator;
+class CBlockPubKeys;
 class CTxMemPool;
 class CValidationState;
 class PrecomputedTransactionData;
@@ -119,8 +121,12 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const unsigned int DEFAULT_BYTES_PER_SIGOP = 20;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -assumevalidchainlockdepth, 0 disables skipping script checks below ChainLocks */
+static const int DEFAULT_ASSUMEVALID_CHAINLOCK_DEPTH = 0;
 static const bool DEFAULT_TXINDEX = true;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_ADDRESSBALANCEINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
@@ -136,6 +142,7 @@ static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static const int MAX_UNCONNECTING_HEADERS = 10;
 
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
 
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
@@ -163,6 +170,7 @@ extern uint256 g_best_block;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern bool fAddressIndex;
+extern bool fAddressBalanceIndex;
 extern bool fTimestampIndex;
 extern bool fSpentIndex;
 extern bool fIsBareMultisigStd;
@@ -190,6 +198,9 @@ extern std::atomic<bool> fDIP0001ActiveAtTip;
 /** Block hash whose ancestors we will assume to have valid scripts without checking them. */
 extern uint256 hashAssumeValid;
 
+/** Blocks at least this deep below a verified ChainLock are assumed to have valid scripts, 0 if disabled. */
+extern int nAssumeValidChainLockDepth;
+
 /** Minimum work we will assume exists on some valid chain. */
 extern arith_uint256 nMinimumChainWork;
 
@@ -260,6 +271,16 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
 
+/** Same as above, with the hashes of the headers already computed by GetBlockHeaderHashes() */
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
+
+/**
+ * Compute the hashes of a batch of block headers. Large batches, like the ones
+ * received during headers sync, are hashed on several threads. Doesn't need
+ * cs_main, so callers should do this before taking it.
+ */
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers);
+
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0, bool blocks_dir = false);
 /** Open a block file (blk?????.dat) */
@@ -387,11 +408,12 @@ private:
     bool cacheStore;
     ScriptError error;
     PrecomputedTransactionData *txdata;
+    const CBlockPubKeys *blockPubKeys;
 
 public:
-    CScriptCheck(): ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
-    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
-        m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
+    CScriptCheck(): ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), blockPubKeys(nullptr) {}
+    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn, const CBlockPubKeys* blockPubKeysIn = nullptr) :
+        m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn), blockPubKeys(blockPubKeysIn) { }
 
     bool operator()();
 
@@ -403,6 +425,7 @@ public:
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
+        std::swap(blockPubKeys, check.blockPubKeys);
     }
 
     ScriptError GetScriptError() const { return error; }
@@ -412,7 +435,8 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::v
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t limit = 0);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 /** Initializes the script-execution cache */
@@ -422,6 +446,12 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Same as above, but the block is shared with the cache of recently read blocks instead of being copied */
+bool ReadBlockFromDisk(std::shared_ptr<const CBlock>& pblock, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
+bool ReadBlockFromDisk(std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the block at pindex as it is stored on disk, without decoding it. Network and disk serialization are the same. */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -442,6 +472,75 @@ public:
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
+/**
+ * Time in microseconds ConnectBlock spent in its stages, accumulated over all blocks connected since startup. The
+ * difference between two readings gives the costs of the blocks connected in between.
+ */
+struct CBlockConnectTimings
+{
+    //! CheckBlock and the other checks in front of the transactions
+    int64_t nCheckBlock{0};
+    //! the per transaction checks of ProcessSpecialTxsInBlock, including ProTx and quorum commitment signatures
+    int64_t nSpecialTxs{0};
+    //! CQuorumBlockProcessor::ProcessBlock
+    int64_t nQuorumCommitments{0};
+    //! CDeterministicMNManager::ProcessBlock
+    int64_t nDMNList{0};
+    //! CheckCbTxMerkleRoots
+    int64_t nCbTxMerkleRoots{0};
+    //! checking and spending the inputs and waiting for the script check workers
+    int64_t nScriptChecks{0};
+    //! InstantSend conflicts, block value and payee, checked while the script check workers are busy
+    int64_t nDashSpecific{0};
+    //! undo data and address/spent/timestamp indexes
+    int64_t nIndexes{0};
+
+    CBlockConnectTimings operator-(const CBlockConnectTimings& other) const
+    {
+        CBlockConnectTimings ret;
+        ret.nCheckBlock = nCheckBlock - other.nCheckBlock;
+        ret.nSpecialTxs = nSpecialTxs - other.nSpecialTxs;
+        ret.nQuorumCommitments = nQuorumCommitments - other.nQuorumCommitments;
+        ret.nDMNList = nDMNList - other.nDMNList;
+        ret.nCbTxMerkleRoots = nCbTxMerkleRoots - other.nCbTxMerkleRoots;
+        ret.nScriptChecks = nScriptChecks - other.nScriptChecks;
+        ret.nDashSpecific = nDashSpecific - other.nDashSpecific;
+        ret.nIndexes = nIndexes - other.nIndexes;
+        return ret;
+    }
+};
+extern CBlockConnectTimings g_block_connect_timings GUARDED_BY(cs_main);
+
+/** Time in microseconds spent on the blocks replayed by ReplayBlocksForBenchmark */
+struct CBlockReplayStats
+{
+    int nStartHeight{0};
+    int nEndHeight{0};
+    size_t nTxs{0};
+    size_t nInputs{0};
+    //! rewinding the coins and the EvoDB to the first block, not part of the replay
+    int64_t nTimeDisconnect{0};
+    int64_t nTimeReadFromDisk{0};
+    //! deserialization and the block hash check
+    int64_t nTimeDeserialize{0};
+    //! ConnectBlock in total, see connect for its stages
+    int64_t nTimeConnectBlock{0};
+    CBlockConnectTimings connect;
+    //! serializing MN lists, diffs and commitments into the EvoDB transaction, part of the special tx stages
+    int64_t nTimeEvoDbWrites{0};
+    //! flushing the coins of each block into the cache below, as ConnectTip does with pcoinsTip
+    int64_t nTimeCoinsFlush{0};
+    int64_t nTimeTotal{0};
+};
+
+/**
+ * Disconnect the last nBlocks blocks in memory and connect them again from the block files while measuring the costs
+ * of each stage, for profiling block validation on real blocks. Like -checklevel=4 of VerifyDB, nothing is written to
+ * the coins DB or the EvoDB, so the replay can be repeated on the same datadir. Fewer blocks are replayed if the
+ * disconnected coins don't fit into -dbcache.
+ */
+bool ReplayBlocksForBenchmark(const CChainParams& chainparams, int nBlocks, CBlockReplayStats& statsRet, std::string& strError);
+
 inline CBlockIndex* LookupBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
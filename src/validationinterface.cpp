@@ -20,7 +20,7 @@
 struct MainSignalsInstance {
     boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
     boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> SynchronousUpdatedBlockTip;
-    boost::signals2::signal<void (const CTransactionRef &, int64_t)> TransactionAddedToMempool;
+    boost::signals2::signal<void (const std::vector<MempoolAddedTx>&)> TransactionsAddedToMempool;
     boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::vector<CTransactionRef>&)> BlockConnected;
     boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex* pindexDisconnected)> BlockDisconnected;
     boost::signals2::signal<void (const CTransactionRef &, MemPoolRemovalReason)> TransactionRemovedFromMempool;
@@ -30,19 +30,69 @@ struct MainSignalsInstance {
     boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
     boost::signals2::signal<void (const CBlockIndex *)>AcceptedBlockHeader;
     boost::signals2::signal<void (const CBlockIndex *, bool)>NotifyHeaderTip;
-    boost::signals2::signal<void (const CTransactionRef& tx, const std::shared_ptr<const llmq::CInstantSendLock>& islock)>NotifyTransactionLock;
-    boost::signals2::signal<void (const CBlockIndex* pindex, const std::shared_ptr<const llmq::CChainLockSig>& clsig)>NotifyChainLock;
-    boost::signals2::signal<void (const std::shared_ptr<const CGovernanceVote>& vote)>NotifyGovernanceVote;
+    boost::signals2::signal<void (const std::vector<TransactionLockEvent>& locks)>NotifyTransactionLocks;
+    boost::signals2::signal<void (const std::vector<ChainLockEvent>& clsigs)>NotifyChainLocks;
+    boost::signals2::signal<void (const std::vector<std::shared_ptr<const CGovernanceVote>>& votes)>NotifyGovernanceVotes;
     boost::signals2::signal<void (const std::shared_ptr<const CGovernanceObject>& object)>NotifyGovernanceObject;
     boost::signals2::signal<void (const CTransactionRef& currentTx, const CTransactionRef& previousTx)>NotifyInstantSendDoubleSpendAttempt;
     boost::signals2::signal<void (bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)>NotifyMasternodeListChanged;
-    boost::signals2::signal<void (const std::shared_ptr<const llmq::CRecoveredSig>& sig)>NotifyRecoveredSig;
+    boost::signals2::signal<void (const std::vector<std::shared_ptr<const llmq::CRecoveredSig>>& sigs)>NotifyRecoveredSigs;
     // We are not allowed to assume the scheduler only runs in one thread,
     // but must ensure all callbacks happen in-order, so we end up creating
     // our own queue here :(
     SingleThreadedSchedulerClient m_schedulerClient;
 
-    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+    // The batch of the most recently queued callback, as long as that callback didn't run yet. Events of the same
+    // kind are appended to it instead of queueing another callback. Queueing anything else closes the batch, so
+    // events are still delivered in order.
+    Mutex m_batch_mutex;
+    std::shared_ptr<void> m_open_batch GUARDED_BY(m_batch_mutex);
+    const void* m_open_batch_signal GUARDED_BY(m_batch_mutex){nullptr};
+
+    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler, SchedulerTaskOptions{"validationinterface", SchedulerPriority::HIGH, "validationinterface"}) {}
+
+    void AddToProcessQueue(std::function<void ()> func)
+    {
+        LOCK(m_batch_mutex);
+        m_open_batch.reset();
+        m_open_batch_signal = nullptr;
+        m_schedulerClient.AddToProcessQueue(std::move(func));
+    }
+
+    template <typename Event>
+    void AddBatchedEvent(boost::signals2::signal<void (const std::vector<Event>&)>& signal, Event event)
+    {
+        LOCK(m_batch_mutex);
+        if (m_open_batch_signal == &signal) {
+            auto& events = *static_cast<std::vector<Event>*>(m_open_batch.get());
+            events.emplace_back(std::move(event));
+            if (events.size() >= MAX_EVENT_BATCH_SIZE) {
+                // Keep individual callbacks short, so that other events don't wait too long behind a huge batch
+                m_open_batch.reset();
+                m_open_batch_signal = nullptr;
+            }
+            return;
+        }
+
+        auto batch = std::make_shared<std::vector<Event>>();
+        batch->emplace_back(std::move(event));
+        m_open_batch = batch;
+        m_open_batch_signal = &signal;
+        m_schedulerClient.AddToProcessQueue([this, batch, &signal] {
+            {
+                // Nothing may be appended to the batch once it's being dispatched
+                LOCK(m_batch_mutex);
+                if (m_open_batch == batch) {
+                    m_open_batch.reset();
+                    m_open_batch_signal = nullptr;
+                }
+            }
+            signal(*batch);
+        });
+    }
+
+private:
+    static const size_t MAX_EVENT_BATCH_SIZE = 1000;
 };
 
 static CMainSignals g_signals;
@@ -80,25 +130,60 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
+void CValidationInterface::TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs)
+{
+    for (const auto& p : txs) {
+        TransactionAddedToMempool(p.first, p.second);
+    }
+}
+
+void CValidationInterface::NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks)
+{
+    for (const auto& p : locks) {
+        NotifyTransactionLock(p.first, p.second);
+    }
+}
+
+void CValidationInterface::NotifyChainLocks(const std::vector<ChainLockEvent>& clsigs)
+{
+    for (const auto& p : clsigs) {
+        NotifyChainLock(p.first, p.second);
+    }
+}
+
+void CValidationInterface::NotifyGovernanceVotes(const std::vector<std::shared_ptr<const CGovernanceVote>>& votes)
+{
+    for (const auto& vote : votes) {
+        NotifyGovernanceVote(vote);
+    }
+}
+
+void CValidationInterface::NotifyRecoveredSigs(const std::vector<std::shared_ptr<const llmq::CRecoveredSig>>& sigs)
+{
+    for (const auto& sig : sigs) {
+        NotifyRecoveredSig(sig);
+    }
+}
+
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.m_internals->AcceptedBlockHeader.connect(boost::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, _1));
     g_signals.m_internals->NotifyHeaderTip.connect(boost::bind(&CValidationInterface::NotifyHeaderTip, pwalletIn, _1, _2));
     g_signals.m_internals->UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3));
     g_signals.m_internals->SynchronousUpdatedBlockTip.connect(boost::bind(&CValidationInterface::SynchronousUpdatedBlockTip, pwalletIn, _1, _2, _3));
-    g_signals.m_internals->TransactionAddedToMempool.connect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    g_signals.m_internals->TransactionsAddedToMempool.connect(boost::bind(&CValidationInterface::TransactionsAddedToMempool, pwalletIn, _1));
     g_signals.m_internals->BlockConnected.connect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2, _3));
     g_signals.m_internals->BlockDisconnected.connect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1, _2));
-    g_signals.m_internals->NotifyTransactionLock.connect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1, _2));
-    g_signals.m_internals->NotifyChainLock.connect(boost::bind(&CValidationInterface::NotifyChainLock, pwalletIn, _1, _2));
+    g_signals.m_internals->NotifyTransactionLocks.connect(boost::bind(&CValidationInterface::NotifyTransactionLocks, pwalletIn, _1));
+    g_signals.m_internals->NotifyChainLocks.connect(boost::bind(&CValidationInterface::NotifyChainLocks, pwalletIn, _1));
     g_signals.m_internals->TransactionRemovedFromMempool.connect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2));
     g_signals.m_internals->ChainStateFlushed.connect(boost::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1));
     g_signals.m_internals->Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1, _2));
     g_signals.m_internals->BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.m_internals->NewPoWValidBlock.connect(boost::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, _1, _2));
     g_signals.m_internals->NotifyGovernanceObject.connect(boost::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, _1));
-    g_signals.m_internals->NotifyGovernanceVote.connect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
+    g_signals.m_internals->NotifyGovernanceVotes.connect(boost::bind(&CValidationInterface::NotifyGovernanceVotes, pwalletIn, _1));
     g_signals.m_internals->NotifyInstantSendDoubleSpendAttempt.connect(boost::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, _1, _2));
-    g_signals.m_internals->NotifyRecoveredSig.connect(boost::bind(&CValidationInterface::NotifyRecoveredSig, pwalletIn, _1));
+    g_signals.m_internals->NotifyRecoveredSigs.connect(boost::bind(&CValidationInterface::NotifyRecoveredSigs, pwalletIn, _1));
     g_signals.m_internals->NotifyMasternodeListChanged.connect(boost::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, _1, _2, _3));
 }
 
@@ -106,9 +191,9 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.m_internals->BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.m_internals->Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1, _2));
     g_signals.m_internals->ChainStateFlushed.disconnect(boost::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1));
-    g_signals.m_internals->NotifyChainLock.disconnect(boost::bind(&CValidationInterface::NotifyChainLock, pwalletIn, _1, _2));
-    g_signals.m_internals->NotifyTransactionLock.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1, _2));
-    g_signals.m_internals->TransactionAddedToMempool.disconnect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    g_signals.m_internals->NotifyChainLocks.disconnect(boost::bind(&CValidationInterface::NotifyChainLocks, pwalletIn, _1));
+    g_signals.m_internals->NotifyTransactionLocks.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLocks, pwalletIn, _1));
+    g_signals.m_internals->TransactionsAddedToMempool.disconnect(boost::bind(&CValidationInterface::TransactionsAddedToMempool, pwalletIn, _1));
     g_signals.m_internals->BlockConnected.disconnect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2, _3));
     g_signals.m_internals->BlockDisconnected.disconnect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1, _2));
     g_signals.m_internals->TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2));
@@ -118,9 +203,9 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.m_internals->NotifyHeaderTip.disconnect(boost::bind(&CValidationInterface::NotifyHeaderTip, pwalletIn, _1, _2));
     g_signals.m_internals->AcceptedBlockHeader.disconnect(boost::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, _1));
     g_signals.m_internals->NotifyGovernanceObject.disconnect(boost::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, _1));
-    g_signals.m_internals->NotifyGovernanceVote.disconnect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
+    g_signals.m_internals->NotifyGovernanceVotes.disconnect(boost::bind(&CValidationInterface::NotifyGovernanceVotes, pwalletIn, _1));
     g_signals.m_internals->NotifyInstantSendDoubleSpendAttempt.disconnect(boost::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, _1, _2));
-    g_signals.m_internals->NotifyRecoveredSig.disconnect(boost::bind(&CValidationInterface::NotifyRecoveredSig, pwalletIn, _1));
+    g_signals.m_internals->NotifyRecoveredSigs.disconnect(boost::bind(&CValidationInterface::NotifyRecoveredSigs, pwalletIn, _1));
     g_signals.m_internals->NotifyMasternodeListChanged.disconnect(boost::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, _1, _2, _3));
 }
 
@@ -131,9 +216,9 @@ void UnregisterAllValidationInterfaces() {
     g_signals.m_internals->BlockChecked.disconnect_all_slots();
     g_signals.m_internals->Broadcast.disconnect_all_slots();
     g_signals.m_internals->ChainStateFlushed.disconnect_all_slots();
-    g_signals.m_internals->NotifyTransactionLock.disconnect_all_slots();
-    g_signals.m_internals->NotifyChainLock.disconnect_all_slots();
-    g_signals.m_internals->TransactionAddedToMempool.disconnect_all_slots();
+    g_signals.m_internals->NotifyTransactionLocks.disconnect_all_slots();
+    g_signals.m_internals->NotifyChainLocks.disconnect_all_slots();
+    g_signals.m_internals->TransactionsAddedToMempool.disconnect_all_slots();
     g_signals.m_internals->BlockConnected.disconnect_all_slots();
     g_signals.m_internals->BlockDisconnected.disconnect_all_slots();
     g_signals.m_internals->TransactionRemovedFromMempool.disconnect_all_slots();
@@ -143,14 +228,14 @@ void UnregisterAllValidationInterfaces() {
     g_signals.m_internals->NotifyHeaderTip.disconnect_all_slots();
     g_signals.m_internals->AcceptedBlockHeader.disconnect_all_slots();
     g_signals.m_internals->NotifyGovernanceObject.disconnect_all_slots();
-    g_signals.m_internals->NotifyGovernanceVote.disconnect_all_slots();
+    g_signals.m_internals->NotifyGovernanceVotes.disconnect_all_slots();
     g_signals.m_internals->NotifyInstantSendDoubleSpendAttempt.disconnect_all_slots();
-    g_signals.m_internals->NotifyRecoveredSig.disconnect_all_slots();
+    g_signals.m_internals->NotifyRecoveredSigs.disconnect_all_slots();
     g_signals.m_internals->NotifyMasternodeListChanged.disconnect_all_slots();
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->AddToProcessQueue(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -165,7 +250,7 @@ void SyncWithValidationInterfaceQueue() {
 
 void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
     if (reason != MemPoolRemovalReason::BLOCK) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, reason, this] {
+        m_internals->AddToProcessQueue([ptx, reason, this] {
             m_internals->TransactionRemovedFromMempool(ptx, reason);
         });
     }
@@ -176,7 +261,7 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
+    m_internals->AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
         m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
@@ -186,25 +271,23 @@ void CMainSignals::SynchronousUpdatedBlockTip(const CBlockIndex *pindexNew, cons
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx, int64_t nAcceptTime) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, nAcceptTime, this] {
-        m_internals->TransactionAddedToMempool(ptx, nAcceptTime);
-    });
+    m_internals->AddBatchedEvent(m_internals->TransactionsAddedToMempool, MempoolAddedTx(ptx, nAcceptTime));
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
+    m_internals->AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
         m_internals->BlockConnected(pblock, pindex, *pvtxConflicted);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex* pindexDisconnected) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindexDisconnected, this] {
+    m_internals->AddToProcessQueue([pblock, pindexDisconnected, this] {
         m_internals->BlockDisconnected(pblock, pindexDisconnected);
     });
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
+    m_internals->AddToProcessQueue([locator, this] {
         m_internals->ChainStateFlushed(locator);
     });
 }
@@ -230,39 +313,31 @@ void CMainSignals::NotifyHeaderTip(const CBlockIndex *pindexNew, bool fInitialDo
 }
 
 void CMainSignals::NotifyTransactionLock(const CTransactionRef &tx, const std::shared_ptr<const llmq::CInstantSendLock>& islock) {
-    m_internals->m_schedulerClient.AddToProcessQueue([tx, islock, this] {
-        m_internals->NotifyTransactionLock(tx, islock);
-    });
+    m_internals->AddBatchedEvent(m_internals->NotifyTransactionLocks, TransactionLockEvent(tx, islock));
 }
 
 void CMainSignals::NotifyChainLock(const CBlockIndex* pindex, const std::shared_ptr<const llmq::CChainLockSig>& clsig) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pindex, clsig, this] {
-        m_internals->NotifyChainLock(pindex, clsig);
-    });
+    m_internals->AddBatchedEvent(m_internals->NotifyChainLocks, ChainLockEvent(pindex, clsig));
 }
 
 void CMainSignals::NotifyGovernanceVote(const std::shared_ptr<const CGovernanceVote>& vote) {
-    m_internals->m_schedulerClient.AddToProcessQueue([vote, this] {
-        m_internals->NotifyGovernanceVote(vote);
-    });
+    m_internals->AddBatchedEvent(m_internals->NotifyGovernanceVotes, vote);
 }
 
 void CMainSignals::NotifyGovernanceObject(const std::shared_ptr<const CGovernanceObject>& object) {
-    m_internals->m_schedulerClient.AddToProcessQueue([object, this] {
+    m_internals->AddToProcessQueue([object, this] {
         m_internals->NotifyGovernanceObject(object);
     });
 }
 
 void CMainSignals::NotifyInstantSendDoubleSpendAttempt(const CTransactionRef& currentTx, const CTransactionRef& previousTx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([currentTx, previousTx, this] {
+    m_internals->AddToProcessQueue([currentTx, previousTx, this] {
         m_internals->NotifyInstantSendDoubleSpendAttempt(currentTx, previousTx);
     });
 }
 
 void CMainSignals::NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& sig) {
-    m_internals->m_schedulerClient.AddToProcessQueue([sig, this] {
-        m_internals->NotifyRecoveredSig(sig);
-    });
+    m_internals->AddBatchedEvent(m_internals->NotifyRecoveredSigs, sig);
 }
 
 void CMainSignals::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) {
@@ -11,6 +11,8 @@
 
 #include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
 
 extern CCriticalSection cs_main;
 class CBlock;
@@ -35,6 +37,11 @@ namespace llmq {
     class CRecoveredSig;
 } // namespace llmq
 
+/** Events of the high-rate notifications, as delivered by their batched callbacks */
+typedef std::pair<CTransactionRef, int64_t> MempoolAddedTx;
+typedef std::pair<CTransactionRef, std::shared_ptr<const llmq::CInstantSendLock>> TransactionLockEvent;
+typedef std::pair<const CBlockIndex*, std::shared_ptr<const llmq::CChainLockSig>> ChainLockEvent;
+
 // These functions dispatch to one or all registered wallets
 
 /** Register a wallet to receive updates from core */
@@ -139,6 +146,21 @@ protected:
     virtual void NotifyInstantSendDoubleSpendAttempt(const CTransactionRef& currentTx, const CTransactionRef& previousTx) {}
     virtual void NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& sig) {}
     virtual void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) {}
+    /**
+     * Batched variants of TransactionAddedToMempool, NotifyTransactionLock, NotifyChainLock, NotifyGovernanceVote and
+     * NotifyRecoveredSig. Consecutive events of the same kind which are still waiting in the background queue are
+     * coalesced and delivered with a single call, in the order in which they happened.
+     *
+     * The default implementations forward every event to the single-event callback, so these only need to be
+     * overridden by listeners which can handle a whole batch more efficiently, e.g. by taking their locks only once.
+     *
+     * Called on a background thread.
+     */
+    virtual void TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs);
+    virtual void NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks);
+    virtual void NotifyChainLocks(const std::vector<ChainLockEvent>& clsigs);
+    virtual void NotifyGovernanceVotes(const std::vector<std::shared_ptr<const CGovernanceVote>>& votes);
+    virtual void NotifyRecoveredSigs(const std::vector<std::shared_ptr<const llmq::CRecoveredSig>>& sigs);
     /**
      * Notifies listeners of the new active block chain on-disk.
      *
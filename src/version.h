@@ -11,7 +11,7 @@
  */
 
 
-static const int PROTOCOL_VERSION = 70219;
+static const int PROTOCOL_VERSION = 70222;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -48,6 +48,15 @@ static const int MNAUTH_NODE_VER_VERSION = 70218;
 //! introduction of QGETDATA/QDATA messages
 static const int LLMQ_DATA_MESSAGES_VERSION = 70219;
 
+//! ENCRYPTED_CONTRIBUTIONS_CHUNK requests in QGETDATA
+static const int LLMQ_DATA_CHUNKS_VERSION = 70220;
+
+//! run-length/offset encoded QSIGSHARESINV/QGETSIGSHARES and QSIGSESANN grouped by quorum
+static const int LLMQ_COMPACT_SIGSHARES_VERSION = 70221;
+
+//! introduction of SENDLZ4/LZ4MSG
+static const int P2P_COMPRESSION_VERSION = 70222;
+
 // Make sure that none of the values above collide with `ADDRV2_FORMAT`.
 
 #endif // BITCOIN_VERSION_H
@@ -222,7 +222,6 @@ private:
 protected:
     int64_t BeginTime(const Consensus::Params& params) const override { return params.vDeployments[id].nStartTime; }
     int64_t EndTime(const Consensus::Params& params) const override { return params.vDeployments[id].nTimeout; }
-    int Period(const Consensus::Params& params) const override { return params.vDeployments[id].nWindowSize ? params.vDeployments[id].nWindowSize : params.nMinerConfirmationWindow; }
     int Threshold(const Consensus::Params& params, int nAttempt) const override
     {
         if (params.vDeployments[id].nThresholdStart == 0) {
@@ -243,23 +242,39 @@ protected:
 public:
     explicit VersionBitsConditionChecker(Consensus::DeploymentPos id_) : id(id_) {}
     uint32_t Mask(const Consensus::Params& params) const { return ((uint32_t)1) << params.vDeployments[id].bit; }
+    int Period(const Consensus::Params& params) const override { return params.vDeployments[id].nWindowSize ? params.vDeployments[id].nWindowSize : params.nMinerConfirmationWindow; }
 };
 
+//! The last block of the previous period, which is what the states are cached for
+const CBlockIndex* GetPeriodParent(const CBlockIndex* pindexPrev, int nPeriod)
+{
+    if (pindexPrev == nullptr) {
+        return nullptr;
+    }
+    return pindexPrev->GetAncestor(pindexPrev->nHeight - ((pindexPrev->nHeight + 1) % nPeriod));
+}
+
+bool IsInChainOf(const CBlockIndex* pindexAncestor, const CBlockIndex* pindex)
+{
+    return pindexAncestor != nullptr && pindex != nullptr && pindex->nHeight >= pindexAncestor->nHeight &&
+           pindex->GetAncestor(pindexAncestor->nHeight) == pindexAncestor;
+}
+
 } // namespace
 
 ThresholdState VersionBitsState(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, VersionBitsCache& cache)
 {
-    return VersionBitsConditionChecker(pos).GetStateFor(pindexPrev, params, cache.caches[pos]);
+    return cache.State(pindexPrev, params, pos);
 }
 
 BIP9Stats VersionBitsStatistics(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, VersionBitsCache& cache)
 {
-    return VersionBitsConditionChecker(pos).GetStateStatisticsFor(pindexPrev, params, cache.caches[pos]);
+    return cache.Statistics(pindexPrev, params, pos);
 }
 
 int VersionBitsStateSinceHeight(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, VersionBitsCache& cache)
 {
-    return VersionBitsConditionChecker(pos).GetStateSinceHeightFor(pindexPrev, params, cache.caches[pos]);
+    return cache.StateSinceHeight(pindexPrev, params, pos);
 }
 
 uint32_t VersionBitsMask(const Consensus::Params& params, Consensus::DeploymentPos pos)
@@ -267,9 +282,84 @@ uint32_t VersionBitsMask(const Consensus::Params& params, Consensus::DeploymentP
     return VersionBitsConditionChecker(pos).Mask(params);
 }
 
+VersionBitsCache::VersionBitsCache()
+{
+    for (unsigned int d = 0; d < Consensus::MAX_VERSION_BITS_DEPLOYMENTS; d++) {
+        activeSince[d] = nullptr;
+        failedSince[d] = nullptr;
+    }
+}
+
+bool VersionBitsCache::GetTerminalState(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, ThresholdState& stateRet) const
+{
+    const CBlockIndex* pindexPeriodParent = GetPeriodParent(pindexPrev, VersionBitsConditionChecker(pos).Period(params));
+    if (IsInChainOf(activeSince[pos].load(std::memory_order_acquire), pindexPeriodParent)) {
+        stateRet = ThresholdState::ACTIVE;
+        return true;
+    }
+    if (IsInChainOf(failedSince[pos].load(std::memory_order_acquire), pindexPeriodParent)) {
+        stateRet = ThresholdState::FAILED;
+        return true;
+    }
+    return false;
+}
+
+void VersionBitsCache::PublishTerminalState(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, ThresholdState state)
+{
+    if (state != ThresholdState::ACTIVE && state != ThresholdState::FAILED) {
+        return;
+    }
+    VersionBitsConditionChecker checker(pos);
+    auto& since = state == ThresholdState::ACTIVE ? activeSince[pos] : failedSince[pos];
+    if (IsInChainOf(since.load(std::memory_order_relaxed), GetPeriodParent(pindexPrev, checker.Period(params)))) {
+        return;
+    }
+    // Publish the first period in this state, so that all later ones are covered. This only replaces a previously
+    // published period if the deployment reached the state on another chain before.
+    int nSinceHeight = checker.GetStateSinceHeightFor(pindexPrev, params, caches[pos]);
+    since.store(pindexPrev->GetAncestor(nSinceHeight - 1), std::memory_order_release);
+}
+
+ThresholdState VersionBitsCache::State(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos)
+{
+    ThresholdState state;
+    if (GetTerminalState(pindexPrev, params, pos, state)) {
+        return state;
+    }
+    LOCK(cs);
+    state = VersionBitsConditionChecker(pos).GetStateFor(pindexPrev, params, caches[pos]);
+    PublishTerminalState(pindexPrev, params, pos, state);
+    return state;
+}
+
+BIP9Stats VersionBitsCache::Statistics(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos)
+{
+    LOCK(cs);
+    return VersionBitsConditionChecker(pos).GetStateStatisticsFor(pindexPrev, params, caches[pos]);
+}
+
+int VersionBitsCache::StateSinceHeight(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos)
+{
+    LOCK(cs);
+    return VersionBitsConditionChecker(pos).GetStateSinceHeightFor(pindexPrev, params, caches[pos]);
+}
+
+void VersionBitsCache::UpdateTip(const CBlockIndex* pindexNew, const Consensus::Params& params)
+{
+    for (unsigned int d = 0; d < Consensus::MAX_VERSION_BITS_DEPLOYMENTS; d++) {
+        Consensus::DeploymentPos pos = Consensus::DeploymentPos(d);
+        if ((pindexNew->nHeight + 1) % VersionBitsConditionChecker(pos).Period(params) == 0) {
+            State(pindexNew, params, pos);
+        }
+    }
+}
+
 void VersionBitsCache::Clear()
 {
+    LOCK(cs);
     for (unsigned int d = 0; d < Consensus::MAX_VERSION_BITS_DEPLOYMENTS; d++) {
         caches[d].clear();
+        activeSince[d] = nullptr;
+        failedSince[d] = nullptr;
     }
 }
@@ -6,6 +6,9 @@
 #define BITCOIN_VERSIONBITS_H
 
 #include <chain.h>
+#include <sync.h>
+
+#include <atomic>
 #include <map>
 
 /** What block version to use for new blocks (pre versionbits) */
@@ -67,9 +70,36 @@ public:
     int GetStateSinceHeightFor(const CBlockIndex* pindexPrev, const Consensus::Params& params, ThresholdConditionCache& cache) const;
 };
 
-struct VersionBitsCache
+/**
+ * BIP9 states of all deployments, shared by validation and the LLMQ, InstantSend and CoinJoin code without cs_main.
+ *
+ * States are cached per period under the cache's own lock, and the states for the next period are computed when the
+ * last block of a period is connected. Once a deployment is ACTIVE or FAILED, which is where deployments spend nearly
+ * all their time, the first period of that state is also published through an atomic pointer. The state of all its
+ * descendants is then known without taking the lock.
+ */
+class VersionBitsCache
 {
-    ThresholdConditionCache caches[Consensus::MAX_VERSION_BITS_DEPLOYMENTS];
+private:
+    CCriticalSection cs;
+    ThresholdConditionCache caches[Consensus::MAX_VERSION_BITS_DEPLOYMENTS] GUARDED_BY(cs);
+
+    // Last block before the first period in which the deployment is ACTIVE/FAILED, nullptr if not known yet
+    std::atomic<const CBlockIndex*> activeSince[Consensus::MAX_VERSION_BITS_DEPLOYMENTS];
+    std::atomic<const CBlockIndex*> failedSince[Consensus::MAX_VERSION_BITS_DEPLOYMENTS];
+
+    bool GetTerminalState(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, ThresholdState& stateRet) const;
+    void PublishTerminalState(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos, ThresholdState state) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    VersionBitsCache();
+
+    ThresholdState State(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos);
+    BIP9Stats Statistics(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos);
+    int StateSinceHeight(const CBlockIndex* pindexPrev, const Consensus::Params& params, Consensus::DeploymentPos pos);
+
+    /** Compute the states of the deployments whose period ends with pindexNew, called when it is connected */
+    void UpdateTip(const CBlockIndex* pindexNew, const Consensus::Params& params);
 
     void Clear();
 };
@@ -20,6 +20,7 @@ void CCoinControl::SetNull(bool fResetCoinType)
     m_fee_mode = FeeEstimateMode::UNSET;
     fRequireAllInputs = true;
     m_discard_feerate.reset();
+    m_start_after.reset();
     if (fResetCoinType) {
         nCoinType = CoinType::ALL_COINS;
     }
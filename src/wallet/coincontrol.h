@@ -51,6 +51,9 @@ public:
     FeeEstimateMode m_fee_mode;
     //! Controls which types of coins are allowed to be used (default: ALL_COINS)
     CoinType nCoinType;
+    //! If set, AvailableCoins only looks at the outputs after this one (all outputs if it's null) and returns them
+    //! sorted by outpoint, so that the UTXOs of a large wallet can be listed page by page
+    boost::optional<COutPoint> m_start_after;
 
     CCoinControl()
     {
@@ -230,6 +230,71 @@ struct CompareByPriority
     }
 };
 
+bool SelectCoinsDenominated(const CAmount& nTargetValue, std::vector<OutputGroup>& groups, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, CAmount maxTxFee)
+{
+    setCoinsRet.clear();
+    nValueRet = 0;
+
+    // Standard denominations are sorted from the largest to the smallest one
+    const std::vector<CAmount> vecDenoms = CCoinJoin::GetStandardDenominations();
+
+    // Put the groups into one bucket per denomination, in random order to not always spend the same coins
+    Shuffle(groups.begin(), groups.end(), FastRandomContext());
+    std::vector<std::vector<const OutputGroup*>> vecBuckets(vecDenoms.size());
+    for (const OutputGroup& group : groups) {
+        auto it = std::find(vecDenoms.begin(), vecDenoms.end(), group.m_value);
+        if (it != vecDenoms.end()) {
+            vecBuckets[it - vecDenoms.begin()].push_back(&group);
+        }
+    }
+
+    // Take as many coins of each denomination as fit into the remaining amount, largest denominations first
+    std::vector<size_t> vecUsed(vecDenoms.size(), 0);
+    CAmount nRemaining = nTargetValue;
+    for (size_t i = 0; i < vecDenoms.size(); i++) {
+        vecUsed[i] = std::min<size_t>(vecBuckets[i].size(), nRemaining / vecDenoms[i]);
+        nRemaining -= vecUsed[i] * vecDenoms[i];
+    }
+
+    if (nRemaining > 0) {
+        // All coins left are larger than the rest, overpay with the smallest of them...
+        size_t nAdded = vecDenoms.size();
+        for (size_t i = vecDenoms.size(); i-- > 0; ) {
+            if (vecUsed[i] < vecBuckets[i].size() && vecDenoms[i] >= nRemaining) {
+                nAdded = i;
+                break;
+            }
+        }
+        if (nAdded == vecDenoms.size()) {
+            // not enough funds
+            return false;
+        }
+        vecUsed[nAdded]++;
+        nRemaining -= vecDenoms[nAdded];
+        // ...and drop the smaller coins which are not needed anymore
+        for (size_t i = nAdded + 1; i < vecDenoms.size(); i++) {
+            while (vecUsed[i] > 0 && -nRemaining >= vecDenoms[i]) {
+                vecUsed[i]--;
+                nRemaining += vecDenoms[i];
+            }
+        }
+    }
+
+    // There is no change in PS, the overpaid amount goes to fees
+    if (-nRemaining > maxTxFee) {
+        return false;
+    }
+
+    for (size_t i = 0; i < vecDenoms.size(); i++) {
+        for (size_t j = 0; j < vecUsed[i]; j++) {
+            util::insert(setCoinsRet, vecBuckets[i][j]->m_outputs);
+            nValueRet += vecBuckets[i][j]->m_value;
+        }
+    }
+    LogPrint(BCLog::SELECTCOINS, "SelectCoinsDenominated - selected %d coins, total %s\n", setCoinsRet.size(), FormatMoney(nValueRet));
+    return true;
+}
+
 // move denoms down
 bool less_then_denom (const OutputGroup& group1, const OutputGroup& group2)
 {
@@ -96,6 +96,10 @@ struct OutputGroup
 
 bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change, std::set<CInputCoin>& out_set, CAmount& value_ret, CAmount not_input_fees);
 
+// Selects fully mixed coins for a CoinJoin send by counting the coins of each standard denomination instead of
+// searching over all of them. There is no change, so the overpaid amount (i.e. the fee) must not exceed maxTxFee.
+bool SelectCoinsDenominated(const CAmount& nTargetValue, std::vector<OutputGroup>& groups, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, CAmount maxTxFee);
+
 // Original coin selection algorithm as a fallback
 bool KnapsackSolver(const CAmount& nTargetValue, std::vector<OutputGroup>& groups, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, bool fFulyMixedOnly, CAmount maxTxFee);
 #endif // BITCOIN_WALLET_COINSELECTION_H
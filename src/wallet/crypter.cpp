@@ -10,6 +10,10 @@
 #include <script/standard.h>
 #include <util/system.h>
 
+#include <ctpl_stl.h>
+
+#include <atomic>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -251,20 +255,58 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn, bool fForMixin
 
         bool keyPass = false;
         bool keyFail = false;
-        CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
-        for (; mi != mapCryptedKeys.end(); ++mi)
-        {
-            const CPubKey &vchPubKey = (*mi).second.first;
-            const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
+        const size_t nThreads = std::min(GetNumCores(), UNLOCK_CHECK_THREADS);
+        if (!fDecryptionThoroughlyChecked && mapCryptedKeys.size() >= UNLOCK_CHECK_PARALLEL_MIN && nThreads >= 2) {
+            std::vector<const CryptedKeyMap::mapped_type*> vecKeys;
+            vecKeys.reserve(mapCryptedKeys.size());
+            for (const auto& p : mapCryptedKeys) {
+                vecKeys.emplace_back(&p.second);
+            }
+            // a wrong master key fails on the first key already, don't spin up the threads for it
             CKey key;
-            if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
-            {
-                keyFail = true;
-                break;
+            if (!DecryptKey(vMasterKeyIn, vecKeys[0]->second, vecKeys[0]->first, key)) {
+                return false;
             }
             keyPass = true;
-            if (fDecryptionThoroughlyChecked)
-                break;
+
+            std::atomic<bool> fAbort{false};
+            auto checkRange = [&](size_t nBegin, size_t nEnd) {
+                CKey key;
+                for (size_t i = nBegin; i < nEnd && !fAbort; i++) {
+                    if (!DecryptKey(vMasterKeyIn, vecKeys[i]->second, vecKeys[i]->first, key)) {
+                        fAbort = true;
+                        return false;
+                    }
+                }
+                return true;
+            };
+            ctpl::thread_pool pool(nThreads);
+            RenameThreadPool(pool, "dash-unlock");
+            std::vector<std::future<bool>> futures;
+            const size_t nPerThread = (vecKeys.size() - 1 + nThreads - 1) / nThreads;
+            for (size_t nBegin = 1; nBegin < vecKeys.size(); nBegin += nPerThread) {
+                const size_t nEnd = std::min(nBegin + nPerThread, vecKeys.size());
+                futures.emplace_back(pool.push([&checkRange, nBegin, nEnd](int) { return checkRange(nBegin, nEnd); }));
+            }
+            for (auto& future : futures) {
+                keyFail |= !future.get();
+            }
+        } else {
+            CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
+            for (; mi != mapCryptedKeys.end(); ++mi)
+            {
+                const CPubKey &vchPubKey = (*mi).second.first;
+                const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
+                CKey key;
+                if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
+                {
+                    keyFail = true;
+                    break;
+                }
+                keyPass = true;
+                if (fDecryptionThoroughlyChecked)
+                    break;
+            }
         }
         if (keyPass && keyFail)
         {
@@ -103,6 +103,11 @@ public:
     }
 };
 
+//! Maximum number of threads checking the encrypted keys during the first unlock
+static const int UNLOCK_CHECK_THREADS = 8;
+//! Minimum number of encrypted keys before the first unlock checks them in parallel
+static const size_t UNLOCK_CHECK_PARALLEL_MIN = 1000;
+
 bool EncryptAES256(const SecureString& sKey, const SecureString& sPlaintext, const std::string& sIV, std::string& sCiphertext);
 bool DecryptAES256(const SecureString& sKey, const std::string& sCiphertext, const std::string& sIV, SecureString& sPlaintext);
 
@@ -122,7 +127,7 @@ private:
     std::atomic<bool> fUseCrypto;
 
     //! keeps track of whether Unlock has run a thorough check before
-    bool fDecryptionThoroughlyChecked;
+    std::atomic<bool> fDecryptionThoroughlyChecked;
 
     //! if fOnlyMixingAllowed is true, only mixing should be allowed in unlocked wallet
     bool fOnlyMixingAllowed;
@@ -143,6 +148,10 @@ protected:
     bool Unlock(const CKeyingMaterial& vMasterKeyIn, bool fForMixingOnly = false);
     CryptedKeyMap mapCryptedKeys GUARDED_BY(cs_KeyStore);
 
+    bool IsDecryptionThoroughlyChecked() const { return fDecryptionThoroughlyChecked; }
+    //! skip the thorough check of all keys, it was done before for this wallet
+    void SetDecryptionThoroughlyChecked() { fDecryptionThoroughlyChecked = true; }
+
 public:
     CCryptoKeyStore() : fUseCrypto(false), fDecryptionThoroughlyChecked(false), fOnlyMixingAllowed(false)
     {
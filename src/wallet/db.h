@@ -117,6 +117,7 @@ std::shared_ptr<BerkeleyEnvironment> GetWalletEnv(const fs::path& wallet_path, s
 class BerkeleyDatabase
 {
     friend class BerkeleyBatch;
+    friend class WalletDBJournal;
 public:
     /** Create dummy DB handle */
     BerkeleyDatabase() : nUpdateCounter(0), nLastSeen(0), nLastFlushed(0), nLastWalletUpdate(0), env(nullptr)
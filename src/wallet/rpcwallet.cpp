@@ -1841,7 +1841,7 @@ static UniValue listtransactions(const JSONRPCRequest& request)
 
     std::string help_text {};
     if (!IsDeprecatedRPCEnabled("accounts")) {
-        help_text = "listtransactions (label count skip include_watchonly)\n"
+        help_text = "listtransactions (label count skip include_watchonly before)\n"
             "\nIf a label name is provided, this will return only incoming transactions paying to addresses with the specified label.\n"
             "\nReturns up to 'count' most recent transactions skipping the first 'from' transactions.\n"
             "Note that the \"account\" argument and \"otheraccount\" return value have been removed in V0.17. To use this RPC with an \"account\" argument, restart\n"
@@ -1852,6 +1852,9 @@ static UniValue listtransactions(const JSONRPCRequest& request)
             "2. count          (numeric, optional, default=10) The number of transactions to return\n"
             "3. skip           (numeric, optional, default=0) The number of transactions to skip\n"
             "4. include_watchonly (bool, optional, default=false) Include transactions to watch-only addresses (see 'importaddress')\n"
+            "5. before         (numeric, optional) Page through the history by order position instead of skipping. -1 for the\n"
+            "                  most recent transactions, the lowest \"orderpos\" of the previous page for the next one. Pages\n"
+            "                  end at whole transactions, so they may contain a few more than 'count' entries.\n"
             "\nResult:\n"
             "[\n"
             "  {\n"
@@ -1887,6 +1890,7 @@ static UniValue listtransactions(const JSONRPCRequest& request)
             "    \"comment\": \"...\",         (string) If a comment is associated with the transaction.\n"
             "    \"abandoned\": xxx          (bool) 'true' if the transaction has been abandoned (inputs are respendable). Only available for the \n"
             "                                         'send' category of transactions.\n"
+            "    \"orderpos\": n             (numeric) The position of the transaction in the history. Only available if 'before' is set.\n"
             "  }\n"
             "]\n"
 
@@ -1898,13 +1902,16 @@ static UniValue listtransactions(const JSONRPCRequest& request)
             "\nAs a json rpc call\n"
             + HelpExampleRpc("listtransactions", "\"\", 20, 100");
     } else {
-        help_text = "listtransactions ( \"account\" count skip include_watchonly)\n"
+        help_text = "listtransactions ( \"account\" count skip include_watchonly before)\n"
             "\nReturns up to 'count' most recent transactions skipping the first 'from' transactions for account 'account'.\n"
             "\nArguments:\n"
             "1. \"account\"    (string, optional) DEPRECATED. This argument will be removed in V0.18. The account name. Should be \"*\".\n"
             "2. count          (numeric, optional, default=10) The number of transactions to return\n"
             "3. skip           (numeric, optional, default=0) The number of transactions to skip\n"
             "4. include_watchonly (bool, optional, default=false) Include transactions to watch-only addresses (see 'importaddress')\n"
+            "5. before         (numeric, optional) Page through the history by order position instead of skipping. -1 for the\n"
+            "                  most recent transactions, the lowest \"orderpos\" of the previous page for the next one. Pages\n"
+            "                  end at whole transactions, so they may contain a few more than 'count' entries.\n"
             "\nResult:\n"
             "[\n"
             "  {\n"
@@ -1945,6 +1952,7 @@ static UniValue listtransactions(const JSONRPCRequest& request)
             "                                          negative amounts).\n"
             "    \"abandoned\": xxx          (bool) 'true' if the transaction has been abandoned (inputs are respendable). Only available for the \n"
             "                                         'send' category of transactions.\n"
+            "    \"orderpos\": n             (numeric) The position of the transaction in the history. Only available if 'before' is set.\n"
             "  }\n"
             "]\n"
 
@@ -1956,7 +1964,7 @@ static UniValue listtransactions(const JSONRPCRequest& request)
             "\nAs a json rpc call\n"
             + HelpExampleRpc("listtransactions", "\"*\", 20, 100");
     }
-    if (request.fHelp || request.params.size() > 4) throw std::runtime_error(help_text);
+    if (request.fHelp || request.params.size() > 5) throw std::runtime_error(help_text);
 
     // Make sure the results are valid at least up to the most recent block
     // the user could have gotten from another RPC command prior to now
@@ -1984,6 +1992,8 @@ static UniValue listtransactions(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
     if (nFrom < 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
+    bool fPaged = !request.params[4].isNull();
+    int64_t nBefore = fPaged ? request.params[4].get_int64() : -1;
 
     UniValue ret(UniValue::VARR);
 
@@ -1992,15 +2002,26 @@ static UniValue listtransactions(const JSONRPCRequest& request)
 
         const CWallet::TxItems & txOrdered = pwallet->wtxOrdered;
 
+        // wtxOrdered is sorted by order position, so a page only costs as many entries as it returns
+        CWallet::TxItems::const_reverse_iterator it(nBefore < 0 ? txOrdered.end() : txOrdered.lower_bound(nBefore));
+        UniValue txEntries(UniValue::VARR);
         // iterate backwards until we have nCount items to return:
-        for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+        for (; it != txOrdered.rend(); ++it)
         {
+            UniValue& entries = fPaged ? txEntries : ret;
+            if (fPaged) txEntries.setArray();
             CWalletTx *const pwtx = (*it).second.first;
             if (pwtx != nullptr)
-                ListTransactions(pwallet, *pwtx, strAccount, 0, true, ret, filter);
+                ListTransactions(pwallet, *pwtx, strAccount, 0, true, entries, filter);
             if (IsDeprecatedRPCEnabled("accounts")) {
                 CAccountingEntry *const pacentry = (*it).second.second;
-                if (pacentry != nullptr) AcentryToJSON(*pacentry, strAccount, ret);
+                if (pacentry != nullptr) AcentryToJSON(*pacentry, strAccount, entries);
+            }
+            if (fPaged) {
+                for (UniValue entry : txEntries.getValues()) {
+                    entry.pushKV("orderpos", it->first);
+                    ret.push_back(entry);
+                }
             }
 
             if ((int)ret.size() >= (nCount+nFrom)) break;
@@ -2011,7 +2032,7 @@ static UniValue listtransactions(const JSONRPCRequest& request)
 
     if (nFrom > (int)ret.size())
         nFrom = ret.size();
-    if ((nFrom + nCount) > (int)ret.size())
+    if ((nFrom + nCount) > (int)ret.size() || fPaged)
         nCount = ret.size() - nFrom;
 
     const std::vector<UniValue>& txs = ret.getValues();
@@ -3516,6 +3537,9 @@ static UniValue listunspent(const JSONRPCRequest& request)
             "      \"coinType\"         (numeric, default=0) Filter coinTypes as follows:\n"
             "                         0=ALL_COINS, 1=ONLY_FULLY_MIXED, 2=ONLY_READY_TO_MIX, 3=ONLY_NONDENOMINATED,\n"
             "                         4=ONLY_MASTERNODE_COLLATERAL, 5=ONLY_COINJOIN_COLLATERAL\n"
+            "      \"cursor\"           (string, optional) Page through the UTXOs sorted by outpoint, use together with maximumCount.\n"
+            "                         \"\" for the first page, \"txid:vout\" of the last returned UTXO for the next one.\n"
+            "                         A page with less than maximumCount UTXOs is the last one.\n"
             "    }\n"
             "\nResult\n"
             "[                   (array of json object)\n"
@@ -3545,6 +3569,7 @@ static UniValue listunspent(const JSONRPCRequest& request)
             + HelpExampleRpc("listunspent", "6, 9999999 \"[\\\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\\\",\\\"XuQQkwA4FYkq2XERzMY2CiAZhJTEDAbtcg\\\"]\"")
             + HelpExampleCli("listunspent", "6 9999999 '[]' true '{ \"minimumAmount\": 0.005 }'")
             + HelpExampleRpc("listunspent", "6, 9999999, [] , true, { \"minimumAmount\": 0.005 } ")
+            + HelpExampleCli("listunspent", "1 9999999 '[]' true '{ \"maximumCount\": 1000, \"cursor\": \"\" }'")
         );
 
     int nMinDepth = 1;
@@ -3597,7 +3622,8 @@ static UniValue listunspent(const JSONRPCRequest& request)
             "maximumAmount",
             "minimumSumAmount",
             "maximumCount",
-            "coinType"
+            "coinType",
+            "cursor"
         };
 
         for (const auto& key : options.getKeys()) {
@@ -3627,6 +3653,21 @@ static UniValue listunspent(const JSONRPCRequest& request)
 
             coinControl.nCoinType = static_cast<CoinType>(nCoinType);
         }
+
+        if (options.exists("cursor")) {
+            const std::string& strCursor = options["cursor"].get_str();
+            COutPoint startAfter;
+            if (!strCursor.empty()) {
+                const size_t nColon = strCursor.find(':');
+                int32_t nOut;
+                if (nColon != 64 || !IsHex(strCursor.substr(0, nColon)) ||
+                    !ParseInt32(strCursor.substr(nColon + 1), &nOut) || nOut < 0) {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor, expected \"txid:vout\" or \"\"");
+                }
+                startAfter = COutPoint(uint256S(strCursor.substr(0, nColon)), nOut);
+            }
+            coinControl.m_start_after = startAfter;
+        }
     }
 
     // Make sure the results are valid at least up to the most recent block
@@ -3635,20 +3676,13 @@ static UniValue listunspent(const JSONRPCRequest& request)
 
     UniValue results(UniValue::VARR);
     std::vector<COutput> vecOutputs;
-    {
-        LOCK2(cs_main, pwallet->cs_wallet);
-        pwallet->AvailableCoins(vecOutputs, !include_unsafe, &coinControl, nMinimumAmount, nMaximumAmount, nMinimumSumAmount, nMaximumCount, nMinDepth, nMaxDepth);
-    }
-
-    LOCK(pwallet->cs_wallet);
-
-    for (const COutput& out : vecOutputs) {
+    auto pushOutput = [&](const COutput& out) {
         CTxDestination address;
         const CScript& scriptPubKey = out.tx->tx->vout[out.i].scriptPubKey;
         bool fValidAddress = ExtractDestination(scriptPubKey, address);
 
         if (destinations.size() && (!fValidAddress || !destinations.count(address)))
-            continue;
+            return;
 
         UniValue entry(UniValue::VOBJ);
         entry.pushKV("txid", out.tx->GetHash().GetHex());
@@ -3682,6 +3716,25 @@ static UniValue listunspent(const JSONRPCRequest& request)
         entry.pushKV("safe", out.fSafe);
         entry.pushKV("coinjoin_rounds", pwallet->GetRealOutpointCoinJoinRounds(COutPoint(out.tx->GetHash(), out.i)));
         results.push_back(entry);
+    };
+
+    while (true) {
+        // when paging, the outputs which don't pay to one of the addresses don't count towards maximumCount
+        const uint64_t nRequested = nMaximumCount > 0 ? nMaximumCount - results.size() : 0;
+        {
+            LOCK2(cs_main, pwallet->cs_wallet);
+            pwallet->AvailableCoins(vecOutputs, !include_unsafe, &coinControl, nMinimumAmount, nMaximumAmount, nMinimumSumAmount, nRequested, nMinDepth, nMaxDepth);
+        }
+
+        LOCK(pwallet->cs_wallet);
+        for (const COutput& out : vecOutputs) {
+            pushOutput(out);
+        }
+
+        if (!coinControl.m_start_after || nRequested == 0 || vecOutputs.size() < nRequested || results.size() >= nMaximumCount) {
+            break;
+        }
+        coinControl.m_start_after = COutPoint(vecOutputs.back().tx->GetHash(), vecOutputs.back().i);
     }
 
     return results;
@@ -4646,7 +4699,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "listlockunspent",                  &listlockunspent,               {} },
     { "wallet",             "listreceivedbyaddress",            &listreceivedbyaddress,         {"minconf","addlocked","include_empty","include_watchonly","address_filter"} },
     { "wallet",             "listsinceblock",           &listsinceblock,           {"blockhash","target_confirmations","include_watchonly","include_removed"} },
-    { "wallet",             "listtransactions",         &listtransactions,         {"account|label|dummy","count","skip","include_watchonly"} },
+    { "wallet",             "listtransactions",         &listtransactions,         {"account|label|dummy","count","skip","include_watchonly","before"} },
     { "wallet",             "listunspent",              &listunspent,              {"minconf","maxconf","addresses","include_unsafe","query_options"} },
     { "wallet",             "listwallets",              &listwallets,              {} },
     { "wallet",             "loadwallet",               &loadwallet,               {"filename"} },
@@ -605,4 +605,51 @@ BOOST_AUTO_TEST_CASE(SelectCoins_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(SelectCoinsDenominated_test)
+{
+    const std::vector<CAmount> vecDenoms = CCoinJoin::GetStandardDenominations();
+    std::vector<CInputCoin> utxo_pool;
+    CoinSet selection;
+    CAmount value_ret = 0;
+
+    for (int i = 0; i < 1000; i++) {
+        add_coin(vecDenoms[2], i, utxo_pool);
+    }
+    for (int i = 0; i < 5; i++) {
+        add_coin(vecDenoms[1], i, utxo_pool);
+    }
+    for (int i = 0; i < 2; i++) {
+        add_coin(vecDenoms[0], i, utxo_pool);
+    }
+    add_coin(5 * COIN, 0, utxo_pool); // not a denomination, never selected
+
+    // Exact match, largest denominations first
+    CAmount target = 2 * vecDenoms[0] + 3 * vecDenoms[1] + 4 * vecDenoms[2];
+    BOOST_CHECK(SelectCoinsDenominated(target, GroupCoins(utxo_pool), selection, value_ret, 0));
+    BOOST_CHECK_EQUAL(value_ret, target);
+    BOOST_CHECK_EQUAL(selection.size(), 9U);
+
+    // No smaller coins, overpay with the next larger one if the fee allows it
+    BOOST_CHECK(SelectCoinsDenominated(vecDenoms[3], GroupCoins(utxo_pool), selection, value_ret, COIN / 10));
+    BOOST_CHECK_EQUAL(value_ret, vecDenoms[2]);
+    BOOST_CHECK_EQUAL(selection.size(), 1U);
+    BOOST_CHECK(!SelectCoinsDenominated(vecDenoms[3], GroupCoins(utxo_pool), selection, value_ret, COIN / 100));
+
+    // All coins, one more duff is not enough
+    target = 2 * vecDenoms[0] + 5 * vecDenoms[1] + 1000 * vecDenoms[2];
+    BOOST_CHECK(SelectCoinsDenominated(target, GroupCoins(utxo_pool), selection, value_ret, 0));
+    BOOST_CHECK_EQUAL(selection.size(), 1007U);
+    BOOST_CHECK(!SelectCoinsDenominated(target + 1, GroupCoins(utxo_pool), selection, value_ret, MAX_MONEY));
+
+    // Smaller coins are dropped again when a larger one has to be added
+    utxo_pool.clear();
+    for (int i = 0; i < 9; i++) {
+        add_coin(vecDenoms[2], i, utxo_pool);
+    }
+    add_coin(vecDenoms[1], 0, utxo_pool);
+    BOOST_CHECK(SelectCoinsDenominated(95 * COIN / 100, GroupCoins(utxo_pool), selection, value_ret, COIN / 10));
+    BOOST_CHECK_EQUAL(value_ret, vecDenoms[1]);
+    BOOST_CHECK_EQUAL(selection.size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -136,6 +136,51 @@ BOOST_AUTO_TEST_CASE(decrypt) {
     }
 }
 
+class TestCryptoKeyStore : public CCryptoKeyStore
+{
+public:
+    using CCryptoKeyStore::cs_KeyStore;
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::Unlock;
+    using CCryptoKeyStore::IsDecryptionThoroughlyChecked;
+    using CCryptoKeyStore::mapCryptedKeys;
+};
+
+BOOST_AUTO_TEST_CASE(unlock_parallel_check) {
+    CKeyingMaterial vMasterKey(WALLET_CRYPTO_KEY_SIZE), vWrongKey(WALLET_CRYPTO_KEY_SIZE);
+    GetStrongRandBytes(vMasterKey.data(), WALLET_CRYPTO_KEY_SIZE);
+    GetStrongRandBytes(vWrongKey.data(), WALLET_CRYPTO_KEY_SIZE);
+
+    TestCryptoKeyStore source;
+    std::vector<CKey> vecKeys;
+    for (size_t i = 0; i < UNLOCK_CHECK_PARALLEL_MIN; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        source.AddKey(key);
+        vecKeys.push_back(key);
+    }
+    BOOST_CHECK(source.EncryptKeys(vMasterKey));
+
+    TestCryptoKeyStore keystore;
+    {
+        LOCK(source.cs_KeyStore);
+        for (const auto& p : source.mapCryptedKeys) {
+            keystore.AddCryptedKey(p.second.first, p.second.second);
+        }
+    }
+    BOOST_CHECK(!keystore.Unlock(vWrongKey));
+    BOOST_CHECK(!keystore.IsDecryptionThoroughlyChecked());
+    BOOST_CHECK(keystore.IsLocked());
+
+    BOOST_CHECK(keystore.Unlock(vMasterKey));
+    BOOST_CHECK(keystore.IsDecryptionThoroughlyChecked());
+    for (const CKey& key : vecKeys) {
+        CKey keyOut;
+        BOOST_CHECK(keystore.GetKey(key.GetPubKey().GetID(), keyOut));
+        BOOST_CHECK(keyOut == key);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(aes_256_cbc_testvectors) {
     // NIST AES CBC 256-bit encryption test-vectors with padding enabled
     TestAES256CBC("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", \
@@ -5,6 +5,7 @@
 #include <wallet/wallet.h>
 
 #include <iostream>
+#include <list>
 #include <memory>
 #include <set>
 #include <stdint.h>
@@ -200,6 +201,9 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(wtx.GetImmatureCredit(), 500*COIN);
 }
 
+// Block index entries added by AddTx. mapBlockIndex doesn't own the entries inserted into it directly.
+static std::list<CBlockIndex> g_block_index_entries;
+
 static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
@@ -208,7 +212,8 @@ static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64
     CBlockIndex* block = nullptr;
     if (blockTime > 0) {
         LOCK(cs_main);
-        auto inserted = mapBlockIndex.emplace(GetRandHash(), new CBlockIndex);
+        g_block_index_entries.emplace_back();
+        auto inserted = mapBlockIndex.emplace(GetRandHash(), &g_block_index_entries.back());
         assert(inserted.second);
         const uint256& hash = inserted.first->first;
         block = inserted.first->second;
@@ -379,6 +384,40 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+// Check that the cached wallet balances follow new txs, coin locks and the chain tip
+BOOST_FIXTURE_TEST_CASE(balance_cache, ListCoinsTestingSetup)
+{
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), 500 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetAvailableBalance(), 500 * COIN);
+
+    // Sending 1 coin leaves 499 coins of change, mining it matures the coinbase of the next block paying to us
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, true /* subtract fee */});
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), (500 + 499) * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetAvailableBalance(), (500 + 499) * COIN);
+
+    // Locked coins are not available but still part of the balance
+    {
+        LOCK2(cs_main, wallet->cs_wallet);
+        std::vector<COutput> vCoins;
+        wallet->AvailableCoins(vCoins);
+        BOOST_CHECK_EQUAL(vCoins.size(), 2U);
+        for (const auto& coin : vCoins) {
+            wallet->LockCoin(COutPoint(coin.tx->GetHash(), coin.i));
+        }
+    }
+    BOOST_CHECK_EQUAL(wallet->GetAvailableBalance(), 0);
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), (500 + 499) * COIN);
+    {
+        LOCK(wallet->cs_wallet);
+        wallet->UnlockAllCoins();
+    }
+    BOOST_CHECK_EQUAL(wallet->GetAvailableBalance(), (500 + 499) * COIN);
+
+    // A new tip without any wallet tx still matures another coinbase
+    CreateAndProcessBlock({}, GetScriptForRawPubKey({}));
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), (2 * 500 + 499) * COIN);
+}
+
 class CreateTransactionTestSetup : public TestChain100Setup
 {
 public:
@@ -871,6 +910,130 @@ BOOST_FIXTURE_TEST_CASE(select_coins_grouped_by_addresses, ListCoinsTestingSetup
     vecTally.clear();
 }
 
+// Check that the cached anonymizable tally follows wallet changes
+BOOST_FIXTURE_TEST_CASE(select_coins_grouped_by_addresses_cached, ListCoinsTestingSetup)
+{
+    // Connected blocks mature coinbases in the tally
+    RegisterValidationInterface(wallet.get());
+
+    std::vector<CompactTallyItem> vecTally;
+    BOOST_CHECK(wallet->SelectCoinsGroupedByAddresses(vecTally));
+    BOOST_CHECK_EQUAL(vecTally.size(), 1);
+    BOOST_CHECK_EQUAL(vecTally.at(0).nAmount, 500 * COIN);
+
+    // The change of a new tx goes to a new address, its block matures another coinbase for the old one
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, true /* subtract fee */});
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(wallet->SelectCoinsGroupedByAddresses(vecTally));
+    BOOST_CHECK_EQUAL(vecTally.size(), 2);
+    BOOST_CHECK_EQUAL(vecTally.at(0).nAmount + vecTally.at(1).nAmount, (500 + 499) * COIN);
+
+    // Locked coins are excluded, a new block matures one more coinbase
+    const CInputCoin lockedCoin = vecTally.at(0).vecInputCoins.at(0);
+    {
+        LOCK(wallet->cs_wallet);
+        wallet->LockCoin(lockedCoin.outpoint);
+    }
+    CreateAndProcessBlock({}, GetScriptForRawPubKey({}));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(wallet->SelectCoinsGroupedByAddresses(vecTally));
+    CAmount nTotal = 0;
+    for (const auto& item : vecTally) {
+        nTotal += item.nAmount;
+    }
+    BOOST_CHECK_EQUAL(nTotal, (2 * 500 + 499) * COIN - lockedCoin.txout.nValue);
+
+    // The cached tally matches a fresh one
+    std::vector<CompactTallyItem> vecTallyFresh;
+    {
+        LOCK(wallet->cs_wallet);
+        wallet->MarkDirty();
+    }
+    BOOST_CHECK(wallet->SelectCoinsGroupedByAddresses(vecTallyFresh));
+    BOOST_CHECK_EQUAL(vecTally.size(), vecTallyFresh.size());
+    for (size_t i = 0; i < std::min(vecTally.size(), vecTallyFresh.size()); i++) {
+        BOOST_CHECK(vecTally[i].txdest == vecTallyFresh[i].txdest);
+        BOOST_CHECK_EQUAL(vecTally[i].nAmount, vecTallyFresh[i].nAmount);
+        BOOST_CHECK_EQUAL(vecTally[i].vecInputCoins.size(), vecTallyFresh[i].vecInputCoins.size());
+    }
+
+    UnregisterValidationInterface(wallet.get());
+}
+
+// Check that the HD keys derived in batches for the keypool match the keys derived one by one
+BOOST_FIXTURE_TEST_CASE(hd_keypool_topup, TestChain100Setup)
+{
+    std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>(WalletLocation(), WalletDatabase::CreateMock());
+    bool firstRun;
+    wallet->LoadWallet(firstRun);
+    LOCK(wallet->cs_wallet);
+    wallet->GenerateNewHDChain("", "");
+    BOOST_CHECK(wallet->IsHDEnabled());
+    BOOST_CHECK_EQUAL(wallet->KeypoolCountExternalKeys(), DEFAULT_KEYPOOL_SIZE);
+    BOOST_CHECK_EQUAL(wallet->KeypoolCountInternalKeys(), DEFAULT_KEYPOOL_SIZE);
+
+    std::set<CKeyID> setKeyIDs;
+    for (bool fInternal : {false, true}) {
+        for (int i = 0; i < 10; i++) {
+            CPubKey pubkey;
+            BOOST_CHECK(wallet->GetKeyFromPool(pubkey, fInternal));
+            CKey key;
+            BOOST_CHECK(wallet->GetKey(pubkey.GetID(), key));
+            BOOST_CHECK(key.GetPubKey() == pubkey);
+            BOOST_CHECK(wallet->mapKeyMetadata.count(pubkey.GetID()));
+            setKeyIDs.emplace(pubkey.GetID());
+        }
+    }
+    BOOST_CHECK_EQUAL(setKeyIDs.size(), 20U);
+
+    // Topping up again continues where the previous batch ended
+    BOOST_CHECK(wallet->TopUpKeyPool());
+    BOOST_CHECK_EQUAL(wallet->KeypoolCountExternalKeys(), DEFAULT_KEYPOOL_SIZE);
+    BOOST_CHECK_EQUAL(wallet->KeypoolCountInternalKeys(), DEFAULT_KEYPOOL_SIZE);
+    CHDChain hdChain;
+    BOOST_CHECK(wallet->GetHDChain(hdChain));
+    CHDAccount acc;
+    BOOST_CHECK(hdChain.GetAccount(0, acc));
+    BOOST_CHECK_EQUAL(acc.nExternalChainCounter, DEFAULT_KEYPOOL_SIZE + 10);
+    BOOST_CHECK_EQUAL(acc.nInternalChainCounter, DEFAULT_KEYPOOL_SIZE + 10);
+}
+
+// Check that the journal coalesces writes per key and commits them in one go
+BOOST_FIXTURE_TEST_CASE(wallet_db_journal, TestChain100Setup)
+{
+    std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>(WalletLocation(), WalletDatabase::CreateMock());
+    bool firstRun;
+    wallet->LoadWallet(firstRun);
+    WalletDBJournal& journal = wallet->GetDBJournal();
+
+    COutPoint outpoint1(InsecureRand256(), 0), outpoint2(InsecureRand256(), 1);
+    journal.WriteCoinJoinRounds(outpoint1, 16, 2);
+    journal.WriteCoinJoinRounds(outpoint1, 16, 3);
+    journal.WriteCoinJoinRounds(outpoint2, 16, 4);
+    BOOST_CHECK_EQUAL(journal.GetPendingCount(), 2U);
+
+    BOOST_CHECK(journal.Flush());
+    BOOST_CHECK_EQUAL(journal.GetPendingCount(), 0U);
+    BOOST_CHECK_EQUAL(journal.nFlushes, 1U);
+    BOOST_CHECK_EQUAL(journal.nFlushedRecords, 2U);
+
+    // a discarded write is never committed
+    journal.WriteCoinJoinRounds(outpoint2, 16, 5);
+    journal.DiscardCoinJoinRounds(outpoint2);
+    BOOST_CHECK_EQUAL(journal.GetPendingCount(), 0U);
+    // nothing pending, nothing to commit
+    BOOST_CHECK(journal.Flush());
+    BOOST_CHECK_EQUAL(journal.nFlushes, 1U);
+
+    BerkeleyBatch batch(wallet->GetDBHandle(), "r");
+    std::pair<int, int> rounds;
+    BOOST_CHECK(batch.Read(std::make_pair(std::string("cj_rounds"), outpoint1), rounds));
+    BOOST_CHECK_EQUAL(rounds.first, 16);
+    BOOST_CHECK_EQUAL(rounds.second, 3);
+    BOOST_CHECK(batch.Read(std::make_pair(std::string("cj_rounds"), outpoint2), rounds));
+    BOOST_CHECK_EQUAL(rounds.second, 4);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>(WalletLocation(), WalletDatabase::CreateDummy());
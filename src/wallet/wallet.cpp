@@ -33,6 +33,8 @@
 #include <wallet/fees.h>
 #include <warnings.h>
 
+#include <ctpl_stl.h>
+
 #include <coinjoin/coinjoin-client.h>
 #include <coinjoin/coinjoin-client-options.h>
 #include <governance/governance.h>
@@ -45,6 +47,7 @@
 #include <llmq/quorums_chainlocks.h>
 
 #include <assert.h>
+#include <deque>
 #include <future>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -272,6 +275,143 @@ void CWallet::DeriveNewChildKey(WalletBatch &batch, const CKeyMetadata& metadata
         throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
 }
 
+std::vector<CHDPubKey> CWallet::DeriveNewChildKeys(WalletBatch &batch, CHDChain& hdChain, const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, size_t nCount)
+{
+    AssertLockHeld(cs_wallet);
+
+    if (nCount == 0) {
+        return {};
+    }
+
+    CHDChain hdChainTmp = hdChain;
+    if (!DecryptHDChain(hdChainTmp))
+        throw std::runtime_error(std::string(__func__) + ": DecryptHDChain failed");
+    // make sure seed matches this chain
+    if (hdChainTmp.GetID() != hdChainTmp.GetSeedHash())
+        throw std::runtime_error(std::string(__func__) + ": Wrong HD chain!");
+
+    CHDAccount acc;
+    if (!hdChainTmp.GetAccount(nAccountIndex, acc))
+        throw std::runtime_error(std::string(__func__) + ": Wrong HD account!");
+
+    // Child keys are not hardened, so they can be derived from the public chain key. This yields the same keys as
+    // deriving the private keys (which GetKey does on the fly) and doesn't need the seed for every key.
+    CExtKey changeKey;
+    hdChainTmp.DeriveChangeExtKey(nAccountIndex, fInternal, changeKey);
+    const CExtPubKey changePubKey = changeKey.Neuter();
+
+    std::vector<CHDPubKey> vecHDPubKeys;
+    vecHDPubKeys.reserve(nCount);
+    uint32_t nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
+    std::unique_ptr<ctpl::thread_pool> pool;
+
+    // derive keys at the next indexes, skip keys already known to the wallet and derive more for them
+    while (vecHDPubKeys.size() < nCount) {
+        const size_t nMissing = nCount - vecHDPubKeys.size();
+        std::vector<CExtPubKey> vecChildKeys(nMissing);
+        auto deriveRange = [&](size_t nBegin, size_t nEnd) {
+            bool fSuccess = true;
+            for (size_t i = nBegin; i < nEnd; i++) {
+                fSuccess &= changePubKey.Derive(vecChildKeys[i], nChildIndex + i);
+            }
+            return fSuccess;
+        };
+
+        bool fSuccess = true;
+        const size_t nThreads = std::min(GetNumCores(), KEYPOOL_DERIVE_THREADS);
+        if (nMissing < KEYPOOL_DERIVE_PARALLEL_MIN || nThreads < 2) {
+            fSuccess = deriveRange(0, nMissing);
+        } else {
+            if (!pool) {
+                pool = MakeUnique<ctpl::thread_pool>(nThreads);
+                RenameThreadPool(*pool, "dash-keypool");
+            }
+            std::vector<std::future<bool>> futures;
+            const size_t nPerThread = (nMissing + nThreads - 1) / nThreads;
+            for (size_t nBegin = 0; nBegin < nMissing; nBegin += nPerThread) {
+                const size_t nEnd = std::min(nBegin + nPerThread, nMissing);
+                futures.emplace_back(pool->push([&deriveRange, nBegin, nEnd](int) { return deriveRange(nBegin, nEnd); }));
+            }
+            for (auto& future : futures) {
+                fSuccess &= future.get();
+            }
+        }
+        if (!fSuccess) {
+            throw std::runtime_error(std::string(__func__) + ": Deriving child key failed");
+        }
+
+        for (const auto& childPubKey : vecChildKeys) {
+            const CKeyID keyID = childPubKey.pubkey.GetID();
+            if (HaveKey(keyID)) continue;
+
+            CHDPubKey hdPubKey;
+            hdPubKey.extPubKey = childPubKey;
+            hdPubKey.hdchainID = hdChain.GetID();
+            hdPubKey.nChangeIndex = fInternal ? 1 : 0;
+            if (!batch.WriteHDPubKey(hdPubKey, metadata))
+                throw std::runtime_error(std::string(__func__) + ": WriteHDPubKey failed");
+
+            // watch-only scripts of the key are removed from memory by LoadNewChildKeys
+            for (const CScript& script : {GetScriptForDestination(keyID), GetScriptForRawPubKey(childPubKey.pubkey)}) {
+                if (HaveWatchOnly(script) && !batch.EraseWatchOnly(script))
+                    throw std::runtime_error(std::string(__func__) + ": EraseWatchOnly failed");
+            }
+            vecHDPubKeys.emplace_back(hdPubKey);
+        }
+        nChildIndex += nMissing;
+    }
+
+    // update the chain model in the database once for all keys
+    if (fInternal) {
+        acc.nInternalChainCounter = nChildIndex;
+    }
+    else {
+        acc.nExternalChainCounter = nChildIndex;
+    }
+
+    if (!hdChain.SetAccount(nAccountIndex, acc))
+        throw std::runtime_error(std::string(__func__) + ": SetAccount failed");
+
+    if (IsCrypted()) {
+        if (!batch.WriteCryptedHDChain(hdChain))
+            throw std::runtime_error(std::string(__func__) + ": WriteCryptedHDChain failed");
+    }
+    else {
+        if (!batch.WriteHDChain(hdChain))
+            throw std::runtime_error(std::string(__func__) + ": WriteHDChain failed");
+    }
+
+    return vecHDPubKeys;
+}
+
+void CWallet::LoadNewChildKeys(const CHDChain& hdChain, const std::vector<CHDPubKey>& vecHDPubKeys, const CKeyMetadata& metadata)
+{
+    AssertLockHeld(cs_wallet);
+
+    bool fWatchOnlyRemoved = false;
+    for (const auto& hdPubKey : vecHDPubKeys) {
+        const CPubKey& pubkey = hdPubKey.extPubKey.pubkey;
+        mapKeyMetadata[pubkey.GetID()] = metadata;
+        LoadHDPubKey(hdPubKey);
+        for (const CScript& script : {GetScriptForDestination(pubkey.GetID()), GetScriptForRawPubKey(pubkey)}) {
+            if (HaveWatchOnly(script)) {
+                CCryptoKeyStore::RemoveWatchOnly(script);
+                fWatchOnlyRemoved = true;
+            }
+        }
+    }
+    if (fWatchOnlyRemoved && !HaveWatchOnly())
+        NotifyWatchonlyChanged(false);
+    UpdateTimeFirstKey(metadata.nCreateTime);
+
+    if (IsCrypted()) {
+        CCryptoKeyStore::SetCryptedHDChain(hdChain);
+    }
+    else {
+        CCryptoKeyStore::SetHDChain(hdChain);
+    }
+}
+
 bool CWallet::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
 {
     LOCK(cs_wallet);
@@ -347,10 +487,10 @@ bool CWallet::AddHDPubKey(WalletBatch &batch, const CExtPubKey &extPubKey, bool
     CScript script;
     script = GetScriptForDestination(extPubKey.pubkey.GetID());
     if (HaveWatchOnly(script))
-        RemoveWatchOnly(script);
+        RemoveWatchOnly(batch, script);
     script = GetScriptForRawPubKey(extPubKey.pubkey);
     if (HaveWatchOnly(script))
-        RemoveWatchOnly(script);
+        RemoveWatchOnly(batch, script);
 
     return batch.WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
 }
@@ -496,13 +636,20 @@ bool CWallet::AddWatchOnly(const CScript& dest, int64_t nCreateTime)
 }
 
 bool CWallet::RemoveWatchOnly(const CScript &dest)
+{
+    AssertLockHeld(cs_wallet);
+    WalletBatch batch(*database);
+    return RemoveWatchOnly(batch, dest);
+}
+
+bool CWallet::RemoveWatchOnly(WalletBatch &batch, const CScript &dest)
 {
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
-    if (!WalletBatch(*database).EraseWatchOnly(dest))
+    if (!batch.EraseWatchOnly(dest))
         return false;
 
     return true;
@@ -537,6 +684,9 @@ bool CWallet::Unlock(const SecureString& strWalletPassphrase, bool fForMixingOnl
 
     {
         LOCK(cs_wallet);
+        if (nDecryptionCheckVersion == nWalletVersion) {
+            SetDecryptionThoroughlyChecked();
+        }
         for (const MasterKeyMap::value_type& pMasterKey : mapMasterKeys)
         {
             if (!crypter.SetKeyFromPassphrase(strWalletPassphraseFinal, pMasterKey.second.vchSalt, pMasterKey.second.nDeriveIterations, pMasterKey.second.nDerivationMethod))
@@ -544,6 +694,11 @@ bool CWallet::Unlock(const SecureString& strWalletPassphrase, bool fForMixingOnl
             if (!crypter.Decrypt(pMasterKey.second.vchCryptedKey, _vMasterKey))
                 continue; // try another master key
             if (CCryptoKeyStore::Unlock(_vMasterKey, fForMixingOnly)) {
+                if (nDecryptionCheckVersion != nWalletVersion) {
+                    // don't check all keys again on the next start
+                    WalletBatch(*database).WriteDecryptionCheck(nWalletVersion);
+                    nDecryptionCheckVersion = nWalletVersion;
+                }
                 if(nWalletBackups == -2) {
                     TopUpKeyPool();
                     WalletLogPrintf("Keypool replenished, re-initializing automatic backups.\n");
@@ -697,6 +852,8 @@ std::set<uint256> CWallet::GetConflicts(const uint256& txid) const
 
 void CWallet::Flush(bool shutdown)
 {
+    PersistCoinJoinRounds();
+    m_db_journal.Flush();
     database->Flush(shutdown);
 }
 
@@ -763,10 +920,46 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+bool CWallet::AddWalletUTXO(const COutPoint& outpoint, CAmount nValue)
+{
+    if (!setWalletUTXO.insert(outpoint).second) {
+        return false;
+    }
+    MarkBalancesDirty();
+    MarkAnonymizableTallyDirty(outpoint.hash);
+    if (CCoinJoin::IsDenominatedAmount(nValue)) {
+        mapDenominatedUTXOs[nValue].insert(outpoint);
+    }
+    return true;
+}
+
+void CWallet::RemoveWalletUTXO(const COutPoint& outpoint)
+{
+    if (!setWalletUTXO.erase(outpoint)) {
+        return;
+    }
+    MarkBalancesDirty();
+    MarkAnonymizableTallyDirty(outpoint.hash);
+    auto it = mapWallet.find(outpoint.hash);
+    for (auto jt = mapDenominatedUTXOs.begin(); jt != mapDenominatedUTXOs.end(); ) {
+        // the tx might be gone already (e.g. zapped), there are only a few denominations to check then
+        if (it != mapWallet.end() && jt->first != it->second.tx->vout[outpoint.n].nValue) {
+            ++jt;
+            continue;
+        }
+        jt->second.erase(outpoint);
+        if (jt->second.empty()) {
+            jt = mapDenominatedUTXOs.erase(jt);
+        } else {
+            ++jt;
+        }
+    }
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
-    setWalletUTXO.erase(outpoint);
+    RemoveWalletUTXO(outpoint);
 
     setLockedCoins.erase(outpoint);
 
@@ -1084,12 +1277,29 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
+        // Rebuilding is cheaper than updating the tally for every tx
+        ResetAnonymizableTally();
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        MarkBalancesDirty();
+    }
+}
+
+void CWallet::MarkAnonymizableTallyDirty(const uint256& hash) const
+{
+    // Nothing to update if the tally is going to be rebuilt anyway
+    if (anonymizableTally.fValid) {
+        anonymizableTally.setDirtyTxs.emplace(hash);
+    }
+    if (anonymizableTallyNonDenom.fValid) {
+        anonymizableTallyNonDenom.setDirtyTxs.emplace(hash);
     }
+}
 
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
+void CWallet::ResetAnonymizableTally() const
+{
+    anonymizableTally = AnonymizableTally();
+    anonymizableTallyNonDenom = AnonymizableTally();
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
@@ -1112,11 +1322,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, nullptr)));
         wtx.nTimeSmart = ComputeTimeSmart(wtx);
         AddToSpends(hash);
+        InvalidateCoinJoinRounds(hash, batch);
 
         auto mnList = deterministicMNManager->GetListAtChainTip();
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
-                setWalletUTXO.insert(COutPoint(hash, i));
+                AddWalletUTXO(COutPoint(hash, i), wtx.tx->vout[i].nValue);
                 if (deterministicMNManager->IsProTxWithCollateral(wtx.tx, i) || mnList.HasMNByCollateral(COutPoint(hash, i))) {
                     LockCoin(COutPoint(hash, i));
                 }
@@ -1153,7 +1364,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         auto mnList = deterministicMNManager->GetListAtChainTip();
         for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
-                bool new_utxo = setWalletUTXO.insert(COutPoint(hash, i)).second;
+                bool new_utxo = AddWalletUTXO(COutPoint(hash, i), wtx.tx->vout[i].nValue);
                 if (new_utxo && (deterministicMNManager->IsProTxWithCollateral(wtx.tx, i) || mnList.HasMNByCollateral(COutPoint(hash, i)))) {
                     LockCoin(COutPoint(hash, i));
                 }
@@ -1186,9 +1397,6 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         t.detach(); // thread runs free
     }
 
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
-
     return true;
 }
 
@@ -1352,9 +1560,6 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
         }
     }
 
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
-
     return true;
 }
 
@@ -1410,9 +1615,6 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             MarkInputsDirty(wtx.tx);
         }
     }
-
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
 }
 
 void CWallet::SyncTransaction(const CTransactionRef& ptx, const CBlockIndex *pindex, int posInBlock, bool update_tx) {
@@ -1423,18 +1625,19 @@ void CWallet::SyncTransaction(const CTransactionRef& ptx, const CBlockIndex *pin
     // available of the outputs it spends. So force those to be
     // recomputed, also:
     MarkInputsDirty(ptx);
-
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
 }
 
-void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcceptTime) {
+void CWallet::TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs) {
     LOCK2(cs_main, cs_wallet);
-    SyncTransaction(ptx);
+    for (const auto& p : txs) {
+        SyncTransaction(p.first);
 
-    auto it = mapWallet.find(ptx->GetHash());
-    if (it != mapWallet.end()) {
-        it->second.fInMempool = true;
+        auto it = mapWallet.find(p.first->GetHash());
+        if (it != mapWallet.end()) {
+            it->second.fInMempool = true;
+            MarkBalancesDirty();
+            MarkAnonymizableTallyDirty(it->first);
+        }
     }
 }
 
@@ -1444,6 +1647,8 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx, MemPoolR
         auto it = mapWallet.find(ptx->GetHash());
         if (it != mapWallet.end()) {
             it->second.fInMempool = false;
+            MarkBalancesDirty();
+            MarkAnonymizableTallyDirty(it->first);
         }
     }
 }
@@ -1498,9 +1703,11 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
 
     hashPrevBestCoinbase = pblock->vtx[0]->GetHash();
 
-    // reset cache to make sure no longer immature coins are included
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
+    // recheck immature coins, some of them might be mature now
+    for (AnonymizableTally* pTally : {&anonymizableTally, &anonymizableTallyNonDenom}) {
+        pTally->setDirtyTxs.insert(pTally->setImmatureTxs.begin(), pTally->setImmatureTxs.end());
+        pTally->setImmatureTxs.clear();
+    }
 }
 
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) {
@@ -1512,8 +1719,7 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, con
     }
 
     // reset cache to make sure no longer mature coins are excluded
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
+    ResetAnonymizableTally();
 }
 
 
@@ -1577,84 +1783,186 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
 }
 
 // Recursively determine the rounds of a given input (How deep is the CoinJoin chain for a given input)
-int CWallet::GetRealOutpointCoinJoinRounds(const COutPoint& outpoint, int nRounds) const
+int CWallet::GetRealOutpointCoinJoinRounds(const COutPoint& outpoint) const
 {
     LOCK(cs_wallet);
 
     const int nRoundsMax = MAX_COINJOIN_ROUNDS + CCoinJoinClientOptions::GetRandomRounds();
 
-    if (nRounds >= nRoundsMax) {
-        // there can only be nRoundsMax rounds max
-        return nRoundsMax - 1;
-    }
-
-    auto pair = mapOutpointRoundsCache.emplace(outpoint, -10);
-    auto nRoundsRef = &pair.first->second;
-    if (!pair.second) {
+    auto it = mapOutpointRoundsCache.find(outpoint);
+    if (it != mapOutpointRoundsCache.end()) {
         // we already processed it, just return what we have
-        return *nRoundsRef;
-    }
+        return it->second;
+    }
+
+    // Walk the ancestry depth first with an explicit stack instead of recursing. An outpoint is marked with -10 while
+    // its inputs are processed, it is finished when we get back to it. Every outpoint is only calculated once.
+    std::vector<std::pair<COutPoint, int>> vecNewRounds;
+    std::vector<COutPoint> vecStack{outpoint};
+    while (!vecStack.empty()) {
+        const COutPoint curOutpoint = vecStack.back();
+        auto pair = mapOutpointRoundsCache.emplace(curOutpoint, -10);
+        int& nRoundsRef = pair.first->second;
+        if (!pair.second && nRoundsRef != -10) {
+            // reached through multiple descendants
+            vecStack.pop_back();
+            continue;
+        }
+
+        const CWalletTx* wtx = GetWalletTx(curOutpoint.hash);
+
+        if (pair.second) {
+            if (wtx == nullptr || wtx->tx == nullptr) {
+                // no such tx in this wallet
+                nRoundsRef = -1;
+                LogPrint(BCLog::COINJOIN, "%s FAILED    %-70s %3d\n", __func__, curOutpoint.ToStringShort(), -1);
+                vecStack.pop_back();
+                continue;
+            }
+
+            // bounds check
+            if (curOutpoint.n >= wtx->tx->vout.size()) {
+                // should never actually hit this
+                nRoundsRef = -4;
+                LogPrint(BCLog::COINJOIN, "%s FAILED    %-70s %3d\n", __func__, curOutpoint.ToStringShort(), -4);
+                vecStack.pop_back();
+                continue;
+            }
+
+            auto txOutRef = &wtx->tx->vout[curOutpoint.n];
+
+            if (CCoinJoin::IsCollateralAmount(txOutRef->nValue)) {
+                nRoundsRef = -3;
+                LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, curOutpoint.ToStringShort(), nRoundsRef);
+                vecStack.pop_back();
+                continue;
+            }
+
+            // make sure the final output is non-denominate
+            if (!CCoinJoin::IsDenominatedAmount(txOutRef->nValue)) { //NOT DENOM
+                nRoundsRef = -2;
+                LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, curOutpoint.ToStringShort(), nRoundsRef);
+                vecStack.pop_back();
+                continue;
+            }
+
+            bool fNonDenomFound = false;
+            for (const auto& out : wtx->tx->vout) {
+                if (!CCoinJoin::IsDenominatedAmount(out.nValue)) {
+                    fNonDenomFound = true;
+                    break;
+                }
+            }
+            if (fNonDenomFound) {
+                // this one is denominated but there is another non-denominated output found in the same tx
+                nRoundsRef = 0;
+                LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, curOutpoint.ToStringShort(), nRoundsRef);
+                vecNewRounds.emplace_back(curOutpoint, nRoundsRef);
+                vecStack.pop_back();
+                continue;
+            }
 
-    // TODO wtx should refer to a CWalletTx object, not a pointer, based on surrounding code
-    const CWalletTx* wtx = GetWalletTx(outpoint.hash);
+            // only denoms here so let's look up, but process the inputs we don't know yet first
+            bool fPending = false;
+            for (const auto& txinNext : wtx->tx->vin) {
+                if (IsMine(txinNext) && !mapOutpointRoundsCache.count(txinNext.prevout)) {
+                    vecStack.emplace_back(txinNext.prevout);
+                    fPending = true;
+                }
+            }
+            if (fPending) {
+                continue;
+            }
+        }
 
-    if (wtx == nullptr || wtx->tx == nullptr) {
-        // no such tx in this wallet
-        *nRoundsRef = -1;
-        LogPrint(BCLog::COINJOIN, "%s FAILED    %-70s %3d\n", __func__, outpoint.ToStringShort(), -1);
-        return *nRoundsRef;
+        int nShortest = -10; // an initial value, should be no way to get this by calculations
+        bool fDenomFound = false;
+        for (const auto& txinNext : wtx->tx->vin) {
+            if (IsMine(txinNext)) {
+                auto jt = mapOutpointRoundsCache.find(txinNext.prevout);
+                int n = jt != mapOutpointRoundsCache.end() ? jt->second : -10;
+                // denom found, find the shortest chain or initially assign nShortest with the first found value
+                if(n >= 0 && (n < nShortest || nShortest == -10)) {
+                    nShortest = n;
+                    fDenomFound = true;
+                }
+            }
+        }
+        nRoundsRef = fDenomFound
+                ? (nShortest >= nRoundsMax - 1 ? nRoundsMax : nShortest + 1) // good, we a +1 to the shortest one but only nRoundsMax rounds max allowed
+                : 0;            // too bad, we are the fist one in that chain
+        LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, curOutpoint.ToStringShort(), nRoundsRef);
+        vecNewRounds.emplace_back(curOutpoint, nRoundsRef);
+        vecStack.pop_back();
     }
 
-    // bounds check
-    if (outpoint.n >= wtx->tx->vout.size()) {
-        // should never actually hit this
-        *nRoundsRef = -4;
-        LogPrint(BCLog::COINJOIN, "%s FAILED    %-70s %3d\n", __func__, outpoint.ToStringShort(), -4);
-        return *nRoundsRef;
+    // Persisted later by PersistCoinJoinRounds, so that we don't have to walk the ancestry again after a restart
+    for (const auto& p : vecNewRounds) {
+        setOutpointRoundsToPersist.emplace(p.first);
     }
 
-    auto txOutRef = &wtx->tx->vout[outpoint.n];
+    return mapOutpointRoundsCache.at(outpoint);
+}
+
+void CWallet::PersistCoinJoinRounds()
+{
+    LOCK(cs_wallet);
 
-    if (CCoinJoin::IsCollateralAmount(txOutRef->nValue)) {
-        *nRoundsRef = -3;
-        LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, outpoint.ToStringShort(), *nRoundsRef);
-        return *nRoundsRef;
+    const int nRoundsMax = MAX_COINJOIN_ROUNDS + CCoinJoinClientOptions::GetRandomRounds();
+    for (const auto& outpoint : setOutpointRoundsToPersist) {
+        auto it = mapOutpointRoundsCache.find(outpoint);
+        if (it != mapOutpointRoundsCache.end()) {
+            m_db_journal.WriteCoinJoinRounds(outpoint, nRoundsMax, it->second);
+        }
     }
+    setOutpointRoundsToPersist.clear();
+}
+
+void CWallet::LoadCoinJoinRounds(const COutPoint& outpoint, int nRoundsMax, int nRounds)
+{
+    AssertLockHeld(cs_wallet);
 
-    // make sure the final output is non-denominate
-    if (!CCoinJoin::IsDenominatedAmount(txOutRef->nValue)) { //NOT DENOM
-        *nRoundsRef = -2;
-        LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, outpoint.ToStringShort(), *nRoundsRef);
-        return *nRoundsRef;
+    if (nRoundsMax != MAX_COINJOIN_ROUNDS + CCoinJoinClientOptions::GetRandomRounds()) {
+        // calculated with a different maximum, will be recalculated when needed
+        return;
     }
+    mapOutpointRoundsCache.emplace(outpoint, nRounds);
+}
 
-    for (const auto& out : wtx->tx->vout) {
-        if (!CCoinJoin::IsDenominatedAmount(out.nValue)) {
-            // this one is denominated but there is another non-denominated output found in the same tx
-            *nRoundsRef = 0;
-            LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, outpoint.ToStringShort(), *nRoundsRef);
-            return *nRoundsRef;
+void CWallet::InvalidateCoinJoinRounds(const uint256& hash, WalletBatch& batch)
+{
+    AssertLockHeld(cs_wallet);
+
+    std::vector<uint256> vecTodo{hash};
+    std::set<uint256> setDone;
+    while (!vecTodo.empty()) {
+        uint256 curHash = vecTodo.back();
+        vecTodo.pop_back();
+        if (!setDone.emplace(curHash).second) {
+            continue;
         }
-    }
 
-    int nShortest = -10; // an initial value, should be no way to get this by calculations
-    bool fDenomFound = false;
-    // only denoms here so let's look up
-    for (const auto& txinNext : wtx->tx->vin) {
-        if (IsMine(txinNext)) {
-            int n = GetRealOutpointCoinJoinRounds(txinNext.prevout, nRounds + 1);
-            // denom found, find the shortest chain or initially assign nShortest with the first found value
-            if(n >= 0 && (n < nShortest || nShortest == -10)) {
-                nShortest = n;
-                fDenomFound = true;
+        auto it = mapOutpointRoundsCache.lower_bound(COutPoint(curHash, 0));
+        if (it == mapOutpointRoundsCache.end() || it->first.hash != curHash) {
+            // nothing was calculated from the outputs of this tx, so the descendants aren't affected either
+            continue;
+        }
+        // outputs of this tx might be (not) fully mixed anymore
+        MarkAnonymizableTallyDirty(curHash);
+        while (it != mapOutpointRoundsCache.end() && it->first.hash == curHash) {
+            // erased right away, the journal only holds records which can be recalculated if they get lost
+            setOutpointRoundsToPersist.erase(it->first);
+            m_db_journal.DiscardCoinJoinRounds(it->first);
+            if (it->second >= 0) {
+                batch.EraseCoinJoinRounds(it->first);
             }
+            it = mapOutpointRoundsCache.erase(it);
+        }
+
+        for (auto jt = mapTxSpends.lower_bound(COutPoint(curHash, 0)); jt != mapTxSpends.end() && jt->first.hash == curHash; ++jt) {
+            vecTodo.emplace_back(jt->second);
         }
     }
-    *nRoundsRef = fDenomFound
-            ? (nShortest >= nRoundsMax - 1 ? nRoundsMax : nShortest + 1) // good, we a +1 to the shortest one but only nRoundsMax rounds max allowed
-            : 0;            // too bad, we are the fist one in that chain
-    LogPrint(BCLog::COINJOIN, "%s UPDATED   %-70s %3d\n", __func__, outpoint.ToStringShort(), *nRoundsRef);
-    return *nRoundsRef;
 }
 
 // respect current settings
@@ -2185,6 +2493,18 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
  * the main chain after to the addition of any new keys you want to detect
  * transactions for.
  */
+namespace {
+//! Result of reading a block and matching its outputs against the wallet's keys on a rescan worker thread
+struct RescanPrefetchedBlock
+{
+    bool fRead{false};
+    CBlock block;
+    bool fOutputsMatch{false};
+    // Number of wallet keys known when the outputs were matched, see ScanForWalletTransactions
+    size_t nKeys{0};
+};
+} // anonymous namespace
+
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlockIndex* pindexStop, const WalletRescanReserver &reserver, bool fUpdate)
 {
     int64_t nNow = GetTime();
@@ -2216,6 +2536,54 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 progress_end = GuessVerificationProgress(chainParams.TxData(), pindexStop);
             }
         }
+
+        // Blocks are read from disk and their outputs are matched against the wallet's keys by worker threads, ahead
+        // of the block that is currently being processed. Inputs are matched against snapshots of the wallet's txids
+        // and spent outpoints, which are kept up to date as transactions are found. Only blocks which match either
+        // way need cs_main and cs_wallet for SyncTransaction. Finding a transaction might top up the keypool, in
+        // which case the outputs of blocks which were matched with fewer keys are matched again.
+        std::unordered_set<uint256, StaticSaltedHasher> setWalletTxids;
+        std::unordered_set<COutPoint, SaltedOutpointHasher> setWalletSpends;
+        size_t nKeys;
+        {
+            LOCK(cs_wallet);
+            setWalletTxids.reserve(mapWallet.size());
+            for (const auto& p : mapWallet) {
+                setWalletTxids.emplace(p.first);
+            }
+            setWalletSpends.reserve(mapTxSpends.size());
+            for (const auto& p : mapTxSpends) {
+                setWalletSpends.emplace(p.first);
+            }
+            nKeys = mapKeyMetadata.size();
+        }
+
+        ctpl::thread_pool prefetchPool(RESCAN_PREFETCH_THREADS);
+        RenameThreadPool(prefetchPool, "dash-rescan");
+        std::deque<std::pair<CBlockIndex*, std::future<RescanPrefetchedBlock>>> prefetchQueue;
+        CBlockIndex* pindexPrefetch = pindex;
+        auto prefetch = [&]() {
+            while (pindexPrefetch != nullptr && prefetchQueue.size() < RESCAN_PREFETCH_BLOCKS) {
+                CBlockIndex* pindexJob = pindexPrefetch;
+                const size_t nJobKeys = nKeys;
+                prefetchQueue.emplace_back(pindexJob, prefetchPool.push([this, pindexJob, nJobKeys](int) {
+                    RescanPrefetchedBlock ret;
+                    ret.nKeys = nJobKeys;
+                    ret.fRead = ReadBlockFromDisk(ret.block, pindexJob, Params().GetConsensus());
+                    for (size_t i = 0; ret.fRead && i < ret.block.vtx.size() && !ret.fOutputsMatch; i++) {
+                        ret.fOutputsMatch = IsMine(*ret.block.vtx[i]);
+                    }
+                    return ret;
+                }));
+                if (pindexJob == pindexStop) {
+                    pindexPrefetch = nullptr;
+                } else {
+                    LOCK(cs_main);
+                    pindexPrefetch = chainActive.Next(pindexJob);
+                }
+            }
+        };
+
         double progress_current = progress_begin;
         while (pindex && !fAbortRescan && !ShutdownRequested())
         {
@@ -2228,17 +2596,46 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, progress_current);
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                LOCK2(cs_main, cs_wallet);
-                if (pindex && !chainActive.Contains(pindex)) {
-                    // Abort scan if current block is no longer active, to prevent
-                    // marking transactions as coming from the wrong block.
-                    ret = pindex;
-                    break;
+            if (prefetchQueue.empty() || prefetchQueue.front().first != pindex) {
+                // The chain changed while prefetching
+                prefetchQueue.clear();
+                pindexPrefetch = pindex;
+            }
+            prefetch();
+            RescanPrefetchedBlock prefetched = prefetchQueue.front().second.get();
+            prefetchQueue.pop_front();
+            prefetch();
+
+            if (prefetched.fRead) {
+                const CBlock& block = prefetched.block;
+                bool fMatch = prefetched.nKeys == nKeys ? prefetched.fOutputsMatch : std::any_of(block.vtx.begin(), block.vtx.end(), [this](const CTransactionRef& tx) { return IsMine(*tx); });
+                for (size_t i = 0; i < block.vtx.size() && !fMatch; i++) {
+                    const CTransaction& tx = *block.vtx[i];
+                    fMatch = setWalletTxids.count(tx.GetHash()) != 0;
+                    for (const CTxIn& txin : tx.vin) {
+                        if (fMatch) break;
+                        fMatch = setWalletTxids.count(txin.prevout.hash) != 0 || setWalletSpends.count(txin.prevout) != 0;
+                    }
                 }
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    SyncTransaction(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                if (fMatch) {
+                    LOCK2(cs_main, cs_wallet);
+                    if (pindex && !chainActive.Contains(pindex)) {
+                        // Abort scan if current block is no longer active, to prevent
+                        // marking transactions as coming from the wrong block.
+                        ret = pindex;
+                        break;
+                    }
+                    for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                        SyncTransaction(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                    }
+                    for (const CTransactionRef& tx : block.vtx) {
+                        if (mapWallet.count(tx->GetHash()) && setWalletTxids.emplace(tx->GetHash()).second) {
+                            for (const CTxIn& txin : tx->vin) {
+                                setWalletSpends.emplace(txin.prevout);
+                            }
+                        }
+                    }
+                    nKeys = mapKeyMetadata.size();
                 }
             } else {
                 ret = pindex;
@@ -2248,6 +2645,11 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             }
             {
                 LOCK(cs_main);
+                if (!chainActive.Contains(pindex)) {
+                    // Same as above, the blocks after this one are not the ones that were prefetched
+                    ret = pindex;
+                    break;
+                }
                 pindex = chainActive.Next(pindex);
                 progress_current = GuessVerificationProgress(chainParams.TxData(), pindex);
                 if (pindexStop == nullptr && tip != chainActive.Tip()) {
@@ -2329,6 +2731,28 @@ std::set<uint256> CWalletTx::GetConflicts() const
     return result;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fAnonymizedCreditCached = false;
+    fDenomUnconfCreditCached = false;
+    fDenomConfCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+
+    // The wallet-wide balances and the CoinJoin tally include this tx
+    if (pwallet != nullptr) {
+        pwallet->MarkBalancesDirty();
+        pwallet->MarkAnonymizableTallyDirty(GetHash());
+    }
+}
+
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
 {
     if (tx->vin.empty())
@@ -2685,16 +3109,50 @@ std::unordered_set<const CWalletTx*, WalletTxHasher> CWallet::GetSpendableTXs()
     return ret;
 }
 
+bool CWallet::GetCachedBalance(const BalanceCacheKey& key, CAmount& nBalanceRet) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+    if (hashTip != hashBalanceCacheTip) {
+        // depth, maturity and finality of every tx might have changed
+        mapBalanceCache.clear();
+        hashBalanceCacheTip = hashTip;
+        return false;
+    }
+
+    auto it = mapBalanceCache.find(key);
+    if (it == mapBalanceCache.end()) {
+        return false;
+    }
+    nBalanceRet = it->second;
+    return true;
+}
+
+void CWallet::SetCachedBalance(const BalanceCacheKey& key, CAmount nBalance) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    mapBalanceCache[key] = nBalance;
+}
+
 CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth, const bool fAddLocked) const
 {
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
+        const BalanceCacheKey key{BalanceType::TRUSTED, filter, min_depth, fAddLocked};
+        if (GetCachedBalance(key, nTotal)) {
+            return nTotal;
+        }
         for (auto pcoin : GetSpendableTXs()) {
             if (pcoin->IsTrusted() && ((pcoin->GetDepthInMainChain() >= min_depth) || (fAddLocked && pcoin->IsLockedByInstantSend()))) {
                 nTotal += pcoin->GetAvailableCredit(true, filter);
             }
         }
+        SetCachedBalance(key, nTotal);
     }
 
     return nTotal;
@@ -2730,10 +3188,20 @@ CAmount CWallet::GetAnonymizedBalance(const CCoinControl* coinControl) const
 
     LOCK2(cs_main, cs_wallet);
 
+    // Only the balance of all coins can be cached, the mixing progress depends on the configured rounds
+    const BalanceCacheKey key{BalanceType::ANONYMIZED, ISMINE_SPENDABLE, CCoinJoinClientOptions::GetRounds(), false};
+    if (coinControl == nullptr && GetCachedBalance(key, nTotal)) {
+        return nTotal;
+    }
+
     for (auto pcoin : GetSpendableTXs()) {
         nTotal += pcoin->GetAnonymizedCredit(coinControl);
     }
 
+    if (coinControl == nullptr) {
+        SetCachedBalance(key, nTotal);
+    }
+
     return nTotal;
 }
 
@@ -2747,11 +3215,13 @@ float CWallet::GetAverageAnonymizedRounds() const
     int nCount = 0;
 
     LOCK2(cs_main, cs_wallet);
-    for (const auto& outpoint : setWalletUTXO) {
-        if(!IsDenominated(outpoint)) continue;
+    for (const auto& p : mapDenominatedUTXOs) {
+        for (const auto& outpoint : p.second) {
+            if (!mapWallet.count(outpoint.hash)) continue;
 
-        nTotal += GetCappedOutpointCoinJoinRounds(outpoint);
-        nCount++;
+            nTotal += GetCappedOutpointCoinJoinRounds(outpoint);
+            nCount++;
+        }
     }
 
     if(nCount == 0) return 0;
@@ -2768,16 +3238,16 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
     CAmount nTotal = 0;
 
     LOCK2(cs_main, cs_wallet);
-    for (const auto& outpoint : setWalletUTXO) {
-        const auto it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
-
-        CAmount nValue = it->second.tx->vout[outpoint.n].nValue;
-        if (!CCoinJoin::IsDenominatedAmount(nValue)) continue;
-        if (it->second.GetDepthInMainChain() < 0) continue;
+    for (const auto& p : mapDenominatedUTXOs) {
+        CAmount nValue = p.first;
+        for (const auto& outpoint : p.second) {
+            const auto it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end()) continue;
+            if (it->second.GetDepthInMainChain() < 0) continue;
 
-        int nRounds = GetCappedOutpointCoinJoinRounds(outpoint);
-        nTotal += nValue * nRounds / CCoinJoinClientOptions::GetRounds();
+            int nRounds = GetCappedOutpointCoinJoinRounds(outpoint);
+            nTotal += nValue * nRounds / CCoinJoinClientOptions::GetRounds();
+        }
     }
 
     return nTotal;
@@ -2791,10 +3261,17 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
 
     LOCK2(cs_main, cs_wallet);
 
+    const BalanceCacheKey key{BalanceType::DENOMINATED, ISMINE_SPENDABLE, 0, unconfirmed};
+    if (GetCachedBalance(key, nTotal)) {
+        return nTotal;
+    }
+
     for (auto pcoin : GetSpendableTXs()) {
         nTotal += pcoin->GetDenominatedCredit(unconfirmed);
     }
 
+    SetCachedBalance(key, nTotal);
+
     return nTotal;
 }
 
@@ -2803,10 +3280,15 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
+        const BalanceCacheKey key{BalanceType::UNCONFIRMED, ISMINE_SPENDABLE, 0, false};
+        if (GetCachedBalance(key, nTotal)) {
+            return nTotal;
+        }
         for (auto pcoin : GetSpendableTXs()) {
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableCredit();
         }
+        SetCachedBalance(key, nTotal);
     }
     return nTotal;
 }
@@ -2816,9 +3298,14 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
+        const BalanceCacheKey key{BalanceType::IMMATURE, ISMINE_SPENDABLE, 0, false};
+        if (GetCachedBalance(key, nTotal)) {
+            return nTotal;
+        }
         for (auto pcoin : GetSpendableTXs()) {
             nTotal += pcoin->GetImmatureCredit();
         }
+        SetCachedBalance(key, nTotal);
     }
     return nTotal;
 }
@@ -2828,10 +3315,15 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
+        const BalanceCacheKey key{BalanceType::UNCONFIRMED, ISMINE_WATCH_ONLY, 0, false};
+        if (GetCachedBalance(key, nTotal)) {
+            return nTotal;
+        }
         for (auto pcoin : GetSpendableTXs()) {
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableCredit(true, ISMINE_WATCH_ONLY);
         }
+        SetCachedBalance(key, nTotal);
     }
     return nTotal;
 }
@@ -2841,9 +3333,14 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
+        const BalanceCacheKey key{BalanceType::IMMATURE, ISMINE_WATCH_ONLY, 0, false};
+        if (GetCachedBalance(key, nTotal)) {
+            return nTotal;
+        }
         for (auto pcoin : GetSpendableTXs()) {
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
+        SetCachedBalance(key, nTotal);
     }
     return nTotal;
 }
@@ -2896,6 +3393,10 @@ CAmount CWallet::GetAvailableBalance(const CCoinControl* coinControl) const
     LOCK2(cs_main, cs_wallet);
 
     CAmount balance = 0;
+    const BalanceCacheKey key{BalanceType::AVAILABLE, ISMINE_SPENDABLE, 0, false};
+    if (coinControl == nullptr && GetCachedBalance(key, balance)) {
+        return balance;
+    }
     std::vector<COutput> vCoins;
     AvailableCoins(vCoins, true, coinControl);
     for (const COutput& out : vCoins) {
@@ -2903,6 +3404,9 @@ CAmount CWallet::GetAvailableBalance(const CCoinControl* coinControl) const
             balance += out.tx->tx->vout[out.i].nValue;
         }
     }
+    if (coinControl == nullptr) {
+        SetCachedBalance(key, balance);
+    }
     return balance;
 }
 
@@ -2916,32 +3420,36 @@ void CWallet::AvailableCoins(std::vector<COutput> &vCoins, bool fOnlySafe, const
 
     CAmount nTotal = 0;
 
-    for (auto pcoin : GetSpendableTXs()) {
+    // Returns true when enough coins were found. pvOutputs limits the outputs to look at, all outputs are checked if
+    // it's null.
+    auto ProcessTx = [&](const CWalletTx* pcoin, const std::vector<unsigned int>* pvOutputs) {
         const uint256& wtxid = pcoin->GetHash();
 
         if (!CheckFinalTx(*pcoin->tx))
-            continue;
+            return false;
 
         if (pcoin->IsImmatureCoinBase())
-            continue;
+            return false;
 
         int nDepth = pcoin->GetDepthInMainChain();
 
         // We should not consider coins which aren't at least in our mempool
         // It's possible for these to be conflicted via ancestors which we may never be able to detect
         if (nDepth == 0 && !pcoin->InMempool())
-            continue;
+            return false;
 
         bool safeTx = pcoin->IsTrusted();
 
         if (fOnlySafe && !safeTx) {
-            continue;
+            return false;
         }
 
         if (nDepth < nMinDepth || nDepth > nMaxDepth)
-            continue;
+            return false;
 
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
+        size_t nOutputs = pvOutputs ? pvOutputs->size() : pcoin->tx->vout.size();
+        for (size_t j = 0; j < nOutputs; j++) {
+            unsigned int i = pvOutputs ? (*pvOutputs)[j] : j;
             bool found = false;
             if (nCoinType == CoinType::ONLY_FULLY_MIXED) {
                 if (!CCoinJoin::IsDenominatedAmount(pcoin->tx->vout[i].nValue)) continue;
@@ -2989,15 +3497,62 @@ void CWallet::AvailableCoins(std::vector<COutput> &vCoins, bool fOnlySafe, const
                 nTotal += pcoin->tx->vout[i].nValue;
 
                 if (nTotal >= nMinimumSumAmount) {
-                    return;
+                    return true;
                 }
             }
 
             // Checks the maximum number of UTXO's.
             if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (coinControl && coinControl->m_start_after) {
+        // setWalletUTXO is sorted by COutPoint, so the page starts right after the last outpoint of the previous one and
+        // ProcessTx stops as soon as nMaximumCount outputs were found
+        const COutPoint& startAfter = *coinControl->m_start_after;
+        auto it = startAfter.IsNull() ? setWalletUTXO.begin() : setWalletUTXO.upper_bound(startAfter);
+        std::vector<unsigned int> vOutputs;
+        while (it != setWalletUTXO.end()) {
+            const uint256 hash = it->hash;
+            vOutputs.clear();
+            for (; it != setWalletUTXO.end() && it->hash == hash; ++it) {
+                vOutputs.emplace_back(it->n);
+            }
+            auto jt = mapWallet.find(hash);
+            if (jt != mapWallet.end() && ProcessTx(&jt->second, &vOutputs)) {
+                return;
+            }
+        }
+        return;
+    }
+
+    if (nCoinType == CoinType::ONLY_FULLY_MIXED || nCoinType == CoinType::ONLY_READY_TO_MIX) {
+        // Only denominated outputs can match, look them up in the index instead of checking all spendable txs
+        std::map<uint256, std::vector<unsigned int>> mapCandidates;
+        for (const auto& p : mapDenominatedUTXOs) {
+            if (p.first < nMinimumAmount || p.first > nMaximumAmount) {
+                continue;
+            }
+            for (const auto& outpoint : p.second) {
+                mapCandidates[outpoint.hash].emplace_back(outpoint.n);
+            }
+        }
+        for (const auto& p : mapCandidates) {
+            auto it = mapWallet.find(p.first);
+            if (it != mapWallet.end() && ProcessTx(&it->second, &p.second)) {
                 return;
             }
         }
+        return;
+    }
+
+    for (auto pcoin : GetSpendableTXs()) {
+        if (ProcessTx(pcoin, nullptr)) {
+            return;
+        }
     }
 }
 
@@ -3132,6 +3687,10 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibil
             utxo_pool.push_back(group);
         }
         bnb_used = false;
+        // Fully mixed coins only come in a few denominations, count them instead of searching through all of them
+        if (nCoinType == CoinType::ONLY_FULLY_MIXED && SelectCoinsDenominated(nTargetValue, utxo_pool, setCoinsRet, nValueRet, maxTxFee)) {
+            return true;
+        }
         return KnapsackSolver(nTargetValue, utxo_pool, setCoinsRet, nValueRet, nCoinType == CoinType::ONLY_FULLY_MIXED, maxTxFee);
     }
 }
@@ -3315,7 +3874,8 @@ bool CWallet::SelectTxDSInsByDenomination(int nDenom, CAmount nValueMax, std::ve
 
     CCoinControl coin_control;
     coin_control.nCoinType = CoinType::ONLY_READY_TO_MIX;
-    AvailableCoins(vCoins, true, &coin_control);
+    // only look at the outputs of this denomination
+    AvailableCoins(vCoins, true, &coin_control, nDenomAmount, nDenomAmount);
     LogPrint(BCLog::COINJOIN, "CWallet::%s -- vCoins.size(): %d\n", __func__, vCoins.size());
 
     Shuffle(vCoins.rbegin(), vCoins.rend(), FastRandomContext());
@@ -3343,77 +3903,169 @@ bool CWallet::SelectTxDSInsByDenomination(int nDenom, CAmount nValueMax, std::ve
     return nValueTotal > 0;
 }
 
-bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTallyRet, bool fSkipDenominated, bool fAnonymizable, bool fSkipUnconfirmed, int nMaxOupointsPerAddress) const
+void CWallet::TallyWalletTx(const CWalletTx& wtx, std::map<CTxDestination, CompactTallyItem>& mapTally, bool fSkipDenominated, bool fAnonymizable, bool fSkipUnconfirmed, int nMaxOupointsPerAddress, std::set<CTxDestination>* psetDestinations) const
 {
-    LOCK2(cs_main, cs_wallet);
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
     isminefilter filter = ISMINE_SPENDABLE;
+    CAmount nSmallestDenom = CCoinJoin::GetSmallestDenomination();
+    const uint256& hash = wtx.GetHash();
 
-    // Try using the cache for already confirmed mixable inputs.
-    // This should only be used if nMaxOupointsPerAddress was NOT specified.
-    if(nMaxOupointsPerAddress == -1 && fAnonymizable && fSkipUnconfirmed) {
-        if(fSkipDenominated && fAnonymizableTallyCachedNonDenom) {
-            vecTallyRet = vecAnonymizableTallyCachedNonDenom;
-            LogPrint(BCLog::SELECTCOINS, "SelectCoinsGroupedByAddresses - using cache for non-denom inputs %d\n", vecTallyRet.size());
-            return vecTallyRet.size() > 0;
-        }
-        if(!fSkipDenominated && fAnonymizableTallyCached) {
-            vecTallyRet = vecAnonymizableTallyCached;
-            LogPrint(BCLog::SELECTCOINS, "SelectCoinsGroupedByAddresses - using cache for all inputs %d\n", vecTallyRet.size());
-            return vecTallyRet.size() > 0;
-        }
-    }
+    if(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) return;
+    if(fSkipUnconfirmed && !wtx.IsTrusted()) return;
+    if (wtx.GetDepthInMainChain() < 0) return;
 
-    CAmount nSmallestDenom = CCoinJoin::GetSmallestDenomination();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        CTxDestination txdest;
+        if (!ExtractDestination(wtx.tx->vout[i].scriptPubKey, txdest)) continue;
 
-    // Tally
-    std::map<CTxDestination, CompactTallyItem> mapTally;
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
+        isminefilter mine = ::IsMine(*this, txdest);
+        if(!(mine & filter)) continue;
 
-        if (!setWalletTxesCounted.emplace(outpoint.hash).second) continue;
+        auto itTallyItem = mapTally.find(txdest);
+        if (nMaxOupointsPerAddress != -1 && itTallyItem != mapTally.end() && itTallyItem->second.vecInputCoins.size() >= nMaxOupointsPerAddress) continue;
 
-        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
+        if(IsSpent(hash, i) || IsLockedCoin(hash, i)) continue;
 
-        const CWalletTx& wtx = (*it).second;
+        if(fSkipDenominated && CCoinJoin::IsDenominatedAmount(wtx.tx->vout[i].nValue)) continue;
 
-        if(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) continue;
-        if(fSkipUnconfirmed && !wtx.IsTrusted()) continue;
-        if (wtx.GetDepthInMainChain() < 0) continue;
+        if(fAnonymizable) {
+            // ignore collaterals
+            if(CCoinJoin::IsCollateralAmount(wtx.tx->vout[i].nValue)) continue;
+            if(fMasternodeMode && wtx.tx->vout[i].nValue == 1000*COIN) continue;
+            // ignore outputs that are 10 times smaller then the smallest denomination
+            // otherwise they will just lead to higher fee / lower priority
+            if(wtx.tx->vout[i].nValue <= nSmallestDenom/10) continue;
+            // ignore mixed
+            if (IsFullyMixed(COutPoint(hash, i))) continue;
+        }
 
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
-            CTxDestination txdest;
-            if (!ExtractDestination(wtx.tx->vout[i].scriptPubKey, txdest)) continue;
+        if (itTallyItem == mapTally.end()) {
+            itTallyItem = mapTally.emplace(txdest, CompactTallyItem()).first;
+            itTallyItem->second.txdest = txdest;
+        }
+        itTallyItem->second.nAmount += wtx.tx->vout[i].nValue;
+        itTallyItem->second.vecInputCoins.emplace_back(wtx.tx, i);
+        if (psetDestinations) {
+            psetDestinations->emplace(txdest);
+        }
+    }
+}
 
-            isminefilter mine = ::IsMine(*this, txdest);
-            if(!(mine & filter)) continue;
+void CWallet::AddToAnonymizableTally(AnonymizableTally& tally, const CWalletTx& wtx, bool fSkipDenominated) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-            auto itTallyItem = mapTally.find(txdest);
-            if (nMaxOupointsPerAddress != -1 && itTallyItem != mapTally.end() && itTallyItem->second.vecInputCoins.size() >= nMaxOupointsPerAddress) continue;
+    if (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) {
+        tally.setImmatureTxs.emplace(wtx.GetHash());
+        return;
+    }
 
-            if(IsSpent(outpoint.hash, i) || IsLockedCoin(outpoint.hash, i)) continue;
+    std::set<CTxDestination> setDestinations;
+    TallyWalletTx(wtx, tally.mapTally, fSkipDenominated, true, true, -1, &setDestinations);
+    if (!setDestinations.empty()) {
+        tally.mapTxDestinations.emplace(wtx.GetHash(), std::move(setDestinations));
+    }
+}
 
-            if(fSkipDenominated && CCoinJoin::IsDenominatedAmount(wtx.tx->vout[i].nValue)) continue;
+void CWallet::UpdateAnonymizableTally(AnonymizableTally& tally, bool fSkipDenominated) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-            if(fAnonymizable) {
-                // ignore collaterals
-                if(CCoinJoin::IsCollateralAmount(wtx.tx->vout[i].nValue)) continue;
-                if(fMasternodeMode && wtx.tx->vout[i].nValue == 1000*COIN) continue;
-                // ignore outputs that are 10 times smaller then the smallest denomination
-                // otherwise they will just lead to higher fee / lower priority
-                if(wtx.tx->vout[i].nValue <= nSmallestDenom/10) continue;
-                // ignore mixed
-                if (IsFullyMixed(COutPoint(outpoint.hash, i))) continue;
+    const int nRounds = CCoinJoinClientOptions::GetRounds();
+    if (!tally.fValid || tally.nRounds != nRounds) {
+        tally = AnonymizableTally();
+        for (auto it = setWalletUTXO.begin(); it != setWalletUTXO.end(); ) {
+            const uint256 hash = it->hash;
+            const auto jt = mapWallet.find(hash);
+            if (jt != mapWallet.end()) {
+                AddToAnonymizableTally(tally, jt->second, fSkipDenominated);
+            }
+            // setWalletUTXO is sorted by COutPoint, skip the other UTXOs of this tx
+            while (it != setWalletUTXO.end() && it->hash == hash) {
+                ++it;
             }
+        }
+        tally.nRounds = nRounds;
+        tally.fValid = true;
+        LogPrint(BCLog::SELECTCOINS, "UpdateAnonymizableTally - rebuilt %s tally, %d addresses\n", fSkipDenominated ? "non-denom" : "full", tally.mapTally.size());
+        return;
+    }
 
-            if (itTallyItem == mapTally.end()) {
-                itTallyItem = mapTally.emplace(txdest, CompactTallyItem()).first;
-                itTallyItem->second.txdest = txdest;
+    if (tally.setDirtyTxs.empty()) {
+        return;
+    }
+
+    for (const auto& hash : tally.setDirtyTxs) {
+        // Drop whatever this tx contributed before
+        auto itDests = tally.mapTxDestinations.find(hash);
+        if (itDests != tally.mapTxDestinations.end()) {
+            for (const auto& txdest : itDests->second) {
+                auto itTallyItem = tally.mapTally.find(txdest);
+                if (itTallyItem == tally.mapTally.end()) continue;
+                auto& vecInputCoins = itTallyItem->second.vecInputCoins;
+                for (auto it = vecInputCoins.begin(); it != vecInputCoins.end(); ) {
+                    if (it->outpoint.hash == hash) {
+                        itTallyItem->second.nAmount -= it->txout.nValue;
+                        it = vecInputCoins.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                if (vecInputCoins.empty()) {
+                    tally.mapTally.erase(itTallyItem);
+                }
             }
-            itTallyItem->second.nAmount += wtx.tx->vout[i].nValue;
-            itTallyItem->second.vecInputCoins.emplace_back(wtx.tx, i);
+            tally.mapTxDestinations.erase(itDests);
+        }
+        tally.setImmatureTxs.erase(hash);
+
+        // and add it again if it still has unspent outputs
+        const auto itUTXO = setWalletUTXO.lower_bound(COutPoint(hash, 0));
+        if (itUTXO == setWalletUTXO.end() || itUTXO->hash != hash) continue;
+        const auto it = mapWallet.find(hash);
+        if (it == mapWallet.end()) continue;
+        AddToAnonymizableTally(tally, it->second, fSkipDenominated);
+    }
+
+    LogPrint(BCLog::SELECTCOINS, "UpdateAnonymizableTally - updated %d txs in %s tally\n", tally.setDirtyTxs.size(), fSkipDenominated ? "non-denom" : "full");
+    tally.setDirtyTxs.clear();
+}
+
+bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTallyRet, bool fSkipDenominated, bool fAnonymizable, bool fSkipUnconfirmed, int nMaxOupointsPerAddress) const
+{
+    LOCK2(cs_main, cs_wallet);
+
+    CAmount nSmallestDenom = CCoinJoin::GetSmallestDenomination();
+
+    // Use the incrementally maintained tally for already confirmed mixable inputs.
+    // This should only be used if nMaxOupointsPerAddress was NOT specified.
+    if(nMaxOupointsPerAddress == -1 && fAnonymizable && fSkipUnconfirmed) {
+        AnonymizableTally& tally = fSkipDenominated ? anonymizableTallyNonDenom : anonymizableTally;
+        UpdateAnonymizableTally(tally, fSkipDenominated);
+        vecTallyRet.clear();
+        for (const auto& item : tally.mapTally) {
+            if(item.second.nAmount < nSmallestDenom) continue;
+            vecTallyRet.push_back(item.second);
         }
+        LogPrint(BCLog::SELECTCOINS, "SelectCoinsGroupedByAddresses - using cache for %s inputs %d\n", fSkipDenominated ? "non-denom" : "all", vecTallyRet.size());
+        return vecTallyRet.size() > 0;
+    }
+
+    // Tally
+    std::map<CTxDestination, CompactTallyItem> mapTally;
+    std::set<uint256> setWalletTxesCounted;
+    for (const auto& outpoint : setWalletUTXO) {
+
+        if (!setWalletTxesCounted.emplace(outpoint.hash).second) continue;
+
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+        if (it == mapWallet.end()) continue;
+
+        TallyWalletTx((*it).second, mapTally, fSkipDenominated, fAnonymizable, fSkipUnconfirmed, nMaxOupointsPerAddress, nullptr);
     }
 
     // construct resulting vector
@@ -3424,18 +4076,6 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
         vecTallyRet.push_back(item.second);
     }
 
-    // Cache already confirmed mixable entries for later use.
-    // This should only be used if nMaxOupointsPerAddress was NOT specified.
-    if(nMaxOupointsPerAddress == -1 && fAnonymizable && fSkipUnconfirmed) {
-        if(fSkipDenominated) {
-            vecAnonymizableTallyCachedNonDenom = vecTallyRet;
-            fAnonymizableTallyCachedNonDenom = true;
-        } else {
-            vecAnonymizableTallyCached = vecTallyRet;
-            fAnonymizableTallyCached = true;
-        }
-    }
-
     // debug
     if (LogAcceptCategory(BCLog::SELECTCOINS)) {
         std::string strMessage = "SelectCoinsGroupedByAddresses - vecTallyRet:\n";
@@ -3478,6 +4118,21 @@ int CWallet::CountInputsWithAmount(CAmount nInputAmount) const
 
     LOCK2(cs_main, cs_wallet);
 
+    if (CCoinJoin::IsDenominatedAmount(nInputAmount)) {
+        const auto jt = mapDenominatedUTXOs.find(nInputAmount);
+        if (jt == mapDenominatedUTXOs.end()) {
+            return 0;
+        }
+        for (const auto& outpoint : jt->second) {
+            const auto it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end()) continue;
+            if (it->second.GetDepthInMainChain() < 0) continue;
+
+            nTotal++;
+        }
+        return nTotal;
+    }
+
     for (const auto& outpoint : setWalletUTXO) {
         const auto it = mapWallet.find(outpoint.hash);
         if (it == mapWallet.end()) continue;
@@ -3896,13 +4551,15 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CTransac
 
         if (sign)
         {
+            // Signing only updates the input scripts, which are not part of the shared signature hash data
+            const PrecomputedTransactionData txdata(txNew);
             int nIn = 0;
             for(const auto& coin : vecCoins)
             {
                 const CScript& scriptPubKey = coin.txout.scriptPubKey;
                 SignatureData sigdata;
 
-                if (!ProduceSignature(*this, MutableTransactionSignatureCreator(&txNew, nIn, coin.txout.nValue, SIGHASH_ALL), scriptPubKey, sigdata))
+                if (!ProduceSignature(*this, MutableTransactionSignatureCreator(&txNew, nIn, coin.txout.nValue, SIGHASH_ALL, &txdata), scriptPubKey, sigdata))
                 {
                     strFailReason = _("Signing transaction failed");
                     return false;
@@ -4057,7 +4714,7 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     for (auto& pair : mapWallet) {
         for(unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
             if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
-                setWalletUTXO.insert(COutPoint(pair.first, i));
+                AddWalletUTXO(COutPoint(pair.first, i), pair.second.tx->vout[i].nValue);
             }
         }
     }
@@ -4295,40 +4952,65 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         } else {
             nTargetSize *= 2;
         }
-        bool fInternal = false;
+        if (missingInternal + missingExternal == 0) {
+            return true;
+        }
+
+        // With HD wallets all keys, their metadata and the updated HD chain are written in a single DB transaction and
+        // are only added to the wallet's memory after it was committed
         WalletBatch batch(*database);
-        for (int64_t i = missingInternal + missingExternal; i--;)
-        {
-            if (i < missingInternal) {
-                fInternal = true;
-            }
+        if (IsHDEnabled() && !batch.TxnBegin()) {
+            throw std::runtime_error(std::string(__func__) + ": TxnBegin failed");
+        }
 
-            assert(m_max_keypool_index < std::numeric_limits<int64_t>::max()); // How in the hell did you use so many keys?
-            int64_t index = ++m_max_keypool_index;
+        std::vector<std::pair<int64_t, CKeyPool>> vecPoolEntries;
+        int64_t nIndex = m_max_keypool_index;
+        auto addToPool = [&](const CPubKey& pubkey, bool fInternal) {
+            assert(nIndex < std::numeric_limits<int64_t>::max()); // How in the hell did you use so many keys?
+            nIndex++;
 
-            // TODO: implement keypools for all accounts?
-            CPubKey pubkey(GenerateNewKey(batch, 0, fInternal));
-            if (!batch.WritePool(index, CKeyPool(pubkey, fInternal))) {
+            CKeyPool keypool(pubkey, fInternal);
+            if (!batch.WritePool(nIndex, keypool)) {
                 throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
             }
+            vecPoolEntries.emplace_back(nIndex, keypool);
 
-            if (fInternal) {
-                setInternalKeyPool.insert(index);
-            } else {
-                setExternalKeyPool.insert(index);
-            }
+            double dProgress = 100.f * nIndex / (nTargetSize + 1);
+            std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
+            uiInterface.InitMessage(strMsg);
+        };
 
-            m_pool_key_to_index[pubkey.GetID()] = index;
-            if (missingInternal + missingExternal > 0) {
-                WalletLogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n",
-                          missingInternal + missingExternal, missingInternal,
-                          setInternalKeyPool.size() + setExternalKeyPool.size(), setInternalKeyPool.size());
+        if (IsHDEnabled()) {
+            // TODO: implement keypools for all accounts?
+            CKeyMetadata metadata(GetTime());
+            CHDChain hdChain;
+            if (!GetHDChain(hdChain)) {
+                throw std::runtime_error(std::string(__func__) + ": GetHDChain failed");
+            }
+            std::vector<CHDPubKey> vecHDPubKeys;
+            for (bool fInternal : {false, true}) {
+                for (const auto& hdPubKey : DeriveNewChildKeys(batch, hdChain, metadata, 0, fInternal, fInternal ? missingInternal : missingExternal)) {
+                    addToPool(hdPubKey.extPubKey.pubkey, fInternal);
+                    vecHDPubKeys.emplace_back(hdPubKey);
+                }
+            }
+            if (!batch.TxnCommit()) {
+                throw std::runtime_error(std::string(__func__) + ": TxnCommit failed");
             }
+            LoadNewChildKeys(hdChain, vecHDPubKeys, metadata);
+        } else {
+            for (int64_t i = missingExternal; i--;) {
+                addToPool(GenerateNewKey(batch, 0, false), false);
+            }
+        }
 
-            double dProgress = 100.f * index / (nTargetSize + 1);
-            std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
-            uiInterface.InitMessage(strMsg);
+        for (const auto& p : vecPoolEntries) {
+            LoadKeyPool(p.first, p.second);
         }
+
+        WalletLogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n",
+                  missingInternal + missingExternal, missingInternal,
+                  setInternalKeyPool.size() + setExternalKeyPool.size(), setInternalKeyPool.size());
     }
     return true;
 }
@@ -4682,9 +5364,6 @@ void CWallet::LockCoin(const COutPoint& output)
     setLockedCoins.insert(output);
     std::map<uint256, CWalletTx>::iterator it = mapWallet.find(output.hash);
     if (it != mapWallet.end()) it->second.MarkDirty(); // recalculate all credits for this tx
-
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
 }
 
 void CWallet::UnlockCoin(const COutPoint& output)
@@ -4693,15 +5372,16 @@ void CWallet::UnlockCoin(const COutPoint& output)
     setLockedCoins.erase(output);
     std::map<uint256, CWalletTx>::iterator it = mapWallet.find(output.hash);
     if (it != mapWallet.end()) it->second.MarkDirty(); // recalculate all credits for this tx
-
-    fAnonymizableTallyCached = false;
-    fAnonymizableTallyCachedNonDenom = false;
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
+    for (const auto& outpoint : setLockedCoins) {
+        MarkAnonymizableTallyDirty(outpoint.hash);
+    }
     setLockedCoins.clear();
+    MarkBalancesDirty();
 }
 
 bool CWallet::IsLockedCoin(uint256 hash, unsigned int n) const
@@ -5454,28 +6134,51 @@ bool CWallet::AutoBackupWallet(const fs::path& wallet_path, std::string& strBack
     return true;
 }
 
-void CWallet::NotifyTransactionLock(const CTransactionRef &tx, const std::shared_ptr<const llmq::CInstantSendLock>& islock)
+void CWallet::NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks)
 {
     LOCK(cs_wallet);
-    // Only notify UI if this transaction is in this wallet
-    uint256 txHash = tx->GetHash();
-    std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(txHash);
-    if (mi != mapWallet.end()){
+    // Update the wallet state for all locked txs of this wallet first, then notify once per event
+    std::vector<uint256> vecLockedTxs;
+    for (const auto& p : locks) {
+        uint256 txHash = p.first->GetHash();
+        if (mapWallet.count(txHash)) {
+            MarkAnonymizableTallyDirty(txHash);
+            vecLockedTxs.emplace_back(txHash);
+        }
+    }
+    if (vecLockedTxs.empty()) {
+        return;
+    }
+    // the txs are trusted now, which changes the balances they're counted in
+    MarkBalancesDirty();
+
+    // the status of each tx changed, but balances and lock counts only need to be refreshed once
+    for (const auto& txHash : vecLockedTxs) {
         NotifyTransactionChanged(this, txHash, CT_UPDATED);
-        NotifyISLockReceived();
-        // notify an external script
-        std::string strCmd = gArgs.GetArg("-instantsendnotify", "");
-        if (!strCmd.empty()) {
-            boost::replace_all(strCmd, "%s", txHash.GetHex());
-            std::thread t(runCommand, strCmd);
-            t.detach(); // thread runs free
+    }
+    NotifyISLockReceived();
+
+    // notify an external script, run the commands of one event from a single thread
+    const std::string strNotifyCmd = gArgs.GetArg("-instantsendnotify", "");
+    if (!strNotifyCmd.empty()) {
+        std::vector<std::string> vecCmds;
+        for (const auto& txHash : vecLockedTxs) {
+            vecCmds.emplace_back(strNotifyCmd);
+            boost::replace_all(vecCmds.back(), "%s", txHash.GetHex());
         }
+        std::thread t([vecCmds] {
+            for (const auto& strCmd : vecCmds) {
+                runCommand(strCmd);
+            }
+        });
+        t.detach(); // thread runs free
     }
 }
 
-void CWallet::NotifyChainLock(const CBlockIndex* pindexChainLock, const std::shared_ptr<const llmq::CChainLockSig>& clsig)
+void CWallet::NotifyChainLocks(const std::vector<ChainLockEvent>& clsigs)
 {
-    NotifyChainLockReceived(pindexChainLock->nHeight);
+    // Only the most recent ChainLock is interesting for the UI
+    NotifyChainLockReceived(clsigs.back().first->nHeight);
 }
 
 bool CWallet::LoadGovernanceObject(const CGovernanceObject& obj)
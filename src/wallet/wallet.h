@@ -35,6 +35,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -69,6 +70,15 @@ static const bool DEFAULT_DISABLE_WALLET = false;
 //! if set, all keys will be derived by using BIP39/BIP44
 static const bool DEFAULT_USE_HD_WALLET = false;
 
+//! Number of threads reading blocks and matching them against the wallet's keys during a rescan
+static const int RESCAN_PREFETCH_THREADS = 4;
+//! Maximum number of blocks read ahead of the block a rescan is currently processing
+static const size_t RESCAN_PREFETCH_BLOCKS = 32;
+//! Maximum number of threads deriving HD keys when topping up the keypool
+static const int KEYPOOL_DERIVE_THREADS = 8;
+//! Minimum number of HD keys to derive at once before the derivation is split across threads
+static const size_t KEYPOOL_DERIVE_PARALLEL_MIN = 256;
+
 class CBlockIndex;
 class CCoinControl;
 class CKey;
@@ -452,21 +462,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -719,6 +715,8 @@ private:
 
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion = FEATURE_BASE;
+    //! the wallet version all encrypted keys were checked for, the check is repeated after upgrades
+    int nDecryptionCheckVersion GUARDED_BY(cs_wallet) = 0;
 
     //! the maximum wallet format version: memory-only variable that specifies to what version this wallet may be upgraded
     int nWalletMaxVersion = FEATURE_BASE;
@@ -727,10 +725,52 @@ private:
     int64_t nLastResend = 0;
     bool fBroadcastTransactions = false;
 
-    mutable bool fAnonymizableTallyCached = false;
-    mutable std::vector<CompactTallyItem> vecAnonymizableTallyCached;
-    mutable bool fAnonymizableTallyCachedNonDenom = false;
-    mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
+    /**
+     * The anonymizable outputs of the wallet grouped by address, as returned by SelectCoinsGroupedByAddresses for
+     * CoinJoin. Instead of rebuilding it after every wallet change, only the txs which were marked dirty since the
+     * last use are removed from and added to it again.
+     */
+    struct AnonymizableTally
+    {
+        bool fValid{false};
+        // The CoinJoin rounds setting the tally was built for, the outputs considered to be fully mixed depend on it
+        int nRounds{0};
+        std::map<CTxDestination, CompactTallyItem> mapTally;
+        // The addresses which outputs of a tx were added to, so that they can be removed again
+        std::map<uint256, std::set<CTxDestination>> mapTxDestinations;
+        // Immature coinbase txs which need to be checked again when a new block is connected
+        std::set<uint256> setImmatureTxs;
+        std::set<uint256> setDirtyTxs;
+    };
+    mutable AnonymizableTally anonymizableTally;
+    mutable AnonymizableTally anonymizableTallyNonDenom;
+
+    void UpdateAnonymizableTally(AnonymizableTally& tally, bool fSkipDenominated) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    void AddToAnonymizableTally(AnonymizableTally& tally, const CWalletTx& wtx, bool fSkipDenominated) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    // Adds the outputs of wtx matching the SelectCoinsGroupedByAddresses criteria to mapTally, the addresses which
+    // received coins are added to psetDestinations if it's not null
+    void TallyWalletTx(const CWalletTx& wtx, std::map<CTxDestination, CompactTallyItem>& mapTally, bool fSkipDenominated, bool fAnonymizable, bool fSkipUnconfirmed, int nMaxOupointsPerAddress, std::set<CTxDestination>* psetDestinations) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+
+    enum class BalanceType {
+        TRUSTED,
+        UNCONFIRMED,
+        IMMATURE,
+        ANONYMIZED,
+        DENOMINATED,
+        AVAILABLE,
+    };
+    // Balance kind, ismine filter and the integer/boolean argument the balance was calculated with
+    typedef std::tuple<BalanceType, isminefilter, int, bool> BalanceCacheKey;
+    /**
+     * Wallet balances which were calculated already. Entries are dropped whenever a wallet tx, its spentness, its
+     * mempool or InstantSend state or a coin lock changes, and all of them are bound to the chain tip they were
+     * calculated at, so that depth and maturity don't need to be tracked per tx.
+     */
+    mutable std::map<BalanceCacheKey, CAmount> mapBalanceCache;
+    mutable uint256 hashBalanceCacheTip;
+
+    bool GetCachedBalance(const BalanceCacheKey& key, CAmount& nBalanceRet) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    void SetCachedBalance(const BalanceCacheKey& key, CAmount nBalance) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
 
     /**
      * Used to keep track of spent outpoints, and
@@ -743,7 +783,18 @@ private:
     void AddToSpends(const uint256& wtxid);
 
     std::set<COutPoint> setWalletUTXO;
+    // The denominated entries of setWalletUTXO grouped by amount, so that CoinJoin doesn't need to walk all UTXOs
+    std::map<CAmount, std::set<COutPoint>> mapDenominatedUTXOs;
     mutable std::map<COutPoint, int> mapOutpointRoundsCache;
+    // Entries of mapOutpointRoundsCache which were calculated but not handed to the DB journal yet
+    mutable std::set<COutPoint> setOutpointRoundsToPersist;
+
+    bool AddWalletUTXO(const COutPoint& outpoint, CAmount nValue);
+    void RemoveWalletUTXO(const COutPoint& outpoint);
+
+    // Forgets the (possibly persisted) CoinJoin rounds of the outputs of this tx and of all outputs which were
+    // calculated from them, called when the tx becomes known to the wallet
+    void InvalidateCoinJoinRounds(const uint256& hash, WalletBatch& batch);
 
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
@@ -774,6 +825,11 @@ private:
 
     /* HD derive new child key (on internal or external chain) */
     void DeriveNewChildKey(WalletBatch &batch, const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /* HD derive nCount new child keys at once, the account and chain keys are derived only once and the child keys
+     * are derived from the public chain key in parallel. The keys and the advanced chain counter of hdChain are only
+     * written to batch, LoadNewChildKeys adds them to the wallet once the batch was committed. */
+    std::vector<CHDPubKey> DeriveNewChildKeys(WalletBatch &batch, CHDChain& hdChain, const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, size_t nCount) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void LoadNewChildKeys(const CHDChain& hdChain, const std::vector<CHDPubKey>& vecHDPubKeys, const CKeyMetadata& metadata) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     std::set<int64_t> setInternalKeyPool;
     std::set<int64_t> setExternalKeyPool;
@@ -799,6 +855,8 @@ private:
 
     /** Internal database handle. */
     std::unique_ptr<WalletDatabase> database;
+    /** Write-behind journal for recalculable records, must be declared after database */
+    WalletDBJournal m_db_journal{*database};
 
     // Used to NotifyTransactionChanged of the previous block's coinbase when
     // the next block comes in
@@ -840,6 +898,11 @@ public:
     /** Get database handle used by this wallet. Ideally this function would
      * not be necessary.
      */
+    WalletDBJournal& GetDBJournal()
+    {
+        return m_db_journal;
+    }
+
     WalletDatabase& GetDBHandle()
     {
         return *database;
@@ -941,7 +1004,9 @@ public:
     int  CountInputsWithAmount(CAmount nInputAmount) const;
 
     // get the CoinJoin chain depth for a given input
-    int GetRealOutpointCoinJoinRounds(const COutPoint& outpoint, int nRounds = 0) const;
+    int GetRealOutpointCoinJoinRounds(const COutPoint& outpoint) const;
+    // hand the rounds calculated by GetRealOutpointCoinJoinRounds to the DB journal
+    void PersistCoinJoinRounds();
     // respect current settings
     int GetCappedOutpointCoinJoinRounds(const COutPoint& outpoint) const;
 
@@ -1017,6 +1082,7 @@ public:
     bool AddWatchOnly(const CScript& dest, int64_t nCreateTime) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     bool RemoveWatchOnly(const CScript &dest) override EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    bool RemoveWatchOnly(WalletBatch &batch, const CScript &dest) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     //! Adds a watch-only address to the store, without saving it to disk (used by LoadWallet)
     bool LoadWatchOnly(const CScript &dest);
 
@@ -1040,9 +1106,15 @@ public:
     bool GetLabelDestination(CTxDestination &dest, const std::string& label, bool bForceNew = false);
 
     void MarkDirty();
+    //! Forget all cached balances, called when anything they depend on changes
+    void MarkBalancesDirty() const { mapBalanceCache.clear(); }
+    //! Recalculate the anonymizable tally entries of this tx the next time they are used
+    void MarkAnonymizableTallyDirty(const uint256& hash) const;
+    //! Rebuild the anonymizable tally from scratch the next time it's used
+    void ResetAnonymizableTally() const;
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
     void LoadToWallet(const CWalletTx& wtxIn);
-    void TransactionAddedToMempool(const CTransactionRef& tx, int64_t nAcceptTime) override;
+    void TransactionsAddedToMempool(const std::vector<MempoolAddedTx>& txs) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) override;
     int64_t RescanFromTime(int64_t startTime, const WalletRescanReserver& reserver, bool update);
@@ -1224,7 +1296,7 @@ public:
     /** Watch-only address added */
     boost::signals2::signal<void (bool fHaveWatchOnly)> NotifyWatchonlyChanged;
 
-    /** IS-lock received */
+    /** IS-locks received for txs of this wallet, signaled once per batch of locks */
     boost::signals2::signal<void ()> NotifyISLockReceived;
 
     /** ChainLock received */
@@ -1280,8 +1352,14 @@ public:
 
     bool GetDecryptedHDChain(CHDChain& hdChainRet);
 
-    void NotifyTransactionLock(const CTransactionRef &tx, const std::shared_ptr<const llmq::CInstantSendLock>& islock) override;
-    void NotifyChainLock(const CBlockIndex* pindexChainLock, const std::shared_ptr<const llmq::CChainLockSig>& clsig) override;
+    void NotifyTransactionLocks(const std::vector<TransactionLockEvent>& locks) override;
+    void NotifyChainLocks(const std::vector<ChainLockEvent>& clsigs) override;
+
+    /** Load the wallet version for which all encrypted keys were checked to decrypt correctly. */
+    void LoadDecryptionCheck(int nVersion) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet) { AssertLockHeld(cs_wallet); nDecryptionCheckVersion = nVersion; }
+
+    /** Load the persisted CoinJoin rounds of an outpoint into mapOutpointRoundsCache. */
+    void LoadCoinJoinRounds(const COutPoint& outpoint, int nRoundsMax, int nRounds);
 
     /** Load a CGovernanceObject into m_gobjects. */
     bool LoadGovernanceObject(const CGovernanceObject& obj);
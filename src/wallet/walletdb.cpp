@@ -13,6 +13,7 @@
 #include <governance/governance-object.h>
 #include <protocol.h>
 #include <serialize.h>
+#include <statsd_client.h>
 #include <sync.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -188,6 +189,21 @@ bool WalletBatch::WriteCoinJoinSalt(const uint256& salt)
     return WriteIC(std::string("cj_salt"), salt);
 }
 
+bool WalletBatch::WriteDecryptionCheck(int nVersion)
+{
+    return WriteIC(std::string("cryptcheck"), nVersion);
+}
+
+bool WalletBatch::WriteCoinJoinRounds(const COutPoint& outpoint, int nRoundsMax, int nRounds)
+{
+    return WriteIC(std::make_pair(std::string("cj_rounds"), outpoint), std::make_pair(nRoundsMax, nRounds));
+}
+
+bool WalletBatch::EraseCoinJoinRounds(const COutPoint& outpoint)
+{
+    return EraseIC(std::make_pair(std::string("cj_rounds"), outpoint));
+}
+
 bool WalletBatch::WriteGovernanceObject(const CGovernanceObject& obj)
 {
     return WriteIC(std::make_pair(std::string("gobject"), obj.GetHash()), obj, false);
@@ -573,6 +589,16 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 strErr = "Invalid governance object: LoadGovernanceObject";
                 return false;
             }
+        } else if (strType == "cj_rounds") {
+            COutPoint outpoint;
+            std::pair<int, int> rounds;
+            ssKey >> outpoint;
+            ssValue >> rounds;
+            pwallet->LoadCoinJoinRounds(outpoint, rounds.first, rounds.second);
+        } else if (strType == "cryptcheck") {
+            int nVersion;
+            ssValue >> nVersion;
+            pwallet->LoadDecryptionCheck(nVersion);
         } else if (strType == "flags") {
             uint64_t flags;
             ssValue >> flags;
@@ -818,13 +844,103 @@ DBErrors WalletBatch::ZapWalletTx(std::vector<CWalletTx>& vWtx)
     return DBErrors::LOAD_OK;
 }
 
+template <typename K>
+std::vector<unsigned char> WalletDBJournal::SerializeKey(const K& key)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << key;
+    return std::vector<unsigned char>(ssKey.begin(), ssKey.end());
+}
+
+template <typename K>
+void WalletDBJournal::AddPending(const K& key, PendingRecord&& record)
+{
+    auto vchKey = SerializeKey(key);
+    LOCK(cs_pending);
+    mapPending[std::move(vchKey)] = std::move(record);
+}
+
+void WalletDBJournal::WriteCoinJoinRounds(const COutPoint& outpoint, int nRoundsMax, int nRounds)
+{
+    AddPending(std::make_pair(std::string("cj_rounds"), outpoint), [=](WalletBatch& batch) {
+        return batch.WriteCoinJoinRounds(outpoint, nRoundsMax, nRounds);
+    });
+}
+
+void WalletDBJournal::DiscardCoinJoinRounds(const COutPoint& outpoint)
+{
+    auto vchKey = SerializeKey(std::make_pair(std::string("cj_rounds"), outpoint));
+    // a running flush might still commit the old value
+    LOCK(cs_flush);
+    LOCK(cs_pending);
+    mapPending.erase(vchKey);
+}
+
+size_t WalletDBJournal::GetPendingCount() const
+{
+    LOCK(cs_pending);
+    return mapPending.size();
+}
+
+bool WalletDBJournal::Flush()
+{
+    LOCK(cs_flush);
+
+    std::map<std::vector<unsigned char>, PendingRecord> mapFlush;
+    {
+        LOCK(cs_pending);
+        mapFlush.swap(mapPending);
+    }
+    if (mapFlush.empty() || m_database.IsDummy()) {
+        return true;
+    }
+
+    int64_t nStart = GetTimeMicros();
+    // Don't checkpoint on close, the periodic flush takes care of that
+    WalletBatch batch(m_database, "r+", false);
+    bool fSuccess = batch.TxnBegin();
+    for (auto it = mapFlush.begin(); fSuccess && it != mapFlush.end(); ++it) {
+        // erasing a record which was never committed fails, that's fine
+        it->second(batch);
+    }
+    fSuccess = fSuccess && batch.TxnCommit();
+    if (!fSuccess) {
+        batch.TxnAbort();
+        LogPrintf("WalletDBJournal::%s -- failed to commit %d records, retrying later\n", __func__, mapFlush.size());
+        LOCK(cs_pending);
+        // records which were written again in the meantime are newer
+        mapPending.insert(std::make_move_iterator(mapFlush.begin()), std::make_move_iterator(mapFlush.end()));
+        return false;
+    }
+
+    int64_t nDuration = GetTimeMicros() - nStart;
+    nFlushes++;
+    nFlushedRecords += mapFlush.size();
+    nLastFlushMicros = nDuration;
+    if (nDuration > nMaxFlushMicros) {
+        nMaxFlushMicros = nDuration;
+    }
+    LogPrint(BCLog::DB, "WalletDBJournal::%s -- committed %d records in %.2fms\n", __func__, mapFlush.size(), nDuration * 0.001);
+    statsClient.timing("wallet.journal.flushMs", nDuration / 1000, 1.0f);
+    statsClient.count("wallet.journal.records", mapFlush.size(), 1.0f);
+    return true;
+}
+
 void MaybeCompactWalletDB()
 {
     static std::atomic<bool> fOneThread(false);
     if (fOneThread.exchange(true)) {
         return;
     }
+
+    // Commit the write-behind records first, they are updates to be flushed below too
+    for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
+        pwallet->PersistCoinJoinRounds();
+        pwallet->GetDBJournal().Flush();
+    }
+
     if (!gArgs.GetBoolArg("-flushwallet", DEFAULT_FLUSHWALLET)) {
+        fOneThread = false;
         return;
     }
 
@@ -11,7 +11,10 @@
 #include <hdchain.h>
 #include <key.h>
 
+#include <atomic>
+#include <functional>
 #include <list>
+#include <map>
 #include <stdint.h>
 #include <string>
 #include <utility>
@@ -37,6 +40,7 @@ struct CBlockLocator;
 class CGovernanceObject;
 class CKeyPool;
 class CMasterKey;
+class COutPoint;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -164,6 +168,13 @@ public:
     bool ReadCoinJoinSalt(uint256& salt, bool fLegacy = false);
     bool WriteCoinJoinSalt(const uint256& salt);
 
+    /** Record that all encrypted keys were checked to decrypt correctly for this wallet version */
+    bool WriteDecryptionCheck(int nVersion);
+
+    /** Write the CoinJoin rounds of an outpoint, nRoundsMax is the maximum they were calculated with */
+    bool WriteCoinJoinRounds(const COutPoint& outpoint, int nRoundsMax, int nRounds);
+    bool EraseCoinJoinRounds(const COutPoint& outpoint);
+
     /** Write a CGovernanceObject to the database */
     bool WriteGovernanceObject(const CGovernanceObject& obj);
 
@@ -213,6 +224,50 @@ private:
     WalletDatabase& m_database;
 };
 
+/** Write-behind journal for wallet records which are only cached calculation results and can be recalculated if
+ * they get lost, like the CoinJoin rounds of outpoints. Writes are coalesced per key and committed by Flush() in a
+ * single DB transaction, which happens periodically (see MaybeCompactWalletDB) and whenever the wallet is flushed.
+ * Records which can't be recalculated (keys, txs, HD chains, the keypool, ...) must keep using WalletBatch.
+ */
+class WalletDBJournal
+{
+public:
+    explicit WalletDBJournal(WalletDatabase& database) : m_database(database) {}
+    WalletDBJournal(const WalletDBJournal&) = delete;
+    WalletDBJournal& operator=(const WalletDBJournal&) = delete;
+
+    void WriteCoinJoinRounds(const COutPoint& outpoint, int nRoundsMax, int nRounds);
+    /** Drops a pending write of the rounds of outpoint and waits for a running flush, so that a record which the
+     * caller erases through its own WalletBatch afterwards can't be written again by the journal */
+    void DiscardCoinJoinRounds(const COutPoint& outpoint);
+
+    /** Commit all pending records, they are kept for the next attempt if the DB transaction fails */
+    bool Flush();
+    size_t GetPendingCount() const;
+
+    //! Number of flushes which committed records, and the records committed by them
+    std::atomic<uint64_t> nFlushes{0};
+    std::atomic<uint64_t> nFlushedRecords{0};
+    //! Duration of the last and the slowest flush in microseconds
+    std::atomic<int64_t> nLastFlushMicros{0};
+    std::atomic<int64_t> nMaxFlushMicros{0};
+
+private:
+    typedef std::function<bool(WalletBatch&)> PendingRecord;
+
+    template <typename K>
+    static std::vector<unsigned char> SerializeKey(const K& key);
+    template <typename K>
+    void AddPending(const K& key, PendingRecord&& record);
+
+    WalletDatabase& m_database;
+    //! Serializes flushes, so that an older value can't be committed after a newer one for the same key
+    Mutex cs_flush;
+    mutable Mutex cs_pending;
+    //! Pending records by their serialized DB key, only the last write or erase of a key is kept
+    std::map<std::vector<unsigned char>, PendingRecord> mapPending GUARDED_BY(cs_pending);
+};
+
 //! Compacts BDB state so that wallet.dat is self-contained (if there are changes)
 void MaybeCompactWalletDB();
 
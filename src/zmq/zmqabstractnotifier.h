@@ -7,6 +7,8 @@
 
 #include <zmq/zmqconfig.h>
 
+#include <atomic>
+
 class CBlockIndex;
 class CGovernanceObject;
 class CGovernanceVote;
@@ -20,10 +22,13 @@ namespace llmq {
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
+//! Default per-topic ZMQ_SNDHWM, i.e. the number of messages ZMQ queues per subscriber before dropping
+static const int DEFAULT_ZMQ_SNDHWM = 1000;
+
 class CZMQAbstractNotifier
 {
 public:
-    CZMQAbstractNotifier() : psocket(nullptr) { }
+    CZMQAbstractNotifier() : psocket(nullptr), outbound_message_high_water_mark(DEFAULT_ZMQ_SNDHWM) { }
     virtual ~CZMQAbstractNotifier();
 
     template <typename T>
@@ -36,6 +41,14 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    int GetOutboundMessageHighWaterMark() const { return outbound_message_high_water_mark; }
+    void SetOutboundMessageHighWaterMark(const int sndhwm) {
+        if (sndhwm >= 0) {
+            outbound_message_high_water_mark = sndhwm;
+        }
+    }
+    uint64_t GetSentCount() const { return nSent; }
+    uint64_t GetDroppedCount() const { return nDropped; }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
@@ -53,6 +66,11 @@ protected:
     void *psocket;
     std::string type;
     std::string address;
+    int outbound_message_high_water_mark; // aka SNDHWM
+
+    // Updated from the notifying threads and the publisher thread
+    std::atomic<uint64_t> nSent{0};
+    std::atomic<uint64_t> nDropped{0};
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
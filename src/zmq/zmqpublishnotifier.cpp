@@ -5,12 +5,112 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <streams.h>
+#include <sync.h>
+#include <threadinterrupt.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
+#include <util/memory.h>
 #include <util/system.h>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
+/**
+ * Messages are serialized on the notifying thread (usually the validation interface's scheduler thread) and then
+ * handed over to a single publisher thread which does all zmq_msg_send calls. This keeps slow subscribers and large
+ * messages from delaying the dispatch of other validation interface callbacks. The queue is bounded, messages which
+ * don't fit anymore are dropped and counted per notifier.
+ */
+class CZMQPublishQueue
+{
+private:
+    struct Message {
+        CZMQAbstractPublishNotifier* notifier;
+        std::string command;
+        std::vector<unsigned char> data;
+        uint32_t nSequence;
+    };
+
+    // Raw blocks can be large, so the queue is also limited by the bytes it holds
+    static const size_t MAX_QUEUE_BYTES = 256 * 1024 * 1024;
+
+    Mutex cs;
+    std::condition_variable cond GUARDED_BY(cs);
+    std::deque<Message> queue GUARDED_BY(cs);
+    size_t nQueueBytes GUARDED_BY(cs){0};
+    // true while the publisher thread is sending a message it already took from the queue
+    bool fSending GUARDED_BY(cs){false};
+    bool fStop GUARDED_BY(cs){false};
+    const size_t nMaxSize;
+
+    std::thread thread;
+
+    void ThreadMain()
+    {
+        while (true) {
+            Message msg;
+            {
+                WAIT_LOCK(cs, lock);
+                fSending = false;
+                cond.notify_all();
+                cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fStop || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                msg = std::move(queue.front());
+                queue.pop_front();
+                nQueueBytes -= msg.data.size();
+                fSending = true;
+            }
+            msg.notifier->SendQueuedMessage(msg.command, msg.data, msg.nSequence);
+        }
+    }
+
+public:
+    explicit CZMQPublishQueue(size_t _nMaxSize) : nMaxSize(_nMaxSize)
+    {
+        thread = std::thread(&TraceThread<std::function<void()> >, "zmqpub", std::function<void()>(std::bind(&CZMQPublishQueue::ThreadMain, this)));
+    }
+
+    ~CZMQPublishQueue()
+    {
+        {
+            LOCK(cs);
+            fStop = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+
+    bool Push(CZMQAbstractPublishNotifier* notifier, const char* command, const void* data, size_t size, uint32_t nSequence)
+    {
+        {
+            LOCK(cs);
+            if (queue.size() >= nMaxSize || nQueueBytes + size > MAX_QUEUE_BYTES) {
+                return false;
+            }
+            const auto* p = static_cast<const unsigned char*>(data);
+            queue.push_back(Message{notifier, command, std::vector<unsigned char>(p, p + size), nSequence});
+            nQueueBytes += size;
+        }
+        cond.notify_all();
+        return true;
+    }
+
+    //! Waits until all messages queued so far were sent. Must be called before a socket is closed.
+    void Flush()
+    {
+        WAIT_LOCK(cs, lock);
+        cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return queue.empty() && !fSending; });
+    }
+};
+
+// Started with the first and stopped with the last publish notifier, see Initialize/Shutdown
+static std::unique_ptr<CZMQPublishQueue> g_zmq_publish_queue;
+
 static const char *MSG_HASHBLOCK     = "hashblock";
 static const char *MSG_HASHCHAINLOCK = "hashchainlock";
 static const char *MSG_HASHTX        = "hashtx";
@@ -89,7 +189,16 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        LogPrint(BCLog::ZMQ, "zmq: Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
+
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &outbound_message_high_water_mark, sizeof(outbound_message_high_water_mark));
+        if (rc != 0) {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -99,23 +208,31 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 
         // register this notifier for the address, so it can be reused for other publish notifier
         mapPublishNotifiers.insert(std::make_pair(address, this));
-        return true;
     }
     else
     {
         LogPrint(BCLog::ZMQ, "zmq: Reusing socket for address %s\n", address);
+        LogPrint(BCLog::ZMQ, "zmq: Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
 
         psocket = i->second->psocket;
         mapPublishNotifiers.insert(std::make_pair(address, this));
+    }
 
-        return true;
+    if (!g_zmq_publish_queue) {
+        g_zmq_publish_queue = MakeUnique<CZMQPublishQueue>(std::max<int64_t>(1, gArgs.GetArg("-zmqqueuesize", DEFAULT_ZMQ_QUEUE_SIZE)));
     }
+    return true;
 }
 
 void CZMQAbstractPublishNotifier::Shutdown()
 {
     assert(psocket);
 
+    // Messages of this notifier still in the queue reference it and maybe its socket
+    if (g_zmq_publish_queue) {
+        g_zmq_publish_queue->Flush();
+    }
+
     int count = mapPublishNotifiers.count(address);
 
     // remove this notifier from the list of publishers using this address
@@ -140,22 +257,40 @@ void CZMQAbstractPublishNotifier::Shutdown()
     }
 
     psocket = nullptr;
+
+    if (mapPublishNotifiers.empty()) {
+        g_zmq_publish_queue.reset();
+    }
 }
 
 bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
 {
     assert(psocket);
 
+    /* increment memory only sequence number even if the message is dropped, so that subscribers notice the gap */
+    if (!g_zmq_publish_queue->Push(this, command, data, size, nSequence++)) {
+        LogPrint(BCLog::ZMQ, "zmq: Publisher queue full, dropping %s message\n", command);
+        nDropped++;
+    }
+
+    /* a full queue is not a reason to shut down the notifier */
+    return true;
+}
+
+bool CZMQAbstractPublishNotifier::SendQueuedMessage(const std::string& command, const std::vector<unsigned char>& data, uint32_t nMsgSequence)
+{
+    assert(psocket);
+
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
-    if (rc == -1)
+    WriteLE32(&msgseq[0], nMsgSequence);
+    int rc = zmq_send_multipart(psocket, command.data(), command.size(), data.empty() ? (const void*)"" : data.data(), data.size(), msgseq, (size_t)sizeof(uint32_t), nullptr);
+    if (rc == -1) {
+        nDropped++;
         return false;
+    }
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
-
+    nSent++;
     return true;
 }
 
@@ -11,21 +11,28 @@ class CBlockIndex;
 class CGovernanceVote;
 class CGovernanceObject;
 
+//! Default maximum number of messages waiting for the publisher thread, across all topics
+static const unsigned int DEFAULT_ZMQ_QUEUE_SIZE = 10000;
+
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //!< upcounting per message sequence number
+    uint32_t nSequence{0U}; //!< upcounting per message sequence number
 
 public:
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the publisher thread
        parts:
           * command
           * data
           * message sequence number
+       The sequence number is assigned when queueing, so messages dropped due to a full queue show up as gaps.
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
+    /* actually send a queued message, only called by the publisher thread */
+    bool SendQueuedMessage(const std::string& command, const std::vector<unsigned char>& data, uint32_t nMsgSequence);
+
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
 };
@@ -22,7 +22,11 @@ UniValue getzmqnotifications(const JSONRPCRequest& request)
             "[\n"
             "  {                        (json object)\n"
             "    \"type\": \"pubhashtx\",   (string) Type of notification\n"
-            "    \"address\": \"...\"       (string) Address of the publisher\n"
+            "    \"address\": \"...\",      (string) Address of the publisher\n"
+            "    \"hwm\": n,              (numeric) Outbound message high water mark\n"
+            "    \"sent\": n,             (numeric) Number of messages sent since startup\n"
+            "    \"dropped\": n           (numeric) Number of messages dropped since startup because the publisher queue\n"
+            "                                    was full or sending failed\n"
             "  },\n"
             "  ...\n"
             "]\n"
@@ -38,6 +42,9 @@ UniValue getzmqnotifications(const JSONRPCRequest& request)
             UniValue obj(UniValue::VOBJ);
             obj.pushKV("type", n->GetType());
             obj.pushKV("address", n->GetAddress());
+            obj.pushKV("hwm", n->GetOutboundMessageHighWaterMark());
+            obj.pushKV("sent", n->GetSentCount());
+            obj.pushKV("dropped", n->GetDroppedCount());
             result.push_back(obj);
         }
     }
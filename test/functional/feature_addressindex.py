@@ -26,9 +26,9 @@ class AddressIndexTest(BitcoinTestFramework):
         # Nodes 0/1 are "wallet" nodes
         self.start_node(0, [])
         self.start_node(1, ["-addressindex"])
-        # Nodes 2/3 are used for testing
+        # Nodes 2/3 are used for testing, node 3 also keeps the per-address balance aggregates
         self.start_node(2, ["-addressindex"])
-        self.start_node(3, ["-addressindex"])
+        self.start_node(3, ["-addressindex", "-addressbalanceindex"])
         connect_nodes(self.nodes[0], 1)
         connect_nodes(self.nodes[0], 2)
         connect_nodes(self.nodes[0], 3)
@@ -48,6 +48,12 @@ class AddressIndexTest(BitcoinTestFramework):
         self.start_node(1, ["-addressindex", "-reindex"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
+        self.stop_node(3)
+        self.nodes[3].assert_start_raises_init_error(["-addressbalanceindex"], "-addressbalanceindex requires -addressindex.", match=ErrorMatch.PARTIAL_REGEX)
+        self.nodes[3].assert_start_raises_init_error(["-addressindex"], "You need to rebuild the database using -reindex to change -addressbalanceindex", match=ErrorMatch.PARTIAL_REGEX)
+        self.start_node(3, ["-addressindex", "-addressbalanceindex", "-reindex"])
+        connect_nodes(self.nodes[0], 3)
+        self.sync_all()
 
         self.log.info("Mining blocks...")
         mining_address = self.nodes[0].getnewaddress()
@@ -66,6 +72,7 @@ class AddressIndexTest(BitcoinTestFramework):
         assert_equal(balance_mining["balance"], 105 * 500 * COIN)
         assert_equal(balance_mining["balance_immature"], 100 * 500 * COIN)
         assert_equal(balance_mining["balance_spendable"], 5 * 500 * COIN)
+        self.check_balance_index([mining_address, "93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"])
 
         # Check p2pkh and p2sh address indexes
         self.log.info("Testing p2pkh and p2sh address index...")
@@ -126,6 +133,7 @@ class AddressIndexTest(BitcoinTestFramework):
         # Check that balances are correct
         balance0 = self.nodes[1].getaddressbalance("93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB")
         assert_equal(balance0["balance"], 45 * 100000000)
+        self.check_balance_index(["93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB", "yMNJePdcKvXtWWQnFYHNeJ5u8TF2v1dfK4"])
 
         # Check that outputs with the same address will only return one txid
         self.log.info("Testing for txid uniqueness...")
@@ -151,6 +159,7 @@ class AddressIndexTest(BitcoinTestFramework):
         self.log.info("Testing balances...")
         balance0 = self.nodes[1].getaddressbalance("93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB")
         assert_equal(balance0["balance"], 45 * 100000000 + 21)
+        self.check_balance_index(["93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"])
 
         # Check that balances are correct after spending
         self.log.info("Testing balances after spending...")
@@ -188,6 +197,7 @@ class AddressIndexTest(BitcoinTestFramework):
 
         balance2 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance2["balance"], change_amount)
+        self.check_balance_index([address2, "93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"])
 
         # Check that deltas are returned correctly
         deltas = self.nodes[1].getaddressdeltas({"addresses": [address2], "start": 0, "end": 200})
@@ -226,6 +236,7 @@ class AddressIndexTest(BitcoinTestFramework):
 
         balance4 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance4, balance1)
+        self.check_balance_index([address2, "93bVhahvUKmQu8gu9g3QnPPa2cxFK98pMB"])
 
         utxos2 = self.nodes[1].getaddressutxos({"addresses": [address2]})
         assert_equal(len(utxos2), 1)
@@ -245,6 +256,7 @@ class AddressIndexTest(BitcoinTestFramework):
         assert_equal(utxos3[0]["height"], 114)
         assert_equal(utxos3[1]["height"], 264)
         assert_equal(utxos3[2]["height"], 265)
+        self.check_balance_index([address2, mining_address])
 
         # Check mempool indexing
         self.log.info("Testing mempool indexing...")
@@ -342,8 +354,23 @@ class AddressIndexTest(BitcoinTestFramework):
         mempool_deltas = self.nodes[2].getaddressmempool({"addresses": [address1]})
         assert_equal(len(mempool_deltas), 2)
 
+        self.nodes[0].generate(1)
+        self.sync_all()
+        self.check_balance_index([address1, address2, address3, mining_address])
+
+        self.log.info("Testing that the balance index survives a restart...")
+        self.restart_node(3, ["-addressindex", "-addressbalanceindex"])
+        connect_nodes(self.nodes[0], 3)
+        self.check_balance_index([address1, address2, address3, mining_address])
+
         self.log.info("Passed")
 
+    def check_balance_index(self, addresses):
+        # The aggregates kept by -addressbalanceindex must match what the full address index sums up
+        for address in addresses:
+            assert_equal(self.nodes[3].getaddressbalance(address), self.nodes[1].getaddressbalance(address))
+        assert_equal(self.nodes[3].getaddressbalance({"addresses": addresses}), self.nodes[1].getaddressbalance({"addresses": addresses}))
+
 
 if __name__ == '__main__':
     AddressIndexTest().main()
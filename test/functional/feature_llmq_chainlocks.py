@@ -10,6 +10,7 @@ Checks LLMQs based ChainLocks
 
 '''
 
+import os
 import time
 
 from test_framework.test_framework import DashTestFramework
@@ -157,6 +158,20 @@ class LLMQChainLocksTest(DashTestFramework):
         reconnect_isolated_node(self.nodes[0], 1)
         self.wait_for_chainlocked_block(self.nodes[0], self.nodes[0].getbestblockhash(), timeout=30)
 
+        self.log.info("Skip script checks only for blocks deep enough below the best ChainLock")
+        self.restart_node(0, self.extra_args[0] + ["-assumevalidchainlockdepth=1"])
+        connect_nodes(self.nodes[0], 1)
+        self.nodes[1].generatetoaddress(5, node0_mining_addr)
+        good_tip = self.nodes[1].getbestblockhash()
+        self.wait_for_chainlocked_block_all_nodes(good_tip)
+        fork_hash = self.nodes[0].getblockhash(self.nodes[0].getblockcount() - 4)
+        with self.nodes[0].assert_debug_log(["skipping script checks for block %s" % fork_hash]):
+            self.nodes[0].invalidateblock(fork_hash)
+            self.nodes[0].reconsiderblock(fork_hash)
+        assert(self.nodes[0].getbestblockhash() == good_tip)
+        with open(os.path.join(self.nodes[0].datadir, "regtest", "debug.log"), encoding="utf-8") as f:
+            assert("skipping script checks for block %s" % good_tip not in f.read())
+
     def create_chained_txs(self, node, amount):
         txid = node.sendtoaddress(node.getnewaddress(), amount)
         tx = node.getrawtransaction(txid, 1)
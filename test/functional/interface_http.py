@@ -8,6 +8,7 @@ from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal, str_to_b64str
 
 import http.client
+import json
 import urllib.parse
 
 class HTTPBasicsTest (BitcoinTestFramework):
@@ -103,6 +104,33 @@ class HTTPBasicsTest (BitcoinTestFramework):
         out1 = conn.getresponse()
         assert_equal(out1.status, http.client.BAD_REQUEST)
 
+        # Requests for expensive methods are queued separately but still answered
+        conn = http.client.HTTPConnection(urlNode2.hostname, urlNode2.port)
+        conn.connect()
+        conn.request('POST', '/', '[{"method": "getblockcount"}, {"method": "gettxoutsetinfo"}]', headers)
+        out1 = conn.getresponse().read()
+        assert(b'"error":null' in out1)
+
+        # Per-method latency stats are collected
+        stats = self.nodes[2].getrpcstats()
+        assert(stats['methods']['getbestblockhash']['calls'] >= 1)
+        assert_equal(stats['methods']['gettxoutsetinfo']['calls'], 1)
+        assert_equal(sum(stats['methods']['gettxoutsetinfo']['histogram'].values()), 1)
+        assert_equal(stats['slow_queue'], 0)
+
+        # Read-only batch entries are executed in parallel, but results are still returned in order
+        height = self.nodes[2].getblockcount()
+        batch = [{"method": "getblockhash", "params": [h % (height + 1)], "id": h} for h in range(50)]
+        batch.insert(25, {"method": "nonexistingmethod", "id": "x"})
+        conn = http.client.HTTPConnection(urlNode2.hostname, urlNode2.port)
+        conn.connect()
+        conn.request('POST', '/', json.dumps(batch), headers)
+        results = json.loads(conn.getresponse().read().decode('utf-8'))
+        assert_equal([r['id'] for r in results], [r['id'] for r in batch])
+        assert_equal(results[25]['error']['code'], -32601)
+        for r in results[:25] + results[26:]:
+            assert_equal(r['result'], self.nodes[2].getblockhash(r['id'] % (height + 1)))
+
 
 if __name__ == '__main__':
     HTTPBasicsTest ().main ()
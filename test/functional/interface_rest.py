@@ -268,6 +268,38 @@ class RESTTest (BitcoinTestFramework):
         json_obj = self.test_rest_request("/headers/5/{}".format(bb_hash))
         assert_equal(len(json_obj), 5)  # now we should have 5 header objects
 
+        self.log.info("Test the /mnlistdiff URI")
+
+        null_hash = "00" * 32
+        json_obj = self.test_rest_request("/mnlistdiff/{}/{}".format(null_hash, bb_hash))
+        assert_equal(json_obj['blockHash'], bb_hash)
+        assert_equal(json_obj['mnList'], [])
+
+        response = self.test_rest_request("/mnlistdiff/{}/{}".format(null_hash, bb_hash), req_type=ReqType.BIN, ret_type=RetType.OBJ)
+        assert_equal(response.status, 200)
+        etag = response.getheader('ETag')
+        assert_equal(etag, '"{}-{}"'.format(null_hash, bb_hash))
+        assert 'max-age' in response.getheader('Cache-Control')
+        # the binary diff starts with the base and the target block hash
+        diff_bytes = response.read()
+        assert_equal(diff_bytes[32:64][::-1].hex(), bb_hash)
+
+        # A matching If-None-Match is answered with 304 and an empty body
+        conn = http.client.HTTPConnection(self.url.hostname, self.url.port)
+        conn.request('GET', '/rest/mnlistdiff/{}/{}.bin'.format(null_hash, bb_hash), headers={'If-None-Match': etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 304)
+        assert_equal(response.read(), b'')
+
+        self.test_rest_request("/mnlistdiff/{}/{}".format(bb_hash, null_hash), status=404, ret_type=RetType.OBJ)
+        self.test_rest_request("/mnlistdiff/{}".format(bb_hash), status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/quorumcommitment/100/{}".format(bb_hash), status=404, ret_type=RetType.OBJ)
+        self.test_rest_request("/quorumcommitment/abc/{}".format(bb_hash), status=400, ret_type=RetType.OBJ)
+        # Unknown LLMQ types, 356 would be 100 if truncated to uint8_t
+        self.test_rest_request("/quorumcommitment/250/{}".format(bb_hash), status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/quorumcommitment/356/{}".format(bb_hash), status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/chainlock/best", status=404, ret_type=RetType.OBJ)
+
         self.log.info("Test the /tx URI")
 
         tx_hash = block_json_obj['tx'][0]['txid']
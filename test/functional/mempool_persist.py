@@ -33,16 +33,38 @@ Test is as follows:
     mempool.
   - Verify that savemempool throws when the RPC is called if
     node1 can't write to disk.
+  - Rewrite node1's mempool.dat in the version 1 format, which has no
+    islocks. Verify that node1 still loads its 5 transactions.
 
 """
 from decimal import Decimal
 import os
+import struct
 import time
 
+from test_framework.messages import CTransaction
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal, assert_raises_rpc_error, wait_until
 
 
+def downgrade_mempooldat(path):
+    """Rewrite a version 2 mempool.dat without islocks in the version 1 format"""
+    with open(path, 'rb') as f:
+        version, num = struct.unpack("<QQ", f.read(16))
+        assert_equal(version, 2)
+        entries = b""
+        for _ in range(num):
+            tx = CTransaction()
+            tx.deserialize(f)
+            # nTime and nFeeDelta
+            entries += tx.serialize() + f.read(16)
+            # there are no quorums to lock the transactions
+            assert_equal(f.read(1), b"\x00")
+        deltas = f.read()
+    with open(path, 'wb') as f:
+        f.write(struct.pack("<QQ", 1, num) + entries + deltas)
+
+
 class MempoolPersistTest(BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 3
@@ -127,6 +149,12 @@ class MempoolPersistTest(BitcoinTestFramework):
         assert_raises_rpc_error(-1, "Unable to dump mempool to disk", self.nodes[1].savemempool)
         os.rmdir(mempooldotnew1)
 
+        self.log.debug("Stop node1, rewrite its mempool.dat as version 1. Verify that it still has 5 transactions")
+        self.stop_nodes()
+        downgrade_mempooldat(mempooldat1)
+        self.start_node(1, extra_args=[])
+        wait_until(lambda: len(self.nodes[1].getrawmempool()) == 5)
+
 
 if __name__ == '__main__':
     MempoolPersistTest().main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Dash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+from io import BytesIO
+
+from test_framework.messages import msg_getmnlistd, msg_lz4msg, msg_mnlistdiff, msg_sendlz4
+from test_framework.mininode import mininode_lock, P2PInterface
+from test_framework.test_framework import DashTestFramework
+from test_framework.util import assert_equal, wait_until
+
+'''
+p2p_compression.py
+
+Tests SENDLZ4/LZ4MSG negotiation and the fallback to uncompressed messages
+
+'''
+
+P2P_COMPRESSION_VERSION = 70222
+
+
+def lz4_block_decompress(src, size):
+    dst = bytearray()
+    pos = 0
+    while pos < len(src):
+        token = src[pos]
+        pos += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                pos += 1
+                length += src[pos - 1]
+                if src[pos - 1] != 255:
+                    break
+        dst += src[pos:pos + length]
+        pos += length
+        if pos == len(src):
+            break
+        offset = src[pos] | (src[pos + 1] << 8)
+        pos += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                pos += 1
+                length += src[pos - 1]
+                if src[pos - 1] != 255:
+                    break
+        for _ in range(length + 4):
+            dst.append(dst[-offset])
+    assert_equal(len(dst), size)
+    return bytes(dst)
+
+
+class TestP2PConn(P2PInterface):
+    def __init__(self, version=None):
+        super().__init__()
+        self.version = version
+
+    def peer_connect(self, *args, **kwargs):
+        create_conn = super().peer_connect(*args, **kwargs)
+        if self.version is not None:
+            self.on_connection_send_msg.nVersion = self.version
+        return create_conn
+
+    def getmnlistdiff(self, baseBlockHash, blockHash, expected_command):
+        with mininode_lock:
+            self.last_message.pop(expected_command, None)
+        self.send_message(msg_getmnlistd(baseBlockHash, blockHash))
+        wait_until(lambda: expected_command in self.last_message, timeout=30, lock=mininode_lock)
+        with mininode_lock:
+            return self.last_message[expected_command]
+
+
+def get_compression_stats(node, uacomment):
+    for peer in node.getpeerinfo():
+        if uacomment in peer["subver"]:
+            return peer["compression"]
+    assert False
+
+
+class P2PCompressionTest(DashTestFramework):
+    def set_test_params(self):
+        self.set_dash_test_params(4, 3, fast_dip3_enforcement=True)
+
+    def run_test(self):
+        node = self.nodes[0]
+        tip = int(node.getbestblockhash(), 16)
+
+        self.log.info("Test that old peers get neither SENDLZ4 nor compressed messages")
+        old_peer = node.add_p2p_connection(TestP2PConn(), uacomment="old")
+        old_peer.sync_with_ping()
+        assert "sendlz4" not in old_peer.message_count
+        mnlistdiff = old_peer.getmnlistdiff(0, tip, "mnlistdiff")
+        assert "lz4msg" not in old_peer.message_count
+        assert_equal(len(mnlistdiff.mnList), self.mn_count)
+        # The diff is big enough to be compressed
+        assert_equal(get_compression_stats(node, "old")["bytessent"], 0)
+
+        self.log.info("Test that peers which don't send SENDLZ4 get uncompressed messages")
+        new_peer = node.add_p2p_connection(TestP2PConn(P2P_COMPRESSION_VERSION), uacomment="new")
+        wait_until(lambda: "sendlz4" in new_peer.message_count, timeout=30, lock=mininode_lock)
+        new_peer.getmnlistdiff(0, tip, "mnlistdiff")
+        assert "lz4msg" not in new_peer.message_count
+        assert_equal(get_compression_stats(node, "new")["enabled"], False)
+
+        self.log.info("Test that peers which send SENDLZ4 get compressed messages")
+        new_peer.send_message(msg_sendlz4())
+        new_peer.sync_with_ping()
+        assert_equal(get_compression_stats(node, "new")["enabled"], True)
+        lz4msg = new_peer.getmnlistdiff(0, tip, "lz4msg")
+        assert_equal(lz4msg.wrapped_command, b"mnlistdiff")
+        assert len(lz4msg.data) < lz4msg.size
+        compressed_mnlistdiff = msg_mnlistdiff()
+        compressed_mnlistdiff.deserialize(BytesIO(lz4_block_decompress(lz4msg.data, lz4msg.size)))
+        assert_equal(compressed_mnlistdiff.blockHash, mnlistdiff.blockHash)
+        assert_equal([mn.proRegTxHash for mn in compressed_mnlistdiff.mnList], [mn.proRegTxHash for mn in mnlistdiff.mnList])
+        stats = get_compression_stats(node, "new")
+        assert_equal(stats["bytessent"], len(lz4msg.serialize()))
+        assert_equal(stats["bytessent_uncompressed"], lz4msg.size)
+
+        self.log.info("Test that compressed messages are processed as the message they wrap")
+        data = lz4msg.data
+        # An unrequested MNLISTDIFF gets the peer disconnected, compressed or not
+        with node.assert_debug_log(["received not-requested mnlistdiff"]):
+            new_peer.send_message(msg_lz4msg(b"mnlistdiff", lz4msg.size, data))
+            new_peer.wait_for_disconnect()
+        node.disconnect_p2ps()
+
+        self.log.info("Test that malformed LZ4MSG gets the peer disconnected")
+        for msg in [
+            # More than 255 bytes per compressed byte announced
+            msg_lz4msg(b"mnlistdiff", len(data) * 255 + 1, data),
+            # Wrong size announced
+            msg_lz4msg(b"mnlistdiff", lz4msg.size + 1, data),
+            # Not a compressible message
+            msg_lz4msg(b"getmnlistd", lz4msg.size, data),
+            # Not LZ4
+            msg_lz4msg(b"mnlistdiff", 100, b"\xff" * 50),
+        ]:
+            peer = node.add_p2p_connection(TestP2PConn(P2P_COMPRESSION_VERSION))
+            peer.send_message(msg)
+            peer.wait_for_disconnect()
+        node.disconnect_p2ps()
+
+        self.log.info("Test that -p2pcompression=0 disables the negotiation")
+        self.restart_node(0, self.extra_args[0] + ["-p2pcompression=0"])
+        new_peer = node.add_p2p_connection(TestP2PConn(P2P_COMPRESSION_VERSION), uacomment="new")
+        new_peer.send_message(msg_sendlz4())
+        new_peer.getmnlistdiff(0, tip, "mnlistdiff")
+        assert "sendlz4" not in new_peer.message_count
+        assert "lz4msg" not in new_peer.message_count
+        assert_equal(get_compression_stats(node, "new")["enabled"], False)
+        new_peer.send_message(lz4msg)
+        new_peer.wait_for_disconnect()
+
+
+if __name__ == '__main__':
+    P2PCompressionTest().main()
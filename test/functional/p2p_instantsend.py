@@ -3,8 +3,11 @@
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+import os
+import shutil
+
 from test_framework.test_framework import DashTestFramework
-from test_framework.util import assert_equal, assert_raises_rpc_error, bytes_to_hex_str, hash256, hex_str_to_bytes, isolate_node, reconnect_isolated_node
+from test_framework.util import assert_equal, assert_raises_rpc_error, bytes_to_hex_str, connect_nodes, hash256, hex_str_to_bytes, isolate_node, reconnect_isolated_node
 
 '''
 p2p_instantsend.py
@@ -27,6 +30,7 @@ class InstantSendTest(DashTestFramework):
 
         self.test_mempool_doublespend()
         self.test_block_doublespend()
+        self.test_mempool_persist_islock()
 
     def test_block_doublespend(self):
         sender = self.nodes[self.sender_idx]
@@ -123,5 +127,23 @@ class InstantSendTest(DashTestFramework):
         self.nodes[0].generate(2)
         self.sync_all()
 
+    def test_mempool_persist_islock(self):
+        node = self.nodes[0]
+        is_id = node.sendtoaddress(node.getnewaddress(), 1)
+        self.sync_mempools()
+        self.wait_for_instantlock(is_id, node)
+
+        # Wipe the llmq db, which holds the InstantSend db, as if the islock was pruned from it. The node is no
+        # masternode and the islock isn't announced again, so it can only come from mempool.dat.
+        with node.assert_debug_log(["restored islock from mempool.dat"]):
+            self.stop_node(0)
+            shutil.rmtree(os.path.join(node.datadir, self.chain, "llmq"))
+            self.start_node(0)
+            self.bump_mocktime(1)
+            self.wait_for_instantlock(is_id, node)
+        for i in range(1, self.num_nodes):
+            connect_nodes(node, i)
+        self.sync_all()
+
 if __name__ == '__main__':
     InstantSendTest().main()
@@ -28,9 +28,12 @@ class RPCZMQTest(BitcoinTestFramework):
 
         self.restart_node(0, extra_args=["-zmqpubhashtx=%s" % self.address])
         assert_equal(self.nodes[0].getzmqnotifications(), [
-            {"type": "pubhashtx", "address": self.address},
+            {"type": "pubhashtx", "address": self.address, "hwm": 1000, "sent": 0, "dropped": 0},
         ])
 
+        self.restart_node(0, extra_args=["-zmqpubhashtx=%s" % self.address, "-zmqpubhashtxhwm=10"])
+        assert_equal(self.nodes[0].getzmqnotifications()[0]["hwm"], 10)
+
 
 if __name__ == '__main__':
     RPCZMQTest().main()
@@ -23,7 +23,7 @@ import sys
 import time
 import threading
 
-from test_framework.messages import CBlockHeader, MIN_VERSION_SUPPORTED, msg_addr, msg_addrv2, msg_block, msg_blocktxn, msg_clsig, msg_cmpctblock, msg_getaddr, msg_getblocks, msg_getblocktxn, msg_getdata, msg_getheaders, msg_getmnlistd, msg_headers, msg_inv, msg_islock, msg_mempool, msg_mnlistdiff, msg_ping, msg_pong, msg_qdata, msg_qgetdata, msg_reject, msg_sendaddrv2, msg_sendcmpct, msg_sendheaders, msg_tx, msg_verack, msg_version, MY_SUBVERSION, NODE_NETWORK, sha256
+from test_framework.messages import CBlockHeader, MIN_VERSION_SUPPORTED, msg_addr, msg_addrv2, msg_block, msg_blocktxn, msg_cfcheckpt, msg_cfheaders, msg_cfilter, msg_clsig, msg_cmpctblock, msg_getaddr, msg_getblocks, msg_getblocktxn, msg_getdata, msg_getheaders, msg_getmnlistd, msg_headers, msg_inv, msg_islock, msg_lz4msg, msg_mempool, msg_mnlistdiff, msg_ping, msg_pong, msg_qdata, msg_qgetdata, msg_reject, msg_sendaddrv2, msg_sendcmpct, msg_sendlz4, msg_sendheaders, msg_tx, msg_verack, msg_version, MY_SUBVERSION, NODE_NETWORK, sha256
 from test_framework.util import wait_until
 
 MSG_TX = 1
@@ -37,6 +37,9 @@ MESSAGEMAP = {
     b"addrv2": msg_addrv2,
     b"block": msg_block,
     b"blocktxn": msg_blocktxn,
+    b"cfcheckpt": msg_cfcheckpt,
+    b"cfheaders": msg_cfheaders,
+    b"cfilter": msg_cfilter,
     b"cmpctblock": msg_cmpctblock,
     b"getaddr": msg_getaddr,
     b"getblocks": msg_getblocks,
@@ -61,6 +64,7 @@ MESSAGEMAP = {
     b"getsporks": None,
     b"govsync": None,
     b"islock": msg_islock,
+    b"lz4msg": msg_lz4msg,
     b"mnlistdiff": msg_mnlistdiff,
     b"notfound": None,
     b"qfcommit": None,
@@ -69,6 +73,7 @@ MESSAGEMAP = {
     b"qdata": msg_qdata,
     b"qwatch" : None,
     b"senddsq": None,
+    b"sendlz4": msg_sendlz4,
     b"spork": None,
 }
 
@@ -329,6 +334,9 @@ class P2PInterface(P2PConnection):
     def on_addrv2(self, message): pass
     def on_block(self, message): pass
     def on_blocktxn(self, message): pass
+    def on_cfcheckpt(self, message): pass
+    def on_cfheaders(self, message): pass
+    def on_cfilter(self, message): pass
     def on_cmpctblock(self, message): pass
     def on_feefilter(self, message): pass
     def on_getaddr(self, message): pass
@@ -364,6 +372,9 @@ class P2PInterface(P2PConnection):
     def on_qdata(self, message): pass
     def on_qwatch(self, message): pass
 
+    def on_sendlz4(self, message): pass
+    def on_lz4msg(self, message): pass
+
     def on_verack(self, message):
         self.verack_received = True
 
@@ -156,6 +156,15 @@ class WalletTest(BitcoinTestFramework):
         node0utxos = self.nodes[0].listunspent(1)
         assert_equal(len(node0utxos), 2)
 
+        # paging with a cursor returns the UTXOs sorted by outpoint
+        first_page = self.nodes[0].listunspent(1, 9999999, [], True, {"maximumCount": 1, "cursor": ""})
+        cursor = "%s:%d" % (first_page[0]["txid"], first_page[0]["vout"])
+        second_page = self.nodes[0].listunspent(1, 9999999, [], True, {"maximumCount": 1, "cursor": cursor})
+        assert_equal(len(second_page), 1)
+        assert_equal(self.nodes[0].listunspent(1, 9999999, [], True, {"maximumCount": 1, "cursor": "%s:%d" % (second_page[0]["txid"], second_page[0]["vout"])}), [])
+        assert_equal(sorted(node0utxos, key=lambda u: u["txid"]), sorted(first_page + second_page, key=lambda u: u["txid"]))
+        assert_raises_rpc_error(-8, "Invalid cursor", self.nodes[0].listunspent, 1, 9999999, [], True, {"cursor": "x:0"})
+
         fee_per_input = Decimal('0.00001')
         totalfee = 0
         # create both transactions
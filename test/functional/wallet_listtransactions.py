@@ -10,6 +10,7 @@ from test_framework.messages import CTransaction
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import (
     assert_array_result,
+    assert_equal,
     hex_str_to_bytes,
 )
 
@@ -96,5 +97,18 @@ class ListTransactionsTest(BitcoinTestFramework):
                             {"category": "receive", "amount": Decimal("0.1")},
                             {"txid": txid, "label": "watchonly"})
 
+        # paging by order position returns the same history as a single call, pages end at whole transactions
+        all_txs = self.nodes[1].listtransactions("*", 1000)
+        paged_txs = []
+        before = -1
+        while True:
+            page = self.nodes[1].listtransactions("*", 3, 0, False, before)
+            if not page:
+                break
+            assert len(page) >= 3 or len(paged_txs) + len(page) == len(all_txs)
+            before = min(entry.pop("orderpos") for entry in page)
+            paged_txs = page + paged_txs
+        assert_equal(paged_txs, all_txs)
+
 if __name__ == '__main__':
     ListTransactionsTest().main()